@@ -66,6 +66,11 @@ enum access_query_e
     ACCESS_GET_PRIVATE_ID_STATE,    /* arg1=int i_private_data arg2=bool *  res=can fail */
 
     ACCESS_GET_CONTENT_TYPE, /* arg1=char **ppsz_content_type */
+
+    /* Timeshift window, in bytes and in time elapsed since its start */
+    ACCESS_GET_TIMESHIFT_WINDOW, /* arg1= int64_t *i_start arg2= int64_t *i_end arg3= mtime_t *i_length res=can fail */
+    /* Position of the data received i_delay ago */
+    ACCESS_GET_TIMESHIFT_POS,    /* arg1= mtime_t i_delay arg2= int64_t *i_pos res=can fail */
 };
 
 struct access_t
@@ -212,6 +212,11 @@ typedef struct aout_mixer_t
      * software. Beware, this creates sound distortion and should be avoided
      * as much as possible. This isn't available for non-float32 mixer. */
     float                   f_multiplier;
+
+    /** Statistics, protected by the mixer lock: number of mixed buffers and
+     * total time spent in pf_do_work for them. */
+    unsigned                i_nb_mixes;
+    mtime_t                 i_mix_time;
 } aout_mixer_t;
 
 /** audio output buffer FIFO */
@@ -274,6 +279,15 @@ struct aout_input_t
 
     /* Mixer information */
     uint8_t *               p_first_byte_to_mix;
+    /* Buffers taken out of fifo while the mixer runs without the input
+     * FIFOs lock ; only used with the mixer lock. */
+    aout_fifo_t             mix_fifo;
+    /* Set with the input FIFOs lock when fifo is flushed ; the mixer then
+     * resets p_first_byte_to_mix, which is only written with the mixer
+     * lock. i_mix_moved is the dates offset applied to fifo while its
+     * buffers are in mix_fifo. */
+    bool                    b_mix_flushed;
+    mtime_t                 i_mix_moved;
     audio_replay_gain_t     replay_gain;
     float                   f_multiplier;
 
@@ -302,6 +316,9 @@ typedef struct aout_output_t
     /* Indicates whether the audio output is currently starving, to avoid
      * printing a 1,000 "output is starving" messages. */
     bool              b_starving;
+    /* Number of times the output ran out of mixed buffers, protected by the
+     * output FIFO lock. */
+    unsigned                i_underruns;
 
     /* post-filters */
     aout_filter_t *         pp_filters[AOUT_MAX_FILTERS];
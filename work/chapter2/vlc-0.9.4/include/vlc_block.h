@@ -125,10 +125,16 @@ struct block_t
  *      with preheader and or body (increase
  *      and decrease are supported). Use it as it is optimised.
  * - block_Duplicate : create a copy of a block.
+ * - block_Share : create a block sharing the payload of another one, which
+ *      then becomes read-only for both.
+ * - block_Unshare : make the payload of a block writable, copying it if it
+ *      is shared.
  ****************************************************************************/
 VLC_EXPORT( void,      block_Init,    ( block_t *, void *, size_t ) );
 VLC_EXPORT( block_t *, block_Alloc,   ( size_t ) );
 VLC_EXPORT( block_t *, block_Realloc, ( block_t *, ssize_t i_pre, size_t i_body ) );
+VLC_EXPORT( block_t *, block_Share,   ( block_t * ) );
+VLC_EXPORT( block_t *, block_Unshare, ( block_t * ) );
 
 #define block_New( dummy, size ) block_Alloc(size)
 
@@ -156,6 +162,7 @@ static inline void block_Release( block_t *p_block )
 
 VLC_EXPORT( block_t *, block_mmap_Alloc, (void *addr, size_t length) );
 VLC_EXPORT( block_t *, block_File, (int fd) );
+VLC_EXPORT( const uint8_t *, block_StartcodeFind, ( const uint8_t *, const uint8_t * ) );
 
 /****************************************************************************
  * Chains of blocks functions helper
@@ -436,14 +436,59 @@ static inline int block_PeekOffsetBytes( block_bytestream_t *p_bytestream,
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Start code search
+ *****************************************************************************/
+/* Returns the first position p in [p, p_end) such that the start code lies
+ * entirely in [p, p_end), or NULL if there is none. The common 00 00 01
+ * start code uses the CPU-optimized block_StartcodeFind(). */
+static inline const uint8_t *block_StartcodeFindGeneric( const uint8_t *p,
+    const uint8_t *p_end, const uint8_t *p_startcode, int i_startcode_length )
+{
+    if( i_startcode_length == 3 && p_startcode[0] == 0x00 &&
+        p_startcode[1] == 0x00 && p_startcode[2] == 0x01 )
+        return block_StartcodeFind( p, p_end );
+
+    while( p_end - p >= i_startcode_length )
+    {
+        p = memchr( p, p_startcode[0], p_end - p - i_startcode_length + 1 );
+        if( p == NULL )
+            return NULL;
+        if( !memcmp( p + 1, p_startcode + 1, i_startcode_length - 1 ) )
+            return p;
+        p++;
+    }
+    return NULL;
+}
+
+/* Compares the start code against the data at i_offset in p_block and the
+ * following blocks. Returns -1 on mismatch, else the number of matching
+ * bytes, which is less than i_startcode_length if the chain is too short. */
+static inline int block_StartcodeMatchChain( const block_t *p_block,
+    size_t i_offset, const uint8_t *p_startcode, int i_startcode_length )
+{
+    int i_match = 0;
+
+    for( ; p_block != NULL; p_block = p_block->p_next, i_offset = 0 )
+    {
+        for( ; i_offset < p_block->i_buffer; i_offset++ )
+        {
+            if( p_block->p_buffer[i_offset] != p_startcode[i_match] )
+                return -1;
+            if( ++i_match == i_startcode_length )
+                return i_match;
+        }
+    }
+    return i_match;
+}
+
 static inline int block_FindStartcodeFromOffset(
     block_bytestream_t *p_bytestream, size_t *pi_offset,
     uint8_t *p_startcode, int i_startcode_length )
 {
-    block_t *p_block, *p_block_backup = 0;
+    block_t *p_block;
     int i_size = 0;
-    size_t i_offset, i_offset_backup = 0;
-    int i_caller_offset_backup = 0, i_match;
+    size_t i_offset;
 
     /* Find the right place */
     i_size = *pi_offset + p_bytestream->i_offset;
@@ -461,48 +506,44 @@ static inline int block_FindStartcodeFromOffset(
     }
 
     /* Begin the search.
-     * We first look for an occurrence of the 1st startcode byte and
-     * if found, we do a more thorough check. */
-    i_size += p_block->i_buffer;
-    *pi_offset -= i_size;
-    i_match = 0;
-    for( ; p_block != NULL; p_block = p_block->p_next )
+     * Start codes lying inside one block are found with the fast helpers,
+     * only the few positions at the end of each block need the slow path
+     * crossing block boundaries. */
+    i_offset = i_size + p_block->i_buffer;
+    *pi_offset -= i_offset;
+    for( ; p_block != NULL; p_block = p_block->p_next, i_offset = 0 )
     {
-        for( i_offset = i_size; i_offset < p_block->i_buffer; i_offset++ )
+        const uint8_t *p_found;
+
+        p_found = block_StartcodeFindGeneric( p_block->p_buffer + i_offset,
+                                    p_block->p_buffer + p_block->i_buffer,
+                                    p_startcode, i_startcode_length );
+        if( p_found != NULL )
         {
-            if( p_block->p_buffer[i_offset] == p_startcode[i_match] )
-            {
-                if( !i_match )
-                {
-                    p_block_backup = p_block;
-                    i_offset_backup = i_offset;
-                    i_caller_offset_backup = *pi_offset;
-                }
-
-                if( i_match + 1 == i_startcode_length )
-                {
-                    /* We have it */
-                    *pi_offset += i_offset - i_match;
-                    return VLC_SUCCESS;
-                }
-
-                i_match++;
-            }
-            else if ( i_match )
-            {
-                /* False positive */
-                p_block = p_block_backup;
-                i_offset = i_offset_backup;
-                *pi_offset = i_caller_offset_backup;
-                i_match = 0;
-            }
+            /* We have it */
+            *pi_offset += p_found - p_block->p_buffer;
+            return VLC_SUCCESS;
+        }
 
+        if( p_block->i_buffer >= (size_t)i_startcode_length )
+            i_offset = __MAX( i_offset,
+                              p_block->i_buffer - i_startcode_length + 1 );
+        for( ; i_offset < p_block->i_buffer; i_offset++ )
+        {
+            int i_match = block_StartcodeMatchChain( p_block, i_offset,
+                                            p_startcode, i_startcode_length );
+            if( i_match < 0 )
+                continue;
+
+            /* Either we have it, or we ran out of data in the middle of a
+             * possible start code, which will be searched again from here */
+            *pi_offset += i_offset;
+            return i_match == i_startcode_length ? VLC_SUCCESS
+                                                 : VLC_EGENERIC;
         }
-        i_size = 0;
-        *pi_offset += i_offset;
+        *pi_offset += p_block->i_buffer;
     }
 
-    *pi_offset -= i_match;
     return VLC_EGENERIC;
 }
 
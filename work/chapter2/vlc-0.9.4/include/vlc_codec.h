@@ -67,6 +67,11 @@ struct decoder_t
     /* Tell the decoder if it is allowed to drop frames */
     bool          b_pace_control;
 
+    /* Number of pictures the decoder keeps linked on top of the usual video
+     * output needs (reference pictures), to be set before the first
+     * pf_vout_buffer_new call */
+    int           i_extra_picture_buffers;
+
     /* */
     picture_t *         ( * pf_decode_video )( decoder_t *, block_t ** );
     aout_buffer_t *     ( * pf_decode_audio )( decoder_t *, block_t ** );
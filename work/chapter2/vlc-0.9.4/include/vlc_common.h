@@ -840,6 +840,8 @@ VLC_EXPORT(int, vlc_wclosedir, ( void *_p_dir ));
 #define CPU_CAPABILITY_MMXEXT  (1<<5)
 #define CPU_CAPABILITY_SSE     (1<<6)
 #define CPU_CAPABILITY_SSE2    (1<<7)
+#define CPU_CAPABILITY_SSSE3   (1<<8)
+#define CPU_CAPABILITY_AVX2    (1<<9)
 #define CPU_CAPABILITY_ALTIVEC (1<<16)
 #define CPU_CAPABILITY_FPU     (1<<31)
 VLC_EXPORT( unsigned, vlc_CPU, ( void ) );
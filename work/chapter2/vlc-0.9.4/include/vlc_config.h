@@ -107,7 +107,7 @@
 #define AOUT_MAX_FILTERS                10
 
 /* Max number of inputs */
-#define AOUT_MAX_INPUTS                 5
+#define AOUT_MAX_INPUTS                 32
 
 /* Buffers which arrive in advance of more than AOUT_MAX_ADVANCE_TIME
  * will be considered as bogus and be trashed */
@@ -146,8 +146,9 @@
 /* Number of planes in a picture */
 #define VOUT_MAX_PLANES                 5
 
-/* Video heap size - remember that a decompressed picture is big
- * (~1 Mbyte) before using huge values */
+/* Default and minimum number of render pictures, and maximum number of
+ * direct buffers a video output may allocate - remember that a decompressed
+ * picture is big (~1 Mbyte) before using huge values */
 #define VOUT_MAX_PICTURES               8
 
 /* Minimum number of direct pictures the video output will accept without
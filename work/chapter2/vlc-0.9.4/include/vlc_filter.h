@@ -33,6 +33,7 @@
  */
 
 typedef struct filter_owner_sys_t filter_owner_sys_t;
+typedef struct filter_slices_t filter_slices_t;
 
 /** Structure describing a filter
  * @warning BIG FAT WARNING : the code relies on the first 4 members of
@@ -88,6 +89,9 @@ struct filter_t
 
     /* Private structure for the owner of the decoder */
     filter_owner_sys_t *p_owner;
+
+    /* Threads for filter_RunSlices(), provided by the owner (can be NULL) */
+    filter_slices_t *p_slices;
 };
 
 /**
@@ -191,6 +195,94 @@ static inline block_t *filter_NewAudioBuffer( filter_t *p_filter, int i_size )
         return p_outpic;                                                \
     }
 
+/**
+ * Slice threading
+ *
+ * A video filter that renders each line of its output from a bounded
+ * neighbourhood of its input can split a picture into horizontal slices and
+ * render them with filter_RunSlices(). If the owner of the filter gave it a
+ * thread pool (p_slices), the slices are shared between the pool and the
+ * calling thread; otherwise the slice function is called once for the whole
+ * picture. A slice function must only write the lines of its own slice, as
+ * given by filter_GetSliceLines(), and must not change the filter state.
+ */
+typedef void (*filter_slice_t)( filter_t *, picture_t *p_src,
+                                picture_t *p_dst, int i_slice, int i_slices );
+
+/**
+ * Create a pool of threads for filter_RunSlices().
+ *
+ * \param i_threads number of threads, including the calling one, or 0 for
+ * one per CPU
+ * \return the pool, or NULL if there is no use for one
+ */
+VLC_EXPORT( filter_slices_t *, __filter_slices_New, ( vlc_object_t *, unsigned ) );
+#define filter_slices_New( a, b ) __filter_slices_New( VLC_OBJECT( a ), b )
+
+/**
+ * Destroy a pool of threads created with filter_slices_New().
+ */
+VLC_EXPORT( void, filter_slices_Delete, ( filter_slices_t * ) );
+
+/**
+ * Render every slice of a picture with the threads of the pool, and wait
+ * for them. A pool is only used by one thread at a time.
+ */
+VLC_EXPORT( void, filter_slices_Run, ( filter_slices_t *, filter_t *, filter_slice_t, picture_t *, picture_t * ) );
+
+/**
+ * Render a picture with a slice function, in parallel if the owner of the
+ * filter allows it.
+ */
+static inline void filter_RunSlices( filter_t *p_filter,
+                                     filter_slice_t pf_slice,
+                                     picture_t *p_src, picture_t *p_dst )
+{
+    if( p_filter->p_slices )
+        filter_slices_Run( p_filter->p_slices, p_filter, pf_slice,
+                           p_src, p_dst );
+    else
+        pf_slice( p_filter, p_src, p_dst, 0, 1 );
+}
+
+/**
+ * Compute the lines [*pi_first, *pi_last) of slice i_slice out of i_slices,
+ * for i_lines lines processed in groups of i_align lines.
+ */
+static inline void filter_GetSliceLines( int i_lines, int i_align,
+                                         int i_slice, int i_slices,
+                                         int *pi_first, int *pi_last )
+{
+    const int i_groups = ( i_lines + i_align - 1 ) / i_align;
+
+    *pi_first = __MIN( i_groups * i_slice / i_slices * i_align, i_lines );
+    *pi_last = __MIN( i_groups * ( i_slice + 1 ) / i_slices * i_align,
+                      i_lines );
+}
+
+/**
+ * Same as VIDEO_FILTER_WRAPPER, using a filter_slice_t function, for the
+ * converters where every line (or pair of lines) can be done on its own
+ */
+#define VIDEO_FILTER_WRAPPER_SLICES( name )                             \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( !p_outpic )                                                 \
+        {                                                               \
+            picture_Release( p_pic );                                   \
+            return NULL;                                                \
+        }                                                               \
+                                                                        \
+        filter_RunSlices( p_filter, name, p_pic, p_outpic );            \
+                                                                        \
+        picture_CopyProperties( p_outpic, p_pic );                      \
+        picture_Release( p_pic );                                       \
+                                                                        \
+        return p_outpic;                                                \
+    }
+
 /**
  * Filter chain management API
  * The filter chain management API is used to dynamically construct filters
@@ -421,6 +421,7 @@ typedef enum input_state_e
 #define INPUT_UPDATE_TITLE      0x0010
 #define INPUT_UPDATE_SEEKPOINT  0x0020
 #define INPUT_UPDATE_META       0x0040
+#define INPUT_UPDATE_DISCONTINUITY 0x0080 /* data was skipped */
 
 /* Input control XXX: internal */
 #define INPUT_CONTROL_FIFO_SIZE    100
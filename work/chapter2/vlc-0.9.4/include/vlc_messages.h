@@ -257,6 +257,8 @@ struct input_stats_t
     int i_read_bytes;
     float f_input_bitrate;
     float f_average_input_bitrate;
+    int i_stream_cache_hits;
+    int i_stream_cache_misses;
 
     /* Demux */
     int i_demux_read_packets;
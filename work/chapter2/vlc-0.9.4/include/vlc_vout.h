@@ -209,7 +209,7 @@ struct picture_heap_t
     /**@}*/
 
     /* Real pictures */
-    picture_t*      pp_picture[VOUT_MAX_PICTURES];             /**< pictures */
+    picture_t**     pp_picture;                                /**< pictures */
     int             i_last_used_pic;              /**< last used pic in heap */
     bool            b_allow_modify_pics;
 
@@ -437,6 +437,9 @@ VLC_EXPORT( int, __vout_AllocatePicture,( vlc_object_t *p_this, picture_t *p_pic
  * @{
  */
 
+/** Snapshot writer thread, private to the video output */
+typedef struct vout_snapshot_t vout_snapshot_t;
+
 /**
  * Video output thread descriptor
  *
@@ -454,6 +457,9 @@ struct vout_thread_t
     vlc_mutex_t         subpicture_lock;           /**< subpicture heap lock */
     vlc_mutex_t         change_lock;                 /**< thread change lock */
     vlc_mutex_t         vfilter_lock;         /**< video filter2 change lock */
+    vlc_cond_t          picture_released;  /**< a picture went back to the heap */
+    vlc_cond_t          picture_queued;       /**< a picture became ready */
+    unsigned            i_picture_queued;   /**< pictures made ready so far */
     vout_sys_t *        p_sys;                     /**< system output method */
     /**@}*/
 
@@ -512,8 +518,13 @@ struct vout_thread_t
     video_format_t      fmt_out;     /* output format (for the video output) */
     /**@}*/
 
-    /* Picture heap */
-    picture_t           p_picture[2*VOUT_MAX_PICTURES+1];      /**< pictures */
+    /* Picture heap: VOUT_MAX_PICTURES slots for the direct buffers, the
+     * render pictures, and a temporary picture */
+    picture_t          *p_picture;                            /**< pictures */
+    int                 i_heap_pictures;        /**< size of the picture heap */
+    int                 i_render_pictures;    /**< requested render pictures */
+    picture_t         **pp_free_picture;  /**< render pictures ready for use */
+    int                 i_free_pictures;
 
     /* Subpicture unit */
     spu_t          *p_spu;
@@ -538,6 +549,7 @@ struct vout_thread_t
 
     /* Misc */
     bool            b_snapshot;     /**< take one snapshot on the next loop */
+    vout_snapshot_t *p_snapshot;    /**< snapshot writer, or NULL */
 
     /* Video output configuration */
     config_chain_t *p_cfg;
@@ -675,6 +687,10 @@ picture_t *     vout_RenderPicture  ( vout_thread_t *, picture_t *,
 
 /* DO NOT use vout_CountPictureAvailable unless your are in src/input/dec.c (no exception) */
 int vout_CountPictureAvailable( vout_thread_t * );
+int vout_WaitPictureAvailable( vout_thread_t *, int, mtime_t );
+
+/* DO NOT use vout_RecyclePicture unless you are in src/ (picture_lock held) */
+void vout_RecyclePicture( vout_thread_t *, picture_t * );
 
 VLC_EXPORT( int, vout_vaControlDefault, ( vout_thread_t *, int, va_list ) );
 VLC_EXPORT( void *, vout_RequestWindow, ( vout_thread_t *, int *, int *, unsigned int *, unsigned int * ) );
@@ -75,6 +75,8 @@
 
 #include <vlc_charset.h>
 
+#include "readahead.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -86,6 +88,16 @@ static void Close( vlc_object_t * );
     "Caching value for files. This " \
     "value should be set in milliseconds." )
 
+#define READAHEAD_TEXT N_("Read-ahead window (kB)")
+#define READAHEAD_LONGTEXT N_( \
+    "Amount of data read asynchronously ahead of the current position " \
+    "in regular files, so that reading does not wait for the disk. " \
+    "Set to 0 to disable asynchronous read-ahead." )
+#define READAHEAD_DEPTH_TEXT N_("Read-ahead queue depth")
+#define READAHEAD_DEPTH_LONGTEXT N_( \
+    "Number of read requests kept in flight. The read-ahead window is " \
+    "split into that many chunks." )
+
 vlc_module_begin();
     set_description( N_("File input") );
     set_shortname( N_("File") );
@@ -93,6 +105,13 @@ vlc_module_begin();
     set_subcategory( SUBCAT_INPUT_ACCESS );
     add_integer( "file-caching", DEFAULT_PTS_DELAY / 1000, NULL, CACHING_TEXT, CACHING_LONGTEXT, true );
     add_obsolete_string( "file-cat" );
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+    add_integer( "file-readahead", 1024, NULL, READAHEAD_TEXT,
+                 READAHEAD_LONGTEXT, true );
+    add_integer_with_range( "file-readahead-depth", 4, 1, 32, NULL,
+                            READAHEAD_DEPTH_TEXT, READAHEAD_DEPTH_LONGTEXT,
+                            true );
+#endif
     set_capability( "access", 50 );
     add_shortcut( "file" );
     add_shortcut( "stream" );
@@ -114,6 +133,7 @@ struct access_sys_t
     unsigned int i_nb_reads;
 
     int fd;
+    readahead_t *p_readahead;
 
     /* */
     bool b_seekable;
@@ -136,6 +156,7 @@ static int Open( vlc_object_t *p_this )
     STANDARD_READ_ACCESS_INIT;
     p_sys->i_nb_reads = 0;
     int fd = p_sys->fd = -1;
+    p_sys->p_readahead = NULL;
 
     if (!strcasecmp (p_access->psz_access, "stream"))
     {
@@ -191,6 +212,30 @@ static int Open( vlc_object_t *p_this )
 # warning File size not known!
 #endif
 
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+    /* Only regular files can be read at arbitrary offsets */
+    int i_window = var_CreateGetInteger (p_access, "file-readahead");
+    if (p_sys->b_seekable && i_window > 0)
+    {
+        unsigned i_depth = var_CreateGetInteger (p_access,
+                                                 "file-readahead-depth");
+        size_t i_chunk;
+
+        if (i_depth < 1)
+            i_depth = 1;
+        /* Whole pages, which is also what the kernel reads anyway */
+        i_chunk = ((size_t)i_window * 1024 / i_depth + 4095) & ~4095;
+        p_sys->p_readahead = readahead_New (VLC_OBJECT(p_access), fd, 0,
+                                            i_depth, i_chunk, true);
+        if (p_sys->p_readahead != NULL)
+            msg_Dbg (p_access, "read-ahead of %u x %zu bytes using %s",
+                     i_depth, i_chunk,
+                     readahead_GetBackend (p_sys->p_readahead));
+        else
+            msg_Warn (p_access, "cannot start asynchronous read-ahead");
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -202,6 +247,18 @@ static void Close (vlc_object_t * p_this)
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+    if (p_sys->p_readahead != NULL)
+    {
+        readahead_stats_t stats;
+
+        readahead_GetStats (p_sys->p_readahead, &stats);
+        msg_Dbg (p_access, "read-ahead: %"PRIu64" bytes, %u reads, "
+                 "%u stalls, %u resets", stats.i_bytes, stats.i_reads,
+                 stats.i_stalls, stats.i_resets);
+        readahead_Delete (p_sys->p_readahead);
+    }
+#endif
     close (p_sys->fd);
     free (p_sys);
 }
@@ -232,7 +289,12 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
     }
 #endif /* WIN32 || UNDER_CE */
 
-    i_ret = read (fd, p_buffer, i_len);
+#if !defined(WIN32) && !defined(UNDER_CE)
+    if (p_sys->p_readahead != NULL)
+        i_ret = readahead_Read (p_sys->p_readahead, p_buffer, i_len);
+    else
+#endif
+        i_ret = read (fd, p_buffer, i_len);
     if( i_ret < 0 )
     {
         switch (errno)
@@ -281,7 +343,12 @@ static int Seek (access_t *p_access, int64_t i_pos)
     p_access->info.i_pos = i_pos;
     p_access->info.b_eof = false;
 
-    lseek (p_access->p_sys->fd, i_pos, SEEK_SET);
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+    if (p_access->p_sys->p_readahead != NULL)
+        readahead_Seek (p_access->p_sys->p_readahead, i_pos);
+    else
+#endif
+        lseek (p_access->p_sys->fd, i_pos, SEEK_SET);
     return VLC_SUCCESS;
 }
 
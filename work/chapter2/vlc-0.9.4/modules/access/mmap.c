@@ -42,6 +42,10 @@
 #define FILE_MMAP_TEXT N_("Use file memory mapping")
 #define FILE_MMAP_LONGTEXT N_( \
     "Try to use memory mapping to read files and block devices." )
+#define FILE_MMAP_WINDOW_TEXT N_("Memory mapping window (MB)")
+#define FILE_MMAP_WINDOW_LONGTEXT N_( \
+    "Size of the file windows that are mapped at once and shared by the " \
+    "data blocks. 0 maps every block separately." )
 
 #ifndef NDEBUG
 /*# define MMAP_DEBUG 1*/
@@ -61,20 +65,50 @@ vlc_module_begin();
 
     add_bool ("file-mmap", true, NULL,
               FILE_MMAP_TEXT, FILE_MMAP_LONGTEXT, true);
+    add_integer ("file-mmap-window", 64, NULL,
+                 FILE_MMAP_WINDOW_TEXT, FILE_MMAP_WINDOW_LONGTEXT, true);
 vlc_module_end();
 
 static block_t *Block (access_t *);
 static int Seek (access_t *, int64_t);
 static int Control (access_t *, int, va_list);
 
+typedef struct mmap_window_t mmap_window_t;
+static void WindowRelease (mmap_window_t *);
+
+/* A mapped window of the file, shared by all blocks taken from it */
+struct mmap_window_t
+{
+    vlc_mutex_t lock;
+    unsigned    refs;
+    void       *addr;
+    size_t      length;
+    int64_t     offset;
+};
+
+typedef struct
+{
+    block_t        self;
+    mmap_window_t *window;
+} mmap_block_t;
+
 struct access_sys_t
 {
     size_t page_size;
     size_t mtu;
     int    fd;
+
+    size_t         window_size; /* 0 if each block has its own mapping */
+    mmap_window_t *window;
+    int64_t        willneed;    /* end of the range already advised */
+    mtime_t        last_stat;
 };
 
 #define MMAP_SIZE (1 << 20)
+/* How far ahead of the read position pages are requested */
+#define MMAP_READAHEAD (4 << 20)
+/* How often the file size is checked before the end of file is reached */
+#define MMAP_STAT_INTERVAL (INT64_C(1000000))
 
 static int Open (vlc_object_t *p_this)
 {
@@ -141,6 +175,11 @@ static int Open (vlc_object_t *p_this)
     if (p_sys->mtu < p_sys->page_size)
         p_sys->mtu = p_sys->page_size;
     p_sys->fd = fd;
+    p_sys->window_size =
+        (size_t)var_CreateGetInteger (p_this, "file-mmap-window") << 20;
+    p_sys->window = NULL;
+    p_sys->willneed = 0;
+    p_sys->last_stat = mdate ();
 
     p_access->info.i_size = st.st_size;
 #ifdef HAVE_POSIX_FADVISE    
@@ -162,22 +201,161 @@ static void Close (vlc_object_t * p_this)
     access_t *p_access = (access_t *)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    if (p_sys->window != NULL)
+        WindowRelease (p_sys->window);
     close (p_sys->fd); /* don't care about error when only reading */
     free (p_sys);
 }
 
+static void WindowRelease (mmap_window_t *window)
+{
+    unsigned refs;
+
+    vlc_mutex_lock (&window->lock);
+    refs = --window->refs;
+    vlc_mutex_unlock (&window->lock);
+
+    if (refs > 0)
+        return;
+
+    munmap (window->addr, window->length);
+    vlc_mutex_destroy (&window->lock);
+    free (window);
+}
+
+static void WindowBlockRelease (block_t *block)
+{
+    mmap_block_t *b = (mmap_block_t *)block;
+
+    WindowRelease (b->window);
+    free (b);
+}
+
+/* Maps a new window starting at the page containing offset */
+static mmap_window_t *WindowMap (access_t *p_access, int64_t offset)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    const uintptr_t page_mask = p_sys->page_size - 1;
+    mmap_window_t *window = malloc (sizeof (*window));
+
+    if (window == NULL)
+        return NULL;
+
+    window->offset = offset & ~(int64_t)page_mask;
+    window->length = p_sys->window_size;
+    if (window->offset + (int64_t)window->length > p_access->info.i_size)
+        window->length = p_access->info.i_size - window->offset;
+
+    /* See Block() about PROT_WRITE and MAP_PRIVATE. Blocks taken from one
+     * window never overlap, as Seek() drops the window when going back,
+     * so modifying one does not affect the others. */
+    window->addr = mmap (NULL, window->length, PROT_READ|PROT_WRITE,
+                         MAP_PRIVATE, p_sys->fd, window->offset);
+    if (window->addr == MAP_FAILED)
+    {
+        free (window);
+        return NULL;
+    }
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise (window->addr, window->length, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    vlc_mutex_init (&window->lock);
+    window->refs = 1; /* the access' own reference */
+
+#ifdef MMAP_DEBUG
+    msg_Dbg (p_access, "mapped 0x%lx bytes window at %p from offset 0x%llx",
+             (unsigned long)window->length, window->addr,
+             (unsigned long long)window->offset);
+#endif
+    return window;
+}
+
+/* Hands out a block pointing into the current window */
+static block_t *WindowBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    mmap_window_t *window = p_sys->window;
+    int64_t pos = p_access->info.i_pos;
+
+    if (window == NULL || pos < window->offset
+     || pos >= window->offset + (int64_t)window->length)
+    {
+        /* Pending blocks keep the old window mapped until released */
+        if (window != NULL)
+            WindowRelease (window);
+
+        window = p_sys->window = WindowMap (p_access, pos);
+        if (window == NULL)
+        {
+            msg_Err (p_access, "memory mapping failed (%m)");
+            intf_UserFatal (p_access, false, _("File reading failed"),
+                            _("VLC could not read the file."));
+            p_access->info.b_eof = true;
+            return NULL;
+        }
+        p_sys->willneed = pos;
+    }
+
+    size_t inner_offset = pos - window->offset;
+    size_t length = window->length - inner_offset;
+    if (length > p_sys->mtu)
+        length = p_sys->mtu;
+
+    mmap_block_t *b = malloc (sizeof (*b));
+    if (b == NULL)
+        return NULL;
+
+    block_Init (&b->self, (uint8_t *)window->addr + inner_offset, length);
+    b->self.pf_release = WindowBlockRelease;
+    b->window = window;
+
+    vlc_mutex_lock (&window->lock);
+    window->refs++;
+    vlc_mutex_unlock (&window->lock);
+
+#ifdef HAVE_POSIX_MADVISE
+    /* Get the next pages read from the disk before we need them */
+    int64_t ahead = pos + length + MMAP_READAHEAD;
+    if (ahead > window->offset + (int64_t)window->length)
+        ahead = window->offset + window->length;
+    if (ahead > p_sys->willneed)
+    {
+        const uintptr_t page_mask = p_sys->page_size - 1;
+        int64_t from = (p_sys->willneed > pos + (int64_t)length)
+                     ? p_sys->willneed : pos + (int64_t)length;
+
+        from &= ~(int64_t)page_mask;
+        if (ahead > from)
+            posix_madvise ((uint8_t *)window->addr + (from - window->offset),
+                           ahead - from, POSIX_MADV_WILLNEED);
+        p_sys->willneed = ahead;
+    }
+#endif
+
+    p_access->info.i_pos = pos + length;
+    return &b->self;
+}
+
 static block_t *Block (access_t *p_access)
 {
     access_sys_t *p_sys = p_access->p_sys;
 
-    /* Check if file size changed... */
+    /* Check if file size changed... Not for every block, unless we are at
+     * the end of the file and waiting for it to grow. */
+    mtime_t now = mdate ();
     struct stat st;
 
-    if ((fstat (p_sys->fd, &st) == 0)
-     && (st.st_size != p_access->info.i_size))
+    if (((uint64_t)p_access->info.i_pos >= (uint64_t)p_access->info.i_size
+      || now - p_sys->last_stat >= MMAP_STAT_INTERVAL)
+     && (fstat (p_sys->fd, &st) == 0))
     {
-        p_access->info.i_size = st.st_size;
-        p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        p_sys->last_stat = now;
+        if (st.st_size != p_access->info.i_size)
+        {
+            p_access->info.i_size = st.st_size;
+            p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        }
     }
 
     if ((uint64_t)p_access->info.i_pos >= (uint64_t)p_access->info.i_size)
@@ -188,6 +366,9 @@ static block_t *Block (access_t *p_access)
         return NULL;
     }
 
+    if (p_sys->window_size > 0)
+        return WindowBlock (p_access);
+
 #ifdef MMAP_DEBUG
     int64_t dbgpos = lseek (p_sys->fd, 0, SEEK_CUR);
     if (dbgpos != p_access->info.i_pos)
@@ -260,10 +441,20 @@ fatal:
 
 static int Seek (access_t *p_access, int64_t i_pos)
 {
+    access_sys_t *p_sys = p_access->p_sys;
+
 #ifdef MMAP_DEBUG
-    lseek (p_access->p_sys->fd, i_pos, SEEK_SET);
+    lseek (p_sys->fd, i_pos, SEEK_SET);
 #endif
 
+    /* Blocks already handed out may have been modified in place: map
+     * the file again rather than hand out the same bytes twice. */
+    if (p_sys->window != NULL && i_pos < p_access->info.i_pos)
+    {
+        WindowRelease (p_sys->window);
+        p_sys->window = NULL;
+    }
+
     p_access->info.i_pos = i_pos;
     p_access->info.b_eof = false;
     return VLC_SUCCESS;
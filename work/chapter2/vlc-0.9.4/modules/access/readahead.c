@@ -0,0 +1,695 @@
+/*****************************************************************************
+ * readahead.c: asynchronous read-ahead for file descriptors
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#if !defined( WIN32 ) && !defined( UNDER_CE )
+
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_TYPES_H
+#   include <sys/types.h>
+#endif
+#include <sys/uio.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#   include <linux/io_uring.h>
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#   if defined( __NR_io_uring_setup ) && defined( __NR_io_uring_enter )
+#       define HAVE_URING 1
+#   endif
+#endif
+
+#include "readahead.h"
+
+enum
+{
+    SLOT_IDLE,      /* not in use */
+    SLOT_QUEUED,    /* waiting for a thread of the pool */
+    SLOT_BUSY,      /* being read by the kernel */
+    SLOT_DONE,      /* i_result is valid */
+};
+
+typedef struct
+{
+    uint8_t *p_buffer;
+    int64_t  i_offset;
+    ssize_t  i_result;  /* bytes read, or -errno */
+    size_t   i_done;    /* bytes already returned to the caller */
+    int      i_state;
+    struct iovec iov;
+} ra_slot_t;
+
+typedef struct
+{
+    VLC_COMMON_MEMBERS
+
+    readahead_t *p_ra;
+} ra_worker_t;
+
+#ifdef HAVE_URING
+typedef struct
+{
+    int       fd;
+    void     *p_sq, *p_cq;
+    size_t    i_sq, i_cq;
+    struct io_uring_sqe *p_sqes;
+    size_t    i_sqes;
+
+    unsigned *pi_sq_tail, *pi_sq_mask, *pi_sq_array;
+    unsigned *pi_cq_head, *pi_cq_tail, *pi_cq_mask;
+    struct io_uring_cqe *p_cqes;
+} ra_uring_t;
+#endif
+
+struct readahead_t
+{
+    vlc_object_t *p_parent;
+    int       fd;
+
+    unsigned  i_depth;
+    size_t    i_chunk;
+    uint8_t  *p_buffers;
+    ra_slot_t *p_slots;
+    unsigned  i_head;   /* slot holding the data at i_pos */
+    int64_t   i_pos;    /* offset of the next byte returned */
+    bool      b_reset;  /* the window must be refilled from i_pos */
+
+    readahead_stats_t stats;
+
+    /* Thread pool back-end */
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;     /* a slot was queued, or the pool is stopping */
+    vlc_cond_t    done;     /* a slot was completed */
+    bool          b_stop;
+    unsigned      i_workers;
+    ra_worker_t **pp_workers;
+
+#ifdef HAVE_URING
+    ra_uring_t   *p_uring;
+#endif
+};
+
+/*****************************************************************************
+ * Thread pool back-end
+ *****************************************************************************/
+static ssize_t ReadAt( int fd, uint8_t *p_buffer, size_t i_len,
+                       int64_t i_offset )
+{
+    size_t i_done = 0;
+
+    /* Regular files only return less than asked at the end, but a short
+     * read would drop the whole window, so fill the chunk anyway. */
+    while( i_done < i_len )
+    {
+#ifdef HAVE_PREADV
+        struct iovec iov = { p_buffer + i_done, i_len - i_done };
+        ssize_t i_ret = preadv( fd, &iov, 1, i_offset + i_done );
+#else
+        ssize_t i_ret = pread( fd, p_buffer + i_done, i_len - i_done,
+                               i_offset + i_done );
+#endif
+        if( i_ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            if( i_done > 0 )
+                break;
+            return -errno;
+        }
+        if( i_ret == 0 )
+            break;
+        i_done += i_ret;
+    }
+    return i_done;
+}
+
+static ra_slot_t *NextQueued( readahead_t *p_ra )
+{
+    ra_slot_t *p_next = NULL;
+
+    /* Serve the lowest offset first, that is the one needed soonest */
+    for( unsigned i = 0; i < p_ra->i_depth; i++ )
+    {
+        ra_slot_t *p_slot = &p_ra->p_slots[i];
+
+        if( p_slot->i_state == SLOT_QUEUED
+         && ( p_next == NULL || p_slot->i_offset < p_next->i_offset ) )
+            p_next = p_slot;
+    }
+    return p_next;
+}
+
+static void *Worker( vlc_object_t *p_this )
+{
+    readahead_t *p_ra = ((ra_worker_t *)p_this)->p_ra;
+
+    vlc_mutex_lock( &p_ra->lock );
+    for( ;; )
+    {
+        ra_slot_t *p_slot;
+
+        while( !p_ra->b_stop && (p_slot = NextQueued( p_ra )) == NULL )
+            vlc_cond_wait( &p_ra->wait, &p_ra->lock );
+        if( p_ra->b_stop )
+            break;
+
+        p_slot->i_state = SLOT_BUSY;
+        vlc_mutex_unlock( &p_ra->lock );
+
+        ssize_t i_ret = ReadAt( p_ra->fd, p_slot->p_buffer, p_ra->i_chunk,
+                                p_slot->i_offset );
+
+        vlc_mutex_lock( &p_ra->lock );
+        p_slot->i_result = i_ret;
+        p_slot->i_state = SLOT_DONE;
+        vlc_cond_signal( &p_ra->done );
+    }
+    vlc_mutex_unlock( &p_ra->lock );
+    return NULL;
+}
+
+static void PoolStop( readahead_t *p_ra )
+{
+    vlc_mutex_lock( &p_ra->lock );
+    p_ra->b_stop = true;
+    /* There is no broadcast: wake the threads one by one. A thread that is
+     * not waiting sees b_stop before it waits again. */
+    for( unsigned i = 0; i < p_ra->i_workers; i++ )
+        vlc_cond_signal( &p_ra->wait );
+    vlc_mutex_unlock( &p_ra->lock );
+
+    for( unsigned i = 0; i < p_ra->i_workers; i++ )
+    {
+        vlc_thread_join( p_ra->pp_workers[i] );
+        vlc_object_release( p_ra->pp_workers[i] );
+    }
+    free( p_ra->pp_workers );
+    p_ra->pp_workers = NULL;
+    p_ra->i_workers = 0;
+}
+
+static int PoolStart( readahead_t *p_ra )
+{
+    p_ra->pp_workers = calloc( p_ra->i_depth, sizeof( ra_worker_t * ) );
+    if( p_ra->pp_workers == NULL )
+        return VLC_ENOMEM;
+
+    /* One thread per slot, so that the whole window can be in flight */
+    for( unsigned i = 0; i < p_ra->i_depth; i++ )
+    {
+        ra_worker_t *p_worker = vlc_object_create( p_ra->p_parent,
+                                                   sizeof( ra_worker_t ) );
+        if( p_worker == NULL )
+            break;
+        p_worker->p_ra = p_ra;
+        if( vlc_thread_create( p_worker, "file read-ahead", Worker,
+                               VLC_THREAD_PRIORITY_INPUT, false ) )
+        {
+            vlc_object_release( p_worker );
+            break;
+        }
+        p_ra->pp_workers[p_ra->i_workers++] = p_worker;
+    }
+
+    if( p_ra->i_workers == 0 )
+    {
+        PoolStop( p_ra );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * io_uring back-end
+ *****************************************************************************/
+#ifdef HAVE_URING
+static int UringEnter( int fd, unsigned i_submit, unsigned i_wait,
+                       unsigned i_flags )
+{
+    return syscall( __NR_io_uring_enter, fd, i_submit, i_wait, i_flags,
+                    NULL, 0 );
+}
+
+static void UringDelete( ra_uring_t *p_uring )
+{
+    if( p_uring->p_sqes != MAP_FAILED )
+        munmap( p_uring->p_sqes, p_uring->i_sqes );
+    if( p_uring->p_cq != MAP_FAILED && p_uring->p_cq != p_uring->p_sq )
+        munmap( p_uring->p_cq, p_uring->i_cq );
+    if( p_uring->p_sq != MAP_FAILED )
+        munmap( p_uring->p_sq, p_uring->i_sq );
+    close( p_uring->fd );
+    free( p_uring );
+}
+
+static ra_uring_t *UringNew( unsigned i_entries )
+{
+    struct io_uring_params params;
+    ra_uring_t *p_uring;
+    uint8_t *p_sq, *p_cq;
+
+    memset( &params, 0, sizeof( params ) );
+    int fd = syscall( __NR_io_uring_setup, i_entries, &params );
+    if( fd == -1 )
+        return NULL;
+
+    p_uring = malloc( sizeof( *p_uring ) );
+    if( p_uring == NULL )
+    {
+        close( fd );
+        return NULL;
+    }
+    p_uring->fd = fd;
+    p_uring->i_sq = params.sq_off.array
+                  + params.sq_entries * sizeof( unsigned );
+    p_uring->i_cq = params.cq_off.cqes
+                  + params.cq_entries * sizeof( struct io_uring_cqe );
+    p_uring->i_sqes = params.sq_entries * sizeof( struct io_uring_sqe );
+    p_uring->p_cq = p_uring->p_sqes = MAP_FAILED;
+
+    p_uring->p_sq = mmap( NULL, __MAX( p_uring->i_sq, p_uring->i_cq ),
+                          PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                          fd, IORING_OFF_SQ_RING );
+    if( p_uring->p_sq == MAP_FAILED )
+        goto error;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        p_uring->i_sq = __MAX( p_uring->i_sq, p_uring->i_cq );
+        p_uring->p_cq = p_uring->p_sq;
+    }
+    else
+#endif
+    {
+        /* Only the submission ring size was mapped */
+        munmap( p_uring->p_sq, __MAX( p_uring->i_sq, p_uring->i_cq ) );
+        p_uring->p_sq = mmap( NULL, p_uring->i_sq, PROT_READ|PROT_WRITE,
+                              MAP_SHARED|MAP_POPULATE, fd,
+                              IORING_OFF_SQ_RING );
+        if( p_uring->p_sq == MAP_FAILED )
+            goto error;
+        p_uring->p_cq = mmap( NULL, p_uring->i_cq, PROT_READ|PROT_WRITE,
+                              MAP_SHARED|MAP_POPULATE, fd,
+                              IORING_OFF_CQ_RING );
+        if( p_uring->p_cq == MAP_FAILED )
+            goto error;
+    }
+    p_uring->p_sqes = mmap( NULL, p_uring->i_sqes, PROT_READ|PROT_WRITE,
+                            MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES );
+    if( p_uring->p_sqes == MAP_FAILED )
+        goto error;
+
+    p_sq = p_uring->p_sq;
+    p_cq = p_uring->p_cq;
+    p_uring->pi_sq_tail  = (unsigned *)(p_sq + params.sq_off.tail);
+    p_uring->pi_sq_mask  = (unsigned *)(p_sq + params.sq_off.ring_mask);
+    p_uring->pi_sq_array = (unsigned *)(p_sq + params.sq_off.array);
+    p_uring->pi_cq_head  = (unsigned *)(p_cq + params.cq_off.head);
+    p_uring->pi_cq_tail  = (unsigned *)(p_cq + params.cq_off.tail);
+    p_uring->pi_cq_mask  = (unsigned *)(p_cq + params.cq_off.ring_mask);
+    p_uring->p_cqes = (struct io_uring_cqe *)(p_cq + params.cq_off.cqes);
+    return p_uring;
+
+error:
+    UringDelete( p_uring );
+    return NULL;
+}
+
+static void UringSubmit( readahead_t *p_ra, ra_slot_t *p_slot )
+{
+    ra_uring_t *p_uring = p_ra->p_uring;
+    unsigned i_tail = *p_uring->pi_sq_tail;
+    unsigned i_index = i_tail & *p_uring->pi_sq_mask;
+    struct io_uring_sqe *p_sqe = &p_uring->p_sqes[i_index];
+
+    p_slot->iov.iov_base = p_slot->p_buffer;
+    p_slot->iov.iov_len = p_ra->i_chunk;
+
+    memset( p_sqe, 0, sizeof( *p_sqe ) );
+    p_sqe->opcode = IORING_OP_READV;
+    p_sqe->fd = p_ra->fd;
+    p_sqe->off = p_slot->i_offset;
+    p_sqe->addr = (uintptr_t)&p_slot->iov;
+    p_sqe->len = 1;
+    p_sqe->user_data = p_slot - p_ra->p_slots;
+    p_uring->pi_sq_array[i_index] = i_index;
+
+    /* The entry must be visible before the new tail */
+    __sync_synchronize();
+    *p_uring->pi_sq_tail = i_tail + 1;
+    __sync_synchronize();
+
+    p_slot->i_state = SLOT_BUSY;
+    while( UringEnter( p_uring->fd, 1, 0, 0 ) < 0 )
+    {
+        if( errno == EINTR )
+            continue;
+        /* The entry was not consumed: take it back */
+        *p_uring->pi_sq_tail = i_tail;
+        p_slot->i_result = -errno;
+        p_slot->i_state = SLOT_DONE;
+        break;
+    }
+}
+
+static int UringReap( readahead_t *p_ra, bool b_wait )
+{
+    ra_uring_t *p_uring = p_ra->p_uring;
+    unsigned i_head = *p_uring->pi_cq_head;
+    unsigned i_mask = *p_uring->pi_cq_mask;
+
+    if( b_wait )
+    {
+        while( UringEnter( p_uring->fd, 0, 1, IORING_ENTER_GETEVENTS ) < 0 )
+            if( errno != EINTR )
+                return -errno;
+    }
+
+    __sync_synchronize();
+    while( i_head != *(volatile unsigned *)p_uring->pi_cq_tail )
+    {
+        const struct io_uring_cqe *p_cqe = &p_uring->p_cqes[i_head & i_mask];
+        ra_slot_t *p_slot = &p_ra->p_slots[p_cqe->user_data];
+
+        __sync_synchronize();
+        p_slot->i_result = p_cqe->res;
+        p_slot->i_state = SLOT_DONE;
+        i_head++;
+    }
+    __sync_synchronize();
+    *p_uring->pi_cq_head = i_head;
+    return 0;
+}
+#endif
+
+/*****************************************************************************
+ * Slot helpers, common to both back-ends
+ *****************************************************************************/
+static void SlotSubmit( readahead_t *p_ra, ra_slot_t *p_slot,
+                        int64_t i_offset )
+{
+    p_slot->i_offset = i_offset;
+    p_slot->i_done = 0;
+    p_ra->stats.i_reads++;
+
+#ifdef HAVE_URING
+    if( p_ra->p_uring != NULL )
+    {
+        UringSubmit( p_ra, p_slot );
+        return;
+    }
+#endif
+    vlc_mutex_lock( &p_ra->lock );
+    p_slot->i_state = SLOT_QUEUED;
+    vlc_cond_signal( &p_ra->wait );
+    vlc_mutex_unlock( &p_ra->lock );
+}
+
+static bool SlotIsDone( readahead_t *p_ra, ra_slot_t *p_slot )
+{
+    bool b_done;
+
+#ifdef HAVE_URING
+    if( p_ra->p_uring != NULL )
+    {
+        if( p_slot->i_state != SLOT_DONE )
+            UringReap( p_ra, false );
+        return p_slot->i_state == SLOT_DONE;
+    }
+#endif
+    vlc_mutex_lock( &p_ra->lock );
+    b_done = p_slot->i_state == SLOT_DONE;
+    vlc_mutex_unlock( &p_ra->lock );
+    return b_done;
+}
+
+static void SlotWait( readahead_t *p_ra, ra_slot_t *p_slot )
+{
+    assert( p_slot->i_state != SLOT_IDLE );
+
+#ifdef HAVE_URING
+    if( p_ra->p_uring != NULL )
+    {
+        while( p_slot->i_state != SLOT_DONE )
+        {
+            int i_ret = UringReap( p_ra, true );
+            if( i_ret < 0 )
+            {
+                p_slot->i_result = i_ret;
+                p_slot->i_state = SLOT_DONE;
+            }
+        }
+        return;
+    }
+#endif
+    vlc_mutex_lock( &p_ra->lock );
+    while( p_slot->i_state != SLOT_DONE )
+        vlc_cond_wait( &p_ra->done, &p_ra->lock );
+    vlc_mutex_unlock( &p_ra->lock );
+}
+
+/* Waits for every read in flight, as their buffers are about to be reused */
+static void Drain( readahead_t *p_ra )
+{
+    for( unsigned i = 0; i < p_ra->i_depth; i++ )
+    {
+        ra_slot_t *p_slot = &p_ra->p_slots[i];
+
+        if( p_slot->i_state != SLOT_IDLE )
+            SlotWait( p_ra, p_slot );
+        p_slot->i_state = SLOT_IDLE;
+    }
+}
+
+static void Refill( readahead_t *p_ra )
+{
+    Drain( p_ra );
+    p_ra->i_head = 0;
+    for( unsigned i = 0; i < p_ra->i_depth; i++ )
+        SlotSubmit( p_ra, &p_ra->p_slots[i],
+                    p_ra->i_pos + (int64_t)i * p_ra->i_chunk );
+    p_ra->b_reset = false;
+}
+
+/* Re-queues the fully consumed head slot at the end of the window */
+static void Recycle( readahead_t *p_ra )
+{
+    ra_slot_t *p_slot = &p_ra->p_slots[p_ra->i_head];
+
+    SlotSubmit( p_ra, p_slot, p_slot->i_offset
+                        + (int64_t)p_ra->i_depth * p_ra->i_chunk );
+    p_ra->i_head = (p_ra->i_head + 1) % p_ra->i_depth;
+}
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+readahead_t *readahead_New( vlc_object_t *p_parent, int fd, int64_t i_pos,
+                            unsigned i_depth, size_t i_chunk, bool b_uring )
+{
+    readahead_t *p_ra;
+
+    assert( i_depth > 0 && i_chunk > 0 );
+
+    p_ra = calloc( 1, sizeof( *p_ra ) );
+    if( p_ra == NULL )
+        return NULL;
+    p_ra->p_parent = p_parent;
+    p_ra->fd = fd;
+    p_ra->i_depth = i_depth;
+    p_ra->i_chunk = i_chunk;
+    p_ra->i_pos = i_pos;
+    p_ra->b_reset = true;
+
+    p_ra->p_slots = calloc( i_depth, sizeof( ra_slot_t ) );
+    p_ra->p_buffers = malloc( i_depth * i_chunk );
+    if( p_ra->p_slots == NULL || p_ra->p_buffers == NULL )
+    {
+        free( p_ra->p_buffers );
+        free( p_ra->p_slots );
+        free( p_ra );
+        return NULL;
+    }
+    for( unsigned i = 0; i < i_depth; i++ )
+    {
+        p_ra->p_slots[i].p_buffer = p_ra->p_buffers + i * i_chunk;
+        p_ra->p_slots[i].i_state = SLOT_IDLE;
+    }
+
+    vlc_mutex_init( &p_ra->lock );
+    vlc_cond_init( NULL, &p_ra->wait );
+    vlc_cond_init( NULL, &p_ra->done );
+
+#ifdef HAVE_URING
+    if( b_uring )
+    {
+        /* Older kernels, or seccomp filters, fall back to the threads */
+        p_ra->p_uring = UringNew( i_depth );
+        if( p_ra->p_uring != NULL )
+            return p_ra;
+    }
+#else
+    VLC_UNUSED( b_uring );
+#endif
+    if( PoolStart( p_ra ) )
+    {
+        readahead_Delete( p_ra );
+        return NULL;
+    }
+    return p_ra;
+}
+
+void readahead_Delete( readahead_t *p_ra )
+{
+    Drain( p_ra );
+#ifdef HAVE_URING
+    if( p_ra->p_uring != NULL )
+        UringDelete( p_ra->p_uring );
+#endif
+    if( p_ra->pp_workers != NULL )
+        PoolStop( p_ra );
+
+    vlc_cond_destroy( &p_ra->done );
+    vlc_cond_destroy( &p_ra->wait );
+    vlc_mutex_destroy( &p_ra->lock );
+    free( p_ra->p_buffers );
+    free( p_ra->p_slots );
+    free( p_ra );
+}
+
+/**
+ * Reads up to i_len bytes at the current position. This only waits if no
+ * data at all is ready, and otherwise returns what has been read ahead.
+ * \return the number of bytes read, 0 at the end of the file, or -1 with
+ * errno set on error.
+ */
+ssize_t readahead_Read( readahead_t *p_ra, uint8_t *p_buffer, size_t i_len )
+{
+    size_t i_total = 0;
+
+    if( p_ra->b_reset )
+        Refill( p_ra );
+
+    while( i_total < i_len )
+    {
+        ra_slot_t *p_slot = &p_ra->p_slots[p_ra->i_head];
+
+        if( !SlotIsDone( p_ra, p_slot ) )
+        {
+            if( i_total > 0 )
+                break;
+            p_ra->stats.i_stalls++;
+            SlotWait( p_ra, p_slot );
+        }
+
+        if( p_slot->i_result < 0 )
+        {
+            if( i_total > 0 )
+                break; /* report the error on the next call */
+            errno = -p_slot->i_result;
+            p_ra->b_reset = true;
+            return -1;
+        }
+
+        size_t i_copy = p_slot->i_result - p_slot->i_done;
+        if( i_copy > i_len - i_total )
+            i_copy = i_len - i_total;
+        memcpy( p_buffer + i_total, p_slot->p_buffer + p_slot->i_done,
+                i_copy );
+        p_slot->i_done += i_copy;
+        p_ra->i_pos += i_copy;
+        i_total += i_copy;
+
+        if( p_slot->i_done < (size_t)p_slot->i_result )
+            break;
+        if( (size_t)p_slot->i_result < p_ra->i_chunk )
+        {
+            /* End of file, for now: the reads queued behind are useless,
+             * and the next call will find out whether the file grew. */
+            p_ra->b_reset = true;
+            break;
+        }
+        Recycle( p_ra );
+    }
+
+    p_ra->stats.i_bytes += i_total;
+    return i_total;
+}
+
+void readahead_Seek( readahead_t *p_ra, int64_t i_pos )
+{
+    /* Inside the window, the data is wanted anyway: wait for it rather
+     * than throwing it away */
+    while( !p_ra->b_reset )
+    {
+        ra_slot_t *p_slot = &p_ra->p_slots[p_ra->i_head];
+
+        if( i_pos < p_slot->i_offset
+         || i_pos >= p_slot->i_offset + (int64_t)(p_ra->i_depth * p_ra->i_chunk) )
+            break;
+
+        SlotWait( p_ra, p_slot );
+        if( p_slot->i_result < 0 )
+            break;
+        if( i_pos < p_slot->i_offset + p_slot->i_result )
+        {
+            p_slot->i_done = i_pos - p_slot->i_offset;
+            p_ra->i_pos = i_pos;
+            return;
+        }
+        if( (size_t)p_slot->i_result < p_ra->i_chunk )
+            break;
+        Recycle( p_ra );
+    }
+
+    p_ra->i_pos = i_pos;
+    p_ra->b_reset = true;
+    p_ra->stats.i_resets++;
+}
+
+const char *readahead_GetBackend( const readahead_t *p_ra )
+{
+#ifdef HAVE_URING
+    if( p_ra->p_uring != NULL )
+        return "io_uring";
+#else
+    VLC_UNUSED( p_ra );
+#endif
+#ifdef HAVE_PREADV
+    return "preadv threads";
+#else
+    return "pread threads";
+#endif
+}
+
+void readahead_GetStats( const readahead_t *p_ra, readahead_stats_t *p_stats )
+{
+    *p_stats = p_ra->stats;
+}
+
+#endif /* !WIN32 && !UNDER_CE */
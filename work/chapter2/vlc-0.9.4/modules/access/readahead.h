@@ -0,0 +1,52 @@
+/*****************************************************************************
+ * readahead.h: asynchronous read-ahead for file descriptors
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _READAHEAD_H_
+#define _READAHEAD_H_ 1
+
+/*
+ * The read-ahead engine keeps i_depth reads of i_chunk bytes in flight at
+ * consecutive offsets after the current position of a regular file, and
+ * serves readahead_Read() from the completed ones. Reads are submitted
+ * through io_uring when the kernel supports it, and otherwise handed to a
+ * pool of threads doing positioned reads.
+ *
+ * The engine is not thread-safe: only one thread may use a given instance.
+ */
+typedef struct readahead_t readahead_t;
+
+typedef struct
+{
+    uint64_t i_bytes;   /* bytes returned by readahead_Read() */
+    unsigned i_reads;   /* reads submitted to the kernel */
+    unsigned i_stalls;  /* readahead_Read() calls that had to wait */
+    unsigned i_resets;  /* seeks or short reads that dropped the window */
+} readahead_stats_t;
+
+readahead_t *readahead_New( vlc_object_t *, int fd, int64_t i_pos,
+                            unsigned i_depth, size_t i_chunk, bool b_uring );
+void     readahead_Delete( readahead_t * );
+ssize_t  readahead_Read( readahead_t *, uint8_t *, size_t );
+void     readahead_Seek( readahead_t *, int64_t );
+const char *readahead_GetBackend( const readahead_t * );
+void     readahead_GetStats( const readahead_t *, readahead_stats_t * );
+
+#endif
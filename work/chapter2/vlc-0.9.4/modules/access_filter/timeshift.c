@@ -39,6 +39,7 @@
 #include <vlc_input.h>
 
 #include <unistd.h>
+#include <fcntl.h>
 
 #ifdef WIN32
 #  include <direct.h>                                        /* _wgetcwd  */
@@ -50,13 +51,15 @@
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
-#define GRANULARITY_TEXT N_("Timeshift granularity")
-/// \bug [String] typo
-#define GRANULARITY_LONGTEXT N_( "This is the size of the temporary files " \
-  "that will be used to store the timeshifted streams." )
+#define SIZE_TEXT N_("Timeshift size (MB)")
+#define SIZE_LONGTEXT N_( "Size of the temporary file used to store the " \
+  "timeshifted stream. Older data is overwritten when it is full." )
 #define DIR_TEXT N_("Timeshift directory")
 #define DIR_LONGTEXT N_( "Directory used to store the timeshift temporary " \
   "files." )
+#define DIRECT_TEXT N_("Bypass the page cache")
+#define DIRECT_LONGTEXT N_( "Read and write the timeshift file without " \
+  "going through the operating system cache, where supported." )
 #define FORCE_TEXT N_("Force use of the timeshift module")
 #define FORCE_LONGTEXT N_("Force use of the timeshift module even if the " \
   "access declares that it can control pace or pause." )
@@ -70,10 +73,13 @@ vlc_module_begin();
     add_shortcut( "timeshift" );
     set_callbacks( Open, Close );
 
-    add_integer( "timeshift-granularity", 50, NULL, GRANULARITY_TEXT,
-                 GRANULARITY_LONGTEXT, true );
+    add_obsolete_integer( "timeshift-granularity" );
+    add_integer( "timeshift-size", 1024, NULL, SIZE_TEXT, SIZE_LONGTEXT,
+                 true );
     add_directory( "timeshift-dir", 0, 0, DIR_TEXT, DIR_LONGTEXT, false );
         change_unsafe();
+    add_bool( "timeshift-direct", false, NULL, DIRECT_TEXT, DIRECT_LONGTEXT,
+              true );
     add_bool( "timeshift-force", false, NULL, FORCE_TEXT, FORCE_LONGTEXT,
               false );
 vlc_module_end();
@@ -86,39 +92,138 @@ static int      Seek( access_t *, int64_t );
 static block_t *Block  ( access_t *p_access );
 static int      Control( access_t *, int i_query, va_list args );
 static void*    Thread ( vlc_object_t *p_this );
-static int      WriteBlockToFile( access_t *p_access, block_t *p_block );
-static block_t *ReadBlockFromFile( access_t *p_access );
 static char    *GetTmpFilePath( access_t *p_access );
 
-#define TIMESHIFT_FIFO_MAX (10*1024*1024)
-#define TIMESHIFT_FIFO_MIN (TIMESHIFT_FIFO_MAX/4)
-#define TMP_FILE_MAX 256
+/* The stream is stored in a ring file written and read by units of
+ * TIMESHIFT_IO_SIZE bytes at aligned offsets */
+#define TIMESHIFT_IO_SIZE  (1024*1024)
+#define TIMESHIFT_IO_ALIGN 4096
+/* Distance in bytes between two entries of the index */
+#define TIMESHIFT_INDEX_STEP (64*1024)
+/* Maximum time Block() waits for live data */
+#define TIMESHIFT_WAIT (100000)
+
+#ifndef O_BINARY
+#   define O_BINARY 0
+#endif
 
-typedef struct ts_entry_t
+/*
+ * Offsets are counted from the start of the timeshifted stream. The data in
+ * [i_start, i_flushed) is in the ring file at (offset % i_ring_size), and the
+ * data in [i_flushed, i_end) is still in the write buffer.
+ */
+struct access_sys_t
 {
-    FILE *file;
-    struct ts_entry_t *p_next;
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+
+    /* Ring file */
+    int      fd;
+    char    *psz_filename;
+    int64_t  i_ring_size;
+    bool     b_error;       /* last write failed */
+#ifdef WIN32
+    vlc_mutex_t io_lock;    /* no positioned I/O */
+#endif
 
-} ts_entry_t;
+    /* Window, protected by lock */
+    int64_t  i_start;
+    int64_t  i_flushed;
+    int64_t  i_end;
+    bool     b_source_eof;
+
+    /* Write buffer, holding the data after i_flushed */
+    uint8_t *p_write;
+    void    *p_write_orig;
+
+    /* Last unit read from the file */
+    uint8_t *p_read;
+    void    *p_read_orig;
+    int64_t  i_read_base;   /* offset of p_read, -1 if none */
+
+    /* Reception date of each TIMESHIFT_INDEX_STEP bytes of the window */
+    mtime_t *p_index;
+    int      i_index;
+
+    /* Resume latency */
+    mtime_t  i_resume_date;
+    int      i_resume_count;
+    mtime_t  i_resume_total;
+    mtime_t  i_resume_max;
+};
 
-struct access_sys_t
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+static uint8_t *AlignedAlloc( void **pp_orig, size_t i_size )
 {
-    block_fifo_t *p_fifo;
+    uint8_t *p = *pp_orig = malloc( i_size + TIMESHIFT_IO_ALIGN - 1 );
 
-    unsigned  i_files;
-    unsigned  i_file_size;
-    unsigned  i_write_size;
+    if( p == NULL )
+        return NULL;
+    return (uint8_t *)( ((uintptr_t)p + TIMESHIFT_IO_ALIGN - 1) &
+                        ~(uintptr_t)(TIMESHIFT_IO_ALIGN - 1) );
+}
 
-    ts_entry_t *p_read_list;
-    ts_entry_t **pp_read_last;
-    ts_entry_t *p_write_list;
-    ts_entry_t **pp_write_last;
+/* Reads or writes one unit at i_offset of the ring file */
+static int RingIO( access_sys_t *p_sys, bool b_write, uint8_t *p_data,
+                   int64_t i_offset )
+{
+    size_t i_done = 0;
 
-    char *psz_filename_base;
-    char *psz_filename;
+    while( i_done < TIMESHIFT_IO_SIZE )
+    {
+        ssize_t i_ret;
+#ifndef WIN32
+        if( b_write )
+            i_ret = pwrite( p_sys->fd, p_data + i_done,
+                            TIMESHIFT_IO_SIZE - i_done, i_offset + i_done );
+        else
+            i_ret = pread( p_sys->fd, p_data + i_done,
+                           TIMESHIFT_IO_SIZE - i_done, i_offset + i_done );
+#else
+        vlc_mutex_lock( &p_sys->io_lock );
+        if( _lseeki64( p_sys->fd, i_offset + i_done, SEEK_SET ) == -1 )
+            i_ret = -1;
+        else if( b_write )
+            i_ret = write( p_sys->fd, p_data + i_done,
+                           TIMESHIFT_IO_SIZE - i_done );
+        else
+            i_ret = read( p_sys->fd, p_data + i_done,
+                          TIMESHIFT_IO_SIZE - i_done );
+        vlc_mutex_unlock( &p_sys->io_lock );
+#endif
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        i_done += i_ret;
+    }
+    return VLC_SUCCESS;
+}
 
-    int64_t i_data;
-};
+/* Returns the first offset of the window received at or after i_date,
+ * or -1 if the window is empty. Must be called with the lock held. */
+static int64_t IndexFind( access_sys_t *p_sys, mtime_t i_date )
+{
+    int64_t i_first = p_sys->i_start / TIMESHIFT_INDEX_STEP;
+    int64_t i_last = ( p_sys->i_end - 1 ) / TIMESHIFT_INDEX_STEP;
+
+    if( p_sys->i_end <= p_sys->i_start )
+        return -1;
+
+    /* Dates increase with offsets */
+    while( i_first < i_last )
+    {
+        int64_t i_mid = ( i_first + i_last ) / 2;
+
+        if( p_sys->p_index[i_mid % p_sys->i_index] < i_date )
+            i_first = i_mid + 1;
+        else
+            i_last = i_mid;
+    }
+    return __MAX( i_first * TIMESHIFT_INDEX_STEP, p_sys->i_start );
+}
 
 /*****************************************************************************
  * Open:
@@ -129,6 +234,7 @@ static int Open( vlc_object_t *p_this )
     access_t *p_src = p_access->p_source;
     access_sys_t *p_sys;
     bool b_bool;
+    int i_flags = O_RDWR | O_CREAT | O_EXCL | O_BINARY;
 
     var_Create( p_access, "timeshift-force", VLC_VAR_BOOL|VLC_VAR_DOINHERIT );
     if( var_GetBool( p_access, "timeshift-force" ) )
@@ -152,38 +258,91 @@ static int Open( vlc_object_t *p_this )
         }
     }
 
-    /* */
-    p_access->pf_read = NULL;
-    p_access->pf_block = Block;
-    p_access->pf_seek = Seek;
-    p_access->pf_control = Control;
-    p_access->info = p_src->info;
-
-    p_access->p_sys = p_sys = malloc( sizeof( access_sys_t ) );
+    p_access->p_sys = p_sys = calloc( 1, sizeof( access_sys_t ) );
     if( !p_sys )
         return VLC_ENOMEM;
-
-    /* */
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->i_write_size = 0;
-    p_sys->i_files = 0;
-    p_sys->i_data = 0;
-
-    p_sys->p_read_list = NULL;
-    p_sys->pp_read_last = &p_sys->p_read_list;
-    p_sys->p_write_list = NULL;
-    p_sys->pp_write_last = &p_sys->p_write_list;
+    p_sys->fd = -1;
 
     var_Create( p_access, "timeshift-dir",
                 VLC_VAR_DIRECTORY | VLC_VAR_DOINHERIT );
-    var_Create( p_access, "timeshift-granularity",
-                VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
-    p_sys->i_file_size = var_GetInteger( p_access, "timeshift-granularity" );
-    if( p_sys->i_file_size < 1 ) p_sys->i_file_size = 1;
-    p_sys->i_file_size *= 1024 * 1024; /* In MBytes */
+    p_sys->i_ring_size = var_CreateGetInteger( p_access, "timeshift-size" );
+    if( p_sys->i_ring_size < 2 ) p_sys->i_ring_size = 2;
+    p_sys->i_ring_size *= 1024 * 1024; /* In MBytes */
+    p_sys->i_ring_size -= p_sys->i_ring_size % TIMESHIFT_IO_SIZE;
+
+    p_sys->i_index = ( p_sys->i_ring_size + TIMESHIFT_IO_SIZE ) /
+                     TIMESHIFT_INDEX_STEP + 1;
+    p_sys->p_index = malloc( p_sys->i_index * sizeof( mtime_t ) );
+    p_sys->p_write = AlignedAlloc( &p_sys->p_write_orig, TIMESHIFT_IO_SIZE );
+    p_sys->p_read = AlignedAlloc( &p_sys->p_read_orig, TIMESHIFT_IO_SIZE );
+    p_sys->i_read_base = -1;
+    if( !p_sys->p_index || !p_sys->p_write || !p_sys->p_read )
+        goto error;
+
+    /* Create the ring file */
+    {
+        char *psz_base = GetTmpFilePath( p_access );
+
+        if( !psz_base ||
+            asprintf( &p_sys->psz_filename, "%sring.dat", psz_base ) == -1 )
+            p_sys->psz_filename = NULL;
+        free( psz_base );
+        if( !p_sys->psz_filename )
+            goto error;
+    }
+#ifdef O_DIRECT
+    if( var_CreateGetBool( p_access, "timeshift-direct" ) )
+    {
+        p_sys->fd = utf8_open( p_sys->psz_filename, i_flags | O_DIRECT,
+                               0600 );
+        if( p_sys->fd == -1 && errno == EINVAL )
+            msg_Warn( p_access, "direct I/O not supported in %s",
+                      p_sys->psz_filename );
+        else if( p_sys->fd == -1 )
+            goto open_failed;
+        else
+            msg_Dbg( p_access, "using direct I/O" );
+    }
+    else
+#endif
+        p_sys->fd = -1;
+    if( p_sys->fd == -1 )
+        p_sys->fd = utf8_open( p_sys->psz_filename, i_flags, 0600 );
+    if( p_sys->fd == -1 )
+        goto open_failed;
+
+    /* Allocate the whole file now rather than fail later */
+#ifdef HAVE_POSIX_FALLOCATE
+    errno = posix_fallocate( p_sys->fd, 0, p_sys->i_ring_size );
+    if( errno == ENOSPC )
+    {
+        msg_Err( p_access, "cannot allocate %"PRId64" MB in '%s' (%m)",
+                 p_sys->i_ring_size >> 20, p_sys->psz_filename );
+        goto error;
+    }
+    else if( errno )
+#endif
+    if( ftruncate( p_sys->fd, p_sys->i_ring_size ) )
+    {
+        msg_Err( p_access, "cannot resize '%s' (%m)", p_sys->psz_filename );
+        goto error;
+    }
+    msg_Dbg( p_access, "timeshift file '%s' of %"PRId64" MB",
+             p_sys->psz_filename, p_sys->i_ring_size >> 20 );
 
-    p_sys->psz_filename_base = GetTmpFilePath( p_access );
-    p_sys->psz_filename = malloc( strlen( p_sys->psz_filename_base ) + 1000 );
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( NULL, &p_sys->wait );
+#ifdef WIN32
+    vlc_mutex_init( &p_sys->io_lock );
+#endif
+
+    /* */
+    p_access->pf_read = NULL;
+    p_access->pf_block = Block;
+    p_access->pf_seek = Seek;
+    p_access->pf_control = Control;
+    p_access->info = p_src->info;
+    p_access->info.i_pos = 0;
 
     if( vlc_thread_create( p_access, "timeshift thread", Thread,
                            VLC_THREAD_PRIORITY_LOW, false ) )
@@ -194,6 +353,22 @@ static int Open( vlc_object_t *p_this )
     }
 
     return VLC_SUCCESS;
+
+open_failed:
+    msg_Err( p_access, "cannot open temporary file '%s' (%m)",
+             p_sys->psz_filename );
+error:
+    if( p_sys->fd != -1 )
+    {
+        close( p_sys->fd );
+        unlink( p_sys->psz_filename );
+    }
+    free( p_sys->psz_filename );
+    free( p_sys->p_index );
+    free( p_sys->p_write_orig );
+    free( p_sys->p_read_orig );
+    free( p_sys );
+    return VLC_EGENERIC;
 }
 
 /*****************************************************************************
@@ -203,36 +378,28 @@ static void Close( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
-    ts_entry_t *p_entry;
-    unsigned i;
 
     msg_Dbg( p_access, "timeshift close called" );
     vlc_thread_join( p_access );
 
-    for( p_entry = p_sys->p_write_list; p_entry; )
-    {
-        ts_entry_t *p_next = p_entry->p_next;
-        fclose( p_entry->file );
-        free( p_entry );
-        p_entry = p_next;
-    }
-    for( p_entry = p_sys->p_read_list; p_entry; )
-    {
-        ts_entry_t *p_next = p_entry->p_next;
-        fclose( p_entry->file );
-        free( p_entry );
-        p_entry = p_next;
-    }
-    for( i = 0; i < p_sys->i_files; i++ )
-    {
-        sprintf( p_sys->psz_filename, "%s%i.dat",
-                 p_sys->psz_filename_base, i );
-        unlink( p_sys->psz_filename );
-    }
+    if( p_sys->i_resume_count > 0 )
+        msg_Dbg( p_access, "resume latency: %d resumes, average %"PRId64
+                 " us, max %"PRId64" us", p_sys->i_resume_count,
+                 p_sys->i_resume_total / p_sys->i_resume_count,
+                 p_sys->i_resume_max );
+
+    close( p_sys->fd );
+    unlink( p_sys->psz_filename );
 
+#ifdef WIN32
+    vlc_mutex_destroy( &p_sys->io_lock );
+#endif
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
     free( p_sys->psz_filename );
-    free( p_sys->psz_filename_base );
-    block_FifoRelease( p_sys->p_fifo );
+    free( p_sys->p_index );
+    free( p_sys->p_write_orig );
+    free( p_sys->p_read_orig );
     free( p_sys );
 }
 
@@ -243,6 +410,8 @@ static block_t *Block( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
     access_t *p_src = p_access->p_source;
+    int64_t i_pos = p_access->info.i_pos;
+    int64_t i_base = i_pos - i_pos % TIMESHIFT_IO_SIZE;
     block_t *p_block = NULL;
 
     /* Update info (we probably ought to be time caching that as well) */
@@ -252,21 +421,151 @@ static block_t *Block( access_t *p_access )
         p_access->info.i_update |= INPUT_UPDATE_META;
     }
 
-    /* Get data from timeshift fifo */
-    if( !p_access->info.b_eof )
-        p_block = block_FifoGet( p_sys->p_fifo );
+    if( p_access->info.b_eof )
+        return NULL;
 
-    if( p_block && !p_block->i_buffer ) /* Used to signal EOF */
-    { block_Release( p_block ); p_block = 0; }
+    if( i_base != p_sys->i_read_base )
+    {
+        mtime_t i_deadline = mdate() + TIMESHIFT_WAIT;
 
-    if( p_block )
+        vlc_mutex_lock( &p_sys->lock );
+        while( i_pos >= p_sys->i_end && !p_sys->b_source_eof &&
+               vlc_object_alive( p_access ) )
+        {
+            if( vlc_cond_timedwait( &p_sys->wait, &p_sys->lock, i_deadline ) )
+                break;
+        }
+
+        if( i_pos < p_sys->i_start )
+        {
+            msg_Warn( p_access, "%"PRId64" bytes overwritten before being "
+                      "read", p_sys->i_start - i_pos );
+            i_pos = p_sys->i_start;
+            i_base = i_pos - i_pos % TIMESHIFT_IO_SIZE;
+            /* Do not splice two unrelated parts of the stream silently */
+            p_access->info.i_update |= INPUT_UPDATE_DISCONTINUITY;
+        }
+
+        if( i_pos >= p_sys->i_end )
+        {
+            p_access->info.b_eof = p_sys->b_source_eof;
+            vlc_mutex_unlock( &p_sys->lock );
+            p_access->info.i_pos = i_pos;
+            return NULL;
+        }
+
+        if( i_pos >= p_sys->i_flushed )
+        {
+            /* Not written yet, take it from the write buffer */
+            p_block = block_New( p_access, p_sys->i_end - i_pos );
+            if( p_block )
+                memcpy( p_block->p_buffer,
+                        &p_sys->p_write[i_pos - p_sys->i_flushed],
+                        p_block->i_buffer );
+            vlc_mutex_unlock( &p_sys->lock );
+        }
+        else
+        {
+            bool b_lost;
+
+            vlc_mutex_unlock( &p_sys->lock );
+
+            p_sys->i_read_base = -1;
+            if( RingIO( p_sys, false, p_sys->p_read,
+                        i_base % p_sys->i_ring_size ) )
+            {
+                msg_Err( p_access, "cannot read timeshift file (%m)" );
+                p_access->info.i_pos = i_pos;
+                return NULL;
+            }
+
+            /* The unit may have been overwritten meanwhile */
+            vlc_mutex_lock( &p_sys->lock );
+            b_lost = i_base < p_sys->i_start;
+            vlc_mutex_unlock( &p_sys->lock );
+            if( !b_lost )
+                p_sys->i_read_base = i_base;
+            p_access->info.i_pos = i_pos;
+            if( b_lost )
+                return NULL;
+        }
+    }
+
+    if( !p_block )
     {
-        p_sys->i_data -= p_block->i_buffer;
-        return p_block;
+        p_block = block_New( p_access, i_base + TIMESHIFT_IO_SIZE - i_pos );
+        if( !p_block )
+            return NULL;
+        memcpy( p_block->p_buffer, &p_sys->p_read[i_pos - i_base],
+                p_block->i_buffer );
     }
 
-    p_access->info.b_eof = p_src->info.b_eof;
-    return NULL;
+    if( p_sys->i_resume_date > 0 )
+    {
+        mtime_t i_latency = mdate() - p_sys->i_resume_date;
+
+        msg_Dbg( p_access, "resumed in %"PRId64" us", i_latency );
+        p_sys->i_resume_count++;
+        p_sys->i_resume_total += i_latency;
+        if( i_latency > p_sys->i_resume_max )
+            p_sys->i_resume_max = i_latency;
+        p_sys->i_resume_date = 0;
+    }
+
+    p_access->info.i_pos = i_pos + p_block->i_buffer;
+    return p_block;
+}
+
+/*****************************************************************************
+ * Write: appends data to the window, flushing the full units
+ *****************************************************************************/
+static void Write( access_t *p_access, const uint8_t *p_data, size_t i_data )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    mtime_t i_date = mdate();
+
+    while( i_data > 0 )
+    {
+        size_t i_fill = p_sys->i_end - p_sys->i_flushed;
+        size_t i_copy = __MIN( i_data, TIMESHIFT_IO_SIZE - i_fill );
+        int64_t i_step;
+        bool b_failed;
+
+        vlc_mutex_lock( &p_sys->lock );
+        memcpy( &p_sys->p_write[i_fill], p_data, i_copy );
+        for( i_step = ( p_sys->i_end + TIMESHIFT_INDEX_STEP - 1 ) /
+                      TIMESHIFT_INDEX_STEP;
+             i_step * TIMESHIFT_INDEX_STEP < p_sys->i_end + (int64_t)i_copy;
+             i_step++ )
+            p_sys->p_index[i_step % p_sys->i_index] = i_date;
+        p_sys->i_end += i_copy;
+        vlc_cond_signal( &p_sys->wait );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        p_data += i_copy;
+        i_data -= i_copy;
+        if( i_fill + i_copy < TIMESHIFT_IO_SIZE )
+            break;
+
+        /* The unit overwrites the oldest one of the ring */
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_start = __MAX( p_sys->i_start, p_sys->i_flushed +
+                                TIMESHIFT_IO_SIZE - p_sys->i_ring_size );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        b_failed = RingIO( p_sys, true, p_sys->p_write,
+                           p_sys->i_flushed % p_sys->i_ring_size ) != 0;
+        if( b_failed && !p_sys->b_error )
+            msg_Err( p_access, "cannot write timeshift file (%m)" );
+        p_sys->b_error = b_failed;
+
+        /* The data of a failed write is lost */
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->i_flushed += TIMESHIFT_IO_SIZE;
+        if( b_failed )
+            p_sys->i_start = __MAX( p_sys->i_start, p_sys->i_flushed );
+        vlc_mutex_unlock( &p_sys->lock );
+    }
 }
 
 /*****************************************************************************
@@ -309,222 +608,42 @@ static void* Thread( vlc_object_t* p_this )
           continue;
         }
 
-        p_sys->i_data += p_block->i_buffer;
-
-        /* Write block */
-        if( !p_sys->p_write_list && !p_sys->p_read_list &&
-            block_FifoSize( p_sys->p_fifo ) < TIMESHIFT_FIFO_MAX )
-        {
-            /* If there isn't too much timeshifted data,
-             * write directly to FIFO */
-            block_FifoPut( p_sys->p_fifo, p_block );
-            continue;
-        }
-
-        WriteBlockToFile( p_access, p_block );
+        Write( p_access, p_block->p_buffer, p_block->i_buffer );
         block_Release( p_block );
-
-        /* Read from file to fill up the fifo */
-        while( block_FifoSize( p_sys->p_fifo ) < TIMESHIFT_FIFO_MIN &&
-               vlc_object_alive (p_access) )
-        {
-            p_block = ReadBlockFromFile( p_access );
-            if( !p_block ) break;
-
-            block_FifoPut( p_sys->p_fifo, p_block );
-        }
     }
 
     msg_Dbg( p_access, "timeshift: no more input data" );
 
-    while( vlc_object_alive (p_access) &&
-           (p_sys->p_read_list || block_FifoSize( p_sys->p_fifo ) ) )
-    {
-        /* Read from file to fill up the fifo */
-        while( block_FifoSize( p_sys->p_fifo ) < TIMESHIFT_FIFO_MIN &&
-               vlc_object_alive (p_access) && p_sys->p_read_list )
-        {
-            p_block = ReadBlockFromFile( p_access );
-            if( !p_block ) break;
-
-            block_FifoPut( p_sys->p_fifo, p_block );
-        }
-
-        msleep( 100000 );
-    }
-
-    msg_Dbg( p_access, "timeshift: EOF" );
-    p_src->info.b_eof = true;
-
-    /* Send dummy packet to avoid deadlock in Block() */
-    block_FifoPut( p_sys->p_fifo, block_New( p_access, 0 ) );
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_source_eof = true;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
     return NULL;
 }
 
 /*****************************************************************************
- * NextFileWrite:
- *****************************************************************************/
-static void NextFileWrite( access_t *p_access )
-{
-    access_sys_t *p_sys = p_access->p_sys;
-    ts_entry_t   *p_next;
-
-    if( !p_sys->p_write_list )
-    {
-        p_sys->i_write_size = 0;
-        return;
-    }
-
-    p_next = p_sys->p_write_list->p_next;
-
-    /* Put written file in read list */
-    if( p_sys->i_write_size < p_sys->i_file_size )
-        ftruncate( fileno( p_sys->p_write_list->file ), p_sys->i_write_size );
-
-    fseek( p_sys->p_write_list->file, 0, SEEK_SET );
-    *p_sys->pp_read_last = p_sys->p_write_list;
-    p_sys->pp_read_last = &p_sys->p_write_list->p_next;
-    p_sys->p_write_list->p_next = 0;
-
-    /* Switch to next file to write */
-    p_sys->p_write_list = p_next;
-    if( !p_sys->p_write_list ) p_sys->pp_write_last = &p_sys->p_write_list;
-
-    p_sys->i_write_size = 0;
-}
-
-/*****************************************************************************
- * NextFileRead:
- *****************************************************************************/
-static void NextFileRead( access_t *p_access )
-{
-    access_sys_t *p_sys = p_access->p_sys;
-    ts_entry_t   *p_next;
-
-    if( !p_sys->p_read_list ) return;
-
-    p_next = p_sys->p_read_list->p_next;
-
-    /* Put read file in write list */
-    fseek( p_sys->p_read_list->file, 0, SEEK_SET );
-    *p_sys->pp_write_last = p_sys->p_read_list;
-    p_sys->pp_write_last = &p_sys->p_read_list->p_next;
-    p_sys->p_read_list->p_next = 0;
-
-    /* Switch to next file to read */
-    p_sys->p_read_list = p_next;
-    if( !p_sys->p_read_list ) p_sys->pp_read_last = &p_sys->p_read_list;
-}
-
-/*****************************************************************************
- * WriteBlockToFile:
+ * Seek: seek to a specific location in the timeshift window
  *****************************************************************************/
-static int WriteBlockToFile( access_t *p_access, block_t *p_block )
+static int Seek( access_t *p_access, int64_t i_pos )
 {
     access_sys_t *p_sys = p_access->p_sys;
-    int i_write, i_buffer;
-
-    if( p_sys->i_write_size == p_sys->i_file_size ) NextFileWrite( p_access );
-
-    /* Open new file if necessary */
-    if( !p_sys->p_write_list )
-    {
-        FILE *file;
-
-        sprintf( p_sys->psz_filename, "%s%u.dat",
-                 p_sys->psz_filename_base, p_sys->i_files );
-        file = utf8_fopen( p_sys->psz_filename, "w+b" );
-
-        if( !file && p_sys->i_files < 2 )
-        {
-            /* We just can't work with less than 2 buffer files */
-            msg_Err( p_access, "cannot open temporary file '%s' (%m)",
-                     p_sys->psz_filename );
-            return VLC_EGENERIC;
-        }
-        else if( !file ) return VLC_EGENERIC;
-
-        p_sys->p_write_list = malloc( sizeof(ts_entry_t) );
-        p_sys->p_write_list->p_next = 0;
-        p_sys->p_write_list->file = file;
-        p_sys->pp_write_last = &p_sys->p_write_list->p_next;
-
-        p_sys->i_files++;
-    }
-
-    /* Write to file */
-    i_buffer = __MIN( p_block->i_buffer,
-                      p_sys->i_file_size - p_sys->i_write_size );
+    int64_t i_start, i_end;
 
-    i_write = fwrite( p_block->p_buffer, 1, i_buffer,
-                      p_sys->p_write_list->file );
+    vlc_mutex_lock( &p_sys->lock );
+    i_start = p_sys->i_start;
+    i_end = p_sys->i_end;
+    vlc_mutex_unlock( &p_sys->lock );
 
-    if( i_write > 0 ) p_sys->i_write_size += i_write;
-
-    //p_access->info.i_size += i_write;
-    //p_access->info.i_update |= INPUT_UPDATE_SIZE;
-
-    if( i_write < i_buffer )
+    /* The caller gets the valid targets with ACCESS_GET_TIMESHIFT_WINDOW */
+    if( i_pos < i_start || i_pos > i_end )
     {
-        /* Looks like we're short of space */
-
-        if( !p_sys->p_write_list->p_next )
-        {
-            msg_Warn( p_access, "no more space, overwritting old data" );
-            NextFileRead( p_access );
-            NextFileRead( p_access );
-        }
-
-        /* Make sure we switch to next file in write list */
-        p_sys->i_write_size = p_sys->i_file_size;
-    }
-
-    p_block->p_buffer += i_write;
-    p_block->i_buffer -= i_write;
-
-    /* Check if we have some data left */
-    if( p_block->i_buffer ) return WriteBlockToFile( p_access, p_block );
-
-    return VLC_SUCCESS;
-}
-
-/*****************************************************************************
- * ReadBlockFromFile:
- *****************************************************************************/
-static block_t *ReadBlockFromFile( access_t *p_access )
-{
-    access_sys_t *p_sys = p_access->p_sys;
-    block_t *p_block;
-
-    if( !p_sys->p_read_list && p_sys->p_write_list )
-    {
-        /* Force switching to next write file, that should
-         * give us something to read */
-        NextFileWrite( p_access );
+        msg_Dbg( p_access, "cannot seek to %"PRId64" outside of the window "
+                 "[%"PRId64", %"PRId64"]", i_pos, i_start, i_end );
+        return VLC_EGENERIC;
     }
 
-    if( !p_sys->p_read_list ) return 0;
-
-    p_block = block_New( p_access, 4096 );
-    p_block->i_buffer = fread( p_block->p_buffer, 1, 4096,
-                               p_sys->p_read_list->file );
-
-    if( p_block->i_buffer == 0 ) NextFileRead( p_access );
-
-    //p_access->info.i_size -= p_block->i_buffer;
-    //p_access->info.i_update |= INPUT_UPDATE_SIZE;
-
-    return p_block;
-}
-
-/*****************************************************************************
- * Seek: seek to a specific location in a file
- *****************************************************************************/
-static int Seek( access_t *p_access, int64_t i_pos )
-{
-    //access_sys_t *p_sys = p_access->p_sys;
-    (void)p_access;
-    (void)i_pos;
+    p_access->info.i_pos = i_pos;
+    p_access->info.b_eof = false;
     return VLC_SUCCESS;
 }
 
@@ -533,8 +652,11 @@ static int Seek( access_t *p_access, int64_t i_pos )
  *****************************************************************************/
 static int Control( access_t *p_access, int i_query, va_list args )
 {
+    access_sys_t *p_sys = p_access->p_sys;
     bool   *pb_bool;
     int          *pi_int;
+    int64_t      *pi_64, *pi_64_end;
+    mtime_t      *pi_length, i_delay;
 
     switch( i_query )
     {
@@ -556,6 +678,34 @@ static int Control( access_t *p_access, int i_query, va_list args )
         break;
 
     case ACCESS_SET_PAUSE_STATE:
+        if( (bool)va_arg( args, int ) )
+            p_sys->i_resume_date = 0;
+        else
+            p_sys->i_resume_date = mdate();
+        break;
+
+    case ACCESS_GET_TIMESHIFT_WINDOW:
+        pi_64 = (int64_t*)va_arg( args, int64_t * );
+        pi_64_end = (int64_t*)va_arg( args, int64_t * );
+        pi_length = (mtime_t*)va_arg( args, mtime_t * );
+        vlc_mutex_lock( &p_sys->lock );
+        *pi_64 = p_sys->i_start;
+        *pi_64_end = p_sys->i_end;
+        *pi_length = 0;
+        if( p_sys->i_end > p_sys->i_start )
+            *pi_length = mdate() - p_sys->p_index[p_sys->i_start /
+                                 TIMESHIFT_INDEX_STEP % p_sys->i_index];
+        vlc_mutex_unlock( &p_sys->lock );
+        break;
+
+    case ACCESS_GET_TIMESHIFT_POS:
+        i_delay = (mtime_t)va_arg( args, mtime_t );
+        pi_64 = (int64_t*)va_arg( args, int64_t * );
+        vlc_mutex_lock( &p_sys->lock );
+        *pi_64 = IndexFind( p_sys, mdate() - i_delay );
+        vlc_mutex_unlock( &p_sys->lock );
+        if( *pi_64 < 0 )
+            return VLC_EGENERIC;
         break;
 
     /* Forward everything else to the source access */
@@ -0,0 +1,336 @@
+/*****************************************************************************
+ * biquad.c: IIR filter kernels of the equalizers
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "biquad.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define BIQUAD_SSE2 1
+#endif
+
+/* -600 dB */
+#define BIQUAD_TINY 1e-30f
+
+static void Flush( float *p, int i_count )
+{
+    for( int i = 0; i < i_count; i++ )
+        if( p[i] > -BIQUAD_TINY && p[i] < BIQUAD_TINY )
+            p[i] = 0.f;
+}
+
+static void FlushBands( biquad_bands_state_t *p_state, int i_bands,
+                        int i_channels )
+{
+    Flush( p_state->x[0], i_channels );
+    Flush( p_state->x[1], i_channels );
+    for( int j = 0; j < i_bands; j++ )
+    {
+        Flush( p_state->y[j][0], i_channels );
+        Flush( p_state->y[j][1], i_channels );
+    }
+}
+
+static void FlushCascade( biquad_cascade_state_t *p_state, int i_stages,
+                          int i_channels )
+{
+    for( int k = 0; k < i_stages; k++ )
+        for( int i = 0; i < 4; i++ )
+            Flush( p_state->s[k][i], i_channels );
+}
+
+/*****************************************************************************
+ * C versions
+ *****************************************************************************/
+static void BandsC( biquad_bands_state_t *p_state,
+                    const biquad_bands_t *p_bands,
+                    float *p_out, const float *p_in,
+                    int i_samples, int i_channels,
+                    float f_factor, float f_gain )
+{
+    for( int i = 0; i < i_samples; i++ )
+    {
+        for( int ch = 0; ch < i_channels; ch++ )
+        {
+            const float x = p_in[ch];
+            float o = 0.f;
+
+            for( int j = 0; j < p_bands->i_bands; j++ )
+            {
+                float (*y)[BIQUAD_MAX_CHANNELS] = p_state->y[j];
+                const float f_y =
+                    p_bands->pf_alpha[j] * ( x - p_state->x[1][ch] ) +
+                    p_bands->pf_gamma[j] * y[0][ch] -
+                    p_bands->pf_beta[j]  * y[1][ch];
+
+                y[1][ch] = y[0][ch];
+                y[0][ch] = f_y;
+
+                o += f_y * p_bands->pf_amp[j];
+            }
+            p_state->x[1][ch] = p_state->x[0][ch];
+            p_state->x[0][ch] = x;
+
+            p_out[ch] = f_gain * ( f_factor * x + o );
+        }
+        p_in  += i_channels;
+        p_out += i_channels;
+    }
+    FlushBands( p_state, p_bands->i_bands, i_channels );
+}
+
+static void CascadeC( biquad_cascade_state_t *p_state,
+                      const float *p_coeffs, int i_stages,
+                      float *p_out, const float *p_in,
+                      int i_samples, int i_channels )
+{
+    for( int i = 0; i < i_samples; i++ )
+    {
+        for( int ch = 0; ch < i_channels; ch++ )
+        {
+            const float *c = p_coeffs;
+            float x = p_in[ch];
+
+            for( int k = 0; k < i_stages; k++, c += 5 )
+            {
+                float (*s)[BIQUAD_MAX_CHANNELS] = p_state->s[k];
+                const float y = x * c[0] + s[0][ch] * c[1] + s[1][ch] * c[2]
+                              - s[2][ch] * c[3] - s[3][ch] * c[4];
+
+                s[1][ch] = s[0][ch];
+                s[0][ch] = x;
+                s[3][ch] = s[2][ch];
+                s[2][ch] = y;
+                x = y;
+            }
+            p_out[ch] = x;
+        }
+        p_in  += i_channels;
+        p_out += i_channels;
+    }
+    FlushCascade( p_state, i_stages, i_channels );
+}
+
+/*****************************************************************************
+ * SSE2 versions
+ *****************************************************************************
+ * A vector holds 4 channels of a sample, and the states of a group of
+ * channels stay in registers over the whole buffer. The denormals are
+ * flushed to zero while filtering.
+ *****************************************************************************/
+#if defined(BIQUAD_SSE2)
+#define SSE2_INLINE static inline \
+    __attribute__((__target__("sse2"), __always_inline__))
+#define SSE2_KERNEL static __attribute__((__target__("sse2")))
+
+/* Flush to zero, denormals are zero */
+#define MXCSR_FTZ_DAZ 0x8040
+
+/* The first i_lanes channels of a sample, the others being 0 */
+SSE2_INLINE
+__m128 Load( const float *p, int i_lanes )
+{
+    switch( i_lanes )
+    {
+        case 4:
+            return _mm_loadu_ps( p );
+        case 3:
+            return _mm_movelh_ps( _mm_loadl_pi( _mm_setzero_ps(),
+                                                (const __m64 *)p ),
+                                  _mm_load_ss( p + 2 ) );
+        case 2:
+            return _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)p );
+        default:
+            return _mm_load_ss( p );
+    }
+}
+
+SSE2_INLINE
+void Store( float *p, __m128 v, int i_lanes )
+{
+    switch( i_lanes )
+    {
+        case 4:
+            _mm_storeu_ps( p, v );
+            break;
+        case 3:
+            _mm_storel_pi( (__m64 *)p, v );
+            _mm_store_ss( p + 2, _mm_movehl_ps( v, v ) );
+            break;
+        case 2:
+            _mm_storel_pi( (__m64 *)p, v );
+            break;
+        default:
+            _mm_store_ss( p, v );
+            break;
+    }
+}
+
+SSE2_KERNEL
+void BandsSSE2( biquad_bands_state_t *p_state,
+                const biquad_bands_t *p_bands,
+                float *p_out, const float *p_in,
+                int i_samples, int i_channels,
+                float f_factor, float f_gain )
+{
+    const unsigned i_csr = _mm_getcsr();
+    const int i_bands = p_bands->i_bands;
+    const __m128 factor = _mm_set1_ps( f_factor );
+    const __m128 gain = _mm_set1_ps( f_gain );
+    __m128 alpha[BIQUAD_MAX_BANDS], beta[BIQUAD_MAX_BANDS];
+    __m128 gamma[BIQUAD_MAX_BANDS], amp[BIQUAD_MAX_BANDS];
+
+    _mm_setcsr( i_csr | MXCSR_FTZ_DAZ );
+    for( int j = 0; j < i_bands; j++ )
+    {
+        alpha[j] = _mm_set1_ps( p_bands->pf_alpha[j] );
+        beta[j]  = _mm_set1_ps( p_bands->pf_beta[j] );
+        gamma[j] = _mm_set1_ps( p_bands->pf_gamma[j] );
+        amp[j]   = _mm_set1_ps( p_bands->pf_amp[j] );
+    }
+
+    for( int ch = 0; ch < i_channels; ch += 4 )
+    {
+        const int i_lanes = __MIN( 4, i_channels - ch );
+        const float *p_src = &p_in[ch];
+        float *p_dst = &p_out[ch];
+        __m128 x1 = _mm_loadu_ps( &p_state->x[0][ch] );
+        __m128 x2 = _mm_loadu_ps( &p_state->x[1][ch] );
+        __m128 y1[BIQUAD_MAX_BANDS], y2[BIQUAD_MAX_BANDS];
+
+        for( int j = 0; j < i_bands; j++ )
+        {
+            y1[j] = _mm_loadu_ps( &p_state->y[j][0][ch] );
+            y2[j] = _mm_loadu_ps( &p_state->y[j][1][ch] );
+        }
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            const __m128 x = Load( p_src, i_lanes );
+            const __m128 dx = _mm_sub_ps( x, x2 );
+            __m128 o = _mm_setzero_ps();
+
+            for( int j = 0; j < i_bands; j++ )
+            {
+                __m128 y = _mm_mul_ps( alpha[j], dx );
+                y = _mm_add_ps( y, _mm_mul_ps( gamma[j], y1[j] ) );
+                y = _mm_sub_ps( y, _mm_mul_ps( beta[j], y2[j] ) );
+                y2[j] = y1[j];
+                y1[j] = y;
+
+                o = _mm_add_ps( o, _mm_mul_ps( y, amp[j] ) );
+            }
+            x2 = x1;
+            x1 = x;
+
+            Store( p_dst, _mm_mul_ps( gain, _mm_add_ps( _mm_mul_ps( factor, x ),
+                                                        o ) ), i_lanes );
+            p_src += i_channels;
+            p_dst += i_channels;
+        }
+
+        /* The lanes past the channels only ever hold zeros */
+        _mm_storeu_ps( &p_state->x[0][ch], x1 );
+        _mm_storeu_ps( &p_state->x[1][ch], x2 );
+        for( int j = 0; j < i_bands; j++ )
+        {
+            _mm_storeu_ps( &p_state->y[j][0][ch], y1[j] );
+            _mm_storeu_ps( &p_state->y[j][1][ch], y2[j] );
+        }
+    }
+    _mm_setcsr( i_csr );
+    FlushBands( p_state, i_bands, i_channels );
+}
+
+SSE2_KERNEL
+void CascadeSSE2( biquad_cascade_state_t *p_state,
+                  const float *p_coeffs, int i_stages,
+                  float *p_out, const float *p_in,
+                  int i_samples, int i_channels )
+{
+    const unsigned i_csr = _mm_getcsr();
+    __m128 c[BIQUAD_MAX_STAGES][5];
+
+    _mm_setcsr( i_csr | MXCSR_FTZ_DAZ );
+    for( int k = 0; k < i_stages; k++ )
+        for( int i = 0; i < 5; i++ )
+            c[k][i] = _mm_set1_ps( p_coeffs[5 * k + i] );
+
+    for( int ch = 0; ch < i_channels; ch += 4 )
+    {
+        const int i_lanes = __MIN( 4, i_channels - ch );
+        const float *p_src = &p_in[ch];
+        float *p_dst = &p_out[ch];
+        __m128 s[BIQUAD_MAX_STAGES][4];
+
+        for( int k = 0; k < i_stages; k++ )
+            for( int i = 0; i < 4; i++ )
+                s[k][i] = _mm_loadu_ps( &p_state->s[k][i][ch] );
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            __m128 x = Load( p_src, i_lanes );
+
+            for( int k = 0; k < i_stages; k++ )
+            {
+                __m128 y = _mm_mul_ps( x, c[k][0] );
+                y = _mm_add_ps( y, _mm_mul_ps( s[k][0], c[k][1] ) );
+                y = _mm_add_ps( y, _mm_mul_ps( s[k][1], c[k][2] ) );
+                y = _mm_sub_ps( y, _mm_mul_ps( s[k][2], c[k][3] ) );
+                y = _mm_sub_ps( y, _mm_mul_ps( s[k][3], c[k][4] ) );
+                s[k][1] = s[k][0];
+                s[k][0] = x;
+                s[k][3] = s[k][2];
+                s[k][2] = y;
+                x = y;
+            }
+            Store( p_dst, x, i_lanes );
+            p_src += i_channels;
+            p_dst += i_channels;
+        }
+
+        for( int k = 0; k < i_stages; k++ )
+            for( int i = 0; i < 4; i++ )
+                _mm_storeu_ps( &p_state->s[k][i][ch], s[k][i] );
+    }
+    _mm_setcsr( i_csr );
+    FlushCascade( p_state, i_stages, i_channels );
+}
+#endif
+
+void biquad_KernelsInit( biquad_kernels_t *p_kernels, unsigned i_cpu )
+{
+    p_kernels->pf_bands   = BandsC;
+    p_kernels->pf_cascade = CascadeC;
+#if defined(BIQUAD_SSE2)
+    if( i_cpu & CPU_CAPABILITY_SSE2 )
+    {
+        p_kernels->pf_bands   = BandsSSE2;
+        p_kernels->pf_cascade = CascadeSSE2;
+    }
+#endif
+    (void)i_cpu;
+}
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * biquad.h: IIR filter kernels of the equalizers
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _BIQUAD_H_
+#define _BIQUAD_H_ 1
+
+/*
+ * The second order IIR filters of the equalizer (bands in parallel) and of
+ * the parametric equalizer (stages in cascade), on interleaved float
+ * samples. The SIMD kernels filter 4 channels at once, with the operations
+ * of the C ones in the same order, so that they only differ by what the
+ * compiler rounds differently.
+ * The states are stored with the channels contiguous, and their values too
+ * small to be heard are flushed to zero after each buffer, so that a
+ * filter fed with silence does not go on computing with denormals.
+ */
+
+#define BIQUAD_MAX_CHANNELS 32
+#define BIQUAD_MAX_BANDS    16
+#define BIQUAD_MAX_STAGES   8
+
+/* Bands in parallel:
+ *  y_j[n] = alpha_j ( x[n] - x[n-2] ) + gamma_j y_j[n-1] - beta_j y_j[n-2]
+ *  out[n] = gain ( factor x[n] + sum_j amp_j y_j[n] ) */
+typedef struct
+{
+    int          i_bands;
+    const float *pf_alpha;
+    const float *pf_beta;
+    const float *pf_gamma;
+    const float *pf_amp;
+} biquad_bands_t;
+
+typedef struct
+{
+    float x[2][BIQUAD_MAX_CHANNELS];                    /* x[n-1], x[n-2] */
+    float y[BIQUAD_MAX_BANDS][2][BIQUAD_MAX_CHANNELS];  /* y[n-1], y[n-2] */
+} biquad_bands_state_t;
+
+typedef void (*biquad_bands_filter_t)( biquad_bands_state_t *,
+                                       const biquad_bands_t *,
+                                       float *p_out, const float *p_in,
+                                       int i_samples, int i_channels,
+                                       float f_factor, float f_gain );
+
+/* Direct form 1 stages in cascade, of coefficients b0 b1 b2 a1 a2:
+ *  y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2] */
+typedef struct
+{
+    /* x[n-1], x[n-2], y[n-1], y[n-2] */
+    float s[BIQUAD_MAX_STAGES][4][BIQUAD_MAX_CHANNELS];
+} biquad_cascade_state_t;
+
+typedef void (*biquad_cascade_filter_t)( biquad_cascade_state_t *,
+                                         const float *p_coeffs, int i_stages,
+                                         float *p_out, const float *p_in,
+                                         int i_samples, int i_channels );
+
+typedef struct
+{
+    biquad_bands_filter_t   pf_bands;
+    biquad_cascade_filter_t pf_cascade;
+} biquad_kernels_t;
+
+/* The fastest kernels for the given CPU_CAPABILITY_* flags */
+void biquad_KernelsInit( biquad_kernels_t *, unsigned i_cpu );
+
+#endif
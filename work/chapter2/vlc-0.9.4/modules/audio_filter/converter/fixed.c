@@ -35,6 +35,8 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 
+#include "pcm_conv.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -50,22 +52,49 @@ static int  Create_U8ToF32    ( vlc_object_t * );
 static void Do_U8ToF32( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
                          aout_buffer_t * );
 
+static void Close( vlc_object_t * );
+
+struct aout_filter_sys_t
+{
+    pcm_conv_t conv;
+};
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 vlc_module_begin();
     set_description( N_("Fixed point audio format conversions") );
     add_submodule();
-        set_callbacks( Create_F32ToS16, NULL );
+        set_callbacks( Create_F32ToS16, Close );
         set_capability( "audio filter", 10 );
     add_submodule();
-        set_callbacks( Create_S16ToF32, NULL );
+        set_callbacks( Create_S16ToF32, Close );
         set_capability( "audio filter", 15 );
     add_submodule();
         set_callbacks( Create_U8ToF32, NULL );
         set_capability( "audio filter", 1 );
 vlc_module_end();
 
+/*****************************************************************************
+ * Open: allocate the conversion kernels
+ *****************************************************************************/
+static int Open( aout_filter_t *p_filter )
+{
+    p_filter->p_sys = malloc( sizeof(*p_filter->p_sys) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    pcm_conv_Init( &p_filter->p_sys->conv, vlc_CPU() );
+    return VLC_SUCCESS;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
 /*****************************************************************************
  * F32 to S16
  *****************************************************************************/
@@ -84,67 +113,25 @@ static int Create_F32ToS16( vlc_object_t *p_this )
         return -1;
     }
 
+    if( Open( p_filter ) )
+        return -1;
+
     p_filter->pf_do_work = Do_F32ToS16;
     p_filter->b_in_place = 1;
 
-    return VLC_SUCCESS;;
-}
-
-/*****************************************************************************
- * support routines borrowed from mpg321 (file: mad.c), which is distributed
- * under GPL license
- *
- * mpg321 was written by Joe Drew <drew@debian.org>, and based upon 'plaympeg'
- * from the smpeg sources, which was written by various people from Loki Software
- * (http://www.lokigames.com).
- *
- * It also incorporates some source from mad, written by Robert Leslie
- *****************************************************************************/
-
-/* The following two routines and data structure are from the ever-brilliant
-     Rob Leslie.
-*/
-
-#define VLC_F_FRACBITS  28
-
-# if VLC_F_FRACBITS == 28
-#  define VLC_F(x) ((vlc_fixed_t) (x##L))
-# endif
-
-# define VLC_F_ONE VLC_F(0x10000000)
-
-/*****************************************************************************
- * s24_to_s16_pcm: Scale a 24 bit pcm sample to a 16 bit pcm sample.
- *****************************************************************************/
-static inline int16_t s24_to_s16_pcm(vlc_fixed_t sample)
-{
-  /* round */
-  sample += (1L << (VLC_F_FRACBITS - 16));
-
-  /* clip */
-  if (sample >= VLC_F_ONE)
-    sample = VLC_F_ONE - 1;
-  else if (sample < -VLC_F_ONE)
-    sample = -VLC_F_ONE;
-
-  /* quantize */
-  return (sample >> (VLC_F_FRACBITS + 1 - 16));
+    return VLC_SUCCESS;
 }
 
 static void Do_F32ToS16( aout_instance_t * p_aout, aout_filter_t * p_filter,
                          aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i;
-    vlc_fixed_t * p_in = (vlc_fixed_t *)p_in_buf->p_buffer;
-    int16_t * p_out = (int16_t *)p_out_buf->p_buffer;
 
-    for ( i = p_in_buf->i_nb_samples
-               * aout_FormatNbChannels( &p_filter->input ) ; i-- ; )
-    {
-        /* Fast Scaling */
-        *p_out++ = s24_to_s16_pcm(*p_in++);
-    }
+    /* Rounded and clipped as the mad routines of mpg321 did */
+    p_filter->p_sys->conv.pf_fi32_s16( (int16_t *)p_out_buf->p_buffer,
+                                       (const vlc_fixed_t *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ) );
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes / 2;
 }
@@ -168,6 +155,9 @@ static int Create_S16ToF32( vlc_object_t *p_this )
         return -1;
     }
 
+    if( Open( p_filter ) )
+        return -1;
+
     p_filter->pf_do_work = Do_S16ToF32;
     p_filter->b_in_place = 1;
 
@@ -178,17 +168,12 @@ static void Do_S16ToF32( aout_instance_t * p_aout, aout_filter_t * p_filter,
                          aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
 
-    /* We start from the end because b_in_place is true */
-    int16_t * p_in = (int16_t *)p_in_buf->p_buffer + i - 1;
-    vlc_fixed_t * p_out = (vlc_fixed_t *)p_out_buf->p_buffer + i - 1;
-
-    while( i-- )
-    {
-        *p_out = (vlc_fixed_t)( (int32_t)(*p_in) * (FIXED32_ONE >> 16) );
-        p_in--; p_out--;
-    }
+    /* The kernel starts from the end because b_in_place is true */
+    p_filter->p_sys->conv.pf_s16_fi32( (vlc_fixed_t *)p_out_buf->p_buffer,
+                                       (const int16_t *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ) );
 
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes
@@ -36,16 +36,10 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 
-#ifdef HAVE_UNISTD_H
-#   include <unistd.h>
-#endif
-
-#ifdef HAVE_ALLOCA_H
-#   include <alloca.h>
-#endif
-
 #include <vlc_aout.h>
 
+#include "pcm_conv.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -59,6 +53,14 @@ static int  Create_FL32ToS16 ( vlc_object_t * );
 static void Do_FL32ToS16( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
                            aout_buffer_t * );
 
+static int  Create_FL32ToS24 ( vlc_object_t * );
+static void Do_FL32ToS24( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
+                           aout_buffer_t * );
+
+static int  Create_FL32ToS16Remap ( vlc_object_t * );
+static void Do_FL32ToS16Remap( aout_instance_t *, aout_filter_t *,
+                               aout_buffer_t *, aout_buffer_t * );
+
 static int  Create_FL32ToS8 ( vlc_object_t * );
 static void Do_FL32ToS8( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
                            aout_buffer_t * );
@@ -80,12 +82,6 @@ static void Do_S32ToFL32( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
                            aout_buffer_t * );
 
 static int  Create_S16ToFL32_SW( vlc_object_t * );
-static void Do_S16ToFL32_SW( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
-                           aout_buffer_t * );
-static void Do_S24ToFL32_SW( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
-                           aout_buffer_t * );
-static void Do_S32ToFL32_SW( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
-                           aout_buffer_t * );
 
 static int  Create_S8ToFL32( vlc_object_t * );
 static void Do_S8ToFL32( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
@@ -95,17 +91,44 @@ static int  Create_U8ToFL32( vlc_object_t * );
 static void Do_U8ToFL32( aout_instance_t *, aout_filter_t *, aout_buffer_t *,
                            aout_buffer_t * );
 
+static void Close( vlc_object_t * );
+
+#define STEREO ( AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT )
+
+/* The converters that go through the kernels of pcm_conv */
+struct aout_filter_sys_t
+{
+    pcm_conv_t   conv;
+    pcm_dither_t dither;
+    bool         b_dither;
+    int          pi_map[AOUT_CHAN_MAX];
+};
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#define DITHER_TEXT N_("Dither")
+#define DITHER_LONGTEXT N_( \
+    "Add a triangular noise of one least significant bit to the samples " \
+    "converted from float to 16 or 24 bits, so that the rounding error " \
+    "does not follow the signal." )
+
 vlc_module_begin();
     set_description( N_("Floating-point audio format conversions") );
+    add_bool( "converter-dither", false, NULL, DITHER_TEXT, DITHER_LONGTEXT,
+              true );
     add_submodule();
         set_capability( "audio filter", 10 );
         set_callbacks( Create_F32ToFL32, NULL );
     add_submodule();
         set_capability( "audio filter", 1 );
-        set_callbacks( Create_FL32ToS16, NULL );
+        set_callbacks( Create_FL32ToS16, Close );
+    add_submodule();
+        set_capability( "audio filter", 1 );
+        set_callbacks( Create_FL32ToS24, Close );
+    add_submodule();
+        set_capability( "audio filter", 1 );
+        set_callbacks( Create_FL32ToS16Remap, Close ); /* With stereo modes */
     add_submodule();
         set_capability( "audio filter", 1 );
         set_callbacks( Create_FL32ToS8, NULL );
@@ -117,10 +140,10 @@ vlc_module_begin();
         set_callbacks( Create_FL32ToU8, NULL );
     add_submodule();
         set_capability( "audio filter", 1 );
-        set_callbacks( Create_S16ToFL32, NULL );
+        set_callbacks( Create_S16ToFL32, Close );
     add_submodule();
         set_capability( "audio filter", 1 );
-        set_callbacks( Create_S16ToFL32_SW, NULL ); /* Endianness conversion*/
+        set_callbacks( Create_S16ToFL32_SW, Close ); /* Endianness conversion*/
     add_submodule();
         set_capability( "audio filter", 1 );
         set_callbacks( Create_S8ToFL32, NULL );
@@ -129,6 +152,38 @@ vlc_module_begin();
         set_callbacks( Create_U8ToFL32, NULL );
 vlc_module_end();
 
+/*****************************************************************************
+ * Open: allocate the kernels, and the dither of the conversions from float
+ *****************************************************************************/
+static int Open( aout_filter_t *p_filter, bool b_dither )
+{
+    struct aout_filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    pcm_conv_Init( &p_sys->conv, vlc_CPU() );
+    p_sys->b_dither = b_dither &&
+                      config_GetInt( p_filter, "converter-dither" );
+    if( p_sys->b_dither )
+        pcm_DitherInit( &p_sys->dither, (uintptr_t)p_sys ^ mdate() );
+
+    p_filter->p_sys = p_sys;
+    return VLC_SUCCESS;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
+static pcm_dither_t *Dither( aout_filter_t *p_filter )
+{
+    return p_filter->p_sys->b_dither ? &p_filter->p_sys->dither : NULL;
+}
+
 /*****************************************************************************
  * Fixed 32 to Float 32 and backwards
  *****************************************************************************/
@@ -217,6 +272,9 @@ static int Create_FL32ToS16( vlc_object_t *p_this )
         return -1;
     }
 
+    if( Open( p_filter, true ) )
+        return -1;
+
     p_filter->pf_do_work = Do_FL32ToS16;
     p_filter->b_in_place = 1;
 
@@ -227,29 +285,129 @@ static void Do_FL32ToS16( aout_instance_t * p_aout, aout_filter_t * p_filter,
                           aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i;
-    float * p_in = (float *)p_in_buf->p_buffer;
-    int16_t * p_out = (int16_t *)p_out_buf->p_buffer;
 
-    for ( i = p_in_buf->i_nb_samples
-               * aout_FormatNbChannels( &p_filter->input ); i-- ; )
+    /* Rounded and clipped as walken's trick based on IEEE float format */
+    p_filter->p_sys->conv.pf_fl32_s16( (int16_t *)p_out_buf->p_buffer,
+                                       (const float *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ),
+                                       Dither( p_filter ) );
+
+    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
+    p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes / 2;
+}
+
+/*****************************************************************************
+ * FL32 To S24
+ *****************************************************************************/
+static int Create_FL32ToS24( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+
+    if ( p_filter->input.i_format != VLC_FOURCC('f','l','3','2')
+          || p_filter->output.i_format != AOUT_FMT_S24_NE )
     {
-#if 0
-        /* Slow version. */
-        if ( *p_in >= 1.0 ) *p_out = 32767;
-        else if ( *p_in < -1.0 ) *p_out = -32768;
-        else *p_out = *p_in * 32768.0;
-#else
-        /* This is walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *p_in + 384.0;
-        if ( u.i > 0x43c07fff ) *p_out = 32767;
-        else if ( u.i < 0x43bf8000 ) *p_out = -32768;
-        else *p_out = u.i - 0x43c00000;
-#endif
-        p_in++; p_out++;
+        return -1;
     }
 
+    if ( !AOUT_FMTS_SIMILAR( &p_filter->input, &p_filter->output ) )
+    {
+        return -1;
+    }
+
+    if( Open( p_filter, true ) )
+        return -1;
+
+    p_filter->pf_do_work = Do_FL32ToS24;
+    p_filter->b_in_place = 1;
+
+    return 0;
+}
+
+static void Do_FL32ToS24( aout_instance_t * p_aout, aout_filter_t * p_filter,
+                          aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
+{
+    VLC_UNUSED(p_aout);
+
+    p_filter->p_sys->conv.pf_fl32_s24( (uint8_t *)p_out_buf->p_buffer,
+                                       (const float *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ),
+                                       Dither( p_filter ) );
+
+    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
+    p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 3 / 4;
+}
+
+/*****************************************************************************
+ * FL32 To S16 with the stereo modes of the trivial channel mixer
+ *****************************************************************************
+ * Picking the left or the right channel, or reversing them, is done while
+ * converting rather than by the channel mixer on a float buffer of its own.
+ *****************************************************************************/
+static int Create_FL32ToS16Remap( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+    const uint32_t i_in = p_filter->input.i_original_channels
+                              & AOUT_CHAN_PHYSMASK;
+    const uint32_t i_out = p_filter->output.i_original_channels;
+    int *pi_map;
+
+    if ( p_filter->input.i_format != VLC_FOURCC('f','l','3','2')
+          || p_filter->output.i_format != AOUT_FMT_S16_NE
+          || p_filter->input.i_rate != p_filter->output.i_rate
+          || p_filter->input.i_physical_channels != STEREO
+          || p_filter->output.i_physical_channels != STEREO
+          || p_filter->input.i_original_channels
+              == p_filter->output.i_original_channels )
+    {
+        return -1;
+    }
+
+    /* The stereo modes, as the trivial channel mixer does them */
+    if ( i_in == STEREO
+          && ( i_out & AOUT_CHAN_PHYSMASK ) != STEREO )
+    {
+        /* Fake-stereo mode */
+        const int i_src = ( i_out & AOUT_CHAN_LEFT ) ? 0 : 1;
+
+        if( Open( p_filter, true ) )
+            return -1;
+        pi_map = p_filter->p_sys->pi_map;
+        pi_map[0] = pi_map[1] = i_src;
+    }
+    else if ( i_out & AOUT_CHAN_REVERSESTEREO )
+    {
+        if( Open( p_filter, true ) )
+            return -1;
+        pi_map = p_filter->p_sys->pi_map;
+        pi_map[0] = 1;
+        pi_map[1] = 0;
+    }
+    else
+    {
+        return -1;
+    }
+
+    p_filter->pf_do_work = Do_FL32ToS16Remap;
+    p_filter->b_in_place = 0;
+
+    return 0;
+}
+
+static void Do_FL32ToS16Remap( aout_instance_t * p_aout,
+                               aout_filter_t * p_filter,
+                               aout_buffer_t * p_in_buf,
+                               aout_buffer_t * p_out_buf )
+{
+    VLC_UNUSED(p_aout);
+
+    p_filter->p_sys->conv.pf_fl32_s16_remap( (int16_t *)p_out_buf->p_buffer,
+                                             (const float *)p_in_buf->p_buffer,
+                                             p_in_buf->i_nb_samples, 2, 2,
+                                             p_filter->p_sys->pi_map, 1.f,
+                                             Dither( p_filter ) );
+
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes / 2;
 }
@@ -409,6 +567,9 @@ static int Create_S16ToFL32( vlc_object_t *p_this )
         return -1;
     }
 
+    if( Open( p_filter, false ) )
+        return -1;
+
     if( p_filter->input.i_format == AOUT_FMT_S32_NE )
         p_filter->pf_do_work = Do_S32ToFL32;
     else if( p_filter->input.i_format == AOUT_FMT_S24_NE )
@@ -421,32 +582,19 @@ static int Create_S16ToFL32( vlc_object_t *p_this )
     return 0;
 }
 
+/* These also do the endianness conversion of the _SW formats. The kernels
+ * start from the end, because b_in_place is true. */
 static void Do_S16ToFL32( aout_instance_t * p_aout, aout_filter_t * p_filter,
                           aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
 
-    /* We start from the end because b_in_place is true */
-    int16_t * p_in = (int16_t *)p_in_buf->p_buffer + i - 1;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
-
-    while( i-- )
-    {
-#if 0
-        /* Slow version */
-        *p_out = (float)*p_in / 32768.0;
-#else
-        /* This is walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *p_in + 0x43c00000;
-        *p_out = u.f - 384.0;
-#endif
-
-        p_in--; p_out--;
-    }
+    p_filter->p_sys->conv.pf_s16_fl32( (float *)p_out_buf->p_buffer,
+                                       (const int16_t *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ),
+                                       p_filter->input.i_format
+                                           != AOUT_FMT_S16_NE );
 
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 2;
@@ -456,23 +604,13 @@ static void Do_S24ToFL32( aout_instance_t * p_aout, aout_filter_t * p_filter,
                           aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
 
-    /* We start from the end because b_in_place is true */
-    uint8_t * p_in = (uint8_t *)p_in_buf->p_buffer + (i - 1) * 3;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
-
-    while( i-- )
-    {
-#ifdef WORDS_BIGENDIAN
-        *p_out = ((float)( (((int32_t)*(int16_t *)(p_in)) << 8) + p_in[2]))
-#else
-        *p_out = ((float)( (((int32_t)*(int16_t *)(p_in+1)) << 8) + p_in[0]))
-#endif
-            / 8388608.0;
-
-        p_in -= 3; p_out--;
-    }
+    p_filter->p_sys->conv.pf_s24_fl32( (float *)p_out_buf->p_buffer,
+                                       (const uint8_t *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ),
+                                       p_filter->input.i_format
+                                           != AOUT_FMT_S24_NE );
 
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 3;
@@ -482,16 +620,13 @@ static void Do_S32ToFL32( aout_instance_t * p_aout, aout_filter_t * p_filter,
                           aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
 {
     VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
-
-    /* We start from the end because b_in_place is true */
-    int32_t * p_in = (int32_t *)p_in_buf->p_buffer + i - 1;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
 
-    while( i-- )
-    {
-        *p_out-- = (float)*p_in-- / 2147483648.0;
-    }
+    p_filter->p_sys->conv.pf_s32_fl32( (float *)p_out_buf->p_buffer,
+                                       (const int32_t *)p_in_buf->p_buffer,
+                                       p_in_buf->i_nb_samples *
+                                       aout_FormatNbChannels( &p_filter->input ),
+                                       p_filter->input.i_format
+                                           != AOUT_FMT_S32_NE );
 
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 4;
@@ -514,7 +649,10 @@ static int Create_S16ToFL32_SW( vlc_object_t *p_this )
          && p_filter->output.i_format == VLC_FOURCC('f','l','3','2')
          && p_filter->input.i_format != AOUT_FMT_S16_NE )
     {
-        p_filter->pf_do_work = Do_S16ToFL32_SW;
+        if( Open( p_filter, false ) )
+            return -1;
+
+        p_filter->pf_do_work = Do_S16ToFL32;
         p_filter->b_in_place = true;
 
         return 0;
@@ -525,7 +663,10 @@ static int Create_S16ToFL32_SW( vlc_object_t *p_this )
          && p_filter->output.i_format == VLC_FOURCC('f','l','3','2')
          && p_filter->input.i_format != AOUT_FMT_S24_NE )
     {
-        p_filter->pf_do_work = Do_S24ToFL32_SW;
+        if( Open( p_filter, false ) )
+            return -1;
+
+        p_filter->pf_do_work = Do_S24ToFL32;
         p_filter->b_in_place = true;
 
         return 0;
@@ -536,7 +677,10 @@ static int Create_S16ToFL32_SW( vlc_object_t *p_this )
          && p_filter->output.i_format == VLC_FOURCC('f','l','3','2')
          && p_filter->input.i_format != AOUT_FMT_S32_NE )
     {
-        p_filter->pf_do_work = Do_S32ToFL32_SW;
+        if( Open( p_filter, false ) )
+            return -1;
+
+        p_filter->pf_do_work = Do_S32ToFL32;
         p_filter->b_in_place = true;
 
         return 0;
@@ -545,105 +689,6 @@ static int Create_S16ToFL32_SW( vlc_object_t *p_this )
     return -1;
 }
 
-static void Do_S16ToFL32_SW( aout_instance_t * p_aout, aout_filter_t * p_filter,
-                             aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
-{
-    VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
-
-    /* We start from the end because b_in_place is true */
-    int16_t * p_in;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
-
-#ifdef HAVE_SWAB
-#   ifdef HAVE_ALLOCA
-    int16_t * p_swabbed = alloca( i * sizeof(int16_t) );
-#   else
-    int16_t * p_swabbed = malloc( i * sizeof(int16_t) );
-#   endif
-
-    swab( p_in_buf->p_buffer, (void *)p_swabbed, i * sizeof(int16_t) );
-    p_in = p_swabbed + i - 1;
-
-#else
-    uint8_t p_tmp[2];
-    p_in = (int16_t *)p_in_buf->p_buffer + i - 1;
-#endif
-
-    while( i-- )
-    {
-#ifndef HAVE_SWAB
-        p_tmp[0] = ((uint8_t *)p_in)[1];
-        p_tmp[1] = ((uint8_t *)p_in)[0];
-        *p_out = (float)( *(int16_t *)p_tmp ) / 32768.0;
-#else
-        *p_out = (float)*p_in / 32768.0;
-#endif
-        p_in--; p_out--;
-    }
-
-#ifdef HAVE_SWAB
-#   ifndef HAVE_ALLOCA
-    free( p_swabbed );
-#   endif
-#endif
-
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 2;
-}
-
-static void Do_S24ToFL32_SW( aout_instance_t * p_aout, aout_filter_t * p_filter,
-                             aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
-{
-    VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
-
-    /* We start from the end because b_in_place is true */
-    uint8_t * p_in = (uint8_t *)p_in_buf->p_buffer + (i - 1) * 3;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
-
-    uint8_t p_tmp[3];
-
-    while( i-- )
-    {
-        p_tmp[0] = p_in[2];
-        p_tmp[1] = p_in[1];
-        p_tmp[2] = p_in[0];
-
-#ifdef WORDS_BIGENDIAN
-        *p_out = ((float)( (((int32_t)*(int16_t *)(p_tmp)) << 8) + p_tmp[2]))
-#else
-        *p_out = ((float)( (((int32_t)*(int16_t *)(p_tmp+1)) << 8) + p_tmp[0]))
-#endif
-            / 8388608.0;
-
-        p_in -= 3; p_out--;
-    }
-
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 3;
-}
-
-static void Do_S32ToFL32_SW( aout_instance_t * p_aout, aout_filter_t * p_filter,
-                             aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
-{
-    VLC_UNUSED(p_aout);
-    int i = p_in_buf->i_nb_samples * aout_FormatNbChannels( &p_filter->input );
-
-    /* We start from the end because b_in_place is true */
-    int32_t * p_in = (int32_t *)p_in_buf->p_buffer + i - 1;
-    float * p_out = (float *)p_out_buf->p_buffer + i - 1;
-
-    while( i-- )
-    {
-        *p_out-- = (float)*p_in-- / 2147483648.0;
-    }
-
-    p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
-    p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes * 4 / 4;
-}
-
-
 /*****************************************************************************
  * S8 To FL32
  *****************************************************************************/
@@ -0,0 +1,585 @@
+/*****************************************************************************
+ * pcm_conv.c: sample format conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+
+#include "pcm_conv.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define PCM_SSE2 1
+#endif
+
+/* Fixed point samples have 28 fractional bits (FIXED32_FRACBITS) */
+#define FIXED_TO_S16_SHIFT 13
+#define S16_TO_FIXED_SHIFT 12
+
+/*****************************************************************************
+ * Dither
+ *****************************************************************************/
+void pcm_DitherInit( pcm_dither_t *p_dither, uint32_t i_seed )
+{
+    for( int i = 0; i < 2; i++ )
+        for( int j = 0; j < 4; j++ )
+        {
+            /* Any non zero state will do */
+            i_seed = i_seed * 1664525 + 1013904223;
+            p_dither->s[i][j] = i_seed | 1;
+        }
+}
+
+static inline uint32_t XorShift( uint32_t x )
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* Four values of the dither, in ]-1, 1[ LSB */
+static void Dither4( pcm_dither_t *p_dither, float *pf_dither )
+{
+    for( int j = 0; j < 4; j++ )
+    {
+        const uint32_t a = p_dither->s[0][j] = XorShift( p_dither->s[0][j] );
+        const uint32_t b = p_dither->s[1][j] = XorShift( p_dither->s[1][j] );
+
+        pf_dither[j] = (float)(int32_t)( a >> 8 ) * (1.f / 16777216.f)
+                     - (float)(int32_t)( b >> 8 ) * (1.f / 16777216.f);
+    }
+}
+
+/*****************************************************************************
+ * Rounding, from a value in LSB
+ *****************************************************************************/
+/* As walken's trick based on IEEE float format: to the nearest even, and
+ * NaN gives the largest sample as with the SIMD versions. The rounding is
+ * one lrintf() of the value, which the compiler cannot split with the sum
+ * of the sample and its dither as it can an addition of 1.5 * 2^23. */
+static inline int16_t ClipS16( float f )
+{
+    if( !( f < 32767.f ) )
+        return 32767;
+    if( f < -32768.f )
+        return -32768;
+    return lrintf( f );
+}
+
+/* The same with 24 bits */
+static inline int32_t ClipS24( float f )
+{
+    if( !( f < 8388607.f ) )            /* including NaN */
+        return 8388607;
+    if( f < -8388608.f )
+        return -8388608;
+    return lrintf( f );
+}
+
+static inline void StoreS24( uint8_t *p, int32_t i )
+{
+#ifdef WORDS_BIGENDIAN
+    p[0] = i >> 16;
+    p[1] = i >> 8;
+    p[2] = i;
+#else
+    p[0] = i;
+    p[1] = i >> 8;
+    p[2] = i >> 16;
+#endif
+}
+
+/* The sample of the 3 bytes, with the first one as the most significant
+ * one if b_big */
+static inline int32_t LoadS24( const uint8_t *p, bool b_big )
+{
+    if( b_big )
+        return ( (int32_t)(int8_t)p[0] << 16 ) | ( p[1] << 8 ) | p[2];
+    return ( (int32_t)(int8_t)p[2] << 16 ) | ( p[1] << 8 ) | p[0];
+}
+
+static inline uint16_t Swap16( uint16_t i )
+{
+    return ( i << 8 ) | ( i >> 8 );
+}
+
+static inline uint32_t Swap32( uint32_t i )
+{
+    return ( i << 24 ) | ( ( i << 8 ) & 0xff0000 ) | ( ( i >> 8 ) & 0xff00 )
+         | ( i >> 24 );
+}
+
+/*****************************************************************************
+ * C versions
+ *****************************************************************************
+ * With a dither, the samples are taken by 4 as by the SIMD versions, so
+ * that the same sample gets the same dither.
+ *****************************************************************************/
+static void FL32ToS16C( int16_t *p_out, const float *p_in, size_t i_samples,
+                        pcm_dither_t *p_dither )
+{
+    if( p_dither == NULL )
+    {
+        for( size_t i = 0; i < i_samples; i++ )
+            p_out[i] = ClipS16( p_in[i] * 32768.f );
+        return;
+    }
+
+    for( size_t i = 0; i < i_samples; i += 4 )
+    {
+        float pf_dither[4];
+
+        Dither4( p_dither, pf_dither );
+        for( size_t j = 0; j < 4 && i + j < i_samples; j++ )
+            p_out[i + j] = ClipS16( p_in[i + j] * 32768.f + pf_dither[j] );
+    }
+}
+
+static void FL32ToS24C( uint8_t *p_out, const float *p_in, size_t i_samples,
+                        pcm_dither_t *p_dither )
+{
+    for( size_t i = 0; i < i_samples; i += 4 )
+    {
+        float pf_dither[4] = { 0.f, 0.f, 0.f, 0.f };
+
+        if( p_dither != NULL )
+            Dither4( p_dither, pf_dither );
+        for( size_t j = 0; j < 4 && i + j < i_samples; j++ )
+            StoreS24( &p_out[3 * ( i + j )],
+                      ClipS24( p_in[i + j] * 8388608.f + pf_dither[j] ) );
+    }
+}
+
+static void S16ToFL32C( float *p_out, const int16_t *p_in, size_t i_samples,
+                        bool b_swap )
+{
+    /* We start from the end because the buffer may be shared */
+    for( size_t i = i_samples; i-- > 0; )
+    {
+        const int16_t i_sample = b_swap ? (int16_t)Swap16( p_in[i] )
+                                        : p_in[i];
+        p_out[i] = i_sample * (1.f / 32768.f);
+    }
+}
+
+static void S24ToFL32C( float *p_out, const uint8_t *p_in, size_t i_samples,
+                        bool b_swap )
+{
+#ifdef WORDS_BIGENDIAN
+    const bool b_big = !b_swap;
+#else
+    const bool b_big = b_swap;
+#endif
+
+    /* One loop for each byte order, so that they do not test it */
+    if( b_big )
+        for( size_t i = i_samples; i-- > 0; )
+            p_out[i] = LoadS24( &p_in[3 * i], true ) * (1.f / 8388608.f);
+    else
+        for( size_t i = i_samples; i-- > 0; )
+            p_out[i] = LoadS24( &p_in[3 * i], false ) * (1.f / 8388608.f);
+}
+
+static void S32ToFL32C( float *p_out, const int32_t *p_in, size_t i_samples,
+                        bool b_swap )
+{
+    for( size_t i = i_samples; i-- > 0; )
+    {
+        const int32_t i_sample = b_swap ? (int32_t)Swap32( p_in[i] )
+                                        : p_in[i];
+        p_out[i] = (float)i_sample * (1.f / 2147483648.f);
+    }
+}
+
+static void FI32ToS16C( int16_t *p_out, const int32_t *p_in,
+                        size_t i_samples )
+{
+    for( size_t i = 0; i < i_samples; i++ )
+    {
+        /* round, clip and quantize */
+        int32_t i_sample = p_in[i] + ( 1 << ( FIXED_TO_S16_SHIFT - 1 ) );
+
+        i_sample >>= FIXED_TO_S16_SHIFT;
+        p_out[i] = __MAX( -32768, __MIN( i_sample, 32767 ) );
+    }
+}
+
+static void S16ToFI32C( int32_t *p_out, const int16_t *p_in,
+                        size_t i_samples )
+{
+    for( size_t i = i_samples; i-- > 0; )
+        p_out[i] = (int32_t)p_in[i] * ( 1 << S16_TO_FIXED_SHIFT );
+}
+
+static void FL32ToS16RemapC( int16_t *p_out, const float *p_in,
+                             size_t i_frames, unsigned i_in_channels,
+                             unsigned i_out_channels, const int *pi_map,
+                             float f_gain, pcm_dither_t *p_dither )
+{
+    const float f_scale = f_gain * 32768.f;
+    float pf_dither[4] = { 0.f, 0.f, 0.f, 0.f };
+    unsigned i_lane = 4;
+
+    for( size_t i = 0; i < i_frames; i++ )
+    {
+        for( unsigned j = 0; j < i_out_channels; j++ )
+        {
+            if( p_dither != NULL && i_lane == 4 )
+            {
+                Dither4( p_dither, pf_dither );
+                i_lane = 0;
+            }
+            *p_out++ = ClipS16( p_in[pi_map[j]] * f_scale
+                                + pf_dither[i_lane & 3] );
+            i_lane++;
+        }
+        p_in += i_in_channels;
+    }
+}
+
+/*****************************************************************************
+ * SSE2 versions
+ *****************************************************************************
+ * The conversions from float round to the nearest even as walken's trick,
+ * and the packs saturate as its clipping. The remainders of less than 4
+ * samples are left to the C versions.
+ *****************************************************************************/
+#if defined(PCM_SSE2)
+#define SSE2_INLINE static inline \
+    __attribute__((__target__("sse2"), __always_inline__))
+#define SSE2_KERNEL static __attribute__((__target__("sse2")))
+
+SSE2_INLINE
+__m128i XorShiftSSE2( __m128i x )
+{
+    x = _mm_xor_si128( x, _mm_slli_epi32( x, 13 ) );
+    x = _mm_xor_si128( x, _mm_srli_epi32( x, 17 ) );
+    x = _mm_xor_si128( x, _mm_slli_epi32( x, 5 ) );
+    return x;
+}
+
+SSE2_INLINE
+__m128 DitherSSE2( __m128i *p_a, __m128i *p_b )
+{
+    const __m128 scale = _mm_set1_ps( 1.f / 16777216.f );
+
+    *p_a = XorShiftSSE2( *p_a );
+    *p_b = XorShiftSSE2( *p_b );
+    return _mm_sub_ps(
+        _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( *p_a, 8 ) ), scale ),
+        _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( *p_b, 8 ) ), scale ) );
+}
+
+/* Past the 16 bits range, the packs saturate the result */
+SSE2_INLINE
+__m128i ToS32SSE2( __m128 v )
+{
+    const __m128 max = _mm_set1_ps( 2147483520.f );
+
+    /* cvtps gives INT32_MIN for what does not fit, even when positive */
+    return _mm_cvtps_epi32( _mm_min_ps( v, max ) );
+}
+
+SSE2_KERNEL
+void FL32ToS16SSE2( int16_t *p_out, const float *p_in, size_t i_samples,
+                    pcm_dither_t *p_dither )
+{
+    const __m128 scale = _mm_set1_ps( 32768.f );
+    size_t i = 0;
+
+    if( p_dither == NULL )
+    {
+        for( ; i + 8 <= i_samples; i += 8 )
+        {
+            const __m128i lo = ToS32SSE2( _mm_mul_ps( _mm_loadu_ps( &p_in[i] ),
+                                                      scale ) );
+            const __m128i hi = ToS32SSE2(
+                _mm_mul_ps( _mm_loadu_ps( &p_in[i + 4] ), scale ) );
+
+            _mm_storeu_si128( (__m128i *)&p_out[i],
+                              _mm_packs_epi32( lo, hi ) );
+        }
+    }
+    else
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p_dither->s[0] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)p_dither->s[1] );
+
+        for( ; i + 4 <= i_samples; i += 4 )
+        {
+            const __m128 v = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &p_in[i] ),
+                                                     scale ),
+                                         DitherSSE2( &a, &b ) );
+            const __m128i s = ToS32SSE2( v );
+
+            _mm_storel_epi64( (__m128i *)&p_out[i], _mm_packs_epi32( s, s ) );
+        }
+        _mm_storeu_si128( (__m128i *)p_dither->s[0], a );
+        _mm_storeu_si128( (__m128i *)p_dither->s[1], b );
+    }
+    FL32ToS16C( &p_out[i], &p_in[i], i_samples - i, p_dither );
+}
+
+SSE2_KERNEL
+void FL32ToS24SSE2( uint8_t *p_out, const float *p_in, size_t i_samples,
+                    pcm_dither_t *p_dither )
+{
+    const __m128 scale = _mm_set1_ps( 8388608.f );
+    const __m128 min = _mm_set1_ps( -8388608.f );
+    const __m128 max = _mm_set1_ps( 8388607.f );
+    __m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+    size_t i = 0;
+
+    if( p_dither != NULL )
+    {
+        a = _mm_loadu_si128( (const __m128i *)p_dither->s[0] );
+        b = _mm_loadu_si128( (const __m128i *)p_dither->s[1] );
+    }
+
+    for( ; i + 4 <= i_samples; i += 4 )
+    {
+        int32_t pi_sample[4] __attribute__((aligned(16)));
+        __m128 v = _mm_mul_ps( _mm_loadu_ps( &p_in[i] ), scale );
+
+        if( p_dither != NULL )
+            v = _mm_add_ps( v, DitherSSE2( &a, &b ) );
+        /* min_ps gives its second operand for NaN, the maximum as in C */
+        v = _mm_max_ps( _mm_min_ps( v, max ), min );
+        _mm_store_si128( (__m128i *)pi_sample, _mm_cvtps_epi32( v ) );
+#ifdef WORDS_BIGENDIAN
+        for( int j = 0; j < 4; j++ )
+            StoreS24( &p_out[3 * ( i + j )], pi_sample[j] );
+#else
+        {
+            /* The 12 bytes of the 4 samples, in two stores */
+            const uint64_t i_lo = ( pi_sample[0] & 0xffffff )
+                | (uint64_t)( pi_sample[1] & 0xffffff ) << 24
+                | (uint64_t)pi_sample[2] << 48;
+            const uint32_t i_hi = ( ( pi_sample[2] >> 16 ) & 0xff )
+                | (uint32_t)pi_sample[3] << 8;
+
+            memcpy( &p_out[3 * i], &i_lo, 8 );
+            memcpy( &p_out[3 * i + 8], &i_hi, 4 );
+        }
+#endif
+    }
+
+    if( p_dither != NULL )
+    {
+        _mm_storeu_si128( (__m128i *)p_dither->s[0], a );
+        _mm_storeu_si128( (__m128i *)p_dither->s[1], b );
+    }
+    FL32ToS24C( &p_out[3 * i], &p_in[i], i_samples - i, p_dither );
+}
+
+SSE2_INLINE
+__m128i Swap16SSE2( __m128i v )
+{
+    return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+
+SSE2_INLINE
+__m128i Swap32SSE2( __m128i v )
+{
+    const __m128i mask = _mm_set1_epi32( 0x00ff00ff );
+
+    /* Swaps the bytes of the 16 bits words, then the words */
+    v = _mm_or_si128( _mm_and_si128( _mm_srli_epi32( v, 8 ), mask ),
+                      _mm_slli_epi32( _mm_and_si128( v, mask ), 8 ) );
+    return _mm_or_si128( _mm_srli_epi32( v, 16 ), _mm_slli_epi32( v, 16 ) );
+}
+
+/*
+ * The blocks are converted from the end: a block is loaded before its
+ * output, twice as large, overwrites the input of the blocks before it.
+ */
+SSE2_KERNEL
+void S16ToFL32SSE2( float *p_out, const int16_t *p_in, size_t i_samples,
+                    bool b_swap )
+{
+    const __m128 scale = _mm_set1_ps( 1.f / 32768.f );
+    const size_t i_head = i_samples % 8;
+
+    for( size_t i = i_samples; i > i_head; )
+    {
+        __m128i v, lo, hi;
+
+        i -= 8;
+        v = _mm_loadu_si128( (const __m128i *)&p_in[i] );
+        if( b_swap )
+            v = Swap16SSE2( v );
+        /* Sign extension */
+        lo = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 );
+        hi = _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 );
+        _mm_storeu_ps( &p_out[i + 4],
+                       _mm_mul_ps( _mm_cvtepi32_ps( hi ), scale ) );
+        _mm_storeu_ps( &p_out[i], _mm_mul_ps( _mm_cvtepi32_ps( lo ), scale ) );
+    }
+    S16ToFL32C( p_out, p_in, i_head, b_swap );
+}
+
+SSE2_KERNEL
+void S32ToFL32SSE2( float *p_out, const int32_t *p_in, size_t i_samples,
+                    bool b_swap )
+{
+    const __m128 scale = _mm_set1_ps( 1.f / 2147483648.f );
+    const size_t i_head = i_samples % 4;
+
+    for( size_t i = i_samples; i > i_head; )
+    {
+        __m128i v;
+
+        i -= 4;
+        v = _mm_loadu_si128( (const __m128i *)&p_in[i] );
+        if( b_swap )
+            v = Swap32SSE2( v );
+        _mm_storeu_ps( &p_out[i], _mm_mul_ps( _mm_cvtepi32_ps( v ), scale ) );
+    }
+    S32ToFL32C( p_out, p_in, i_head, b_swap );
+}
+
+SSE2_KERNEL
+void FI32ToS16SSE2( int16_t *p_out, const int32_t *p_in, size_t i_samples )
+{
+    const __m128i round = _mm_set1_epi32( 1 << ( FIXED_TO_S16_SHIFT - 1 ) );
+    size_t i = 0;
+
+    for( ; i + 8 <= i_samples; i += 8 )
+    {
+        const __m128i lo = _mm_add_epi32(
+            _mm_loadu_si128( (const __m128i *)&p_in[i] ), round );
+        const __m128i hi = _mm_add_epi32(
+            _mm_loadu_si128( (const __m128i *)&p_in[i + 4] ), round );
+
+        _mm_storeu_si128( (__m128i *)&p_out[i],
+            _mm_packs_epi32( _mm_srai_epi32( lo, FIXED_TO_S16_SHIFT ),
+                             _mm_srai_epi32( hi, FIXED_TO_S16_SHIFT ) ) );
+    }
+    FI32ToS16C( &p_out[i], &p_in[i], i_samples - i );
+}
+
+SSE2_KERNEL
+void S16ToFI32SSE2( int32_t *p_out, const int16_t *p_in, size_t i_samples )
+{
+    const size_t i_head = i_samples % 8;
+
+    for( size_t i = i_samples; i > i_head; )
+    {
+        __m128i v;
+
+        i -= 8;
+        v = _mm_loadu_si128( (const __m128i *)&p_in[i] );
+        /* The sample in the high half, shifted down with its sign */
+        _mm_storeu_si128( (__m128i *)&p_out[i + 4],
+            _mm_srai_epi32( _mm_unpackhi_epi16( _mm_setzero_si128(), v ),
+                            16 - S16_TO_FIXED_SHIFT ) );
+        _mm_storeu_si128( (__m128i *)&p_out[i],
+            _mm_srai_epi32( _mm_unpacklo_epi16( _mm_setzero_si128(), v ),
+                            16 - S16_TO_FIXED_SHIFT ) );
+    }
+    S16ToFI32C( p_out, p_in, i_head );
+}
+
+/*
+ * The input samples of 4 frames are gathered by 4 from a table of their
+ * offsets, so that any channel map goes in one pass
+ */
+SSE2_KERNEL
+void FL32ToS16RemapSSE2( int16_t *p_out, const float *p_in, size_t i_frames,
+                         unsigned i_in_channels, unsigned i_out_channels,
+                         const int *pi_map, float f_gain,
+                         pcm_dither_t *p_dither )
+{
+    const __m128 scale = _mm_set1_ps( f_gain * 32768.f );
+    const unsigned i_period = 4 * i_out_channels;
+    int pi_offset[4 * PCM_MAX_CHANNELS];
+    __m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+    size_t i = 0;
+
+    for( unsigned j = 0; j < i_period; j++ )
+        pi_offset[j] = j / i_out_channels * i_in_channels
+                     + pi_map[j % i_out_channels];
+
+    if( p_dither != NULL )
+    {
+        a = _mm_loadu_si128( (const __m128i *)p_dither->s[0] );
+        b = _mm_loadu_si128( (const __m128i *)p_dither->s[1] );
+    }
+
+    for( ; i + 4 <= i_frames; i += 4 )
+    {
+        for( unsigned j = 0; j < i_period; j += 4 )
+        {
+            __m128 v = _mm_setr_ps( p_in[pi_offset[j]],
+                                    p_in[pi_offset[j + 1]],
+                                    p_in[pi_offset[j + 2]],
+                                    p_in[pi_offset[j + 3]] );
+            __m128i s;
+
+            v = _mm_mul_ps( v, scale );
+            if( p_dither != NULL )
+                v = _mm_add_ps( v, DitherSSE2( &a, &b ) );
+            s = ToS32SSE2( v );
+            _mm_storel_epi64( (__m128i *)&p_out[j], _mm_packs_epi32( s, s ) );
+        }
+        p_in += 4 * i_in_channels;
+        p_out += i_period;
+    }
+
+    if( p_dither != NULL )
+    {
+        _mm_storeu_si128( (__m128i *)p_dither->s[0], a );
+        _mm_storeu_si128( (__m128i *)p_dither->s[1], b );
+    }
+    FL32ToS16RemapC( p_out, p_in, i_frames - i, i_in_channels,
+                     i_out_channels, pi_map, f_gain, p_dither );
+}
+#endif
+
+void pcm_conv_Init( pcm_conv_t *p_conv, unsigned i_cpu )
+{
+    p_conv->pf_fl32_s16 = FL32ToS16C;
+    p_conv->pf_fl32_s24 = FL32ToS24C;
+    p_conv->pf_s16_fl32 = S16ToFL32C;
+    p_conv->pf_s24_fl32 = S24ToFL32C;
+    p_conv->pf_s32_fl32 = S32ToFL32C;
+    p_conv->pf_fi32_s16 = FI32ToS16C;
+    p_conv->pf_s16_fi32 = S16ToFI32C;
+    p_conv->pf_fl32_s16_remap = FL32ToS16RemapC;
+#if defined(PCM_SSE2)
+    if( i_cpu & CPU_CAPABILITY_SSE2 )
+    {
+        p_conv->pf_fl32_s16 = FL32ToS16SSE2;
+        p_conv->pf_fl32_s24 = FL32ToS24SSE2;
+        p_conv->pf_s16_fl32 = S16ToFL32SSE2;
+        p_conv->pf_s32_fl32 = S32ToFL32SSE2;
+        p_conv->pf_fi32_s16 = FI32ToS16SSE2;
+        p_conv->pf_s16_fi32 = S16ToFI32SSE2;
+        p_conv->pf_fl32_s16_remap = FL32ToS16RemapSSE2;
+    }
+#endif
+    (void)i_cpu;
+}
@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * pcm_conv.h: sample format conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _PCM_CONV_H_
+#define _PCM_CONV_H_ 1
+
+/*
+ * The conversions of the float and fixed point converters, on i_samples
+ * samples (frames times channels). The integer outputs are rounded to the
+ * nearest and clipped; the SIMD kernels give the same samples as the C
+ * ones. The conversions to a larger sample go from the end of the buffer,
+ * so that they can be done in place.
+ *
+ * The optional dither is triangular, of 1 LSB peak, from 4 lanes of two
+ * xorshift generators drawn for 4 samples at a time.
+ */
+
+typedef struct
+{
+    uint32_t s[2][4];
+} pcm_dither_t;
+
+void pcm_DitherInit( pcm_dither_t *, uint32_t i_seed );
+
+typedef struct
+{
+    /* Float to native endian integers, with a dither if not NULL */
+    void (*pf_fl32_s16)( int16_t *p_out, const float *p_in, size_t i_samples,
+                         pcm_dither_t * );
+    void (*pf_fl32_s24)( uint8_t *p_out, const float *p_in, size_t i_samples,
+                         pcm_dither_t * );
+
+    /* Integers, byte swapped if b_swap, to float */
+    void (*pf_s16_fl32)( float *p_out, const int16_t *p_in, size_t i_samples,
+                         bool b_swap );
+    void (*pf_s24_fl32)( float *p_out, const uint8_t *p_in, size_t i_samples,
+                         bool b_swap );
+    void (*pf_s32_fl32)( float *p_out, const int32_t *p_in, size_t i_samples,
+                         bool b_swap );
+
+    /* Fixed point (vlc_fixed_t) from and to native endian 16 bits */
+    void (*pf_fi32_s16)( int16_t *p_out, const int32_t *p_in,
+                         size_t i_samples );
+    void (*pf_s16_fi32)( int32_t *p_out, const int16_t *p_in,
+                         size_t i_samples );
+
+    /* Float to 16 bits, in one pass with a gain and a channel map: output
+     * channel j of a frame is input channel pi_map[j]. Not in place. */
+    void (*pf_fl32_s16_remap)( int16_t *p_out, const float *p_in,
+                               size_t i_frames, unsigned i_in_channels,
+                               unsigned i_out_channels, const int *pi_map,
+                               float f_gain, pcm_dither_t * );
+} pcm_conv_t;
+
+#define PCM_MAX_CHANNELS 32
+
+/* The fastest kernels for the given CPU_CAPABILITY_* flags */
+void pcm_conv_Init( pcm_conv_t *, unsigned i_cpu );
+
+#endif
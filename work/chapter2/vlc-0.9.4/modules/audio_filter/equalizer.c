@@ -37,9 +37,9 @@
 #include "vlc_aout.h"
 
 #include "equalizer_presets.h"
+#include "biquad.h"
 /* TODO:
  *  - add tables for other rates ( 22500, 11250, ...)
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *  computation (not too hard once the Q is found).
  *  - support for external preset
@@ -110,12 +110,12 @@ typedef struct aout_filter_sys_t
     bool b_2eqz;
 
     /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
+    biquad_bands_state_t state;
 
     /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    biquad_bands_state_t state2;
+
+    biquad_kernels_t kernels;
 
 } aout_filter_sys_t;
 
@@ -166,6 +166,11 @@ static int Open( vlc_object_t *p_this )
     {
         return VLC_EGENERIC;
     }
+    if( aout_FormatNbChannels( &p_filter->input ) > BIQUAD_MAX_CHANNELS )
+    {
+        msg_Err( p_filter, "too many channels" );
+        return VLC_EGENERIC;
+    }
 
     p_filter->pf_do_work = DoWork;
     p_filter->b_in_place = true;
@@ -285,10 +290,12 @@ static int EqzInit( aout_filter_t *p_filter, int i_rate )
 {
     aout_filter_sys_t *p_sys = p_filter->p_sys;
     const eqz_config_t *p_cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     aout_instance_t *p_aout = (aout_instance_t *)p_filter->p_parent;
 
+    biquad_KernelsInit( &p_sys->kernels, vlc_CPU() );
+
     /* Select the config */
     if( i_rate == 48000 )
     {
@@ -342,21 +349,8 @@ static int EqzInit( aout_filter_t *p_filter, int i_rate )
     }
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
-    {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0;
-
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0;
-        }
-    }
+    memset( &p_sys->state, 0, sizeof(p_sys->state) );
+    memset( &p_sys->state2, 0, sizeof(p_sys->state2) );
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -420,60 +414,27 @@ static void EqzFilter( aout_filter_t *p_filter, float *out, float *in,
                        int i_samples, int i_channels )
 {
     aout_filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    const biquad_bands_t bands = {
+        p_sys->i_band, p_sys->f_alpha, p_sys->f_beta, p_sys->f_gamma,
+        p_sys->f_amp
+    };
 
-    for( i = 0; i < i_samples; i++ )
+    if( p_sys->b_2eqz )
     {
-        for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
-        }
-
-        in  += i_channels;
-        out += i_channels;
+        /* The second filter gets source PCM + filtered PCM of the first */
+        p_sys->kernels.pf_bands( &p_sys->state, &bands, out, in,
+                                 i_samples, i_channels, EQZ_IN_FACTOR, 1.f );
+        in = out;
+        p_sys->kernels.pf_bands( &p_sys->state2, &bands, out, in,
+                                 i_samples, i_channels, EQZ_IN_FACTOR,
+                                 p_sys->f_gamp );
+    }
+    else
+    {
+        /* We add source PCM + filtered PCM */
+        p_sys->kernels.pf_bands( &p_sys->state, &bands, out, in,
+                                 i_samples, i_channels, EQZ_IN_FACTOR,
+                                 p_sys->f_gamp );
     }
 }
 
@@ -36,6 +36,8 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -43,7 +45,6 @@ static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 static void CalcPeakEQCoeffs( float, float, float, float, float * );
 static void CalcShelfEQCoeffs( float, float, float, int, float, float * );
-static void ProcessEQ( float *, float *, float *, unsigned, unsigned, float *, unsigned );
 static void DoWork( aout_instance_t *, aout_filter_t *,
                     aout_buffer_t *, aout_buffer_t * );
 
@@ -93,7 +94,8 @@ typedef struct aout_filter_sys_t
     /* Filter computed coeffs */
     float   coeffs[5*5];
     /* State */
-    float  *p_state;
+    biquad_cascade_state_t *p_state;
+    biquad_kernels_t kernels;
  
 } aout_filter_sys_t;
 
@@ -130,6 +132,11 @@ static int Open( vlc_object_t *p_this )
     {
         return VLC_EGENERIC;
     }
+    if( p_filter->input.i_channels > BIQUAD_MAX_CHANNELS )
+    {
+        msg_Err( p_filter, "too many channels" );
+        return VLC_EGENERIC;
+    }
 
     p_filter->pf_do_work = DoWork;
     p_filter->b_in_place = true;
@@ -166,8 +173,8 @@ static int Open( vlc_object_t *p_this )
                       i_samplerate, p_sys->coeffs+3*5);
     CalcShelfEQCoeffs(p_sys->f_highf, 1, p_sys->f_highgain, 0,
                       i_samplerate, p_sys->coeffs+4*5);
-    p_sys->p_state = (float*)calloc( p_filter->input.i_channels*5*4,
-                                     sizeof(float) );
+    p_sys->p_state = calloc( 1, sizeof(*p_sys->p_state) );
+    biquad_KernelsInit( &p_sys->kernels, vlc_CPU() );
 
     return VLC_SUCCESS;
 }
@@ -191,10 +198,12 @@ static void DoWork( aout_instance_t * p_aout, aout_filter_t * p_filter,
     p_out_buf->i_nb_samples = p_in_buf->i_nb_samples;
     p_out_buf->i_nb_bytes = p_in_buf->i_nb_bytes;
 
-    ProcessEQ( (float*)p_in_buf->p_buffer, (float*)p_out_buf->p_buffer,
-               p_filter->p_sys->p_state,
-               p_filter->input.i_channels, p_in_buf->i_nb_samples,
-               p_filter->p_sys->coeffs, 5 );
+    p_filter->p_sys->kernels.pf_cascade( p_filter->p_sys->p_state,
+                                         p_filter->p_sys->coeffs, 5,
+                                         (float*)p_out_buf->p_buffer,
+                                         (float*)p_in_buf->p_buffer,
+                                         p_in_buf->i_nb_samples,
+                                         p_filter->input.i_channels );
 }
 
 /*
@@ -297,51 +306,3 @@ static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
     coeffs[3] = a1/a0;
     coeffs[4] = a2/a0;
 }
-
-/*
-  src is assumed to be interleaved
-  dest is assumed to be interleaved
-  size of state is 4*channels*eqCount
-  samples is not premultiplied by channels
-  size of coeffs is 5*eqCount
-*/
-void ProcessEQ( float *src, float *dest, float *state,
-                unsigned channels, unsigned samples, float *coeffs,
-                unsigned eqCount )
-{
-    unsigned i, chn, eq;
-    float   b0, b1, b2, a1, a2;
-    float   x, y = 0;
-    float   *src1, *dest1;
-    float   *coeffs1, *state1;
-    src1 = src;
-    dest1 = dest;
-    for (i = 0; i < samples; i++)
-    {
-        state1 = state;
-        for (chn = 0; chn < channels; chn++)
-        {
-            coeffs1 = coeffs;
-            x = *src1++;
-            /* Direct form 1 IIRs */
-            for (eq = 0; eq < eqCount; eq++)
-            {
-                b0 = coeffs1[0];
-                b1 = coeffs1[1];
-                b2 = coeffs1[2];
-                a1 = coeffs1[3];
-                a2 = coeffs1[4];
-                coeffs1 += 5;
-                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
-                state1[1] = state1[0];
-                state1[0] = x;
-                state1[3] = state1[2];
-                state1[2] = y;
-                x = y;
-                state1 += 4;
-            }
-            *dest1++ = y;
-        }
-    }
-}
-
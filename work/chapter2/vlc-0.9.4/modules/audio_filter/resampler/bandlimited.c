@@ -44,6 +44,7 @@
 #include <vlc_block.h>
 
 #include "bandlimited.h"
+#include "polyphase.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -59,6 +60,15 @@ static void CloseFilter( vlc_object_t * );
 static block_t *Resample( filter_t *, block_t * );
 
 
+/* polyphase resampler */
+static int  OpenPolyphase     ( vlc_object_t * );
+static void ClosePolyphase    ( vlc_object_t * );
+static void DoPolyphase       ( aout_instance_t *, aout_filter_t *,
+                                aout_buffer_t *, aout_buffer_t * );
+static int  OpenPolyphaseFilter ( vlc_object_t * );
+static void ClosePolyphaseFilter( vlc_object_t * );
+static block_t *ResamplePolyphase( filter_t *, block_t * );
+
 static void FilterFloatUP( const float Imp[], const float ImpD[], uint16_t Nwing,
                            float *f_in, float *f_out, uint32_t ui_remainder,
                            uint32_t ui_output_rate, int16_t Inc,
@@ -89,9 +99,29 @@ struct filter_sys_t
     bool b_filter2;
 };
 
+struct polyphase_sys_t
+{
+    polyphase_t *p_poly;
+
+    float *p_copy;                      /* the input, as we work in place */
+    size_t i_copy;
+
+    audio_date_t end_date;
+};
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#define QUALITY_TEXT N_("Polyphase resampling quality")
+#define QUALITY_LONGTEXT N_( \
+    "Length of the filter of the polyphase resampler. Longer filters cut " \
+    "closer to the Nyquist frequency, with less aliasing, but are slower." )
+
+static const int pi_quality_values[] = {
+    POLYPHASE_FAST, POLYPHASE_NORMAL, POLYPHASE_BEST };
+static const char *const ppsz_quality_text[] = {
+    N_("Fast"), N_("Normal"), N_("Best") };
+
 vlc_module_begin();
     set_category( CAT_AUDIO );
     set_subcategory( SUBCAT_AUDIO_MISC );
@@ -99,10 +129,27 @@ vlc_module_begin();
     set_capability( "audio filter", 20 );
     set_callbacks( Create, Close );
 
+    add_integer( "polyphase-quality", POLYPHASE_NORMAL, NULL, QUALITY_TEXT,
+                 QUALITY_LONGTEXT, true );
+        change_integer_list( pi_quality_values, ppsz_quality_text, NULL );
+
     add_submodule();
     set_description( _("Audio filter for band-limited interpolation resampling") );
     set_capability( "audio filter2", 20 );
     set_callbacks( OpenFilter, CloseFilter );
+    add_shortcut( "bandlimited" );
+
+    add_submodule();
+    set_description( _("Audio filter for polyphase resampling") );
+    set_capability( "audio filter", 30 );
+    set_callbacks( OpenPolyphase, ClosePolyphase );
+    add_shortcut( "polyphase" );
+
+    add_submodule();
+    set_description( _("Audio filter for polyphase resampling") );
+    set_capability( "audio filter2", 30 );
+    set_callbacks( OpenPolyphaseFilter, ClosePolyphaseFilter );
+    add_shortcut( "polyphase" );
 vlc_module_end();
 
 /*****************************************************************************
@@ -570,8 +617,12 @@ static block_t *Resample( filter_t *p_filter, block_t *p_block )
     i_bytes_per_frame = p_filter->fmt_out.audio.i_channels *
                   p_filter->fmt_out.audio.i_bitspersample / 8;
 
-    i_out_size = i_bytes_per_frame * ( 1 + (p_block->i_samples *
-        p_filter->fmt_out.audio.i_rate / p_filter->fmt_in.audio.i_rate));
+    /* The samples of the filter wing kept from last time come out too,
+     * and those of the first wing are copied without being resampled */
+    i_out_size = i_bytes_per_frame * ( 1 + ( (p_block->i_samples +
+        2 * p_filter->p_sys->i_old_wing) *
+        __MAX(p_filter->fmt_out.audio.i_rate, p_filter->fmt_in.audio.i_rate) /
+        p_filter->fmt_in.audio.i_rate));
 
     p_out = p_filter->pf_audio_buffer_new( p_filter, i_out_size );
     if( !p_out )
@@ -711,3 +762,246 @@ void FilterFloatUD( const float Imp[], const float ImpD[], uint16_t Nwing, float
         p_in += (Inc * i_nb_channels); /* Input signal step */
     }
 }
+
+/*****************************************************************************
+ * OpenPolyphase: allocate the polyphase resampler
+ *****************************************************************************/
+static int OpenPolyphase( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+    struct polyphase_sys_t *p_sys;
+
+    if ( p_filter->input.i_rate == p_filter->output.i_rate
+          || p_filter->input.i_format != p_filter->output.i_format
+          || p_filter->input.i_physical_channels
+              != p_filter->output.i_physical_channels
+          || p_filter->input.i_original_channels
+              != p_filter->output.i_original_channels
+          || p_filter->input.i_format != VLC_FOURCC('f','l','3','2') )
+    {
+        return VLC_EGENERIC;
+    }
+
+#if !defined( __APPLE__ )
+    if( !config_GetInt( p_this, "hq-resampling" ) )
+    {
+        return VLC_EGENERIC;
+    }
+#endif
+
+    p_sys = calloc( 1, sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    /* The input rate moves, up to the worst case of Create() */
+    p_sys->p_poly = polyphase_New( aout_FormatNbChannels( &p_filter->input ),
+                                   p_filter->output.i_rate,
+                                   p_filter->input.i_rate * AOUT_MAX_INPUT_RATE,
+                                   config_GetInt( p_this, "polyphase-quality" ),
+                                   vlc_CPU() );
+    if( p_sys->p_poly == NULL )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    p_filter->p_sys = (struct aout_filter_sys_t *)p_sys;
+    p_filter->pf_do_work = DoPolyphase;
+
+    msg_Dbg( p_this, "polyphase resampling from %iHz to %iHz",
+             p_filter->input.i_rate, p_filter->output.i_rate );
+
+    /* As Create(), so that nothing is copied while the rates are equal */
+    p_filter->b_in_place = true;
+
+    return VLC_SUCCESS;
+}
+
+static void ClosePolyphase( vlc_object_t *p_this )
+{
+    aout_filter_t * p_filter = (aout_filter_t *)p_this;
+    struct polyphase_sys_t *p_sys = (struct polyphase_sys_t *)p_filter->p_sys;
+
+    polyphase_Delete( p_sys->p_poly );
+    free( p_sys->p_copy );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * DoPolyphase: convert a buffer
+ *****************************************************************************/
+static void DoPolyphase( aout_instance_t * p_aout, aout_filter_t * p_filter,
+                         aout_buffer_t * p_in_buf, aout_buffer_t * p_out_buf )
+{
+    struct polyphase_sys_t *p_sys = (struct polyphase_sys_t *)p_filter->p_sys;
+    const unsigned i_out_rate = p_aout->mixer.mixer.i_rate;
+    const unsigned i_bytes_per_frame = p_filter->input.i_bytes_per_frame;
+    const unsigned i_in = p_in_buf->i_nb_samples;
+    unsigned i_out;
+
+    /* Check if we really need to run the resampler */
+    if( i_out_rate == p_filter->input.i_rate )
+    {
+        const unsigned i_pending = polyphase_Pending( p_sys->p_poly );
+
+        if( i_pending > 0 && p_in_buf->i_size >=
+              p_in_buf->i_nb_bytes + i_pending * i_bytes_per_frame )
+        {
+            /* output the whole thing with the samples from last time */
+            memmove( p_in_buf->p_buffer + i_pending * i_bytes_per_frame,
+                     p_in_buf->p_buffer, p_in_buf->i_nb_bytes );
+            polyphase_Drain( p_sys->p_poly, (float *)p_in_buf->p_buffer );
+
+            p_out_buf->i_nb_samples = i_in + i_pending;
+            p_out_buf->start_date = aout_DateGet( &p_sys->end_date );
+            p_out_buf->end_date =
+                aout_DateIncrement( &p_sys->end_date,
+                                    p_out_buf->i_nb_samples );
+            p_out_buf->i_nb_bytes = p_out_buf->i_nb_samples *
+                i_bytes_per_frame;
+        }
+        polyphase_Reset( p_sys->p_poly );
+        p_filter->b_continuity = false;
+        return;
+    }
+
+    if( !p_filter->b_continuity )
+    {
+        p_filter->b_continuity = true;
+        polyphase_Reset( p_sys->p_poly );
+        aout_DateInit( &p_sys->end_date, i_out_rate );
+        aout_DateSet( &p_sys->end_date, p_in_buf->start_date );
+    }
+
+    /* The output overwrites the input */
+    if( p_sys->i_copy < p_in_buf->i_nb_bytes )
+    {
+        float *p_copy = realloc( p_sys->p_copy, p_in_buf->i_nb_bytes );
+
+        if( p_copy == NULL )
+            return;
+        p_sys->p_copy = p_copy;
+        p_sys->i_copy = p_in_buf->i_nb_bytes;
+    }
+    vlc_memcpy( p_sys->p_copy, p_in_buf->p_buffer, p_in_buf->i_nb_bytes );
+
+    i_out = polyphase_Resample( p_sys->p_poly, p_filter->input.i_rate,
+                                (float *)p_out_buf->p_buffer,
+                                p_out_buf->i_size / i_bytes_per_frame,
+                                p_sys->p_copy, i_in );
+
+    p_out_buf->i_nb_samples = i_out;
+    p_out_buf->start_date = aout_DateGet( &p_sys->end_date );
+    p_out_buf->end_date = aout_DateIncrement( &p_sys->end_date, i_out );
+    p_out_buf->i_nb_bytes = i_out * i_bytes_per_frame;
+}
+
+/*****************************************************************************
+ * OpenPolyphaseFilter:
+ *****************************************************************************/
+static int OpenPolyphaseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    struct polyphase_sys_t *p_sys;
+    unsigned int i_out_rate  = p_filter->fmt_out.audio.i_rate;
+
+    if( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate ||
+        p_filter->fmt_in.i_codec != VLC_FOURCC('f','l','3','2') )
+    {
+        return VLC_EGENERIC;
+    }
+
+#if !defined( SYS_DARWIN )
+    if( !config_GetInt( p_this, "hq-resampling" ) )
+    {
+        return VLC_EGENERIC;
+    }
+#endif
+
+    p_sys = calloc( 1, sizeof(*p_sys) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys->p_poly = polyphase_New( p_filter->fmt_in.audio.i_channels,
+                                   i_out_rate, p_filter->fmt_in.audio.i_rate,
+                                   config_GetInt( p_this, "polyphase-quality" ),
+                                   vlc_CPU() );
+    if( p_sys->p_poly == NULL )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    p_filter->p_sys = (filter_sys_t *)p_sys;
+    p_filter->pf_audio_filter = ResamplePolyphase;
+
+    msg_Dbg( p_this, "%4.4s/%iKHz/%i->%4.4s/%iKHz/%i",
+             (char *)&p_filter->fmt_in.i_codec,
+             p_filter->fmt_in.audio.i_rate,
+             p_filter->fmt_in.audio.i_channels,
+             (char *)&p_filter->fmt_out.i_codec,
+             p_filter->fmt_out.audio.i_rate,
+             p_filter->fmt_out.audio.i_channels);
+
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->fmt_out.audio.i_rate = i_out_rate;
+
+    return 0;
+}
+
+static void ClosePolyphaseFilter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    struct polyphase_sys_t *p_sys = (struct polyphase_sys_t *)p_filter->p_sys;
+
+    polyphase_Delete( p_sys->p_poly );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * ResamplePolyphase
+ *****************************************************************************/
+static block_t *ResamplePolyphase( filter_t *p_filter, block_t *p_block )
+{
+    struct polyphase_sys_t *p_sys = (struct polyphase_sys_t *)p_filter->p_sys;
+    const unsigned i_bytes_per_frame = p_filter->fmt_out.audio.i_channels *
+                  p_filter->fmt_out.audio.i_bitspersample / 8;
+    unsigned i_out;
+    block_t *p_out;
+
+    if( !p_block || !p_block->i_samples )
+    {
+        if( p_block )
+            block_Release( p_block );
+        return NULL;
+    }
+
+    if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        polyphase_Reset( p_sys->p_poly );
+
+    i_out = polyphase_OutputSize( p_sys->p_poly, p_block->i_samples,
+                                  p_filter->fmt_in.audio.i_rate );
+    p_out = p_filter->pf_audio_buffer_new( p_filter,
+                                           i_out * i_bytes_per_frame );
+    if( !p_out )
+    {
+        msg_Warn( p_filter, "can't get output buffer" );
+        block_Release( p_block );
+        return NULL;
+    }
+
+    i_out = polyphase_Resample( p_sys->p_poly, p_filter->fmt_in.audio.i_rate,
+                                (float *)p_out->p_buffer, i_out,
+                                (const float *)p_block->p_buffer,
+                                p_block->i_samples );
+
+    p_out->i_buffer = i_out * i_bytes_per_frame;
+    p_out->i_samples = i_out;
+    p_out->i_dts = p_block->i_dts;
+    p_out->i_pts = p_block->i_pts;
+    p_out->i_length = (mtime_t)i_out * 1000000
+                    / p_filter->fmt_out.audio.i_rate;
+
+    block_Release( p_block );
+    return p_out;
+}
@@ -0,0 +1,487 @@
+/*****************************************************************************
+ * polyphase.c: polyphase resampler engine
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+
+#include "polyphase.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define POLYPHASE_SSE2 1
+#   if defined(CAN_COMPILE_AVX2)
+#       include <immintrin.h>
+#       define POLYPHASE_AVX 1
+#   endif
+#endif
+
+#define CHUNK       1024   /* input frames deinterleaved at once */
+#define MAX_TAPS    512
+#define MAX_PHASES  512
+#define TAP_ALIGN   8      /* rows are padded with zeros for the kernels */
+
+static const struct
+{
+    unsigned i_taps;     /* when the cutoff is the input Nyquist frequency */
+    unsigned i_phases;   /* at least */
+    double   d_beta;     /* of the Kaiser window */
+    double   d_rolloff;  /* cutoff, relative to the lower Nyquist frequency */
+} p_presets[] =
+{
+    {  8,  32, 5.0, 0.85 },     /* POLYPHASE_FAST */
+    { 16,  64, 7.0, 0.91 },     /* POLYPHASE_NORMAL */
+    { 32, 128, 9.0, 0.95 },     /* POLYPHASE_BEST */
+};
+
+/* Computes one output frame from the planar input lines */
+typedef void (*polyphase_filter_t)( float *p_out, const float *p_coeffs,
+                                    const float *p_x, size_t i_stride,
+                                    unsigned i_channels, unsigned i_taps );
+
+struct polyphase_t
+{
+    unsigned i_channels;
+    unsigned i_out_rate;
+    int      i_quality;
+    unsigned i_max_row;
+
+    /* Filter bank, of i_phases + 1 rows of i_row coefficients */
+    float   *p_bank;
+    unsigned i_bank_rate;       /* input rate it was computed for */
+    double   d_cutoff;          /* in input sample rate units */
+    unsigned i_taps;            /* non zero coefficients of a row */
+    unsigned i_row;
+    unsigned i_center;          /* tap of the input frame at phase 0 */
+    unsigned i_phases;
+
+    float   *p_blend;           /* row between two phases */
+
+    /* Planar input, one line of i_stride floats per channel */
+    float   *p_work;
+    size_t   i_stride;
+    unsigned i_avail;           /* frames in the lines */
+    unsigned i_pos;             /* first tap of the next output frame */
+    unsigned i_rem;             /* and its phase, in 1/i_out_rate */
+    bool     b_primed;
+
+    polyphase_filter_t pf_filter;
+};
+
+/*****************************************************************************
+ * Filter bank
+ *****************************************************************************/
+static unsigned TapsFor( int i_quality, double d_ratio )
+{
+    const unsigned i_taps = 2 * ceil( p_presets[i_quality].i_taps
+                                      / ( 2. * __MIN( 1., d_ratio ) ) );
+    return __MIN( i_taps, MAX_TAPS );
+}
+
+static double Cutoff( const polyphase_t *p, unsigned i_in_rate )
+{
+    return .5 * p_presets[p->i_quality].d_rolloff
+              * __MIN( 1., (double)p->i_out_rate / i_in_rate );
+}
+
+/* Modified Bessel function of the first kind, order 0 */
+static double BesselI0( double x )
+{
+    double d_sum = 1., d_term = 1.;
+
+    for( int k = 1; d_term > d_sum * 1e-12; k++ )
+    {
+        d_term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+        d_sum += d_term;
+    }
+    return d_sum;
+}
+
+static void Build( polyphase_t *p, unsigned i_in_rate )
+{
+    const double d_beta = p_presets[p->i_quality].d_beta;
+    const unsigned i_min_phases = p_presets[p->i_quality].i_phases;
+    const unsigned i_den = p->i_out_rate / GCD( i_in_rate, p->i_out_rate );
+    const double d_cutoff = Cutoff( p, i_in_rate );
+    /* Shorter than it should be above the maximum rate given at creation */
+    const unsigned i_taps = __MIN( TapsFor( p->i_quality,
+                                            (double)p->i_out_rate / i_in_rate ),
+                                   p->i_max_row );
+    const double d_half = i_taps / 2;
+    const double d_i0_beta = BesselI0( d_beta );
+
+    /* With a multiple of the denominator of the ratio, every phase the
+     * remainder can take is a row of its own */
+    if( i_den <= MAX_PHASES )
+        p->i_phases = i_den * ( ( i_min_phases + i_den - 1 ) / i_den );
+    else
+        p->i_phases = i_min_phases;
+    p->i_taps = i_taps;
+    p->i_row = ( i_taps + TAP_ALIGN - 1 ) / TAP_ALIGN * TAP_ALIGN;
+    p->i_center = i_taps / 2 - 1;
+    p->d_cutoff = d_cutoff;
+    p->i_bank_rate = i_in_rate;
+
+    for( unsigned i_phase = 0; i_phase <= p->i_phases; i_phase++ )
+    {
+        float *p_row = &p->p_bank[i_phase * p->i_row];
+        const double d_frac = (double)i_phase / p->i_phases;
+        double d_sum = 0.;
+
+        for( unsigned k = 0; k < p->i_row; k++ )
+        {
+            const double t = (double)k - p->i_center - d_frac;
+            double h = 0.;
+
+            if( k < i_taps && fabs( t ) <= d_half )
+            {
+                const double x = 2. * d_cutoff * t;
+                const double w = t / d_half;
+
+                h = x == 0. ? 1. : sin( M_PI * x ) / ( M_PI * x );
+                h *= BesselI0( d_beta * sqrt( 1. - w * w ) ) / d_i0_beta;
+            }
+            p_row[k] = h;
+            d_sum += h;
+        }
+        /* Unity gain at DC */
+        for( unsigned k = 0; k < p->i_row; k++ )
+            p_row[k] /= d_sum;
+    }
+}
+
+/* Keeps the bank while its cutoff neither aliases nor loses much */
+static bool NeedBuild( const polyphase_t *p, unsigned i_in_rate )
+{
+    const double d_cutoff = Cutoff( p, i_in_rate );
+
+    return p->i_bank_rate == 0 || p->d_cutoff > d_cutoff * 1.02
+        || p->d_cutoff < d_cutoff * .95;
+}
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+static void FilterC( float *p_out, const float *p_coeffs, const float *p_x,
+                     size_t i_stride, unsigned i_channels, unsigned i_taps )
+{
+    for( unsigned c = 0; c < i_channels; c++, p_x += i_stride )
+    {
+        float f_sum = 0.f;
+
+        for( unsigned k = 0; k < i_taps; k++ )
+            f_sum += p_coeffs[k] * p_x[k];
+        p_out[c] = f_sum;
+    }
+}
+
+#if defined(POLYPHASE_SSE2)
+#define SSE2_KERNEL static __attribute__((__target__("sse2")))
+
+SSE2_KERNEL
+void FilterSSE2( float *p_out, const float *p_coeffs, const float *p_x,
+                 size_t i_stride, unsigned i_channels, unsigned i_taps )
+{
+    for( unsigned c = 0; c < i_channels; c++, p_x += i_stride )
+    {
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+
+        for( unsigned k = 0; k < i_taps; k += 8 )
+        {
+            sum0 = _mm_add_ps( sum0, _mm_mul_ps( _mm_loadu_ps( &p_coeffs[k] ),
+                                                 _mm_loadu_ps( &p_x[k] ) ) );
+            sum1 = _mm_add_ps( sum1,
+                               _mm_mul_ps( _mm_loadu_ps( &p_coeffs[k + 4] ),
+                                           _mm_loadu_ps( &p_x[k + 4] ) ) );
+        }
+        sum0 = _mm_add_ps( sum0, sum1 );
+        sum0 = _mm_add_ps( sum0, _mm_movehl_ps( sum0, sum0 ) );
+        sum0 = _mm_add_ss( sum0, _mm_shuffle_ps( sum0, sum0, 1 ) );
+        _mm_store_ss( &p_out[c], sum0 );
+    }
+}
+#endif
+
+#if defined(POLYPHASE_AVX)
+#define AVX_KERNEL static __attribute__((__target__("avx")))
+
+AVX_KERNEL
+void FilterAVX( float *p_out, const float *p_coeffs, const float *p_x,
+                size_t i_stride, unsigned i_channels, unsigned i_taps )
+{
+    for( unsigned c = 0; c < i_channels; c++, p_x += i_stride )
+    {
+        __m256 sum = _mm256_setzero_ps();
+        __m128 half;
+
+        for( unsigned k = 0; k < i_taps; k += 8 )
+            sum = _mm256_add_ps( sum,
+                                 _mm256_mul_ps( _mm256_loadu_ps( &p_coeffs[k] ),
+                                                _mm256_loadu_ps( &p_x[k] ) ) );
+        half = _mm_add_ps( _mm256_castps256_ps128( sum ),
+                           _mm256_extractf128_ps( sum, 1 ) );
+        half = _mm_add_ps( half, _mm_movehl_ps( half, half ) );
+        half = _mm_add_ss( half, _mm_shuffle_ps( half, half, 1 ) );
+        _mm_store_ss( &p_out[c], half );
+    }
+}
+#endif
+
+/* Simple enough for the compiler to vectorize */
+static void Blend( float *restrict p_dst, const float *restrict p_a,
+                   const float *restrict p_b, float f, unsigned i_taps )
+{
+    for( unsigned k = 0; k < i_taps; k++ )
+        p_dst[k] = p_a[k] + f * ( p_b[k] - p_a[k] );
+}
+
+/*****************************************************************************
+ * Resampler
+ *****************************************************************************/
+polyphase_t *polyphase_New( unsigned i_channels, unsigned i_out_rate,
+                            unsigned i_max_in_rate, int i_quality,
+                            unsigned i_cpu )
+{
+    polyphase_t *p;
+    unsigned i_max_taps;
+
+    if( i_channels == 0 || i_out_rate == 0 || i_max_in_rate == 0 )
+        return NULL;
+
+    p = calloc( 1, sizeof(*p) );
+    if( p == NULL )
+        return NULL;
+
+    p->i_channels = i_channels;
+    p->i_out_rate = i_out_rate;
+    p->i_quality = __MAX( POLYPHASE_FAST, __MIN( i_quality, POLYPHASE_BEST ) );
+
+    /* Downsampling needs the longest filters */
+    i_max_taps = TapsFor( p->i_quality, (double)i_out_rate / i_max_in_rate );
+    p->i_max_row = ( i_max_taps + TAP_ALIGN - 1 ) / TAP_ALIGN * TAP_ALIGN;
+    /* Room for the frames kept, a chunk, and the padding of the rows */
+    p->i_stride = CHUNK + 2 * p->i_max_row;
+
+    p->p_bank = malloc( ( MAX_PHASES + 1 ) * p->i_max_row * sizeof(float) );
+    p->p_blend = malloc( p->i_max_row * sizeof(float) );
+    p->p_work = calloc( i_channels * p->i_stride, sizeof(float) );
+    if( !p->p_bank || !p->p_blend || !p->p_work )
+    {
+        polyphase_Delete( p );
+        return NULL;
+    }
+
+    p->pf_filter = FilterC;
+#if defined(POLYPHASE_SSE2)
+    if( i_cpu & CPU_CAPABILITY_SSE2 )
+        p->pf_filter = FilterSSE2;
+#endif
+#if defined(POLYPHASE_AVX)
+    if( i_cpu & CPU_CAPABILITY_AVX2 )
+        p->pf_filter = FilterAVX;
+#endif
+    (void)i_cpu;
+
+    polyphase_Reset( p );
+    return p;
+}
+
+void polyphase_Delete( polyphase_t *p )
+{
+    free( p->p_work );
+    free( p->p_blend );
+    free( p->p_bank );
+    free( p );
+}
+
+void polyphase_Reset( polyphase_t *p )
+{
+    p->i_avail = 0;
+    p->i_pos = 0;
+    p->i_rem = 0;
+    p->b_primed = false;
+}
+
+unsigned polyphase_OutputSize( const polyphase_t *p, unsigned i_in,
+                               unsigned i_in_rate )
+{
+    const uint64_t i_frames = (uint64_t)p->i_avail + p->i_max_row + i_in;
+
+    return i_frames * p->i_out_rate / i_in_rate + 1;
+}
+
+static float *Line( polyphase_t *p, unsigned i_channel )
+{
+    return &p->p_work[i_channel * p->i_stride];
+}
+
+/* Moves the lines i_delta frames to the right, with zeros at the start */
+static void Delay( polyphase_t *p, unsigned i_delta )
+{
+    for( unsigned c = 0; c < p->i_channels; c++ )
+    {
+        memmove( Line( p, c ) + i_delta, Line( p, c ),
+                 p->i_avail * sizeof(float) );
+        memset( Line( p, c ), 0, i_delta * sizeof(float) );
+    }
+    p->i_avail += i_delta;
+}
+
+/* A new bank may center its filter on another tap */
+static void Rebuild( polyphase_t *p, unsigned i_in_rate )
+{
+    const unsigned i_old_center = p->i_center;
+
+    Build( p, i_in_rate );
+    if( !p->b_primed )
+        return;
+
+    if( p->i_center <= i_old_center )
+        p->i_pos += i_old_center - p->i_center;
+    else if( p->i_center - i_old_center <= p->i_pos )
+        p->i_pos -= p->i_center - i_old_center;
+    else
+    {
+        Delay( p, p->i_center - i_old_center - p->i_pos );
+        p->i_pos = 0;
+    }
+}
+
+/* Forgets the frames before the next output one */
+static void Shift( polyphase_t *p )
+{
+    if( p->i_pos >= p->i_avail )
+    {
+        p->i_pos -= p->i_avail;
+        p->i_avail = 0;
+    }
+    else if( p->i_pos > 0 )
+    {
+        for( unsigned c = 0; c < p->i_channels; c++ )
+            memmove( Line( p, c ), Line( p, c ) + p->i_pos,
+                     ( p->i_avail - p->i_pos ) * sizeof(float) );
+        p->i_avail -= p->i_pos;
+        p->i_pos = 0;
+    }
+}
+
+unsigned polyphase_Resample( polyphase_t *p, unsigned i_in_rate,
+                             float *p_out, unsigned i_out_max,
+                             const float *p_in, unsigned i_in )
+{
+    const unsigned i_channels = p->i_channels;
+    const unsigned i_out_rate = p->i_out_rate;
+    unsigned i_out = 0;
+
+    if( i_in_rate == 0 )
+        return 0;
+    if( NeedBuild( p, i_in_rate ) )
+        Rebuild( p, i_in_rate );
+    if( !p->b_primed )
+    {
+        /* Centers the first output frame on the first input one */
+        Delay( p, p->i_center );
+        p->b_primed = true;
+    }
+
+    for( ;; )
+    {
+        const unsigned i_count = __MIN( i_in, CHUNK + p->i_max_row
+                                              - p->i_avail );
+
+        for( unsigned c = 0; c < i_channels; c++ )
+        {
+            float *p_line = Line( p, c ) + p->i_avail;
+
+            for( unsigned i = 0; i < i_count; i++ )
+                p_line[i] = p_in[i * i_channels + c];
+        }
+        p->i_avail += i_count;
+        p_in += i_count * i_channels;
+        i_in -= i_count;
+
+        while( p->i_pos + p->i_taps <= p->i_avail )
+        {
+            if( i_out < i_out_max )
+            {
+                const uint64_t i_index = (uint64_t)p->i_rem * p->i_phases;
+                const unsigned i_frac = i_index % i_out_rate;
+                const float *p_coeffs = &p->p_bank[i_index / i_out_rate
+                                                   * p->i_row];
+
+                if( i_frac != 0 )
+                {
+                    Blend( p->p_blend, p_coeffs, p_coeffs + p->i_row,
+                           (float)i_frac / i_out_rate, p->i_row );
+                    p_coeffs = p->p_blend;
+                }
+                p->pf_filter( &p_out[i_out * i_channels], p_coeffs,
+                              Line( p, 0 ) + p->i_pos, p->i_stride,
+                              i_channels, p->i_row );
+                i_out++;
+            }
+
+            p->i_rem += i_in_rate;
+            p->i_pos += p->i_rem / i_out_rate;
+            p->i_rem %= i_out_rate;
+        }
+        Shift( p );
+
+        if( i_in == 0 )
+            return i_out;
+    }
+}
+
+/* The input frame of the next output one, rounded to the nearest */
+static unsigned NextFrame( const polyphase_t *p )
+{
+    return p->i_pos + p->i_center
+         + ( 2 * (uint64_t)p->i_rem >= p->i_out_rate ? 1 : 0 );
+}
+
+unsigned polyphase_Pending( const polyphase_t *p )
+{
+    const unsigned i_next = NextFrame( p );
+
+    if( !p->b_primed || i_next >= p->i_avail )
+        return 0;
+    return p->i_avail - i_next;
+}
+
+unsigned polyphase_Drain( polyphase_t *p, float *p_out )
+{
+    const unsigned i_pending = polyphase_Pending( p );
+    const unsigned i_next = NextFrame( p );
+
+    for( unsigned c = 0; c < p->i_channels; c++ )
+    {
+        const float *p_line = Line( p, c ) + i_next;
+
+        for( unsigned i = 0; i < i_pending; i++ )
+            p_out[i * p->i_channels + c] = p_line[i];
+    }
+    polyphase_Reset( p );
+    return i_pending;
+}
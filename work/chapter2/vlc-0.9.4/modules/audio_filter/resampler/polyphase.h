@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * polyphase.h: polyphase resampler engine
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _POLYPHASE_H_
+#define _POLYPHASE_H_ 1
+
+/*
+ * Resampling of interleaved float samples with a Kaiser windowed sinc
+ * low-pass filter, whose coefficients are computed in advance for a number
+ * of phases (a filter bank). When the ratio of the rates is a fraction whose
+ * denominator fits in the bank, every output sample uses one of its rows;
+ * otherwise, as while the input rate is moved to correct a drift, the two
+ * nearest rows are interpolated. The bank is only computed again when the
+ * input rate moves too far for its cutoff, in the memory allocated for the
+ * worst case at creation.
+ *
+ * The phase is kept as a remainder in 1/output rate units of input samples,
+ * so that any couple of integer rates advances exactly.
+ */
+
+#define POLYPHASE_FAST   0
+#define POLYPHASE_NORMAL 1
+#define POLYPHASE_BEST   2
+
+typedef struct polyphase_t polyphase_t;
+
+/**
+ * Creates a resampler to i_out_rate, for input rates up to i_max_in_rate,
+ * with the SIMD kernels allowed by the CPU_CAPABILITY_* flags of i_cpu.
+ */
+polyphase_t *polyphase_New( unsigned i_channels, unsigned i_out_rate,
+                            unsigned i_max_in_rate, int i_quality,
+                            unsigned i_cpu );
+void polyphase_Delete( polyphase_t * );
+
+/* Forgets the previous samples, as on a discontinuity */
+void polyphase_Reset( polyphase_t * );
+
+/* The most output frames i_in frames at i_in_rate can give */
+unsigned polyphase_OutputSize( const polyphase_t *, unsigned i_in,
+                               unsigned i_in_rate );
+
+/**
+ * Resamples i_in frames at i_in_rate, which may change from a call to the
+ * next, and returns the number of frames written to p_out. The output is
+ * delayed by half the filter, which is used up first by zeros so that its
+ * first sample matches the first input one.
+ */
+unsigned polyphase_Resample( polyphase_t *, unsigned i_in_rate,
+                             float *p_out, unsigned i_out_max,
+                             const float *p_in, unsigned i_in );
+
+/**
+ * Writes the input frames not output yet, rounded to the nearest phase, to
+ * hand over to unresampled samples at the same rate, then resets. Returns
+ * their number, which polyphase_Pending() gives beforehand.
+ */
+unsigned polyphase_Pending( const polyphase_t * );
+unsigned polyphase_Drain( polyphase_t *, float *p_out );
+
+#endif
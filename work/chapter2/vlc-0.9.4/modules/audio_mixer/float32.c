@@ -34,13 +34,21 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 
+#include "float_mix.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static int  Create    ( vlc_object_t * );
+static void Destroy   ( vlc_object_t * );
 
 static void DoWork    ( aout_instance_t *, aout_buffer_t * );
 
+struct aout_mixer_sys_t
+{
+    float_mix_t pf_mix;
+};
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -49,7 +57,7 @@ vlc_module_begin();
     set_subcategory( SUBCAT_AUDIO_MISC );
     set_description( N_("Float32 audio mixer") );
     set_capability( "audio mixer", 10 );
-    set_callbacks( Create, NULL );
+    set_callbacks( Create, Destroy );
 vlc_module_end();
 
 /*****************************************************************************
@@ -77,38 +85,23 @@ static int Create( vlc_object_t *p_this )
             return -1;
     }
 
+    p_aout->mixer.p_sys = malloc( sizeof(struct aout_mixer_sys_t) );
+    if ( p_aout->mixer.p_sys == NULL )
+        return -1;
+    p_aout->mixer.p_sys->pf_mix = float_mix_Get( vlc_CPU() );
+
     p_aout->mixer.pf_do_work = DoWork;
     return 0;
 }
 
 /*****************************************************************************
- * ScaleWords: prepare input words for averaging
- *****************************************************************************/
-static void ScaleWords( float * p_out, const float * p_in, size_t i_nb_words,
-                        int i_nb_inputs, float f_multiplier )
-{
-    int i;
-    f_multiplier /= i_nb_inputs;
-
-    for ( i = i_nb_words; i--; )
-    {
-        *p_out++ = *p_in++ * f_multiplier;
-    }
-}
-
-/*****************************************************************************
- * MeanWords: average input words
+ * Destroy: free mixer
  *****************************************************************************/
-static void MeanWords( float * p_out, const float * p_in, size_t i_nb_words,
-                       int i_nb_inputs, float f_multiplier )
+static void Destroy( vlc_object_t *p_this )
 {
-    int i;
-    f_multiplier /= i_nb_inputs;
+    aout_instance_t * p_aout = (aout_instance_t *)p_this;
 
-    for ( i = i_nb_words; i--; )
-    {
-        *p_out++ += *p_in++ * f_multiplier;
-    }
+    free( p_aout->mixer.p_sys );
 }
 
 /*****************************************************************************
@@ -116,83 +109,78 @@ static void MeanWords( float * p_out, const float * p_in, size_t i_nb_words,
  *****************************************************************************
  * Terminology : in this function a word designates a single float32, eg.
  * a stereo sample is consituted of two words.
+ *
+ * All the inputs are mixed at once, up to the end of the shortest of their
+ * current buffers, so that each output word is written only once per group
+ * of inputs.
  *****************************************************************************/
 static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
 {
     const int i_nb_inputs = p_aout->i_nb_inputs;
     const float f_multiplier_global = p_aout->mixer.f_multiplier;
     const int i_nb_channels = aout_FormatNbChannels( &p_aout->mixer.mixer );
+    aout_input_t * pp_inputs[AOUT_MAX_INPUTS];
+    const float * pp_in[AOUT_MAX_INPUTS];
+    float pf_multiplier[AOUT_MAX_INPUTS];
+    unsigned i_nb_mixed = 0, k;
+    size_t i_nb_words = p_buffer->i_nb_samples * i_nb_channels;
+    float * p_out = (float *)p_buffer->p_buffer;
     int i_input;
 
     for ( i_input = 0; i_input < i_nb_inputs; i_input++ )
     {
-        int i_nb_words = p_buffer->i_nb_samples * i_nb_channels;
         aout_input_t * p_input = p_aout->pp_inputs[i_input];
-        float f_multiplier = f_multiplier_global * p_input->f_multiplier;
-
-        float * p_out = (float *)p_buffer->p_buffer;
-        float * p_in = (float *)p_input->p_first_byte_to_mix;
 
         if ( p_input->b_error ) continue;
 
-        for ( ; ; )
-        {
-            ptrdiff_t i_available_words = (
-                 (float *)p_input->fifo.p_first->p_buffer - p_in)
-                                   + p_input->fifo.p_first->i_nb_samples
-                                   * i_nb_channels;
+        pp_inputs[i_nb_mixed] = p_input;
+        pp_in[i_nb_mixed] = (const float *)p_input->p_first_byte_to_mix;
+        pf_multiplier[i_nb_mixed] = f_multiplier_global
+                                     * p_input->f_multiplier / i_nb_inputs;
+        i_nb_mixed++;
+    }
 
-            if ( i_available_words < i_nb_words )
-            {
-                aout_buffer_t * p_old_buffer;
+    while ( i_nb_words > 0 )
+    {
+        size_t i_words = i_nb_words;
 
-                if ( i_available_words > 0 )
-                {
-                    if ( !i_input )
-                    {
-                        ScaleWords( p_out, p_in, i_available_words,
-                                    i_nb_inputs, f_multiplier );
-                    }
-                    else
-                    {
-                        MeanWords( p_out, p_in, i_available_words,
-                                   i_nb_inputs, f_multiplier );
-                    }
-                }
+        for ( k = 0; k < i_nb_mixed; k++ )
+        {
+            aout_fifo_t * p_fifo = &pp_inputs[k]->mix_fifo;
+            ptrdiff_t i_available_words;
+            aout_buffer_t * p_old_buffer;
 
-                i_nb_words -= i_available_words;
-                p_out += i_available_words;
+            for ( ; ; )
+            {
+                i_available_words =
+                    ((const float *)p_fifo->p_first->p_buffer - pp_in[k])
+                     + p_fifo->p_first->i_nb_samples * i_nb_channels;
+                if ( i_available_words > 0 ) break;
 
                 /* Next buffer */
-                p_old_buffer = aout_FifoPop( p_aout, &p_input->fifo );
+                p_old_buffer = aout_FifoPop( p_aout, p_fifo );
                 aout_BufferFree( p_old_buffer );
-                if ( p_input->fifo.p_first == NULL )
+                if ( p_fifo->p_first == NULL )
                 {
                     msg_Err( p_aout, "internal amix error" );
                     return;
                 }
-                p_in = (float *)p_input->fifo.p_first->p_buffer;
-            }
-            else
-            {
-                if ( i_nb_words > 0 )
-                {
-                    if ( !i_input )
-                    {
-                        ScaleWords( p_out, p_in, i_nb_words, i_nb_inputs,
-                                    f_multiplier );
-                    }
-                    else
-                    {
-                        MeanWords( p_out, p_in, i_nb_words, i_nb_inputs,
-                                   f_multiplier );
-                    }
-                }
-                p_input->p_first_byte_to_mix = (void *)(p_in
-                                            + i_nb_words);
-                break;
+                pp_in[k] = (const float *)p_fifo->p_first->p_buffer;
             }
+
+            if ( (size_t)i_available_words < i_words )
+                i_words = i_available_words;
         }
+
+        p_aout->mixer.p_sys->pf_mix( p_out, pp_in, pf_multiplier,
+                                     i_nb_mixed, i_words );
+
+        for ( k = 0; k < i_nb_mixed; k++ )
+            pp_in[k] += i_words;
+        p_out += i_words;
+        i_nb_words -= i_words;
     }
-}
 
+    for ( k = 0; k < i_nb_mixed; k++ )
+        pp_inputs[k]->p_first_byte_to_mix = (uint8_t *)pp_in[k];
+}
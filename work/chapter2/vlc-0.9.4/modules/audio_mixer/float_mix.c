@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * float_mix.c: weighted sum of float32 inputs
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "float_mix.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define FLOAT_MIX_SSE2 1
+#endif
+
+/*****************************************************************************
+ * C version
+ *****************************************************************************
+ * The inputs are summed by 4, then one by one, the first group setting the
+ * output and the next ones adding to it.
+ *****************************************************************************/
+static void Mix4C( float *p_out, const float *const *pp_in,
+                   const float *pf_gain, size_t i_words, bool b_add )
+{
+    const float *p_a = pp_in[0], *p_b = pp_in[1],
+                *p_c = pp_in[2], *p_d = pp_in[3];
+    const float f_a = pf_gain[0], f_b = pf_gain[1],
+                f_c = pf_gain[2], f_d = pf_gain[3];
+
+    for( size_t i = 0; i < i_words; i++ )
+    {
+        const float f_sum = ( p_a[i] * f_a + p_b[i] * f_b )
+                          + ( p_c[i] * f_c + p_d[i] * f_d );
+
+        p_out[i] = b_add ? p_out[i] + f_sum : f_sum;
+    }
+}
+
+static void Mix1C( float *p_out, const float *p_in, float f_gain,
+                   size_t i_words, bool b_add )
+{
+    for( size_t i = 0; i < i_words; i++ )
+        p_out[i] = b_add ? p_out[i] + p_in[i] * f_gain : p_in[i] * f_gain;
+}
+
+static void MixC( float *p_out, const float *const *pp_in,
+                  const float *pf_gain, unsigned i_inputs, size_t i_words )
+{
+    unsigned k = 0;
+
+    for( ; k + 4 <= i_inputs; k += 4 )
+        Mix4C( p_out, &pp_in[k], &pf_gain[k], i_words, k > 0 );
+    for( ; k < i_inputs; k++ )
+        Mix1C( p_out, pp_in[k], pf_gain[k], i_words, k > 0 );
+}
+
+/*****************************************************************************
+ * SSE2 version
+ *****************************************************************************/
+#if defined(FLOAT_MIX_SSE2)
+#define SSE2_KERNEL static __attribute__((__target__("sse2")))
+
+SSE2_KERNEL
+void Mix4SSE2( float *p_out, const float *const *pp_in,
+               const float *pf_gain, size_t i_words, bool b_add )
+{
+    const float *p_a = pp_in[0], *p_b = pp_in[1],
+                *p_c = pp_in[2], *p_d = pp_in[3];
+    const __m128 a = _mm_set1_ps( pf_gain[0] ), b = _mm_set1_ps( pf_gain[1] ),
+                 c = _mm_set1_ps( pf_gain[2] ), d = _mm_set1_ps( pf_gain[3] );
+    size_t i = 0;
+
+    for( ; i + 4 <= i_words; i += 4 )
+    {
+        __m128 sum = _mm_add_ps(
+            _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &p_a[i] ), a ),
+                        _mm_mul_ps( _mm_loadu_ps( &p_b[i] ), b ) ),
+            _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &p_c[i] ), c ),
+                        _mm_mul_ps( _mm_loadu_ps( &p_d[i] ), d ) ) );
+
+        if( b_add )
+            sum = _mm_add_ps( _mm_loadu_ps( &p_out[i] ), sum );
+        _mm_storeu_ps( &p_out[i], sum );
+    }
+
+    if( i < i_words )
+    {
+        const float *pp_tail[4] = { &p_a[i], &p_b[i], &p_c[i], &p_d[i] };
+
+        Mix4C( &p_out[i], pp_tail, pf_gain, i_words - i, b_add );
+    }
+}
+
+SSE2_KERNEL
+void Mix1SSE2( float *p_out, const float *p_in, float f_gain,
+               size_t i_words, bool b_add )
+{
+    const __m128 g = _mm_set1_ps( f_gain );
+    size_t i = 0;
+
+    for( ; i + 4 <= i_words; i += 4 )
+    {
+        __m128 v = _mm_mul_ps( _mm_loadu_ps( &p_in[i] ), g );
+
+        if( b_add )
+            v = _mm_add_ps( _mm_loadu_ps( &p_out[i] ), v );
+        _mm_storeu_ps( &p_out[i], v );
+    }
+    Mix1C( &p_out[i], &p_in[i], f_gain, i_words - i, b_add );
+}
+
+SSE2_KERNEL
+void MixSSE2( float *p_out, const float *const *pp_in,
+              const float *pf_gain, unsigned i_inputs, size_t i_words )
+{
+    unsigned k = 0;
+
+    for( ; k + 4 <= i_inputs; k += 4 )
+        Mix4SSE2( p_out, &pp_in[k], &pf_gain[k], i_words, k > 0 );
+    for( ; k < i_inputs; k++ )
+        Mix1SSE2( p_out, pp_in[k], pf_gain[k], i_words, k > 0 );
+}
+#endif
+
+float_mix_t float_mix_Get( unsigned i_cpu )
+{
+#if defined(FLOAT_MIX_SSE2)
+    if( i_cpu & CPU_CAPABILITY_SSE2 )
+        return MixSSE2;
+#endif
+    (void)i_cpu;
+    return MixC;
+}
@@ -0,0 +1,37 @@
+/*****************************************************************************
+ * float_mix.h: weighted sum of float32 inputs
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _FLOAT_MIX_H_
+#define _FLOAT_MIX_H_ 1
+
+/*
+ * p_out[i] = sum of pp_in[k][i] * pf_gain[k] for the i_inputs inputs, on
+ * i_words words. The output is written once for up to 4 inputs at a time,
+ * rather than once per input.
+ */
+typedef void (*float_mix_t)( float *p_out, const float *const *pp_in,
+                             const float *pf_gain, unsigned i_inputs,
+                             size_t i_words );
+
+/* The fastest version for the given CPU_CAPABILITY_* flags */
+float_mix_t float_mix_Get( unsigned i_cpu );
+
+#endif
@@ -82,7 +82,7 @@ static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
     {
         p_input = p_aout->pp_inputs[++i];
     }
-    aout_FifoPop( p_aout, &p_input->fifo );
+    aout_FifoPop( p_aout, &p_input->mix_fifo );
 
     /* Empty other FIFOs to avoid a memory leak. */
     for ( i++; i < p_aout->i_nb_inputs; i++ )
@@ -92,7 +92,7 @@ static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
 
         p_input = p_aout->pp_inputs[i];
         if ( p_input->b_error ) continue;
-        p_fifo = &p_input->fifo;
+        p_fifo = &p_input->mix_fifo;
         p_deleted = p_fifo->p_first;
         while ( p_deleted != NULL )
         {
@@ -94,11 +94,11 @@ static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
 
     for ( ; ; )
     {
-        ptrdiff_t i_available_bytes = (p_input->fifo.p_first->p_buffer
+        ptrdiff_t i_available_bytes = (p_input->mix_fifo.p_first->p_buffer
                                         - p_in)
-                                        + p_input->fifo.p_first->i_nb_samples
-                                           * sizeof(int32_t)
-                                           * i_nb_channels;
+                                    + p_input->mix_fifo.p_first->i_nb_samples
+                                       * sizeof(int32_t)
+                                       * i_nb_channels;
 
         if ( i_available_bytes < i_nb_bytes )
         {
@@ -109,14 +109,14 @@ static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
             p_out += i_available_bytes;
 
             /* Next buffer */
-            p_old_buffer = aout_FifoPop( p_aout, &p_input->fifo );
+            p_old_buffer = aout_FifoPop( p_aout, &p_input->mix_fifo );
             aout_BufferFree( p_old_buffer );
-            if ( p_input->fifo.p_first == NULL )
+            if ( p_input->mix_fifo.p_first == NULL )
             {
                 msg_Err( p_aout, "internal amix error" );
                 return;
             }
-            p_in = p_input->fifo.p_first->p_buffer;
+            p_in = p_input->mix_fifo.p_first->p_buffer;
         }
         else
         {
@@ -134,7 +134,7 @@ static void DoWork( aout_instance_t * p_aout, aout_buffer_t * p_buffer )
 
         p_input = p_aout->pp_inputs[i];
         if ( p_input->b_error ) continue;
-        p_fifo = &p_input->fifo;
+        p_fifo = &p_input->mix_fifo;
         p_deleted = p_fifo->p_first;
         while ( p_deleted != NULL )
         {
@@ -299,13 +299,16 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     if( val.b_bool && (p_sys->p_codec->capabilities & CODEC_CAP_DR1) &&
         /* Apparently direct rendering doesn't work with YUV422P */
         p_sys->p_context->pix_fmt != PIX_FMT_YUV422P &&
-        /* H264 uses too many reference frames */
-        p_sys->i_codec_id != CODEC_ID_H264 &&
         !p_sys->p_context->debug_mv )
     {
         /* Some codecs set pix_fmt only after the 1st frame has been decoded,
          * so we need to do another check in ffmpeg_GetFrameBuf() */
         p_sys->b_direct_rendering = 1;
+
+        /* Reference pictures stay linked in the video output heap: H264
+         * may keep up to 16 of them, the other codecs 2 */
+        p_dec->i_extra_picture_buffers =
+            p_sys->i_codec_id == CODEC_ID_H264 ? 16 + 1 : 2;
     }
 
     /* ffmpeg doesn't properly release old pictures when frames are skipped */
@@ -95,6 +95,56 @@ int  ArtCallback( httpd_handler_sys_t *p_args,
                           char *psz_remote_addr, char *psz_remote_host,
                           uint8_t **pp_data, int *pi_data );
 
+/*****************************************************************************
+ * Playlist changes
+ *****************************************************************************/
+static const char *const ppsz_playlist_vars[] =
+{
+    "intf-change", "item-change", "item-deleted", "item-append",
+    "playlist-current", NULL
+};
+
+static int PlaylistChange( vlc_object_t *p_this, char const *psz_var,
+                           vlc_value_t oldval, vlc_value_t newval,
+                           void *p_data )
+{
+    intf_sys_t *p_sys = ((intf_thread_t *)p_data)->p_sys;
+    VLC_UNUSED(p_this); VLC_UNUSED(psz_var);
+    VLC_UNUSED(oldval); VLC_UNUSED(newval);
+
+    vlc_mutex_lock( &p_sys->serial_lock );
+    p_sys->i_playlist_serial++;
+    vlc_mutex_unlock( &p_sys->serial_lock );
+    return VLC_SUCCESS;
+}
+
+static void PlaylistWatch( intf_thread_t *p_intf, bool b_watch )
+{
+    playlist_t *p_playlist = p_intf->p_sys->p_playlist;
+    int i;
+
+    for( i = 0; ppsz_playlist_vars[i] != NULL; i++ )
+    {
+        if( b_watch )
+            var_AddCallback( p_playlist, ppsz_playlist_vars[i],
+                             PlaylistChange, p_intf );
+        else
+            var_DelCallback( p_playlist, ppsz_playlist_vars[i],
+                             PlaylistChange, p_intf );
+    }
+}
+
+int PlaylistSerial( intf_thread_t *p_intf )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    int i_serial;
+
+    vlc_mutex_lock( &p_sys->serial_lock );
+    i_serial = p_sys->i_playlist_serial;
+    vlc_mutex_unlock( &p_sys->serial_lock );
+    return i_serial;
+}
+
 /*****************************************************************************
  * Activate: initialize and create stuff
  *****************************************************************************/
@@ -135,6 +185,15 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_port     = i_port;
     p_sys->p_art_handler = NULL;
 
+    /* compiled pages, and what tells when the playlist pages are stale */
+    p_sys->i_templates = 0;
+    p_sys->pp_templates = NULL;
+    p_sys->p_playlist_set = NULL;
+    p_sys->i_playlist_set_refs = 0;
+    p_sys->i_playlist_serial = 0;
+    vlc_mutex_init( &p_sys->serial_lock );
+    PlaylistWatch( p_intf, true );
+
     /* determine file handler associations */
     p_sys->i_handlers = 0;
     p_sys->pp_handlers = NULL;
@@ -210,6 +269,8 @@ static int Open( vlc_object_t *p_this )
     if( p_sys->p_httpd_host == NULL )
     {
         msg_Err( p_intf, "cannot listen on %s:%d", psz_address, i_port );
+        PlaylistWatch( p_intf, false );
+        vlc_mutex_destroy( &p_sys->serial_lock );
         pl_Release( p_this );
         free( p_sys->psz_address );
         free( p_sys );
@@ -283,6 +344,8 @@ failed:
     free( psz_src );
     free( p_sys->pp_files );
     httpd_HostDelete( p_sys->p_httpd_host );
+    PlaylistWatch( p_intf, false );
+    vlc_mutex_destroy( &p_sys->serial_lock );
     free( p_sys->psz_address );
     free( p_sys );
     pl_Release( p_this );
@@ -334,6 +397,11 @@ static void Close ( vlc_object_t *p_this )
     if( p_sys->p_art_handler )
         httpd_HandlerDelete( p_sys->p_art_handler );
     httpd_HostDelete( p_sys->p_httpd_host );
+    PlaylistWatch( p_intf, false );
+    vlc_mutex_destroy( &p_sys->serial_lock );
+    TemplateCacheClean( p_intf );
+    if( p_sys->p_playlist_set )
+        mvar_Delete( p_sys->p_playlist_set );
     free( p_sys->psz_address );
     free( p_sys );
     pl_Release( p_this );
@@ -366,95 +434,84 @@ static void Callback404( httpd_file_sys_t *p_args, char **pp_data,
     *pi_data = strlen( *pp_data );
 }
 
-static void ParseExecute( httpd_file_sys_t *p_args, char *p_buffer,
-                          int i_buffer, char *p_request,
-                          char **pp_data, int *pi_data )
+void RequestVars( httpd_file_sys_t *p_args, int i_vars )
 {
     intf_sys_t *p_sys = p_args->p_intf->p_sys;
-    int i_request = p_request != NULL ? strlen( p_request ) : 0;
-    char *dst;
     vlc_value_t val;
-    char position[4]; /* percentage */
-    char time[12]; /* in seconds */
-    char length[12]; /* in seconds */
-    audio_volume_t i_volume;
-    char volume[5];
-    const char *state;
-    char stats[20];
 
-    assert( p_sys->p_input == NULL );
-    /* FIXME: proper locking anyone? */
-    p_sys->p_input = p_sys->p_playlist->p_input;
-    if( p_sys->p_input )
+    i_vars &= ~p_args->i_vars;
+    p_args->i_vars |= i_vars;
+
+    if( i_vars & HTTP_VARS_INPUT )
     {
-        vlc_object_yield( p_sys->p_input );
-        var_Get( p_sys->p_input, "position", &val);
-        sprintf( position, "%d" , (int)((val.f_float) * 100.0));
-        var_Get( p_sys->p_input, "time", &val);
-        sprintf( time, "%"PRIi64, (int64_t)val.i_time / INT64_C(1000000) );
-        var_Get( p_sys->p_input, "length", &val);
-        sprintf( length, "%"PRIi64, (int64_t)val.i_time / INT64_C(1000000) );
-
-        var_Get( p_sys->p_input, "state", &val );
-        if( val.i_int == PLAYING_S )
-        {
-            state = "playing";
-        }
-        else if( val.i_int == OPENING_S )
-        {
-            state = "opening/connecting";
-        }
-        else if( val.i_int == BUFFERING_S )
-        {
-            state = "buffering";
-        }
-        else if( val.i_int == PAUSE_S )
+        char position[4]; /* percentage */
+        char time[12]; /* in seconds */
+        char length[12]; /* in seconds */
+        const char *state;
+
+        if( p_sys->p_input )
         {
-            state = "paused";
+            var_Get( p_sys->p_input, "position", &val);
+            sprintf( position, "%d" , (int)((val.f_float) * 100.0));
+            var_Get( p_sys->p_input, "time", &val);
+            sprintf( time, "%"PRIi64, (int64_t)val.i_time / INT64_C(1000000) );
+            var_Get( p_sys->p_input, "length", &val);
+            sprintf( length, "%"PRIi64, (int64_t)val.i_time / INT64_C(1000000) );
+
+            var_Get( p_sys->p_input, "state", &val );
+            if( val.i_int == PLAYING_S )
+            {
+                state = "playing";
+            }
+            else if( val.i_int == OPENING_S )
+            {
+                state = "opening/connecting";
+            }
+            else if( val.i_int == BUFFERING_S )
+            {
+                state = "buffering";
+            }
+            else if( val.i_int == PAUSE_S )
+            {
+                state = "paused";
+            }
+            else
+            {
+                state = "stop";
+            }
         }
         else
         {
+            sprintf( position, "%d", 0 );
+            sprintf( time, "%d", 0 );
+            sprintf( length, "%d", 0 );
             state = "stop";
         }
-    }
-    else
-    {
-        sprintf( position, "%d", 0 );
-        sprintf( time, "%d", 0 );
-        sprintf( length, "%d", 0 );
-        state = "stop";
+
+        mvar_AppendNewVar( p_args->vars, "stream_position", position );
+        mvar_AppendNewVar( p_args->vars, "stream_time", time );
+        mvar_AppendNewVar( p_args->vars, "stream_length", length );
+        mvar_AppendNewVar( p_args->vars, "stream_state", state );
     }
 
-    aout_VolumeGet( p_args->p_intf, &i_volume );
-    sprintf( volume, "%d", (int)i_volume );
+    if( i_vars & HTTP_VARS_VOLUME )
+    {
+        audio_volume_t i_volume;
+        char volume[5];
 
-    p_args->vars = mvar_New( "variables", "" );
-    mvar_AppendNewVar( p_args->vars, "url_param",
-                           i_request > 0 ? "1" : "0" );
-    mvar_AppendNewVar( p_args->vars, "url_value", p_request );
-    mvar_AppendNewVar( p_args->vars, "version", VLC_Version() );
-    mvar_AppendNewVar( p_args->vars, "copyright", COPYRIGHT_MESSAGE );
-    mvar_AppendNewVar( p_args->vars, "vlc_compile_by", VLC_CompileBy() );
-    mvar_AppendNewVar( p_args->vars, "vlc_compile_host",
-                           VLC_CompileHost() );
-    mvar_AppendNewVar( p_args->vars, "vlc_compile_domain",
-                           VLC_CompileDomain() );
-    mvar_AppendNewVar( p_args->vars, "vlc_compiler", VLC_Compiler() );
-    mvar_AppendNewVar( p_args->vars, "vlc_changeset", VLC_Changeset() );
-    mvar_AppendNewVar( p_args->vars, "stream_position", position );
-    mvar_AppendNewVar( p_args->vars, "stream_time", time );
-    mvar_AppendNewVar( p_args->vars, "stream_length", length );
-    mvar_AppendNewVar( p_args->vars, "volume", volume );
-    mvar_AppendNewVar( p_args->vars, "stream_state", state );
-    mvar_AppendNewVar( p_args->vars, "charset", "UTF-8" );
+        aout_VolumeGet( p_args->p_intf, &i_volume );
+        sprintf( volume, "%d", (int)i_volume );
+        mvar_AppendNewVar( p_args->vars, "volume", volume );
+    }
 
     /* Stats */
-    if( p_sys->p_input )
+    if( ( i_vars & HTTP_VARS_STATS ) && p_sys->p_input )
     {
         /* FIXME: Workarround a stupid assert in input_GetItem */
         input_item_t *p_item = p_sys->p_input && p_sys->p_input->p
                                ? input_GetItem( p_sys->p_input )
                                : NULL;
+        char stats[20];
 
         if( p_item )
         {
@@ -481,16 +538,57 @@ static void ParseExecute( httpd_file_sys_t *p_args, char *p_buffer,
             vlc_mutex_unlock( &p_item->p_stats->lock );
         }
     }
+}
+
+static void ParseExecute( httpd_file_sys_t *p_args,
+                          http_template_t *p_template, char *p_request,
+                          char **pp_data, int *pi_data )
+{
+    intf_sys_t *p_sys = p_args->p_intf->p_sys;
+    int i_request = p_request != NULL ? strlen( p_request ) : 0;
+    int i_serial;
+    char *dst;
+
+    /* A page only depending on the playlist is the same until it changes */
+    if( i_request == 0
+     && TemplateGetOutput( p_args->p_intf, p_template, pp_data, pi_data ) )
+        return;
+    i_serial = PlaylistSerial( p_args->p_intf );
+
+    assert( p_sys->p_input == NULL );
+    /* FIXME: proper locking anyone? */
+    p_sys->p_input = p_sys->p_playlist->p_input;
+    if( p_sys->p_input )
+        vlc_object_yield( p_sys->p_input );
+
+    p_args->vars = mvar_New( "variables", "" );
+    mvar_AppendNewVar( p_args->vars, "url_param",
+                           i_request > 0 ? "1" : "0" );
+    mvar_AppendNewVar( p_args->vars, "url_value", p_request );
+    mvar_AppendNewVar( p_args->vars, "version", VLC_Version() );
+    mvar_AppendNewVar( p_args->vars, "copyright", COPYRIGHT_MESSAGE );
+    mvar_AppendNewVar( p_args->vars, "vlc_compile_by", VLC_CompileBy() );
+    mvar_AppendNewVar( p_args->vars, "vlc_compile_host",
+                           VLC_CompileHost() );
+    mvar_AppendNewVar( p_args->vars, "vlc_compile_domain",
+                           VLC_CompileDomain() );
+    mvar_AppendNewVar( p_args->vars, "vlc_compiler", VLC_Compiler() );
+    mvar_AppendNewVar( p_args->vars, "vlc_changeset", VLC_Changeset() );
+    mvar_AppendNewVar( p_args->vars, "charset", "UTF-8" );
+
+    /* The input, volume and stats variables, if the page uses them */
+    p_args->i_vars = 0;
+    RequestVars( p_args, TemplateVars( p_template ) );
 
     SSInit( &p_args->stack );
 
     /* allocate output */
-    *pi_data = i_buffer + 1000;
+    *pi_data = 4096;
     dst = *pp_data = malloc( *pi_data );
 
     /* we parse executing all  <vlc /> macros */
-    Execute( p_args, p_request, i_request, pp_data, pi_data, &dst,
-                 &p_buffer[0], &p_buffer[i_buffer] );
+    TemplateExecute( p_args, p_template, p_request, i_request,
+                     pp_data, pi_data, &dst );
 
     *dst     = '\0';
     *pi_data = dst - *pp_data;
@@ -502,6 +600,9 @@ static void ParseExecute( httpd_file_sys_t *p_args, char *p_buffer,
     }
     SSClean( &p_args->stack );
     mvar_Delete( p_args->vars );
+
+    if( i_request == 0 )
+        TemplateSetOutput( p_template, *pp_data, *pi_data, i_serial );
 }
 
 int  HttpCallback( httpd_file_sys_t *p_args,
@@ -514,29 +615,25 @@ int  HttpCallback( httpd_file_sys_t *p_args,
     char **pp_data = (char **)_pp_data;
     FILE *f;
 
-    if( ( f = utf8_fopen( p_args->file, "r" ) ) == NULL )
+    if( p_args->b_html )
     {
-        Callback404( p_args, pp_data, pi_data );
+        /* Compiled when first requested, and again if the file changes */
+        http_template_t *p_template = TemplateGet( p_args->p_intf,
+                                                   p_args->file, true );
+        if( p_template == NULL )
+            Callback404( p_args, pp_data, pi_data );
+        else
+            ParseExecute( p_args, p_template, p_request, pp_data, pi_data );
         return VLC_SUCCESS;
     }
 
-    if( !p_args->b_html )
-    {
-        FileLoad( f, pp_data, pi_data );
-    }
-    else
+    if( ( f = utf8_fopen( p_args->file, "r" ) ) == NULL )
     {
-        int  i_buffer;
-        char *p_buffer;
-
-        /* first we load in a temporary buffer */
-        FileLoad( f, &p_buffer, &i_buffer );
-
-        ParseExecute( p_args, p_buffer, i_buffer, p_request, pp_data, pi_data );
-
-        free( p_buffer );
+        Callback404( p_args, pp_data, pi_data );
+        return VLC_SUCCESS;
     }
 
+    FileLoad( f, pp_data, pi_data );
     fclose( f );
 
     return VLC_SUCCESS;
@@ -765,10 +862,17 @@ int  HandlerCallback( httpd_handler_sys_t *p_args,
     }
     else
     {
-        ParseExecute( (httpd_file_sys_t *)p_args, p_buffer, i_buffer,
-                      p_request, pp_data, pi_data );
+        http_template_t *p_template = TemplateNew( p_buffer, i_buffer );
 
         free( p_buffer );
+        if( p_template == NULL )
+        {
+            Callback404( (httpd_file_sys_t *)p_args, pp_data, pi_data );
+            return VLC_SUCCESS;
+        }
+        ParseExecute( (httpd_file_sys_t *)p_args, p_template,
+                      p_request, pp_data, pi_data );
+        TemplateDelete( p_template );
     }
 
     return VLC_SUCCESS;
@@ -206,6 +206,11 @@ mvar_t *mvar_ObjectSetNew( intf_thread_t *p_intf, char *name, const char *arg );
 /** This function creates a set variable with the contents of the playlist */
 mvar_t *mvar_PlaylistSetNew( intf_thread_t *p_intf, char *name,
                                  playlist_t *p_pl );
+/** This function returns the contents of the playlist, from a set kept until
+ * the playlist changes. It must not be modified, and must be given back with
+ * mvar_PlaylistSetRelease() */
+mvar_t *mvar_PlaylistSetGet( intf_thread_t *p_intf );
+void mvar_PlaylistSetRelease( intf_thread_t *p_intf, mvar_t * );
 /** This function creates a set variable with the contents of the Stream
  * and media info box */
 mvar_t *mvar_InfoSetNew( char *name, input_thread_t *p_input );
@@ -298,6 +303,44 @@ void Execute( httpd_file_sys_t *p_args,
                   char **pp_dst,
                   char *_src, char *_end );
 
+/** \struct http_template_t
+ * A page compiled into a list of text and macro instructions, so that the
+ * macros are parsed and their blocks matched only once.
+ */
+typedef struct http_template_t http_template_t;
+
+/** Request variables a template may use, to be set only if needed */
+#define HTTP_VARS_INPUT  0x01   ///< stream_position, stream_time, ...
+#define HTTP_VARS_VOLUME 0x02   ///< volume
+#define HTTP_VARS_STATS  0x04   ///< read_bytes, input_bitrate, ...
+
+/** This function compiles a page held in memory */
+http_template_t *TemplateNew( const char *p_data, int i_data );
+/** This function deletes a template */
+void TemplateDelete( http_template_t * );
+/** This function returns the compiled page of a file, from a cache of the
+ * interface: it is compiled again only if the file changed. The template
+ * is valid until the next call for the same file. */
+http_template_t *TemplateGet( intf_thread_t *p_intf, const char *psz_file,
+                              bool b_utf8 );
+/** This function empties the cache of TemplateGet() */
+void TemplateCacheClean( intf_thread_t *p_intf );
+/** This function executes a template, like Execute() does with a page */
+void TemplateExecute( httpd_file_sys_t *p_args, http_template_t *,
+                      char *p_request, int i_request,
+                      char **pp_data, int *pi_data, char **pp_dst );
+/** This function returns the HTTP_VARS_* used by a template */
+int TemplateVars( const http_template_t * );
+/** This function returns the output of a template kept by
+ * TemplateSetOutput(), if it only depends on the playlist and the playlist
+ * did not change since. */
+bool TemplateGetOutput( intf_thread_t *p_intf, http_template_t *,
+                        char **pp_data, int *pi_data );
+/** This function keeps the output of a template that only depends on the
+ * playlist, as of the given playlist serial number */
+void TemplateSetOutput( http_template_t *, const char *p_data, int i_data,
+                        int i_serial );
+
 /**@}*/
 
 /**
@@ -321,6 +364,7 @@ struct httpd_file_sys_t
     /* inited for each access */
     rpn_stack_t   stack;
     mvar_t        *vars;
+    int           i_vars; /* HTTP_VARS_* already in vars */
 };
 
 /** \struct
@@ -366,8 +410,27 @@ struct intf_sys_t
 
     char                *psz_address;
     unsigned short      i_port;
+
+    /* Compiled pages. Like the playlist set, they are only used by the
+     * httpd host thread. */
+    int                 i_templates;
+    http_template_t     **pp_templates;
+
+    /* Playlist changes, and the last set of the playlist */
+    vlc_mutex_t         serial_lock;
+    int                 i_playlist_serial;
+    mvar_t              *p_playlist_set;
+    int                 i_playlist_set_serial;
+    int                 i_playlist_set_refs;
 };
 
+/** This function returns the serial number of the playlist, that changes
+ * each time the playlist does */
+int PlaylistSerial( intf_thread_t *p_intf );
+/** This function adds to p_args->vars the request variables of the
+ * HTTP_VARS_* groups it does not have yet */
+void RequestVars( httpd_file_sys_t *p_args, int i_vars );
+
 /** This function is the main HTTPD Callback used by the HTTP Interface */
 int HttpCallback( httpd_file_sys_t *p_args,
                       httpd_file_t *,
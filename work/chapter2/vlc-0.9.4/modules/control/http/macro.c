@@ -32,24 +32,19 @@
 
 static int MacroParse( macro_t *m, char *psz_src )
 {
-    char *dup = strdup( (char *)psz_src );
-    char *src = dup;
+    char *src = psz_src;
     char *p;
-    int     i_skip;
 
 #define EXTRACT( name, l ) \
         src += l;    \
         p = strchr( src, '"' );             \
-        if( p )                             \
-        {                                   \
-            *p++ = '\0';                    \
-        }                                   \
-        m->name = strdup( src );            \
         if( !p )                            \
         {                                   \
+            m->name = strdup( src );        \
             break;                          \
         }                                   \
-        src = p;
+        m->name = strndup( src, p - src );  \
+        src = p + 1;
 
     /* init m */
     m->id = NULL;
@@ -103,10 +98,8 @@ static int MacroParse( macro_t *m, char *psz_src )
     {
         m->param2 = strdup( "" );
     }
-    i_skip = src - dup;
 
-    free( dup );
-    return i_skip;
+    return src - psz_src;
 #undef EXTRACT
 }
 
@@ -136,7 +129,7 @@ static int StrToMacroType( const char *name )
 }
 
 static void MacroDo( httpd_file_sys_t *p_args,
-                     macro_t *m,
+                     macro_t *m, int i_type,
                      char *p_request, int i_request,
                      char **pp_data,  int *pi_data,
                      char **pp_dst )
@@ -170,7 +163,7 @@ static void MacroDo( httpd_file_sys_t *p_args,
         } \
     }
 
-    switch( StrToMacroType( m->id ) )
+    switch( i_type )
     {
         case MVLC_CONTROL:
             if( i_request <= 0 )
@@ -810,321 +803,593 @@ static void MacroDo( httpd_file_sys_t *p_args,
 #undef PRINT
 #undef ALLOC
 }
+/****************************************************************************
+ * Templates: a page is parsed once into a list of instructions, text or
+ * macro, where if and foreach know where their else and end are.
+ ****************************************************************************/
+#define TEMPLATE_TEXT (-1)
+
+typedef struct
+{
+    int     i_type;     /* MVLC_* or TEMPLATE_TEXT */
+    macro_t m;
+    const char *p_text; /* TEMPLATE_TEXT */
+    int     i_text;
+    int     i_else;     /* if: the matching else, or -1 */
+    int     i_end;      /* if, foreach: the matching end, or -1 */
+} template_op_t;
+
+struct http_template_t
+{
+    char          *p_data;  /* a copy of the page, for the text instructions */
+    int            i_ops;
+    template_op_t *p_ops;
+
+    int            i_vars;  /* HTTP_VARS_* */
+    bool           b_static;/* output only depends on the playlist */
+
+    /* TemplateGet() */
+    char          *psz_file;
+    time_t         i_mtime;
+    int64_t        i_size;
+
+    /* TemplateSetOutput() */
+    char          *p_output;
+    int            i_output;
+    int            i_output_serial;
+};
+
+/* The request variables, and the groups setting them */
+static const struct
+{
+    const char *psz_name;
+    int        i_vars;
+} p_request_vars[] =
+{
+    { "stream_",            HTTP_VARS_INPUT },
+    { "volume",             HTTP_VARS_VOLUME },
+    { "read_",              HTTP_VARS_STATS },
+    { "input_bitrate",      HTTP_VARS_STATS },
+    { "demux_",             HTTP_VARS_STATS },
+    { "decoded_",           HTTP_VARS_STATS },
+    { "displayed_pictures", HTTP_VARS_STATS },
+    { "lost_",              HTTP_VARS_STATS },
+    { "played_abuffers",    HTTP_VARS_STATS },
+    { "sent_",              HTTP_VARS_STATS },
+    { "send_bitrate",       HTTP_VARS_STATS },
+    { NULL, 0 }
+};
+
+/* What else the output of a page may depend on, besides the playlist */
+static const char *const ppsz_dynamic[] =
+{
+    "vlc_", "playlist_", "services_discovery_", "vlm", "snapshot", "url_",
+    "realpath", NULL
+};
+
+static void TemplateCheckParam( http_template_t *t, const char *psz )
+{
+    int i;
+
+    if( psz == NULL )
+        return;
+    for( i = 0; p_request_vars[i].psz_name != NULL; i++ )
+    {
+        if( strstr( psz, p_request_vars[i].psz_name ) )
+        {
+            t->i_vars |= p_request_vars[i].i_vars;
+            t->b_static = false;
+        }
+    }
+    for( i = 0; ppsz_dynamic[i] != NULL; i++ )
+    {
+        if( strstr( psz, ppsz_dynamic[i] ) )
+            t->b_static = false;
+    }
+}
+
+static void TemplateCheck( http_template_t *t, const template_op_t *op )
+{
+    TemplateCheckParam( t, op->m.param1 );
+    TemplateCheckParam( t, op->m.param2 );
+
+    switch( op->i_type )
+    {
+        case MVLC_IF:
+        case MVLC_ELSE:
+        case MVLC_END:
+        case MVLC_RPN:
+        case MVLC_VALUE:
+            break;
+        case MVLC_FOREACH:
+            if( op->m.param2 == NULL
+             || ( strcmp( op->m.param2, "playlist" )
+               && strcmp( op->m.param2, "integer" ) ) )
+                t->b_static = false;
+            break;
+        default:
+            t->b_static = false;
+            break;
+    }
+}
 
-static
-char *MacroSearch( char *src, char *end, int i_mvlc, bool b_after )
+static template_op_t *TemplateAppend( http_template_t *t, int i_type )
 {
-    int     i_id;
-    int     i_level = 0;
+    template_op_t *op;
+
+    if( ( t->i_ops % 64 ) == 0 )
+    {
+        template_op_t *p_ops = realloc( t->p_ops,
+                                        ( t->i_ops + 64 ) * sizeof( *p_ops ) );
+        if( p_ops == NULL )
+            return NULL;
+        t->p_ops = p_ops;
+    }
+    op = &t->p_ops[t->i_ops++];
+    memset( op, 0, sizeof( *op ) );
+    op->i_type = i_type;
+    op->i_else = -1;
+    op->i_end = -1;
+    return op;
+}
 
+http_template_t *TemplateNew( const char *p_data, int i_data )
+{
+    http_template_t *t = calloc( 1, sizeof( *t ) );
+    int *pi_open = NULL;
+    int i_open = 0;
+    char *src, *end;
+
+    if( t == NULL )
+        return NULL;
+    t->b_static = true;
+    t->p_data = malloc( i_data + 1 );
+    if( t->p_data == NULL )
+    {
+        free( t );
+        return NULL;
+    }
+    memcpy( t->p_data, p_data, i_data );
+    t->p_data[i_data] = '\0';
+
+    src = t->p_data;
+    end = src + i_data;
     while( src < end )
     {
-        if( src + 4 < end  && !strncmp( (char *)src, "<vlc", 4 ) )
+        char *p = strstr( src, "<vlc" );
+        template_op_t *op;
+        int i_op = t->i_ops;
+
+        if( p == src )
         {
-            int i_skip;
             macro_t m;
 
-            i_skip = MacroParse( &m, src );
+            src += MacroParse( &m, src );
 
-            i_id = StrToMacroType( m.id );
+            op = TemplateAppend( t, StrToMacroType( m.id ) );
+            if( op == NULL )
+            {
+                MacroClean( &m );
+                break;
+            }
+            op->m = m;
+            TemplateCheck( t, op );
 
-            switch( i_id )
+            switch( op->i_type )
             {
                 case MVLC_IF:
                 case MVLC_FOREACH:
-                    i_level++;
+                    if( ( i_open % 16 ) == 0 )
+                        pi_open = realloc( pi_open,
+                                           ( i_open + 16 ) * sizeof( int ) );
+                    pi_open[i_open++] = i_op;
                     break;
-                case MVLC_END:
-                    i_level--;
+                case MVLC_ELSE:
+                    /* Otherwise it is output as an invalid macro */
+                    if( i_open > 0 )
+                    {
+                        template_op_t *p_if = &t->p_ops[pi_open[i_open - 1]];
+                        if( p_if->i_type == MVLC_IF && p_if->i_else < 0 )
+                            p_if->i_else = i_op;
+                    }
                     break;
-                default:
+                case MVLC_END:
+                    if( i_open > 0 )
+                        t->p_ops[pi_open[--i_open]].i_end = i_op;
                     break;
             }
+            continue;
+        }
 
-            MacroClean( &m );
+        op = TemplateAppend( t, TEMPLATE_TEXT );
+        if( op == NULL )
+            break;
+        op->p_text = src;
+        op->i_text = ( p == NULL || p > end ? end : p ) - src;
+        src += op->i_text;
+    }
+    free( pi_open );
 
-            if( ( i_mvlc == MVLC_END && i_level == -1 ) ||
-                ( i_mvlc != MVLC_END && i_level == 0 && i_mvlc == i_id ) )
-            {
-                return src + ( b_after ? i_skip : 0 );
-            }
-            else if( i_level < 0 )
-            {
-                return NULL;
-            }
+    return t;
+}
 
-            src += i_skip;
-        }
-        else
+void TemplateDelete( http_template_t *t )
+{
+    int i;
+
+    if( t == NULL )
+        return;
+    for( i = 0; i < t->i_ops; i++ )
+        MacroClean( &t->p_ops[i].m );
+    free( t->p_ops );
+    free( t->p_data );
+    free( t->psz_file );
+    free( t->p_output );
+    free( t );
+}
+
+http_template_t *TemplateGet( intf_thread_t *p_intf, const char *psz_file,
+                              bool b_utf8 )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    http_template_t *t;
+    struct stat st;
+    FILE *f;
+    char *p_buffer;
+    int i_buffer;
+    int i;
+
+    if( ( b_utf8 ? utf8_stat( psz_file, &st ) : stat( psz_file, &st ) ) )
+        return NULL;
+
+    for( i = 0; i < p_sys->i_templates; i++ )
+    {
+        t = p_sys->pp_templates[i];
+        if( !strcmp( t->psz_file, psz_file ) )
         {
-            src++;
+            if( t->i_mtime == st.st_mtime && t->i_size == st.st_size )
+                return t;
+            break;
         }
     }
 
-    return NULL;
+    f = b_utf8 ? utf8_fopen( psz_file, "r" ) : fopen( psz_file, "r" );
+    if( f == NULL )
+        return NULL;
+    FileLoad( f, &p_buffer, &i_buffer );
+    fclose( f );
+
+    t = TemplateNew( p_buffer, i_buffer );
+    free( p_buffer );
+    if( t == NULL )
+        return NULL;
+    t->psz_file = strdup( psz_file );
+    t->i_mtime = st.st_mtime;
+    t->i_size = st.st_size;
+
+    if( i < p_sys->i_templates )
+    {
+        msg_Dbg( p_intf, "file %s changed", psz_file );
+        TemplateDelete( p_sys->pp_templates[i] );
+        p_sys->pp_templates[i] = t;
+    }
+    else
+    {
+        TAB_APPEND( p_sys->i_templates, p_sys->pp_templates, t );
+    }
+    return t;
 }
 
-void Execute( httpd_file_sys_t *p_args,
-                     char *p_request, int i_request,
-                     char **pp_data, int *pi_data,
-                     char **pp_dst,
-                     char *_src, char *_end )
+void TemplateCacheClean( intf_thread_t *p_intf )
 {
-    intf_thread_t  *p_intf = p_args->p_intf;
+    intf_sys_t *p_sys = p_intf->p_sys;
+    int i;
 
-    char *src, *dup, *end;
-    char *dst = *pp_dst;
+    for( i = 0; i < p_sys->i_templates; i++ )
+        TemplateDelete( p_sys->pp_templates[i] );
+    free( p_sys->pp_templates );
+    p_sys->pp_templates = NULL;
+    p_sys->i_templates = 0;
+}
 
-    src = dup = malloc( _end - _src + 1 );
-    end = src +( _end - _src );
+int TemplateVars( const http_template_t *t )
+{
+    return t->i_vars;
+}
 
-    memcpy( src, _src, _end - _src );
-    *end = '\0';
+bool TemplateGetOutput( intf_thread_t *p_intf, http_template_t *t,
+                        char **pp_data, int *pi_data )
+{
+    if( t->p_output == NULL || t->i_output_serial != PlaylistSerial( p_intf ) )
+        return false;
+
+    *pp_data = malloc( t->i_output + 1 );
+    if( *pp_data == NULL )
+        return false;
+    memcpy( *pp_data, t->p_output, t->i_output + 1 );
+    *pi_data = t->i_output;
+    return true;
+}
 
-    /* we parse searching <vlc */
-    while( src < end )
-    {
-        char *p;
-        int i_copy;
+void TemplateSetOutput( http_template_t *t, const char *p_data, int i_data,
+                        int i_serial )
+{
+    /* Only the pages of the cache are kept long enough */
+    if( !t->b_static || t->psz_file == NULL )
+        return;
+
+    free( t->p_output );
+    t->p_output = malloc( i_data + 1 );
+    if( t->p_output == NULL )
+        return;
+    memcpy( t->p_output, p_data, i_data );
+    t->p_output[i_data] = '\0';
+    t->i_output = i_data;
+    t->i_output_serial = i_serial;
+}
 
-        p = (char *)strstr( (char *)src, "<vlc" );
-        if( p < end && p == src )
-        {
-            macro_t m;
+static void TemplateWrite( char **pp_data, int *pi_data, char **pp_dst,
+                           const char *p, int i )
+{
+    int i_index = *pp_dst - *pp_data;
 
-            src += MacroParse( &m, src );
+    if( i_index + i + 1 > *pi_data )
+    {
+        *pi_data = __MAX( 2 * *pi_data, i_index + i + 1 );
+        *pp_data = realloc( *pp_data, *pi_data );
+        *pp_dst = *pp_data + i_index;
+    }
+    memcpy( *pp_dst, p, i );
+    *pp_dst += i;
+}
 
-            //msg_Dbg( p_intf, "macro_id=%s", m.id );
+static void TemplateRun( httpd_file_sys_t *p_args, http_template_t *t,
+                         int i_first, int i_last,
+                         char *p_request, int i_request,
+                         char **pp_data, int *pi_data, char **pp_dst );
 
-            switch( StrToMacroType( m.id ) )
-            {
-                case MVLC_INCLUDE:
-                {
-                    FILE *f;
-                    int  i_buffer;
-                    char *p_buffer;
-                    char psz_file[MAX_DIR_SIZE];
-                    char *p;
-                    char sep;
+static void TemplateInclude( httpd_file_sys_t *p_args, const char *psz_name,
+                             char *p_request, int i_request,
+                             char **pp_data, int *pi_data, char **pp_dst )
+{
+    http_template_t *t;
+    char psz_file[MAX_DIR_SIZE];
+    char *p;
+    char sep;
 
 #if defined( WIN32 )
-                    sep = '\\';
+    sep = '\\';
 #else
-                    sep = '/';
+    sep = '/';
 #endif
 
-                    if( m.param1[0] != sep )
-                    {
-                        strcpy( psz_file, p_args->file );
-                        p = strrchr( psz_file, sep );
-                        if( p != NULL )
-                            strcpy( p + 1, m.param1 );
-                        else
-                            strcpy( psz_file, m.param1 );
-                    }
-                    else
-                    {
-                        strcpy( psz_file, m.param1 );
-                    }
+    if( psz_name[0] != sep )
+    {
+        strcpy( psz_file, p_args->file );
+        p = strrchr( psz_file, sep );
+        if( p != NULL )
+            strcpy( p + 1, psz_name );
+        else
+            strcpy( psz_file, psz_name );
+    }
+    else
+    {
+        strcpy( psz_file, psz_name );
+    }
 
-                    /* We hereby assume that psz_file is in the
-                     * local character encoding */
-                    if( ( f = fopen( psz_file, "r" ) ) == NULL )
-                    {
-                        msg_Warn( p_args->p_intf,
-                                  "unable to include file %s (%m)",
-                                  psz_file );
-                        break;
-                    }
+    /* We hereby assume that psz_file is in the local character encoding */
+    t = TemplateGet( p_args->p_intf, psz_file, false );
+    if( t == NULL )
+    {
+        msg_Warn( p_args->p_intf, "unable to include file %s (%m)",
+                  psz_file );
+        return;
+    }
 
-                    /* first we load in a temporary buffer */
-                    FileLoad( f, &p_buffer, &i_buffer );
+    RequestVars( p_args, t->i_vars );
+    TemplateRun( p_args, t, 0, t->i_ops, p_request, i_request,
+                 pp_data, pi_data, pp_dst );
+}
 
-                    /* we parse executing all  <vlc /> macros */
-                    Execute( p_args, p_request, i_request, pp_data, pi_data,
-                             &dst, &p_buffer[0], &p_buffer[i_buffer] );
-                    free( p_buffer );
-                    fclose(f);
-                    break;
-                }
-                case MVLC_IF:
-                {
-                    bool i_test;
-                    char    *endif;
+static void TemplateForeach( httpd_file_sys_t *p_args, http_template_t *t,
+                             int i_op,
+                             char *p_request, int i_request,
+                             char **pp_data, int *pi_data, char **pp_dst )
+{
+    intf_thread_t *p_intf = p_args->p_intf;
+    const template_op_t *op = &t->p_ops[i_op];
+    const char *psz_name = op->m.param1;
+    const char *psz_type = op->m.param2;
+    bool b_playlist = false;
+    mvar_t *index;
+    int    i_idx;
+    mvar_t *v;
+
+    if( psz_name == NULL || psz_type == NULL )
+    {
+        msg_Dbg( p_intf, "invalid foreach" );
+        return;
+    }
 
-                    EvaluateRPN( p_intf, p_args->vars, &p_args->stack, m.param1 );
-                    if( SSPopN( &p_args->stack, p_args->vars ) )
-                    {
-                        i_test = 1;
-                    }
-                    else
-                    {
-                        i_test = 0;
-                    }
-                    endif = MacroSearch( src, end, MVLC_END, true );
+    if( !strcmp( psz_type, "integer" ) )
+    {
+        char *arg = SSPop( &p_args->stack );
+        index = mvar_IntegerSetNew( psz_name, arg );
+        free( arg );
+    }
+    else if( !strcmp( psz_type, "directory" ) )
+    {
+        char *arg = SSPop( &p_args->stack );
+        index = mvar_FileSetNew( p_intf, (char *)psz_name, arg );
+        free( arg );
+    }
+    else if( !strcmp( psz_type, "object" ) )
+    {
+        char *arg = SSPop( &p_args->stack );
+        index = mvar_ObjectSetNew( p_intf, (char *)psz_name, arg );
+        free( arg );
+    }
+    else if( !strcmp( psz_type, "playlist" ) )
+    {
+        /* The fields get renamed below, the name of the set is unused */
+        index = mvar_PlaylistSetGet( p_intf );
+        b_playlist = true;
+    }
+    else if( !strcmp( psz_type, "information" ) )
+    {
+        index = mvar_InfoSetNew( (char *)psz_name, p_intf->p_sys->p_input );
+    }
+    else if( !strcmp( psz_type, "program" )
+              || !strcmp( psz_type, "title" )
+              || !strcmp( psz_type, "chapter" )
+              || !strcmp( psz_type, "audio-es" )
+              || !strcmp( psz_type, "video-es" )
+              || !strcmp( psz_type, "spu-es" ) )
+    {
+        index = mvar_InputVarSetNew( p_intf, (char *)psz_name,
+                                     p_intf->p_sys->p_input, psz_type );
+    }
+#ifdef ENABLE_VLM
+    else if( !strcmp( psz_type, "vlm" ) )
+    {
+        if( p_intf->p_sys->p_vlm == NULL )
+            p_intf->p_sys->p_vlm = vlm_New( p_intf );
+        index = mvar_VlmSetNew( (char *)psz_name, p_intf->p_sys->p_vlm );
+    }
+#endif
+    else if( ( v = mvar_GetVar( p_args->vars, psz_type ) ) )
+    {
+        index = mvar_Duplicate( v );
+    }
+    else
+    {
+        msg_Dbg( p_intf, "invalid index constructor (%s)", psz_type );
+        return;
+    }
 
-                    if( i_test == 0 )
-                    {
-                        char *start = MacroSearch( src, endif, MVLC_ELSE, true );
+    for( i_idx = 0; i_idx < index->i_field; i_idx++ )
+    {
+        mvar_t *f = mvar_Duplicate( index->field[i_idx] );
 
-                        if( start )
-                        {
-                            char *stop  = MacroSearch( start, endif, MVLC_END, false );
-                            if( stop )
-                            {
-                                Execute( p_args, p_request, i_request,
-                                         pp_data, pi_data, &dst, start, stop );
-                            }
-                        }
-                    }
-                    else if( i_test == 1 )
-                    {
-                        char *stop;
-                        if( ( stop = MacroSearch( src, endif, MVLC_ELSE, false ) ) == NULL )
-                        {
-                            stop = MacroSearch( src, endif, MVLC_END, false );
-                        }
-                        if( stop )
-                        {
-                            Execute( p_args, p_request, i_request,
-                                     pp_data, pi_data, &dst, src, stop );
-                        }
-                    }
+        free( f->name );
+        f->name = strdup( psz_name );
 
-                    src = endif;
-                    break;
-                }
-                case MVLC_FOREACH:
-                {
-                    char *endfor = MacroSearch( src, end, MVLC_END, true );
-                    char *start = src;
-                    char *stop = MacroSearch( src, end, MVLC_END, false );
+        mvar_PushVar( p_args->vars, f );
+        TemplateRun( p_args, t, i_op + 1, op->i_end, p_request, i_request,
+                     pp_data, pi_data, pp_dst );
+        mvar_RemoveVar( p_args->vars, f );
 
-                    if( stop )
-                    {
-                        mvar_t *index;
-                        int    i_idx;
-                        mvar_t *v;
-                        if( !strcmp( m.param2, "integer" ) )
-                        {
-                            char *arg = SSPop( &p_args->stack );
-                            index = mvar_IntegerSetNew( m.param1, arg );
-                            free( arg );
-                        }
-                        else if( !strcmp( m.param2, "directory" ) )
-                        {
-                            char *arg = SSPop( &p_args->stack );
-                            index = mvar_FileSetNew( p_intf, m.param1, arg );
-                            free( arg );
-                        }
-                        else if( !strcmp( m.param2, "object" ) )
-                        {
-                            char *arg = SSPop( &p_args->stack );
-                            index = mvar_ObjectSetNew( p_intf, m.param1, arg );
-                            free( arg );
-                        }
-                        else if( !strcmp( m.param2, "playlist" ) )
-                        {
-                            index = mvar_PlaylistSetNew( p_intf, m.param1,
-                                                    p_intf->p_sys->p_playlist );
-                        }
-                        else if( !strcmp( m.param2, "information" ) )
-                        {
-                            index = mvar_InfoSetNew( m.param1,
-                                                     p_intf->p_sys->p_input );
-                        }
-                        else if( !strcmp( m.param2, "program" )
-                                  || !strcmp( m.param2, "title" )
-                                  || !strcmp( m.param2, "chapter" )
-                                  || !strcmp( m.param2, "audio-es" )
-                                  || !strcmp( m.param2, "video-es" )
-                                  || !strcmp( m.param2, "spu-es" ) )
-                        {
-                            index = mvar_InputVarSetNew( p_intf, m.param1,
-                                                         p_intf->p_sys->p_input,
-                                                         m.param2 );
-                        }
-#ifdef ENABLE_VLM
-                        else if( !strcmp( m.param2, "vlm" ) )
-                        {
-                            if( p_intf->p_sys->p_vlm == NULL )
-                                p_intf->p_sys->p_vlm = vlm_New( p_intf );
-                            index = mvar_VlmSetNew( m.param1, p_intf->p_sys->p_vlm );
-                        }
-#endif
-#if 0
-                        else if( !strcmp( m.param2, "hosts" ) )
-                        {
-                            index = mvar_HttpdInfoSetNew( m.param1, p_intf->p_sys->p_httpd, HTTPD_GET_HOSTS );
-                        }
-                        else if( !strcmp( m.param2, "urls" ) )
-                        {
-                            index = mvar_HttpdInfoSetNew( m.param1, p_intf->p_sys->p_httpd, HTTPD_GET_URLS );
-                        }
-                        else if( !strcmp( m.param2, "connections" ) )
-                        {
-                            index = mvar_HttpdInfoSetNew(m.param1, p_intf->p_sys->p_httpd, HTTPD_GET_CONNECTIONS);
-                        }
-#endif
-                        else if( ( v = mvar_GetVar( p_args->vars, m.param2 ) ) )
-                        {
-                            index = mvar_Duplicate( v );
-                        }
-                        else
-                        {
-                            msg_Dbg( p_intf, "invalid index constructor (%s)", m.param2 );
-                            src = endfor;
-                            break;
-                        }
+        mvar_Delete( f );
+    }
 
-                        for( i_idx = 0; i_idx < index->i_field; i_idx++ )
-                        {
-                            mvar_t *f = mvar_Duplicate( index->field[i_idx] );
+    if( b_playlist )
+        mvar_PlaylistSetRelease( p_intf, index );
+    else
+        mvar_Delete( index );
+}
 
-                            //msg_Dbg( p_intf, "foreach field[%d] name=%s value=%s", i_idx, f->name, f->value );
+static void TemplateRun( httpd_file_sys_t *p_args, http_template_t *t,
+                         int i_first, int i_last,
+                         char *p_request, int i_request,
+                         char **pp_data, int *pi_data, char **pp_dst )
+{
+    int i = i_first;
 
-                            free( f->name );
-                            f->name = strdup( m.param1 );
+    while( i < i_last )
+    {
+        const template_op_t *op = &t->p_ops[i];
+        /* The macros may modify their parameters */
+        macro_t m;
 
+        switch( op->i_type )
+        {
+            case TEMPLATE_TEXT:
+                TemplateWrite( pp_data, pi_data, pp_dst,
+                               op->p_text, op->i_text );
+                i++;
+                break;
 
-                            mvar_PushVar( p_args->vars, f );
-                            Execute( p_args, p_request, i_request,
-                                     pp_data, pi_data, &dst, start, stop );
-                            mvar_RemoveVar( p_args->vars, f );
+            case MVLC_INCLUDE:
+                TemplateInclude( p_args, op->m.param1, p_request, i_request,
+                                 pp_data, pi_data, pp_dst );
+                i++;
+                break;
 
-                            mvar_Delete( f );
-                        }
-                        mvar_Delete( index );
+            case MVLC_IF:
+            {
+                char *psz_test;
+                bool b_test;
 
-                        src = endfor;
-                    }
+                if( op->i_end < 0 )
+                {
+                    /* Unterminated: nothing is output past it */
+                    i = i_last;
                     break;
                 }
-                default:
-                    MacroDo( p_args, &m, p_request, i_request,
-                             pp_data, pi_data, &dst );
-                    break;
-            }
 
-            MacroClean( &m );
-            continue;
-        }
-
-        i_copy =   ( (p == NULL || p > end ) ? end : p  ) - src;
-        if( i_copy > 0 )
-        {
-            int i_index = dst - *pp_data;
+                psz_test = strdup( op->m.param1 ? op->m.param1 : "" );
+                EvaluateRPN( p_args->p_intf, p_args->vars, &p_args->stack,
+                             psz_test );
+                free( psz_test );
+                b_test = SSPopN( &p_args->stack, p_args->vars ) != 0;
+
+                if( b_test )
+                    TemplateRun( p_args, t, i + 1,
+                                 op->i_else >= 0 ? op->i_else : op->i_end,
+                                 p_request, i_request,
+                                 pp_data, pi_data, pp_dst );
+                else if( op->i_else >= 0 )
+                    TemplateRun( p_args, t, op->i_else + 1, op->i_end,
+                                 p_request, i_request,
+                                 pp_data, pi_data, pp_dst );
+                i = op->i_end + 1;
+                break;
+            }
 
-            *pi_data += i_copy;
-            *pp_data = realloc( *pp_data, *pi_data );
-            dst = (*pp_data) + i_index;
+            case MVLC_FOREACH:
+                if( op->i_end < 0 )
+                {
+                    i++;
+                    break;
+                }
+                TemplateForeach( p_args, t, i, p_request, i_request,
+                                 pp_data, pi_data, pp_dst );
+                i = op->i_end + 1;
+                break;
 
-            memcpy( dst, src, i_copy );
-            dst += i_copy;
-            src += i_copy;
+            default:
+                m.id = op->m.id;
+                m.param1 = op->m.param1 ? strdup( op->m.param1 ) : NULL;
+                m.param2 = op->m.param2 ? strdup( op->m.param2 ) : NULL;
+                MacroDo( p_args, &m, op->i_type, p_request, i_request,
+                         pp_data, pi_data, pp_dst );
+                free( m.param1 );
+                free( m.param2 );
+                i++;
+                break;
         }
     }
+}
+
+void TemplateExecute( httpd_file_sys_t *p_args, http_template_t *t,
+                      char *p_request, int i_request,
+                      char **pp_data, int *pi_data, char **pp_dst )
+{
+    TemplateRun( p_args, t, 0, t->i_ops, p_request, i_request,
+                 pp_data, pi_data, pp_dst );
+}
+
+void Execute( httpd_file_sys_t *p_args,
+                     char *p_request, int i_request,
+                     char **pp_data, int *pi_data,
+                     char **pp_dst,
+                     char *_src, char *_end )
+{
+    http_template_t *t = TemplateNew( _src, _end - _src );
 
-    *pp_dst = dst;
-    free( dup );
+    if( t == NULL )
+        return;
+    TemplateExecute( p_args, t, p_request, i_request,
+                     pp_data, pi_data, pp_dst );
+    TemplateDelete( t );
 }
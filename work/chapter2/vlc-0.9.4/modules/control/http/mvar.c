@@ -293,6 +293,43 @@ mvar_t *mvar_PlaylistSetNew( intf_thread_t *p_intf, char *name,
     return s;
 }
 
+mvar_t *mvar_PlaylistSetGet( intf_thread_t *p_intf )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    /* Read before the playlist is, so that a change while building the
+     * set makes the next call build it again */
+    int i_serial = PlaylistSerial( p_intf );
+    mvar_t *s;
+
+    if( p_sys->p_playlist_set != NULL
+     && p_sys->i_playlist_set_serial == i_serial )
+    {
+        p_sys->i_playlist_set_refs++;
+        return p_sys->p_playlist_set;
+    }
+
+    s = mvar_PlaylistSetNew( p_intf, (char *)"playlist", p_sys->p_playlist );
+    if( p_sys->i_playlist_set_refs > 0 )
+        return s; /* the old one is still used, this one will be deleted */
+
+    if( p_sys->p_playlist_set != NULL )
+        mvar_Delete( p_sys->p_playlist_set );
+    p_sys->p_playlist_set = s;
+    p_sys->i_playlist_set_serial = i_serial;
+    p_sys->i_playlist_set_refs = 1;
+    return s;
+}
+
+void mvar_PlaylistSetRelease( intf_thread_t *p_intf, mvar_t *s )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+
+    if( s == p_sys->p_playlist_set )
+        p_sys->i_playlist_set_refs--;
+    else
+        mvar_Delete( s );
+}
+
 mvar_t *mvar_InfoSetNew( char *name, input_thread_t *p_input )
 {
     mvar_t *s = mvar_New( name, "set" );
@@ -2002,6 +2002,10 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             (float)(p_item->p_stats->i_read_bytes)/1000 );
     msg_rc(_("| input bitrate    :   %6.0f kb/s"),
             (float)(p_item->p_stats->f_input_bitrate)*8000 );
+    msg_rc(_("| cache seeks hit  :    %5i/%i"),
+            p_item->p_stats->i_stream_cache_hits,
+            p_item->p_stats->i_stream_cache_hits +
+            p_item->p_stats->i_stream_cache_misses );
     msg_rc(_("| demux bytes read : %8.0f kB"),
             (float)(p_item->p_stats->i_demux_read_bytes)/1000 );
     msg_rc(_("| demux bitrate    :   %6.0f kb/s"),
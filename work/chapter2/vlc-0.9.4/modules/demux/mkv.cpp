@@ -103,6 +103,14 @@
 extern "C" {
    #include "mp4/libmp4.h"
 }
+#ifdef MKV_RAW_BLOCKS
+/* Experimental, not enabled by default: the blocks of the clusters of known
+ * size are read straight from the stream instead of through libebml. */
+#   include <limits.h>
+extern "C" {
+   #include "mkv_block.h"
+}
+#endif
 #ifdef HAVE_ZLIB_H
 #   include <zlib.h>
 #endif
@@ -531,6 +539,10 @@ class vlc_stream_io_callback: public IOCallback
     virtual size_t   write           ( const void *p_buffer, size_t i_size);
     virtual uint64   getFilePointer  ( void );
     virtual void     close           ( void );
+#ifdef MKV_RAW_BLOCKS
+
+    stream_t        *GetStream       ( void ) { return s; }
+#endif
 };
 
 /*****************************************************************************
@@ -553,6 +565,14 @@ class EbmlParser
 
     /* Is the provided element presents in our upper elements */
     bool IsTopPresent( EbmlElement * );
+#ifdef MKV_RAW_BLOCKS
+
+    /* The children of the cluster just entered are read by the demuxer up
+     * to i_end (see BlockGetRaw), and given back to the parser with the
+     * stream at one of them. 0 when the parser reads them. */
+    void    SetRawEnd( int64_t i_end ) { mi_raw_end = i_end; }
+    int64_t GetRawEnd( void ) const { return mi_raw_end; }
+#endif
 
   private:
     EbmlStream  *m_es;
@@ -565,6 +585,9 @@ class EbmlParser
     int         mi_user_level;
     bool        mb_keep;
     bool        mb_dummy;
+#ifdef MKV_RAW_BLOCKS
+    int64_t     mi_raw_end;
+#endif
 };
 
 
@@ -1047,6 +1070,11 @@ public:
         ,sys(demuxer)
         ,ep(NULL)
         ,b_preloaded(false)
+#ifdef MKV_RAW_BLOCKS
+        ,i_cluster_timecode(0)
+        ,p_raw_buffer(NULL)
+        ,i_raw_buffer(0)
+#endif
     {
         p_indexes = (mkv_index_t*)malloc( sizeof( mkv_index_t ) * i_index_max );
     }
@@ -1068,6 +1096,9 @@ public:
         free( psz_title );
         free( psz_date_utc );
         free( p_indexes );
+#ifdef MKV_RAW_BLOCKS
+        free( p_raw_buffer );
+#endif
 
         delete ep;
         delete segment;
@@ -1150,6 +1181,14 @@ public:
     demux_sys_t                    & sys;
     EbmlParser                     *ep;
     bool                           b_preloaded;
+#ifdef MKV_RAW_BLOCKS
+
+    /* blocks read without libebml */
+    uint64_t                       i_cluster_timecode;
+    mkv_block_t                    raw_block;
+    uint8_t                        *p_raw_buffer;
+    size_t                         i_raw_buffer;
+#endif
 
     bool Preload( );
     bool LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position );
@@ -1167,7 +1206,18 @@ public:
     void LoadTags( KaxTags *tags );
     void InformationCreate( );
     void Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_global_position );
+#ifdef MKV_RAW_BLOCKS
+    int BlockGet( KaxBlock * &, KaxSimpleBlock * &, int64_t *, int64_t *, int64_t *, mkv_block_t ** = NULL );
+    bool BlockGetRaw( int64_t *, int64_t *, int64_t * );
+    /* in nanoseconds, as KaxInternalBlock::GlobalTimecode() */
+    int64_t BlockGetRawTimecode( const mkv_block_t *p_block ) const
+    {
+        return (int64_t)( i_cluster_timecode + p_block->i_timecode ) * (int64_t)i_timescale;
+    }
+    int BlockFindRawTrackIndex( size_t *pi_track, const mkv_block_t * );
+#else
     int BlockGet( KaxBlock * &, KaxSimpleBlock * &, int64_t *, int64_t *, int64_t *);
+#endif
 
     int BlockFindTrackIndex( size_t *pi_track,
                              const KaxBlock *, const KaxSimpleBlock * );
@@ -1754,12 +1804,21 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 }
 
+#ifdef MKV_RAW_BLOCKS
+/* pp_rawblock may be NULL, then all the blocks are read by libebml */
+int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, int64_t *pi_ref1, int64_t *pi_ref2, int64_t *pi_duration, mkv_block_t **pp_rawblock )
+#else
 int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, int64_t *pi_ref1, int64_t *pi_ref2, int64_t *pi_duration )
+#endif
 {
     pp_simpleblock = NULL;
     pp_block = NULL;
     *pi_ref1  = 0;
     *pi_ref2  = 0;
+#ifdef MKV_RAW_BLOCKS
+    if( pp_rawblock != NULL )
+        *pp_rawblock = NULL;
+#endif
 
     for( ;; )
     {
@@ -1769,6 +1828,18 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
         if ( ep == NULL )
             return VLC_EGENERIC;
 
+#ifdef MKV_RAW_BLOCKS
+        if( ep->GetRawEnd() > 0 )
+        {
+            if( pp_rawblock != NULL && BlockGetRaw( pi_ref1, pi_ref2, pi_duration ) )
+            {
+                *pp_rawblock = &raw_block;
+                return VLC_SUCCESS;
+            }
+            ep->SetRawEnd( 0 );
+        }
+
+#endif
         if( pp_simpleblock != NULL || ((el = ep->Get()) == NULL && pp_block != NULL) )
         {
             /* Check blocks validity to protect againts broken files */
@@ -1844,6 +1915,18 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                 }
 
                 ep->Down();
+#ifdef MKV_RAW_BLOCKS
+
+                /* read the children of a cluster of known size ourselves */
+                if( pp_rawblock != NULL && cluster->IsFiniteSize() )
+                {
+                    int64_t i_data = cluster->GetElementPosition() + cluster->HeadSize();
+
+                    i_cluster_timecode = 0;
+                    if( (int64_t)es.I_O().getFilePointer() == i_data )
+                        ep->SetRawEnd( i_data + cluster->GetSize() );
+                }
+#endif
             }
             else if( MKV_IS_ID( el, KaxCues ) )
             {
@@ -1932,6 +2015,129 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
         }
     }
 }
+#ifdef MKV_RAW_BLOCKS
+
+/* Reads the next block of the current cluster straight from the stream,
+ * and returns false when libebml has to go on: at the end of the cluster,
+ * or at an element which is not handled here. The stream is then at the
+ * start of an element of the cluster, or at its end. */
+bool matroska_segment_c::BlockGetRaw( int64_t *pi_ref1, int64_t *pi_ref2, int64_t *pi_duration )
+{
+    stream_t *s = static_cast<vlc_stream_io_callback&>( es.I_O() ).GetStream();
+    int64_t  i_end = ep->GetRawEnd();
+
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        uint32_t i_id;
+        uint64_t i_size;
+        int64_t  i_pos = stream_Tell( s );
+        int      i_peek, i_header;
+
+        if( i_pos >= i_end )
+            return false;
+
+        i_peek = stream_Peek( s, &p_peek, __MIN( MKV_HEADER_MAX, i_end - i_pos ) );
+        i_header = mkv_ReadHeader( p_peek, i_peek, &i_id, &i_size );
+        if( i_header == 0 || i_size > (uint64_t)( i_end - i_pos - i_header ) ||
+            i_size > INT_MAX )
+            return false;
+
+        if( i_id != MKV_ID_CLUSTER_TIMECODE && i_id != MKV_ID_SIMPLEBLOCK &&
+            i_id != MKV_ID_BLOCKGROUP )
+        {
+            /* Upper level elements in a broken cluster, and silent tracks
+             * are for libebml */
+            if( i_id > 0xffff || i_id == MKV_ID_SILENT_TRACKS )
+                return false;
+
+            /* CRC-32, Void, Position, PrevSize... */
+            if( stream_Seek( s, i_pos + i_header + i_size ) )
+                return false;
+            continue;
+        }
+
+        if( i_raw_buffer < i_size )
+        {
+            uint8_t *p_buffer = (uint8_t *)realloc( p_raw_buffer, i_size );
+            if( p_buffer == NULL )
+                return false;
+            p_raw_buffer = p_buffer;
+            i_raw_buffer = i_size;
+        }
+
+        if( stream_Read( s, NULL, i_header ) != i_header ||
+            stream_Read( s, p_raw_buffer, i_size ) != (int)i_size )
+        {
+            stream_Seek( s, i_pos );
+            return false;
+        }
+
+        if( i_id == MKV_ID_CLUSTER_TIMECODE )
+        {
+            if( !mkv_ReadUInt( p_raw_buffer, i_size, &i_cluster_timecode ) )
+                cluster->InitTimecode( i_cluster_timecode, i_timescale );
+            continue;
+        }
+
+        if( i_id == MKV_ID_SIMPLEBLOCK )
+        {
+            if( mkv_BlockParse( &raw_block, p_raw_buffer, i_size, true ) )
+            {
+                msg_Warn( &sys.demuxer, "invalid SimpleBlock at %"PRId64, i_pos );
+                continue;
+            }
+            *pi_ref1 = *pi_ref2 = 0;
+        }
+        else
+        {
+            if( mkv_BlockGroupParse( &raw_block, p_raw_buffer, i_size ) )
+            {
+                msg_Warn( &sys.demuxer, "invalid BlockGroup at %"PRId64, i_pos );
+                continue;
+            }
+            *pi_ref1 = raw_block.i_reference[0] * (int64_t)i_timescale;
+            *pi_ref2 = raw_block.i_reference[1] * (int64_t)i_timescale;
+            if( raw_block.b_duration )
+                *pi_duration = raw_block.i_duration;
+        }
+
+        /* Check blocks validity to protect againts broken files */
+        if( BlockFindRawTrackIndex( NULL, &raw_block ) )
+            continue;
+
+        /* update the index */
+#define idx p_indexes[i_index - 1]
+        if( i_index > 0 && idx.i_time == -1 )
+        {
+            idx.i_time        = BlockGetRawTimecode( &raw_block ) / (mtime_t)1000;
+            idx.b_key         = *pi_ref1 == 0 ? true : false;
+        }
+#undef idx
+        i_block_pos = i_pos;
+        return true;
+    }
+}
+
+int matroska_segment_c::BlockFindRawTrackIndex( size_t *pi_track,
+                                                const mkv_block_t *p_block )
+{
+    size_t i_track;
+
+    for( i_track = 0; i_track < tracks.size(); i_track++ )
+    {
+        if( tracks[i_track]->i_number == p_block->i_track )
+            break;
+    }
+
+    if( i_track >= tracks.size() )
+        return VLC_EGENERIC;
+
+    if( pi_track )
+        *pi_track = i_track;
+    return VLC_SUCCESS;
+}
+#endif
 
 static block_t *MemToBlock( demux_t *p_demux, uint8_t *p_mem, int i_mem, size_t offset)
 {
@@ -1942,8 +2148,14 @@ static block_t *MemToBlock( demux_t *p_demux, uint8_t *p_mem, int i_mem, size_t
     return p_block;
 }
 
+#ifdef MKV_RAW_BLOCKS
+static void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
+                         mtime_t i_pts, mtime_t i_duration, bool f_mandatory,
+                         const mkv_block_t *rawblock = NULL )
+#else
 static void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock,
                          mtime_t i_pts, mtime_t i_duration, bool f_mandatory )
+#endif
 {
     demux_sys_t        *p_sys = p_demux->p_sys;
     matroska_segment_c *p_segment = p_sys->p_current_segment->Segment();
@@ -1952,7 +2164,12 @@ static void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simp
     unsigned int    i;
     bool            b;
 
+#ifdef MKV_RAW_BLOCKS
+    if( rawblock != NULL ? p_segment->BlockFindRawTrackIndex( &i_track, rawblock ) :
+                           p_segment->BlockFindTrackIndex( &i_track, block, simpleblock ) )
+#else
     if( p_segment->BlockFindTrackIndex( &i_track, block, simpleblock ) )
+#endif
     {
         msg_Err( p_demux, "invalid track number" );
         return;
@@ -1995,11 +2212,27 @@ static void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simp
 
 
     for( i = 0;
+#ifdef MKV_RAW_BLOCKS
+         (block != NULL && i < block->NumberFrames()) || (simpleblock != NULL && i < simpleblock->NumberFrames()) ||
+         (rawblock != NULL && i < rawblock->i_frames);
+#else
          (block != NULL && i < block->NumberFrames()) || (simpleblock != NULL && i < simpleblock->NumberFrames());
+#endif
          i++ )
     {
         block_t *p_block;
         DataBuffer *data;
+#ifdef MKV_RAW_BLOCKS
+        DataBuffer rawdata( rawblock != NULL ? (binary *)rawblock->p_frame[i] : NULL,
+                            rawblock != NULL ? rawblock->i_frame[i] : 0 );
+        if( rawblock != NULL )
+        {
+            data = &rawdata;
+            if( rawblock->b_simple )
+                f_mandatory = rawblock->b_discardable || rawblock->b_keyframe;
+        }
+        else
+#endif
         if( simpleblock != NULL )
         {
             data = &simpleblock->GetBuffer(i);
@@ -3530,8 +3763,14 @@ static int Demux( demux_t *p_demux)
         int64_t i_block_duration = 0;
         int64_t i_block_ref1;
         int64_t i_block_ref2;
+#ifdef MKV_RAW_BLOCKS
+        mkv_block_t *rawblock;
+
+        if( p_segment->BlockGet( block, simpleblock, &i_block_ref1, &i_block_ref2, &i_block_duration, &rawblock ) )
+#else
 
         if( p_segment->BlockGet( block, simpleblock, &i_block_ref1, &i_block_ref2, &i_block_duration ) )
+#endif
         {
             if ( p_vsegment->Edition() && p_vsegment->Edition()->b_ordered )
             {
@@ -3573,6 +3812,11 @@ static int Demux( demux_t *p_demux)
             }
         }
 
+#ifdef MKV_RAW_BLOCKS
+        if( rawblock != NULL )
+            p_sys->i_pts = (p_sys->i_chapter_time + p_segment->BlockGetRawTimecode( rawblock )) / (mtime_t) 1000;
+        else
+#endif
         if( simpleblock != NULL )
             p_sys->i_pts = (p_sys->i_chapter_time + simpleblock->GlobalTimecode()) / (mtime_t) 1000;
         else
@@ -3614,7 +3858,11 @@ static int Demux( demux_t *p_demux)
             continue;
         }
 
+#ifdef MKV_RAW_BLOCKS
+        BlockDecode( p_demux, block, simpleblock, p_sys->i_pts, i_block_duration, i_block_ref1 >= 0 || i_block_ref2 > 0, rawblock );
+#else
         BlockDecode( p_demux, block, simpleblock, p_sys->i_pts, i_block_duration, i_block_ref1 >= 0 || i_block_ref2 > 0 );
+#endif
 
         delete block;
         i_block_count++;
@@ -3719,6 +3967,9 @@ EbmlParser::EbmlParser( EbmlStream *es, EbmlElement *el_start, demux_t *p_demux
     mi_user_level = 1;
     mb_keep = false;
     mb_dummy = config_GetInt( p_demux, "mkv-use-dummy" );
+#ifdef MKV_RAW_BLOCKS
+    mi_raw_end = 0;
+#endif
 }
 
 EbmlParser::~EbmlParser( void )
@@ -3748,6 +3999,9 @@ EbmlElement* EbmlParser::UnGet( uint64 i_block_pos, uint64 i_cluster_pos )
     }
     m_got = NULL;
     mb_keep = false;
+#ifdef MKV_RAW_BLOCKS
+    mi_raw_end = 0;
+#endif
     if ( m_el[1]->GetElementPosition() == i_cluster_pos )
     {
         m_es->I_O().setFilePointer( i_block_pos, seek_beginning );
@@ -3807,6 +4061,9 @@ void EbmlParser::Reset( demux_t *p_demux )
     m_es->I_O().setFilePointer( m_el[0]->GetElementPosition() + m_el[0]->ElementSize(true) - m_el[0]->GetSize() );
 #endif
     mb_dummy = config_GetInt( p_demux, "mkv-use-dummy" );
+#ifdef MKV_RAW_BLOCKS
+    mi_raw_end = 0;
+#endif
 }
 
 /* This function workarounds a bug in KaxBlockVirtual implementation */
@@ -0,0 +1,292 @@
+/*****************************************************************************
+ * mkv_block.c: Matroska blocks read without libebml
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "mkv_block.h"
+
+/* Length of the variable size integer starting with i_first, 0 if invalid */
+static int VintLength( uint8_t i_first )
+{
+    int i_len = 1;
+
+    if( i_first == 0 )
+        return 0;
+    while( !( i_first & 0x80 ) )
+    {
+        i_first <<= 1;
+        i_len++;
+    }
+    return i_len;
+}
+
+/* Reads a variable size integer without its length marker, returns its
+ * length or 0. *pb_reserved tells if all its bits are set. */
+static int ReadVint( const uint8_t *p_data, size_t i_data,
+                     uint64_t *pi_value, bool *pb_reserved )
+{
+    uint64_t i_value;
+    bool b_reserved;
+    int i_len, i;
+
+    if( i_data < 1 )
+        return 0;
+    i_len = VintLength( p_data[0] );
+    if( i_len == 0 || (size_t)i_len > i_data )
+        return 0;
+
+    i_value = p_data[0] & ( 0xff >> i_len );
+    b_reserved = i_value == (uint64_t)( 0xff >> i_len );
+    for( i = 1; i < i_len; i++ )
+    {
+        i_value = ( i_value << 8 ) | p_data[i];
+        b_reserved = b_reserved && p_data[i] == 0xff;
+    }
+
+    *pi_value = i_value;
+    *pb_reserved = b_reserved;
+    return i_len;
+}
+
+int mkv_ReadHeader( const uint8_t *p_data, size_t i_data,
+                    uint32_t *pi_id, uint64_t *pi_size )
+{
+    uint32_t i_id = 0;
+    bool b_unknown;
+    int i_id_len, i_size_len, i;
+
+    if( i_data < 1 )
+        return 0;
+    i_id_len = VintLength( p_data[0] );
+    if( i_id_len == 0 || i_id_len > 4 || (size_t)i_id_len > i_data )
+        return 0;
+    for( i = 0; i < i_id_len; i++ )
+        i_id = ( i_id << 8 ) | p_data[i];
+
+    i_size_len = ReadVint( p_data + i_id_len, i_data - i_id_len,
+                           pi_size, &b_unknown );
+    if( i_size_len == 0 )
+        return 0;
+    if( b_unknown )
+        *pi_size = MKV_SIZE_UNKNOWN;
+
+    *pi_id = i_id;
+    return i_id_len + i_size_len;
+}
+
+int mkv_ReadUInt( const uint8_t *p_data, size_t i_data, uint64_t *pi_value )
+{
+    uint64_t i_value = 0;
+    size_t i;
+
+    if( i_data > 8 )
+        return VLC_EGENERIC;
+    for( i = 0; i < i_data; i++ )
+        i_value = ( i_value << 8 ) | p_data[i];
+
+    *pi_value = i_value;
+    return VLC_SUCCESS;
+}
+
+int mkv_ReadSInt( const uint8_t *p_data, size_t i_data, int64_t *pi_value )
+{
+    uint64_t i_value;
+    size_t i;
+
+    if( i_data > 8 )
+        return VLC_EGENERIC;
+    i_value = ( i_data > 0 && ( p_data[0] & 0x80 ) ) ? UINT64_MAX : 0;
+    for( i = 0; i < i_data; i++ )
+        i_value = ( i_value << 8 ) | p_data[i];
+
+    *pi_value = (int64_t)i_value;
+    return VLC_SUCCESS;
+}
+
+int mkv_BlockParse( mkv_block_t *p_block, const uint8_t *p_data, size_t i_data,
+                    bool b_simple )
+{
+    uint64_t i_track;
+    uint8_t i_flags;
+    unsigned i_frames, i;
+    size_t i_laced;
+    bool b_reserved;
+    int i_len;
+
+    i_len = ReadVint( p_data, i_data, &i_track, &b_reserved );
+    if( i_len == 0 || i_data - i_len < 3 || i_data > UINT32_MAX )
+        return VLC_EGENERIC;
+
+    p_block->i_track = i_track;
+    p_block->i_timecode = (int16_t)( ( p_data[i_len] << 8 ) |
+                                     p_data[i_len + 1] );
+    i_flags = p_data[i_len + 2];
+    p_block->b_simple = b_simple;
+    p_block->b_keyframe = b_simple && ( i_flags & 0x80 );
+    p_block->b_discardable = b_simple && ( i_flags & 0x01 );
+
+    p_data += i_len + 3;
+    i_data -= i_len + 3;
+
+    if( ( i_flags & 0x06 ) == 0 )
+    {
+        /* No lacing */
+        p_block->i_frames = 1;
+        p_block->p_frame[0] = p_data;
+        p_block->i_frame[0] = i_data;
+        return VLC_SUCCESS;
+    }
+
+    if( i_data < 1 )
+        return VLC_EGENERIC;
+    i_frames = p_data[0] + 1;
+    p_data++;
+    i_data--;
+
+    /* Sizes of all the frames but the last one */
+    switch( ( i_flags >> 1 ) & 0x03 )
+    {
+        case 1: /* Xiph */
+            for( i = 0; i + 1 < i_frames; i++ )
+            {
+                uint32_t i_size = 0;
+                uint8_t i_byte;
+
+                do
+                {
+                    if( i_data == 0 )
+                        return VLC_EGENERIC;
+                    i_byte = *p_data++;
+                    i_data--;
+                    i_size += i_byte;
+                } while( i_byte == 0xff );
+
+                p_block->i_frame[i] = i_size;
+            }
+            break;
+
+        case 2: /* Fixed size */
+            if( i_data % i_frames )
+                return VLC_EGENERIC;
+            for( i = 0; i + 1 < i_frames; i++ )
+                p_block->i_frame[i] = i_data / i_frames;
+            break;
+
+        case 3: /* EBML: the first size, then the differences */
+            for( i = 0; i + 1 < i_frames; i++ )
+            {
+                uint64_t i_value;
+                int64_t i_size;
+
+                i_len = ReadVint( p_data, i_data, &i_value, &b_reserved );
+                if( i_len == 0 )
+                    return VLC_EGENERIC;
+                p_data += i_len;
+                i_data -= i_len;
+
+                if( i == 0 )
+                    i_size = i_value;
+                else
+                    i_size = (int64_t)p_block->i_frame[i - 1] +
+                             (int64_t)i_value -
+                             ( ( INT64_C(1) << ( 7 * i_len - 1 ) ) - 1 );
+                if( i_size < 0 || i_size > UINT32_MAX )
+                    return VLC_EGENERIC;
+
+                p_block->i_frame[i] = i_size;
+            }
+            break;
+    }
+
+    i_laced = 0;
+    for( i = 0; i + 1 < i_frames; i++ )
+    {
+        if( p_block->i_frame[i] > i_data - i_laced )
+            return VLC_EGENERIC;
+        p_block->p_frame[i] = &p_data[i_laced];
+        i_laced += p_block->i_frame[i];
+    }
+    p_block->p_frame[i_frames - 1] = &p_data[i_laced];
+    p_block->i_frame[i_frames - 1] = i_data - i_laced;
+    p_block->i_frames = i_frames;
+
+    return VLC_SUCCESS;
+}
+
+int mkv_BlockGroupParse( mkv_block_t *p_block, const uint8_t *p_data,
+                         size_t i_data )
+{
+    bool b_block = false;
+
+    p_block->b_duration = false;
+    p_block->i_reference[0] = p_block->i_reference[1] = 0;
+
+    while( i_data > 0 )
+    {
+        uint32_t i_id;
+        uint64_t i_size;
+        int64_t i_reference;
+        int i_header;
+
+        i_header = mkv_ReadHeader( p_data, i_data, &i_id, &i_size );
+        if( i_header == 0 || i_size > i_data - i_header )
+            return VLC_EGENERIC;
+        p_data += i_header;
+        i_data -= i_header;
+
+        switch( i_id )
+        {
+            case MKV_ID_BLOCK:
+                if( b_block ||
+                    mkv_BlockParse( p_block, p_data, i_size, false ) )
+                    return VLC_EGENERIC;
+                b_block = true;
+                break;
+
+            case MKV_ID_BLOCK_DURATION:
+                if( mkv_ReadUInt( p_data, i_size, &p_block->i_duration ) )
+                    return VLC_EGENERIC;
+                p_block->b_duration = true;
+                break;
+
+            case MKV_ID_REFERENCE_BLOCK:
+                if( mkv_ReadSInt( p_data, i_size, &i_reference ) )
+                    return VLC_EGENERIC;
+                if( p_block->i_reference[0] == 0 )
+                    p_block->i_reference[0] = i_reference;
+                else if( p_block->i_reference[1] == 0 )
+                    p_block->i_reference[1] = i_reference;
+                break;
+
+            default:
+                break;
+        }
+
+        p_data += i_size;
+        i_data -= i_size;
+    }
+
+    return b_block ? VLC_SUCCESS : VLC_EGENERIC;
+}
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * mkv_block.h: Matroska blocks read without libebml
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _MKV_BLOCK_H_
+#define _MKV_BLOCK_H_ 1
+
+/*
+ * The children of a cluster are read by the demuxer from the stream: it
+ * peeks the element headers, and reads the payload of a block into a buffer
+ * of its own. The block headers and the lacing are parsed from there, and
+ * the frames point into the buffer. libebml still reads everything else.
+ */
+
+/* EBML IDs, with their length marker */
+#define MKV_ID_CLUSTER_TIMECODE     0xE7
+#define MKV_ID_SILENT_TRACKS        0x5854
+#define MKV_ID_BLOCKGROUP           0xA0
+#define MKV_ID_SIMPLEBLOCK          0xA3
+#define MKV_ID_BLOCK                0xA1
+#define MKV_ID_BLOCK_DURATION       0x9B
+#define MKV_ID_REFERENCE_BLOCK      0xFB
+
+#define MKV_SIZE_UNKNOWN UINT64_MAX
+
+/* Longest element header: a 4 bytes ID and an 8 bytes size */
+#define MKV_HEADER_MAX 12
+
+/* Reads the element header at p_data: returns its length, or 0 if it is not
+ * a valid header or if i_data is too short for it */
+int mkv_ReadHeader( const uint8_t *p_data, size_t i_data,
+                    uint32_t *pi_id, uint64_t *pi_size );
+
+/* Values of integer elements of i_data bytes */
+int mkv_ReadUInt( const uint8_t *p_data, size_t i_data, uint64_t * );
+int mkv_ReadSInt( const uint8_t *p_data, size_t i_data, int64_t * );
+
+/* A lace holds at most 256 frames */
+#define MKV_FRAMES_MAX 256
+
+typedef struct
+{
+    uint64_t        i_track;        /* track number */
+    int16_t         i_timecode;     /* relative to the cluster timecode */
+
+    bool            b_simple;       /* a SimpleBlock, with the flags below */
+    bool            b_keyframe;
+    bool            b_discardable;
+
+    /* From the BlockGroup: the duration if b_duration, the first two
+     * non zero ReferenceBlock, 0 if there are not, in timecode units */
+    bool            b_duration;
+    uint64_t        i_duration;
+    int64_t         i_reference[2];
+
+    unsigned        i_frames;
+    const uint8_t  *p_frame[MKV_FRAMES_MAX];
+    uint32_t        i_frame[MKV_FRAMES_MAX];
+} mkv_block_t;
+
+/* Parses the payload of a SimpleBlock (b_simple) or of a Block */
+int mkv_BlockParse( mkv_block_t *, const uint8_t *p_data, size_t i_data,
+                    bool b_simple );
+/* Parses the payload of a BlockGroup, skipping the children which do not
+ * matter to the demuxer */
+int mkv_BlockGroupParse( mkv_block_t *, const uint8_t *p_data,
+                         size_t i_data );
+
+#endif
@@ -0,0 +1,870 @@
+/*****************************************************************************
+ * mpeg_index.c: time index of MPEG transport and program streams
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#ifdef HAVE_SYS_TYPES_H
+#   include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#   include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#   include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_charset.h>
+
+#include "mpeg_index.h"
+
+/* Clock references are 33 bits at 90 kHz */
+#define CLOCK_WRAP ((INT64_C(1) << 33) * 100 / 9)
+/* A larger step of the clock is taken as a discontinuity */
+#define CLOCK_MAX_STEP INT64_C(10000000)
+/* Entries are added anyway after this time without random access point */
+#define MAX_INTERVAL (4 * MPEG_INDEX_INTERVAL)
+
+/* Larger than a PS packet */
+#define SCAN_BUFFER (256 * 1024)
+
+#define SIDECAR_EXT ".vlcidx"
+#define SIDECAR_MAGIC "VLCMPIX2"
+#define SIDECAR_HEADER 40
+#define SIDECAR_ENTRY 28
+
+typedef struct
+{
+    VLC_COMMON_MEMBERS
+
+    mpeg_index_t *p_index;
+    int           fd;
+} mpeg_index_thread_t;
+
+struct mpeg_index_t
+{
+    vlc_object_t *p_obj;
+    int           i_type;
+    int           i_packet_size;
+
+    /* Shared with the demuxer */
+    vlc_mutex_t         lock;
+    mpeg_index_entry_t *p_entries;
+    unsigned            i_entries;
+    unsigned            i_alloc;
+    int64_t             i_scanned;  /* bytes indexed so far */
+    int64_t             i_length;   /* time at the end of the file */
+    bool                b_complete;
+    bool                b_rap;      /* random access points were found */
+
+    /* Parser state */
+    int                 i_pcr_pid;  /* -1 for the first one with a PCR */
+    int                 i_video_id; /* PID, or stream id for PS */
+    vlc_fourcc_t        i_codec;
+    bool                b_clock;
+    int64_t             i_last_clock;
+    int64_t             i_time;
+    bool                b_candidate;
+    mpeg_index_entry_t  candidate;
+
+    /* */
+    mpeg_index_thread_t *p_thread;
+    char                *psz_sidecar;
+    int64_t              i_file_size;
+    int64_t              i_file_mtime;
+    int64_t              i_length_probe; /* from the first and last clocks */
+};
+
+/*****************************************************************************
+ * Entries
+ *****************************************************************************/
+static void Append( mpeg_index_t *p_index, const mpeg_index_entry_t *p_entry )
+{
+    vlc_mutex_lock( &p_index->lock );
+    if( p_index->i_entries >= p_index->i_alloc )
+    {
+        unsigned i_alloc = p_index->i_alloc ? 2 * p_index->i_alloc : 1024;
+        mpeg_index_entry_t *p_entries =
+            realloc( p_index->p_entries, i_alloc * sizeof(*p_entries) );
+
+        if( p_entries == NULL )
+        {
+            vlc_mutex_unlock( &p_index->lock );
+            return;
+        }
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+    p_index->p_entries[p_index->i_entries++] = *p_entry;
+    if( p_entry->i_flags & MPEG_INDEX_RAP )
+        p_index->b_rap = true;
+    vlc_mutex_unlock( &p_index->lock );
+}
+
+/* The candidate entry is the last clock reference: it is kept once we know
+ * if a random access point follows it. */
+static void Clock( mpeg_index_t *p_index, int64_t i_clock, int64_t i_offset )
+{
+    uint32_t i_flags = 0;
+
+    if( p_index->b_clock )
+    {
+        int64_t i_step = i_clock - p_index->i_last_clock;
+
+        if( i_step < -CLOCK_WRAP / 2 )
+            i_step += CLOCK_WRAP;
+        if( i_step < 0 || i_step > CLOCK_MAX_STEP )
+        {
+            i_step = 0;
+            i_flags = MPEG_INDEX_DISCONTINUITY;
+        }
+        p_index->i_time += i_step;
+    }
+    p_index->b_clock = true;
+    p_index->i_last_clock = i_clock;
+
+    if( p_index->b_candidate )
+    {
+        const mpeg_index_entry_t *p_cand = &p_index->candidate;
+        const mpeg_index_entry_t *p_last = p_index->i_entries > 0 ?
+            &p_index->p_entries[p_index->i_entries - 1] : NULL;
+        const int64_t i_gap = p_last ? p_cand->i_time - p_last->i_time : 0;
+        /* Without video, any clock reference is a random access point */
+        const bool b_rap = (p_cand->i_flags & MPEG_INDEX_RAP) ||
+                           p_index->i_video_id < 0;
+
+        if( p_last == NULL || (p_cand->i_flags & MPEG_INDEX_DISCONTINUITY)
+         || ( b_rap && i_gap >= MPEG_INDEX_INTERVAL )
+         || i_gap >= MAX_INTERVAL )
+            Append( p_index, p_cand );
+    }
+
+    p_index->candidate.i_time = p_index->i_time;
+    p_index->candidate.i_clock = i_clock;
+    p_index->candidate.i_offset = i_offset;
+    p_index->candidate.i_flags = i_flags;
+    p_index->b_candidate = true;
+}
+
+/*****************************************************************************
+ * Random access points
+ *****************************************************************************/
+static bool IsRap( mpeg_index_t *p_index, const uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i + 4 <= i_size; i++ )
+    {
+        if( p[i] != 0 || p[i+1] != 0 || p[i+2] != 1 )
+            continue;
+
+        const uint8_t i_code = p[i+3];
+
+        /* The first start code of the first PES tells the codec: a GOP or
+         * sequence header, or a picture, for MPEG video, and an access unit
+         * delimiter, a SPS or a slice for H.264 */
+        if( p_index->i_codec == 0 )
+        {
+            if( i_code == 0xb3 || i_code == 0xb8 || i_code == 0xb5 ||
+                i_code == 0x00 )
+                p_index->i_codec = VLC_FOURCC('m','p','g','v');
+            else if( !(i_code & 0x80) &&
+                     ( (i_code & 0x1f) == 9 || (i_code & 0x1f) == 7 ||
+                       (i_code & 0x1f) == 5 || (i_code & 0x1f) == 1 ) )
+                p_index->i_codec = VLC_FOURCC('h','2','6','4');
+            else
+                return false;
+        }
+
+        if( p_index->i_codec == VLC_FOURCC('m','p','g','v') )
+        {
+            if( i_code == 0xb3 || i_code == 0xb8 )
+                return true;
+            if( i_code == 0x00 )
+                /* picture_coding_type 1 is an I picture */
+                return i + 5 < i_size && ((p[i+5] >> 3) & 0x07) == 1;
+        }
+        else
+        {
+            const int i_nal = i_code & 0x1f;
+            if( i_nal == 5 || i_nal == 7 )
+                return true;
+            if( i_nal == 1 )
+                return false;
+        }
+        i += 3;
+    }
+    return false;
+}
+
+/* A PES start: p_index->i_video_id locks on the first video stream */
+static void Pes( mpeg_index_t *p_index, const uint8_t *p, size_t i_size,
+                 int i_id )
+{
+    size_t i_skip;
+
+    if( i_size < 9 || p[0] != 0 || p[1] != 0 || p[2] != 1 ||
+        (p[3] & 0xf0) != 0xe0 )
+        return;
+    if( p_index->i_video_id < 0 )
+        p_index->i_video_id = i_id;
+    else if( p_index->i_video_id != i_id )
+        return;
+
+    if( (p[6] & 0xc0) == 0x80 )
+    {
+        /* MPEG-2 */
+        i_skip = 9 + p[8];
+    }
+    else
+    {
+        /* MPEG-1 */
+        i_skip = 6;
+        while( i_skip < i_size && i_skip < 6 + 16 && p[i_skip] == 0xff )
+            i_skip++;
+        if( i_skip < i_size && (p[i_skip] & 0xc0) == 0x40 )
+            i_skip += 2;
+        if( i_skip < i_size && (p[i_skip] & 0xf0) == 0x20 )
+            i_skip += 5;
+        else if( i_skip < i_size && (p[i_skip] & 0xf0) == 0x30 )
+            i_skip += 10;
+        else if( i_skip < i_size && p[i_skip] == 0x0f )
+            i_skip++;
+    }
+    if( i_skip >= i_size )
+        return;
+
+    if( p_index->b_candidate && IsRap( p_index, &p[i_skip], i_size - i_skip ) )
+        p_index->candidate.i_flags |= MPEG_INDEX_RAP;
+}
+
+/*****************************************************************************
+ * Parsers
+ *****************************************************************************/
+static void PacketTS( mpeg_index_t *p_index, const uint8_t *p,
+                      int64_t i_offset )
+{
+    const int i_pid = ( (p[1] & 0x1f) << 8 ) | p[2];
+    const int i_afc = (p[3] >> 4) & 0x03;
+    int i_skip = 4;
+
+    if( i_afc & 0x02 )
+    {
+        if( p[4] >= 7 && (p[5] & 0x10) )
+        {
+            const int64_t i_pcr = ( (int64_t)p[6] << 25 ) |
+                                  ( (int64_t)p[7] << 17 ) |
+                                  ( (int64_t)p[8] << 9 ) |
+                                  ( (int64_t)p[9] << 1 ) |
+                                  ( (int64_t)p[10] >> 7 );
+
+            if( p_index->i_pcr_pid < 0 )
+                p_index->i_pcr_pid = i_pid;
+            if( i_pid == p_index->i_pcr_pid )
+                Clock( p_index, i_pcr * 100 / 9, i_offset );
+        }
+        i_skip += 1 + p[4];
+    }
+
+    /* payload_unit_start_indicator */
+    if( (p[1] & 0x40) && (i_afc & 0x01) && i_skip < 188 )
+        Pes( p_index, &p[i_skip], 188 - i_skip, i_pid );
+}
+
+static size_t ParseTS( mpeg_index_t *p_index, const uint8_t *p_data,
+                       size_t i_data, int64_t i_offset )
+{
+    const size_t i_size = p_index->i_packet_size;
+    size_t i = 0;
+
+    while( i + i_size <= i_data )
+    {
+        if( p_data[i] != 0x47 ||
+            ( i + 2 * i_size <= i_data && p_data[i + i_size] != 0x47 ) )
+        {
+            i++;
+            continue;
+        }
+        PacketTS( p_index, &p_data[i], i_offset + i );
+        i += i_size;
+    }
+    return i;
+}
+
+static size_t ParsePS( mpeg_index_t *p_index, const uint8_t *p_data,
+                       size_t i_data, int64_t i_offset )
+{
+    size_t i = 0;
+
+    while( i + 6 <= i_data )
+    {
+        const uint8_t *p = &p_data[i];
+        const size_t i_left = i_data - i;
+        size_t i_size;
+
+        if( p[0] != 0 || p[1] != 0 || p[2] != 1 || p[3] < 0xb9 )
+        {
+            i++;
+            continue;
+        }
+
+        if( p[3] == 0xb9 )
+        {
+            i_size = 4;
+        }
+        else if( p[3] == 0xba )
+        {
+            int64_t i_scr;
+
+            if( i_left < 14 )
+                break;
+            if( (p[4] >> 6) == 0x01 )
+            {
+                i_size = 14 + (p[13] & 0x07);
+                i_scr = ( (int64_t)(p[4] & 0x38) << 27 ) |
+                        ( (int64_t)(p[4] & 0x03) << 28 ) |
+                        ( (int64_t)p[5] << 20 ) |
+                        ( (int64_t)(p[6] & 0xf8) << 12 ) |
+                        ( (int64_t)(p[6] & 0x03) << 13 ) |
+                        ( (int64_t)p[7] << 5 ) |
+                        ( (int64_t)p[8] >> 3 );
+            }
+            else if( (p[4] >> 4) == 0x02 )
+            {
+                i_size = 12;
+                i_scr = ( (int64_t)(p[4] & 0x0e) << 29 ) |
+                        ( (int64_t)p[5] << 22 ) |
+                        ( (int64_t)(p[6] & 0xfe) << 14 ) |
+                        ( (int64_t)p[7] << 7 ) |
+                        ( (int64_t)p[8] >> 1 );
+            }
+            else
+            {
+                i++;
+                continue;
+            }
+            if( i_left < i_size )
+                break;
+            Clock( p_index, i_scr * 100 / 9, i_offset + i );
+        }
+        else
+        {
+            i_size = 6 + GetWBE( &p[4] );
+            if( i_left < i_size )
+                break;
+            Pes( p_index, p, i_size, p[3] );
+        }
+        i += i_size;
+    }
+    return i;
+}
+
+size_t mpeg_index_Parse( mpeg_index_t *p_index, const uint8_t *p_data,
+                         size_t i_data, int64_t i_offset )
+{
+    size_t i_used = p_index->i_type == MPEG_INDEX_TS ?
+                    ParseTS( p_index, p_data, i_data, i_offset ) :
+                    ParsePS( p_index, p_data, i_data, i_offset );
+
+    vlc_mutex_lock( &p_index->lock );
+    p_index->i_scanned = i_offset + i_used;
+    vlc_mutex_unlock( &p_index->lock );
+    return i_used;
+}
+
+void mpeg_index_End( mpeg_index_t *p_index )
+{
+    if( p_index->b_candidate )
+    {
+        Append( p_index, &p_index->candidate );
+        p_index->b_candidate = false;
+    }
+    vlc_mutex_lock( &p_index->lock );
+    p_index->i_length = p_index->i_time;
+    p_index->b_complete = true;
+    vlc_mutex_unlock( &p_index->lock );
+}
+
+/*****************************************************************************
+ * Sidecar file
+ *****************************************************************************/
+static int SidecarLoad( mpeg_index_t *p_index )
+{
+    FILE *p_file = utf8_fopen( p_index->psz_sidecar, "rb" );
+    uint8_t p_header[SIDECAR_HEADER];
+    unsigned i_entries;
+
+    if( p_file == NULL )
+        return VLC_EGENERIC;
+
+    if( fread( p_header, SIDECAR_HEADER, 1, p_file ) != 1 ||
+        memcmp( p_header, SIDECAR_MAGIC, 8 ) ||
+        (int64_t)GetQWBE( &p_header[8] ) != p_index->i_file_size ||
+        (int64_t)GetQWBE( &p_header[16] ) != p_index->i_file_mtime ||
+        GetDWBE( &p_header[24] ) != (uint32_t)p_index->i_type ||
+        GetDWBE( &p_header[28] ) != (uint32_t)p_index->i_packet_size ||
+        GetDWBE( &p_header[36] ) != (uint32_t)p_index->i_pcr_pid )
+        goto error;
+
+    i_entries = GetDWBE( &p_header[32] );
+    p_index->p_entries = malloc( (i_entries ? i_entries : 1)
+                                 * sizeof(mpeg_index_entry_t) );
+    if( p_index->p_entries == NULL )
+        goto error;
+    p_index->i_alloc = i_entries;
+
+    for( unsigned i = 0; i < i_entries; i++ )
+    {
+        mpeg_index_entry_t *p_entry = &p_index->p_entries[i];
+        uint8_t p_buf[SIDECAR_ENTRY];
+
+        if( fread( p_buf, SIDECAR_ENTRY, 1, p_file ) != 1 )
+            goto error;
+        p_entry->i_time = GetQWBE( &p_buf[0] );
+        p_entry->i_clock = GetQWBE( &p_buf[8] );
+        p_entry->i_offset = GetQWBE( &p_buf[16] );
+        p_entry->i_flags = GetDWBE( &p_buf[24] );
+        if( p_entry->i_flags & MPEG_INDEX_RAP )
+            p_index->b_rap = true;
+    }
+    fclose( p_file );
+
+    p_index->i_entries = i_entries;
+    p_index->i_length = i_entries ? p_index->p_entries[i_entries-1].i_time : 0;
+    p_index->i_scanned = p_index->i_file_size;
+    p_index->b_complete = true;
+    return VLC_SUCCESS;
+
+error:
+    fclose( p_file );
+    free( p_index->p_entries );
+    p_index->p_entries = NULL;
+    p_index->i_alloc = 0;
+    p_index->b_rap = false;
+    return VLC_EGENERIC;
+}
+
+static void SidecarSave( mpeg_index_t *p_index )
+{
+    FILE *p_file = utf8_fopen( p_index->psz_sidecar, "wb" );
+    uint8_t p_header[SIDECAR_HEADER];
+
+    if( p_file == NULL )
+    {
+        msg_Dbg( p_index->p_obj, "cannot write index file %s: %m",
+                 p_index->psz_sidecar );
+        return;
+    }
+
+    memset( p_header, 0, sizeof(p_header) );
+    memcpy( p_header, SIDECAR_MAGIC, 8 );
+    SetQWBE( &p_header[8], p_index->i_file_size );
+    SetQWBE( &p_header[16], p_index->i_file_mtime );
+    SetDWBE( &p_header[24], p_index->i_type );
+    SetDWBE( &p_header[28], p_index->i_packet_size );
+    SetDWBE( &p_header[32], p_index->i_entries );
+    SetDWBE( &p_header[36], p_index->i_pcr_pid );
+    fwrite( p_header, SIDECAR_HEADER, 1, p_file );
+
+    for( unsigned i = 0; i < p_index->i_entries; i++ )
+    {
+        const mpeg_index_entry_t *p_entry = &p_index->p_entries[i];
+        uint8_t p_buf[SIDECAR_ENTRY];
+
+        SetQWBE( &p_buf[0], p_entry->i_time );
+        SetQWBE( &p_buf[8], p_entry->i_clock );
+        SetQWBE( &p_buf[16], p_entry->i_offset );
+        SetDWBE( &p_buf[24], p_entry->i_flags );
+        fwrite( p_buf, SIDECAR_ENTRY, 1, p_file );
+    }
+
+    if( fclose( p_file ) )
+    {
+        msg_Dbg( p_index->p_obj, "cannot write index file %s",
+                 p_index->psz_sidecar );
+        utf8_unlink( p_index->psz_sidecar );
+    }
+    else
+        msg_Dbg( p_index->p_obj, "saved %u index entries to %s",
+                 p_index->i_entries, p_index->psz_sidecar );
+}
+
+/*****************************************************************************
+ * Thread
+ *****************************************************************************/
+static void *Thread( vlc_object_t *p_this )
+{
+    mpeg_index_thread_t *p_thread = (mpeg_index_thread_t *)p_this;
+    mpeg_index_t *p_index = p_thread->p_index;
+    uint8_t *p_buffer = malloc( SCAN_BUFFER );
+    size_t i_buffer = 0;
+    int64_t i_offset = 0;
+
+    if( p_buffer == NULL )
+        return NULL;
+
+    while( vlc_object_alive( p_thread ) )
+    {
+        ssize_t i_read = read( p_thread->fd, &p_buffer[i_buffer],
+                               SCAN_BUFFER - i_buffer );
+        size_t i_used;
+
+        if( i_read < 0 && errno == EINTR )
+            continue;
+        if( i_read <= 0 )
+        {
+            mpeg_index_End( p_index );
+            msg_Dbg( p_thread, "indexed %"PRId64" bytes in %u entries, "
+                     "length %"PRId64" us", i_offset + i_buffer,
+                     p_index->i_entries, p_index->i_length );
+            break;
+        }
+        i_buffer += i_read;
+
+        i_used = mpeg_index_Parse( p_index, p_buffer, i_buffer, i_offset );
+        if( i_used == 0 && i_buffer == SCAN_BUFFER )
+            i_used = 1; /* cannot happen with a large enough buffer */
+        memmove( p_buffer, &p_buffer[i_used], i_buffer - i_used );
+        i_buffer -= i_used;
+        i_offset += i_used;
+    }
+
+    free( p_buffer );
+    return NULL;
+}
+
+/* The clock of the first (or last) entry of SCAN_BUFFER bytes at i_offset */
+static int64_t ProbeClock( mpeg_index_t *p_index, uint8_t *p_buffer, int fd,
+                           int64_t i_offset, bool b_last )
+{
+    mpeg_index_t *p_probe;
+    mpeg_index_entry_t *p_entries;
+    unsigned i_entries;
+    ssize_t i_read;
+    int64_t i_clock = -1;
+
+    if( lseek( fd, i_offset, SEEK_SET ) != i_offset )
+        return -1;
+    i_read = read( fd, p_buffer, SCAN_BUFFER );
+    if( i_read <= 0 )
+        return -1;
+
+    p_probe = mpeg_index_Create( p_index->p_obj, p_index->i_type,
+                                 p_index->i_packet_size );
+    if( p_probe == NULL )
+        return -1;
+    p_probe->i_pcr_pid = p_index->i_pcr_pid;
+    mpeg_index_Parse( p_probe, p_buffer, i_read, i_offset );
+    mpeg_index_End( p_probe );
+    i_entries = mpeg_index_Entries( p_probe, &p_entries );
+    if( i_entries > 0 )
+        i_clock = p_entries[b_last ? i_entries - 1 : 0].i_clock;
+    free( p_entries );
+    mpeg_index_Delete( p_probe );
+    return i_clock;
+}
+
+/* Estimate the length from the clocks at both ends of the file, so that it
+ * is known before the scan gets there */
+static void ProbeLength( mpeg_index_t *p_index, int fd )
+{
+    uint8_t *p_buffer = malloc( SCAN_BUFFER );
+    int64_t i_first, i_last = -1;
+
+    if( p_buffer == NULL )
+        return;
+    i_first = ProbeClock( p_index, p_buffer, fd, 0, false );
+    if( i_first >= 0 )
+        i_last = ProbeClock( p_index, p_buffer, fd,
+                             __MAX( p_index->i_file_size - SCAN_BUFFER, 0 ),
+                             true );
+    if( i_last >= 0 )
+    {
+        int64_t i_length = i_last - i_first;
+
+        if( i_length < 0 )
+            i_length += CLOCK_WRAP;
+        p_index->i_length_probe = i_length;
+    }
+    lseek( fd, 0, SEEK_SET );
+    free( p_buffer );
+}
+
+/*****************************************************************************
+ * Public functions
+ *****************************************************************************/
+mpeg_index_t *mpeg_index_Create( vlc_object_t *p_obj, int i_type,
+                                 int i_packet_size )
+{
+    mpeg_index_t *p_index = calloc( 1, sizeof(*p_index) );
+
+    if( p_index == NULL )
+        return NULL;
+    p_index->p_obj = p_obj;
+    p_index->i_type = i_type;
+    p_index->i_packet_size = i_type == MPEG_INDEX_TS ? i_packet_size : 0;
+    p_index->i_pcr_pid = -1;
+    p_index->i_video_id = -1;
+    vlc_mutex_init( &p_index->lock );
+    return p_index;
+}
+
+mpeg_index_t *mpeg_index_New( demux_t *p_demux, int i_type,
+                              int i_packet_size, int i_pcr_pid,
+                              bool b_sidecar )
+{
+    mpeg_index_t *p_index;
+    mpeg_index_thread_t *p_thread;
+    struct stat st;
+    int fd;
+
+    /* Only local files are read a second time */
+    if( ( *p_demux->psz_access && strcmp( p_demux->psz_access, "file" ) ) ||
+        !strcmp( p_demux->psz_path, "-" ) ||
+        utf8_stat( p_demux->psz_path, &st ) || !S_ISREG( st.st_mode ) )
+        return NULL;
+
+    p_index = mpeg_index_Create( VLC_OBJECT(p_demux), i_type, i_packet_size );
+    if( p_index == NULL )
+        return NULL;
+    if( i_type == MPEG_INDEX_TS )
+        p_index->i_pcr_pid = i_pcr_pid;
+    p_index->i_file_size = st.st_size;
+    p_index->i_file_mtime = st.st_mtime;
+
+    if( b_sidecar &&
+        asprintf( &p_index->psz_sidecar, "%s"SIDECAR_EXT,
+                  p_demux->psz_path ) == -1 )
+        p_index->psz_sidecar = NULL;
+    if( p_index->psz_sidecar && !SidecarLoad( p_index ) )
+    {
+        msg_Dbg( p_demux, "loaded %u index entries from %s",
+                 p_index->i_entries, p_index->psz_sidecar );
+        /* Nothing to save back */
+        free( p_index->psz_sidecar );
+        p_index->psz_sidecar = NULL;
+        return p_index;
+    }
+
+    fd = utf8_open( p_demux->psz_path, O_RDONLY, 0666 );
+    if( fd == -1 )
+    {
+        mpeg_index_Delete( p_index );
+        return NULL;
+    }
+    ProbeLength( p_index, fd );
+
+    p_thread = vlc_object_create( p_demux, sizeof(*p_thread) );
+    if( p_thread == NULL )
+    {
+        close( fd );
+        mpeg_index_Delete( p_index );
+        return NULL;
+    }
+    p_thread->p_index = p_index;
+    p_thread->fd = fd;
+    if( vlc_thread_create( p_thread, "mpeg index", Thread,
+                           VLC_THREAD_PRIORITY_LOW, false ) )
+    {
+        msg_Err( p_demux, "cannot start the index thread" );
+        vlc_object_release( p_thread );
+        close( fd );
+        mpeg_index_Delete( p_index );
+        return NULL;
+    }
+    p_index->p_thread = p_thread;
+    return p_index;
+}
+
+void mpeg_index_Delete( mpeg_index_t *p_index )
+{
+    if( p_index->p_thread )
+    {
+        vlc_object_kill( p_index->p_thread );
+        vlc_thread_join( p_index->p_thread );
+        close( p_index->p_thread->fd );
+        vlc_object_release( p_index->p_thread );
+
+        if( p_index->psz_sidecar && p_index->b_complete )
+            SidecarSave( p_index );
+    }
+
+    vlc_mutex_destroy( &p_index->lock );
+    free( p_index->psz_sidecar );
+    free( p_index->p_entries );
+    free( p_index );
+}
+
+/* Last entry not after i_time, or -1. Please note that you must hold the
+ * lock. */
+static int Find( mpeg_index_t *p_index, int64_t i_time )
+{
+    int i_low = 0, i_high = (int)p_index->i_entries - 1;
+
+    if( i_high < 0 || p_index->p_entries[0].i_time > i_time )
+        return -1;
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high + 1 ) / 2;
+
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+    return i_low;
+}
+
+int mpeg_index_Seek( mpeg_index_t *p_index, int64_t i_time,
+                     int64_t *pi_offset, int64_t *pi_clock )
+{
+    int i, i_next;
+
+    vlc_mutex_lock( &p_index->lock );
+    i = Find( p_index, i_time );
+    /* Past the part of the file indexed so far */
+    if( i < 0 || ( !p_index->b_complete &&
+                   i == (int)p_index->i_entries - 1 ) )
+    {
+        vlc_mutex_unlock( &p_index->lock );
+        return VLC_EGENERIC;
+    }
+
+    i_next = i + 1;
+    if( p_index->b_rap )
+        while( i > 0 && !(p_index->p_entries[i].i_flags & MPEG_INDEX_RAP) )
+            i--;
+
+    const mpeg_index_entry_t *p_entry = &p_index->p_entries[i];
+    *pi_offset = p_entry->i_offset;
+    *pi_clock = p_entry->i_clock + i_time - p_entry->i_time;
+    if( *pi_clock >= CLOCK_WRAP )
+        *pi_clock -= CLOCK_WRAP;
+
+    /* The clock of i_time is only known if it did not jump since */
+    for( int j = i + 1; j <= i_next && j < (int)p_index->i_entries; j++ )
+        if( p_index->p_entries[j].i_flags & MPEG_INDEX_DISCONTINUITY )
+            *pi_clock = -1;
+    vlc_mutex_unlock( &p_index->lock );
+    return VLC_SUCCESS;
+}
+
+int mpeg_index_GetTime( mpeg_index_t *p_index, int64_t i_offset,
+                        int64_t *pi_time )
+{
+    int i_low = 0, i_high;
+
+    vlc_mutex_lock( &p_index->lock );
+    i_high = (int)p_index->i_entries - 1;
+    if( i_high < 0 || i_offset > p_index->i_scanned )
+    {
+        vlc_mutex_unlock( &p_index->lock );
+        return VLC_EGENERIC;
+    }
+
+    if( p_index->p_entries[0].i_offset > i_offset )
+        i_high = -1;
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high + 1 ) / 2;
+
+        if( p_index->p_entries[i_mid].i_offset <= i_offset )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+
+    if( i_high < 0 )
+        *pi_time = 0;
+    else
+    {
+        const mpeg_index_entry_t *p_entry = &p_index->p_entries[i_high];
+        int64_t i_end_offset, i_end_time;
+
+        if( i_high + 1 < (int)p_index->i_entries )
+        {
+            i_end_offset = p_index->p_entries[i_high + 1].i_offset;
+            i_end_time = p_index->p_entries[i_high + 1].i_time;
+        }
+        else
+        {
+            /* Only while the candidate entry is pending */
+            i_end_offset = p_index->i_scanned;
+            i_end_time = p_index->b_complete ? p_index->i_length
+                                             : p_entry->i_time;
+        }
+
+        *pi_time = p_entry->i_time;
+        if( i_end_offset > p_entry->i_offset && i_offset > p_entry->i_offset )
+            *pi_time += ( i_end_time - p_entry->i_time )
+                        * ( i_offset - p_entry->i_offset )
+                        / ( i_end_offset - p_entry->i_offset );
+    }
+    vlc_mutex_unlock( &p_index->lock );
+    return VLC_SUCCESS;
+}
+
+int mpeg_index_GetLength( mpeg_index_t *p_index, int64_t *pi_length )
+{
+    int i_ret = VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_index->lock );
+    if( p_index->b_complete )
+        *pi_length = p_index->i_length;
+    else if( p_index->i_length_probe > 0 )
+        *pi_length = p_index->i_length_probe;
+    else if( p_index->i_entries > 0 && p_index->i_file_size > 0 &&
+             p_index->p_entries[p_index->i_entries-1].i_offset > 0 )
+    {
+        const mpeg_index_entry_t *p_last =
+            &p_index->p_entries[p_index->i_entries-1];
+
+        *pi_length = p_last->i_time * p_index->i_file_size
+                     / p_last->i_offset;
+    }
+    else
+        i_ret = VLC_EGENERIC;
+    vlc_mutex_unlock( &p_index->lock );
+    return i_ret;
+}
+
+unsigned mpeg_index_Entries( mpeg_index_t *p_index,
+                             mpeg_index_entry_t **pp_entries )
+{
+    unsigned i_entries;
+
+    vlc_mutex_lock( &p_index->lock );
+    i_entries = p_index->i_entries;
+    *pp_entries = malloc( (i_entries ? i_entries : 1)
+                          * sizeof(mpeg_index_entry_t) );
+    if( *pp_entries )
+        memcpy( *pp_entries, p_index->p_entries,
+                i_entries * sizeof(mpeg_index_entry_t) );
+    else
+        i_entries = 0;
+    vlc_mutex_unlock( &p_index->lock );
+    return i_entries;
+}
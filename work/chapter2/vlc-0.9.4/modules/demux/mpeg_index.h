@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * mpeg_index.h: time index of MPEG transport and program streams
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _MPEG_INDEX_H_
+#define _MPEG_INDEX_H_ 1
+
+/*
+ * A sparse index from the time of a local file to byte offsets, built from
+ * the PCR (TS) or SCR (PS) by a thread reading the file on its own. An
+ * entry is the offset of a clock reference, flagged as a random access
+ * point when the first video PES after it starts with a sequence header,
+ * a GOP or an I picture (MPEG video), or a SPS or an IDR (H.264). Clock
+ * wraps are unwrapped and jumps are skipped, so that the times of the
+ * entries grow with their offsets.
+ */
+
+#define MPEG_INDEX_TS 0
+#define MPEG_INDEX_PS 1
+
+/* Smallest time between two entries, in microseconds */
+#define MPEG_INDEX_INTERVAL INT64_C(1000000)
+
+typedef struct
+{
+    int64_t i_time;     /* from the first clock reference of the file */
+    int64_t i_clock;    /* the clock reference, as the demuxers send it */
+    int64_t i_offset;   /* of the packet holding the clock reference */
+    uint32_t i_flags;
+} mpeg_index_entry_t;
+
+#define MPEG_INDEX_RAP          0x01 /* a random access point follows */
+#define MPEG_INDEX_DISCONTINUITY 0x02 /* the clock jumped before this one */
+
+typedef struct mpeg_index_t mpeg_index_t;
+
+/* Index the file of the demuxer if it is a local one, with a sidecar file
+ * next to it to load the index from or save it to if b_sidecar. TS packets
+ * are i_packet_size bytes long, and the clock is the PCR of i_pcr_pid, the
+ * one of the program being played (-1 for the first PID with a PCR). */
+mpeg_index_t *mpeg_index_New( demux_t *, int i_type, int i_packet_size,
+                              int i_pcr_pid, bool b_sidecar );
+void mpeg_index_Delete( mpeg_index_t * );
+
+/* The entry to seek to for i_time: the last random access point (or entry
+ * if the stream has no video) not after it. *pi_clock is the clock value
+ * of i_time, or -1 if it cannot be told because of a clock jump. */
+int mpeg_index_Seek( mpeg_index_t *, int64_t i_time, int64_t *pi_offset,
+                     int64_t *pi_clock );
+/* The time at a byte offset, interpolated between entries */
+int mpeg_index_GetTime( mpeg_index_t *, int64_t i_offset, int64_t *pi_time );
+/* The length, estimated from the clocks at both ends of the file, or from
+ * the bytes scanned, until the scan ends */
+int mpeg_index_GetLength( mpeg_index_t *, int64_t *pi_length );
+
+/* Used by the thread, and by tests: index i_data bytes found at i_offset,
+ * returning how many of them were used; the others must be given again
+ * with the next ones. mpeg_index_End() records the last clock. */
+mpeg_index_t *mpeg_index_Create( vlc_object_t *, int i_type,
+                                 int i_packet_size );
+size_t mpeg_index_Parse( mpeg_index_t *, const uint8_t *p_data,
+                         size_t i_data, int64_t i_offset );
+void mpeg_index_End( mpeg_index_t * );
+/* Copy of the entries, to be freed */
+unsigned mpeg_index_Entries( mpeg_index_t *, mpeg_index_entry_t ** );
+
+#endif
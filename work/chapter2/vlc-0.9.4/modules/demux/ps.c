@@ -34,6 +34,7 @@
 #include <vlc_demux.h>
 
 #include "ps.h"
+#include "mpeg_index.h"
 
 /* TODO:
  *  - re-add pre-scanning.
@@ -45,6 +46,16 @@
     "to calculate position and duration. However sometimes this might not " \
     "be usable. Disable this option to calculate from the bitrate instead." )
 
+#define INDEX_TEXT N_("Time index")
+#define INDEX_LONGTEXT N_( \
+    "Index the SCR of local files in the background, for accurate time " \
+    "seeking and length." )
+
+#define INDEX_FILE_TEXT N_("Save the time index")
+#define INDEX_FILE_LONGTEXT N_( \
+    "Keep the time index in a .vlcidx file next to the stream, so that it " \
+    "does not have to be built again the next time." )
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -62,6 +73,9 @@ vlc_module_begin();
 
     add_bool( "ps-trust-timestamps", true, NULL, TIME_TEXT,
                  TIME_LONGTEXT, true );
+    add_bool( "ps-time-index", true, NULL, INDEX_TEXT, INDEX_LONGTEXT, true );
+    add_bool( "ps-index-file", false, NULL, INDEX_FILE_TEXT,
+              INDEX_FILE_LONGTEXT, true );
 
     add_submodule();
     set_description( N_("MPEG-PS demuxer") );
@@ -87,6 +101,9 @@ struct demux_sys_t
     bool  b_lost_sync;
     bool  b_have_pack;
     bool  b_seekable;
+
+    /* Time index of local files */
+    mpeg_index_t *p_index;
 };
 
 static int Demux  ( demux_t *p_demux );
@@ -144,6 +161,12 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
 
     /* TODO prescanning of ES */
 
+    p_sys->p_index = NULL;
+    if( p_sys->b_seekable && var_CreateGetBool( p_demux, "ps-time-index" ) )
+        p_sys->p_index = mpeg_index_New( p_demux, MPEG_INDEX_PS, 0, -1,
+                                         var_CreateGetBool( p_demux,
+                                                            "ps-index-file" ) );
+
     return VLC_SUCCESS;
 }
 
@@ -178,6 +201,9 @@ static void Close( vlc_object_t *p_this )
 
     ps_psm_destroy( &p_sys->psm );
 
+    if( p_sys->p_index )
+        mpeg_index_Delete( p_sys->p_index );
+
     free( p_sys );
 }
 
@@ -455,6 +481,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_TIME:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            if( p_sys->p_index &&
+                !mpeg_index_GetTime( p_sys->p_index,
+                                     stream_Tell( p_demux->s ), pi64 ) )
+                return VLC_SUCCESS;
             if( p_sys->i_time_track >= 0 && p_sys->i_current_pts > 0 )
             {
                 *pi64 = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track].i_first_pts;
@@ -471,6 +501,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_LENGTH:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            if( p_sys->p_index &&
+                !mpeg_index_GetLength( p_sys->p_index, pi64 ) )
+                return VLC_SUCCESS;
             if( p_sys->i_length > 0 )
             {
                 *pi64 = p_sys->i_length;
@@ -487,6 +520,30 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
+            if( p_sys->p_index )
+            {
+                int64_t i_offset, i_clock;
+                int i;
+
+                if( mpeg_index_Seek( p_sys->p_index, i64, &i_offset, &i_clock )
+                 || stream_Seek( p_demux->s, i_offset ) )
+                    return VLC_EGENERIC;
+
+                p_sys->i_current_pts = 0;
+                p_sys->b_lost_sync = false;
+                es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
+                /* Decode from the random access point, but only display
+                 * from the requested time */
+                for( i = 0; i_clock >= 0 && i < PS_TK_COUNT; i++ )
+                {
+                    ps_track_t *tk = &p_sys->tk[i];
+                    if( tk->b_seen && tk->es )
+                        es_out_Control( p_demux->out,
+                                        ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                        tk->es, i_clock );
+                }
+                return VLC_SUCCESS;
+            }
             if( p_sys->i_time_track >= 0 && p_sys->i_current_pts > 0 )
             {
                 int64_t i_now = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track].i_first_pts;
@@ -117,21 +117,34 @@ enum
                          and Gnome subtitles SubViewer 1.0 */
 };
 
+/* The lines of the file, read as the parsers ask for them. Only the lines
+ * of the subtitle being parsed are kept. */
 typedef struct
 {
-    int     i_line_count;
-    int     i_line;
+    stream_t *s;
+    bool    b_eof;
+
+    int     i_line_count;   /* lines read */
+    int     i_line;         /* next line to return */
+    int     i_line_first;   /* line[0], the lines before it are freed */
+    int     i_line_max;
     char    **line;
 } text_t;
 
-static int  TextLoad( text_t *, stream_t *s );
+static void TextInit( text_t *, stream_t *s );
 static void TextUnload( text_t * );
+static void TextFlush( text_t * );
 
 typedef struct
 {
     int64_t i_start;
     int64_t i_stop;
 
+    /* The largest i_start, and i_start or i_stop, of the subtitles up to
+     * this one: they are not always in order, and the seeks search these */
+    int64_t i_start_max;
+    int64_t i_end_max;
+
     char    *psz_text;
 } subtitle_t;
 
@@ -148,8 +161,13 @@ struct demux_sys_t
     char        *psz_header;
     int         i_subtitle;
     int         i_subtitles;
+    int         i_subtitles_max;
     subtitle_t  *subtitle;
 
+    /* The subtitles are parsed as they are needed */
+    int         (*pf_read)( demux_t *, subtitle_t*, int );
+    bool        b_parsed;
+
     int64_t     i_length;
 
     /* */
@@ -219,6 +237,10 @@ static const struct
 static int Demux( demux_t * );
 static int Control( demux_t *, int, va_list );
 
+static bool ParseNext( demux_t * );
+static subtitle_t *SubtitleGet( demux_t *, int );
+static int  SubtitleSearch( demux_sys_t *, int64_t, bool );
+
 /*static void Fix( demux_t * );*/
 
 /*****************************************************************************
@@ -231,8 +253,7 @@ static int Open ( vlc_object_t *p_this )
     es_format_t    fmt;
     float          f_fps;
     char           *psz_type;
-    int  (*pf_read)( demux_t *, subtitle_t*, int );
-    int            i, i_max;
+    int            i;
 
     if( !p_demux->b_force )
     {
@@ -249,7 +270,10 @@ static int Open ( vlc_object_t *p_this )
     p_sys->psz_header         = NULL;
     p_sys->i_subtitle         = 0;
     p_sys->i_subtitles        = 0;
+    p_sys->i_subtitles_max    = 0;
     p_sys->subtitle           = NULL;
+    p_sys->b_parsed           = false;
+    p_sys->i_length           = 0;
     p_sys->i_microsecperframe = 40000;
 
     p_sys->jss.b_inited       = false;
@@ -450,53 +474,15 @@ static int Open ( vlc_object_t *p_this )
         {
             msg_Dbg( p_demux, "detected %s format",
                      sub_read_subtitle_function[i].psz_name );
-            pf_read = sub_read_subtitle_function[i].pf_read;
+            p_sys->pf_read = sub_read_subtitle_function[i].pf_read;
             break;
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
-
-    /* Load the whole file */
-    TextLoad( &p_sys->txt, p_demux->s );
-
-    /* Parse it */
-    for( i_max = 0;; )
-    {
-        if( p_sys->i_subtitles >= i_max )
-        {
-            i_max += 500;
-            if( !( p_sys->subtitle = realloc( p_sys->subtitle,
-                                              sizeof(subtitle_t) * i_max ) ) )
-            {
-                free( p_sys->subtitle );
-                TextUnload( &p_sys->txt );
-                free( p_sys );
-                return VLC_ENOMEM;
-            }
-        }
-
-        if( pf_read( p_demux, &p_sys->subtitle[p_sys->i_subtitles],
-                     p_sys->i_subtitles ) )
-            break;
-
-        p_sys->i_subtitles++;
-    }
-    /* Unload */
-    TextUnload( &p_sys->txt );
-
-    msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
-
-    /* Fix subtitle (order and time) *** */
-    p_sys->i_subtitle = 0;
-    p_sys->i_length = 0;
-    if( p_sys->i_subtitles > 0 )
-    {
-        p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_stop;
-        /* +1 to avoid 0 */
-        if( p_sys->i_length <= 0 )
-            p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_start+1;
-    }
+    /* The rest of the file is parsed as the subtitles are needed, the
+     * first subtitle comes after the header of the SSA formats */
+    TextInit( &p_sys->txt, p_demux->s );
+    ParseNext( p_demux );
 
     /* *** add subtitle ES *** */
     if( p_sys->i_type == SUB_TYPE_SSA1 ||
@@ -528,9 +514,12 @@ static void Close( vlc_object_t *p_this )
     demux_sys_t *p_sys = p_demux->p_sys;
     int i;
 
+    if( !p_sys->b_parsed )
+        TextUnload( &p_sys->txt );
     for( i = 0; i < p_sys->i_subtitles; i++ )
         free( p_sys->subtitle[i].psz_text );
     free( p_sys->subtitle );
+    free( p_sys->psz_header );
 
     free( p_sys );
 }
@@ -548,12 +537,13 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     {
         case DEMUX_GET_LENGTH:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            while( ParseNext( p_demux ) );
             *pi64 = p_sys->i_length;
             return VLC_SUCCESS;
 
         case DEMUX_GET_TIME:
             pi64 = (int64_t*)va_arg( args, int64_t * );
-            if( p_sys->i_subtitle < p_sys->i_subtitles )
+            if( SubtitleGet( p_demux, p_sys->i_subtitle ) )
             {
                 *pi64 = p_sys->subtitle[p_sys->i_subtitle].i_start;
                 return VLC_SUCCESS;
@@ -562,25 +552,19 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles )
-            {
-                const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
-
-                if( p_subtitle->i_start > i64 )
-                    break;
-                if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
-                    break;
-
-                p_sys->i_subtitle++;
-            }
+            /* The first subtitle starting or still shown after i64 */
+            while( ( p_sys->i_subtitles <= 0 ||
+                     p_sys->subtitle[p_sys->i_subtitles-1].i_end_max <= i64 )
+                   && ParseNext( p_demux ) );
 
+            p_sys->i_subtitle = SubtitleSearch( p_sys, i64, false );
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
             return VLC_SUCCESS;
 
         case DEMUX_GET_POSITION:
             pf = (double*)va_arg( args, double * );
+            while( ParseNext( p_demux ) );
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
             {
                 *pf = 1.0;
@@ -598,14 +582,10 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_POSITION:
             f = (double)va_arg( args, double );
+            while( ParseNext( p_demux ) );
             i64 = f * p_sys->i_length;
 
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles &&
-                   p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
-            {
-                p_sys->i_subtitle++;
-            }
+            p_sys->i_subtitle = SubtitleSearch( p_sys, i64, true );
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
             return VLC_SUCCESS;
@@ -635,21 +615,21 @@ static int Demux( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
     int64_t i_maxdate;
 
-    if( p_sys->i_subtitle >= p_sys->i_subtitles )
+    const subtitle_t *p_subtitle;
+
+    if( ( p_subtitle = SubtitleGet( p_demux, p_sys->i_subtitle ) ) == NULL )
         return 0;
 
     i_maxdate = p_sys->i_next_demux_date - var_GetTime( p_demux->p_parent, "spu-delay" );;
-    if( i_maxdate <= 0 && p_sys->i_subtitle < p_sys->i_subtitles )
+    if( i_maxdate <= 0 )
     {
         /* Should not happen */
-        i_maxdate = p_sys->subtitle[p_sys->i_subtitle].i_start + 1;
+        i_maxdate = p_subtitle->i_start + 1;
     }
 
-    while( p_sys->i_subtitle < p_sys->i_subtitles &&
-           p_sys->subtitle[p_sys->i_subtitle].i_start < i_maxdate )
+    while( ( p_subtitle = SubtitleGet( p_demux, p_sys->i_subtitle ) ) &&
+           p_subtitle->i_start < i_maxdate )
     {
-        const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
-
         block_t *p_block;
         int i_len = strlen( p_subtitle->psz_text ) + 1;
 
@@ -683,6 +663,97 @@ static int Demux( demux_t *p_demux )
     return 1;
 }
 
+/*****************************************************************************
+ * ParseNext: parse one more subtitle, returns false after the last one
+ *****************************************************************************/
+static bool ParseNext( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    subtitle_t *p_subtitle;
+
+    if( p_sys->b_parsed )
+        return false;
+
+    if( p_sys->i_subtitles >= p_sys->i_subtitles_max )
+    {
+        subtitle_t *p_new = realloc( p_sys->subtitle, sizeof(subtitle_t) *
+                                     ( p_sys->i_subtitles_max + 500 ) );
+        if( p_new == NULL )
+            goto parsed;
+        p_sys->subtitle = p_new;
+        p_sys->i_subtitles_max += 500;
+    }
+
+    p_subtitle = &p_sys->subtitle[p_sys->i_subtitles];
+    if( p_sys->pf_read( p_demux, p_subtitle, p_sys->i_subtitles ) )
+        goto parsed;
+
+    p_subtitle->i_start_max = p_subtitle->i_start;
+    p_subtitle->i_end_max = __MAX( p_subtitle->i_start, p_subtitle->i_stop );
+    if( p_sys->i_subtitles > 0 )
+    {
+        const subtitle_t *p_prev = &p_subtitle[-1];
+        p_subtitle->i_start_max = __MAX( p_subtitle->i_start_max,
+                                         p_prev->i_start_max );
+        p_subtitle->i_end_max = __MAX( p_subtitle->i_end_max,
+                                       p_prev->i_end_max );
+    }
+    p_sys->i_subtitles++;
+
+    TextFlush( &p_sys->txt );
+    return true;
+
+parsed:
+    TextUnload( &p_sys->txt );
+    p_sys->b_parsed = true;
+
+    msg_Dbg( p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+
+    if( p_sys->i_subtitles > 0 )
+    {
+        p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_stop;
+        /* +1 to avoid 0 */
+        if( p_sys->i_length <= 0 )
+            p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_start+1;
+    }
+    return false;
+}
+
+static subtitle_t *SubtitleGet( demux_t *p_demux, int i_subtitle )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    while( i_subtitle >= p_sys->i_subtitles )
+    {
+        if( !ParseNext( p_demux ) )
+            return NULL;
+    }
+    return &p_sys->subtitle[i_subtitle];
+}
+
+/*****************************************************************************
+ * SubtitleSearch: the first parsed subtitle starting at or after i_time if
+ * b_start, else starting or ending after i_time. Returns i_subtitles if none.
+ *****************************************************************************/
+static int SubtitleSearch( demux_sys_t *p_sys, int64_t i_time, bool b_start )
+{
+    int i_low = 0;
+    int i_high = p_sys->i_subtitles;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+        const subtitle_t *p_subtitle = &p_sys->subtitle[i_mid];
+
+        if( b_start ? p_subtitle->i_start_max >= i_time
+                    : p_subtitle->i_end_max > i_time )
+            i_high = i_mid;
+        else
+            i_low = i_mid + 1;
+    }
+    return i_low;
+}
+
 /*****************************************************************************
  * Fix: fix time stamp and order of subtitle
  *****************************************************************************/
@@ -722,65 +793,98 @@ static void Fix( demux_t *p_demux )
 }
 #endif
 
-static int TextLoad( text_t *txt, stream_t *s )
+static void TextInit( text_t *txt, stream_t *s )
 {
-    int   i_line_max;
-
-    /* init txt */
-    i_line_max          = 500;
+    txt->s              = s;
+    txt->b_eof          = false;
     txt->i_line_count   = 0;
     txt->i_line         = 0;
-    txt->line           = calloc( i_line_max, sizeof( char * ) );
+    txt->i_line_first   = 0;
+    txt->i_line_max     = 0;
+    txt->line           = NULL;
+}
+static void TextUnload( text_t *txt )
+{
+    int i;
 
-    /* load the complete file */
-    for( ;; )
+    for( i = txt->i_line_first; i < txt->i_line_count; i++ )
     {
-        char *psz = stream_ReadLine( s );
+        free( txt->line[i - txt->i_line_first] );
+    }
+    free( txt->line );
+    txt->line         = NULL;
+    txt->i_line       = 0;
+    txt->i_line_count = 0;
+    txt->i_line_first = 0;
+    txt->i_line_max   = 0;
+}
 
-        if( psz == NULL )
-            break;
+/* Reads one more line, returns false at the end of the file */
+static bool TextRead( text_t *txt )
+{
+    char *psz;
 
-        txt->line[txt->i_line_count++] = psz;
-        if( txt->i_line_count >= i_line_max )
-        {
-            i_line_max += 100;
-            txt->line = realloc( txt->line, i_line_max * sizeof( char * ) );
-        }
-    }
+    if( txt->b_eof )
+        return false;
 
-    if( txt->i_line_count <= 0 )
+    psz = stream_ReadLine( txt->s );
+    if( psz == NULL )
     {
-        free( txt->line );
-        return VLC_EGENERIC;
+        txt->b_eof = true;
+        return false;
     }
 
-    return VLC_SUCCESS;
+    if( txt->i_line_count - txt->i_line_first >= txt->i_line_max )
+    {
+        char **line = realloc( txt->line,
+                               ( txt->i_line_max + 100 ) * sizeof( char * ) );
+        if( line == NULL )
+        {
+            free( psz );
+            txt->b_eof = true;
+            return false;
+        }
+        txt->line = line;
+        txt->i_line_max += 100;
+    }
+    txt->line[txt->i_line_count++ - txt->i_line_first] = psz;
+    return true;
 }
-static void TextUnload( text_t *txt )
+
+/* Frees the lines before the last one returned, that the next parsers
+ * will not look at */
+static void TextFlush( text_t *txt )
 {
+    int i_drop = txt->i_line - 1 - txt->i_line_first;
     int i;
 
-    for( i = 0; i < txt->i_line_count; i++ )
-    {
+    if( i_drop <= 0 )
+        return;
+
+    for( i = 0; i < i_drop; i++ )
         free( txt->line[i] );
-    }
-    free( txt->line );
-    txt->i_line       = 0;
-    txt->i_line_count = 0;
+    memmove( &txt->line[0], &txt->line[i_drop],
+             ( txt->i_line_count - txt->i_line_first - i_drop ) *
+             sizeof( char * ) );
+    txt->i_line_first += i_drop;
 }
 
 static char *TextGetLine( text_t *txt )
 {
-    if( txt->i_line >= txt->i_line_count )
+    if( txt->i_line >= txt->i_line_count && !TextRead( txt ) )
         return( NULL );
 
-    return txt->line[txt->i_line++];
+    return txt->line[txt->i_line++ - txt->i_line_first];
 }
 static void TextPreviousLine( text_t *txt )
 {
-    if( txt->i_line > 0 )
+    if( txt->i_line > txt->i_line_first )
         txt->i_line--;
 }
+static bool TextIsEnd( text_t *txt )
+{
+    return txt->i_line >= txt->i_line_count && !TextRead( txt );
+}
 
 /*****************************************************************************
  * Specific Subtitle function
@@ -1380,7 +1484,7 @@ static int ParseAQT( demux_t *p_demux, subtitle_t *p_subtitle, int i_idx )
                  return VLC_ENOMEM;
             strcat( psz_text, s );
             strcat( psz_text, "\n" );
-            if( txt->i_line == txt->i_line_count )
+            if( TextIsEnd( txt ) )
                 break;
         }
     }
@@ -45,6 +45,7 @@
 #include <vlc_charset.h>
 
 #include "../mux/mpeg/csa.h"
+#include "mpeg_index.h"
 
 /* Include dvbpsi headers */
 #ifdef HAVE_DVBPSI_DR_H
@@ -150,6 +151,16 @@ static void Close ( vlc_object_t * );
     "If the file exists and this option is selected, the existing file " \
     "will not be overwritten." )
 
+#define INDEX_TEXT N_("Time index")
+#define INDEX_LONGTEXT N_( \
+    "Index the PCR of local files in the background, for accurate time " \
+    "seeking and length." )
+
+#define INDEX_FILE_TEXT N_("Save the time index")
+#define INDEX_FILE_LONGTEXT N_( \
+    "Keep the time index in a .vlcidx file next to the stream, so that it " \
+    "does not have to be built again the next time." )
+
 #define DUMPSIZE_TEXT N_("Dump buffer size")
 #define DUMPSIZE_LONGTEXT N_( \
     "Tweak the buffer size for reading and writing an integer number of packets." \
@@ -170,6 +181,9 @@ vlc_module_begin();
     add_string( "ts-csa2-ck", NULL, NULL, CSA_TEXT, CSA_LONGTEXT, true );
     add_integer( "ts-csa-pkt", 188, NULL, CPKT_TEXT, CPKT_LONGTEXT, true );
     add_bool( "ts-silent", 0, NULL, SILENT_TEXT, SILENT_LONGTEXT, true );
+    add_bool( "ts-time-index", true, NULL, INDEX_TEXT, INDEX_LONGTEXT, true );
+    add_bool( "ts-index-file", false, NULL, INDEX_FILE_TEXT,
+              INDEX_FILE_LONGTEXT, true );
 
     add_file( "ts-dump-file", NULL, NULL, TSDUMP_TEXT, TSDUMP_LONGTEXT, false );
         change_unsafe();
@@ -370,6 +384,13 @@ struct demux_sys_t
 
     /* */
     bool        b_meta;
+
+    /* Time index of local files, on the PCR of the program played */
+    mpeg_index_t *p_index;
+    bool        b_index;
+    bool        b_index_file;
+    int         i_index_program;    /* -1 for the first one */
+    int         i_index_pcr_pid;
 };
 
 static int Demux    ( demux_t *p_demux );
@@ -396,6 +417,8 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
 
+static void IndexUpdate( demux_t *p_demux );
+
 static iod_descriptor_t *IODNew( int , uint8_t * );
 static void              IODFree( iod_descriptor_t * );
 
@@ -784,6 +807,14 @@ static int Open( vlc_object_t *p_this )
     var_Get( p_demux, "ts-silent", &val );
     p_sys->b_silent = val.b_bool;
 
+    /* The index is started once the PCR PID of the program is known */
+    p_sys->p_index = NULL;
+    p_sys->b_index = !p_sys->b_file_out && !p_sys->b_udp_out &&
+                     var_CreateGetBool( p_demux, "ts-time-index" );
+    p_sys->b_index_file = var_CreateGetBool( p_demux, "ts-index-file" );
+    p_sys->i_index_program = -1;
+    p_sys->i_index_pcr_pid = -1;
+
     return VLC_SUCCESS;
 }
 
@@ -885,6 +916,9 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_file );
     p_sys->psz_file = NULL;
 
+    if( p_sys->p_index )
+        mpeg_index_Delete( p_sys->p_index );
+
     vlc_mutex_destroy( &p_sys->csa_lock );
     free( p_sys );
 }
@@ -1250,15 +1284,61 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 #else
         case DEMUX_GET_TIME:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            if( p_sys->p_index &&
+                !mpeg_index_GetTime( p_sys->p_index,
+                                     stream_Tell( p_demux->s ), pi64 ) )
+                return VLC_SUCCESS;
             if( DVBEventInformation( p_demux, pi64, NULL ) )
                 *pi64 = 0;
             return VLC_SUCCESS;
 
         case DEMUX_GET_LENGTH:
             pi64 = (int64_t*)va_arg( args, int64_t * );
+            if( p_sys->p_index &&
+                !mpeg_index_GetLength( p_sys->p_index, pi64 ) )
+                return VLC_SUCCESS;
             if( DVBEventInformation( p_demux, NULL, pi64 ) )
                 *pi64 = 0;
             return VLC_SUCCESS;
+
+        case DEMUX_SET_TIME:
+        {
+            int64_t i_offset, i_clock;
+
+            i64 = (int64_t)va_arg( args, int64_t );
+            if( !p_sys->p_index ||
+                mpeg_index_Seek( p_sys->p_index, i64, &i_offset, &i_clock ) ||
+                stream_Seek( p_demux->s, i_offset ) )
+                return VLC_EGENERIC;
+
+            es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
+            /* Decode from the random access point, but only display from
+             * the requested time */
+            if( i_clock >= 0 )
+            {
+                for( i_int = 0; i_int < 8192; i_int++ )
+                {
+                    ts_pid_t *pid = &p_sys->pid[i_int];
+                    int i_extra;
+
+                    if( !pid->b_valid || !pid->es )
+                        continue;
+                    if( pid->es->id )
+                        es_out_Control( p_demux->out,
+                                        ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                        pid->es->id, i_clock );
+                    for( i_extra = 0; i_extra < pid->i_extra_es; i_extra++ )
+                    {
+                        if( pid->extra_es[i_extra]->id )
+                            es_out_Control( p_demux->out,
+                                            ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                            pid->extra_es[i_extra]->id,
+                                            i_clock );
+                    }
+                }
+            }
+            return VLC_SUCCESS;
+        }
 #endif
         case DEMUX_SET_GROUP:
         {
@@ -1270,6 +1350,14 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             p_list = (vlc_list_t *)va_arg( args, vlc_list_t * );
             msg_Dbg( p_demux, "DEMUX_SET_GROUP %d %p", i_int, p_list );
 
+            if( i_int > 0 )
+                p_sys->i_index_program = i_int;
+            else if( p_list && p_list->i_count > 0 )
+                p_sys->i_index_program = p_list->p_values[0].i_int;
+            else
+                p_sys->i_index_program = -1;
+            IndexUpdate( p_demux );
+
             if( p_sys->b_dvb_control && i_int > 0 && i_int != p_sys->i_dvb_program )
             {
                 int i_pmt_pid = -1;
@@ -1387,7 +1475,6 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_GET_FPS:
-        case DEMUX_SET_TIME:
         default:
             return VLC_EGENERIC;
     }
@@ -1887,6 +1974,55 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     }
 }
 
+/*****************************************************************************
+ * IndexUpdate: (re)start the time index on the PCR of the program played
+ *****************************************************************************/
+static void IndexUpdate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int i_pcr_pid = -1;
+    int i, i_prg;
+
+    if( !p_sys->b_index )
+        return;
+
+    /* The selected program, or the first one with a PCR */
+    for( i = 0; i < p_sys->i_pmt && i_pcr_pid < 0; i++ )
+    {
+        for( i_prg = 0; i_prg < p_sys->pmt[i]->psi->i_prg; i_prg++ )
+        {
+            const ts_prg_psi_t *prg = p_sys->pmt[i]->psi->prg[i_prg];
+
+            if( prg->i_pid_pcr <= 0 || prg->i_pid_pcr == 0x1fff )
+                continue;
+            if( p_sys->i_index_program <= 0 ||
+                prg->i_number == p_sys->i_index_program )
+            {
+                i_pcr_pid = prg->i_pid_pcr;
+                break;
+            }
+        }
+    }
+
+    if( i_pcr_pid == p_sys->i_index_pcr_pid )
+        return;
+
+    /* An index on another clock would give the times of another program */
+    if( p_sys->p_index )
+    {
+        mpeg_index_Delete( p_sys->p_index );
+        p_sys->p_index = NULL;
+    }
+    p_sys->i_index_pcr_pid = i_pcr_pid;
+    if( i_pcr_pid < 0 )
+        return;
+
+    msg_Dbg( p_demux, "time index on the PCR of pid %d", i_pcr_pid );
+    p_sys->p_index = mpeg_index_New( p_demux, MPEG_INDEX_TS,
+                                     p_sys->i_packet_size, i_pcr_pid,
+                                     p_sys->b_index_file );
+}
+
 static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
 {
     const uint8_t *p = p_bk->p_buffer;
@@ -3077,6 +3213,7 @@ static void PMTCallBack( demux_t *p_demux, dvbpsi_pmt_t *p_pmt )
              p_pmt->i_program_number, p_pmt->i_version, p_pmt->i_pcr_pid );
     prg->i_pid_pcr = p_pmt->i_pcr_pid;
     prg->i_version = p_pmt->i_version;
+    IndexUpdate( p_demux );
 
     if( DVBProgramIsSelected( p_demux, prg->i_number ) )
     {
@@ -75,6 +75,8 @@
 
 #include <assert.h>
 
+#include "freetype_cache.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -112,6 +114,14 @@ static const char *const ppsz_sizes_text[] = {
 #define EFFECT_LONGTEXT N_("It is possible to apply effects to the rendered " \
 "text to improve its readability." )
 
+#define GLYPH_CACHE_TEXT N_("Glyph cache size (kB)")
+#define GLYPH_CACHE_LONGTEXT N_("Memory used to keep the rendered glyphs " \
+    "of the fonts from one text to the next." )
+#define TEXT_CACHE_TEXT N_("Text cache size (kB)")
+#define TEXT_CACHE_LONGTEXT N_("Memory used to keep the last rendered " \
+    "texts, so that a text rendered again, like the ones of the marquee, " \
+    "is only copied. 0 disables this cache." )
+
 #define EFFECT_BACKGROUND  1
 #define EFFECT_OUTLINE     2
 #define EFFECT_OUTLINE_FAT 3
@@ -159,6 +169,10 @@ vlc_module_begin();
 
     add_bool( "freetype-yuvp", 0, NULL, YUVP_TEXT,
               YUVP_LONGTEXT, true );
+    add_integer( "freetype-glyph-cache", 1024, NULL, GLYPH_CACHE_TEXT,
+                 GLYPH_CACHE_LONGTEXT, true );
+    add_integer( "freetype-text-cache", 2048, NULL, TEXT_CACHE_TEXT,
+                 TEXT_CACHE_LONGTEXT, true );
     set_capability( "text renderer", 100 );
     add_shortcut( "text" );
     set_callbacks( Create, Destroy );
@@ -191,7 +205,8 @@ static void YUVFromRGB( uint32_t i_argb,
 typedef struct line_desc_t line_desc_t;
 struct line_desc_t
 {
-    /** NULL-terminated list of glyphs making the string */
+    /** NULL-terminated list of glyphs making the string, which belong to
+     * the glyph cache */
     FT_BitmapGlyph *pp_glyphs;
     /** list of relative positions for the glyphs */
     FT_Vector      *p_glyph_pos;
@@ -242,6 +257,22 @@ static int Render( filter_t *, subpicture_region_t *, line_desc_t *, int, int);
 static void FreeLines( line_desc_t * );
 static void FreeLine( line_desc_t * );
 
+/* A rendered glyph, as kept in the glyph cache */
+typedef struct
+{
+    FT_BitmapGlyph p_glyph;
+    FT_BBox        size;    /* control box of the outline, in pixels */
+} ft_glyph_t;
+
+static int  GetGlyph( filter_t *, FT_Face, int, const ft_glyph_t ** );
+static void GlyphFree( void * );
+static size_t TextCacheKey( filter_t *, subpicture_region_t *, const char *,
+                            int, int, uint8_t ** );
+static int  TextCacheCopy( filter_t *, subpicture_region_t *, const void * );
+static void TextCachePut( filter_t *, subpicture_region_t *,
+                          const uint8_t *, size_t );
+static void CacheStats( filter_t *, const char *, ft_cache_t * );
+
 #ifdef HAVE_FONTCONFIG
 static vlc_object_t *FontBuilderAttach( filter_t *p_filter, vlc_mutex_t **pp_lock  );
 static void  FontBuilderDetach( filter_t *p_filter, vlc_object_t *p_fontbuilder );
@@ -280,6 +311,9 @@ struct filter_sys_t
     int                  i_font_attachments;
 
     vlc_object_t  *p_fontbuilder;
+
+    ft_cache_t    *p_glyph_cache;   /* of ft_glyph_t */
+    ft_cache_t    *p_text_cache;    /* of rendered regions, or NULL */
 };
 
 /*****************************************************************************
@@ -293,6 +327,7 @@ static int Create( vlc_object_t *p_this )
     filter_sys_t  *p_sys;
     char          *psz_fontfile = NULL;
     int            i_error;
+    int            i_cache;
     vlc_value_t    val;
 
     /* Allocate structure */
@@ -303,6 +338,8 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library = 0;
     p_sys->i_font_size = 0;
     p_sys->i_display_height = 0;
+    p_sys->p_glyph_cache = NULL;
+    p_sys->p_text_cache = NULL;
 
     var_Create( p_filter, "freetype-font",
                 VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -322,6 +359,20 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_font_color = __MAX( __MIN( val.i_int, 0xFFFFFF ), 0 );
     p_sys->i_effect = var_GetInteger( p_filter, "freetype-effect" );
 
+    /* Without room, the glyphs only live as long as the text using them */
+    i_cache = config_GetInt( p_filter, "freetype-glyph-cache" );
+    p_sys->p_glyph_cache = ft_cache_New( __MAX( i_cache, 0 ) * 1024,
+                                         GlyphFree );
+    if( !p_sys->p_glyph_cache )
+        goto error;
+    i_cache = config_GetInt( p_filter, "freetype-text-cache" );
+    if( i_cache > 0 )
+    {
+        p_sys->p_text_cache = ft_cache_New( i_cache * 1024, free );
+        if( !p_sys->p_text_cache )
+            goto error;
+    }
+
     /* Look what method was requested */
     var_Get( p_filter, "freetype-font", &val );
     psz_fontfile = val.psz_string;
@@ -397,6 +448,8 @@ static int Create( vlc_object_t *p_this )
     return VLC_SUCCESS;
 
  error:
+    if( p_sys->p_text_cache ) ft_cache_Delete( p_sys->p_text_cache );
+    if( p_sys->p_glyph_cache ) ft_cache_Delete( p_sys->p_glyph_cache );
     if( p_sys->p_face ) FT_Done_Face( p_sys->p_face );
     if( p_sys->p_library ) FT_Done_FreeType( p_sys->p_library );
     free( psz_fontfile );
@@ -432,6 +485,14 @@ static void Destroy( vlc_object_t *p_this )
      * even if no other library functions have been made since FcInit(),
      * so don't call it. */
 
+    if( p_sys->p_text_cache )
+    {
+        CacheStats( p_filter, "text", p_sys->p_text_cache );
+        ft_cache_Delete( p_sys->p_text_cache );
+    }
+    CacheStats( p_filter, "glyph", p_sys->p_glyph_cache );
+    ft_cache_Delete( p_sys->p_glyph_cache );
+
     FT_Done_Face( p_sys->p_face );
     FT_Done_FreeType( p_sys->p_library );
     free( p_sys );
@@ -1128,11 +1189,12 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     int i_font_color, i_font_alpha, i_font_size, i_red, i_green, i_blue;
     vlc_value_t val;
     int i_scale = 1000;
+    uint8_t *p_text_key = NULL;
+    size_t i_text_key = 0;
 
     FT_BBox line;
-    FT_BBox glyph_size;
     FT_Vector result;
-    FT_Glyph tmp_glyph;
+    const ft_glyph_t *p_glyph;
 
     /* Sanity check */
     if( !p_region_in || !p_region_out ) return VLC_EGENERIC;
@@ -1163,6 +1225,21 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     i_green = ( i_font_color & 0x0000FF00 ) >>  8;
     i_blue  =   i_font_color & 0x000000FF;
 
+    if( p_sys->p_text_cache )
+    {
+        i_text_key = TextCacheKey( p_filter, p_region_out, psz_string,
+                                   i_font_color, i_font_alpha, &p_text_key );
+        const void *p_text = p_text_key ?
+            ft_cache_Get( p_sys->p_text_cache, p_text_key, i_text_key ) : NULL;
+        if( p_text )
+        {
+            free( p_text_key );
+            p_region_out->i_x = p_region_in->i_x;
+            p_region_out->i_y = p_region_in->i_y;
+            return TextCacheCopy( p_filter, p_region_out, p_text );
+        }
+    }
+
     result.x =  result.y = 0;
     line.xMin = line.xMax = line.yMin = line.yMax = 0;
 
@@ -1260,7 +1337,6 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     psz_line_start = psz_unicode;
 
 #define face p_sys->p_face
-#define glyph face->glyph
 
     while( *psz_unicode )
     {
@@ -1309,35 +1385,17 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
         }
         p_line->p_glyph_pos[ i ].x = i_pen_x;
         p_line->p_glyph_pos[ i ].y = i_pen_y;
-        i_error = FT_Load_Glyph( face, i_glyph_index, FT_LOAD_DEFAULT );
-        if( i_error )
-        {
-            msg_Err( p_filter, "unable to render text FT_Load_Glyph returned"
-                               " %d", i_error );
+        if( GetGlyph( p_filter, face, i_glyph_index, &p_glyph ) )
             goto error;
-        }
-        i_error = FT_Get_Glyph( glyph, &tmp_glyph );
-        if( i_error )
-        {
-            msg_Err( p_filter, "unable to render text FT_Get_Glyph returned "
-                               "%d", i_error );
-            goto error;
-        }
-        FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, &glyph_size );
-        i_error = FT_Glyph_To_Bitmap( &tmp_glyph, ft_render_mode_normal, 0, 1);
-        if( i_error )
-        {
-            FT_Done_Glyph( tmp_glyph );
+        if( !p_glyph )
             continue;
-        }
-        p_line->pp_glyphs[ i ] = (FT_BitmapGlyph)tmp_glyph;
+        p_line->pp_glyphs[ i ] = p_glyph->p_glyph;
 
         /* Do rest */
-        line.xMax = p_line->p_glyph_pos[i].x + glyph_size.xMax -
-            glyph_size.xMin + ((FT_BitmapGlyph)tmp_glyph)->left;
+        line.xMax = p_line->p_glyph_pos[i].x + p_glyph->size.xMax -
+            p_glyph->size.xMin + p_glyph->p_glyph->left;
         if( line.xMax > (int)p_filter->fmt_out.video.i_visible_width - 20 )
         {
-            FT_Done_Glyph( (FT_Glyph)p_line->pp_glyphs[ i ] );
             p_line->pp_glyphs[ i ] = NULL;
             FreeLine( p_line );
             p_line = NewLine( strlen( psz_string ));
@@ -1374,11 +1432,11 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
             line.xMin = line.xMax = line.yMin = line.yMax = 0;
             continue;
         }
-        line.yMax = __MAX( line.yMax, glyph_size.yMax );
-        line.yMin = __MIN( line.yMin, glyph_size.yMin );
+        line.yMax = __MAX( line.yMax, p_glyph->size.yMax );
+        line.yMin = __MIN( line.yMin, p_glyph->size.yMin );
 
         i_previous = i_glyph_index;
-        i_pen_x += glyph->advance.x >> 6;
+        i_pen_x += p_glyph->p_glyph->root.advance.x >> 16;
         i++;
     }
 
@@ -1393,23 +1451,32 @@ static int RenderText( filter_t *p_filter, subpicture_region_t *p_region_out,
     result.y += line.yMax - line.yMin;
 
 #undef face
-#undef glyph
 
     p_region_out->i_x = p_region_in->i_x;
     p_region_out->i_y = p_region_in->i_y;
 
     if( config_GetInt( p_filter, "freetype-yuvp" ) )
-        Render( p_filter, p_region_out, p_lines, result.x, result.y );
+        i_error = Render( p_filter, p_region_out, p_lines,
+                          result.x, result.y );
     else
-        RenderYUVA( p_filter, p_region_out, p_lines, result.x, result.y );
+        i_error = RenderYUVA( p_filter, p_region_out, p_lines,
+                              result.x, result.y );
+
+    /* RenderYUVA() leaves empty texts alone */
+    if( p_text_key && !i_error && result.x > 0 && result.y > 0 )
+        TextCachePut( p_filter, p_region_out, p_text_key, i_text_key );
 
+    free( p_text_key );
     free( psz_unicode_orig );
     FreeLines( p_lines );
+    ft_cache_Trim( p_sys->p_glyph_cache );
     return VLC_SUCCESS;
 
  error:
+    free( p_text_key );
     free( psz_unicode_orig );
     FreeLines( p_lines );
+    ft_cache_Trim( p_sys->p_glyph_cache );
     return VLC_EGENERIC;
 }
 
@@ -1664,9 +1731,7 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
 
     while( *psz_unicode && ( *psz_unicode != '\n' ) )
     {
-        FT_BBox glyph_size;
-        FT_Glyph tmp_glyph;
-        int i_error;
+        const ft_glyph_t *p_glyph;
 
         int i_glyph_index = FT_Get_Char_Index( p_face, *psz_unicode++ );
         if( FT_HAS_KERNING( p_face ) && i_glyph_index
@@ -1680,29 +1745,13 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
         p_line->p_glyph_pos[ i ].x = *pi_pen_x;
         p_line->p_glyph_pos[ i ].y = i_pen_y;
 
-        i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT );
-        if( i_error )
-        {
-            msg_Err( p_filter,
-                   "unable to render text FT_Load_Glyph returned %d", i_error );
-            p_line->pp_glyphs[ i ] = NULL;
-            return VLC_EGENERIC;
-        }
-        i_error = FT_Get_Glyph( p_face->glyph, &tmp_glyph );
-        if( i_error )
+        if( GetGlyph( p_filter, p_face, i_glyph_index, &p_glyph ) )
         {
-            msg_Err( p_filter,
-                    "unable to render text FT_Get_Glyph returned %d", i_error );
             p_line->pp_glyphs[ i ] = NULL;
             return VLC_EGENERIC;
         }
-        FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, &glyph_size );
-        i_error = FT_Glyph_To_Bitmap( &tmp_glyph, FT_RENDER_MODE_NORMAL, 0, 1);
-        if( i_error )
-        {
-            FT_Done_Glyph( tmp_glyph );
+        if( !p_glyph )
             continue;
-        }
         if( b_uline )
         {
             float aOffset = FT_FLOOR(FT_MulFix(p_face->underline_position,
@@ -1715,17 +1764,15 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
             p_line->pi_underline_thickness[ i ] =
                                        ( aSize < 0 ) ? -aSize   : aSize;
         }
-        p_line->pp_glyphs[ i ] = (FT_BitmapGlyph)tmp_glyph;
+        p_line->pp_glyphs[ i ] = p_glyph->p_glyph;
         p_line->p_fg_rgb[ i ] = i_font_color & 0x00ffffff;
         p_line->p_bg_rgb[ i ] = i_karaoke_bgcolor & 0x00ffffff;
         p_line->p_fg_bg_ratio[ i ] = 0x00;
 
-        line.xMax = p_line->p_glyph_pos[i].x + glyph_size.xMax -
-                    glyph_size.xMin + ((FT_BitmapGlyph)tmp_glyph)->left;
+        line.xMax = p_line->p_glyph_pos[i].x + p_glyph->size.xMax -
+                    p_glyph->size.xMin + p_glyph->p_glyph->left;
         if( line.xMax > (int)p_filter->fmt_out.video.i_visible_width - 20 )
         {
-            for( ; i >= *pi_start; i-- )
-                FT_Done_Glyph( (FT_Glyph)p_line->pp_glyphs[ i ] );
             i = *pi_start;
 
             while( psz_unicode > psz_unicode_start && *psz_unicode != ' ' )
@@ -1765,11 +1812,11 @@ static int RenderTag( filter_t *p_filter, FT_Face p_face, int i_font_color,
 
             continue;
         }
-        line.yMax = __MAX( line.yMax, glyph_size.yMax );
-        line.yMin = __MIN( line.yMin, glyph_size.yMin );
+        line.yMax = __MAX( line.yMax, p_glyph->size.yMax );
+        line.yMin = __MIN( line.yMin, p_glyph->size.yMin );
 
         i_previous = i_glyph_index;
-        *pi_pen_x += p_face->glyph->advance.x >> 6;
+        *pi_pen_x += p_glyph->p_glyph->root.advance.x >> 16;
         i++;
     }
     p_line->i_width = line.xMax;
@@ -2777,6 +2824,7 @@ static int RenderHtml( filter_t *p_filter, subpicture_region_t *p_region_out,
                     }
                 }
                 FreeLines( p_lines );
+                ft_cache_Trim( p_filter->p_sys->p_glyph_cache );
 
                 xml_ReaderDelete( p_xml, p_xml_reader );
             }
@@ -2851,13 +2899,244 @@ static char* FontConfig_Select( FcConfig* priv, const char* family,
 }
 #endif
 
-static void FreeLine( line_desc_t *p_line )
+/*****************************************************************************
+ * GetGlyph: render a glyph of a face at its current size
+ *****************************************************************************
+ * The glyph comes from the glyph cache if it has been rendered already, and
+ * stays valid until the cache is trimmed. It is NULL if the glyph has no
+ * bitmap, in which case it is left out of the text.
+ *****************************************************************************/
+typedef struct
 {
-    unsigned int i;
-    for( i = 0; p_line->pp_glyphs[ i ] != NULL; i++ )
+    FT_Fixed i_x_scale;
+    FT_Fixed i_y_scale;
+    FT_Long  i_face_index;
+    FT_Long  i_style_flags;
+    FT_Long  i_num_glyphs;
+    FT_UInt  i_glyph_index;
+    char     psz_name[128];     /* family/style, truncated */
+} glyph_key_t;
+
+static int GetGlyph( filter_t *p_filter, FT_Face p_face, int i_glyph_index,
+                     const ft_glyph_t **pp_glyph )
+{
+    ft_cache_t *p_cache = p_filter->p_sys->p_glyph_cache;
+    glyph_key_t key;
+    size_t i_key;
+    ft_glyph_t *p_glyph;
+    FT_Glyph tmp_glyph;
+    int i_error;
+
+    /* The faces of the styled texts are opened for every run of text, so
+     * they are told apart by their names rather than their handles */
+    memset( &key, 0, sizeof(key) );
+    key.i_x_scale = p_face->size->metrics.x_scale;
+    key.i_y_scale = p_face->size->metrics.y_scale;
+    key.i_face_index = p_face->face_index;
+    key.i_style_flags = p_face->style_flags;
+    key.i_num_glyphs = p_face->num_glyphs;
+    key.i_glyph_index = i_glyph_index;
+    snprintf( key.psz_name, sizeof(key.psz_name), "%s/%s",
+              p_face->family_name ? p_face->family_name : "",
+              p_face->style_name ? p_face->style_name : "" );
+    i_key = offsetof( glyph_key_t, psz_name ) + strlen( key.psz_name );
+
+    *pp_glyph = ft_cache_Get( p_cache, &key, i_key );
+    if( *pp_glyph )
+        return VLC_SUCCESS;
+
+    i_error = FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT );
+    if( i_error )
     {
-        FT_Done_Glyph( (FT_Glyph)p_line->pp_glyphs[ i ] );
+        msg_Err( p_filter,
+               "unable to render text FT_Load_Glyph returned %d", i_error );
+        return VLC_EGENERIC;
     }
+    i_error = FT_Get_Glyph( p_face->glyph, &tmp_glyph );
+    if( i_error )
+    {
+        msg_Err( p_filter,
+                "unable to render text FT_Get_Glyph returned %d", i_error );
+        return VLC_EGENERIC;
+    }
+    p_glyph = malloc( sizeof(*p_glyph) );
+    if( !p_glyph )
+    {
+        FT_Done_Glyph( tmp_glyph );
+        return VLC_ENOMEM;
+    }
+    FT_Glyph_Get_CBox( tmp_glyph, ft_glyph_bbox_pixels, &p_glyph->size );
+    if( FT_Glyph_To_Bitmap( &tmp_glyph, FT_RENDER_MODE_NORMAL, 0, 1 ) )
+    {
+        FT_Done_Glyph( tmp_glyph );
+        free( p_glyph );
+        return VLC_SUCCESS;
+    }
+    p_glyph->p_glyph = (FT_BitmapGlyph)tmp_glyph;
+
+    if( ft_cache_Put( p_cache, &key, i_key, p_glyph, sizeof(*p_glyph) +
+                      sizeof(FT_BitmapGlyphRec) +
+                      abs( p_glyph->p_glyph->bitmap.pitch ) *
+                      p_glyph->p_glyph->bitmap.rows ) )
+    {
+        GlyphFree( p_glyph );
+        return VLC_ENOMEM;
+    }
+    *pp_glyph = p_glyph;
+    return VLC_SUCCESS;
+}
+
+static void GlyphFree( void *p_data )
+{
+    ft_glyph_t *p_glyph = p_data;
+
+    FT_Done_Glyph( (FT_Glyph)p_glyph->p_glyph );
+    free( p_glyph );
+}
+
+/*****************************************************************************
+ * Text cache: the regions rendered by RenderText
+ *****************************************************************************
+ * A region is found by its text and whatever else RenderText depends on,
+ * and copied instead of being laid out and rendered again.
+ *****************************************************************************/
+typedef struct
+{
+    int      i_font_color;
+    int      i_font_alpha;
+    int      i_font_size;
+    int      i_effect;
+    int      i_align;
+    bool     b_yuvp;
+    bool     b_kerning;
+    unsigned i_visible_width;   /* of the region */
+    unsigned i_visible_height;
+    unsigned i_max_width;       /* of the video */
+} text_key_t;
+
+typedef struct
+{
+    video_format_t  fmt;
+    video_palette_t palette;
+    int             i_planes;
+    size_t          pi_size[VOUT_MAX_PLANES];
+    uint8_t         p_pixels[];
+} text_region_t;
+
+static size_t TextCacheKey( filter_t *p_filter, subpicture_region_t *p_region,
+                            const char *psz_text, int i_font_color,
+                            int i_font_alpha, uint8_t **pp_key )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const size_t i_text = strlen( psz_text );
+    text_key_t key;
+
+    memset( &key, 0, sizeof(key) );
+    key.i_font_color = i_font_color;
+    key.i_font_alpha = i_font_alpha;
+    key.i_font_size = p_sys->i_font_size;
+    key.i_effect = p_sys->i_effect;
+    key.i_align = p_region->i_align;
+    key.b_yuvp = config_GetInt( p_filter, "freetype-yuvp" );
+    key.b_kerning = p_sys->i_use_kerning;
+    key.i_visible_width = p_region->fmt.i_visible_width;
+    key.i_visible_height = p_region->fmt.i_visible_height;
+    key.i_max_width = p_filter->fmt_out.video.i_visible_width;
+
+    *pp_key = malloc( sizeof(key) + i_text );
+    if( !*pp_key )
+        return 0;
+    memcpy( *pp_key, &key, sizeof(key) );
+    memcpy( *pp_key + sizeof(key), psz_text, i_text );
+    return sizeof(key) + i_text;
+}
+
+static int TextCacheCopy( filter_t *p_filter, subpicture_region_t *p_region,
+                          const void *p_data )
+{
+    const text_region_t *p_text = p_data;
+    const uint8_t *p_pixels = p_text->p_pixels;
+    subpicture_region_t *p_region_tmp;
+    video_format_t fmt = p_text->fmt;
+
+    p_region_tmp = spu_CreateRegion( p_filter, &fmt );
+    if( !p_region_tmp )
+    {
+        msg_Err( p_filter, "cannot allocate SPU region" );
+        return VLC_EGENERIC;
+    }
+    if( fmt.p_palette )
+        *fmt.p_palette = p_text->palette;
+
+    p_region->fmt = p_region_tmp->fmt;
+    p_region->picture = p_region_tmp->picture;
+    free( p_region_tmp );
+
+    for( int i = 0; i < p_text->i_planes; i++ )
+    {
+        plane_t *p_plane = &p_region->picture.p[i];
+
+        assert( (size_t)p_plane->i_pitch * p_plane->i_lines ==
+                p_text->pi_size[i] );
+        vlc_memcpy( p_plane->p_pixels, p_pixels, p_text->pi_size[i] );
+        p_pixels += p_text->pi_size[i];
+    }
+    return VLC_SUCCESS;
+}
+
+static void TextCachePut( filter_t *p_filter, subpicture_region_t *p_region,
+                          const uint8_t *p_key, size_t i_key )
+{
+    ft_cache_t *p_cache = p_filter->p_sys->p_text_cache;
+    const picture_t *p_pic = &p_region->picture;
+    text_region_t *p_text;
+    uint8_t *p_pixels;
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_pitch * p_pic->p[i].i_lines;
+
+    p_text = malloc( sizeof(*p_text) + i_size );
+    if( !p_text )
+        return;
+    p_text->fmt = p_region->fmt;
+    p_text->fmt.p_palette = NULL;
+    if( p_region->fmt.p_palette )
+        p_text->palette = *p_region->fmt.p_palette;
+    p_text->i_planes = p_pic->i_planes;
+
+    p_pixels = p_text->p_pixels;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        p_text->pi_size[i] = (size_t)p_pic->p[i].i_pitch * p_pic->p[i].i_lines;
+        vlc_memcpy( p_pixels, p_pic->p[i].p_pixels, p_text->pi_size[i] );
+        p_pixels += p_text->pi_size[i];
+    }
+
+    if( ft_cache_Put( p_cache, p_key, i_key, p_text,
+                      sizeof(*p_text) + i_size ) )
+        free( p_text );
+    ft_cache_Trim( p_cache );
+}
+
+static void CacheStats( filter_t *p_filter, const char *psz_name,
+                        ft_cache_t *p_cache )
+{
+    ft_cache_stats_t stats;
+    uint64_t i_lookups;
+
+    ft_cache_GetStats( p_cache, &stats );
+    i_lookups = stats.i_hits + stats.i_misses;
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits out of %"PRIu64" lookups "
+             "(%u%%), %"PRIu64" evictions, %zu entries using %zu of %zu bytes",
+             psz_name, stats.i_hits, i_lookups,
+             i_lookups ? (unsigned)( 100 * stats.i_hits / i_lookups ) : 0,
+             stats.i_evictions, stats.i_entries, stats.i_size,
+             stats.i_max_size );
+}
+
+static void FreeLine( line_desc_t *p_line )
+{
     free( p_line->pp_glyphs );
     free( p_line->p_glyph_pos );
     free( p_line->p_fg_rgb );
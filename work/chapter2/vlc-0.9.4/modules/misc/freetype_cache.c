@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * freetype_cache.c: LRU cache of the freetype text renderer
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <assert.h>
+
+#include "freetype_cache.h"
+
+typedef struct ft_cache_entry_t ft_cache_entry_t;
+struct ft_cache_entry_t
+{
+    ft_cache_entry_t *p_hash_next;
+    /* Usage list, the most recently used entry first */
+    ft_cache_entry_t *p_prev;
+    ft_cache_entry_t *p_next;
+
+    uint32_t          i_hash;
+    void             *p_data;
+    size_t            i_size;
+    size_t            i_key;
+    uint8_t           p_key[];
+};
+
+struct ft_cache_t
+{
+    ft_cache_entry_t **pp_buckets;
+    unsigned           i_buckets;   /* power of 2 */
+
+    ft_cache_entry_t  *p_first;
+    ft_cache_entry_t  *p_last;
+
+    void             (*pf_free)( void * );
+    ft_cache_stats_t   stats;
+};
+
+#define FT_CACHE_MIN_BUCKETS 64
+
+/* FNV-1a */
+static uint32_t Hash( const uint8_t *p_key, size_t i_key )
+{
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p_key[i] ) * 16777619u;
+    return i_hash;
+}
+
+static size_t EntrySize( const ft_cache_entry_t *p_entry )
+{
+    return sizeof(*p_entry) + p_entry->i_key + p_entry->i_size;
+}
+
+static void Unlink( ft_cache_t *p_cache, ft_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void LinkFirst( ft_cache_t *p_cache, ft_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+/* Doubles the buckets, if possible, once they are all used on average */
+static void Grow( ft_cache_t *p_cache )
+{
+    const unsigned i_buckets = 2 * p_cache->i_buckets;
+    ft_cache_entry_t **pp_buckets;
+
+    pp_buckets = calloc( i_buckets, sizeof(*pp_buckets) );
+    if( !pp_buckets )
+        return;
+
+    for( unsigned i = 0; i < p_cache->i_buckets; i++ )
+    {
+        ft_cache_entry_t *p_entry = p_cache->pp_buckets[i];
+
+        while( p_entry )
+        {
+            ft_cache_entry_t *p_next = p_entry->p_hash_next;
+            ft_cache_entry_t **pp_bucket =
+                &pp_buckets[p_entry->i_hash & (i_buckets - 1)];
+
+            p_entry->p_hash_next = *pp_bucket;
+            *pp_bucket = p_entry;
+            p_entry = p_next;
+        }
+    }
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+ft_cache_t *ft_cache_New( size_t i_max_size, void (*pf_free)( void * ) )
+{
+    ft_cache_t *p_cache = malloc( sizeof(*p_cache) );
+
+    if( !p_cache )
+        return NULL;
+    p_cache->i_buckets = FT_CACHE_MIN_BUCKETS;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof(*p_cache->pp_buckets) );
+    if( !p_cache->pp_buckets )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->p_first = p_cache->p_last = NULL;
+    p_cache->pf_free = pf_free;
+    memset( &p_cache->stats, 0, sizeof(p_cache->stats) );
+    p_cache->stats.i_max_size = i_max_size;
+    return p_cache;
+}
+
+void ft_cache_Delete( ft_cache_t *p_cache )
+{
+    ft_cache_entry_t *p_entry = p_cache->p_first;
+
+    while( p_entry )
+    {
+        ft_cache_entry_t *p_next = p_entry->p_next;
+
+        p_cache->pf_free( p_entry->p_data );
+        free( p_entry );
+        p_entry = p_next;
+    }
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+void *ft_cache_Get( ft_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    const uint32_t i_hash = Hash( p_key, i_key );
+    ft_cache_entry_t *p_entry =
+        p_cache->pp_buckets[i_hash & (p_cache->i_buckets - 1)];
+
+    for( ; p_entry; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key &&
+            !memcmp( p_entry->p_key, p_key, i_key ) )
+        {
+            if( p_cache->p_first != p_entry )
+            {
+                Unlink( p_cache, p_entry );
+                LinkFirst( p_cache, p_entry );
+            }
+            p_cache->stats.i_hits++;
+            return p_entry->p_data;
+        }
+    }
+    p_cache->stats.i_misses++;
+    return NULL;
+}
+
+int ft_cache_Put( ft_cache_t *p_cache, const void *p_key, size_t i_key,
+                  void *p_data, size_t i_size )
+{
+    ft_cache_entry_t *p_entry = malloc( sizeof(*p_entry) + i_key );
+    ft_cache_entry_t **pp_bucket;
+
+    if( !p_entry )
+        return VLC_ENOMEM;
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->p_data = p_data;
+    p_entry->i_size = i_size;
+    p_entry->i_key = i_key;
+    memcpy( p_entry->p_key, p_key, i_key );
+
+    pp_bucket = &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+    p_entry->p_hash_next = *pp_bucket;
+    *pp_bucket = p_entry;
+    LinkFirst( p_cache, p_entry );
+
+    p_cache->stats.i_entries++;
+    p_cache->stats.i_size += EntrySize( p_entry );
+    if( p_cache->stats.i_entries > p_cache->i_buckets )
+        Grow( p_cache );
+    return VLC_SUCCESS;
+}
+
+void ft_cache_Trim( ft_cache_t *p_cache )
+{
+    while( p_cache->stats.i_size > p_cache->stats.i_max_size )
+    {
+        ft_cache_entry_t *p_entry = p_cache->p_last;
+        ft_cache_entry_t **pp_bucket;
+
+        assert( p_entry );
+        pp_bucket = &p_cache->pp_buckets[p_entry->i_hash & (p_cache->i_buckets - 1)];
+        while( *pp_bucket != p_entry )
+            pp_bucket = &(*pp_bucket)->p_hash_next;
+        *pp_bucket = p_entry->p_hash_next;
+        Unlink( p_cache, p_entry );
+
+        p_cache->stats.i_entries--;
+        p_cache->stats.i_size -= EntrySize( p_entry );
+        p_cache->stats.i_evictions++;
+        p_cache->pf_free( p_entry->p_data );
+        free( p_entry );
+    }
+}
+
+void ft_cache_GetStats( const ft_cache_t *p_cache, ft_cache_stats_t *p_stats )
+{
+    *p_stats = p_cache->stats;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * freetype_cache.h: LRU cache of the freetype text renderer
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _FREETYPE_CACHE_H_
+#define _FREETYPE_CACHE_H_ 1
+
+/*
+ * A cache of opaque data keyed by arbitrary bytes, used for the rendered
+ * glyphs and the rendered text regions. The data given by ft_cache_Get()
+ * stay valid until the next ft_cache_Trim(): ft_cache_Put() never evicts,
+ * so that a whole string can be laid out with cached glyphs, and the least
+ * recently used entries are dropped by ft_cache_Trim() once it is rendered.
+ * A cache is not thread-safe.
+ */
+
+typedef struct ft_cache_t ft_cache_t;
+
+typedef struct
+{
+    uint64_t i_hits;
+    uint64_t i_misses;
+    uint64_t i_evictions;
+    size_t   i_entries;
+    size_t   i_size;        /* bytes accounted for the entries */
+    size_t   i_max_size;
+} ft_cache_stats_t;
+
+/* pf_free releases the data of an evicted entry */
+ft_cache_t *ft_cache_New( size_t i_max_size, void (*pf_free)( void * ) );
+void ft_cache_Delete( ft_cache_t * );
+
+/* Returns the data stored with the key, or NULL, and counts a hit or a miss */
+void *ft_cache_Get( ft_cache_t *, const void *p_key, size_t i_key );
+
+/* Stores data of i_size bytes with a key that is not in the cache yet.
+ * On error, the data still belong to the caller. */
+int ft_cache_Put( ft_cache_t *, const void *p_key, size_t i_key,
+                  void *p_data, size_t i_size );
+
+/* Evicts the least recently used entries until the cache fits its size */
+void ft_cache_Trim( ft_cache_t * );
+
+void ft_cache_GetStats( const ft_cache_t *, ft_cache_stats_t * );
+
+#endif
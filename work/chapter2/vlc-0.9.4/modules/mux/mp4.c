@@ -674,10 +674,16 @@ static block_t *ConvertSUBT( block_t *p_block )
 
 static block_t *ConvertAVC1( block_t *p_block )
 {
-    uint8_t *last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
-    uint8_t *dat  = &p_block->p_buffer[4];
-    uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
+    uint8_t *last, *dat, *end;
 
+    /* The start codes are replaced in place */
+    p_block = block_Unshare( p_block );
+    if( p_block == NULL )
+        return NULL;
+
+    last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
+    dat  = &p_block->p_buffer[4];
+    end = &p_block->p_buffer[p_block->i_buffer];
 
     /* Replace the 4 bytes start code with 4 bytes size,
      * FIXME are all startcodes 4 bytes ? (I don't think :( */
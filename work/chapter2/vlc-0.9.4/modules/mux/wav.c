@@ -302,10 +302,15 @@ static int Mux( sout_mux_t *p_mux )
 
         /* Do the channel reordering */
         if( p_sys->b_chan_reorder )
+        {
+            p_block = block_Unshare( p_block );
+            if( p_block == NULL )
+                continue;
             aout_ChannelReorder( p_block->p_buffer, p_block->i_buffer,
                                  p_input->p_fmt->audio.i_channels,
                                  p_sys->pi_chan_table,
                                  p_input->p_fmt->audio.i_bitspersample );
+        }
 
         sout_AccessOutWrite( p_mux->p_access, p_block );
     }
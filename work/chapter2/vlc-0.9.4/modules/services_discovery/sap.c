@@ -79,6 +79,12 @@
 #define SAP_V4_LINK_ADDRESS     "224.0.0.255"
 #define ADD_SESSION 1
 
+/* Buckets of the announce tables */
+#define SAP_HASH_SIZE 1024
+/* Timeouts are checked on a wheel of one second ticks */
+#define SAP_WHEEL_SIZE 256
+#define SAP_WHEEL_TICK INT64_C(1000000)
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -228,6 +234,22 @@ struct sap_announce_t
     sdp_t       *p_sdp;
 
     input_item_t * p_item;
+
+    /* Last packet payload, so that repetitions are not parsed again */
+    uint8_t        *p_packet;
+    size_t          i_packet;
+
+    /* Chaining in the tables, by packet key and by session */
+    uint32_t        i_packet_key;
+    uint32_t        i_session_key;
+    sap_announce_t *p_next_packet;
+    sap_announce_t *p_next_session;
+
+    /* Timer wheel slot, for the deadline it was scheduled at */
+    mtime_t         i_deadline;
+    unsigned        i_slot;
+    sap_announce_t *p_prev_timer;
+    sap_announce_t *p_next_timer;
 };
 
 struct services_discovery_sys_t
@@ -236,9 +258,14 @@ struct services_discovery_sys_t
     int i_fd;
     int *pi_fd;
 
-    /* Table of announces */
+    /* Tables of announces */
     int i_announces;
-    struct sap_announce_t **pp_announces;
+    sap_announce_t *pp_by_packet[SAP_HASH_SIZE];
+    sap_announce_t *pp_by_session[SAP_HASH_SIZE];
+
+    /* Timeouts */
+    sap_announce_t *pp_wheel[SAP_WHEEL_SIZE];
+    int64_t         i_wheel_tick; /* the next one to be checked */
 
     /* Modes */
     bool  b_strict;
@@ -270,6 +297,23 @@ struct demux_sys_t
     static sap_announce_t *CreateAnnounce( services_discovery_t *, uint16_t, sdp_t * );
     static int RemoveAnnounce( services_discovery_t *p_sd, sap_announce_t *p_announce );
 
+/* Announce tables and timeouts */
+    static sap_announce_t *FindPacket( services_discovery_sys_t *,
+                                       const uint32_t *pi_source,
+                                       uint16_t i_hash, const uint8_t *p_packet,
+                                       size_t i_packet );
+    static sap_announce_t *FindSession( services_discovery_sys_t *,
+                                        const sdp_t * );
+    static void SetPacket( services_discovery_sys_t *, sap_announce_t *,
+                           const uint32_t *pi_source, uint16_t i_hash,
+                           const uint8_t *p_packet, size_t i_packet );
+    static void RefreshAnnounce( services_discovery_sys_t *, sap_announce_t * );
+    static void TimerSchedule( services_discovery_sys_t *, sap_announce_t * );
+    static void TimerRemove( services_discovery_sys_t *, sap_announce_t * );
+    static int TimerRun( services_discovery_t *, mtime_t now );
+    static uint32_t PacketKey( const uint32_t *pi_source, uint16_t i_hash );
+    static uint32_t SessionKey( const sdp_t * );
+
 /* Helper functions */
     static inline attribute_t *MakeAttribute (const char *str);
     static const char *GetAttribute (attribute_t **tab, unsigned n, const char *name);
@@ -277,16 +321,11 @@ struct demux_sys_t
     static const char *FindAttribute (const sdp_t *sdp, unsigned media,
                                       const char *name);
 
-    static bool IsSameSession( sdp_t *p_sdp1, sdp_t *p_sdp2 );
+    static bool IsSameSession( const sdp_t *p_sdp1, const sdp_t *p_sdp2 );
     static int InitSocket( services_discovery_t *p_sd, const char *psz_address, int i_port );
     static int Decompress( const unsigned char *psz_src, unsigned char **_dst, int i_len );
     static void FreeSDP( sdp_t *p_sdp );
 
-static inline int min_int( int a, int b )
-{
-    return a > b ? b : a;
-}
-
 /*****************************************************************************
  * Open: initialize and create stuff
  *****************************************************************************/
@@ -294,7 +333,7 @@ static int Open( vlc_object_t *p_this )
 {
     services_discovery_t *p_sd = ( services_discovery_t* )p_this;
     services_discovery_sys_t *p_sys  = (services_discovery_sys_t *)
-                                malloc( sizeof( services_discovery_sys_t ) );
+                                calloc( 1, sizeof( services_discovery_sys_t ) );
     if( !p_sys )
         return VLC_ENOMEM;
 
@@ -323,7 +362,7 @@ static int Open( vlc_object_t *p_this )
     services_discovery_SetLocalizedName( p_sd, _("SAP") );
 
     p_sys->i_announces = 0;
-    p_sys->pp_announces = NULL;
+    p_sys->i_wheel_tick = mdate() / SAP_WHEEL_TICK;
 
     return VLC_SUCCESS;
 }
@@ -447,11 +486,11 @@ static void Close( vlc_object_t *p_this )
     }
 #endif
 
-    for( i = p_sys->i_announces  - 1;  i>= 0; i-- )
+    for( i = 0; i < SAP_HASH_SIZE; i++ )
     {
-        RemoveAnnounce( p_sd, p_sys->pp_announces[i] );
+        while( p_sys->pp_by_session[i] != NULL )
+            RemoveAnnounce( p_sd, p_sys->pp_by_session[i] );
     }
-    FREENULL( p_sys->pp_announces );
 
     free( p_sys );
 }
@@ -479,7 +518,6 @@ static void CloseDemux( vlc_object_t *p_this )
 static void Run( services_discovery_t *p_sd )
 {
     char *psz_addr;
-    int i;
     int timeout = -1;
 
     /* Braindead Winsock DNS resolver will get stuck over 2 seconds per failed
@@ -597,35 +635,8 @@ static void Run( services_discovery_t *p_sd )
             }
         }
 
-        mtime_t now = mdate();
-
-        /* A 1 hour timeout correspong to the RFC Implicit timeout.
-         * This timeout is tuned in the following loop. */
-        timeout = 1000 * 60 * 60;
-
         /* Check for items that need deletion */
-        for( i = 0; i < p_sd->p_sys->i_announces; i++ )
-        {
-            mtime_t i_timeout = ( mtime_t ) 1000000 * p_sd->p_sys->i_timeout;
-            sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
-            mtime_t i_last_period = now - p_announce->i_last;
-
-            /* Remove the annoucement, if the last announcement was 1 hour ago
-             * or if the last packet emitted was 3 times the average time
-             * between two packets */
-            if( ( p_announce->i_period_trust > 5 && i_last_period > 3 * p_announce->i_period ) ||
-                i_last_period > i_timeout )
-            {
-                RemoveAnnounce( p_sd, p_announce );
-            }
-            else
-            {
-                /* Compute next timeout */
-                if( p_announce->i_period_trust > 5 )
-                    timeout = min_int((3 * p_announce->i_period - i_last_period) / 1000, timeout);
-                timeout = min_int((i_timeout - i_last_period)/1000, timeout);
-            }
-        }
+        timeout = TimerRun( p_sd, mdate() );
 
         if( !p_sd->p_sys->i_announces )
             timeout = -1; /* We can safely poll indefinitly. */
@@ -682,10 +693,12 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
                      size_t len )
 {
-    int i;
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
     const char          *psz_sdp;
     const uint8_t *end = buf + len;
     sdp_t               *p_sdp;
+    sap_announce_t      *p_announce;
+    uint32_t             pi_source[4] = { 0, 0, 0, 0 };
 
     assert (buf[len] == '\0');
 
@@ -717,11 +730,27 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         return VLC_EGENERIC;
     }
 
+    if (len < 4 + (b_ipv6 ? 16u : 4u))
+        return VLC_EGENERIC;
+    memcpy (pi_source, buf + 4, b_ipv6 ? 16 : 4);
+
     // Skips source address and auth data
     buf += 4 + (b_ipv6 ? 16 : 4) + buf[1];
     if (buf > end)
         return VLC_EGENERIC;
 
+    /* Most packets repeat an announce we already have: they only refresh
+     * it, without decompressing nor parsing the SDP again */
+    p_announce = FindPacket( p_sys, pi_source, i_hash, buf, end - buf );
+    if( p_announce != NULL )
+    {
+        if( !b_need_delete )
+            RefreshAnnounce( p_sys, p_announce );
+        return VLC_SUCCESS;
+    }
+
+    const uint8_t *p_packet = buf;
+    const size_t i_packet = end - buf;
     uint8_t *decomp = NULL;
     if( b_compressed )
     {
@@ -755,12 +784,16 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
         if (strcmp (psz_sdp, "application/sdp"))
         {
             msg_Dbg (p_sd, "unsupported content type: %s", psz_sdp);
+            free (decomp);
             return VLC_EGENERIC;
         }
 
         // skips content type
         if (len <= clen)
+        {
+            free (decomp);
             return VLC_EGENERIC;
+        }
 
         len -= clen;
         psz_sdp += clen;
@@ -770,7 +803,10 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     p_sdp = ParseSDP( VLC_OBJECT(p_sd), psz_sdp );
 
     if( p_sdp == NULL )
+    {
+        free (decomp);
         return VLC_EGENERIC;
+    }
 
     p_sdp->psz_sdp = psz_sdp;
 
@@ -793,43 +829,38 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     if( p_sdp->psz_uri == NULL )
     {
         FreeSDP( p_sdp );
+        free (decomp);
         return VLC_EGENERIC;
     }
 
-    for( i = 0 ; i< p_sd->p_sys->i_announces ; i++ )
+    /* FIXME: we create a new announce each time the sdp changes */
+    p_announce = FindSession( p_sys, p_sdp );
+    if( p_announce != NULL )
     {
-        sap_announce_t * p_announce = p_sd->p_sys->pp_announces[i];
-        /* FIXME: slow */
-        /* FIXME: we create a new announce each time the sdp changes */
-        if( IsSameSession( p_announce->p_sdp, p_sdp ) )
+        /* We don't support delete announcement as they can easily
+         * Be used to highjack an announcement by a third party.
+         * Intead we cleverly implement Implicit Announcement removal.
+         *
+         * if( b_need_delete )
+         *    RemoveAnnounce( p_sd, p_announce );
+         * else
+         */
+
+        if( !b_need_delete )
         {
-            /* We don't support delete announcement as they can easily
-             * Be used to highjack an announcement by a third party.
-             * Intead we cleverly implement Implicit Announcement removal.
-             *
-             * if( b_need_delete )
-             *    RemoveAnnounce( p_sd, p_sd->p_sys->pp_announces[i]);
-             * else
-             */
-
-            if( !b_need_delete )
-            {
-                /* No need to go after six, as we start to trust the
-                 * average period at six */
-                if( p_announce->i_period_trust <= 5 )
-                    p_announce->i_period_trust++;
-
-                /* Compute the average period */
-                mtime_t now = mdate();
-                p_announce->i_period = (p_announce->i_period + (now - p_announce->i_last)) / 2;
-                p_announce->i_last = now;
-            }
-            FreeSDP( p_sdp ); p_sdp = NULL;
-            return VLC_SUCCESS;
+            RefreshAnnounce( p_sys, p_announce );
+            /* Recognize the repetitions of this version of the packet */
+            SetPacket( p_sys, p_announce, pi_source, i_hash,
+                       p_packet, i_packet );
         }
+        FreeSDP( p_sdp ); p_sdp = NULL;
+        free (decomp);
+        return VLC_SUCCESS;
     }
 
-    CreateAnnounce( p_sd, i_hash, p_sdp );
+    p_announce = CreateAnnounce( p_sd, i_hash, p_sdp );
+    if( p_announce != NULL )
+        SetPacket( p_sys, p_announce, pi_source, i_hash, p_packet, i_packet );
 
     FREENULL (decomp);
     return VLC_SUCCESS;
@@ -852,7 +883,10 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint16_t i_hash,
     p_sap->i_period = 0;
     p_sap->i_period_trust = 0;
     p_sap->i_hash = i_hash;
+    memset( p_sap->i_source, 0, sizeof( p_sap->i_source ) );
     p_sap->p_sdp = p_sdp;
+    p_sap->p_packet = NULL;
+    p_sap->i_packet = 0;
 
     /* Released in RemoveAnnounce */
     p_input = input_item_NewWithType( VLC_OBJECT(p_sd),
@@ -888,7 +922,13 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint16_t i_hash,
 
     services_discovery_AddItem( p_sd, p_input, psz_value /* category name */ );
 
-    TAB_APPEND( p_sys->i_announces, p_sys->pp_announces, p_sap );
+    /* The session of an announce does not change */
+    p_sap->i_session_key = SessionKey( p_sdp );
+    p_sap->p_next_session = p_sys->pp_by_session[p_sap->i_session_key];
+    p_sys->pp_by_session[p_sap->i_session_key] = p_sap;
+    p_sys->i_announces++;
+
+    TimerSchedule( p_sys, p_sap );
 
     return p_sap;
 }
@@ -1503,7 +1543,22 @@ static void FreeSDP( sdp_t *p_sdp )
 static int RemoveAnnounce( services_discovery_t *p_sd,
                            sap_announce_t *p_announce )
 {
-    int i;
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    sap_announce_t **pp;
+
+    TimerRemove( p_sys, p_announce );
+
+    if( p_announce->p_packet )
+    {
+        for( pp = &p_sys->pp_by_packet[p_announce->i_packet_key];
+             *pp != p_announce; pp = &(*pp)->p_next_packet );
+        *pp = p_announce->p_next_packet;
+        free( p_announce->p_packet );
+    }
+    for( pp = &p_sys->pp_by_session[p_announce->i_session_key];
+         *pp != p_announce; pp = &(*pp)->p_next_session );
+    *pp = p_announce->p_next_session;
+    p_sys->i_announces--;
 
     if( p_announce->p_sdp )
     {
@@ -1518,22 +1573,12 @@ static int RemoveAnnounce( services_discovery_t *p_sd,
         p_announce->p_item = NULL;
     }
 
-    for( i = 0; i< p_sd->p_sys->i_announces; i++)
-    {
-        if( p_sd->p_sys->pp_announces[i] == p_announce )
-        {
-            REMOVE_ELEM( p_sd->p_sys->pp_announces, p_sd->p_sys->i_announces,
-                         i);
-            break;
-        }
-    }
-
     free( p_announce );
 
     return VLC_SUCCESS;
 }
 
-static bool IsSameSession( sdp_t *p_sdp1, sdp_t *p_sdp2 )
+static bool IsSameSession( const sdp_t *p_sdp1, const sdp_t *p_sdp2 )
 {
     /* A session is identified by
      * - username,
@@ -1551,6 +1596,220 @@ static bool IsSameSession( sdp_t *p_sdp1, sdp_t *p_sdp2 )
     return true;
 }
 
+/*****************************************************************************
+ * Announce tables: an announce is found by the origin address and message
+ * identifier hash of its last packet, or by its session
+ *****************************************************************************/
+static uint32_t HashBytes( uint32_t i_hash, const void *p_data, size_t i_data )
+{
+    const uint8_t *p = p_data;
+
+    /* FNV-1a */
+    while( i_data-- )
+        i_hash = ( i_hash ^ *p++ ) * 16777619u;
+    return i_hash;
+}
+
+static uint32_t PacketKey( const uint32_t *pi_source, uint16_t i_hash )
+{
+    uint32_t i_key = HashBytes( 2166136261u, pi_source, 16 );
+
+    return HashBytes( i_key, &i_hash, sizeof( i_hash ) ) % SAP_HASH_SIZE;
+}
+
+static uint32_t SessionKey( const sdp_t *p_sdp )
+{
+    uint32_t i_key = HashBytes( 2166136261u, p_sdp->username,
+                                strlen( p_sdp->username ) );
+
+    i_key = HashBytes( i_key, &p_sdp->session_id,
+                       sizeof( p_sdp->session_id ) );
+    i_key = HashBytes( i_key, &p_sdp->orig_ip_version,
+                       sizeof( p_sdp->orig_ip_version ) );
+    return HashBytes( i_key, p_sdp->orig_host,
+                      strlen( p_sdp->orig_host ) ) % SAP_HASH_SIZE;
+}
+
+/* The announce whose last packet is the same as this one. The payload is
+ * compared as well, as the message identifier hash may be 0 or reused. */
+static sap_announce_t *FindPacket( services_discovery_sys_t *p_sys,
+                                   const uint32_t *pi_source,
+                                   uint16_t i_hash, const uint8_t *p_packet,
+                                   size_t i_packet )
+{
+    sap_announce_t *p_announce;
+
+    for( p_announce = p_sys->pp_by_packet[PacketKey( pi_source, i_hash )];
+         p_announce != NULL; p_announce = p_announce->p_next_packet )
+    {
+        if( p_announce->i_hash == i_hash &&
+            p_announce->i_packet == i_packet &&
+            !memcmp( p_announce->i_source, pi_source,
+                     sizeof( p_announce->i_source ) ) &&
+            !memcmp( p_announce->p_packet, p_packet, i_packet ) )
+            return p_announce;
+    }
+    return NULL;
+}
+
+static sap_announce_t *FindSession( services_discovery_sys_t *p_sys,
+                                    const sdp_t *p_sdp )
+{
+    sap_announce_t *p_announce;
+
+    for( p_announce = p_sys->pp_by_session[SessionKey( p_sdp )];
+         p_announce != NULL; p_announce = p_announce->p_next_session )
+    {
+        if( IsSameSession( p_announce->p_sdp, p_sdp ) )
+            return p_announce;
+    }
+    return NULL;
+}
+
+/* Remember the packet of an announce, to recognize its repetitions */
+static void SetPacket( services_discovery_sys_t *p_sys,
+                       sap_announce_t *p_announce, const uint32_t *pi_source,
+                       uint16_t i_hash, const uint8_t *p_packet,
+                       size_t i_packet )
+{
+    uint8_t *p_copy = malloc( i_packet ? i_packet : 1 );
+
+    if( p_copy == NULL )
+        return;
+    memcpy( p_copy, p_packet, i_packet );
+
+    if( p_announce->p_packet )
+    {
+        sap_announce_t **pp;
+
+        for( pp = &p_sys->pp_by_packet[p_announce->i_packet_key];
+             *pp != p_announce; pp = &(*pp)->p_next_packet );
+        *pp = p_announce->p_next_packet;
+        free( p_announce->p_packet );
+    }
+
+    p_announce->i_hash = i_hash;
+    memcpy( p_announce->i_source, pi_source, sizeof( p_announce->i_source ) );
+    p_announce->p_packet = p_copy;
+    p_announce->i_packet = i_packet;
+    p_announce->i_packet_key = PacketKey( pi_source, i_hash );
+    p_announce->p_next_packet = p_sys->pp_by_packet[p_announce->i_packet_key];
+    p_sys->pp_by_packet[p_announce->i_packet_key] = p_announce;
+}
+
+/*****************************************************************************
+ * Timeouts: each announce waits on a wheel of SAP_WHEEL_SIZE one second
+ * slots. The deadline of an announce is only pushed back when it is found
+ * in its slot, so refreshing an announce does not move it.
+ *****************************************************************************/
+static mtime_t Deadline( const services_discovery_sys_t *p_sys,
+                         const sap_announce_t *p_announce )
+{
+    /* Remove the annoucement, if the last announcement was 1 hour ago
+     * or if the last packet emitted was 3 times the average time
+     * between two packets */
+    mtime_t i_deadline = p_announce->i_last +
+                         (mtime_t)1000000 * p_sys->i_timeout;
+
+    if( p_announce->i_period_trust > 5 &&
+        p_announce->i_last + 3 * p_announce->i_period < i_deadline )
+        i_deadline = p_announce->i_last + 3 * p_announce->i_period;
+    return i_deadline;
+}
+
+static void TimerSchedule( services_discovery_sys_t *p_sys,
+                           sap_announce_t *p_announce )
+{
+    /* The first tick after the deadline */
+    int64_t i_tick = Deadline( p_sys, p_announce ) / SAP_WHEEL_TICK + 1;
+
+    if( i_tick < p_sys->i_wheel_tick )
+        i_tick = p_sys->i_wheel_tick;
+
+    p_announce->i_deadline = Deadline( p_sys, p_announce );
+    p_announce->i_slot = i_tick % SAP_WHEEL_SIZE;
+    p_announce->p_prev_timer = NULL;
+    p_announce->p_next_timer = p_sys->pp_wheel[p_announce->i_slot];
+    if( p_announce->p_next_timer )
+        p_announce->p_next_timer->p_prev_timer = p_announce;
+    p_sys->pp_wheel[p_announce->i_slot] = p_announce;
+}
+
+static void TimerRemove( services_discovery_sys_t *p_sys,
+                         sap_announce_t *p_announce )
+{
+    if( p_announce->i_slot >= SAP_WHEEL_SIZE )
+        return; /* being checked by TimerRun() */
+    if( p_announce->p_prev_timer )
+        p_announce->p_prev_timer->p_next_timer = p_announce->p_next_timer;
+    else
+        p_sys->pp_wheel[p_announce->i_slot] = p_announce->p_next_timer;
+    if( p_announce->p_next_timer )
+        p_announce->p_next_timer->p_prev_timer = p_announce->p_prev_timer;
+}
+
+static void RefreshAnnounce( services_discovery_sys_t *p_sys,
+                             sap_announce_t *p_announce )
+{
+    /* No need to go after six, as we start to trust the
+     * average period at six */
+    if( p_announce->i_period_trust <= 5 )
+        p_announce->i_period_trust++;
+
+    /* Compute the average period */
+    mtime_t now = mdate();
+    p_announce->i_period = (p_announce->i_period + (now - p_announce->i_last)) / 2;
+    p_announce->i_last = now;
+
+    /* Once the period is trusted, the deadline may come sooner */
+    if( Deadline( p_sys, p_announce ) < p_announce->i_deadline )
+    {
+        TimerRemove( p_sys, p_announce );
+        TimerSchedule( p_sys, p_announce );
+    }
+}
+
+/* Remove the announces whose deadline passed, and return the poll timeout
+ * until the next tick that has announces, in milliseconds */
+static int TimerRun( services_discovery_t *p_sd, mtime_t now )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    const int64_t i_now_tick = now / SAP_WHEEL_TICK;
+
+    for( unsigned i = 0; i < SAP_WHEEL_SIZE &&
+                         p_sys->i_wheel_tick <= i_now_tick; i++ )
+    {
+        const unsigned i_slot = p_sys->i_wheel_tick % SAP_WHEEL_SIZE;
+        sap_announce_t *p_announce = p_sys->pp_wheel[i_slot];
+
+        /* Announces not due yet are scheduled again in later ticks */
+        p_sys->pp_wheel[i_slot] = NULL;
+        while( p_announce != NULL )
+        {
+            sap_announce_t *p_next = p_announce->p_next_timer;
+
+            p_announce->i_slot = SAP_WHEEL_SIZE;
+            if( Deadline( p_sys, p_announce ) < now )
+                RemoveAnnounce( p_sd, p_announce );
+            else
+                TimerSchedule( p_sys, p_announce );
+            p_announce = p_next;
+        }
+        p_sys->i_wheel_tick++;
+    }
+    /* After a longer stall, all the slots were checked */
+    if( p_sys->i_wheel_tick <= i_now_tick )
+        p_sys->i_wheel_tick = i_now_tick + 1;
+
+    for( unsigned i = 0; i < SAP_WHEEL_SIZE; i++ )
+    {
+        const int64_t i_tick = p_sys->i_wheel_tick + i;
+
+        if( p_sys->pp_wheel[i_tick % SAP_WHEEL_SIZE] != NULL )
+            return ( i_tick * SAP_WHEEL_TICK - now ) / 1000;
+    }
+    return -1;
+}
 
 static inline attribute_t *MakeAttribute (const char *str)
 {
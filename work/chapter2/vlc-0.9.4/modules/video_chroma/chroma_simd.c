@@ -0,0 +1,858 @@
+/*****************************************************************************
+ * chroma_simd.c: AVX2 and SSSE3 conversions from planar YUV
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_vout.h>
+
+#include "chroma_simd.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   if defined(CAN_COMPILE_SSSE3)
+#       include <tmmintrin.h>
+#       define CHROMA_SSSE3 1
+        /* The AVX2 kernels share the RV24 store of the SSSE3 ones */
+#       if defined(CAN_COMPILE_AVX2)
+#           include <immintrin.h>
+#           define CHROMA_AVX2 1
+#       endif
+#   endif
+#endif
+
+/*
+ * Fixed point: the components are multiplied by 128 so that the signed high
+ * word of their products with the 2^12 coefficients (pmulhw) has 3 bits of
+ * fraction. The C version does the very same operations, so that every
+ * version gives the same pixels.
+ */
+typedef struct
+{
+    int16_t i_offset;           /* black level */
+    int16_t i_y;                /* luma gain */
+    int16_t i_vr, i_ug, i_vg, i_ub;
+} yuv_matrix_t;
+
+typedef void (*convert_line_t)( const filter_sys_t *, uint8_t *p_dst,
+                                const uint8_t *p_y, const uint8_t *p_u,
+                                const uint8_t *p_v, int i_width );
+
+struct filter_sys_t
+{
+    yuv_matrix_t   matrix;
+    bool           b_420;       /* one chroma line for two luma lines */
+
+    /* RV24 and RV32: byte of R, G and B in a pixel */
+    int            pi_byte[3];
+    /* RV15 and RV16: shifts of R, G and B */
+    int            pi_rshift[3], pi_lshift[3];
+    /* Packed YUV */
+    bool           b_swap_uv;   /* V first */
+    bool           b_uyvy;      /* chroma before luma */
+
+    convert_line_t pf_line;
+};
+
+static void SetMatrix( yuv_matrix_t *p_matrix, bool b_709, bool b_full )
+{
+    const double f_kr = b_709 ? .2126 : .299;
+    const double f_kb = b_709 ? .0722 : .114;
+    const double f_kg = 1. - f_kr - f_kb;
+    const double f_luma = b_full ? 1. : 255. / 219.;
+    const double f_chroma = ( b_full ? 1. : 255. / 224. ) * 4096.;
+
+    p_matrix->i_offset = b_full ? 0 : 16;
+    p_matrix->i_y  = lrint( f_luma * 4096. );
+    p_matrix->i_vr = lrint( 2. * ( 1. - f_kr ) * f_chroma );
+    p_matrix->i_ug = lrint( 2. * f_kb * ( 1. - f_kb ) / f_kg * f_chroma );
+    p_matrix->i_vg = lrint( 2. * f_kr * ( 1. - f_kr ) / f_kg * f_chroma );
+    p_matrix->i_ub = lrint( 2. * ( 1. - f_kb ) * f_chroma );
+}
+
+/*****************************************************************************
+ * C versions
+ *****************************************************************************/
+static inline int Clip( int i )
+{
+    return i < 0 ? 0 : i > 255 ? 255 : i;
+}
+
+static inline void PixelC( const yuv_matrix_t *p_matrix,
+                           int i_y, int i_u, int i_v, int pi_rgb[3] )
+{
+    const int y = ( ( i_y - p_matrix->i_offset ) * 128 * p_matrix->i_y ) >> 16;
+    const int u = ( i_u - 128 ) * 128;
+    const int v = ( i_v - 128 ) * 128;
+
+    pi_rgb[0] = Clip( ( y + ( ( v * p_matrix->i_vr ) >> 16 ) + 4 ) >> 3 );
+    pi_rgb[1] = Clip( ( y - ( ( ( u * p_matrix->i_ug ) >> 16 )
+                            + ( ( v * p_matrix->i_vg ) >> 16 ) ) + 4 ) >> 3 );
+    pi_rgb[2] = Clip( ( y + ( ( u * p_matrix->i_ub ) >> 16 ) + 4 ) >> 3 );
+}
+
+static void LineRGB32C( const filter_sys_t *p_sys, uint8_t *p_dst,
+                        const uint8_t *p_y, const uint8_t *p_u,
+                        const uint8_t *p_v, int i_width )
+{
+    for( int x = 0; x < i_width; x++, p_dst += 4 )
+    {
+        int pi_rgb[3];
+
+        PixelC( &p_sys->matrix, p_y[x], p_u[x / 2], p_v[x / 2], pi_rgb );
+        p_dst[0] = p_dst[1] = p_dst[2] = p_dst[3] = 0;
+        for( int i = 0; i < 3; i++ )
+            p_dst[p_sys->pi_byte[i]] = pi_rgb[i];
+    }
+}
+
+static void LineRGB24C( const filter_sys_t *p_sys, uint8_t *p_dst,
+                        const uint8_t *p_y, const uint8_t *p_u,
+                        const uint8_t *p_v, int i_width )
+{
+    for( int x = 0; x < i_width; x++, p_dst += 3 )
+    {
+        int pi_rgb[3];
+
+        PixelC( &p_sys->matrix, p_y[x], p_u[x / 2], p_v[x / 2], pi_rgb );
+        for( int i = 0; i < 3; i++ )
+            p_dst[p_sys->pi_byte[i]] = pi_rgb[i];
+    }
+}
+
+static void LineRGB16C( const filter_sys_t *p_sys, uint8_t *p_dst,
+                        const uint8_t *p_y, const uint8_t *p_u,
+                        const uint8_t *p_v, int i_width )
+{
+    uint16_t *p_pixel = (uint16_t *)p_dst;
+
+    for( int x = 0; x < i_width; x++ )
+    {
+        int pi_rgb[3];
+        uint16_t i_pixel = 0;
+
+        PixelC( &p_sys->matrix, p_y[x], p_u[x / 2], p_v[x / 2], pi_rgb );
+        for( int i = 0; i < 3; i++ )
+            i_pixel |= ( pi_rgb[i] >> p_sys->pi_rshift[i] )
+                                   << p_sys->pi_lshift[i];
+        p_pixel[x] = i_pixel;
+    }
+}
+
+static void LinePackedC( const filter_sys_t *p_sys, uint8_t *p_dst,
+                         const uint8_t *p_y, const uint8_t *p_u,
+                         const uint8_t *p_v, int i_width )
+{
+    const uint8_t *p_c0 = p_sys->b_swap_uv ? p_v : p_u;
+    const uint8_t *p_c1 = p_sys->b_swap_uv ? p_u : p_v;
+    const int i_y = p_sys->b_uyvy ? 1 : 0;
+    const int i_c = 1 - i_y;
+
+    for( int x = 0; x < i_width; x += 2, p_dst += 4 )
+    {
+        p_dst[i_y]     = p_y[x];
+        p_dst[i_c]     = p_c0[x / 2];
+        p_dst[i_y + 2] = p_y[x + 1];
+        p_dst[i_c + 2] = p_c1[x / 2];
+    }
+}
+
+/*****************************************************************************
+ * SSSE3 versions, 16 pixels at a time
+ *****************************************************************************/
+#if defined(CHROMA_SSSE3)
+#define SSSE3_INLINE static inline \
+    __attribute__((__target__("ssse3"), __always_inline__))
+#define SSSE3_LINE static __attribute__((__target__("ssse3")))
+
+/* R, G and B of 2x8 pixels, as 16 bits integers from 0 to 255 */
+SSSE3_INLINE
+void ComputeSSSE3( const yuv_matrix_t *p_matrix, const uint8_t *p_y,
+                   const uint8_t *p_u, const uint8_t *p_v, __m128i rgb[2][3] )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c128 = _mm_set1_epi16( 128 );
+    const __m128i c255 = _mm_set1_epi16( 255 );
+    const __m128i round = _mm_set1_epi16( 4 );
+    const __m128i offset = _mm_set1_epi16( p_matrix->i_offset );
+    const __m128i luma = _mm_loadu_si128( (const __m128i *)p_y );
+    __m128i u, v, r, g, b;
+
+    u = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p_u ), zero );
+    v = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p_v ), zero );
+    u = _mm_slli_epi16( _mm_sub_epi16( u, c128 ), 7 );
+    v = _mm_slli_epi16( _mm_sub_epi16( v, c128 ), 7 );
+    r = _mm_mulhi_epi16( v, _mm_set1_epi16( p_matrix->i_vr ) );
+    g = _mm_add_epi16( _mm_mulhi_epi16( u, _mm_set1_epi16( p_matrix->i_ug ) ),
+                       _mm_mulhi_epi16( v, _mm_set1_epi16( p_matrix->i_vg ) ) );
+    b = _mm_mulhi_epi16( u, _mm_set1_epi16( p_matrix->i_ub ) );
+
+    for( int h = 0; h < 2; h++ )
+    {
+        __m128i y = h ? _mm_unpackhi_epi8( luma, zero )
+                      : _mm_unpacklo_epi8( luma, zero );
+        __m128i rh = h ? _mm_unpackhi_epi16( r, r ) : _mm_unpacklo_epi16( r, r );
+        __m128i gh = h ? _mm_unpackhi_epi16( g, g ) : _mm_unpacklo_epi16( g, g );
+        __m128i bh = h ? _mm_unpackhi_epi16( b, b ) : _mm_unpacklo_epi16( b, b );
+
+        y = _mm_slli_epi16( _mm_sub_epi16( y, offset ), 7 );
+        y = _mm_add_epi16( _mm_mulhi_epi16( y,
+                                   _mm_set1_epi16( p_matrix->i_y ) ), round );
+        rh = _mm_srai_epi16( _mm_add_epi16( y, rh ), 3 );
+        gh = _mm_srai_epi16( _mm_sub_epi16( y, gh ), 3 );
+        bh = _mm_srai_epi16( _mm_add_epi16( y, bh ), 3 );
+        rgb[h][0] = _mm_min_epi16( _mm_max_epi16( rh, zero ), c255 );
+        rgb[h][1] = _mm_min_epi16( _mm_max_epi16( gh, zero ), c255 );
+        rgb[h][2] = _mm_min_epi16( _mm_max_epi16( bh, zero ), c255 );
+    }
+}
+
+/* The low and high 16 bits of 8 RV24/RV32 pixels */
+SSSE3_INLINE
+void WordsSSSE3( const filter_sys_t *p_sys, const __m128i rgb[3],
+                 __m128i *p_lo, __m128i *p_hi )
+{
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+    for( int i = 0; i < 3; i++ )
+    {
+        const __m128i c = ( p_sys->pi_byte[i] & 1 )
+                        ? _mm_slli_epi16( rgb[i], 8 ) : rgb[i];
+        if( p_sys->pi_byte[i] & 2 )
+            hi = _mm_or_si128( hi, c );
+        else
+            lo = _mm_or_si128( lo, c );
+    }
+    *p_lo = lo;
+    *p_hi = hi;
+}
+
+SSSE3_LINE
+void LineRGB32SSSE3( const filter_sys_t *p_sys, uint8_t *p_dst,
+                     const uint8_t *p_y, const uint8_t *p_u,
+                     const uint8_t *p_v, int i_width )
+{
+    int x;
+
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        __m128i rgb[2][3], lo, hi;
+
+        ComputeSSSE3( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            WordsSSSE3( p_sys, rgb[h], &lo, &hi );
+            _mm_storeu_si128( (__m128i *)&p_dst[4 * ( x + 8 * h )],
+                              _mm_unpacklo_epi16( lo, hi ) );
+            _mm_storeu_si128( (__m128i *)&p_dst[4 * ( x + 8 * h + 4 )],
+                              _mm_unpackhi_epi16( lo, hi ) );
+        }
+    }
+    LineRGB32C( p_sys, &p_dst[4 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+/* Store the first 3 bytes of 4 32 bits pixels */
+SSSE3_INLINE
+void Store24SSSE3( uint8_t *p_dst, __m128i pixels )
+{
+    const __m128i shuffle = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10,
+                                           12, 13, 14, -1, -1, -1, -1 );
+    uint32_t i_last;
+
+    pixels = _mm_shuffle_epi8( pixels, shuffle );
+    _mm_storel_epi64( (__m128i *)p_dst, pixels );
+    i_last = _mm_cvtsi128_si32( _mm_srli_si128( pixels, 8 ) );
+    memcpy( &p_dst[8], &i_last, 4 );
+}
+
+SSSE3_LINE
+void LineRGB24SSSE3( const filter_sys_t *p_sys, uint8_t *p_dst,
+                     const uint8_t *p_y, const uint8_t *p_u,
+                     const uint8_t *p_v, int i_width )
+{
+    int x;
+
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        __m128i rgb[2][3], lo, hi;
+
+        ComputeSSSE3( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            WordsSSSE3( p_sys, rgb[h], &lo, &hi );
+            Store24SSSE3( &p_dst[3 * ( x + 8 * h )],
+                          _mm_unpacklo_epi16( lo, hi ) );
+            Store24SSSE3( &p_dst[3 * ( x + 8 * h + 4 )],
+                          _mm_unpackhi_epi16( lo, hi ) );
+        }
+    }
+    LineRGB24C( p_sys, &p_dst[3 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+SSSE3_LINE
+void LineRGB16SSSE3( const filter_sys_t *p_sys, uint8_t *p_dst,
+                     const uint8_t *p_y, const uint8_t *p_u,
+                     const uint8_t *p_v, int i_width )
+{
+    __m128i rshift[3], lshift[3];
+    int x;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        rshift[i] = _mm_cvtsi32_si128( p_sys->pi_rshift[i] );
+        lshift[i] = _mm_cvtsi32_si128( p_sys->pi_lshift[i] );
+    }
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        __m128i rgb[2][3];
+
+        ComputeSSSE3( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            __m128i pixels = _mm_setzero_si128();
+
+            for( int i = 0; i < 3; i++ )
+                pixels = _mm_or_si128( pixels, _mm_sll_epi16(
+                            _mm_srl_epi16( rgb[h][i], rshift[i] ), lshift[i] ) );
+            _mm_storeu_si128( (__m128i *)&p_dst[2 * ( x + 8 * h )], pixels );
+        }
+    }
+    LineRGB16C( p_sys, &p_dst[2 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+SSSE3_LINE
+void LinePackedSSSE3( const filter_sys_t *p_sys, uint8_t *p_dst,
+                      const uint8_t *p_y, const uint8_t *p_u,
+                      const uint8_t *p_v, int i_width )
+{
+    const uint8_t *p_c0 = p_sys->b_swap_uv ? p_v : p_u;
+    const uint8_t *p_c1 = p_sys->b_swap_uv ? p_u : p_v;
+    int x;
+
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        const __m128i y = _mm_loadu_si128( (const __m128i *)&p_y[x] );
+        const __m128i c = _mm_unpacklo_epi8(
+                _mm_loadl_epi64( (const __m128i *)&p_c0[x / 2] ),
+                _mm_loadl_epi64( (const __m128i *)&p_c1[x / 2] ) );
+        __m128i lo, hi;
+
+        if( p_sys->b_uyvy )
+        {
+            lo = _mm_unpacklo_epi8( c, y );
+            hi = _mm_unpackhi_epi8( c, y );
+        }
+        else
+        {
+            lo = _mm_unpacklo_epi8( y, c );
+            hi = _mm_unpackhi_epi8( y, c );
+        }
+        _mm_storeu_si128( (__m128i *)&p_dst[2 * x], lo );
+        _mm_storeu_si128( (__m128i *)&p_dst[2 * x + 16], hi );
+    }
+    LinePackedC( p_sys, &p_dst[2 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                 i_width - x );
+}
+#endif
+
+/*****************************************************************************
+ * AVX2 versions, 32 pixels at a time
+ *****************************************************************************
+ * The 256 bits instructions mostly work within each 128 bits half: the
+ * chroma samples are reordered before being doubled, and the pixels before
+ * being stored, so that everything is in the order of the C version.
+ *****************************************************************************/
+#if defined(CHROMA_AVX2)
+#define AVX2_INLINE static inline \
+    __attribute__((__target__("avx2"), __always_inline__))
+#define AVX2_LINE static __attribute__((__target__("avx2")))
+
+/* R, G and B of 2x16 pixels, as 16 bits integers from 0 to 255 */
+AVX2_INLINE
+void ComputeAVX2( const yuv_matrix_t *p_matrix, const uint8_t *p_y,
+                  const uint8_t *p_u, const uint8_t *p_v, __m256i rgb[2][3] )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c128 = _mm256_set1_epi16( 128 );
+    const __m256i c255 = _mm256_set1_epi16( 255 );
+    const __m256i round = _mm256_set1_epi16( 4 );
+    const __m256i offset = _mm256_set1_epi16( p_matrix->i_offset );
+    __m256i u, v, r, g, b;
+
+    u = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p_u ) );
+    v = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)p_v ) );
+    u = _mm256_slli_epi16( _mm256_sub_epi16( u, c128 ), 7 );
+    v = _mm256_slli_epi16( _mm256_sub_epi16( v, c128 ), 7 );
+    r = _mm256_mulhi_epi16( v, _mm256_set1_epi16( p_matrix->i_vr ) );
+    g = _mm256_add_epi16(
+            _mm256_mulhi_epi16( u, _mm256_set1_epi16( p_matrix->i_ug ) ),
+            _mm256_mulhi_epi16( v, _mm256_set1_epi16( p_matrix->i_vg ) ) );
+    b = _mm256_mulhi_epi16( u, _mm256_set1_epi16( p_matrix->i_ub ) );
+    /* 0-3 8-11 | 4-7 12-15, so that the unpacks double 0-7 and 8-15 */
+    r = _mm256_permute4x64_epi64( r, 0xd8 );
+    g = _mm256_permute4x64_epi64( g, 0xd8 );
+    b = _mm256_permute4x64_epi64( b, 0xd8 );
+
+    for( int h = 0; h < 2; h++ )
+    {
+        __m256i y = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128( (const __m128i *)&p_y[16 * h] ) );
+        __m256i rh = h ? _mm256_unpackhi_epi16( r, r )
+                       : _mm256_unpacklo_epi16( r, r );
+        __m256i gh = h ? _mm256_unpackhi_epi16( g, g )
+                       : _mm256_unpacklo_epi16( g, g );
+        __m256i bh = h ? _mm256_unpackhi_epi16( b, b )
+                       : _mm256_unpacklo_epi16( b, b );
+
+        y = _mm256_slli_epi16( _mm256_sub_epi16( y, offset ), 7 );
+        y = _mm256_add_epi16( _mm256_mulhi_epi16( y,
+                                _mm256_set1_epi16( p_matrix->i_y ) ), round );
+        rh = _mm256_srai_epi16( _mm256_add_epi16( y, rh ), 3 );
+        gh = _mm256_srai_epi16( _mm256_sub_epi16( y, gh ), 3 );
+        bh = _mm256_srai_epi16( _mm256_add_epi16( y, bh ), 3 );
+        rgb[h][0] = _mm256_min_epi16( _mm256_max_epi16( rh, zero ), c255 );
+        rgb[h][1] = _mm256_min_epi16( _mm256_max_epi16( gh, zero ), c255 );
+        rgb[h][2] = _mm256_min_epi16( _mm256_max_epi16( bh, zero ), c255 );
+    }
+}
+
+/* 16 RV24/RV32 pixels, in two registers of 8 */
+AVX2_INLINE
+void PixelsAVX2( const filter_sys_t *p_sys, const __m256i rgb[3],
+                 __m256i *p_first, __m256i *p_second )
+{
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+    __m256i a, b;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        const __m256i c = ( p_sys->pi_byte[i] & 1 )
+                        ? _mm256_slli_epi16( rgb[i], 8 ) : rgb[i];
+        if( p_sys->pi_byte[i] & 2 )
+            hi = _mm256_or_si256( hi, c );
+        else
+            lo = _mm256_or_si256( lo, c );
+    }
+    a = _mm256_unpacklo_epi16( lo, hi );    /* 0-3 | 8-11 */
+    b = _mm256_unpackhi_epi16( lo, hi );    /* 4-7 | 12-15 */
+    *p_first = _mm256_permute2x128_si256( a, b, 0x20 );
+    *p_second = _mm256_permute2x128_si256( a, b, 0x31 );
+}
+
+AVX2_LINE
+void LineRGB32AVX2( const filter_sys_t *p_sys, uint8_t *p_dst,
+                    const uint8_t *p_y, const uint8_t *p_u,
+                    const uint8_t *p_v, int i_width )
+{
+    int x;
+
+    for( x = 0; x + 32 <= i_width; x += 32 )
+    {
+        __m256i rgb[2][3], first, second;
+
+        ComputeAVX2( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            PixelsAVX2( p_sys, rgb[h], &first, &second );
+            _mm256_storeu_si256( (__m256i *)&p_dst[4 * ( x + 16 * h )],
+                                 first );
+            _mm256_storeu_si256( (__m256i *)&p_dst[4 * ( x + 16 * h + 8 )],
+                                 second );
+        }
+    }
+    LineRGB32C( p_sys, &p_dst[4 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+AVX2_LINE
+void LineRGB24AVX2( const filter_sys_t *p_sys, uint8_t *p_dst,
+                    const uint8_t *p_y, const uint8_t *p_u,
+                    const uint8_t *p_v, int i_width )
+{
+    int x;
+
+    for( x = 0; x + 32 <= i_width; x += 32 )
+    {
+        __m256i rgb[2][3], first, second;
+
+        ComputeAVX2( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            uint8_t *p = &p_dst[3 * ( x + 16 * h )];
+
+            PixelsAVX2( p_sys, rgb[h], &first, &second );
+            Store24SSSE3( &p[0],  _mm256_castsi256_si128( first ) );
+            Store24SSSE3( &p[12], _mm256_extracti128_si256( first, 1 ) );
+            Store24SSSE3( &p[24], _mm256_castsi256_si128( second ) );
+            Store24SSSE3( &p[36], _mm256_extracti128_si256( second, 1 ) );
+        }
+    }
+    LineRGB24C( p_sys, &p_dst[3 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+AVX2_LINE
+void LineRGB16AVX2( const filter_sys_t *p_sys, uint8_t *p_dst,
+                    const uint8_t *p_y, const uint8_t *p_u,
+                    const uint8_t *p_v, int i_width )
+{
+    __m128i rshift[3], lshift[3];
+    int x;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        rshift[i] = _mm_cvtsi32_si128( p_sys->pi_rshift[i] );
+        lshift[i] = _mm_cvtsi32_si128( p_sys->pi_lshift[i] );
+    }
+    for( x = 0; x + 32 <= i_width; x += 32 )
+    {
+        __m256i rgb[2][3];
+
+        ComputeAVX2( &p_sys->matrix, &p_y[x], &p_u[x / 2], &p_v[x / 2], rgb );
+        for( int h = 0; h < 2; h++ )
+        {
+            __m256i pixels = _mm256_setzero_si256();
+
+            for( int i = 0; i < 3; i++ )
+                pixels = _mm256_or_si256( pixels, _mm256_sll_epi16(
+                        _mm256_srl_epi16( rgb[h][i], rshift[i] ), lshift[i] ) );
+            _mm256_storeu_si256( (__m256i *)&p_dst[2 * ( x + 16 * h )],
+                                 pixels );
+        }
+    }
+    LineRGB16C( p_sys, &p_dst[2 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                i_width - x );
+}
+
+AVX2_LINE
+void LinePackedAVX2( const filter_sys_t *p_sys, uint8_t *p_dst,
+                     const uint8_t *p_y, const uint8_t *p_u,
+                     const uint8_t *p_v, int i_width )
+{
+    const uint8_t *p_c0 = p_sys->b_swap_uv ? p_v : p_u;
+    const uint8_t *p_c1 = p_sys->b_swap_uv ? p_u : p_v;
+    int x;
+
+    for( x = 0; x + 32 <= i_width; x += 32 )
+    {
+        const __m256i y = _mm256_loadu_si256( (const __m256i *)&p_y[x] );
+        const __m128i c0 = _mm_loadu_si128( (const __m128i *)&p_c0[x / 2] );
+        const __m128i c1 = _mm_loadu_si128( (const __m128i *)&p_c1[x / 2] );
+        /* Chroma pairs 0-7 | 8-15, next to luma 0-15 | 16-31 */
+        const __m256i c = _mm256_inserti128_si256(
+                _mm256_castsi128_si256( _mm_unpacklo_epi8( c0, c1 ) ),
+                _mm_unpackhi_epi8( c0, c1 ), 1 );
+        __m256i lo, hi;
+
+        if( p_sys->b_uyvy )
+        {
+            lo = _mm256_unpacklo_epi8( c, y );  /* 0-7 | 16-23 */
+            hi = _mm256_unpackhi_epi8( c, y );  /* 8-15 | 24-31 */
+        }
+        else
+        {
+            lo = _mm256_unpacklo_epi8( y, c );
+            hi = _mm256_unpackhi_epi8( y, c );
+        }
+        _mm256_storeu_si256( (__m256i *)&p_dst[2 * x],
+                             _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)&p_dst[2 * x + 32],
+                             _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+    }
+    LinePackedC( p_sys, &p_dst[2 * x], &p_y[x], &p_u[x / 2], &p_v[x / 2],
+                 i_width - x );
+}
+#endif
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static void Convert( filter_t *p_filter, picture_t *p_src, picture_t *p_dst,
+                     int i_slice, int i_slices )
+{
+    const filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_width = p_filter->fmt_in.video.i_width;
+    int i_first, i_last;
+
+    filter_GetSliceLines( p_filter->fmt_in.video.i_height, 2, i_slice,
+                          i_slices, &i_first, &i_last );
+    for( int y = i_first; y < i_last; y++ )
+    {
+        const int i_chroma = p_sys->b_420 ? y / 2 : y;
+
+        p_sys->pf_line( p_sys, &p_dst->p->p_pixels[y * p_dst->p->i_pitch],
+                        &p_src->Y_PIXELS[y * p_src->Y_PITCH],
+                        &p_src->U_PIXELS[i_chroma * p_src->U_PITCH],
+                        &p_src->V_PIXELS[i_chroma * p_src->V_PITCH],
+                        i_width );
+    }
+}
+
+VIDEO_FILTER_WRAPPER_SLICES( Convert )
+
+/*****************************************************************************
+ * Open
+ *****************************************************************************/
+enum
+{
+    LINE_RGB32,
+    LINE_RGB24,
+    LINE_RGB16,
+    LINE_PACKED,
+};
+
+static const struct
+{
+    convert_line_t pf_c;
+#if defined(CHROMA_SSSE3)
+    convert_line_t pf_ssse3;
+#endif
+#if defined(CHROMA_AVX2)
+    convert_line_t pf_avx2;
+#endif
+} p_lines[] =
+{
+#if defined(CHROMA_AVX2)
+#   define LINES( name ) \
+        { Line##name##C, Line##name##SSSE3, Line##name##AVX2 }
+#elif defined(CHROMA_SSSE3)
+#   define LINES( name ) { Line##name##C, Line##name##SSSE3 }
+#else
+#   define LINES( name ) { Line##name##C }
+#endif
+    [LINE_RGB32]  = LINES( RGB32 ),
+    [LINE_RGB24]  = LINES( RGB24 ),
+    [LINE_RGB16]  = LINES( RGB16 ),
+    [LINE_PACKED] = LINES( Packed ),
+#undef LINES
+};
+
+/* Sizes of the conversion, and the best line function for this CPU. The C
+ * one is only used if the module was asked for by name. */
+static int Setup( filter_t *p_filter, int i_line )
+{
+    filter_sys_t *p_sys;
+    convert_line_t pf_line = NULL;
+    const char *psz_kernel = "C";
+
+    if( p_filter->fmt_in.video.i_width & 1
+     || p_filter->fmt_in.video.i_height & 1
+     || p_filter->fmt_in.video.i_width != p_filter->fmt_out.video.i_width
+     || p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height )
+        return VLC_EGENERIC;
+
+#if defined(CHROMA_AVX2)
+    if( vlc_CPU() & CPU_CAPABILITY_AVX2 )
+    {
+        pf_line = p_lines[i_line].pf_avx2;
+        psz_kernel = "AVX2";
+    }
+    else
+#endif
+#if defined(CHROMA_SSSE3)
+    if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
+    {
+        pf_line = p_lines[i_line].pf_ssse3;
+        psz_kernel = "SSSE3";
+    }
+    else
+#endif
+    if( p_filter->b_force )
+        pf_line = p_lines[i_line].pf_c;
+    if( pf_line == NULL )
+        return VLC_EGENERIC;
+
+    p_filter->p_sys = p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+    p_sys->pf_line = pf_line;
+    p_filter->pf_video_filter = Convert_Filter;
+
+    msg_Dbg( p_filter, "%4.4s to %4.4s with the %s kernel",
+             (const char *)&p_filter->fmt_in.video.i_chroma,
+             (const char *)&p_filter->fmt_out.video.i_chroma, psz_kernel );
+    return VLC_SUCCESS;
+}
+
+/* Byte of an 8 bits component of a 24 or 32 bits pixel */
+static int MaskToByte( uint32_t i_mask, int i_bytes )
+{
+    for( int i = 0; i < i_bytes; i++ )
+        if( i_mask == 0xffu << ( 8 * i ) )
+            return i;
+    return -1;
+}
+
+/* Shifts of a component of 8 bits or less in a 16 bits pixel */
+static bool MaskToShift( uint32_t i_mask, int *pi_rshift, int *pi_lshift )
+{
+    int i_low = 0, i_bits = 0;
+
+    if( i_mask == 0 || i_mask > 0xffff )
+        return false;
+    while( !( i_mask & 1 ) )
+    {
+        i_mask >>= 1;
+        i_low++;
+    }
+    while( i_mask & 1 )
+    {
+        i_mask >>= 1;
+        i_bits++;
+    }
+    if( i_mask != 0 || i_bits > 8 )
+        return false;
+    *pi_rshift = 8 - i_bits;
+    *pi_lshift = i_low;
+    return true;
+}
+
+int OpenRGB( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+    const uint32_t pi_mask[3] = { p_out->i_rmask, p_out->i_gmask,
+                                  p_out->i_bmask };
+    int pi_byte[3] = { 0, 0, 0 };
+    int pi_rshift[3] = { 0, 0, 0 }, pi_lshift[3] = { 0, 0, 0 };
+    bool b_420, b_full;
+    int i_line, i_matrix;
+
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        case VLC_FOURCC('I','4','2','0'):
+        case VLC_FOURCC('I','Y','U','V'):
+        case VLC_FOURCC('Y','V','1','2'):
+            b_420 = true; b_full = false;
+            break;
+        case VLC_FOURCC('J','4','2','0'):
+            b_420 = true; b_full = true;
+            break;
+        case VLC_FOURCC('I','4','2','2'):
+            b_420 = false; b_full = false;
+            break;
+        case VLC_FOURCC('J','4','2','2'):
+            b_420 = false; b_full = true;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    switch( p_out->i_chroma )
+    {
+        case VLC_FOURCC('R','V','3','2'):
+        case VLC_FOURCC('R','V','2','4'):
+        {
+            const bool b_32 = p_out->i_chroma == VLC_FOURCC('R','V','3','2');
+
+            for( int i = 0; i < 3; i++ )
+                if( ( pi_byte[i] = MaskToByte( pi_mask[i],
+                                               b_32 ? 4 : 3 ) ) < 0 )
+                    return VLC_EGENERIC;
+            if( pi_byte[0] == pi_byte[1] || pi_byte[0] == pi_byte[2]
+             || pi_byte[1] == pi_byte[2] )
+                return VLC_EGENERIC;
+            i_line = b_32 ? LINE_RGB32 : LINE_RGB24;
+            break;
+        }
+        case VLC_FOURCC('R','V','1','5'):
+        case VLC_FOURCC('R','V','1','6'):
+            for( int i = 0; i < 3; i++ )
+                if( !MaskToShift( pi_mask[i], &pi_rshift[i], &pi_lshift[i] ) )
+                    return VLC_EGENERIC;
+            i_line = LINE_RGB16;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    if( Setup( p_filter, i_line ) )
+        return VLC_EGENERIC;
+
+    i_matrix = var_CreateGetInteger( p_filter, "rgb-matrix" );
+    if( i_matrix != 601 && i_matrix != 709 )
+        i_matrix = p_filter->fmt_in.video.i_height > 576 ? 709 : 601;
+    SetMatrix( &p_filter->p_sys->matrix, i_matrix == 709, b_full );
+    p_filter->p_sys->b_420 = b_420;
+    for( int i = 0; i < 3; i++ )
+    {
+        p_filter->p_sys->pi_byte[i] = pi_byte[i];
+        p_filter->p_sys->pi_rshift[i] = pi_rshift[i];
+        p_filter->p_sys->pi_lshift[i] = pi_lshift[i];
+    }
+    msg_Dbg( p_filter, "BT.%d %s range", i_matrix, b_full ? "full" : "TV" );
+    return VLC_SUCCESS;
+}
+
+int OpenPacked( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    bool b_swap_uv = false, b_uyvy = false;
+
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        case VLC_FOURCC('I','4','2','0'):
+        case VLC_FOURCC('I','Y','U','V'):
+        case VLC_FOURCC('Y','V','1','2'):
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    switch( p_filter->fmt_out.video.i_chroma )
+    {
+        case VLC_FOURCC('Y','U','Y','2'):
+        case VLC_FOURCC('Y','U','N','V'):
+            break;
+        case VLC_FOURCC('Y','V','Y','U'):
+            b_swap_uv = true;
+            break;
+        case VLC_FOURCC('U','Y','V','Y'):
+        case VLC_FOURCC('U','Y','N','V'):
+        case VLC_FOURCC('Y','4','2','2'):
+            b_uyvy = true;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    if( Setup( p_filter, LINE_PACKED ) )
+        return VLC_EGENERIC;
+    p_filter->p_sys->b_420 = true;
+    p_filter->p_sys->b_swap_uv = b_swap_uv;
+    p_filter->p_sys->b_uyvy = b_uyvy;
+    return VLC_SUCCESS;
+}
+
+void CloseSIMD( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
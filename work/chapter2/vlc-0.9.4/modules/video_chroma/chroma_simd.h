@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * chroma_simd.h: AVX2 and SSSE3 conversions from planar YUV
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _CHROMA_SIMD_H_
+#define _CHROMA_SIMD_H_ 1
+
+/*
+ * Submodules of the i420_rgb plugin. They convert I420 and I422 pictures
+ * to RV16, RV24 and RV32, and I420 pictures to the packed YUV 4:2:2
+ * formats, one line at a time with the widest instructions the CPU has
+ * (AVX2, else SSSE3). Each line kernel gives the same pixels as the C one,
+ * which is only used for the end of the lines unless the module is forced.
+ */
+#define RGB_MATRIX_TEXT N_("YUV to RGB matrix")
+#define RGB_MATRIX_LONGTEXT N_( \
+    "Colorimetry of the YUV pictures converted to RGB: ITU-R BT.601 for " \
+    "standard definition, BT.709 for high definition. Automatic uses " \
+    "BT.709 for pictures higher than 576 lines.")
+
+int  OpenRGB   ( vlc_object_t * );
+int  OpenPacked( vlc_object_t * );
+void CloseSIMD ( vlc_object_t * );
+
+#endif
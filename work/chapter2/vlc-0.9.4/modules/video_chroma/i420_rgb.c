@@ -40,6 +40,7 @@
 #include "i420_rgb.h"
 #if defined (MODULE_NAME_IS_i420_rgb)
 #   include "i420_rgb_c.h"
+#   include "chroma_simd.h"
 #endif
 
 /*****************************************************************************
@@ -68,6 +69,12 @@ static void Set8bppPalette      ( filter_t *, uint8_t * );
 /*****************************************************************************
  * Module descriptor.
  *****************************************************************************/
+#if defined (MODULE_NAME_IS_i420_rgb)
+static const int pi_rgb_matrices[] = { 0, 601, 709 };
+static const char *const ppsz_rgb_matrices[] =
+    { N_("Automatic"), "BT.601", "BT.709" };
+#endif
+
 vlc_module_begin();
 #if defined (MODULE_NAME_IS_i420_rgb)
     set_description( N_("I420,IYUV,YV12 to "
@@ -85,6 +92,24 @@ vlc_module_begin();
     add_requirement( SSE2 );
 #endif
     set_callbacks( Activate, Deactivate );
+#if defined (MODULE_NAME_IS_i420_rgb)
+    add_submodule();
+    set_description( N_("AVX2 and SSSE3 I420,I422 to "
+                        "RV15,RV16,RV24,RV32 conversions") );
+    set_capability( "video filter2", 130 );
+    set_category( CAT_VIDEO );
+    set_subcategory( SUBCAT_VIDEO_VOUT );
+    add_integer( "rgb-matrix", 0, NULL, RGB_MATRIX_TEXT,
+                 RGB_MATRIX_LONGTEXT, true );
+        change_integer_list( pi_rgb_matrices, ppsz_rgb_matrices, NULL );
+    set_callbacks( OpenRGB, CloseSIMD );
+
+    add_submodule();
+    set_description( N_("AVX2 and SSSE3 I420,IYUV,YV12 to "
+                        "YUY2,YUNV,YVYU,UYVY,UYNV,Y422 conversions") );
+    set_capability( "video filter2", 300 );
+    set_callbacks( OpenPacked, CloseSIMD );
+#endif
 vlc_module_end();
 
 /*****************************************************************************
@@ -58,9 +58,12 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void I420_YUY2           ( filter_t *, picture_t *, picture_t * );
-static void I420_YVYU           ( filter_t *, picture_t *, picture_t * );
-static void I420_UYVY           ( filter_t *, picture_t *, picture_t * );
+static void I420_YUY2           ( filter_t *, picture_t *, picture_t *,
+                                  int, int );
+static void I420_YVYU           ( filter_t *, picture_t *, picture_t *,
+                                  int, int );
+static void I420_UYVY           ( filter_t *, picture_t *, picture_t *,
+                                  int, int );
 static picture_t *I420_YUY2_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_YVYU_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_UYVY_Filter    ( filter_t *, picture_t * );
@@ -185,9 +188,9 @@ static inline unsigned long long read_cycles(void)
 
 /* Following functions are local */
 
-VIDEO_FILTER_WRAPPER( I420_YUY2 )
-VIDEO_FILTER_WRAPPER( I420_YVYU )
-VIDEO_FILTER_WRAPPER( I420_UYVY )
+VIDEO_FILTER_WRAPPER_SLICES( I420_YUY2 )
+VIDEO_FILTER_WRAPPER_SLICES( I420_YVYU )
+VIDEO_FILTER_WRAPPER_SLICES( I420_UYVY )
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
 VIDEO_FILTER_WRAPPER( I420_IUYV )
 VIDEO_FILTER_WRAPPER( I420_cyuv )
@@ -200,14 +203,22 @@ VIDEO_FILTER_WRAPPER( I420_Y211 )
  * I420_YUY2: planar YUV 4:2:0 to packed YUYV 4:2:2
  *****************************************************************************/
 static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest,
+                                           int i_slice, int i_slices )
 {
-    uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
-    uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line1, *p_line2;
+    uint8_t *p_y1, *p_y2;
+    uint8_t *p_u, *p_v;
 
-    int i_x, i_y;
+    int i_x, i_y, i_first, i_last;
+
+    /* Lines are converted by pairs, which share a chroma line */
+    filter_GetSliceLines( p_filter->fmt_in.video.i_height / 2, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+    p_line2 = p_dest->p->p_pixels + 2 * i_first * p_dest->p->i_pitch;
+    p_y2 = p_source->Y_PIXELS + 2 * i_first * p_source->p[Y_PLANE].i_pitch;
+    p_u = p_source->U_PIXELS + i_first * p_source->p[U_PLANE].i_pitch;
+    p_v = p_source->V_PIXELS + i_first * p_source->p[V_PLANE].i_pitch;
 
 #if defined (MODULE_NAME_IS_i420_yuy2_altivec)
 #define VEC_NEXT_LINES( ) \
@@ -238,7 +249,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
            ( p_filter->fmt_in.video.i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -249,7 +260,8 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
             }
         }
     }
-    else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
+    else if( i_slices == 1 &&
+             !( ( p_filter->fmt_in.video.i_width % 16 ) |
                 ( p_filter->fmt_in.video.i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
@@ -297,7 +309,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_last - i_first ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -351,7 +363,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -379,7 +391,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -414,14 +426,22 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
  * I420_YVYU: planar YUV 4:2:0 to packed YVYU 4:2:2
  *****************************************************************************/
 static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest,
+                                           int i_slice, int i_slices )
 {
-    uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
-    uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line1, *p_line2;
+    uint8_t *p_y1, *p_y2;
+    uint8_t *p_u, *p_v;
 
-    int i_x, i_y;
+    int i_x, i_y, i_first, i_last;
+
+    /* Lines are converted by pairs, which share a chroma line */
+    filter_GetSliceLines( p_filter->fmt_in.video.i_height / 2, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+    p_line2 = p_dest->p->p_pixels + 2 * i_first * p_dest->p->i_pitch;
+    p_y2 = p_source->Y_PIXELS + 2 * i_first * p_source->p[Y_PLANE].i_pitch;
+    p_u = p_source->U_PIXELS + i_first * p_source->p[U_PLANE].i_pitch;
+    p_v = p_source->V_PIXELS + i_first * p_source->p[V_PLANE].i_pitch;
 
 #if defined (MODULE_NAME_IS_i420_yuy2_altivec)
 #define VEC_NEXT_LINES( ) \
@@ -452,7 +472,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
            ( p_filter->fmt_in.video.i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -463,7 +483,8 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
             }
         }
     }
-    else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
+    else if( i_slices == 1 &&
+             !( ( p_filter->fmt_in.video.i_width % 16 ) |
                 ( p_filter->fmt_in.video.i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
@@ -511,7 +532,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_last - i_first ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -561,7 +582,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -589,7 +610,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -623,14 +644,22 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
  * I420_UYVY: planar YUV 4:2:0 to packed UYVY 4:2:2
  *****************************************************************************/
 static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest,
+                                           int i_slice, int i_slices )
 {
-    uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
-    uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line1, *p_line2;
+    uint8_t *p_y1, *p_y2;
+    uint8_t *p_u, *p_v;
 
-    int i_x, i_y;
+    int i_x, i_y, i_first, i_last;
+
+    /* Lines are converted by pairs, which share a chroma line */
+    filter_GetSliceLines( p_filter->fmt_in.video.i_height / 2, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+    p_line2 = p_dest->p->p_pixels + 2 * i_first * p_dest->p->i_pitch;
+    p_y2 = p_source->Y_PIXELS + 2 * i_first * p_source->p[Y_PLANE].i_pitch;
+    p_u = p_source->U_PIXELS + i_first * p_source->p[U_PLANE].i_pitch;
+    p_v = p_source->V_PIXELS + i_first * p_source->p[V_PLANE].i_pitch;
 
 #if defined (MODULE_NAME_IS_i420_yuy2_altivec)
 #define VEC_NEXT_LINES( ) \
@@ -661,7 +690,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
            ( p_filter->fmt_in.video.i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -672,7 +701,8 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
             }
         }
     }
-    else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
+    else if( i_slices == 1 &&
+             !( ( p_filter->fmt_in.video.i_width % 16 ) |
                 ( p_filter->fmt_in.video.i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
@@ -720,7 +750,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_last - i_first ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -770,7 +800,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -798,7 +828,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_last - i_first ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
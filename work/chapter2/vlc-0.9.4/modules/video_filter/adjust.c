@@ -119,6 +119,10 @@ struct filter_sys_t
     double     f_saturation;
     double     f_gamma;
     bool b_brightness_threshold;
+
+    /* Tables of the planar picture being rendered */
+    int        pi_luma[256];
+    int        i_sat, i_sin, i_cos, i_x, i_y;
 };
 
 /*****************************************************************************
@@ -193,91 +197,33 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * Run the filter on the lines of one slice of a Planar YUV picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+static void PlanarSlice( filter_t *p_filter, picture_t *p_pic,
+                         picture_t *p_outpic, int i_slice, int i_slices )
 {
-    int pi_luma[256];
-    int pi_gamma[256];
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int *pi_luma = p_sys->pi_luma;
+    const int i_sat = p_sys->i_sat;
+    const int i_sin = p_sys->i_sin, i_cos = p_sys->i_cos;
+    const int i_x = p_sys->i_x, i_y = p_sys->i_y;
 
-    picture_t *p_outpic;
     uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint8_t *p_out, *p_out_v;
-
-    bool b_thres;
-    double  f_hue;
-    double  f_gamma;
-    int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
-    int i;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    /* Getvariables */
-    i_cont = (int)( p_sys->f_contrast * 255 );
-    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
-    f_hue = (float)( p_sys->i_hue * M_PI / 180 );
-    i_sat = (int)( p_sys->f_saturation * 256 );
-    f_gamma = 1.0 / p_sys->f_gamma;
-    b_thres = p_sys->b_brightness_threshold;
-
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( b_thres != true )
-    {
-
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += 128 - i_cont / 2;
-
-        /* Fill the gamma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
-        }
-
-        /* Fill the luma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
-        }
-
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    int i_first, i_last;
 
     /*
      * Do the Y plane
      */
 
-    p_in = p_pic->p[Y_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                      * p_pic->p[Y_PLANE].i_pitch - 8;
+    filter_GetSliceLines( p_pic->p[Y_PLANE].i_visible_lines, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+    p_in = p_pic->p[Y_PLANE].p_pixels + i_first * p_pic->p[Y_PLANE].i_pitch;
+    p_in_end = p_pic->p[Y_PLANE].p_pixels
+             + i_last * p_pic->p[Y_PLANE].i_pitch;
 
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
+    p_out = p_outpic->p[Y_PLANE].p_pixels
+          + i_first * p_outpic->p[Y_PLANE].i_pitch;
 
     for( ; p_in < p_in_end ; )
     {
@@ -309,19 +255,18 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
      * Do the U and V planes
      */
 
-    p_in = p_pic->p[U_PLANE].p_pixels;
-    p_in_v = p_pic->p[V_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[U_PLANE].i_visible_lines
-                      * p_pic->p[U_PLANE].i_pitch - 8;
+    filter_GetSliceLines( p_pic->p[U_PLANE].i_visible_lines, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+    p_in = p_pic->p[U_PLANE].p_pixels + i_first * p_pic->p[U_PLANE].i_pitch;
+    p_in_v = p_pic->p[V_PLANE].p_pixels
+           + i_first * p_pic->p[V_PLANE].i_pitch;
+    p_in_end = p_pic->p[U_PLANE].p_pixels
+             + i_last * p_pic->p[U_PLANE].i_pitch;
 
-    p_out = p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = p_outpic->p[V_PLANE].p_pixels;
-
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
-
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+    p_out = p_outpic->p[U_PLANE].p_pixels
+          + i_first * p_outpic->p[U_PLANE].i_pitch;
+    p_out_v = p_outpic->p[V_PLANE].p_pixels
+            + i_first * p_outpic->p[V_PLANE].i_pitch;
 
     if ( i_sat > 256 )
     {
@@ -406,6 +351,93 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 #undef WRITE_UV
     }
 
+}
+
+/*****************************************************************************
+ * Run the filter on a Planar YUV picture
+ *****************************************************************************/
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+{
+    int pi_gamma[256];
+    int *pi_luma;
+
+    picture_t *p_outpic;
+
+    bool b_thres;
+    double  f_hue;
+    double  f_gamma;
+    int32_t i_cont, i_lum;
+    int i_sat;
+    int i;
+
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic ) return NULL;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    /* Getvariables */
+    i_cont = (int)( p_sys->f_contrast * 255 );
+    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
+    f_hue = (float)( p_sys->i_hue * M_PI / 180 );
+    i_sat = (int)( p_sys->f_saturation * 256 );
+    f_gamma = 1.0 / p_sys->f_gamma;
+    b_thres = p_sys->b_brightness_threshold;
+    pi_luma = p_sys->pi_luma;
+
+    /*
+     * Threshold mode drops out everything about luma, contrast and gamma.
+     */
+    if( b_thres != true )
+    {
+
+        /* Contrast is a fast but kludged function, so I put this gap to be
+         * cleaner :) */
+        i_lum += 128 - i_cont / 2;
+
+        /* Fill the gamma lookup table */
+        for( i = 0 ; i < 256 ; i++ )
+        {
+          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
+        }
+
+        /* Fill the luma lookup table */
+        for( i = 0 ; i < 256 ; i++ )
+        {
+            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
+        }
+    }
+    else
+    {
+        /*
+         * We get luma as threshold value: the higher it is, the darker is
+         * the image. Should I reverse this?
+         */
+        for( i = 0 ; i < 256 ; i++ )
+        {
+            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
+        }
+
+        /*
+         * Desaturates image to avoid that strange yellow halo...
+         */
+        i_sat = 0;
+    }
+
+    p_sys->i_sat = i_sat;
+    p_sys->i_sin = sin(f_hue) * 256;
+    p_sys->i_cos = cos(f_hue) * 256;
+
+    p_sys->i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
+    p_sys->i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+
+    filter_RunSlices( p_filter, PlanarSlice, p_pic, p_outpic );
+
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
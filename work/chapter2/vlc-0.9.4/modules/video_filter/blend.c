@@ -35,6 +35,8 @@
 #include <vlc_vout.h>
 #include "vlc_filter.h"
 
+#include "blend.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -53,7 +55,7 @@ vlc_module_end();
  *****************************************************************************/
 struct filter_sys_t
 {
-    int i_dummy;
+    blend_lines_t lines;
 };
 
 #define FCC_YUVA VLC_FOURCC('Y','U','V','A')
@@ -148,6 +150,7 @@ static int OpenFilter( vlc_object_t *p_this )
 
     /* Misc init */
     p_filter->pf_video_blend = Blend;
+    blend_LinesInit( &p_sys->lines, vlc_CPU() );
 
     msg_Dbg( p_filter, "chroma: %4.4s -> %4.4s",
              (char *)&p_filter->fmt_in.video.i_chroma,
@@ -267,26 +270,6 @@ static inline uint8_t vlc_uint8( int v )
     return v;
 }
 
-#define MAX_TRANS 255
-#define TRANS_BITS  8
-
-static inline int vlc_blend( int v1, int v2, int a )
-{
-    /* TODO bench if the tests really increase speed */
-    if( a == 0 )
-        return v2;
-    else if( a == MAX_TRANS )
-        return v1;
-    return ( v1 * a + v2 * (MAX_TRANS - a ) ) >> TRANS_BITS;
-}
-
-static inline int vlc_alpha( int t, int a )
-{
-    if( a == 255 )
-        return t;
-    return (t * a) / 255;
-}
-
 static inline void yuv_to_rgb( int *r, int *g, int *b,
                                uint8_t y1, uint8_t u1, uint8_t v1 )
 {
@@ -415,12 +398,13 @@ static void BlendYUVAI420( filter_t *p_filter, picture_t *p_dst,
                            int i_x_offset, int i_y_offset,
                            int i_width, int i_height, int i_alpha )
 {
+    const blend_lines_t *p_lines = &p_filter->p_sys->lines;
     int i_src1_pitch, i_src2_pitch, i_dst_pitch;
     uint8_t *p_src1_y, *p_src2_y, *p_dst_y;
     uint8_t *p_src1_u, *p_src2_u, *p_dst_u;
     uint8_t *p_src1_v, *p_src2_v, *p_dst_v;
     uint8_t *p_trans;
-    int i_x, i_y, i_trans = 0;
+    int i_y;
     bool b_even_scanline = i_y_offset % 2;
 
     p_dst_y = vlc_plane_start( &i_dst_pitch, p_dst, Y_PLANE,
@@ -459,22 +443,15 @@ static void BlendYUVAI420( filter_t *p_filter, picture_t *p_dst,
     {
         b_even_scanline = !b_even_scanline;
 
-        /* Draw until we reach the end of the line */
-        for( i_x = 0; i_x < i_width; i_x++ )
+        /* Blending */
+        p_lines->pf_plane( p_dst_y, p_src1_y, p_src2_y, p_trans,
+                           i_width, i_alpha );
+        if( b_even_scanline )
         {
-            if( p_trans )
-                i_trans = vlc_alpha( p_trans[i_x], i_alpha );
-
-            if( !i_trans )
-                continue;
-
-            /* Blending */
-            p_dst_y[i_x] = vlc_blend( p_src2_y[i_x], p_src1_y[i_x], i_trans );
-            if( b_even_scanline && i_x % 2 == 0 )
-            {
-                p_dst_u[i_x/2] = vlc_blend( p_src2_u[i_x], p_src1_u[i_x/2], i_trans );
-                p_dst_v[i_x/2] = vlc_blend( p_src2_v[i_x], p_src1_v[i_x/2], i_trans );
-            }
+            p_lines->pf_chroma( p_dst_u, p_src1_u, p_src2_u, p_trans,
+                                i_width, i_alpha );
+            p_lines->pf_chroma( p_dst_v, p_src1_v, p_src2_v, p_trans,
+                                i_width, i_alpha );
         }
     }
 }
@@ -676,6 +653,7 @@ static void BlendYUVAYUVPacked( filter_t *p_filter, picture_t *p_dst_pic,
                                 int i_x_offset, int i_y_offset,
                                 int i_width, int i_height, int i_alpha )
 {
+    const blend_lines_t *p_lines = &p_filter->p_sys->lines;
     int i_src1_pitch, i_src2_pitch, i_dst_pitch;
     uint8_t *p_dst, *p_src1, *p_src2_y;
     uint8_t *p_src2_u, *p_src2_v;
@@ -717,6 +695,15 @@ static void BlendYUVAYUVPacked( filter_t *p_filter, picture_t *p_dst_pic,
          p_src2_y += i_src2_pitch, p_src2_u += i_src2_pitch,
          p_src2_v += i_src2_pitch )
     {
+        /* The lines start with a luma sample and its chroma */
+        if( b_even )
+        {
+            p_lines->pf_packed( p_dst, p_src1, p_src2_y, p_src2_u, p_src2_v,
+                                p_trans, i_width, i_alpha,
+                                i_l_offset, i_u_offset, i_v_offset );
+            continue;
+        }
+
         /* Draw until we reach the end of the line */
         for( i_x = 0; i_x < i_width; i_x++, b_even = !b_even )
         {
@@ -1088,16 +1075,20 @@ static void BlendI420YUVPacked( filter_t *p_filter, picture_t *p_dst_pic,
 /***********************************************************************
  * YUVP
  ***********************************************************************/
+/* Pixels looked up at a time, even */
+#define PAL_CHUNK 256
+
 static void BlendPalI420( filter_t *p_filter, picture_t *p_dst,
                           picture_t *p_dst_orig, picture_t *p_src,
                           int i_x_offset, int i_y_offset,
                           int i_width, int i_height, int i_alpha )
 {
+    const blend_lines_t *p_lines = &p_filter->p_sys->lines;
     int i_src1_pitch, i_src2_pitch, i_dst_pitch;
     uint8_t *p_src1_y, *p_src2, *p_dst_y;
     uint8_t *p_src1_u, *p_dst_u;
     uint8_t *p_src1_v, *p_dst_v;
-    int i_x, i_y, i_trans;
+    int i_x, i_y;
     bool b_even_scanline = i_y_offset % 2;
 
     i_dst_pitch = p_dst->p[Y_PLANE].i_pitch;
@@ -1143,22 +1134,34 @@ static void BlendPalI420( filter_t *p_filter, picture_t *p_dst,
          p_dst_v += b_even_scanline ? i_dst_pitch/2 : 0,
          p_src1_v += b_even_scanline ? i_src1_pitch/2 : 0 )
     {
-        const uint8_t *p_trans = p_src2;
         b_even_scanline = !b_even_scanline;
 
-        /* Draw until we reach the end of the line */
-        for( i_x = 0; i_x < i_width; i_x++ )
+        /* Look the colors up, then blend them as YUVA */
+        for( i_x = 0; i_x < i_width; i_x += PAL_CHUNK )
         {
-            i_trans = vlc_alpha( p_pal[p_trans[i_x]][3], i_alpha );
-            if( !i_trans )
-                continue;
+            const int i_count = __MIN( i_width - i_x, PAL_CHUNK );
+            uint8_t p_y[PAL_CHUNK], p_u[PAL_CHUNK], p_v[PAL_CHUNK];
+            uint8_t p_trans[PAL_CHUNK];
+
+            for( int i = 0; i < i_count; i++ )
+            {
+                const uint8_t *p_color = p_pal[p_src2[i_x + i]];
+
+                p_y[i] = p_color[0];
+                p_u[i] = p_color[1];
+                p_v[i] = p_color[2];
+                p_trans[i] = p_color[3];
+            }
 
             /* Blending */
-            p_dst_y[i_x] = vlc_blend( p_pal[p_src2[i_x]][0], p_src1_y[i_x], i_trans );
-            if( b_even_scanline && ((i_x % 2) == 0) )
+            p_lines->pf_plane( &p_dst_y[i_x], &p_src1_y[i_x], p_y, p_trans,
+                               i_count, i_alpha );
+            if( b_even_scanline )
             {
-                p_dst_u[i_x/2] = vlc_blend( p_pal[p_src2[i_x]][1], p_src1_u[i_x/2], i_trans );
-                p_dst_v[i_x/2] = vlc_blend( p_pal[p_src2[i_x]][2], p_src1_v[i_x/2], i_trans );
+                p_lines->pf_chroma( &p_dst_u[i_x/2], &p_src1_u[i_x/2], p_u,
+                                    p_trans, i_count, i_alpha );
+                p_lines->pf_chroma( &p_dst_v[i_x/2], &p_src1_v[i_x/2], p_v,
+                                    p_trans, i_count, i_alpha );
             }
         }
     }
@@ -1409,7 +1412,7 @@ static void BlendRGBAR24( filter_t *p_filter, picture_t *p_dst_pic,
     int i_src1_pitch, i_src2_pitch, i_dst_pitch;
     uint8_t *p_dst, *p_src1, *p_src2;
     int i_x, i_y, i_pix_pitch, i_trans, i_src_pix_pitch;
-    int i_rindex, i_gindex, i_bindex;
+    int i_rindex = 0, i_gindex = 1, i_bindex = 2;
 
     i_pix_pitch = p_dst_pic->p->i_pixel_pitch;
     i_dst_pitch = p_dst_pic->p->i_pitch;
@@ -1432,6 +1435,20 @@ static void BlendRGBAR24( filter_t *p_filter, picture_t *p_dst_pic,
 
     vlc_rgb_index( &i_rindex, &i_gindex, &i_bindex, &p_filter->fmt_out.video );
 
+    /* RV32 with one byte per component */
+    if( i_pix_pitch == 4 && i_src_pix_pitch == 4
+     && i_rindex != i_gindex && i_rindex != i_bindex && i_gindex != i_bindex
+     && (unsigned)( i_rindex | i_gindex | i_bindex ) < 4 )
+    {
+        const int pi_index[3] = { i_rindex, i_gindex, i_bindex };
+
+        for( i_y = 0; i_y < i_height; i_y++, p_dst += i_dst_pitch,
+             p_src1 += i_src1_pitch, p_src2 += i_src2_pitch )
+            p_filter->p_sys->lines.pf_rgb32( p_dst, p_src1, p_src2, i_width,
+                                             i_alpha, pi_index );
+        return;
+    }
+
     /* Draw until we reach the bottom of the subtitle */
     for( i_y = 0; i_y < i_height; i_y++,
          p_dst += i_dst_pitch, p_src1 += i_src1_pitch, p_src2 += i_src2_pitch )
@@ -0,0 +1,89 @@
+/*****************************************************************************
+ * blend.h: line kernels of the blend module
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _BLEND_H_
+#define _BLEND_H_ 1
+
+/*
+ * The lines of the most common blendings: YUVA (and palettized pictures,
+ * once looked up) onto I420 and packed YUV 4:2:2, and RGBA onto RV32.
+ * Every kernel gives the same pixels as the C one, skips the pixels whose
+ * alpha is 0, and, apart from the C ones, whole blocks of them.
+ */
+
+#define MAX_TRANS 255
+#define TRANS_BITS  8
+
+static inline int vlc_blend( int v1, int v2, int a )
+{
+    /* TODO bench if the tests really increase speed */
+    if( a == 0 )
+        return v2;
+    else if( a == MAX_TRANS )
+        return v1;
+    return ( v1 * a + v2 * (MAX_TRANS - a ) ) >> TRANS_BITS;
+}
+
+static inline int vlc_alpha( int t, int a )
+{
+    if( a == 255 )
+        return t;
+    return (t * a) / 255;
+}
+
+/* Blend a line of a full resolution plane:
+ *  p_dst[x] = blend( p_src2[x], p_src1[x], alpha( p_trans[x] ) ) */
+typedef void (*blend_plane_t)( uint8_t *p_dst, const uint8_t *p_src1,
+                               const uint8_t *p_src2, const uint8_t *p_trans,
+                               int i_width, int i_alpha );
+
+/* Blend a line of a half resolution plane from a full resolution one:
+ *  p_dst[x/2] = blend( p_src2[x], p_src1[x/2], alpha( p_trans[x] ) )
+ * for even x */
+typedef blend_plane_t blend_chroma_t;
+
+/* Blend a line of full resolution Y, U and V onto a YUY2, UYVY or YVYU one,
+ * starting on a luma sample with its chroma. i_width is even. */
+typedef void (*blend_packed_t)( uint8_t *p_dst, const uint8_t *p_src1,
+                                const uint8_t *p_y, const uint8_t *p_u,
+                                const uint8_t *p_v, const uint8_t *p_trans,
+                                int i_width, int i_alpha,
+                                int i_l_offset, int i_u_offset,
+                                int i_v_offset );
+
+/* Blend a line of RGBA onto a RV32 one, the bytes of R, G and B being at
+ * pi_index[0], [1] and [2] */
+typedef void (*blend_rgb32_t)( uint8_t *p_dst, const uint8_t *p_src1,
+                               const uint8_t *p_src2, int i_width,
+                               int i_alpha, const int pi_index[3] );
+
+typedef struct
+{
+    blend_plane_t  pf_plane;
+    blend_chroma_t pf_chroma;
+    blend_packed_t pf_packed;
+    blend_rgb32_t  pf_rgb32;
+} blend_lines_t;
+
+/* The fastest kernels for the given CPU_CAPABILITY_* flags */
+void blend_LinesInit( blend_lines_t *, unsigned i_cpu );
+
+#endif
@@ -0,0 +1,386 @@
+/*****************************************************************************
+ * blend_lines.c: line kernels of the blend module
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "blend.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define BLEND_SSE2 1
+#   if defined(CAN_COMPILE_SSSE3)
+#       include <tmmintrin.h>
+#       define BLEND_SSSE3 1
+#   endif
+#endif
+
+/*****************************************************************************
+ * C versions
+ *****************************************************************************/
+static void PlaneC( uint8_t *p_dst, const uint8_t *p_src1,
+                    const uint8_t *p_src2, const uint8_t *p_trans,
+                    int i_width, int i_alpha )
+{
+    for( int i_x = 0; i_x < i_width; i_x++ )
+    {
+        const int i_trans = vlc_alpha( p_trans[i_x], i_alpha );
+
+        if( i_trans )
+            p_dst[i_x] = vlc_blend( p_src2[i_x], p_src1[i_x], i_trans );
+    }
+}
+
+static void ChromaC( uint8_t *p_dst, const uint8_t *p_src1,
+                     const uint8_t *p_src2, const uint8_t *p_trans,
+                     int i_width, int i_alpha )
+{
+    for( int i_x = 0; i_x < i_width; i_x += 2 )
+    {
+        const int i_trans = vlc_alpha( p_trans[i_x], i_alpha );
+
+        if( i_trans )
+            p_dst[i_x/2] = vlc_blend( p_src2[i_x], p_src1[i_x/2], i_trans );
+    }
+}
+
+static void PackedC( uint8_t *p_dst, const uint8_t *p_src1,
+                     const uint8_t *p_y, const uint8_t *p_u,
+                     const uint8_t *p_v, const uint8_t *p_trans,
+                     int i_width, int i_alpha,
+                     int i_l_offset, int i_u_offset, int i_v_offset )
+{
+    for( int i_x = 0; i_x < i_width; i_x += 2 )
+    {
+        int i_trans = vlc_alpha( p_trans[i_x], i_alpha );
+
+        if( i_trans )
+        {
+            int i_u = p_u[i_x], i_v = p_v[i_x];
+
+            /* FIXME what's with 0xaa ? */
+            if( p_trans[i_x+1] > 0xaa )
+            {
+                i_u = ( i_u + p_u[i_x+1] ) >> 1;
+                i_v = ( i_v + p_v[i_x+1] ) >> 1;
+            }
+            p_dst[i_x*2 + i_l_offset] =
+                vlc_blend( p_y[i_x], p_src1[i_x*2 + i_l_offset], i_trans );
+            p_dst[i_x*2 + i_u_offset] =
+                vlc_blend( i_u, p_src1[i_x*2 + i_u_offset], i_trans );
+            p_dst[i_x*2 + i_v_offset] =
+                vlc_blend( i_v, p_src1[i_x*2 + i_v_offset], i_trans );
+        }
+
+        i_trans = vlc_alpha( p_trans[i_x+1], i_alpha );
+        if( i_trans )
+            p_dst[i_x*2 + 2 + i_l_offset] =
+                vlc_blend( p_y[i_x+1], p_src1[i_x*2 + 2 + i_l_offset],
+                           i_trans );
+    }
+}
+
+static void RGB32C( uint8_t *p_dst, const uint8_t *p_src1,
+                    const uint8_t *p_src2, int i_width, int i_alpha,
+                    const int pi_index[3] )
+{
+    for( int i_x = 0; i_x < i_width; i_x++ )
+    {
+        const int i_trans = vlc_alpha( p_src2[i_x * 4 + 3], i_alpha );
+
+        if( !i_trans )
+            continue;
+        for( int i = 0; i < 3; i++ )
+            p_dst[i_x * 4 + pi_index[i]] =
+                vlc_blend( p_src2[i_x * 4 + i],
+                           p_src1[i_x * 4 + pi_index[i]], i_trans );
+    }
+}
+
+/*****************************************************************************
+ * SSE2 versions
+ *****************************************************************************
+ * The alphas and the blending are computed on 16 bits, exactly as in C:
+ * t * a / 255 is the high word of t * a * 0x8081 shifted by 7 bits.
+ *****************************************************************************/
+#if defined(BLEND_SSE2)
+#define SSE2_INLINE static inline \
+    __attribute__((__target__("sse2"), __always_inline__))
+#define SSE2_LINE static __attribute__((__target__("sse2")))
+
+/* alpha( t, a ) of 16 bytes */
+SSE2_INLINE
+__m128i Alpha( __m128i t, __m128i a )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i div = _mm_set1_epi16( 0x8081 );
+    __m128i lo = _mm_mullo_epi16( _mm_unpacklo_epi8( t, zero ), a );
+    __m128i hi = _mm_mullo_epi16( _mm_unpackhi_epi8( t, zero ), a );
+
+    lo = _mm_srli_epi16( _mm_mulhi_epu16( lo, div ), 7 );
+    hi = _mm_srli_epi16( _mm_mulhi_epu16( hi, div ), 7 );
+    return _mm_packus_epi16( lo, hi );
+}
+
+/* blend( s, d, t ) of 16 bytes, keeping the bytes of k whose t is 0 */
+SSE2_INLINE
+__m128i Blend( __m128i s, __m128i d, __m128i t, __m128i k )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16( MAX_TRANS );
+    const __m128i t_lo = _mm_unpacklo_epi8( t, zero );
+    const __m128i t_hi = _mm_unpackhi_epi8( t, zero );
+    __m128i lo, hi, r, mask;
+
+    lo = _mm_add_epi16(
+            _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), t_lo ),
+            _mm_mullo_epi16( _mm_unpacklo_epi8( d, zero ),
+                             _mm_sub_epi16( max, t_lo ) ) );
+    hi = _mm_add_epi16(
+            _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), t_hi ),
+            _mm_mullo_epi16( _mm_unpackhi_epi8( d, zero ),
+                             _mm_sub_epi16( max, t_hi ) ) );
+    r = _mm_packus_epi16( _mm_srli_epi16( lo, TRANS_BITS ),
+                          _mm_srli_epi16( hi, TRANS_BITS ) );
+
+    mask = _mm_cmpeq_epi8( t, _mm_set1_epi8( (char)MAX_TRANS ) );
+    r = _mm_or_si128( _mm_and_si128( mask, s ), _mm_andnot_si128( mask, r ) );
+    mask = _mm_cmpeq_epi8( t, zero );
+    return _mm_or_si128( _mm_and_si128( mask, k ),
+                         _mm_andnot_si128( mask, r ) );
+}
+
+SSE2_INLINE
+bool IsTransparent( __m128i t )
+{
+    return _mm_movemask_epi8( _mm_cmpeq_epi8( t, _mm_setzero_si128() ) )
+           == 0xffff;
+}
+
+SSE2_LINE
+void PlaneSSE2( uint8_t *p_dst, const uint8_t *p_src1,
+                const uint8_t *p_src2, const uint8_t *p_trans,
+                int i_width, int i_alpha )
+{
+    const __m128i alpha = _mm_set1_epi16( i_alpha );
+    int i_x;
+
+    for( i_x = 0; i_x + 16 <= i_width; i_x += 16 )
+    {
+        __m128i t = _mm_loadu_si128( (const __m128i *)&p_trans[i_x] );
+
+        if( IsTransparent( t ) )
+            continue;
+        t = Alpha( t, alpha );
+        _mm_storeu_si128( (__m128i *)&p_dst[i_x], Blend(
+                _mm_loadu_si128( (const __m128i *)&p_src2[i_x] ),
+                _mm_loadu_si128( (const __m128i *)&p_src1[i_x] ), t,
+                _mm_loadu_si128( (const __m128i *)&p_dst[i_x] ) ) );
+    }
+    PlaneC( &p_dst[i_x], &p_src1[i_x], &p_src2[i_x], &p_trans[i_x],
+            i_width - i_x, i_alpha );
+}
+
+/* The even bytes of 32 */
+SSE2_INLINE
+__m128i Even( const uint8_t *p )
+{
+    const __m128i low = _mm_set1_epi16( 0xff );
+
+    return _mm_packus_epi16(
+        _mm_and_si128( _mm_loadu_si128( (const __m128i *)&p[0] ), low ),
+        _mm_and_si128( _mm_loadu_si128( (const __m128i *)&p[16] ), low ) );
+}
+
+SSE2_LINE
+void ChromaSSE2( uint8_t *p_dst, const uint8_t *p_src1,
+                 const uint8_t *p_src2, const uint8_t *p_trans,
+                 int i_width, int i_alpha )
+{
+    const __m128i alpha = _mm_set1_epi16( i_alpha );
+    int i_x;
+
+    for( i_x = 0; i_x + 32 <= i_width; i_x += 32 )
+    {
+        __m128i t = Even( &p_trans[i_x] );
+
+        if( IsTransparent( t ) )
+            continue;
+        t = Alpha( t, alpha );
+        _mm_storeu_si128( (__m128i *)&p_dst[i_x/2], Blend(
+                Even( &p_src2[i_x] ),
+                _mm_loadu_si128( (const __m128i *)&p_src1[i_x/2] ), t,
+                _mm_loadu_si128( (const __m128i *)&p_dst[i_x/2] ) ) );
+    }
+    ChromaC( &p_dst[i_x/2], &p_src1[i_x/2], &p_src2[i_x], &p_trans[i_x],
+             i_width - i_x, i_alpha );
+}
+
+/* The chroma of 8 pairs of pixels, in 16 bits words */
+SSE2_INLINE
+__m128i PairChroma( const uint8_t *p_c, __m128i average )
+{
+    const __m128i c = _mm_loadu_si128( (const __m128i *)p_c );
+    const __m128i first = _mm_and_si128( c, _mm_set1_epi16( 0xff ) );
+    const __m128i mean = _mm_srli_epi16(
+            _mm_add_epi16( first, _mm_srli_epi16( c, 8 ) ), 1 );
+
+    return _mm_or_si128( _mm_and_si128( average, mean ),
+                         _mm_andnot_si128( average, first ) );
+}
+
+SSE2_LINE
+void PackedSSE2( uint8_t *p_dst, const uint8_t *p_src1,
+                 const uint8_t *p_y, const uint8_t *p_u,
+                 const uint8_t *p_v, const uint8_t *p_trans,
+                 int i_width, int i_alpha,
+                 int i_l_offset, int i_u_offset, int i_v_offset )
+{
+    const __m128i alpha = _mm_set1_epi16( i_alpha );
+    const __m128i low = _mm_set1_epi16( 0xff );
+    /* YUY2 and YVYU start with luma, UYVY with chroma */
+    const bool b_luma_first = i_l_offset == 0;
+    const bool b_u_first = i_u_offset < i_v_offset;
+    const bool b_known =
+        ( i_l_offset == 0 && i_u_offset + i_v_offset == 4 && i_u_offset & 1 )
+     || ( i_l_offset == 1 && i_u_offset + i_v_offset == 2 && !(i_u_offset & 1) );
+    int i_x;
+
+    for( i_x = 0; b_known && i_x + 16 <= i_width; i_x += 16 )
+    {
+        const __m128i t_raw = _mm_loadu_si128( (const __m128i *)&p_trans[i_x] );
+        __m128i t, t_pair, average, u, v, c, y, s[2], ts[2];
+
+        if( IsTransparent( t_raw ) )
+            continue;
+
+        /* Alpha of every pixel, and of the first pixel of each pair */
+        t = Alpha( t_raw, alpha );
+        t_pair = _mm_and_si128( t, low );
+        t_pair = _mm_or_si128( t_pair, _mm_slli_epi16( t_pair, 8 ) );
+
+        average = _mm_cmpgt_epi16( _mm_srli_epi16( t_raw, 8 ),
+                                   _mm_set1_epi16( 0xaa ) );
+        u = PairChroma( &p_u[i_x], average );
+        v = PairChroma( &p_v[i_x], average );
+        c = b_u_first ? _mm_or_si128( u, _mm_slli_epi16( v, 8 ) )
+                      : _mm_or_si128( v, _mm_slli_epi16( u, 8 ) );
+        y = _mm_loadu_si128( (const __m128i *)&p_y[i_x] );
+
+        if( b_luma_first )
+        {
+            s[0] = _mm_unpacklo_epi8( y, c );
+            s[1] = _mm_unpackhi_epi8( y, c );
+            ts[0] = _mm_unpacklo_epi8( t, t_pair );
+            ts[1] = _mm_unpackhi_epi8( t, t_pair );
+        }
+        else
+        {
+            s[0] = _mm_unpacklo_epi8( c, y );
+            s[1] = _mm_unpackhi_epi8( c, y );
+            ts[0] = _mm_unpacklo_epi8( t_pair, t );
+            ts[1] = _mm_unpackhi_epi8( t_pair, t );
+        }
+        for( int i = 0; i < 2; i++ )
+        {
+            __m128i *p = (__m128i *)&p_dst[i_x * 2 + 16 * i];
+
+            _mm_storeu_si128( p, Blend( s[i],
+                _mm_loadu_si128( (const __m128i *)&p_src1[i_x * 2 + 16 * i] ),
+                ts[i], _mm_loadu_si128( p ) ) );
+        }
+    }
+    PackedC( &p_dst[i_x * 2], &p_src1[i_x * 2], &p_y[i_x], &p_u[i_x],
+             &p_v[i_x], &p_trans[i_x], i_width - i_x, i_alpha,
+             i_l_offset, i_u_offset, i_v_offset );
+}
+#endif
+
+/*****************************************************************************
+ * SSSE3 versions
+ *****************************************************************************/
+#if defined(BLEND_SSSE3)
+#define SSSE3_LINE static __attribute__((__target__("ssse3")))
+
+SSSE3_LINE
+void RGB32SSSE3( uint8_t *p_dst, const uint8_t *p_src1,
+                 const uint8_t *p_src2, int i_width, int i_alpha,
+                 const int pi_index[3] )
+{
+    const __m128i alpha = _mm_set1_epi16( i_alpha );
+    int8_t pi_color[16], pi_trans[16];
+    __m128i color, trans;
+    int i_x;
+
+    /* Move R, G and B to their bytes, and their alpha next to them. The
+     * fourth byte gets an alpha of 0 and is kept. */
+    for( int i = 0; i < 16; i++ )
+        pi_color[i] = pi_trans[i] = -1;
+    for( int i = 0; i < 16; i += 4 )
+        for( int j = 0; j < 3; j++ )
+        {
+            pi_color[i + pi_index[j]] = i + j;
+            pi_trans[i + pi_index[j]] = i + 3;
+        }
+    color = _mm_loadu_si128( (const __m128i *)pi_color );
+    trans = _mm_loadu_si128( (const __m128i *)pi_trans );
+
+    for( i_x = 0; i_x + 4 <= i_width; i_x += 4 )
+    {
+        const __m128i src = _mm_loadu_si128( (const __m128i *)&p_src2[i_x * 4] );
+        __m128i t = _mm_shuffle_epi8( src, trans );
+
+        if( IsTransparent( t ) )
+            continue;
+        t = Alpha( t, alpha );
+        _mm_storeu_si128( (__m128i *)&p_dst[i_x * 4], Blend(
+                _mm_shuffle_epi8( src, color ),
+                _mm_loadu_si128( (const __m128i *)&p_src1[i_x * 4] ), t,
+                _mm_loadu_si128( (const __m128i *)&p_dst[i_x * 4] ) ) );
+    }
+    RGB32C( &p_dst[i_x * 4], &p_src1[i_x * 4], &p_src2[i_x * 4],
+            i_width - i_x, i_alpha, pi_index );
+}
+#endif
+
+void blend_LinesInit( blend_lines_t *p_lines, unsigned i_cpu )
+{
+    p_lines->pf_plane  = PlaneC;
+    p_lines->pf_chroma = ChromaC;
+    p_lines->pf_packed = PackedC;
+    p_lines->pf_rgb32  = RGB32C;
+#if defined(BLEND_SSE2)
+    if( i_cpu & CPU_CAPABILITY_SSE2 )
+    {
+        p_lines->pf_plane  = PlaneSSE2;
+        p_lines->pf_chroma = ChromaSSE2;
+        p_lines->pf_packed = PackedSSE2;
+    }
+#endif
+#if defined(BLEND_SSSE3)
+    if( i_cpu & CPU_CAPABILITY_SSSE3 )
+        p_lines->pf_rgb32  = RGB32SSSE3;
+#endif
+    (void)i_cpu;
+}
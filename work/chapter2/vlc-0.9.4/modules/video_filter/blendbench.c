@@ -31,6 +31,7 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_interface.h>
 #include <vlc_sout.h>
 #include <vlc_vout.h>
 
@@ -45,6 +46,9 @@ static void Destroy( vlc_object_t * );
 
 static picture_t *Filter( filter_t *, picture_t * );
 
+static int  OpenBench( vlc_object_t * );
+static void RunBench( intf_thread_t * );
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -68,6 +72,14 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  "in")
 
+#define WIDTH_TEXT N_("Width of the pictures")
+#define WIDTH_LONGTEXT N_("Width of the pictures blended by the " \
+                          "blendbench interface")
+
+#define HEIGHT_TEXT N_("Height of the pictures")
+#define HEIGHT_LONGTEXT N_("Height of the pictures blended by the " \
+                           "blendbench interface")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin();
@@ -95,7 +107,21 @@ vlc_module_begin();
     add_string( CFG_PREFIX "blend-chroma", "YUVA", NULL, BLEND_CHROMA_TEXT,
               BLEND_CHROMA_LONGTEXT, false );
 
+    set_section( N_("Headless benchmark"), NULL );
+    add_integer( CFG_PREFIX "width", 1920, NULL, WIDTH_TEXT,
+                 WIDTH_LONGTEXT, false );
+    add_integer( CFG_PREFIX "height", 1080, NULL, HEIGHT_TEXT,
+                 HEIGHT_LONGTEXT, false );
+
     set_callbacks( Create, Destroy );
+
+    /* vlc -I blendbench: blends synthetic pictures of every supported
+     * chroma onto every supported chroma, prints the speeds, and quits */
+    add_submodule();
+    set_description( N_("Blending benchmark") );
+    set_capability( "interface", 0 );
+    add_shortcut( "blendbench" );
+    set_callbacks( OpenBench, NULL );
 vlc_module_end();
 
 static const char *const ppsz_filter_options[] = {
@@ -262,3 +288,171 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     p_sys->b_done = true;
     return p_pic;
 }
+
+/*****************************************************************************
+ * Headless benchmark
+ *****************************************************************************
+ * Each blending is timed twice: with a picture covering the whole base
+ * picture with every alpha, and with a sparser one, transparent but for a
+ * band of a quarter of its lines, as subtitles are. The SIMD versions of the
+ * blend module are compared with the C ones with --no-sse2 --no-ssse3.
+ *****************************************************************************/
+static const vlc_fourcc_t pi_bench_src[] = {
+    VLC_FOURCC('Y','U','V','A'), VLC_FOURCC('Y','U','V','P'),
+    VLC_FOURCC('R','G','B','A'), VLC_FOURCC('I','4','2','0'),
+};
+
+static const vlc_fourcc_t pi_bench_dst[] = {
+    VLC_FOURCC('I','4','2','0'), VLC_FOURCC('Y','U','Y','2'),
+    VLC_FOURCC('U','Y','V','Y'), VLC_FOURCC('R','V','1','6'),
+    VLC_FOURCC('R','V','2','4'), VLC_FOURCC('R','V','3','2'),
+};
+
+static int OpenBench( vlc_object_t *p_this )
+{
+    intf_thread_t *p_intf = (intf_thread_t *)p_this;
+
+    p_intf->pf_run = RunBench;
+    return VLC_SUCCESS;
+}
+
+/* Fill a picture to blend: smooth colors, and an alpha going through every
+ * value along the lines, or 0 outside of the band if b_sparse */
+static void FillBlendPicture( picture_t *p_pic, video_palette_t *p_palette,
+                              bool b_sparse )
+{
+    const int i_lines = p_pic->p[0].i_visible_lines;
+
+    for( int i = 0; i < 256; i++ )
+    {
+        p_palette->palette[i][0] = 16 + i * 219 / 255;
+        p_palette->palette[i][1] = 255 - i;
+        p_palette->palette[i][2] = i;
+        p_palette->palette[i][3] = i;
+    }
+    p_palette->i_entries = 256;
+
+    for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+    {
+        plane_t *p = &p_pic->p[i_plane];
+        const bool b_alpha_plane = i_plane == A_PLANE;
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            const int i_line = y * i_lines / p->i_visible_lines;
+            const bool b_hidden = b_sparse && ( i_line < i_lines * 5 / 8
+                                             || i_line >= i_lines * 7 / 8 );
+
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+            {
+                const int i_pixel = x / p->i_pixel_pitch;
+                const int i_pixels = p->i_visible_pitch / p->i_pixel_pitch;
+                const int i_alpha = b_hidden ? 0 : i_pixel * 255 / i_pixels;
+                uint8_t *p_sample = &p->p_pixels[y * p->i_pitch + x];
+
+                if( p_pic->format.i_chroma == VLC_FOURCC('Y','U','V','P') )
+                    /* The alpha of the palette follows the index */
+                    *p_sample = i_alpha;
+                else if( b_alpha_plane || ( p->i_pixel_pitch == 4
+                                         && x % 4 == 3 ) )
+                    *p_sample = i_alpha;
+                else
+                    *p_sample = 128 + ( x + 3 * y ) % 64 - i_plane * 8;
+            }
+        }
+    }
+}
+
+/* Mpixel/s of the blending of p_src onto p_dst, or 0 if not supported */
+static double BenchBlend( intf_thread_t *p_intf, picture_t *p_dst,
+                          picture_t *p_src, video_palette_t *p_palette,
+                          int i_loops, int i_alpha )
+{
+    filter_t *p_blend = vlc_object_create( p_intf, sizeof(filter_t) );
+    mtime_t i_start, i_time;
+    int i_done = 0;
+
+    if( !p_blend )
+        return 0.;
+    vlc_object_attach( p_blend, p_intf );
+    p_blend->fmt_out.video = p_dst->format;
+    p_blend->fmt_in.video = p_src->format;
+    p_blend->fmt_in.video.p_palette = p_palette;
+    p_blend->p_module = module_Need( p_blend, "video blending", 0, 0 );
+    if( !p_blend->p_module )
+    {
+        vlc_object_detach( p_blend );
+        vlc_object_release( p_blend );
+        return 0.;
+    }
+
+    /* At most one second */
+    i_start = mdate();
+    do
+    {
+        p_blend->pf_video_blend( p_blend, p_dst, p_dst, p_src, 0, 0,
+                                 i_alpha );
+        i_done++;
+    } while( ( i_time = mdate() - i_start ) < 1000000 && i_done < i_loops );
+
+    module_Unneed( p_blend, p_blend->p_module );
+    vlc_object_detach( p_blend );
+    vlc_object_release( p_blend );
+
+    return (double)i_done * p_src->format.i_visible_width
+         * p_src->format.i_visible_height / i_time;
+}
+
+static void RunBench( intf_thread_t *p_intf )
+{
+    const int i_width = __MAX( config_GetInt( p_intf, CFG_PREFIX "width" ), 2 );
+    const int i_height = __MAX( config_GetInt( p_intf, CFG_PREFIX "height" ), 2 );
+    const int i_loops = config_GetInt( p_intf, CFG_PREFIX "loops" );
+    const int i_alpha = config_GetInt( p_intf, CFG_PREFIX "alpha" );
+    video_palette_t palette;
+
+    printf( "Blending %dx%d pictures with alpha %d, in Mpixel/s "
+            "(whole picture, subtitle band):\n", i_width, i_height, i_alpha );
+
+    for( unsigned i = 0; i < sizeof(pi_bench_src) / sizeof(pi_bench_src[0]);
+         i++ )
+    {
+        picture_t *p_src = picture_New( pi_bench_src[i], i_width, i_height,
+                                        VOUT_ASPECT_FACTOR );
+
+        if( !p_src )
+            continue;
+
+        for( unsigned j = 0;
+             j < sizeof(pi_bench_dst) / sizeof(pi_bench_dst[0]); j++ )
+        {
+            picture_t *p_dst = picture_New( pi_bench_dst[j], i_width,
+                                            i_height, VOUT_ASPECT_FACTOR );
+            double pf_speed[2];
+
+            if( !p_dst )
+                continue;
+            for( int k = 0; k < 2; k++ )
+            {
+                for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+                    memset( p_dst->p[i_plane].p_pixels, 0x80,
+                            p_dst->p[i_plane].i_pitch
+                             * p_dst->p[i_plane].i_lines );
+                FillBlendPicture( p_src, &palette, k == 1 );
+                pf_speed[k] = BenchBlend( p_intf, p_dst, p_src, &palette,
+                                          i_loops, i_alpha );
+            }
+            picture_Release( p_dst );
+
+            if( pf_speed[0] > 0. )
+                printf( "  %4.4s -> %4.4s %10.1f %10.1f\n",
+                        (const char *)&pi_bench_src[i],
+                        (const char *)&pi_bench_dst[j],
+                        pf_speed[0], pf_speed[1] );
+        }
+        picture_Release( p_src );
+    }
+    fflush( stdout );
+
+    vlc_object_kill( p_intf->p_libvlc );
+}
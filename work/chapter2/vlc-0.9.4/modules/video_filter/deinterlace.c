@@ -46,6 +46,7 @@
 #endif
 
 #include "filter_common.h"
+#include "yadif.h"
 
 #define DEINTERLACE_DISCARD 1
 #define DEINTERLACE_MEAN    2
@@ -53,6 +54,8 @@
 #define DEINTERLACE_BOB     4
 #define DEINTERLACE_LINEAR  5
 #define DEINTERLACE_X       6
+#define DEINTERLACE_YADIF   7
+#define DEINTERLACE_YADIF2X 8
 
 /*****************************************************************************
  * Local protypes
@@ -70,6 +73,7 @@ static void RenderMean   ( vout_thread_t *, picture_t *, picture_t * );
 static void RenderBlend  ( vout_thread_t *, picture_t *, picture_t * );
 static void RenderLinear ( vout_thread_t *, picture_t *, picture_t *, int );
 static void RenderX      ( picture_t *, picture_t * );
+static mtime_t RenderYadif( vout_thread_t *, picture_t *, picture_t *, int );
 
 static void MergeGeneric ( void *, const void *, const void *, size_t );
 #if defined(CAN_COMPILE_C_ALTIVEC)
@@ -91,6 +95,8 @@ static void EndMMX       ( void );
 static void End3DNow     ( void );
 #endif
 
+static void FlushHistory ( vout_sys_t * );
+
 static int  SendEvents   ( vlc_object_t *, char const *,
                            vlc_value_t, vlc_value_t, void * );
 
@@ -115,12 +121,18 @@ static int FilterCallback ( vlc_object_t *, char const *,
 #define SOUT_MODE_TEXT N_("Streaming deinterlace mode")
 #define SOUT_MODE_LONGTEXT N_("Deinterlace method to use for streaming.")
 
+#define THREADS_TEXT N_("Yadif threads")
+#define THREADS_LONGTEXT N_("Number of threads sharing the work of the " \
+    "yadif modes, which split each picture into horizontal slices. " \
+    "0 uses one thread per processor.")
+
 #define FILTER_CFG_PREFIX "sout-deinterlace-"
 
 static const char *const mode_list[] = {
-    "discard", "blend", "mean", "bob", "linear", "x" };
+    "discard", "blend", "mean", "bob", "linear", "x", "yadif", "yadif2x" };
 static const char *const mode_list_text[] = {
-    N_("Discard"), N_("Blend"), N_("Mean"), N_("Bob"), N_("Linear"), "X" };
+    N_("Discard"), N_("Blend"), N_("Mean"), N_("Bob"), N_("Linear"), "X",
+    "Yadif", N_("Yadif (2x)") };
 
 vlc_module_begin();
     set_description( N_("Deinterlacing video filter") );
@@ -133,6 +145,8 @@ vlc_module_begin();
     add_string( "deinterlace-mode", "discard", NULL, MODE_TEXT,
                 MODE_LONGTEXT, false );
         change_string_list( mode_list, mode_list_text, 0 );
+    add_integer_with_range( "deinterlace-threads", 0, 0, 32, NULL,
+                            THREADS_TEXT, THREADS_LONGTEXT, true );
 
     add_shortcut( "deinterlace" );
     set_callbacks( Create, Destroy );
@@ -171,6 +185,11 @@ struct vout_sys_t
 
     void (*pf_merge) ( void *, const void *, const void *, size_t );
     void (*pf_end_merge) ( void );
+
+    /* Yadif: copies of the previous, current and next input pictures */
+    int        i_threads;
+    yadif_t   *p_yadif;
+    picture_t *pp_history[3];
 };
 
 /*****************************************************************************
@@ -210,6 +229,13 @@ static int Create( vlc_object_t *p_this )
     p_vout->p_sys->p_vout = 0;
     vlc_mutex_init( &p_vout->p_sys->filter_lock );
 
+    /* 0 for one thread per CPU */
+    p_vout->p_sys->i_threads = __MAX( var_CreateGetInteger( p_vout,
+                                            "deinterlace-threads" ), 0 );
+    p_vout->p_sys->p_yadif = NULL;
+    memset( p_vout->p_sys->pp_history, 0,
+            sizeof( p_vout->p_sys->pp_history ) );
+
 #if defined(CAN_COMPILE_C_ALTIVEC)
     if( vlc_CPU() & CPU_CAPABILITY_ALTIVEC )
     {
@@ -306,6 +332,18 @@ static void SetFilterMethod( vout_thread_t *p_vout, char *psz_method )
         p_vout->p_sys->b_double_rate = false;
         p_vout->p_sys->b_half_height = false;
     }
+    else if( !strcmp( psz_method, "yadif" ) )
+    {
+        p_vout->p_sys->i_mode = DEINTERLACE_YADIF;
+        p_vout->p_sys->b_double_rate = false;
+        p_vout->p_sys->b_half_height = false;
+    }
+    else if( !strcmp( psz_method, "yadif2x" ) )
+    {
+        p_vout->p_sys->i_mode = DEINTERLACE_YADIF2X;
+        p_vout->p_sys->b_double_rate = true;
+        p_vout->p_sys->b_half_height = false;
+    }
     else
     {
         if( strcmp( psz_method, "discard" ) )
@@ -422,6 +460,8 @@ static void End( vout_thread_t *p_vout )
     if( p_vout->p_sys->p_vout )
         DEL_CALLBACKS( p_vout->p_sys->p_vout, SendEvents );
 
+    FlushHistory( p_vout->p_sys );
+
     /* Free the fake output buffers we allocated */
     for( i_index = I_OUTPUTPICTURES ; i_index ; )
     {
@@ -441,6 +481,10 @@ static void End( vout_thread_t *p_vout )
 static void Destroy( vlc_object_t *p_this )
 {
     vout_thread_t *p_vout = (vout_thread_t *)p_this;
+
+    FlushHistory( p_vout->p_sys );
+    if( p_vout->p_sys->p_yadif )
+        yadif_Delete( p_vout->p_sys->p_yadif );
     vlc_mutex_destroy( &p_vout->p_sys->filter_lock );
     free( p_vout->p_sys );
 }
@@ -456,6 +500,7 @@ static void Render ( vout_thread_t *p_vout, picture_t *p_pic )
 {
     vout_sys_t *p_sys = p_vout->p_sys;
     picture_t *pp_outpic[2];
+    bool b_yadif;
 
     /* FIXME are they needed ? */
     p_vout->fmt_out.i_x_offset = p_vout->fmt_in.i_x_offset;
@@ -511,7 +556,11 @@ static void Render ( vout_thread_t *p_vout, picture_t *p_pic )
         msleep( VOUT_OUTMEM_SLEEP );
     }
 
-    vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[0], p_pic->date );
+    /* yadif shows an older picture, dated from what RenderYadif returns */
+    b_yadif = p_vout->p_sys->i_mode == DEINTERLACE_YADIF
+           || p_vout->p_sys->i_mode == DEINTERLACE_YADIF2X;
+    if( !b_yadif )
+        vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[0], p_pic->date );
 
     /* If we are using double rate, get an additional new picture */
     if( p_vout->p_sys->b_double_rate )
@@ -529,16 +578,16 @@ static void Render ( vout_thread_t *p_vout, picture_t *p_pic )
             msleep( VOUT_OUTMEM_SLEEP );
         }
 
-        /* 20ms is a bit arbitrary, but it's only for the first image we get */
-        if( !p_vout->p_sys->last_date )
-        {
-            vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[1],
-                              p_pic->date + 20000 );
-        }
-        else
+        if( !b_yadif )
         {
-            vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[1],
-                      (3 * p_pic->date - p_vout->p_sys->last_date) / 2 );
+            /* 20ms is a bit arbitrary, but it's only for the first image
+             * we get */
+            if( !p_vout->p_sys->last_date )
+                vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[1],
+                                  p_pic->date + 20000 );
+            else
+                vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[1],
+                          (3 * p_pic->date - p_vout->p_sys->last_date) / 2 );
         }
         p_vout->p_sys->last_date = p_pic->date;
     }
@@ -578,6 +627,21 @@ static void Render ( vout_thread_t *p_vout, picture_t *p_pic )
             RenderX( pp_outpic[0], p_pic );
             vout_DisplayPicture( p_vout->p_sys->p_vout, pp_outpic[0] );
             break;
+
+        case DEINTERLACE_YADIF:
+            vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[0],
+                              RenderYadif( p_vout, pp_outpic[0], p_pic, 0 ) );
+            vout_DisplayPicture( p_vout->p_sys->p_vout, pp_outpic[0] );
+            break;
+
+        case DEINTERLACE_YADIF2X:
+            vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[0],
+                              RenderYadif( p_vout, pp_outpic[0], p_pic, 0 ) );
+            vout_DisplayPicture( p_vout->p_sys->p_vout, pp_outpic[0] );
+            vout_DatePicture( p_vout->p_sys->p_vout, pp_outpic[1],
+                              RenderYadif( p_vout, pp_outpic[1], p_pic, 1 ) );
+            vout_DisplayPicture( p_vout->p_sys->p_vout, pp_outpic[1] );
+            break;
     }
     vlc_mutex_unlock( &p_vout->p_sys->filter_lock );
 }
@@ -1994,6 +2058,99 @@ static void RenderX( picture_t *p_outpic, picture_t *p_pic )
 #endif
 }
 
+/*****************************************************************************
+ * PushHistory: keep a copy of the last three input pictures for yadif
+ *****************************************************************************/
+static int PushHistory( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    picture_t *p_oldest = p_sys->pp_history[0];
+
+    /* Start over on the first picture, and after seeking backward */
+    if( p_oldest == NULL || p_pic->date < p_sys->pp_history[2]->date )
+    {
+        FlushHistory( p_sys );
+        for( int i = 0; i < 3; i++ )
+        {
+            p_sys->pp_history[i] = picture_New( p_vout->render.i_chroma,
+                                                p_vout->render.i_width,
+                                                p_vout->render.i_height,
+                                                p_vout->render.i_aspect );
+            if( p_sys->pp_history[i] == NULL )
+            {
+                FlushHistory( p_sys );
+                return VLC_ENOMEM;
+            }
+            picture_Copy( p_sys->pp_history[i], p_pic );
+        }
+        return VLC_SUCCESS;
+    }
+
+    p_sys->pp_history[0] = p_sys->pp_history[1];
+    p_sys->pp_history[1] = p_sys->pp_history[2];
+    p_sys->pp_history[2] = p_oldest;
+    picture_Copy( p_oldest, p_pic );
+    return VLC_SUCCESS;
+}
+
+static void FlushHistory( vout_sys_t *p_sys )
+{
+    for( int i = 0; i < 3; i++ )
+    {
+        if( p_sys->pp_history[i] )
+            picture_Release( p_sys->pp_history[i] );
+        p_sys->pp_history[i] = NULL;
+    }
+}
+
+/*****************************************************************************
+ * RenderYadif: motion adaptive deinterlacing, see yadif.c
+ *****************************************************************************
+ * The missing field is rebuilt from the previous and next pictures, so the
+ * picture shown is the one before p_pic: this adds a picture of latency.
+ * i_order tells which field of it is kept, 0 for the first one in time.
+ * Returns the date of the field shown.
+ *****************************************************************************/
+static mtime_t RenderYadif( vout_thread_t *p_vout, picture_t *p_outpic,
+                         picture_t *p_pic, int i_order )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    picture_t *p_cur, *p_next;
+    mtime_t i_date;
+
+    if( p_sys->p_yadif == NULL )
+    {
+        p_sys->p_yadif = yadif_New( VLC_OBJECT(p_vout), p_sys->i_threads );
+        if( p_sys->p_yadif )
+            msg_Dbg( p_vout, "yadif with the %s line filter",
+                     yadif_GetKernel( p_sys->p_yadif ) );
+    }
+
+    if( p_sys->p_yadif == NULL
+     || ( i_order == 0 && PushHistory( p_vout, p_pic ) != VLC_SUCCESS )
+     || p_sys->pp_history[0] == NULL )
+    {
+        RenderBlend( p_vout, p_outpic, p_pic );
+        return p_pic->date + i_order * 20000;
+    }
+
+    p_cur = p_sys->pp_history[1];
+    p_next = p_sys->pp_history[2];
+
+    /* The second field is halfway to the next picture, 20ms when the
+     * history still holds copies of the first picture */
+    i_date = p_cur->date;
+    if( i_order && p_next->date > p_cur->date )
+        i_date = ( p_cur->date + p_next->date ) / 2;
+    else if( i_order )
+        i_date = p_cur->date + 20000;
+
+    yadif_Filter( p_sys->p_yadif, p_outpic, p_sys->pp_history[0], p_cur,
+                  p_next, ( p_cur->b_top_field_first ? 0 : 1 ) ^ i_order,
+                  p_cur->b_top_field_first );
+    return i_date;
+}
+
 /*****************************************************************************
  * SendEvents: forward mouse and keyboard events to the parent p_vout
  *****************************************************************************/
@@ -2036,6 +2193,7 @@ static int FilterCallback( vlc_object_t *p_this, char const *psz_cmd,
     vlc_mutex_lock( &p_vout->p_sys->filter_lock );
 
     SetFilterMethod( p_vout, newval.psz_string );
+    FlushHistory( p_vout->p_sys );
 
     switch( p_vout->render.i_chroma )
     {
@@ -2062,9 +2220,13 @@ static int FilterCallback( vlc_object_t *p_this, char const *psz_cmd,
         case DEINTERLACE_BOB:
         case DEINTERLACE_BLEND:
         case DEINTERLACE_LINEAR:
+        case DEINTERLACE_YADIF:
+        case DEINTERLACE_YADIF2X:
             if( ( i_old_mode == DEINTERLACE_BOB )
                 || ( i_old_mode == DEINTERLACE_BLEND )
-                || ( i_old_mode == DEINTERLACE_LINEAR ) )
+                || ( i_old_mode == DEINTERLACE_LINEAR )
+                || ( i_old_mode == DEINTERLACE_YADIF )
+                || ( i_old_mode == DEINTERLACE_YADIF2X ) )
             {
                 vlc_mutex_unlock( &p_vout->p_sys->filter_lock );
                 return VLC_SUCCESS;
@@ -2122,6 +2284,7 @@ static picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
 {
     vout_thread_t *p_vout = (vout_thread_t *)p_filter->p_sys;
     picture_t *p_pic_dst;
+    mtime_t i_date = p_pic->date;
 
     /* Request output picture */
     p_pic_dst = filter_NewPicture( p_filter );
@@ -2151,6 +2314,7 @@ static picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
             RenderLinear( p_vout, pp_outpic[0], p_pic, 0 );
             RenderLinear( p_vout, pp_outpic[1], p_pic, 1 );
 #endif
+        case DEINTERLACE_YADIF2X:
             msg_Err( p_vout, "doubling the frame rate is not supported yet" );
             picture_Release( p_pic_dst );
             return p_pic;
@@ -2167,9 +2331,14 @@ static picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
         case DEINTERLACE_X:
             RenderX( p_pic_dst, p_pic );
             break;
+
+        case DEINTERLACE_YADIF:
+            i_date = RenderYadif( p_vout, p_pic_dst, p_pic, 0 );
+            break;
     }
 
     picture_CopyProperties( p_pic_dst, p_pic );
+    p_pic_dst->date = i_date;
     p_pic_dst->b_progressive = true;
 
     picture_Release( p_pic );
@@ -2199,6 +2368,9 @@ static int OpenFilter( vlc_object_t *p_this )
     vlc_object_attach( p_vout, p_filter );
     p_filter->p_sys = (filter_sys_t *)p_vout;
     p_vout->render.i_chroma = p_filter->fmt_in.video.i_chroma;
+    p_vout->render.i_width = p_filter->fmt_in.video.i_width;
+    p_vout->render.i_height = p_filter->fmt_in.video.i_height;
+    p_vout->render.i_aspect = p_filter->fmt_in.video.i_aspect;
 
     config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
                    p_filter->p_cfg );
@@ -94,6 +94,8 @@ struct filter_sys_t
     type_t *pt_distribution;
     type_t *pt_buffer;
     type_t *pt_scale;
+
+    int i_plane; /* plane being filtered by the slices */
 };
 
 static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
@@ -181,13 +183,99 @@ static void Destroy( vlc_object_t *p_this )
     free( p_filter->p_sys );
 }
 
+/*****************************************************************************
+ * Slices of the two passes on one plane
+ *****************************************************************************/
+static void HorizontalSlice( filter_t *p_filter, picture_t *p_pic,
+                             picture_t *p_outpic, int i_slice, int i_slices )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_plane = p_sys->i_plane;
+    const int i_dim = p_sys->i_dim;
+    const type_t *pt_distribution = p_sys->pt_distribution;
+    type_t *pt_buffer = p_sys->pt_buffer;
+
+    uint8_t *p_in = p_pic->p[i_plane].p_pixels;
+
+    const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
+    const int i_pitch = p_pic->p[i_plane].i_pitch;
+
+    int i_line, i_col, i_first, i_last;
+    const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
+
+    VLC_UNUSED(p_outpic);
+    filter_GetSliceLines( p_pic->p[i_plane].i_visible_lines, 1,
+                          i_slice, i_slices, &i_first, &i_last );
+
+    for( i_line = i_first ; i_line < i_last ; i_line++ )
+    {
+        for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
+        {
+            type_t t_value = 0;
+            int x;
+            const int c = i_line*i_pitch+i_col;
+            for( x = __MAX( -i_dim, -i_col*(x_factor+1) );
+                 x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
+                 x++ )
+            {
+                t_value += pt_distribution[x+i_dim] *
+                           p_in[c+(x>>x_factor)];
+            }
+            pt_buffer[c] = t_value;
+        }
+    }
+}
+
+static void VerticalSlice( filter_t *p_filter, picture_t *p_pic,
+                           picture_t *p_outpic, int i_slice, int i_slices )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_plane = p_sys->i_plane;
+    const int i_dim = p_sys->i_dim;
+    const type_t *pt_distribution = p_sys->pt_distribution;
+    const type_t *pt_buffer = p_sys->pt_buffer;
+    const type_t *pt_scale = p_sys->pt_scale;
+
+    uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
+
+    const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
+    const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
+    const int i_pitch = p_pic->p[i_plane].i_pitch;
+
+    int i_line, i_col, i_first, i_last;
+    const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
+    const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
+
+    filter_GetSliceLines( i_visible_lines, 1, i_slice, i_slices,
+                          &i_first, &i_last );
+
+    for( i_line = i_first ; i_line < i_last ; i_line++ )
+    {
+        for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
+        {
+            type_t t_value = 0;
+            int y;
+            const int c = i_line*i_pitch+i_col;
+            for( y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
+                 y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
+                 y++ )
+            {
+                t_value += pt_distribution[y+i_dim] *
+                           pt_buffer[c+(y>>y_factor)*i_pitch];
+            }
+
+            const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_pitch<<x_factor)+(i_col<<x_factor)];
+            p_out[c] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
+        }
+    }
+}
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
     filter_sys_t *p_sys = p_filter->p_sys;
     int i_plane;
     const int i_dim = p_sys->i_dim;
-    type_t *pt_buffer;
     type_t *pt_scale;
     const type_t *pt_distribution = p_sys->pt_distribution;
 
@@ -207,7 +295,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                                         sizeof( type_t ) );
     }
 
-    pt_buffer = p_sys->pt_buffer;
     if( !p_sys->pt_scale )
     {
         const int i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
@@ -242,57 +329,13 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         }
     }
 
-    pt_scale = p_sys->pt_scale;
+    /* The vertical pass reads the lines around its own in the result of the
+     * horizontal one, so they are done one after the other */
     for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-
-        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
-        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
-
-        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
-        const int i_pitch = p_pic->p[i_plane].i_pitch;
-
-        int i_line, i_col;
-        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
-        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
-
-        for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
-        {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
-            {
-                type_t t_value = 0;
-                int x;
-                const int c = i_line*i_pitch+i_col;
-                for( x = __MAX( -i_dim, -i_col*(x_factor+1) );
-                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
-                     x++ )
-                {
-                    t_value += pt_distribution[x+i_dim] *
-                               p_in[c+(x>>x_factor)];
-                }
-                pt_buffer[c] = t_value;
-            }
-        }
-        for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
-        {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
-            {
-                type_t t_value = 0;
-                int y;
-                const int c = i_line*i_pitch+i_col;
-                for( y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
-                {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_pitch];
-                }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[c] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
-            }
-        }
+        p_sys->i_plane = i_plane;
+        filter_RunSlices( p_filter, HorizontalSlice, p_pic, p_outpic );
+        filter_RunSlices( p_filter, VerticalSlice, p_pic, p_outpic );
     }
 
     return CopyInfoAndRelease( p_outpic, p_pic );
@@ -0,0 +1,572 @@
+/*****************************************************************************
+ * resize.c: filtered video scaling
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_vout.h>
+#include <vlc_filter.h>
+
+#include "resize.h"
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define RESIZE_SSE2 1
+#   if defined(CAN_COMPILE_AVX2)
+#       include <immintrin.h>
+#       define RESIZE_AVX2 1
+#   endif
+#endif
+
+/*
+ * Fixed point: the coefficients are scaled by 2^14. The horizontal pass
+ * keeps 6 bits of fraction in 16 bits, which leaves room for the negative
+ * lobes of the bicubic and Lanczos filters, and the vertical pass sums in
+ * 32 bits before rounding back to 8 bits.
+ */
+#define COEF_BITS   14
+#define TMP_SHIFT    8
+#define OUT_SHIFT   (2 * COEF_BITS - TMP_SHIFT)
+
+typedef void (*resize_vertical_t)( uint8_t *, const int16_t *, int,
+                                   const int16_t *, int, int );
+
+/* The filter along one axis of one plane */
+typedef struct
+{
+    int      i_src, i_dst;  /* size in pixels */
+    int      i_taps;
+    int     *pi_offset;     /* first source pixel of each output pixel */
+    int16_t *pi_coef;       /* i_taps coefficients per output pixel */
+} resize_axis_t;
+
+typedef struct
+{
+    int           i_components; /* bytes per pixel */
+    resize_axis_t h, v;
+    int16_t      *p_tmp;        /* horizontally scaled source lines */
+    int           i_tmp_pitch;  /* in samples */
+} resize_plane_t;
+
+struct filter_sys_t
+{
+    int               i_method;
+    resize_vertical_t pf_vertical;
+
+    int               i_planes;
+    resize_plane_t    p_plane[VOUT_MAX_PLANES];
+};
+
+/*****************************************************************************
+ * Coefficients
+ *****************************************************************************/
+static double Kernel( int i_method, double x )
+{
+    x = fabs( x );
+    switch( i_method )
+    {
+        case RESIZE_BILINEAR:
+            return x < 1. ? 1. - x : 0.;
+
+        case RESIZE_BICUBIC:
+            /* Keys, a = -0.5 */
+            if( x < 1. )
+                return ( 1.5 * x - 2.5 ) * x * x + 1.;
+            if( x < 2. )
+                return ( ( -0.5 * x + 2.5 ) * x - 4. ) * x + 2.;
+            return 0.;
+
+        default: /* RESIZE_LANCZOS, 3 lobes */
+            if( x < 1e-8 )
+                return 1.;
+            if( x >= 3. )
+                return 0.;
+            return 3. * sin( M_PI * x ) * sin( M_PI * x / 3. )
+                 / ( M_PI * M_PI * x * x );
+    }
+}
+
+static double KernelSupport( int i_method )
+{
+    return i_method == RESIZE_BILINEAR ? 1. :
+           i_method == RESIZE_BICUBIC  ? 2. : 3.;
+}
+
+static void AxisClean( resize_axis_t *p_axis )
+{
+    free( p_axis->pi_offset );
+    free( p_axis->pi_coef );
+    memset( p_axis, 0, sizeof( *p_axis ) );
+}
+
+/* Compute the filter taps of every output pixel. Pixels outside the source
+ * are replaced by the nearest edge one, and the window is moved inside the
+ * source, so that the passes never read outside of it. */
+static int AxisInit( resize_axis_t *p_axis, int i_method, int i_src, int i_dst )
+{
+    const double f_scale = (double)i_src / i_dst;
+    const double f_stretch = f_scale > 1. ? f_scale : 1.;
+    const double f_support = KernelSupport( i_method ) * f_stretch;
+    const double f_window = ceil( 2. * f_support );
+    const int i_window = f_window;
+    const int i_taps = __MIN( i_window, i_src );
+    double *pf_weight;
+
+    AxisClean( p_axis );
+    p_axis->pi_offset = malloc( i_dst * sizeof( int ) );
+    p_axis->pi_coef = malloc( i_dst * i_taps * sizeof( int16_t ) );
+    pf_weight = malloc( i_taps * sizeof( double ) );
+    if( !p_axis->pi_offset || !p_axis->pi_coef || !pf_weight )
+    {
+        free( pf_weight );
+        AxisClean( p_axis );
+        return VLC_ENOMEM;
+    }
+    p_axis->i_src = i_src;
+    p_axis->i_dst = i_dst;
+    p_axis->i_taps = i_taps;
+
+    for( int i = 0; i < i_dst; i++ )
+    {
+        const double f_center = ( i + .5 ) * f_scale - .5;
+        const double f_first = floor( f_center - f_support ) + 1.;
+        const int i_first = f_first;
+        const int i_offset = __MAX( 0, __MIN( i_first, i_src - i_taps ) );
+        int16_t *pi_coef = &p_axis->pi_coef[i * i_taps];
+        double f_sum = 0.;
+        int i_sum = 0, i_max = 0;
+
+        for( int t = 0; t < i_taps; t++ )
+            pf_weight[t] = 0.;
+        for( int j = i_first; j < i_first + i_window; j++ )
+        {
+            const double f_weight = Kernel( i_method,
+                                            ( j - f_center ) / f_stretch );
+            const int i_src_pixel = __MAX( 0, __MIN( j, i_src - 1 ) );
+
+            pf_weight[i_src_pixel - i_offset] += f_weight;
+            f_sum += f_weight;
+        }
+
+        /* Normalize, and give the rounding error to the largest tap so that
+         * flat areas stay flat */
+        for( int t = 0; t < i_taps; t++ )
+        {
+            pi_coef[t] = (int16_t)lrint( pf_weight[t] / f_sum
+                                         * ( 1 << COEF_BITS ) );
+            i_sum += pi_coef[t];
+            if( pi_coef[t] > pi_coef[i_max] )
+                i_max = t;
+        }
+        pi_coef[i_max] += ( 1 << COEF_BITS ) - i_sum;
+        p_axis->pi_offset[i] = i_offset;
+    }
+    free( pf_weight );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Vertical pass
+ *****************************************************************************
+ * Each output line is a weighted sum of i_taps lines of the horizontally
+ * scaled picture, i_pitch samples apart.
+ *****************************************************************************/
+static void VerticalC( uint8_t *p_dst, const int16_t *p_src, int i_pitch,
+                       const int16_t *pi_coef, int i_taps, int i_width )
+{
+    for( int x = 0; x < i_width; x++ )
+    {
+        int32_t i_sum = 1 << (OUT_SHIFT - 1);
+
+        for( int t = 0; t < i_taps; t++ )
+            i_sum += p_src[t * i_pitch + x] * pi_coef[t];
+        i_sum >>= OUT_SHIFT;
+        p_dst[x] = i_sum < 0 ? 0 : i_sum > 255 ? 255 : i_sum;
+    }
+}
+
+#if defined(RESIZE_SSE2)
+/* Two lines at a time: their samples are interleaved and multiplied by
+ * interleaved coefficients with pmaddwd, which sums in 32 bits exactly as
+ * the C version does */
+static __attribute__((__target__("sse2")))
+void VerticalSSE2( uint8_t *p_dst, const int16_t *p_src, int i_pitch,
+                   const int16_t *pi_coef, int i_taps, int i_width )
+{
+    const __m128i round = _mm_set1_epi32( 1 << (OUT_SHIFT - 1) );
+    int x;
+
+    for( x = 0; x + 8 <= i_width; x += 8 )
+    {
+        __m128i lo = round, hi = round;
+        int t;
+
+        for( t = 0; t + 2 <= i_taps; t += 2 )
+        {
+            const __m128i a = _mm_loadu_si128(
+                    (const __m128i *)&p_src[t * i_pitch + x] );
+            const __m128i b = _mm_loadu_si128(
+                    (const __m128i *)&p_src[(t + 1) * i_pitch + x] );
+            const __m128i c = _mm_set1_epi32( (uint16_t)pi_coef[t]
+                                        | ( (uint32_t)pi_coef[t + 1] << 16 ) );
+
+            lo = _mm_add_epi32( lo, _mm_madd_epi16(
+                                    _mm_unpacklo_epi16( a, b ), c ) );
+            hi = _mm_add_epi32( hi, _mm_madd_epi16(
+                                    _mm_unpackhi_epi16( a, b ), c ) );
+        }
+        if( t < i_taps )
+        {
+            const __m128i a = _mm_loadu_si128(
+                    (const __m128i *)&p_src[t * i_pitch + x] );
+            const __m128i c = _mm_set1_epi32( (uint16_t)pi_coef[t] );
+
+            lo = _mm_add_epi32( lo, _mm_madd_epi16(
+                                    _mm_unpacklo_epi16( a, a ), c ) );
+            hi = _mm_add_epi32( hi, _mm_madd_epi16(
+                                    _mm_unpackhi_epi16( a, a ), c ) );
+        }
+        lo = _mm_srai_epi32( lo, OUT_SHIFT );
+        hi = _mm_srai_epi32( hi, OUT_SHIFT );
+        lo = _mm_packs_epi32( lo, hi );
+        _mm_storel_epi64( (__m128i *)&p_dst[x], _mm_packus_epi16( lo, lo ) );
+    }
+    VerticalC( &p_dst[x], &p_src[x], i_pitch, pi_coef, i_taps, i_width - x );
+}
+#endif
+
+#if defined(RESIZE_AVX2)
+static __attribute__((__target__("avx2")))
+void VerticalAVX2( uint8_t *p_dst, const int16_t *p_src, int i_pitch,
+                   const int16_t *pi_coef, int i_taps, int i_width )
+{
+    const __m256i round = _mm256_set1_epi32( 1 << (OUT_SHIFT - 1) );
+    int x;
+
+    for( x = 0; x + 16 <= i_width; x += 16 )
+    {
+        __m256i lo = round, hi = round, v;
+        int t;
+
+        /* The unpacks work within each 128 bits half, and so do the packs
+         * below, which puts the pixels back in order in each half */
+        for( t = 0; t + 2 <= i_taps; t += 2 )
+        {
+            const __m256i a = _mm256_loadu_si256(
+                    (const __m256i *)&p_src[t * i_pitch + x] );
+            const __m256i b = _mm256_loadu_si256(
+                    (const __m256i *)&p_src[(t + 1) * i_pitch + x] );
+            const __m256i c = _mm256_set1_epi32( (uint16_t)pi_coef[t]
+                                        | ( (uint32_t)pi_coef[t + 1] << 16 ) );
+
+            lo = _mm256_add_epi32( lo, _mm256_madd_epi16(
+                                    _mm256_unpacklo_epi16( a, b ), c ) );
+            hi = _mm256_add_epi32( hi, _mm256_madd_epi16(
+                                    _mm256_unpackhi_epi16( a, b ), c ) );
+        }
+        if( t < i_taps )
+        {
+            const __m256i a = _mm256_loadu_si256(
+                    (const __m256i *)&p_src[t * i_pitch + x] );
+            const __m256i c = _mm256_set1_epi32( (uint16_t)pi_coef[t] );
+
+            lo = _mm256_add_epi32( lo, _mm256_madd_epi16(
+                                    _mm256_unpacklo_epi16( a, a ), c ) );
+            hi = _mm256_add_epi32( hi, _mm256_madd_epi16(
+                                    _mm256_unpackhi_epi16( a, a ), c ) );
+        }
+        lo = _mm256_srai_epi32( lo, OUT_SHIFT );
+        hi = _mm256_srai_epi32( hi, OUT_SHIFT );
+        v = _mm256_packs_epi32( lo, hi );
+        v = _mm256_packus_epi16( v, v );
+        v = _mm256_permute4x64_epi64( v, 0xd8 );
+        _mm_storeu_si128( (__m128i *)&p_dst[x],
+                          _mm256_castsi256_si128( v ) );
+    }
+    VerticalSSE2( &p_dst[x], &p_src[x], i_pitch, pi_coef, i_taps,
+                  i_width - x );
+}
+#endif
+
+/*****************************************************************************
+ * Horizontal pass
+ *****************************************************************************/
+static void Horizontal( int16_t *p_dst, const uint8_t *p_src,
+                        const resize_axis_t *p_axis, int i_components )
+{
+    const int i_taps = p_axis->i_taps;
+
+    for( int x = 0; x < p_axis->i_dst; x++ )
+    {
+        const uint8_t *p = &p_src[p_axis->pi_offset[x] * i_components];
+        const int16_t *pi_coef = &p_axis->pi_coef[x * i_taps];
+
+        for( int c = 0; c < i_components; c++ )
+        {
+            int32_t i_sum = 1 << (TMP_SHIFT - 1);
+
+            for( int t = 0; t < i_taps; t++ )
+                i_sum += p[t * i_components + c] * pi_coef[t];
+            *p_dst++ = i_sum >> TMP_SHIFT;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Slices
+ *****************************************************************************/
+static void HorizontalSlice( filter_t *p_filter, picture_t *p_src,
+                             picture_t *p_dst, int i_slice, int i_slices )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    VLC_UNUSED(p_dst);
+    for( int i = 0; i < p_sys->i_planes; i++ )
+    {
+        const resize_plane_t *p_plane = &p_sys->p_plane[i];
+        const plane_t *p_in = &p_src->p[i];
+        int i_first, i_last;
+
+        filter_GetSliceLines( p_plane->v.i_src, 1, i_slice, i_slices,
+                              &i_first, &i_last );
+        for( int y = i_first; y < i_last; y++ )
+            Horizontal( &p_plane->p_tmp[y * p_plane->i_tmp_pitch],
+                        &p_in->p_pixels[y * p_in->i_pitch],
+                        &p_plane->h, p_plane->i_components );
+    }
+}
+
+static void VerticalSlice( filter_t *p_filter, picture_t *p_src,
+                           picture_t *p_dst, int i_slice, int i_slices )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    VLC_UNUSED(p_src);
+    for( int i = 0; i < p_sys->i_planes; i++ )
+    {
+        const resize_plane_t *p_plane = &p_sys->p_plane[i];
+        const resize_axis_t *p_v = &p_plane->v;
+        plane_t *p_out = &p_dst->p[i];
+        int i_first, i_last;
+
+        filter_GetSliceLines( p_v->i_dst, 1, i_slice, i_slices,
+                              &i_first, &i_last );
+        for( int y = i_first; y < i_last; y++ )
+            p_sys->pf_vertical( &p_out->p_pixels[y * p_out->i_pitch],
+                        &p_plane->p_tmp[p_v->pi_offset[y] *
+                                        p_plane->i_tmp_pitch],
+                        p_plane->i_tmp_pitch,
+                        &p_v->pi_coef[y * p_v->i_taps], p_v->i_taps,
+                        p_plane->h.i_dst * p_plane->i_components );
+    }
+}
+
+/*****************************************************************************
+ * Tables
+ *****************************************************************************
+ * The sizes are taken from the pictures, as the owner of the filter may
+ * change its formats between two pictures (the subpicture scaler does).
+ *****************************************************************************/
+static void PlanesClean( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_planes; i++ )
+    {
+        AxisClean( &p_sys->p_plane[i].h );
+        AxisClean( &p_sys->p_plane[i].v );
+        free( p_sys->p_plane[i].p_tmp );
+    }
+    p_sys->i_planes = 0;
+}
+
+static bool PlaneMatches( const resize_plane_t *p_plane,
+                          const plane_t *p_in, const plane_t *p_out )
+{
+    return p_plane->i_components == p_in->i_pixel_pitch
+        && p_plane->h.i_src == p_in->i_visible_pitch / p_in->i_pixel_pitch
+        && p_plane->v.i_src == p_in->i_visible_lines
+        && p_plane->h.i_dst == p_out->i_visible_pitch / p_out->i_pixel_pitch
+        && p_plane->v.i_dst == p_out->i_visible_lines;
+}
+
+static int PlanesInit( filter_t *p_filter, const picture_t *p_src,
+                       const picture_t *p_dst )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    bool b_same = p_sys->i_planes == p_dst->i_planes;
+
+    for( int i = 0; b_same && i < p_dst->i_planes; i++ )
+        b_same = PlaneMatches( &p_sys->p_plane[i], &p_src->p[i],
+                               &p_dst->p[i] );
+    if( b_same )
+        return VLC_SUCCESS;
+
+    PlanesClean( p_sys );
+    for( int i = 0; i < p_dst->i_planes; i++ )
+    {
+        resize_plane_t *p_plane = &p_sys->p_plane[i];
+        const plane_t *p_in = &p_src->p[i];
+        const plane_t *p_out = &p_dst->p[i];
+        const int i_src_width = p_in->i_visible_pitch / p_in->i_pixel_pitch;
+        const int i_dst_width = p_out->i_visible_pitch / p_out->i_pixel_pitch;
+
+        memset( p_plane, 0, sizeof( *p_plane ) );
+        p_sys->i_planes = i + 1;
+        if( p_in->i_pixel_pitch != p_out->i_pixel_pitch
+         || i_src_width <= 0 || p_in->i_visible_lines <= 0
+         || i_dst_width <= 0 || p_out->i_visible_lines <= 0 )
+            goto error;
+
+        p_plane->i_components = p_in->i_pixel_pitch;
+        p_plane->i_tmp_pitch = i_dst_width * p_plane->i_components;
+        p_plane->p_tmp = malloc( p_in->i_visible_lines
+                                 * p_plane->i_tmp_pitch * sizeof( int16_t ) );
+        if( !p_plane->p_tmp
+         || AxisInit( &p_plane->h, p_sys->i_method, i_src_width,
+                      i_dst_width )
+         || AxisInit( &p_plane->v, p_sys->i_method, p_in->i_visible_lines,
+                      p_out->i_visible_lines ) )
+            goto error;
+    }
+
+    msg_Dbg( p_filter, "%dx%d -> %dx%d, %d x %d taps",
+             p_sys->p_plane[0].h.i_src, p_sys->p_plane[0].v.i_src,
+             p_sys->p_plane[0].h.i_dst, p_sys->p_plane[0].v.i_dst,
+             p_sys->p_plane[0].h.i_taps, p_sys->p_plane[0].v.i_taps );
+    return VLC_SUCCESS;
+
+error:
+    PlanesClean( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_pic_dst;
+
+    if( !p_pic ) return NULL;
+
+    p_pic_dst = filter_NewPicture( p_filter );
+    if( !p_pic_dst )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    if( p_pic_dst->i_planes != p_pic->i_planes
+     || PlanesInit( p_filter, p_pic, p_pic_dst ) )
+    {
+        msg_Err( p_filter, "cannot scale %dx%d to %dx%d",
+                 p_filter->fmt_in.video.i_width,
+                 p_filter->fmt_in.video.i_height,
+                 p_filter->fmt_out.video.i_width,
+                 p_filter->fmt_out.video.i_height );
+        filter_DeletePicture( p_filter, p_pic_dst );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    /* All the source lines are scaled horizontally before the vertical
+     * pass reads them */
+    filter_RunSlices( p_filter, HorizontalSlice, p_pic, p_pic_dst );
+    filter_RunSlices( p_filter, VerticalSlice, p_pic, p_pic_dst );
+
+    picture_CopyProperties( p_pic_dst, p_pic );
+    picture_Release( p_pic );
+    return p_pic_dst;
+}
+
+/*****************************************************************************
+ * OpenResize: probe the filter
+ *****************************************************************************/
+int OpenResize( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys;
+
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        /* Planar YUV, whatever the subsampling */
+        case VLC_FOURCC('I','4','2','0'):
+        case VLC_FOURCC('I','Y','U','V'):
+        case VLC_FOURCC('Y','V','1','2'):
+        case VLC_FOURCC('J','4','2','0'):
+        case VLC_FOURCC('I','4','1','1'):
+        case VLC_FOURCC('I','4','1','0'):
+        case VLC_FOURCC('Y','V','U','9'):
+        case VLC_FOURCC('I','4','2','2'):
+        case VLC_FOURCC('J','4','2','2'):
+        case VLC_FOURCC('I','4','4','4'):
+        case VLC_FOURCC('J','4','4','4'):
+        case VLC_FOURCC('Y','U','V','A'):
+        case VLC_FOURCC('G','R','E','Y'):
+        /* Packed RGB, one byte per component */
+        case VLC_FOURCC('R','V','2','4'):
+        case VLC_FOURCC('R','V','3','2'):
+        case VLC_FOURCC('R','G','B','A'):
+            break;
+        default:
+            /* Not the palettized YUVP: the scale submodule picks indexes */
+            return VLC_EGENERIC;
+    }
+    if( p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
+        return VLC_EGENERIC;
+
+    p_filter->p_sys = p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->i_method = var_CreateGetInteger( p_filter, "resize-method" );
+    if( p_sys->i_method < RESIZE_BILINEAR || p_sys->i_method > RESIZE_LANCZOS )
+        p_sys->i_method = RESIZE_BICUBIC;
+
+#if defined(RESIZE_AVX2)
+    if( vlc_CPU() & CPU_CAPABILITY_AVX2 )
+        p_sys->pf_vertical = VerticalAVX2;
+    else
+#endif
+#if defined(RESIZE_SSE2)
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+        p_sys->pf_vertical = VerticalSSE2;
+    else
+#endif
+        p_sys->pf_vertical = VerticalC;
+
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * CloseResize: clean up the filter
+ *****************************************************************************/
+void CloseResize( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+
+    PlanesClean( p_filter->p_sys );
+    free( p_filter->p_sys );
+}
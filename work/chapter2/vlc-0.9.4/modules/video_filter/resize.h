@@ -0,0 +1,48 @@
+/*****************************************************************************
+ * resize.h: filtered video scaling
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _RESIZE_H_
+#define _RESIZE_H_ 1
+
+/*
+ * The "resize" submodule of the scale plugin. It scales planar YUV and
+ * packed RGB pictures with a separable bilinear, bicubic or Lanczos filter,
+ * horizontally first, then vertically. The coefficients are computed in
+ * fixed point once per size, and the vertical pass, where most of the
+ * arithmetic is, has SSE2 and AVX2 versions. Both passes are rendered in
+ * slices (see filter_RunSlices()).
+ */
+#define RESIZE_METHOD_TEXT N_("Scaling method")
+#define RESIZE_METHOD_LONGTEXT N_( \
+    "Interpolation used to scale the video and the subpictures: " \
+    "bilinear is the fastest, Lanczos the sharpest.")
+
+enum
+{
+    RESIZE_BILINEAR,
+    RESIZE_BICUBIC,
+    RESIZE_LANCZOS,
+};
+
+int  OpenResize ( vlc_object_t * );
+void CloseResize( vlc_object_t * );
+
+#endif
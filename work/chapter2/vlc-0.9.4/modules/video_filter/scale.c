@@ -35,6 +35,8 @@
 #include <vlc_vout.h>
 #include "vlc_filter.h"
 
+#include "resize.h"
+
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
@@ -52,6 +54,11 @@ static void CloseFilter( vlc_object_t * );
 
 static picture_t *Filter( filter_t *, picture_t * );
 
+static const int pi_resize_methods[] =
+    { RESIZE_BILINEAR, RESIZE_BICUBIC, RESIZE_LANCZOS };
+static const char *const ppsz_resize_methods[] =
+    { N_("Bilinear"), N_("Bicubic"), N_("Lanczos") };
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -59,6 +66,17 @@ vlc_module_begin();
     set_description( N_("Video scaling filter") );
     set_capability( "video filter2", 10 );
     set_callbacks( OpenFilter, CloseFilter );
+
+    add_submodule();
+    set_description( N_("Filtered video scaling filter") );
+    add_shortcut( "resize" );
+    set_category( CAT_VIDEO );
+    set_subcategory( SUBCAT_VIDEO_VFILTER );
+    set_capability( "video filter2", 100 );
+    add_integer( "resize-method", RESIZE_BICUBIC, NULL,
+                 RESIZE_METHOD_TEXT, RESIZE_METHOD_LONGTEXT, false );
+        change_integer_list( pi_resize_methods, ppsz_resize_methods, NULL );
+    set_callbacks( OpenResize, CloseResize );
 vlc_module_end();
 
 /*****************************************************************************
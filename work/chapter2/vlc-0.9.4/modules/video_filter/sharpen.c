@@ -151,50 +151,29 @@ static void Destroy( vlc_object_t *p_this )
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * FilterSlice: sharpen the lines of one slice
  *****************************************************************************
- * This function send the currently rendered image to Invert image, waits
- * until it is displayed and switch the two rendering buffers, preparing next
- * frame.
+ * The convolution only reads the lines just above and below the ones it
+ * writes, so each slice can be done on its own.
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void FilterSlice( filter_t *p_filter, picture_t *p_pic,
+                         picture_t *p_outpic, int i_slice, int i_slices )
 {
-    picture_t *p_outpic;
-    int i, j;
-    uint8_t *p_src = NULL;
-    uint8_t *p_out = NULL;
-    int i_src_pitch;
+    int i, j, i_first, i_last;
+    uint8_t *p_src = p_pic->p[Y_PLANE].p_pixels;
+    uint8_t *p_out = p_outpic->p[Y_PLANE].p_pixels;
+    const int i_src_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
+    const int i_lines = p_pic->p[Y_PLANE].i_visible_lines;
     int pix;
     const int v1 = -1;
     const int v2 = 3; /* 2^3 = 8 */
 
-    if( !p_pic ) return NULL;
-    if( !p_filter ) return NULL;
-    if( !p_filter->p_sys ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    /* process the Y plane */
-    p_src = p_pic->p[Y_PLANE].p_pixels;
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
-    if( !p_src || !p_out )
-    {
-        msg_Warn( p_filter, "can't get Y plane" );
-        picture_Release( p_pic );
-        return NULL;
-    }
-
-    i_src_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
+    filter_GetSliceLines( i_lines, 1, i_slice, i_slices, &i_first, &i_last );
 
     /* perform convolution only on Y plane. Avoid border line. */
-    for( i = 0; i < p_pic->p[Y_PLANE].i_visible_lines; i++ )
+    for( i = i_first; i < i_last; i++ )
     {
-        if( (i == 0) || (i == p_pic->p[Y_PLANE].i_visible_lines - 1) )
+        if( (i == 0) || (i == i_lines - 1) )
         {
             for( j = 0; j < p_pic->p[Y_PLANE].i_visible_pitch; j++ )
                 p_out[i * i_src_pitch + j] = clip( p_src[i * i_src_pitch + j] );
@@ -224,13 +203,49 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         }
     }
 
+    for( i = U_PLANE; i <= V_PLANE; i++ )
+    {
+        const int i_pitch = p_outpic->p[i].i_pitch;
 
-    vlc_memcpy( p_outpic->p[U_PLANE].p_pixels, p_pic->p[U_PLANE].p_pixels,
-                p_outpic->p[U_PLANE].i_lines * p_outpic->p[U_PLANE].i_pitch );
+        filter_GetSliceLines( p_outpic->p[i].i_lines, 1, i_slice, i_slices,
+                              &i_first, &i_last );
+        vlc_memcpy( p_outpic->p[i].p_pixels + i_first * i_pitch,
+                    p_pic->p[i].p_pixels + i_first * i_pitch,
+                    (i_last - i_first) * i_pitch );
+    }
+}
 
-    vlc_memcpy( p_outpic->p[V_PLANE].p_pixels, p_pic->p[V_PLANE].p_pixels,
-                p_outpic->p[V_PLANE].i_lines * p_outpic->p[V_PLANE].i_pitch );
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************
+ * This function send the currently rendered image to Invert image, waits
+ * until it is displayed and switch the two rendering buffers, preparing next
+ * frame.
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+
+    if( !p_pic ) return NULL;
+    if( !p_filter ) return NULL;
+    if( !p_filter->p_sys ) return NULL;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    /* process the Y plane */
+    if( !p_pic->p[Y_PLANE].p_pixels || !p_outpic->p[Y_PLANE].p_pixels )
+    {
+        msg_Warn( p_filter, "can't get Y plane" );
+        picture_Release( p_pic );
+        return NULL;
+    }
 
+    filter_RunSlices( p_filter, FilterSlice, p_pic, p_outpic );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -0,0 +1,287 @@
+/*****************************************************************************
+ * yadif.c: motion adaptive deinterlacing (YADIF)
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * The filter is the one from MPlayer's vf_yadif, by Michael Niedermayer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_vout.h>
+#include <vlc_filter.h>
+
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#   define YADIF_SSE2 1
+#   if defined(CAN_COMPILE_SSSE3)
+#       include <tmmintrin.h>
+#       define YADIF_SSSE3 1
+#   endif
+#endif
+
+#include "yadif.h"
+
+typedef void (*yadif_line_t)( uint8_t *, const uint8_t *, const uint8_t *,
+                              const uint8_t *, int, int, int, int, bool );
+
+struct yadif_t
+{
+    yadif_line_t  pf_line;
+    const char   *psz_kernel;
+
+    /* Runs the slices, with the thread pool in p_slices */
+    filter_t     *p_filter;
+
+    /* Current frame, but p_cur which is the source of the slices */
+    const picture_t *p_prev, *p_next;
+    int              i_field;
+    bool             b_tff;
+};
+
+/*****************************************************************************
+ * Line filters
+ *****************************************************************************
+ * p_prev, p_cur and p_next point to the line to rebuild in each picture, and
+ * i_mrefs and i_prefs are the offsets of the lines above and below it (they
+ * are mirrored at the edges of the plane). i_parity tells which of the
+ * neighbouring pictures holds the other field closest in time. b_check
+ * enables the check against the lines two lines away, which must exist.
+ *****************************************************************************/
+#define MIN3( a, b, c ) __MIN( __MIN( a, b ), c )
+#define MAX3( a, b, c ) __MAX( __MAX( a, b ), c )
+
+static inline uint8_t YadifPixel( const uint8_t *p_prev, const uint8_t *p_cur,
+                                  const uint8_t *p_next,
+                                  const uint8_t *p_prev2,
+                                  const uint8_t *p_next2,
+                                  int i_prefs, int i_mrefs,
+                                  bool b_spatial, bool b_check )
+{
+    const int c = p_cur[i_mrefs];
+    const int d = ( p_prev2[0] + p_next2[0] ) >> 1;
+    const int e = p_cur[i_prefs];
+    int i_diff0 = abs( p_prev2[0] - p_next2[0] );
+    int i_diff1 = ( abs( p_prev[i_mrefs] - c ) + abs( p_prev[i_prefs] - e ) )
+                  >> 1;
+    int i_diff2 = ( abs( p_next[i_mrefs] - c ) + abs( p_next[i_prefs] - e ) )
+                  >> 1;
+    int i_diff = MAX3( i_diff0 >> 1, i_diff1, i_diff2 );
+    int i_pred = ( c + e ) >> 1;
+
+    /* Follow edges: the outer directions are only tried where the inner
+     * one on the same side was better than the vertical one */
+    if( b_spatial )
+    {
+#define SCORE( j ) \
+    ( abs( p_cur[i_mrefs - 1 + (j)] - p_cur[i_prefs - 1 - (j)] ) \
+    + abs( p_cur[i_mrefs + (j)] - p_cur[i_prefs - (j)] ) \
+    + abs( p_cur[i_mrefs + 1 + (j)] - p_cur[i_prefs + 1 - (j)] ) )
+#define PRED( j ) ( ( p_cur[i_mrefs + (j)] + p_cur[i_prefs - (j)] ) >> 1 )
+        int i_score = SCORE( 0 ) - 1;
+        int i_s;
+
+        if( (i_s = SCORE( -1 )) < i_score )
+        {
+            i_score = i_s;
+            i_pred = PRED( -1 );
+            if( (i_s = SCORE( -2 )) < i_score )
+            {
+                i_score = i_s;
+                i_pred = PRED( -2 );
+            }
+        }
+        if( (i_s = SCORE( 1 )) < i_score )
+        {
+            i_score = i_s;
+            i_pred = PRED( 1 );
+            if( (i_s = SCORE( 2 )) < i_score )
+                i_pred = PRED( 2 );
+        }
+#undef PRED
+#undef SCORE
+    }
+
+    if( b_check )
+    {
+        const int b = ( p_prev2[2 * i_mrefs] + p_next2[2 * i_mrefs] ) >> 1;
+        const int f = ( p_prev2[2 * i_prefs] + p_next2[2 * i_prefs] ) >> 1;
+        const int i_max = MAX3( d - e, d - c, __MIN( b - c, f - e ) );
+        const int i_min = MIN3( d - e, d - c, __MAX( b - c, f - e ) );
+
+        i_diff = MAX3( i_diff, i_min, -i_max );
+    }
+
+    if( i_pred > d + i_diff )
+        i_pred = d + i_diff;
+    else if( i_pred < d - i_diff )
+        i_pred = d - i_diff;
+    return i_pred;
+}
+
+static void YadifLineC( uint8_t *p_dst, const uint8_t *p_prev,
+                        const uint8_t *p_cur, const uint8_t *p_next,
+                        int i_width, int i_prefs, int i_mrefs, int i_parity,
+                        bool b_check )
+{
+    const uint8_t *p_prev2 = i_parity ? p_prev : p_cur;
+    const uint8_t *p_next2 = i_parity ? p_cur : p_next;
+
+    for( int x = 0; x < i_width; x++ )
+        p_dst[x] = YadifPixel( p_prev + x, p_cur + x, p_next + x,
+                               p_prev2 + x, p_next2 + x, i_prefs, i_mrefs,
+                               x >= 3 && x < i_width - 3, b_check );
+}
+
+#ifdef YADIF_SSE2
+#   define YADIF_LINE YadifLineSSE2
+#   define YADIF_TARGET "sse2"
+#   define YADIF_ABSDIFF( a, b ) \
+        _mm_max_epi16( _mm_sub_epi16( a, b ), _mm_sub_epi16( b, a ) )
+#   include "yadif_template.h"
+#   undef YADIF_ABSDIFF
+#   undef YADIF_TARGET
+#   undef YADIF_LINE
+#endif
+
+#ifdef YADIF_SSSE3
+#   define YADIF_LINE YadifLineSSSE3
+#   define YADIF_TARGET "ssse3"
+#   define YADIF_ABSDIFF( a, b ) _mm_abs_epi16( _mm_sub_epi16( a, b ) )
+#   include "yadif_template.h"
+#   undef YADIF_ABSDIFF
+#   undef YADIF_TARGET
+#   undef YADIF_LINE
+#endif
+
+/*****************************************************************************
+ * FilterSlice: filters one horizontal band of every plane
+ *****************************************************************************/
+static void FilterSlice( filter_t *p_filter, picture_t *p_cur,
+                         picture_t *p_dst, int i_slice, int i_slices )
+{
+    const yadif_t *p_yadif = (const yadif_t *)p_filter->p_sys;
+    const int i_field = p_yadif->i_field;
+    const int i_parity = i_field ^ p_yadif->b_tff;
+
+    for( int i_plane = 0; i_plane < p_dst->i_planes; i_plane++ )
+    {
+        const plane_t *p_in = &p_cur->p[i_plane];
+        plane_t *p_out = &p_dst->p[i_plane];
+        const int i_lines = p_in->i_visible_lines;
+        const int i_refs = p_in->i_pitch;
+        const int i_step = p_out->i_visible_lines < i_lines ? 2 : 1;
+        const int i_out_lines = __MIN( p_out->i_visible_lines,
+                                       i_lines / i_step );
+        const int i_width = __MIN( p_in->i_visible_pitch,
+                                   p_out->i_visible_pitch );
+        int y = i_out_lines * i_slice / i_slices;
+        const int y_end = i_out_lines * (i_slice + 1) / i_slices;
+
+        for( ; y < y_end; y++ )
+        {
+            const int i_line = y * i_step;
+            const int i_offset = i_line * i_refs;
+            uint8_t *p = &p_out->p_pixels[y * p_out->i_pitch];
+
+            if( ( (i_line ^ i_field) & 1 ) == 0 )
+            {
+                vlc_memcpy( p, &p_in->p_pixels[i_offset], i_width );
+                continue;
+            }
+
+            p_yadif->pf_line( p,
+                    &p_yadif->p_prev->p[i_plane].p_pixels[i_offset],
+                    &p_in->p_pixels[i_offset],
+                    &p_yadif->p_next->p[i_plane].p_pixels[i_offset],
+                    i_width,
+                    i_line + 1 < i_lines ? i_refs : -i_refs,
+                    i_line > 0 ? -i_refs : i_refs,
+                    i_parity, i_line >= 2 && i_line + 2 < i_lines );
+        }
+    }
+}
+
+yadif_t *yadif_New( vlc_object_t *p_parent, unsigned i_threads )
+{
+    yadif_t *p_yadif = calloc( 1, sizeof( *p_yadif ) );
+
+    if( p_yadif == NULL )
+        return NULL;
+
+#if defined(YADIF_SSSE3)
+    if( vlc_CPU() & CPU_CAPABILITY_SSSE3 )
+    {
+        p_yadif->pf_line = YadifLineSSSE3;
+        p_yadif->psz_kernel = "SSSE3";
+    }
+    else
+#endif
+#if defined(YADIF_SSE2)
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+    {
+        p_yadif->pf_line = YadifLineSSE2;
+        p_yadif->psz_kernel = "SSE2";
+    }
+    else
+#endif
+    {
+        p_yadif->pf_line = YadifLineC;
+        p_yadif->psz_kernel = "C";
+    }
+
+    p_yadif->p_filter = vlc_object_create( p_parent, sizeof( filter_t ) );
+    if( p_yadif->p_filter == NULL )
+    {
+        free( p_yadif );
+        return NULL;
+    }
+    p_yadif->p_filter->p_sys = (filter_sys_t *)p_yadif;
+    p_yadif->p_filter->p_slices = filter_slices_New( p_parent, i_threads );
+    return p_yadif;
+}
+
+void yadif_Delete( yadif_t *p_yadif )
+{
+    filter_slices_Delete( p_yadif->p_filter->p_slices );
+    vlc_object_release( p_yadif->p_filter );
+    free( p_yadif );
+}
+
+const char *yadif_GetKernel( const yadif_t *p_yadif )
+{
+    return p_yadif->psz_kernel;
+}
+
+void yadif_Filter( yadif_t *p_yadif, picture_t *p_dst,
+                   const picture_t *p_prev, const picture_t *p_cur,
+                   const picture_t *p_next, int i_field,
+                   bool b_top_field_first )
+{
+    p_yadif->p_prev = p_prev;
+    p_yadif->p_next = p_next;
+    p_yadif->i_field = i_field;
+    p_yadif->b_tff = b_top_field_first;
+    filter_RunSlices( p_yadif->p_filter, FilterSlice, (picture_t *)p_cur,
+                      p_dst );
+}
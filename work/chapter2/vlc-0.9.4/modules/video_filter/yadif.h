@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * yadif.h: motion adaptive deinterlacing (YADIF)
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _YADIF_H_
+#define _YADIF_H_ 1
+
+/*
+ * YADIF ("yet another deinterlacing filter") rebuilds the missing field of
+ * the current picture from its neighbours in space and in the previous and
+ * next pictures, and falls back to spatial interpolation where it detects
+ * motion. The three pictures must have the same format and pitches; the
+ * destination may have fewer lines in its planes (I422 to I420 output), in
+ * which case every other line of the filtered plane is kept.
+ *
+ * The frame is split into horizontal slices, which are shared between the
+ * calling thread and a pool of i_threads - 1 worker threads (one thread per
+ * CPU if i_threads is 0), see filter_RunSlices().
+ */
+typedef struct yadif_t yadif_t;
+
+yadif_t *yadif_New( vlc_object_t *, unsigned i_threads );
+void     yadif_Delete( yadif_t * );
+const char *yadif_GetKernel( const yadif_t * );
+
+/* i_field is the field of p_cur kept in p_dst (0 for top, 1 for bottom),
+ * b_top_field_first the temporal order of the fields */
+void yadif_Filter( yadif_t *, picture_t *p_dst, const picture_t *p_prev,
+                   const picture_t *p_cur, const picture_t *p_next,
+                   int i_field, bool b_top_field_first );
+
+#endif
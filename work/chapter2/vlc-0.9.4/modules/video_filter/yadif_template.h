@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * yadif_template.h: SIMD line filter for the YADIF deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This file is included by yadif.c once per instruction set, with:
+ *  YADIF_LINE:    the name of the line filter to define
+ *  YADIF_TARGET:  the instruction set, for the target attribute
+ *  YADIF_ABSDIFF: |a - b| on eight signed words
+ * The result is bit-exact with YadifLineC(). Eight pixels are filtered at
+ * once, in 16 bits, and the columns too close to the edges for the
+ * directional checks are left to YadifPixel().
+ */
+
+static __attribute__((__target__(YADIF_TARGET)))
+void YADIF_LINE( uint8_t *p_dst, const uint8_t *p_prev, const uint8_t *p_cur,
+                 const uint8_t *p_next, int i_width, int i_prefs, int i_mrefs,
+                 int i_parity, bool b_check )
+{
+    const uint8_t *p_prev2 = i_parity ? p_prev : p_cur;
+    const uint8_t *p_next2 = i_parity ? p_cur : p_next;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16( 1 );
+    int x;
+
+    for( x = 0; x < 3 && x < i_width; x++ )
+        p_dst[x] = YadifPixel( p_prev + x, p_cur + x, p_next + x,
+                               p_prev2 + x, p_next2 + x, i_prefs, i_mrefs,
+                               false, b_check );
+
+#define LOAD( p ) \
+    _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)(p) ), zero )
+#define CUR( r, j ) LOAD( &p_cur[x + (r) + (j)] )
+#define SCORE( j ) \
+    _mm_add_epi16( _mm_add_epi16( \
+        YADIF_ABSDIFF( CUR( i_mrefs, (j) - 1 ), CUR( i_prefs, -(j) - 1 ) ), \
+        YADIF_ABSDIFF( CUR( i_mrefs, (j) ), CUR( i_prefs, -(j) ) ) ), \
+        YADIF_ABSDIFF( CUR( i_mrefs, (j) + 1 ), CUR( i_prefs, -(j) + 1 ) ) )
+#define PRED( j ) \
+    _mm_srli_epi16( _mm_add_epi16( CUR( i_mrefs, (j) ), \
+                                   CUR( i_prefs, -(j) ) ), 1 )
+#define SELECT( m, a, b ) \
+    _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) )
+
+    /* Reads go from x - 3 to x + 10 */
+    for( ; x + 8 <= i_width - 3; x += 8 )
+    {
+        const __m128i c = CUR( i_mrefs, 0 );
+        const __m128i e = CUR( i_prefs, 0 );
+        const __m128i p2 = LOAD( &p_prev2[x] );
+        const __m128i n2 = LOAD( &p_next2[x] );
+        const __m128i d = _mm_srli_epi16( _mm_add_epi16( p2, n2 ), 1 );
+        __m128i diff, pred, score, s, m;
+
+        /* Temporal prediction, and how far it may be trusted */
+        diff = _mm_srli_epi16( YADIF_ABSDIFF( p2, n2 ), 1 );
+        s = _mm_srli_epi16( _mm_add_epi16(
+                YADIF_ABSDIFF( LOAD( &p_prev[x + i_mrefs] ), c ),
+                YADIF_ABSDIFF( LOAD( &p_prev[x + i_prefs] ), e ) ), 1 );
+        diff = _mm_max_epi16( diff, s );
+        s = _mm_srli_epi16( _mm_add_epi16(
+                YADIF_ABSDIFF( LOAD( &p_next[x + i_mrefs] ), c ),
+                YADIF_ABSDIFF( LOAD( &p_next[x + i_prefs] ), e ) ), 1 );
+        diff = _mm_max_epi16( diff, s );
+
+        /* Spatial prediction along the best of five directions. The outer
+         * ones are only tried where the inner one on the same side won. */
+        pred = _mm_srli_epi16( _mm_add_epi16( c, e ), 1 );
+        score = _mm_sub_epi16( SCORE( 0 ), one );
+
+        s = SCORE( -1 );
+        m = _mm_cmplt_epi16( s, score );
+        score = SELECT( m, s, score );
+        pred = SELECT( m, PRED( -1 ), pred );
+        s = SCORE( -2 );
+        m = _mm_and_si128( m, _mm_cmplt_epi16( s, score ) );
+        score = SELECT( m, s, score );
+        pred = SELECT( m, PRED( -2 ), pred );
+
+        s = SCORE( 1 );
+        m = _mm_cmplt_epi16( s, score );
+        score = SELECT( m, s, score );
+        pred = SELECT( m, PRED( 1 ), pred );
+        s = SCORE( 2 );
+        m = _mm_and_si128( m, _mm_cmplt_epi16( s, score ) );
+        pred = SELECT( m, PRED( 2 ), pred );
+
+        if( b_check )
+        {
+            const __m128i b = _mm_srli_epi16( _mm_add_epi16(
+                LOAD( &p_prev2[x + 2 * i_mrefs] ),
+                LOAD( &p_next2[x + 2 * i_mrefs] ) ), 1 );
+            const __m128i f = _mm_srli_epi16( _mm_add_epi16(
+                LOAD( &p_prev2[x + 2 * i_prefs] ),
+                LOAD( &p_next2[x + 2 * i_prefs] ) ), 1 );
+            const __m128i de = _mm_sub_epi16( d, e );
+            const __m128i dc = _mm_sub_epi16( d, c );
+            const __m128i bc = _mm_sub_epi16( b, c );
+            const __m128i fe = _mm_sub_epi16( f, e );
+            __m128i max, min;
+
+            max = _mm_max_epi16( _mm_max_epi16( de, dc ),
+                                 _mm_min_epi16( bc, fe ) );
+            min = _mm_min_epi16( _mm_min_epi16( de, dc ),
+                                 _mm_max_epi16( bc, fe ) );
+            diff = _mm_max_epi16( _mm_max_epi16( diff, min ),
+                                  _mm_sub_epi16( zero, max ) );
+        }
+
+        pred = _mm_max_epi16( pred, _mm_sub_epi16( d, diff ) );
+        pred = _mm_min_epi16( pred, _mm_add_epi16( d, diff ) );
+        _mm_storel_epi64( (__m128i *)&p_dst[x], _mm_packus_epi16( pred, pred ) );
+    }
+#undef SELECT
+#undef PRED
+#undef SCORE
+#undef CUR
+#undef LOAD
+
+    for( ; x < i_width; x++ )
+        p_dst[x] = YadifPixel( p_prev + x, p_cur + x, p_next + x,
+                               p_prev2 + x, p_next2 + x, i_prefs, i_mrefs,
+                               x < i_width - 3, b_check );
+}
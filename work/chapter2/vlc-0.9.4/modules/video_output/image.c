@@ -33,6 +33,8 @@
 #include <vlc_plugin.h>
 #include <vlc_vout.h>
 #include <vlc_interface.h>
+#include <vlc_input.h>
+#include <vlc_charset.h>
 
 #include "vlc_image.h"
 #include "vlc_strings.h"
@@ -47,6 +49,9 @@ static int  Init      ( vout_thread_t * );
 static void End       ( vout_thread_t *p_vout );
 static void Display   ( vout_thread_t *, picture_t * );
 
+static void WritePicture( vout_thread_t *, picture_t * );
+static void Thumbnail   ( vout_thread_t *, picture_t * );
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -77,6 +82,20 @@ static void Display   ( vout_thread_t *, picture_t * );
                             "creating one file per image. In this case, " \
                              "the number is not appended to the filename." )
 
+#define TIMES_TEXT N_( "Thumbnail times" )
+#define TIMES_LONGTEXT N_( "Comma separated list of times, in seconds, " \
+                           "at which to write an image. The input is " \
+                           "seeked to each of them, and stopped after " \
+                           "the last one, so that thumbnails of many " \
+                           "files are made quickly. The recording ratio " \
+                           "is not used then." )
+
+#define INTERVAL_TEXT N_( "Thumbnail interval" )
+#define INTERVAL_LONGTEXT N_( "Write an image every given number of " \
+                              "seconds, seeking from one to the next, until " \
+                              "the end of the input. 0 disables it. The " \
+                              "thumbnail times have precedence over it." )
+
 static const char *const psz_format_list[] = { "png", "jpeg" };
 static const char *const psz_format_list_text[] = { "PNG", "JPEG" };
 
@@ -104,11 +123,16 @@ vlc_module_begin( );
                  PREFIX_TEXT, PREFIX_LONGTEXT, false );
     add_bool(    CFG_PREFIX "replace", 0, NULL,
                  REPLACE_TEXT, REPLACE_LONGTEXT, false );
+    add_string(  CFG_PREFIX "times", NULL, NULL,
+                 TIMES_TEXT, TIMES_LONGTEXT, true );
+    add_float(   CFG_PREFIX "interval", 0., NULL,
+                 INTERVAL_TEXT, INTERVAL_LONGTEXT, true );
     set_callbacks( Create, Destroy );
 vlc_module_end();
 
 static const char *const ppsz_vout_options[] = {
-    "format", "width", "height", "ratio", "prefix", "replace", NULL
+    "format", "width", "height", "ratio", "prefix", "replace", "times",
+    "interval", NULL
 };
 
 /*****************************************************************************
@@ -132,8 +156,72 @@ struct vout_sys_t
     bool b_meta;
 
     image_handler_t *p_image;
+
+    /* Thumbnails: the times (or the interval) to seek the input to */
+    mtime_t     *pi_times;
+    int         i_times;
+    mtime_t     i_interval;
+    bool        b_thumbnail;
+
+    int         i_input_id;           /* input being seeked, or 0 */
+    int         i_next;               /* next time to seek to */
+    bool        b_seeking;            /* the next new picture is written */
+    bool        b_done;               /* the input was stopped */
+    int         i_stale;     /* pictures decoded before the last seek */
+    mtime_t     i_last_date;          /* of the last displayed picture */
 };
 
+/*****************************************************************************
+ * ParseTimes: reads the thumbnail times and interval
+ *****************************************************************************/
+static int CompareTimes( const void *p_a, const void *p_b )
+{
+    const mtime_t i_a = *(const mtime_t *)p_a, i_b = *(const mtime_t *)p_b;
+
+    return i_a < i_b ? -1 : i_a > i_b;
+}
+
+static void ParseTimes( vout_thread_t *p_vout )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    char *psz_times = var_CreateGetString( p_vout, CFG_PREFIX "times" );
+    char *psz_parser = psz_times;
+    float f_interval = var_CreateGetFloat( p_vout, CFG_PREFIX "interval" );
+
+    p_sys->pi_times = NULL;
+    p_sys->i_times = 0;
+    p_sys->i_interval = f_interval > 0. ? (mtime_t)( f_interval * 1000000 ) : 0;
+
+    while( psz_parser && *psz_parser )
+    {
+        char *psz_end;
+        double f_time = us_strtod( psz_parser, &psz_end );
+
+        if( psz_end == psz_parser || f_time < 0. )
+        {
+            msg_Warn( p_vout, "invalid thumbnail time: %s", psz_parser );
+            break;
+        }
+        mtime_t *pi_times = realloc( p_sys->pi_times, ( p_sys->i_times + 1 )
+                                                      * sizeof( mtime_t ) );
+        if( !pi_times )
+            break;
+        p_sys->pi_times = pi_times;
+        p_sys->pi_times[p_sys->i_times++] = (mtime_t)( f_time * 1000000 );
+
+        psz_parser = psz_end;
+        while( *psz_parser == ',' || *psz_parser == ' ' )
+            psz_parser++;
+    }
+    free( psz_times );
+
+    if( p_sys->i_times > 0 )
+        qsort( p_sys->pi_times, p_sys->i_times, sizeof( mtime_t ),
+               CompareTimes );
+    p_sys->b_thumbnail = p_sys->i_times > 0 || p_sys->i_interval > 0;
+    p_sys->i_input_id = 0;
+}
+
 /*****************************************************************************
  * Create: allocates video thread
  *****************************************************************************
@@ -168,11 +256,14 @@ static int Create( vlc_object_t *p_this )
     p_vout->p_sys->b_replace =
             var_CreateGetBool( p_this, CFG_PREFIX "replace" );
     p_vout->p_sys->i_current = 0;
+    p_vout->p_sys->i_frames = 0;
+    ParseTimes( p_vout );
     p_vout->p_sys->p_image = image_HandlerCreate( p_vout );
 
     if( !p_vout->p_sys->p_image )
     {
         msg_Err( p_this, "unable to create image handler") ;
+        free( p_vout->p_sys->pi_times );
         FREENULL( p_vout->p_sys->psz_prefix );
         FREENULL( p_vout->p_sys->psz_format );
         FREENULL( p_vout->p_sys );
@@ -261,6 +352,7 @@ static void Destroy( vlc_object_t *p_this )
 
     /* Destroy structure */
     image_HandlerDelete( p_vout->p_sys->p_image );
+    free( p_vout->p_sys->pi_times );
     FREENULL( p_vout->p_sys->psz_prefix );
     FREENULL( p_vout->p_sys->psz_format );
     FREENULL( p_vout->p_sys );
@@ -272,6 +364,122 @@ static void Destroy( vlc_object_t *p_this )
  * This function copies the rendered picture into our circular buffer.
  *****************************************************************************/
 static void Display( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    if( p_vout->p_sys->b_thumbnail )
+    {
+        Thumbnail( p_vout, p_pic );
+        return;
+    }
+
+    if( p_vout->p_sys->i_frames % p_vout->p_sys->i_ratio != 0 )
+    {
+        p_vout->p_sys->i_frames++;
+        return;
+    }
+    p_vout->p_sys->i_frames++;
+
+    WritePicture( p_vout, p_pic );
+}
+
+/*****************************************************************************
+ * Thumbnail: writes the first picture after each seek
+ *****************************************************************************
+ * The pictures of the video output have no stream time, so the pictures
+ * that were queued or being decoded when the input was seeked are counted,
+ * and skipped afterwards. The video output displays its last picture again
+ * when no other one comes, which is recognized by its date.
+ *****************************************************************************/
+static void Thumbnail( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    const mtime_t i_date =
+        p_vout->p_fps_sample[( p_vout->c_fps_samples - 1 ) % VOUT_FPS_SAMPLES];
+    input_thread_t *p_input;
+    mtime_t i_time, i_length;
+
+    p_input = vlc_object_find( p_vout, VLC_OBJECT_INPUT, FIND_PARENT );
+    if( !p_input )
+        return;
+
+    /* The video output may be reused by the next input */
+    if( p_sys->i_input_id != p_input->i_object_id )
+    {
+        p_sys->i_input_id = p_input->i_object_id;
+        p_sys->i_next = 0;
+        p_sys->b_seeking = false;
+        p_sys->b_done = false;
+        p_sys->i_stale = 0;
+    }
+    else if( i_date == p_sys->i_last_date )
+    {
+        vlc_object_release( p_input );
+        return;
+    }
+    p_sys->i_last_date = i_date;
+
+    if( p_sys->b_done || p_sys->i_stale > 0 )
+    {
+        if( p_sys->i_stale > 0 )
+            p_sys->i_stale--;
+        vlc_object_release( p_input );
+        return;
+    }
+
+    if( p_sys->b_seeking )
+    {
+        WritePicture( p_vout, p_pic );
+        p_sys->b_seeking = false;
+        p_sys->i_next++;
+    }
+
+    /* Seek to the next time, or stop */
+    if( p_sys->i_times > 0 )
+        i_time = p_sys->i_next < p_sys->i_times ? p_sys->pi_times[p_sys->i_next]
+                                                : -1;
+    else
+        i_time = p_sys->i_next * p_sys->i_interval;
+    i_length = var_GetTime( p_input, "length" );
+
+    if( i_time < 0 || ( i_length > 0 && i_time >= i_length ) )
+    {
+        msg_Dbg( p_vout, "%d thumbnails written, stopping the input",
+                 p_sys->i_next );
+        input_StopThread( p_input );
+        p_sys->b_done = true;
+    }
+    else
+    {
+        /* The picture being displayed is ready too */
+        p_sys->i_stale = -1;
+        vlc_mutex_lock( &p_vout->picture_lock );
+        for( int i = 0; i < I_RENDERPICTURES; i++ )
+        {
+            switch( PP_RENDERPICTURE[i]->i_status )
+            {
+            case READY_PICTURE:
+            case RESERVED_PICTURE:
+            case RESERVED_DATED_PICTURE:
+            case RESERVED_DISP_PICTURE:
+                p_sys->i_stale++;
+                break;
+            default:
+                break;
+            }
+        }
+        vlc_mutex_unlock( &p_vout->picture_lock );
+        if( p_sys->i_stale < 0 )
+            p_sys->i_stale = 0;
+
+        var_SetTime( p_input, "time", i_time );
+        p_sys->b_seeking = true;
+    }
+    vlc_object_release( p_input );
+}
+
+/*****************************************************************************
+ * WritePicture: writes a picture to the next file
+ *****************************************************************************/
+static void WritePicture( vout_thread_t *p_vout, picture_t *p_pic )
 {
     video_format_t fmt_in, fmt_out;
 
@@ -282,13 +490,6 @@ static void Display( vout_thread_t *p_vout, picture_t *p_pic )
     memset( &fmt_in, 0, sizeof( fmt_in ) );
     memset( &fmt_out, 0, sizeof( fmt_out ) );
 
-    if( p_vout->p_sys->i_frames % p_vout->p_sys->i_ratio != 0 )
-    {
-        p_vout->p_sys->i_frames++;
-        return;
-    }
-    p_vout->p_sys->i_frames++;
-
     fmt_in.i_chroma = p_vout->render.i_chroma;
     fmt_in.i_width = p_vout->render.i_width;
     fmt_in.i_height = p_vout->render.i_height;
@@ -128,6 +128,13 @@ IMAGE_TYPE *CreateShmImage ( vout_thread_t *,
 static int i_shm_major = 0;
 #endif
 
+#ifdef HAVE_SHM_COMPLETION
+static void ShmQueue      ( vout_thread_t *, picture_t * );
+static void ShmDrain      ( vout_thread_t *, bool );
+static void ShmFlush      ( vout_thread_t * );
+static int  PictureLock   ( vout_thread_t *, picture_t * );
+#endif
+
 static void ToggleFullScreen      ( vout_thread_t * );
 
 static void EnableXScreenSaver    ( vout_thread_t * );
@@ -509,6 +516,16 @@ void Deactivate ( vlc_object_t *p_this )
     DisablePixelDoubling(p_vout);
 #endif
 
+#ifdef HAVE_SHM_COMPLETION
+    if( p_vout->p_sys->i_present_count )
+        msg_Dbg( p_vout, "%"PRId64" pictures presented, latency "
+                 "%"PRId64" us average, %"PRId64" us max",
+                 p_vout->p_sys->i_present_count,
+                 p_vout->p_sys->i_present_total /
+                     p_vout->p_sys->i_present_count,
+                 p_vout->p_sys->i_present_max );
+#endif
+
     DestroyCursor( p_vout );
     EnableXScreenSaver( p_vout );
     DestroyWindow( p_vout, &p_vout->p_sys->original_window );
@@ -932,6 +949,10 @@ static int InitVideo( vout_thread_t *p_vout )
 
         p_pic->i_status = DESTROYED_PICTURE;
         p_pic->i_type   = DIRECT_PICTURE;
+#ifdef HAVE_SHM_COMPLETION
+        if( p_vout->p_sys->i_shm_opcode )
+            p_pic->pf_lock = PictureLock;
+#endif
 
         PP_OUTPUTPICTURE[ I_OUTPUTPICTURES ] = p_pic;
 
@@ -1081,6 +1102,16 @@ static void DisplayVideo( vout_thread_t *p_vout, picture_t *p_pic )
 #ifdef HAVE_SYS_SHM_H
     if( p_vout->p_sys->i_shm_opcode )
     {
+#   ifdef HAVE_SHM_COMPLETION
+        /* Ask for a ShmCompletion event: the picture stays linked until the
+         * server is done reading it, instead of waiting for it here */
+        const Bool b_completion = True;
+
+        ShmQueue( p_vout, p_pic );
+#   else
+        const Bool b_completion = False;
+#   endif
+
         /* Display rendered image using shared memory extension */
 #   if defined(MODULE_NAME_IS_xvideo) || defined(MODULE_NAME_IS_xvmc)
         XvShmPutImage( p_vout->p_sys->p_display, p_vout->p_sys->i_xvport,
@@ -1091,7 +1122,7 @@ static void DisplayVideo( vout_thread_t *p_vout, picture_t *p_pic )
                        p_vout->fmt_out.i_visible_width,
                        p_vout->fmt_out.i_visible_height,
                        0 /*dest_x*/, 0 /*dest_y*/, i_width, i_height,
-                       False /* Don't put True here or you'll waste your CPU */ );
+                       b_completion );
 #   else
         XShmPutImage( p_vout->p_sys->p_display,
                       p_vout->p_sys->p_win->video_window,
@@ -1101,7 +1132,7 @@ static void DisplayVideo( vout_thread_t *p_vout, picture_t *p_pic )
                       0 /*dest_x*/, 0 /*dest_y*/,
                       p_vout->fmt_out.i_visible_width,
                       p_vout->fmt_out.i_visible_height,
-                      False /* Don't put True here ! */ );
+                      b_completion );
 #   endif
     }
     else
@@ -1129,6 +1160,12 @@ static void DisplayVideo( vout_thread_t *p_vout, picture_t *p_pic )
 #endif
     }
 
+#ifdef HAVE_SHM_COMPLETION
+    /* The ShmCompletion event tells when the image can be written again */
+    if( p_vout->p_sys->i_shm_opcode )
+        XFlush( p_vout->p_sys->p_display );
+    else
+#endif
     /* Make sure the command is sent now - do NOT use XFlush !*/
     XSync( p_vout->p_sys->p_display, False );
 
@@ -1153,6 +1190,12 @@ static int ManageVideo( vout_thread_t *p_vout )
     xvmc_context_reader_lock( &p_vout->p_sys->xvmc_lock );
 #endif
 
+#ifdef HAVE_SHM_COMPLETION
+    /* Release the pictures the server is done with */
+    if( p_vout->p_sys->i_shm_queue )
+        ShmDrain( p_vout, false );
+#endif
+
     /* Handle events from the owner window */
     if( p_vout->p_sys->p_win->owner_window )
     {
@@ -1573,6 +1616,10 @@ static void EndVideo( vout_thread_t *p_vout )
 {
     int i_index;
 
+#ifdef HAVE_SHM_COMPLETION
+    ShmFlush( p_vout );
+#endif
+
     /* Free the direct buffers we allocated */
     for( i_index = I_OUTPUTPICTURES ; i_index ; )
     {
@@ -1903,6 +1950,9 @@ static int NewPicture( vout_thread_t *p_vout, picture_t *p_pic )
     //    p_pic->p_accel_data = &p_pic->p_sys->xxmc_data;
     p_pic->p_sys->nb_display = 0;
 #endif
+#ifdef HAVE_SHM_COMPLETION
+    p_pic->p_sys->i_shm_pending = 0;
+#endif
 
     /* Fill in picture_t fields */
     vout_InitPicture( VLC_OBJECT(p_vout), p_pic, p_vout->output.i_chroma,
@@ -2072,6 +2122,150 @@ static void FreePicture( vout_thread_t *p_vout, picture_t *p_pic )
     free( p_pic->p_sys );
 }
 
+#ifdef HAVE_SHM_COMPLETION
+/*****************************************************************************
+ * ShmQueue: keep an XShm image put until the server is done with it
+ *****************************************************************************
+ * The picture is linked, so that the decoder doesn't get it back while the
+ * server may still read it. If too many puts are in flight, wait for them.
+ *****************************************************************************/
+static void ShmQueue( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    int i_entry;
+
+    if( p_sys->i_shm_queue == SHM_QUEUE_SIZE )
+        ShmDrain( p_vout, true );
+
+    i_entry = ( p_sys->i_shm_queue_first + p_sys->i_shm_queue )
+                  % SHM_QUEUE_SIZE;
+    p_sys->p_shm_queue[i_entry].p_pic = p_pic;
+    p_sys->p_shm_queue[i_entry].i_date = mdate();
+    p_sys->i_shm_queue++;
+
+    p_pic->p_sys->i_shm_pending++;
+    vout_LinkPicture( p_vout, p_pic );
+}
+
+/*****************************************************************************
+ * ShmPop: release the oldest put of the queue
+ *****************************************************************************
+ * b_unlink is false when the picture_lock may be held by our caller
+ * (pf_end), the core resets the direct buffers afterwards anyway.
+ *****************************************************************************/
+static void ShmPop( vout_thread_t *p_vout, mtime_t i_date, bool b_unlink )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    picture_t *p_pic = p_sys->p_shm_queue[p_sys->i_shm_queue_first].p_pic;
+    mtime_t i_latency =
+        i_date - p_sys->p_shm_queue[p_sys->i_shm_queue_first].i_date;
+
+    p_sys->i_shm_queue_first = ( p_sys->i_shm_queue_first + 1 )
+                                   % SHM_QUEUE_SIZE;
+    p_sys->i_shm_queue--;
+
+    p_sys->i_present_count++;
+    p_sys->i_present_total += i_latency;
+    if( i_latency > p_sys->i_present_max )
+        p_sys->i_present_max = i_latency;
+
+    p_pic->p_sys->i_shm_pending--;
+    if( b_unlink )
+        vout_UnlinkPicture( p_vout, p_pic );
+    else
+        p_pic->i_refcount--;
+}
+
+/*****************************************************************************
+ * ShmEvents: handle the pending ShmCompletion events
+ *****************************************************************************
+ * The server completes the puts in order, so an event releases all the puts
+ * up to the one of its segment.
+ *****************************************************************************/
+static void ShmEvents( vout_thread_t *p_vout, bool b_unlink )
+{
+    vout_sys_t *p_sys = p_vout->p_sys;
+    XEvent xevent;
+
+    while( p_sys->i_shm_queue
+        && XCheckTypedEvent( p_sys->p_display, p_sys->i_shm_completion,
+                             &xevent ) == True )
+    {
+        XShmCompletionEvent *p_event = (XShmCompletionEvent *)&xevent;
+        mtime_t i_date = mdate();
+
+        while( p_sys->i_shm_queue )
+        {
+            picture_t *p_pic =
+                p_sys->p_shm_queue[p_sys->i_shm_queue_first].p_pic;
+            bool b_last = p_pic->p_sys->shminfo.shmseg == p_event->shmseg;
+
+            ShmPop( p_vout, i_date, b_unlink );
+            if( b_last )
+                break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * ShmDrain: release the pictures the server is done with
+ *****************************************************************************
+ * With b_sync, wait for all the puts in flight. A put which failed (the
+ * window went away...) gets no event, so whatever remains is released too.
+ *****************************************************************************/
+static void ShmDrain( vout_thread_t *p_vout, bool b_sync )
+{
+    if( b_sync )
+        XSync( p_vout->p_sys->p_display, False );
+
+    ShmEvents( p_vout, true );
+
+    if( b_sync )
+    {
+        mtime_t i_date = mdate();
+
+        while( p_vout->p_sys->i_shm_queue )
+            ShmPop( p_vout, i_date, true );
+    }
+}
+
+/*****************************************************************************
+ * ShmFlush: forget all the puts before the images are destroyed
+ *****************************************************************************/
+static void ShmFlush( vout_thread_t *p_vout )
+{
+    mtime_t i_date;
+
+    if( !p_vout->p_sys->i_shm_queue )
+        return;
+
+    XSync( p_vout->p_sys->p_display, False );
+    ShmEvents( p_vout, false );
+
+    i_date = mdate();
+    while( p_vout->p_sys->i_shm_queue )
+        ShmPop( p_vout, i_date, false );
+}
+
+/*****************************************************************************
+ * PictureLock: wait until the server is done reading a direct buffer
+ *****************************************************************************
+ * Called by the core before it writes a picture into the buffer.
+ *****************************************************************************/
+static int PictureLock( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    vlc_mutex_lock( &p_vout->p_sys->lock );
+
+    if( p_pic->p_sys->i_shm_pending )
+        ShmDrain( p_vout, false );
+    if( p_pic->p_sys->i_shm_pending )
+        ShmDrain( p_vout, true );
+
+    vlc_mutex_unlock( &p_vout->p_sys->lock );
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * ToggleFullScreen: Enable or disable full screen mode
  *****************************************************************************
@@ -2679,6 +2873,14 @@ static int InitDisplay( vout_thread_t *p_vout )
 
 #ifdef HAVE_SYS_SHM_H
     p_vout->p_sys->i_shm_opcode = 0;
+#   ifdef HAVE_SHM_COMPLETION
+    p_vout->p_sys->i_shm_completion = 0;
+    p_vout->p_sys->i_shm_queue_first = 0;
+    p_vout->p_sys->i_shm_queue = 0;
+    p_vout->p_sys->i_present_count = 0;
+    p_vout->p_sys->i_present_total = 0;
+    p_vout->p_sys->i_present_max = 0;
+#   endif
 
     if( config_GetInt( p_vout, MODULE_STRING "-shm" ) )
     {
@@ -2687,7 +2889,12 @@ static int InitDisplay( vout_thread_t *p_vout )
         if( XQueryExtension( p_vout->p_sys->p_display, "MIT-SHM", &major,
                              &evt, &err )
          && XShmQueryExtension( p_vout->p_sys->p_display ) )
+        {
             p_vout->p_sys->i_shm_opcode = major;
+#   ifdef HAVE_SHM_COMPLETION
+            p_vout->p_sys->i_shm_completion = evt + ShmCompletion;
+#   endif
+        }
 
         if( p_vout->p_sys->i_shm_opcode )
         {
@@ -55,6 +55,14 @@
 #include <libosso.h>
 #endif
 
+/* The XShm images are put without waiting for the server: it tells when it
+ * is done with one with a ShmCompletion event. Only x11 for now: xvideo
+ * still waits for each XvShmPutImage until it has been tested this way. */
+#if defined(HAVE_SYS_SHM_H) && defined(MODULE_NAME_IS_x11)
+#   define HAVE_SHM_COMPLETION 1
+#   define SHM_QUEUE_SIZE 32    /* puts in flight before waiting for them */
+#endif
+
 
 /*****************************************************************************
  * x11_window_t: X11 window descriptor
@@ -227,6 +235,23 @@ struct vout_sys_t
 #ifdef HAVE_SYS_SHM_H
     int                 i_shm_opcode;      /* shared memory extension opcode */
 #endif
+#ifdef HAVE_SHM_COMPLETION
+    /* The puts of images the server may still be reading, oldest first.
+     * Their pictures are linked until the ShmCompletion event. */
+    int                 i_shm_completion;    /* ShmCompletion event type */
+    int                 i_shm_queue_first;
+    int                 i_shm_queue;
+    struct
+    {
+        picture_t *     p_pic;
+        mtime_t         i_date;
+    } p_shm_queue[SHM_QUEUE_SIZE];
+
+    /* Present latency, from the put to the handling of its completion */
+    int64_t             i_present_count;
+    mtime_t             i_present_total;
+    mtime_t             i_present_max;
+#endif
 
 #if defined(MODULE_NAME_IS_xvideo) || defined(MODULE_NAME_IS_xvmc)
     int                 i_xvport;
@@ -354,6 +379,9 @@ struct picture_sys_t
 #ifdef HAVE_SYS_SHM_H
     XShmSegmentInfo     shminfo;       /* shared memory zone information */
 #endif
+#ifdef HAVE_SHM_COMPLETION
+    int                 i_shm_pending;    /* puts not completed yet */
+#endif
 
 #ifdef MODULE_NAME_IS_xvmc
     XvMCSurface         *xvmc_surf;
@@ -79,7 +79,9 @@ int aout_InputNew( aout_instance_t * p_aout, aout_input_t * p_input )
 
     /* Prepare FIFO. */
     aout_FifoInit( p_aout, &p_input->fifo, p_aout->mixer.mixer.i_rate );
+    aout_FifoInit( p_aout, &p_input->mix_fifo, p_aout->mixer.mixer.i_rate );
     p_input->p_first_byte_to_mix = NULL;
+    p_input->b_mix_flushed = false;
 
     /* Prepare format structure */
     memcpy( &chain_input_format, &p_input->input,
@@ -554,7 +556,7 @@ int aout_InputPlay( aout_instance_t * p_aout, aout_input_t * p_input,
                   "clearing out", mdate() - start_date );
         aout_lock_input_fifos( p_aout );
         aout_FifoSet( p_aout, &p_input->fifo, 0 );
-        p_input->p_first_byte_to_mix = NULL;
+        p_input->b_mix_flushed = true;
         aout_unlock_input_fifos( p_aout );
         if ( p_input->i_resampling_type != AOUT_RESAMPLING_NONE )
             msg_Warn( p_aout, "timing screwed, stopping resampling" );
@@ -584,7 +586,7 @@ int aout_InputPlay( aout_instance_t * p_aout, aout_input_t * p_input,
                   start_date - p_buffer->start_date );
         aout_lock_input_fifos( p_aout );
         aout_FifoSet( p_aout, &p_input->fifo, 0 );
-        p_input->p_first_byte_to_mix = NULL;
+        p_input->b_mix_flushed = true;
         aout_unlock_input_fifos( p_aout );
         if ( p_input->i_resampling_type != AOUT_RESAMPLING_NONE )
             msg_Warn( p_aout, "timing screwed, stopping resampling" );
@@ -65,6 +65,75 @@ void aout_MixerDelete( aout_instance_t * p_aout )
     p_aout->mixer.b_error = 1;
 }
 
+/*****************************************************************************
+ * TakeBuffers: move the buffers of the input FIFOs to their mix FIFOs
+ *****************************************************************************
+ * The mixer then works on the mix FIFOs with only the mixer lock, and the
+ * decoders can keep on pushing to the input FIFOs in the meantime. Please
+ * note that you must hold the mixer and input FIFOs locks.
+ *****************************************************************************/
+static void TakeBuffers( aout_instance_t * p_aout )
+{
+    int i;
+
+    for ( i = 0; i < p_aout->i_nb_inputs; i++ )
+    {
+        aout_input_t * p_input = p_aout->pp_inputs[i];
+        aout_fifo_t * p_fifo = &p_input->fifo;
+
+        if ( p_input->b_error ) continue;
+
+        p_input->mix_fifo.p_first = p_fifo->p_first;
+        p_input->mix_fifo.pp_last = p_fifo->p_first != NULL ?
+                                    p_fifo->pp_last :
+                                    &p_input->mix_fifo.p_first;
+        p_fifo->p_first = NULL;
+        p_fifo->pp_last = &p_fifo->p_first;
+        p_input->b_mix_flushed = false;
+        p_input->i_mix_moved = 0;
+    }
+}
+
+/*****************************************************************************
+ * GiveBackBuffers: put the buffers left by the mixer back in the input FIFOs
+ *****************************************************************************
+ * Buffers pushed during the mix go after them, unless the input was flushed
+ * in the meantime. Please note that you must hold the mixer and input FIFOs
+ * locks.
+ *****************************************************************************/
+static void GiveBackBuffers( aout_instance_t * p_aout )
+{
+    int i;
+
+    for ( i = 0; i < p_aout->i_nb_inputs; i++ )
+    {
+        aout_input_t * p_input = p_aout->pp_inputs[i];
+        aout_fifo_t * p_fifo = &p_input->fifo;
+        aout_fifo_t * p_mix_fifo = &p_input->mix_fifo;
+
+        if ( p_input->b_error ) continue;
+
+        if ( p_input->b_mix_flushed )
+        {
+            aout_FifoDestroy( p_aout, p_mix_fifo );
+            p_input->p_first_byte_to_mix = NULL;
+            continue;
+        }
+        if ( p_mix_fifo->p_first == NULL ) continue;
+
+        if ( p_input->i_mix_moved )
+            aout_FifoMoveDates( p_aout, p_mix_fifo, p_input->i_mix_moved );
+
+        *p_mix_fifo->pp_last = p_fifo->p_first;
+        if ( p_fifo->p_first == NULL )
+            p_fifo->pp_last = p_mix_fifo->pp_last;
+        p_fifo->p_first = p_mix_fifo->p_first;
+
+        p_mix_fifo->p_first = NULL;
+        p_mix_fifo->pp_last = &p_mix_fifo->p_first;
+    }
+}
+
 /*****************************************************************************
  * MixBuffer: try to prepare one output buffer
  *****************************************************************************
@@ -74,8 +143,9 @@ static int MixBuffer( aout_instance_t * p_aout )
 {
     int             i, i_first_input = 0;
     aout_buffer_t * p_output_buffer;
-    mtime_t start_date, end_date;
+    mtime_t start_date, end_date, mix_date;
     audio_date_t exact_start_date;
+    bool b_reset_output = false;
 
     if ( p_aout->mixer.b_error )
     {
@@ -99,7 +169,6 @@ static int MixBuffer( aout_instance_t * p_aout )
 
 
     aout_lock_output_fifo( p_aout );
-    aout_lock_input_fifos( p_aout );
 
     /* Retrieve the date of the next buffer. */
     memcpy( &exact_start_date, &p_aout->output.fifo.end_date,
@@ -116,10 +185,26 @@ static int MixBuffer( aout_instance_t * p_aout )
         aout_FifoSet( p_aout, &p_aout->output.fifo, 0 );
         aout_DateSet( &exact_start_date, 0 );
         start_date = 0;
+        p_aout->output.i_underruns++;
     }
 
     aout_unlock_output_fifo( p_aout );
 
+    aout_lock_input_fifos( p_aout );
+
+    /* Inputs flushed since the last mix only got b_mix_flushed set, as the
+     * mixer may have been reading p_first_byte_to_mix at that time. */
+    for ( i = 0; i < p_aout->i_nb_inputs; i++ )
+    {
+        aout_input_t * p_input = p_aout->pp_inputs[i];
+
+        if ( p_input->b_mix_flushed )
+        {
+            p_input->p_first_byte_to_mix = NULL;
+            p_input->b_mix_flushed = false;
+        }
+    }
+
     /* See if we have enough data to prepare a new buffer for the audio
      * output. First : start date. */
     if ( !start_date )
@@ -286,11 +371,10 @@ static int MixBuffer( aout_instance_t * p_aout )
                 i_nb_bytes *= p_aout->mixer.mixer.i_bytes_per_frame;
                 if( i_nb_bytes < 0 )
                 {
-                    /* Is it really the best way to do it ? */
-                    aout_lock_output_fifo( p_aout );
-                    aout_FifoSet( p_aout, &p_aout->output.fifo, 0 );
-                    aout_DateSet( &exact_start_date, 0 );
-                    aout_unlock_output_fifo( p_aout );
+                    /* Is it really the best way to do it ? The output
+                     * FIFO lock must not be taken after the input FIFOs
+                     * one, so this is done below. */
+                    b_reset_output = true;
                     break;
                 }
 
@@ -303,19 +387,30 @@ static int MixBuffer( aout_instance_t * p_aout )
     {
         /* Interrupted before the end... We can't run. */
         aout_unlock_input_fifos( p_aout );
+        if ( b_reset_output )
+        {
+            aout_lock_output_fifo( p_aout );
+            aout_FifoSet( p_aout, &p_aout->output.fifo, 0 );
+            aout_unlock_output_fifo( p_aout );
+        }
         return -1;
     }
 
+    TakeBuffers( p_aout );
+    aout_unlock_input_fifos( p_aout );
+
     /* Run the mixer. */
     aout_BufferAlloc( &p_aout->mixer.output_alloc,
                       ((uint64_t)p_aout->output.i_nb_samples * 1000000)
                         / p_aout->output.output.i_rate,
                       /* This is a bit kludgy, but is actually only used
                        * for the S/PDIF dummy mixer : */
-                      p_aout->pp_inputs[i_first_input]->fifo.p_first,
+                      p_aout->pp_inputs[i_first_input]->mix_fifo.p_first,
                       p_output_buffer );
     if ( p_output_buffer == NULL )
     {
+        aout_lock_input_fifos( p_aout );
+        GiveBackBuffers( p_aout );
         aout_unlock_input_fifos( p_aout );
         return -1;
     }
@@ -330,8 +425,13 @@ static int MixBuffer( aout_instance_t * p_aout )
     p_output_buffer->start_date = start_date;
     p_output_buffer->end_date = end_date;
 
+    mix_date = mdate();
     p_aout->mixer.pf_do_work( p_aout, p_output_buffer );
+    p_aout->mixer.i_mix_time += mdate() - mix_date;
+    p_aout->mixer.i_nb_mixes++;
 
+    aout_lock_input_fifos( p_aout );
+    GiveBackBuffers( p_aout );
     aout_unlock_input_fifos( p_aout );
 
     aout_OutputPlay( p_aout, p_output_buffer );
@@ -164,9 +164,13 @@ int aout_OutputNew( aout_instance_t * p_aout,
     /* Prepare FIFO. */
     aout_FifoInit( p_aout, &p_aout->output.fifo,
                    p_aout->output.output.i_rate );
+    p_aout->output.i_underruns = 0;
 
     aout_unlock_output_fifo( p_aout );
 
+    p_aout->mixer.i_nb_mixes = 0;
+    p_aout->mixer.i_mix_time = 0;
+
     aout_FormatPrint( p_aout, "output", &p_aout->output.output );
 
     /* Calculate the resulting mixer output format. */
@@ -234,6 +238,11 @@ void aout_OutputDelete( aout_instance_t * p_aout )
 
     aout_lock_output_fifo( p_aout );
     aout_FifoDestroy( p_aout, &p_aout->output.fifo );
+    msg_Dbg( p_aout, "mixed %u buffers, %"PRId64" us per mix on average, "
+             "%u output under-runs", p_aout->mixer.i_nb_mixes,
+             p_aout->mixer.i_nb_mixes ?
+                 p_aout->mixer.i_mix_time / p_aout->mixer.i_nb_mixes : 0,
+             p_aout->output.i_underruns );
     aout_unlock_output_fifo( p_aout );
 
     p_aout->output.b_error = true;
@@ -327,6 +336,8 @@ aout_buffer_t * aout_OutputNextBuffer( aout_instance_t * p_aout,
      */
     {
         const mtime_t i_delta = p_buffer->start_date - start_date;
+        if ( !p_aout->output.b_starving )
+            p_aout->output.i_underruns++;
         aout_unlock_output_fifo( p_aout );
 
         if ( !p_aout->output.b_starving )
@@ -354,6 +365,8 @@ aout_buffer_t * aout_OutputNextBuffer( aout_instance_t * p_aout,
             aout_fifo_t * p_fifo = &p_aout->pp_inputs[i]->fifo;
 
             aout_FifoMoveDates( p_aout, p_fifo, difference );
+            /* The buffers being mixed are moved when they come back */
+            p_aout->pp_inputs[i]->i_mix_moved += difference;
         }
 
         aout_FifoMoveDates( p_aout, &p_aout->output.fifo, difference );
@@ -59,12 +59,17 @@ static picture_t *vout_new_buffer( decoder_t * );
 static void vout_del_buffer( decoder_t *, picture_t * );
 static void vout_link_picture( decoder_t *, picture_t * );
 static void vout_unlink_picture( decoder_t *, picture_t * );
+static void DecoderAddPictureWait( decoder_t *, mtime_t );
+static void DecoderDumpPictureWait( decoder_t * );
 
 static subpicture_t *spu_new_buffer( decoder_t * );
 static void spu_del_buffer( decoder_t *, subpicture_t * );
 
 static es_format_t null_es_format;
 
+/* Waits for a free picture are accounted by power of two milliseconds */
+#define PICTURE_WAIT_BUCKETS 8
+
 struct decoder_owner_sys_t
 {
     bool      b_own_thread;
@@ -77,6 +82,7 @@ struct decoder_owner_sys_t
     aout_input_t    *p_aout_input;
 
     vout_thread_t   *p_vout;
+    unsigned         pi_picture_wait[PICTURE_WAIT_BUCKETS];
 
     vout_thread_t   *p_spu_vout;
     int              i_spu_channel;
@@ -281,6 +287,10 @@ void input_DecoderDelete( decoder_t *p_dec )
  */
 void input_DecoderDecode( decoder_t * p_dec, block_t *p_block )
 {
+    /* Decoders and packetizers may modify the data */
+    if( p_block && ( p_block = block_Unshare( p_block ) ) == NULL )
+        return;
+
     if( p_dec->p_owner->b_own_thread )
     {
         if( p_dec->p_owner->p_input->p->b_out_pace_control )
@@ -475,6 +485,8 @@ static decoder_t * CreateDecoder( input_thread_t *p_input,
     p_dec->p_owner->p_aout = NULL;
     p_dec->p_owner->p_aout_input = NULL;
     p_dec->p_owner->p_vout = NULL;
+    memset( p_dec->p_owner->pi_picture_wait, 0,
+            sizeof( p_dec->p_owner->pi_picture_wait ) );
     p_dec->p_owner->p_spu_vout = NULL;
     p_dec->p_owner->i_spu_channel = 0;
     p_dec->p_owner->p_sout = p_input->p->p_sout;
@@ -711,8 +723,7 @@ static void VoutDisplayedPicture( vout_thread_t *p_vout, picture_t *p_pic )
     }
     else
     {
-        p_pic->i_status = DESTROYED_PICTURE;
-        p_vout->i_heap_size--;
+        vout_RecyclePicture( p_vout, p_pic );
     }
 
     vlc_mutex_unlock( &p_vout->picture_lock );
@@ -1133,6 +1144,8 @@ static void DeleteDecoder( decoder_t * p_dec )
     {
         int i_pic;
 
+        DecoderDumpPictureWait( p_dec );
+
 #define p_pic p_dec->p_owner->p_vout->render.pp_picture[i_pic]
         /* Hack to make sure all the the pictures are freed by the decoder */
         for( i_pic = 0; i_pic < p_dec->p_owner->p_vout->render.i_pictures;
@@ -1261,10 +1274,44 @@ static void aout_del_buffer( decoder_t *p_dec, aout_buffer_t *p_buffer )
 
 int vout_CountPictureAvailable( vout_thread_t *p_vout );
 
+static void DecoderAddPictureWait( decoder_t *p_dec, mtime_t i_wait )
+{
+    int i_bucket = 0;
+
+    for( i_wait /= 1000; i_wait > 0 && i_bucket < PICTURE_WAIT_BUCKETS - 1;
+         i_wait >>= 1 )
+        i_bucket++;
+    p_dec->p_owner->pi_picture_wait[i_bucket]++;
+}
+
+static void DecoderDumpPictureWait( decoder_t *p_dec )
+{
+    const unsigned *pi_wait = p_dec->p_owner->pi_picture_wait;
+    char psz_buckets[PICTURE_WAIT_BUCKETS * 24];
+    size_t i_len = 0;
+    unsigned i_total = 0;
+    int i;
+
+    for( i = 0; i < PICTURE_WAIT_BUCKETS; i++ )
+    {
+        i_total += pi_wait[i];
+        if( i == PICTURE_WAIT_BUCKETS - 1 )
+            i_len += snprintf( psz_buckets + i_len, sizeof(psz_buckets) - i_len,
+                               " >=%dms:%u", 1 << (i - 1), pi_wait[i] );
+        else
+            i_len += snprintf( psz_buckets + i_len, sizeof(psz_buckets) - i_len,
+                               " <%dms:%u", 1 << i, pi_wait[i] );
+    }
+    if( i_total > 0 )
+        msg_Dbg( p_dec, "waited %u times for a picture:%s", i_total,
+                 psz_buckets );
+}
+
 static picture_t *vout_new_buffer( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_sys = (decoder_owner_sys_t *)p_dec->p_owner;
     picture_t *p_pic;
+    mtime_t i_wait_start = 0;
 
     if( p_sys->p_vout == NULL ||
         p_dec->fmt_out.video.i_width != p_sys->video.i_width ||
@@ -1348,7 +1395,7 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
      */
     for( p_pic = NULL; ; )
     {
-        int i_pic, i_ready_pic;
+        int i_pic, i_ready_pic, i_available;
 
         if( p_dec->b_die || p_dec->b_error )
             return NULL;
@@ -1358,12 +1405,15 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
          * buffer once its work is done, so this check is safe even if we don't
          * lock around both count() and create().
          */
-        if( vout_CountPictureAvailable( p_sys->p_vout ) >= 2 )
+        i_available = vout_CountPictureAvailable( p_sys->p_vout );
+        if( i_available >= 2 )
         {
             p_pic = vout_CreatePicture( p_sys->p_vout, 0, 0, 0 );
             if( p_pic )
                 break;
         }
+        if( i_wait_start == 0 )
+            i_wait_start = mdate();
 
 #define p_pic p_dec->p_owner->p_vout->render.pp_picture[i_pic]
         /* Check the decoder doesn't leak pictures */
@@ -1406,9 +1456,23 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
         }
 #undef p_pic
 
-        msleep( VOUT_OUTMEM_SLEEP );
+        if( i_available >= 2 )
+        {
+            /* The picture allocation failed, do not spin */
+            msleep( VOUT_OUTMEM_SLEEP );
+        }
+        else
+        {
+            /* Wait for the vout to give a picture back to the heap, but
+             * still check from time to time whether we have to die */
+            vout_WaitPictureAvailable( p_sys->p_vout, 2,
+                                       mdate() + VOUT_OUTMEM_SLEEP );
+        }
     }
 
+    if( i_wait_start != 0 )
+        DecoderAddPictureWait( p_dec, mdate() - i_wait_start );
+
     return p_pic;
 }
 
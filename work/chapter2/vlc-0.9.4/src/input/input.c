@@ -766,6 +766,8 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( read_bytes, INTEGER, COUNTER );
         INIT_COUNTER( read_packets, INTEGER, COUNTER );
         INIT_COUNTER( demux_read, INTEGER, COUNTER );
+        INIT_COUNTER( stream_cache_hit, INTEGER, COUNTER );
+        INIT_COUNTER( stream_cache_miss, INTEGER, COUNTER );
         INIT_COUNTER( input_bitrate, FLOAT, DERIVATIVE );
         INIT_COUNTER( demux_bitrate, FLOAT, DERIVATIVE );
         INIT_COUNTER( played_abuffers, INTEGER, COUNTER );
@@ -1218,6 +1220,8 @@ error:
         EXIT_COUNTER( read_bytes );
         EXIT_COUNTER( read_packets );
         EXIT_COUNTER( demux_read );
+        EXIT_COUNTER( stream_cache_hit );
+        EXIT_COUNTER( stream_cache_miss );
         EXIT_COUNTER( input_bitrate );
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( played_abuffers );
@@ -1308,6 +1312,8 @@ static void End( input_thread_t * p_input )
             CL_CO( read_bytes );
             CL_CO( read_packets );
             CL_CO( demux_read );
+            CL_CO( stream_cache_hit );
+            CL_CO( stream_cache_miss );
             CL_CO( input_bitrate );
             CL_CO( demux_bitrate );
             CL_CO( played_abuffers );
@@ -2005,6 +2011,12 @@ static int UpdateFromAccess( input_thread_t *p_input )
         InputUpdateMeta( p_input, p_meta );
         p_access->info.i_update &= ~INPUT_UPDATE_META;
     }
+    if( p_access->info.i_update & INPUT_UPDATE_DISCONTINUITY )
+    {
+        /* Resynchronize as after a seek */
+        input_EsOutChangePosition( p_input->p->p_es_out );
+        p_access->info.i_update &= ~INPUT_UPDATE_DISCONTINUITY;
+    }
 
     p_access->info.i_update &= ~INPUT_UPDATE_SIZE;
 
@@ -127,6 +127,8 @@ struct input_thread_private_t
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
         counter_t *p_input_bitrate;
+        counter_t *p_stream_cache_hit;
+        counter_t *p_stream_cache_miss;
         counter_t *p_demux_read;
         counter_t *p_demux_bitrate;
         counter_t *p_decoded_audio;
@@ -51,16 +51,17 @@
  *      It should probably defaulted (instead of the stream method (2)).
  */
 
-/* How many tracks we have, currently only used for stream mode */
+/* Size of the buffer of the immediate method. The size of the cache of the
+ * other methods, and the number of tracks of the stream method, are set by
+ * the "stream-cache-size" and "stream-cache-tracks" options. */
 #ifdef OPTIMIZE_MEMORY
-#   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
-#   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
+#   define STREAM_CACHE_SIZE  (1024*128)
 #else
-#   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
-#   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
+#   define STREAM_CACHE_SIZE  (4*3*1024*1024)
 #endif
+/* Bounds of the stream cache options */
+#define STREAM_CACHE_TRACK_MAX 16
+#define STREAM_CACHE_TRACK_MIN_SIZE (64*1024)
 
 /* How many data we try to prebuffer */
 #define STREAM_CACHE_PREBUFFER_SIZE (32767)
@@ -81,13 +82,17 @@
  *          if close enough, read data and use this ring
  *          else use the oldest ring, seek and use it.
  *
+ *  The access is only seeked when a track needs more data: switching between
+ *  tracks whose data is already there costs nothing. i_read_size follows the
+ *  throughput of the access, unless the access has a MTU.
+ *
  *  TODO: - with access non seekable: use all space available for only one ring, but
  *          we have to support seekable/non-seekable switch on the fly.
- *        - compute a good value for i_read_size
  *        - ?
  */
 #define STREAM_READ_ATONCE 32767
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+/* Duration of data to read at once when adapting i_read_size */
+#define STREAM_READ_DURATION (20*1000)
 
 typedef struct
 {
@@ -140,7 +145,10 @@ struct stream_sys_t
     {
         int i_offset;   /* Buffer offset in the current track */
         int i_tk;       /* Current track */
-        stream_track_t tk[STREAM_CACHE_TRACK];
+        int i_tk_access;/* Track at whose end the access is, -1 if none */
+        int i_tk_count; /* Number of tracks */
+        int i_tk_size;  /* Size of each track */
+        stream_track_t *tk;
 
         /* Global buffer */
         uint8_t *p_buffer;
@@ -148,6 +156,8 @@ struct stream_sys_t
         /* */
         int i_used; /* Used since last read */
         int i_read_size;
+        bool b_read_size_fixed; /* i_read_size comes from the access MTU */
+        int64_t i_byterate;     /* Observed access throughput */
 
     } stream;
 
@@ -162,6 +172,9 @@ struct stream_sys_t
     unsigned int i_peek;
     uint8_t *p_peek;
 
+    /* Cache size for the block and stream methods */
+    int i_cache_size;
+
     /* Stat for both method */
     struct
     {
@@ -212,6 +225,7 @@ static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
 static void UStreamDestroy( stream_t *s );
 static int  ASeek( stream_t *s, int64_t i_pos );
+static void AStreamSeekStat( stream_t *s, bool b_hit );
 
 /****************************************************************************
  * Method 3 helpers:
@@ -299,6 +313,8 @@ stream_t *stream_AccessNew( access_t *p_access, bool b_quick )
     s->p_sys = p_sys = malloc( sizeof( stream_sys_t ) );
     if( p_sys == NULL )
         goto error;
+    p_sys->stream.p_buffer = NULL;
+    p_sys->stream.tk = NULL;
 
     /* UTF16 and UTF32 text file conversion */
     s->i_char_width = 1;
@@ -331,6 +347,8 @@ stream_t *stream_AccessNew( access_t *p_access, bool b_quick )
 
     p_sys->b_quick = b_quick;
 
+    p_sys->i_cache_size = var_CreateGetInteger( s, "stream-cache-size" ) * 1024;
+
     /* Get the additional list of inputs if any (for concatenation) */
     if( (psz_list = var_CreateGetString( s, "input-list" )) && *psz_list )
     {
@@ -446,30 +464,49 @@ stream_t *stream_AccessNew( access_t *p_access, bool b_quick )
         s->pf_peek = AStreamPeekStream;
 
         /* Allocate/Setup our tracks */
+        p_sys->stream.i_tk_count = var_CreateGetInteger( s,
+                                                   "stream-cache-tracks" );
+        if( p_sys->stream.i_tk_count < 1 )
+            p_sys->stream.i_tk_count = 1;
+        else if( p_sys->stream.i_tk_count > STREAM_CACHE_TRACK_MAX )
+            p_sys->stream.i_tk_count = STREAM_CACHE_TRACK_MAX;
+        p_sys->stream.i_tk_size = __MAX( p_sys->i_cache_size
+                                         / p_sys->stream.i_tk_count,
+                                         STREAM_CACHE_TRACK_MIN_SIZE );
+
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
-        p_sys->stream.p_buffer = malloc( STREAM_CACHE_SIZE );
-        if( p_sys->stream.p_buffer == NULL )
+        p_sys->stream.i_tk_access = 0;
+        p_sys->stream.tk = calloc( p_sys->stream.i_tk_count,
+                                   sizeof( stream_track_t ) );
+        p_sys->stream.p_buffer = malloc( p_sys->stream.i_tk_count *
+                                         p_sys->stream.i_tk_size );
+        if( p_sys->stream.tk == NULL || p_sys->stream.p_buffer == NULL )
         {
             msg_Err( s, "Out of memory when allocating stream cache (%d bytes)",
-                        STREAM_CACHE_SIZE );
+                        p_sys->stream.i_tk_count * p_sys->stream.i_tk_size );
             goto error;
         }
+        msg_Dbg( s, "stream cache of %d tracks of %d bytes",
+                 p_sys->stream.i_tk_count, p_sys->stream.i_tk_size );
+
         p_sys->stream.i_used   = 0;
+        p_sys->stream.i_byterate = 0;
         access_Control( p_access, ACCESS_GET_MTU,
                          &p_sys->stream.i_read_size );
+        p_sys->stream.b_read_size_fixed = p_sys->stream.i_read_size > 0;
         if( p_sys->stream.i_read_size <= 0 )
             p_sys->stream.i_read_size = STREAM_READ_ATONCE;
         else if( p_sys->stream.i_read_size <= 256 )
             p_sys->stream.i_read_size = 256;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
             p_sys->stream.tk[i].i_end   = p_sys->i_pos;
             p_sys->stream.tk[i].p_buffer=
-                &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
+                &p_sys->stream.p_buffer[i * p_sys->stream.i_tk_size];
         }
 
         /* Do the prebuffering */
@@ -492,6 +529,7 @@ error:
     else
     {
         free( p_sys->stream.p_buffer );
+        free( p_sys->stream.tk );
     }
     while( p_sys->i_list > 0 )
         free( p_sys->list[--(p_sys->i_list)] );
@@ -514,7 +552,11 @@ static void AStreamDestroy( stream_t *s )
 
     if( p_sys->method == Block ) block_ChainRelease( p_sys->block.p_first );
     else if ( p_sys->method == Immediate ) free( p_sys->immediate.p_buffer );
-    else free( p_sys->stream.p_buffer );
+    else
+    {
+        free( p_sys->stream.p_buffer );
+        free( p_sys->stream.tk );
+    }
 
     free( p_sys->p_peek );
 
@@ -575,9 +617,10 @@ void stream_AccessReset( stream_t *s )
         /* Setup our tracks */
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
+        p_sys->stream.i_tk_access = 0;
         p_sys->stream.i_used   = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
@@ -666,7 +709,9 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
             i_int = (int) va_arg( args, int );
             if( i_int != ACCESS_SET_PRIVATE_ID_STATE &&
                 i_int != ACCESS_SET_PRIVATE_ID_CA &&
-                i_int != ACCESS_GET_PRIVATE_ID_STATE )
+                i_int != ACCESS_GET_PRIVATE_ID_STATE &&
+                i_int != ACCESS_GET_TIMESHIFT_WINDOW &&
+                i_int != ACCESS_GET_TIMESHIFT_POS )
             {
                 msg_Err( s, "Hey, what are you thinking ?"
                             "DON'T USE STREAM_CONTROL_ACCESS !!!" );
@@ -916,6 +961,7 @@ static int AStreamSeekBlock( stream_t *s, int64_t i_pos )
 
         p_sys->i_pos = i_pos;
 
+        AStreamSeekStat( s, true );
         return VLC_SUCCESS;
     }
 
@@ -957,7 +1003,7 @@ static int AStreamSeekBlock( stream_t *s, int64_t i_pos )
             int i_th = b_aseekfast ? 1 : 5;
 
             if( i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE )
+                i_skip < p_sys->i_cache_size )
                 b_seek = false;
             else
                 b_seek = true;
@@ -967,6 +1013,7 @@ static int AStreamSeekBlock( stream_t *s, int64_t i_pos )
         }
     }
 
+    AStreamSeekStat( s, !b_seek );
     if( b_seek )
     {
         int64_t i_start, i_end;
@@ -1029,7 +1076,7 @@ static int AStreamRefillBlock( stream_t *s )
     block_t      *b;
 
     /* Release data */
-    while( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    while( p_sys->block.i_size >= p_sys->i_cache_size &&
            p_sys->block.p_first != p_sys->block.p_current )
     {
         block_t *b = p_sys->block.p_first;
@@ -1040,7 +1087,7 @@ static int AStreamRefillBlock( stream_t *s )
 
         block_Release( b );
     }
-    if( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    if( p_sys->block.i_size >= p_sys->i_cache_size &&
         p_sys->block.p_current == p_sys->block.p_first &&
         p_sys->block.p_current->p_next )    /* At least 2 packets */
     {
@@ -1131,10 +1178,10 @@ static int AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read )
     while( i_data < i_read )
     {
         int i_off = (tk->i_start + p_sys->stream.i_offset) %
-                    STREAM_CACHE_TRACK_SIZE;
+                    p_sys->stream.i_tk_size;
         unsigned int i_current =
             __MAX(0,__MIN( tk->i_end - tk->i_start - p_sys->stream.i_offset,
-                   STREAM_CACHE_TRACK_SIZE - i_off ));
+                   p_sys->stream.i_tk_size - i_off ));
         int i_copy = __MIN( i_current, i_read - i_data );
 
         if( i_copy <= 0 ) break; /* EOF */
@@ -1184,8 +1231,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
 #endif
 
     /* Avoid problem, but that should *never* happen */
-    if( i_read > STREAM_CACHE_TRACK_SIZE / 2 )
-        i_read = STREAM_CACHE_TRACK_SIZE / 2;
+    if( i_read > (unsigned)p_sys->stream.i_tk_size / 2 )
+        i_read = p_sys->stream.i_tk_size / 2;
 
     while( tk->i_end - tk->i_start - p_sys->stream.i_offset < i_read )
     {
@@ -1202,8 +1249,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
         i_read = tk->i_end - tk->i_start - p_sys->stream.i_offset;
 
     /* Now, direct pointer or a copy ? */
-    i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
-    if( i_off + i_read <= STREAM_CACHE_TRACK_SIZE )
+    i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
+    if( i_off + i_read <= p_sys->stream.i_tk_size )
     {
         *pp_peek = &tk->p_buffer[i_off];
         return i_read;
@@ -1221,20 +1268,61 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     memcpy( p_sys->p_peek, &tk->p_buffer[i_off],
-            STREAM_CACHE_TRACK_SIZE - i_off );
-    memcpy( &p_sys->p_peek[STREAM_CACHE_TRACK_SIZE - i_off],
-            &tk->p_buffer[0], i_read - (STREAM_CACHE_TRACK_SIZE - i_off) );
+            p_sys->stream.i_tk_size - i_off );
+    memcpy( &p_sys->p_peek[p_sys->stream.i_tk_size - i_off],
+            &tk->p_buffer[0], i_read - (p_sys->stream.i_tk_size - i_off) );
 
     *pp_peek = p_sys->p_peek;
     return i_read;
 }
 
-static int AStreamSeekStream( stream_t *s, int64_t i_pos )
+/* Seeks the access, which will then feed the track i_tk */
+static int AStreamSeekAccess( stream_t *s, int64_t i_pos, int i_tk )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int64_t i_start = mdate();
+
+    if( ASeek( s, i_pos ) )
+    {
+        p_sys->stream.i_tk_access = -1;
+        return VLC_EGENERIC;
+    }
+    p_sys->stream.i_tk_access = i_tk;
+
+    p_sys->stat.i_seek_time += mdate() - i_start;
+    p_sys->stat.i_seek_count++;
+    return VLC_SUCCESS;
+}
+
+/* Distance up to which reading forward is cheaper than seeking */
+static int AStreamSkipThreshold( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int64_t i_th = __MIN( p_sys->stream.i_read_size, STREAM_READ_ATONCE / 2 );
+
+    if( !p_sys->stat.b_fastseek )
+        i_th *= 3;
+
+    /* What could have been read during an average seek */
+    if( p_sys->stat.i_seek_count > 0 )
+    {
+        int64_t i_cost = p_sys->stream.i_byterate *
+            ( p_sys->stat.i_seek_time / p_sys->stat.i_seek_count ) /
+            INT64_C(1000000);
+        if( i_cost > i_th )
+            i_th = i_cost;
+    }
+    if( i_th > p_sys->stream.i_tk_size / 2 )
+        i_th = p_sys->stream.i_tk_size / 2;
+    return i_th;
+}
+
+static int AStreamSeekTrack( stream_t *s, int64_t i_pos )
 {
     stream_sys_t *p_sys = s->p_sys;
     access_t     *p_access = p_sys->p_access;
+    stream_track_t *tk;
     bool   b_aseek;
-    bool   b_afastseek;
     int i_maxth;
     int i_new;
     int i;
@@ -1253,7 +1341,7 @@ static int AStreamSeekStream( stream_t *s, int64_t i_pos )
     if( i_pos >= p_sys->stream.tk[p_sys->stream.i_tk].i_start &&
         i_pos < p_sys->stream.tk[p_sys->stream.i_tk].i_end )
     {
-        stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk];
+        tk = &p_sys->stream.tk[p_sys->stream.i_tk];
 #ifdef STREAM_DEBUG
         msg_Dbg( s, "AStreamSeekStream: current track" );
 #endif
@@ -1289,9 +1377,9 @@ static int AStreamSeekStream( stream_t *s, int64_t i_pos )
     p_sys->stream.tk[p_sys->stream.i_tk].i_date = mdate();
 
     /* Try to reuse already read data */
-    for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+    for( i = 0; i < p_sys->stream.i_tk_count; i++ )
     {
-        stream_track_t *tk = &p_sys->stream.tk[i];
+        tk = &p_sys->stream.tk[i];
 
         if( i_pos >= tk->i_start && i_pos <= tk->i_end )
         {
@@ -1300,10 +1388,8 @@ static int AStreamSeekStream( stream_t *s, int64_t i_pos )
                      " end=%"PRId64, i, tk->i_start, tk->i_end );
 #endif
 
-            /* Seek at the end of the buffer */
-            if( ASeek( s, tk->i_end ) ) return VLC_EGENERIC;
-
-            /* That's it */
+            /* That's it, the access will be seeked at the end of the
+             * buffer when more data is needed */
             p_sys->i_pos = i_pos;
             p_sys->stream.i_tk = i;
             p_sys->stream.i_offset = i_pos - tk->i_start;
@@ -1311,48 +1397,55 @@ static int AStreamSeekStream( stream_t *s, int64_t i_pos )
             if( p_sys->stream.i_used < 1024 )
                 p_sys->stream.i_used = 1024;
 
-            if( AStreamRefillStream( s ) && i_pos == tk->i_end )
+            if( i_pos == tk->i_end && AStreamRefillStream( s ) )
                 return VLC_EGENERIC;
 
             return VLC_SUCCESS;
         }
     }
 
-    access_Control( p_access, ACCESS_CAN_SEEK, &b_afastseek );
-    /* FIXME compute seek cost (instead of static 'stupid' value) */
-    i_maxth = __MIN( p_sys->stream.i_read_size, STREAM_READ_ATONCE / 2 );
-    if( !b_afastseek )
-        i_maxth *= 3;
-
-    /* FIXME TODO */
-#if 0
-    /* Search closest segment TODO */
-    for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+    /* A bit after the data of the track the access is reading: read the
+     * data in between rather than seeking */
+    i_maxth = AStreamSkipThreshold( s );
+    if( p_sys->stream.i_tk_access >= 0 )
     {
-        stream_track_t *tk = &p_sys->stream.tk[i];
+        tk = &p_sys->stream.tk[p_sys->stream.i_tk_access];
 
-        if( i_pos + i_maxth >= tk->i_start )
-        {
-            msg_Dbg( s, "good segment before current pos, TODO" );
-        }
-        if( i_pos - i_maxth <= tk->i_end )
+        if( i_pos > tk->i_end && i_pos - tk->i_end <= i_maxth )
         {
-            msg_Dbg( s, "good segment after current pos, TODO" );
+#ifdef STREAM_DEBUG
+            msg_Dbg( s, "AStreamSeekStream: skipping %"PRId64" bytes in %d",
+                     i_pos - tk->i_end, p_sys->stream.i_tk_access );
+#endif
+            p_sys->stream.i_tk = p_sys->stream.i_tk_access;
+            while( tk->i_end <= i_pos )
+            {
+                p_sys->i_pos = tk->i_end;
+                p_sys->stream.i_offset = tk->i_end - tk->i_start;
+                if( p_sys->stream.i_used < i_pos - tk->i_end +
+                                           STREAM_READ_ATONCE / 2 )
+                    p_sys->stream.i_used = i_pos - tk->i_end +
+                                           STREAM_READ_ATONCE / 2;
+                if( AStreamRefillStream( s ) )
+                    return VLC_EGENERIC;
+            }
+            p_sys->i_pos = i_pos;
+            p_sys->stream.i_offset = i_pos - tk->i_start;
+            return VLC_SUCCESS;
         }
     }
-#endif
-
-    /* Nothing good, seek and choose oldest segment */
-    if( ASeek( s, i_pos ) ) return VLC_EGENERIC;
-    p_sys->i_pos = i_pos;
 
+    /* Nothing good, choose the least recently used track, and seek */
     i_new = 0;
-    for( i = 1; i < STREAM_CACHE_TRACK; i++ )
+    for( i = 1; i < p_sys->stream.i_tk_count; i++ )
     {
         if( p_sys->stream.tk[i].i_date < p_sys->stream.tk[i_new].i_date )
             i_new = i;
     }
 
+    if( AStreamSeekAccess( s, i_pos, i_new ) ) return VLC_EGENERIC;
+    p_sys->i_pos = i_pos;
+
     /* Reset the segment */
     p_sys->stream.i_tk     = i_new;
     p_sys->stream.i_offset =  0;
@@ -1369,6 +1462,43 @@ static int AStreamSeekStream( stream_t *s, int64_t i_pos )
     return VLC_SUCCESS;
 }
 
+static int AStreamSeekStream( stream_t *s, int64_t i_pos )
+{
+    int i_seek_count = s->p_sys->stat.i_seek_count;
+    int i_ret = AStreamSeekTrack( s, i_pos );
+
+    /* A hit is a seek served without seeking the access */
+    AStreamSeekStat( s, i_ret == VLC_SUCCESS &&
+                        s->p_sys->stat.i_seek_count == i_seek_count );
+    return i_ret;
+}
+
+/* Reads STREAM_READ_DURATION worth of data at once, at the observed speed */
+static void AStreamAdaptReadSize( stream_t *s, int i_read, int64_t i_time )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int64_t i_byterate, i_size;
+
+    /* Small reads are dominated by the call overhead */
+    if( i_read < 4096 )
+        return;
+
+    i_byterate = INT64_C(1000000) * i_read / (i_time + 1);
+    if( p_sys->stream.i_byterate > 0 )
+        i_byterate = ( 3 * p_sys->stream.i_byterate + i_byterate ) / 4;
+    p_sys->stream.i_byterate = i_byterate;
+
+    if( p_sys->stream.b_read_size_fixed )
+        return;
+
+    i_size = i_byterate * STREAM_READ_DURATION / INT64_C(1000000);
+    if( i_size > p_sys->stream.i_tk_size / 4 )
+        i_size = p_sys->stream.i_tk_size / 4;
+    if( i_size < STREAM_READ_ATONCE )
+        i_size = STREAM_READ_ATONCE;
+    p_sys->stream.i_read_size = i_size;
+}
+
 static int AStreamRefillStream( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1376,9 +1506,10 @@ static int AStreamRefillStream( stream_t *s )
 
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN( p_sys->stream.i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN( p_sys->stream.i_used, p_sys->stream.i_tk_size -
                (tk->i_end - tk->i_start - p_sys->stream.i_offset) );
     bool b_read = false;
+    int i_total = 0;
     int64_t i_start, i_stop;
 
     if( i_toread <= 0 ) return VLC_EGENERIC; /* EOF */
@@ -1388,16 +1519,21 @@ static int AStreamRefillStream( stream_t *s )
                  p_sys->stream.i_used, i_toread );
 #endif
 
+    /* The access is still where another track left it */
+    if( p_sys->stream.i_tk_access != p_sys->stream.i_tk &&
+        AStreamSeekAccess( s, tk->i_end, p_sys->stream.i_tk ) )
+        return VLC_EGENERIC;
+
     i_start = mdate();
     while( i_toread > 0 )
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % p_sys->stream.i_tk_size;
         int i_read;
 
         if( s->b_die )
             return VLC_EGENERIC;
 
-        i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
+        i_read = __MIN( i_toread, p_sys->stream.i_tk_size - i_off );
         i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
@@ -1416,16 +1552,17 @@ static int AStreamRefillStream( stream_t *s )
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if( tk->i_end - tk->i_start > STREAM_CACHE_TRACK_SIZE )
+        /* Windows of p_sys->stream.i_tk_size */
+        if( tk->i_end - tk->i_start > p_sys->stream.i_tk_size )
         {
-            int i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            int i_invalid = tk->i_end - tk->i_start - p_sys->stream.i_tk_size;
 
             tk->i_start += i_invalid;
             p_sys->stream.i_offset -= i_invalid;
         }
 
         i_toread -= i_read;
+        i_total += i_read;
         p_sys->stream.i_used -= i_read;
 
         p_sys->stat.i_bytes += i_read;
@@ -1434,6 +1571,7 @@ static int AStreamRefillStream( stream_t *s )
     i_stop = mdate();
 
     p_sys->stat.i_read_time += i_stop - i_start;
+    AStreamAdaptReadSize( s, i_total, i_stop - i_start );
 
     return VLC_SUCCESS;
 }
@@ -1445,9 +1583,9 @@ static void AStreamPrebufferStream( stream_t *s )
 
     int64_t i_first = 0;
     int64_t i_start;
-    int64_t i_prebuffer = p_sys->b_quick ? STREAM_CACHE_TRACK_SIZE /100 :
+    int64_t i_prebuffer = p_sys->b_quick ? p_sys->stream.i_tk_size /100 :
         ( (p_access->info.i_title > 1 || p_access->info.i_seekpoint > 1) ?
-          STREAM_CACHE_PREBUFFER_SIZE : STREAM_CACHE_TRACK_SIZE / 3 );
+          STREAM_CACHE_PREBUFFER_SIZE : p_sys->stream.i_tk_size / 3 );
 
     msg_Dbg( s, "pre-buffering..." );
     i_start = mdate();
@@ -1478,7 +1616,7 @@ static void AStreamPrebufferStream( stream_t *s )
         }
 
         /* */
-        i_read = STREAM_CACHE_TRACK_SIZE - tk->i_end;
+        i_read = p_sys->stream.i_tk_size - tk->i_end;
         i_read = __MIN( p_sys->stream.i_read_size, i_read );
         i_read = AReadStream( s, &tk->p_buffer[tk->i_end], i_read );
         if( i_read <  0 )
@@ -2053,6 +2191,25 @@ static int ASeek( stream_t *s, int64_t i_pos )
     return p_access->pf_seek( p_access, i_pos );
 }
 
+/* Counts the seeks served from the cache and those hitting the access */
+static void AStreamSeekStat( stream_t *s, bool b_hit )
+{
+    input_thread_t *p_input = NULL;
+
+    if( s->p_parent && s->p_parent->p_parent &&
+        s->p_parent->p_parent->i_object_type == VLC_OBJECT_INPUT )
+        p_input = (input_thread_t *)s->p_parent->p_parent;
+
+    if( !p_input || !libvlc_stats( s ) )
+        return;
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    stats_UpdateInteger( s, b_hit ? p_input->p->counters.p_stream_cache_hit
+                                  : p_input->p->counters.p_stream_cache_miss,
+                         1, NULL );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
 
 /**
  * Try to read "i_read" bytes into a buffer pointed by "p_read".  If
@@ -446,6 +446,12 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort" \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads sharing the work of the video filters and chroma " \
+    "converters that can process a picture in slices. " \
+    "0 means one thread per CPU.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -526,6 +532,12 @@ static const char *const ppsz_pos_descriptions[] =
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define VOUT_PICTURES_TEXT N_("Video buffers")
+#define VOUT_PICTURES_LONGTEXT N_( \
+    "Number of decoded pictures the video output can hold, on top of the " \
+    "reference pictures kept by some decoders. Higher values make the " \
+    "playback more tolerant to decoding hiccups, at the expense of memory.")
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -946,6 +958,16 @@ static const char *const ppsz_clock_descriptions[] =
     "If your processor supports the SSE2 instructions set, VLC can take " \
     "advantage of them.")
 
+#define SSSE3_TEXT N_("Enable CPU SSSE3 support")
+#define SSSE3_LONGTEXT N_( \
+    "If your processor supports the SSSE3 instructions set, VLC can take " \
+    "advantage of them.")
+
+#define AVX2_TEXT N_("Enable CPU AVX2 support")
+#define AVX2_LONGTEXT N_( \
+    "If your processor supports the AVX2 instructions set, VLC can take " \
+    "advantage of them.")
+
 #define ALTIVEC_TEXT N_("Enable CPU AltiVec support")
 #define ALTIVEC_LONGTEXT N_( \
     "If your processor supports the AltiVec instructions set, VLC can take " \
@@ -1002,6 +1024,17 @@ static const char *const ppsz_clock_descriptions[] =
      "This option is useful if you want to lower the latency when " \
      "reading a stream")
 
+#define STREAM_CACHE_SIZE_TEXT N_("Stream cache size (kB)")
+#define STREAM_CACHE_SIZE_LONGTEXT N_( \
+     "Amount of memory used to cache the data read from seekable " \
+     "inputs, in kilobytes.")
+
+#define STREAM_CACHE_TRACKS_TEXT N_("Stream cache tracks")
+#define STREAM_CACHE_TRACKS_LONGTEXT N_( \
+     "Number of places of an input the stream cache keeps data from. " \
+     "Demuxers reading interleaved data from distant places of a file " \
+     "need more tracks to avoid seeking back and forth.")
+
 #define AUTO_ADJUST_PTS_DELAY N_("(Experimental) Minimize latency when" \
      "reading live stream.")
 #define AUTO_ADJUST_PTS_DELAY_LONGTEXT N_( \
@@ -1501,6 +1534,9 @@ vlc_module_begin();
               SKIP_FRAMES_LONGTEXT, true );
     add_bool( "quiet-synchro", 0, NULL, QUIET_SYNCHRO_TEXT,
               QUIET_SYNCHRO_LONGTEXT, true );
+    add_integer_with_range( "vout-pictures", VOUT_MAX_PICTURES,
+                            VOUT_MAX_PICTURES, 64, NULL, VOUT_PICTURES_TEXT,
+                            VOUT_PICTURES_LONGTEXT, true );
 #ifndef __APPLE__
     add_bool( "overlay", 1, NULL, OVERLAY_TEXT, OVERLAY_LONGTEXT, false );
 #endif
@@ -1578,6 +1614,9 @@ vlc_module_begin();
        add_deprecated_alias( "filter" ); /*deprecated since 0.8.2 */
     add_module_list_cat( "vout-filter", SUBCAT_VIDEO_VFILTER, NULL, NULL,
                         VOUT_FILTER_TEXT, VOUT_FILTER_LONGTEXT, false );
+    add_integer_with_range( "filter-threads", 0, 0, 64, NULL,
+                            FILTER_THREADS_TEXT, FILTER_THREADS_LONGTEXT,
+                            true );
 #if 0
     add_string( "pixel-ratio", "1", NULL, PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT );
 #endif
@@ -1823,6 +1862,10 @@ vlc_module_begin();
         change_need_restart();
     add_bool( "sse2", 1, NULL, SSE2_TEXT, SSE2_LONGTEXT, true );
         change_need_restart();
+    add_bool( "ssse3", 1, NULL, SSSE3_TEXT, SSSE3_LONGTEXT, true );
+        change_need_restart();
+    add_bool( "avx2", 1, NULL, AVX2_TEXT, AVX2_LONGTEXT, true );
+        change_need_restart();
 #endif
 #if defined( __powerpc__ ) || defined( __ppc__ ) || defined( __ppc64__ )
     add_bool( "altivec", 1, NULL, ALTIVEC_TEXT, ALTIVEC_LONGTEXT, true );
@@ -1854,6 +1897,25 @@ vlc_module_begin();
     add_bool( "use-stream-immediate", false, NULL,
                USE_STREAM_IMMEDIATE, USE_STREAM_IMMEDIATE_LONGTEXT, true );
 
+#ifdef OPTIMIZE_MEMORY
+    add_integer( "stream-cache-size", 128, NULL, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true );
+#else
+    add_integer( "stream-cache-size", 12288, NULL, STREAM_CACHE_SIZE_TEXT,
+                 STREAM_CACHE_SIZE_LONGTEXT, true );
+#endif
+        change_safe();
+#ifdef OPTIMIZE_MEMORY
+    add_integer_with_range( "stream-cache-tracks", 1, 1, 16, NULL,
+                            STREAM_CACHE_TRACKS_TEXT,
+                            STREAM_CACHE_TRACKS_LONGTEXT, true );
+#else
+    add_integer_with_range( "stream-cache-tracks", 3, 1, 16, NULL,
+                            STREAM_CACHE_TRACKS_TEXT,
+                            STREAM_CACHE_TRACKS_LONGTEXT, true );
+#endif
+        change_safe();
+
     add_bool( "auto-adjust-pts-delay", false, NULL,
               AUTO_ADJUST_PTS_DELAY, AUTO_ADJUST_PTS_DELAY_LONGTEXT, true );
 
@@ -39,10 +39,21 @@
 struct block_sys_t
 {
     block_t     self;
+    unsigned    i_refs;     /* blocks using the payload, see block_Share() */
+#ifndef NDEBUG
+    uint32_t    i_checksum; /* of the payload while it is shared */
+#endif
     size_t      i_allocated_buffer;
     uint8_t     p_allocated_buffer[];
 };
 
+/* A block sharing the payload of a block_Alloc() block */
+typedef struct
+{
+    block_t      self;
+    block_sys_t *p_owner;
+} block_shared_t;
+
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
 {
@@ -65,9 +76,76 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
+#if !defined( __GNUC__ ) && defined( LIBVLC_USE_PTHREAD )
+static pthread_mutex_t refs_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static unsigned BlockRefAdd( block_sys_t *p_sys, int i_delta )
+{
+#if defined( __GNUC__ )
+    return __sync_add_and_fetch( &p_sys->i_refs, i_delta );
+#else
+    unsigned i_refs;
+
+    pthread_mutex_lock( &refs_lock );
+    i_refs = p_sys->i_refs += i_delta;
+    pthread_mutex_unlock( &refs_lock );
+    return i_refs;
+#endif
+}
+
+#ifndef NDEBUG
+/* Nobody may write to a shared payload: check it did not change */
+static uint32_t BlockChecksum( const block_sys_t *p_sys )
+{
+    uint32_t i_sum = 2166136261u;
+
+    for( size_t i = 0; i < p_sys->i_allocated_buffer; i++ )
+        i_sum = ( i_sum ^ p_sys->p_allocated_buffer[i] ) * 16777619u;
+    return i_sum;
+}
+
+static void BlockCheckShared( const block_sys_t *p_sys )
+{
+    if( p_sys->i_refs > 1 && BlockChecksum( p_sys ) != p_sys->i_checksum )
+    {
+        fprintf( stderr, "block %p: shared payload was modified! "
+                 "This is a bug!\n", p_sys );
+        abort();
+    }
+}
+#else
+#   define BlockCheckShared( p_sys ) (void)0
+#endif
+
+static void BlockUnref( block_sys_t *p_sys )
+{
+    BlockCheckShared( p_sys );
+    if( BlockRefAdd( p_sys, -1 ) == 0 )
+        free( p_sys );
+}
+
 static void BlockRelease( block_t *p_block )
 {
-    free( p_block );
+    BlockUnref( (block_sys_t *)p_block );
+}
+
+static void BlockSharedRelease( block_t *p_block )
+{
+    block_shared_t *p_shared = (block_shared_t *)p_block;
+
+    BlockUnref( p_shared->p_owner );
+    free( p_shared );
+}
+
+/* Returns the block owning the payload of p_block, if any */
+static block_sys_t *BlockOwner( block_t *p_block )
+{
+    if( p_block->pf_release == BlockRelease )
+        return (block_sys_t *)p_block;
+    if( p_block->pf_release == BlockSharedRelease )
+        return ((block_shared_t *)p_block)->p_owner;
+    return NULL;
 }
 
 /* Memory alignment */
@@ -93,6 +171,7 @@ block_t *block_Alloc( size_t i_size )
 
     /* Fill opaque data */
     p_sys->i_allocated_buffer = i_alloc;
+    p_sys->i_refs = 1;
 
     block_Init( &p_sys->self, p_sys->p_allocated_buffer + BLOCK_PADDING_SIZE
                 + BLOCK_ALIGN
@@ -114,9 +193,10 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
         return NULL;
     }
 
-    if( p_block->pf_release != BlockRelease )
+    if( p_block->pf_release != BlockRelease || p_sys->i_refs > 1 )
     {
-        /* Special case when pf_release if overloaded
+        /* Special case when pf_release if overloaded, or when the payload
+         * is shared: work on a private copy
          * TODO if used one day, then implement it in a smarter way */
         block_t *p_dup = block_Duplicate( p_block );
         block_Release( p_block );
@@ -189,6 +269,66 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     return p_block;
 }
 
+/**
+ * Creates a block sharing the payload of another one, without copying it.
+ * Both blocks have their own header (buffer pointer and size, timestamps,
+ * chaining), but none of them may modify the payload anymore: call
+ * block_Unshare() before writing to it. block_Realloc() does it by itself.
+ * Blocks not allocated by block_Alloc() are duplicated.
+ *
+ * @return the new block, or NULL on error
+ */
+block_t *block_Share( block_t *p_block )
+{
+    block_sys_t *p_owner = BlockOwner( p_block );
+    block_shared_t *p_shared;
+
+    if( p_owner == NULL )
+        return block_Duplicate( p_block );
+
+    p_shared = malloc( sizeof( *p_shared ) );
+    if( p_shared == NULL )
+        return NULL;
+
+    block_Init( &p_shared->self, p_block->p_buffer, p_block->i_buffer );
+    p_shared->self.i_dts     = p_block->i_dts;
+    p_shared->self.i_pts     = p_block->i_pts;
+    p_shared->self.i_flags   = p_block->i_flags;
+    p_shared->self.i_length  = p_block->i_length;
+    p_shared->self.i_rate    = p_block->i_rate;
+    p_shared->self.i_samples = p_block->i_samples;
+    p_shared->self.pf_release = BlockSharedRelease;
+    p_shared->p_owner = p_owner;
+
+#ifndef NDEBUG
+    if( p_owner->i_refs == 1 )
+        p_owner->i_checksum = BlockChecksum( p_owner );
+    else
+        BlockCheckShared( p_owner );
+#endif
+    BlockRefAdd( p_owner, 1 );
+    return &p_shared->self;
+}
+
+/**
+ * Makes the payload of a block writable. If it is shared with other
+ * blocks (see block_Share()), the block is replaced with a private copy.
+ *
+ * @return the writable block, or NULL on error (p_block is then released)
+ */
+block_t *block_Unshare( block_t *p_block )
+{
+    block_sys_t *p_owner = BlockOwner( p_block );
+    block_t *p_dup;
+
+    if( p_owner == NULL || p_owner->i_refs == 1 )
+        return p_block;
+
+    p_dup = block_Duplicate( p_block );
+    block_Release( p_block );
+    return p_dup;
+}
+
 #ifdef HAVE_MMAP
 # include <sys/mman.h>
 
@@ -335,6 +475,135 @@ block_t *block_File (int fd)
     return block;
 }
 
+/*****************************************************************************
+ * Start code search
+ *****************************************************************************/
+static const uint8_t *StartcodeFindC( const uint8_t *p,
+                                      const uint8_t *p_end )
+{
+    /* A start code beginning in p[0..3] has a zero byte in p[0..3], so
+     * words without any zero byte can be skipped as a whole. */
+    for( ; p_end - p >= 6; p += 4 )
+    {
+        uint32_t x;
+
+        memcpy( &x, p, 4 );
+        if( !( ( x - 0x01010101 ) & ~x & 0x80808080 ) )
+            continue;
+
+        if( !p[1] )
+        {
+            if( !p[0] && p[2] == 1 )
+                return p;
+            if( !p[2] && p[3] == 1 )
+                return p + 1;
+        }
+        if( !p[3] )
+        {
+            if( !p[2] && p[4] == 1 )
+                return p + 2;
+            if( !p[4] && p[5] == 1 )
+                return p + 3;
+        }
+    }
+
+    for( ; p_end - p >= 3; p++ )
+    {
+        if( !p[0] && !p[1] && p[2] == 1 )
+            return p;
+    }
+    return NULL;
+}
+
+#ifdef CAN_COMPILE_SSE2
+static const uint8_t *StartcodeFindSSE2( const uint8_t *p,
+                                         const uint8_t *p_end )
+{
+    /* Each step tests the 16 positions p[0..15], reading p[0..17] */
+    for( ; p_end - p >= 18; p += 16 )
+    {
+        unsigned i_mask;
+
+        __asm__ __volatile__ (
+            "pxor    %%xmm2, %%xmm2\n"
+            "movdqu    (%1), %%xmm0\n"
+            "movdqu   1(%1), %%xmm1\n"
+            "pcmpeqb %%xmm2, %%xmm0\n"
+            "pcmpeqb %%xmm2, %%xmm1\n"
+            "pand    %%xmm1, %%xmm0\n"
+            "pmovmskb %%xmm0, %0\n"
+            : "=r" ( i_mask ) : "r" ( p ) : "xmm0", "xmm1", "xmm2" );
+
+        while( i_mask )
+        {
+            int i = __builtin_ctz( i_mask );
+
+            if( p[i + 2] == 1 )
+                return p + i;
+            i_mask &= i_mask - 1;
+        }
+    }
+    return StartcodeFindC( p, p_end );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+static const uint8_t *StartcodeFindAVX2( const uint8_t *p,
+                                         const uint8_t *p_end )
+{
+    const uint8_t *p_found = NULL;
+
+    /* Each step tests the 32 positions p[0..31], reading p[0..33] */
+    for( ; p_end - p >= 34; p += 32 )
+    {
+        unsigned i_mask;
+
+        __asm__ __volatile__ (
+            "vpxor    %%ymm2, %%ymm2, %%ymm2\n"
+            "vpcmpeqb    (%1), %%ymm2, %%ymm0\n"
+            "vpcmpeqb   1(%1), %%ymm2, %%ymm1\n"
+            "vpand    %%ymm1, %%ymm0, %%ymm0\n"
+            "vpmovmskb %%ymm0, %0\n"
+            : "=r" ( i_mask ) : "r" ( p ) : "xmm0", "xmm1", "xmm2" );
+
+        while( i_mask )
+        {
+            int i = __builtin_ctz( i_mask );
+
+            if( p[i + 2] == 1 )
+            {
+                p_found = p + i;
+                break;
+            }
+            i_mask &= i_mask - 1;
+        }
+        if( p_found )
+            break;
+    }
+    __asm__ __volatile__ ( "vzeroupper\n" );
+
+    return p_found ? p_found : StartcodeFindC( p, p_end );
+}
+#endif
+
+/**
+ * Finds the first 00 00 01 start code lying entirely in [p, p_end).
+ *
+ * @return a pointer to the start code, or NULL if there is none.
+ */
+const uint8_t *block_StartcodeFind( const uint8_t *p, const uint8_t *p_end )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU() & CPU_CAPABILITY_AVX2 )
+        return StartcodeFindAVX2( p, p_end );
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+        return StartcodeFindSSE2( p, p_end );
+#endif
+    return StartcodeFindC( p, p_end );
+}
+
 /*****************************************************************************
  * block_fifo_t management
  *****************************************************************************/
@@ -86,6 +86,7 @@ uint32_t CPUCapabilities( void )
 #elif defined( __i386__ ) || defined( __x86_64__ )
     volatile unsigned int  i_eax, i_ebx, i_ecx, i_edx;
     volatile bool    b_amd;
+    unsigned int     i_max;
 
     /* Needed for x86 CPU capabilities detection */
 #   if defined( __x86_64__ )
@@ -96,7 +97,8 @@ uint32_t CPUCapabilities( void )
                            "=b" ( i_ebx ),     \
                            "=c" ( i_ecx ),     \
                            "=d" ( i_edx )      \
-                         : "a"  ( reg )        \
+                         : "a"  ( reg ),       \
+                           "c"  ( 0 )          \
                          : "cc" );
 #   else
 #       define cpuid( reg )                    \
@@ -108,7 +110,8 @@ uint32_t CPUCapabilities( void )
                            "=r" ( i_ebx ),     \
                            "=c" ( i_ecx ),     \
                            "=d" ( i_edx )      \
-                         : "a"  ( reg )        \
+                         : "a"  ( reg ),       \
+                           "c"  ( 0 )          \
                          : "cc" );
 #   endif
 
@@ -153,6 +156,7 @@ uint32_t CPUCapabilities( void )
 
     /* the CPU supports the CPUID instruction - get its level */
     cpuid( 0x00000000 );
+    i_max = i_eax;
 
     if( !i_eax )
     {
@@ -226,6 +230,35 @@ uint32_t CPUCapabilities( void )
 #   endif
     }
 
+#   if defined(CAN_COMPILE_SSSE3)
+    if( ( i_capabilities & CPU_CAPABILITY_SSE2 ) && ( i_ecx & 0x00000200 ) )
+    {
+        i_capabilities |= CPU_CAPABILITY_SSSE3;
+    }
+#   endif
+
+#   if defined(CAN_COMPILE_AVX2)
+    /* AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0) */
+    if( ( i_capabilities & CPU_CAPABILITY_SSE2 ) && i_max >= 7
+     && ( i_ecx & 0x18000000 ) == 0x18000000 )
+    {
+        unsigned int i_xcr0, i_xcr0_high;
+
+        /* xgetbv, spelled out for old assemblers */
+        asm volatile ( ".byte 0x0f, 0x01, 0xd0"
+                     : "=a" ( i_xcr0 ), "=d" ( i_xcr0_high )
+                     : "c" ( 0 ) );
+        (void)i_xcr0_high;
+
+        if( ( i_xcr0 & 0x6 ) == 0x6 )
+        {
+            cpuid( 0x00000007 );
+            if( i_ebx & 0x00000020 )
+                i_capabilities |= CPU_CAPABILITY_AVX2;
+        }
+    }
+#   endif
+
     /* test for additional capabilities */
     cpuid( 0x80000000 );
 
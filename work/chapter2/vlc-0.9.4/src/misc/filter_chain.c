@@ -43,6 +43,8 @@ struct filter_chain_t
     int (* pf_buffer_allocation_init)( filter_t *, void *p_data ); /* Callback called once filter allocation has succeeded to initialize the filter's buffer allocation callbacks. This function is responsible for setting p_owner if needed. */
     void (* pf_buffer_allocation_clear)( filter_t * ); /* Callback called on filter removal from chain to clean up buffer allocation callbacks data (ie p_owner) */
     void *p_buffer_allocation_data; /* Data for pf_buffer_allocation_init */
+
+    filter_slices_t *p_slices; /* Threads shared by the video filters */
 };
 
 /**
@@ -85,6 +87,11 @@ filter_chain_t *__filter_chain_New( vlc_object_t *p_this,
     p_chain->pf_buffer_allocation_clear = pf_buffer_allocation_clear;
     p_chain->p_buffer_allocation_data = p_buffer_allocation_data;
 
+    p_chain->p_slices = NULL;
+    if( !strcmp( psz_capability, "video filter2" ) )
+        p_chain->p_slices = filter_slices_New( p_this,
+                        var_CreateGetInteger( p_this, "filter-threads" ) );
+
     return p_chain;
 }
 
@@ -97,6 +104,7 @@ void filter_chain_Delete( filter_chain_t *p_chain )
         filter_chain_DeleteFilterInternal( p_chain,
                                    (filter_t*)p_chain->filters.pp_elems[0] );
     vlc_array_clear( &p_chain->filters );
+    filter_slices_Delete( p_chain->p_slices );
     free( p_chain->psz_capability );
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
@@ -157,6 +165,7 @@ static filter_t *filter_chain_AppendFilterInternal( filter_chain_t *p_chain,
     es_format_Copy( &p_filter->fmt_out, p_fmt_out );
     p_filter->p_cfg = p_cfg;
     p_filter->b_allow_fmt_out_change = p_chain->b_allow_fmt_out_change;
+    p_filter->p_slices = p_chain->p_slices;
 
     p_filter->p_module = module_Need( p_filter, p_chain->psz_capability,
                                       psz_name, psz_name ? true : false );
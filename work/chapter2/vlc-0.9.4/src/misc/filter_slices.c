@@ -0,0 +1,207 @@
+/*****************************************************************************
+ * filter_slices.c : threads for the video filters rendering in slices
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+typedef struct
+{
+    VLC_COMMON_MEMBERS
+
+    filter_slices_t *p_slices;
+} slices_worker_t;
+
+struct filter_slices_t
+{
+    vlc_object_t    *p_parent;
+    unsigned         i_threads;     /* including the calling thread */
+
+    /* Current picture */
+    filter_t        *p_filter;
+    filter_slice_t   pf_slice;
+    picture_t       *p_src;
+    picture_t       *p_dst;
+    int              i_slices;
+    int              i_next_slice;  /* first slice not taken by a thread */
+    int              i_pending;     /* slices not finished yet */
+
+    /* Thread pool, started on the first picture */
+    vlc_mutex_t      lock;
+    vlc_cond_t       wait;          /* slices were queued, or stopping */
+    vlc_cond_t       done;          /* the last slice was finished */
+    bool             b_stop;
+    bool             b_started;
+    unsigned         i_workers;
+    slices_worker_t **pp_workers;
+};
+
+static void *Worker( vlc_object_t *p_this )
+{
+    filter_slices_t *p_slices = ((slices_worker_t *)p_this)->p_slices;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        int i_slice;
+
+        while( !p_slices->b_stop
+            && p_slices->i_next_slice >= p_slices->i_slices )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->b_stop )
+            break;
+
+        i_slice = p_slices->i_next_slice++;
+        vlc_mutex_unlock( &p_slices->lock );
+
+        p_slices->pf_slice( p_slices->p_filter, p_slices->p_src,
+                            p_slices->p_dst, i_slice, p_slices->i_slices );
+
+        vlc_mutex_lock( &p_slices->lock );
+        if( --p_slices->i_pending == 0 )
+            vlc_cond_signal( &p_slices->done );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+static void StartWorkers( filter_slices_t *p_slices )
+{
+    p_slices->b_started = true;
+    p_slices->pp_workers = calloc( p_slices->i_threads - 1,
+                                   sizeof( slices_worker_t * ) );
+    for( unsigned i = 0;
+         p_slices->pp_workers && i < p_slices->i_threads - 1; i++ )
+    {
+        slices_worker_t *p_worker = vlc_object_create( p_slices->p_parent,
+                                                       sizeof( *p_worker ) );
+        if( p_worker == NULL )
+            break;
+        p_worker->p_slices = p_slices;
+        if( vlc_thread_create( p_worker, "filter slice", Worker,
+                               VLC_THREAD_PRIORITY_OUTPUT, false ) )
+        {
+            vlc_object_release( p_worker );
+            break;
+        }
+        p_slices->pp_workers[p_slices->i_workers++] = p_worker;
+    }
+    msg_Dbg( p_slices->p_parent, "rendering video filter slices with %u "
+             "threads", p_slices->i_workers + 1 );
+}
+
+filter_slices_t *__filter_slices_New( vlc_object_t *p_parent,
+                                      unsigned i_threads )
+{
+    filter_slices_t *p_slices;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    if( i_threads == 0 )
+    {
+        long i_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        i_threads = i_cpus > 0 ? i_cpus : 1;
+    }
+#endif
+    if( i_threads <= 1 )
+        return NULL;
+
+    p_slices = calloc( 1, sizeof( *p_slices ) );
+    if( p_slices == NULL )
+        return NULL;
+    p_slices->p_parent = p_parent;
+    p_slices->i_threads = i_threads;
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( NULL, &p_slices->wait );
+    vlc_cond_init( NULL, &p_slices->done );
+    return p_slices;
+}
+
+void filter_slices_Delete( filter_slices_t *p_slices )
+{
+    if( p_slices == NULL )
+        return;
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->b_stop = true;
+    /* There is no broadcast: wake the threads one by one. A thread that is
+     * not waiting sees b_stop before it waits again. */
+    for( unsigned i = 0; i < p_slices->i_workers; i++ )
+        vlc_cond_signal( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->i_workers; i++ )
+    {
+        vlc_thread_join( p_slices->pp_workers[i] );
+        vlc_object_release( p_slices->pp_workers[i] );
+    }
+    free( p_slices->pp_workers );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+}
+
+void filter_slices_Run( filter_slices_t *p_slices, filter_t *p_filter,
+                        filter_slice_t pf_slice,
+                        picture_t *p_src, picture_t *p_dst )
+{
+    /* Threads are only started once a filter needs them, as most chains
+     * have no filter rendering in slices */
+    if( !p_slices->b_started )
+        StartWorkers( p_slices );
+    if( p_slices->i_workers == 0 )
+    {
+        pf_slice( p_filter, p_src, p_dst, 0, 1 );
+        return;
+    }
+
+    vlc_mutex_lock( &p_slices->lock );
+    p_slices->p_filter = p_filter;
+    p_slices->pf_slice = pf_slice;
+    p_slices->p_src = p_src;
+    p_slices->p_dst = p_dst;
+    /* A few slices per thread, for the threads that get descheduled */
+    p_slices->i_slices = 4 * ( p_slices->i_workers + 1 );
+    p_slices->i_next_slice = 0;
+    p_slices->i_pending = p_slices->i_slices;
+    for( unsigned i = 0; i < p_slices->i_workers; i++ )
+        vlc_cond_signal( &p_slices->wait );
+
+    while( p_slices->i_next_slice < p_slices->i_slices )
+    {
+        int i_slice = p_slices->i_next_slice++;
+
+        vlc_mutex_unlock( &p_slices->lock );
+        pf_slice( p_filter, p_src, p_dst, i_slice, p_slices->i_slices );
+        vlc_mutex_lock( &p_slices->lock );
+        p_slices->i_pending--;
+    }
+    while( p_slices->i_pending > 0 )
+        vlc_cond_wait( &p_slices->done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+}
@@ -169,6 +169,10 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
                       &p_stats->i_read_bytes );
     stats_GetFloat( p_input, p_input->p->counters.p_input_bitrate,
                     &p_stats->f_input_bitrate );
+    stats_GetInteger( p_input, p_input->p->counters.p_stream_cache_hit,
+                      &p_stats->i_stream_cache_hits );
+    stats_GetInteger( p_input, p_input->p->counters.p_stream_cache_miss,
+                      &p_stats->i_stream_cache_misses );
     stats_GetInteger( p_input, p_input->p->counters.p_demux_read,
                       &p_stats->i_demux_read_bytes );
     stats_GetFloat( p_input, p_input->p->counters.p_demux_bitrate,
@@ -212,6 +216,7 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     vlc_mutex_lock( &p_stats->lock );
     p_stats->i_read_packets = p_stats->i_read_bytes =
     p_stats->f_input_bitrate = p_stats->f_average_input_bitrate =
+    p_stats->i_stream_cache_hits = p_stats->i_stream_cache_misses =
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
@@ -228,10 +233,13 @@ void stats_DumpInputStats( input_stats_t *p_stats  )
     /* f_bitrate is in bytes / microsecond
      * *1000 => bytes / millisecond => kbytes / seconds */
     fprintf( stderr, "Input : %i (%i bytes) - %f kB/s - "
+                     "Cache seeks : %i/%i - "
                      "Demux : %i (%i bytes) - %f kB/s\n"
                      " - Vout : %i/%i - Aout : %i/%i - Sout : %f\n",
                     p_stats->i_read_packets, p_stats->i_read_bytes,
                     p_stats->f_input_bitrate * 1000,
+                    p_stats->i_stream_cache_hits,
+                    p_stats->i_stream_cache_misses,
                     p_stats->i_demux_read_packets, p_stats->i_demux_read_bytes,
                     p_stats->f_demux_bitrate * 1000,
                     p_stats->i_displayed_pictures, p_stats->i_lost_pictures,
@@ -0,0 +1,400 @@
+/*****************************************************************************
+ * audio_biquad.c: Test and benchmark for the kernels of the equalizers
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks that the C kernels filter as the loops the
+ * equalizers had before, that the SIMD kernels give the samples of the C
+ * ones whatever the number of channels, and that silence ends up in
+ * zeros rather than denormals. Given channel counts, it also reports the
+ * throughput of each kernel:
+ *   ./test_biquad 2 6
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "libvlc.h"
+#include "../../modules/audio_filter/biquad.h"
+
+#define MAX_SAMPLES 1024
+#define CHANNELS 8
+
+/* The 10 bands of the equalizer at 44100 Hz */
+static const float pf_alpha[] = { 0.003013, 0.008490, 0.015374, 0.029328,
+    0.047918, 0.130408, 0.226555, 0.344937, 0.366438, 0.379009 };
+static const float pf_beta[] = { 0.993973, 0.983019, 0.969252, 0.941343,
+    0.904163, 0.739184, 0.546889, 0.310127, 0.267123, 0.241981 };
+static const float pf_gamma[] = { 1.993901, 1.982437, 1.967331, 1.934254,
+    1.884869, 1.582718, 1.015267, -0.181410, -0.521151, -0.808451 };
+/* The "fullbass" preset, in linear gains minus 1 */
+static const float pf_amp[] = { -0.601893, 2.019952, 2.019952, 0.905461,
+    0.202264, -0.369043, -0.601893, -0.698374, -0.724557, -0.724557 };
+
+static const biquad_bands_t bands = {
+    10, pf_alpha, pf_beta, pf_gamma, pf_amp
+};
+
+/* The 5 stages of the parametric equalizer with its default settings */
+static float pf_coeffs[5 * 5];
+
+#define IN_FACTOR 0.25f
+#define GAIN 0.8f
+
+static float p_in[MAX_SAMPLES * CHANNELS];
+static float p_ref[MAX_SAMPLES * CHANNELS], p_out[MAX_SAMPLES * CHANNELS];
+
+static void fill( float *p, int i_count )
+{
+    for( int i = 0; i < i_count; i++ )
+        p[i] = rand() / (float)RAND_MAX * 2.f - 1.f;
+}
+
+static void CalcPeak( float f0, float Q, float gainDB, float Fs, float *c )
+{
+    const float A = pow( 10, gainDB / 40 );
+    const float w0 = 2 * 3.141593f * f0 / Fs;
+    const float alpha = sin( w0 ) / ( 2 * Q );
+    const float a0 = 1 + alpha / A;
+
+    c[0] = ( 1 + alpha * A ) / a0;
+    c[1] = -2 * cos( w0 ) / a0;
+    c[2] = ( 1 - alpha * A ) / a0;
+    c[3] = -2 * cos( w0 ) / a0;
+    c[4] = ( 1 - alpha / A ) / a0;
+}
+
+/*
+ * The loops of the equalizers before the kernels
+ */
+static void OldEqz( float *out, const float *in, int i_samples,
+                    int i_channels, bool b_2eqz, float x[][2],
+                    float y[][10][2], float x2[][2], float y2[][10][2] )
+{
+    for( int i = 0; i < i_samples; i++ )
+    {
+        for( int ch = 0; ch < i_channels; ch++ )
+        {
+            const float f_x = in[ch];
+            float o = 0.0;
+
+            for( int j = 0; j < 10; j++ )
+            {
+                float f_y = pf_alpha[j] * ( f_x - x[ch][1] ) +
+                            pf_gamma[j] * y[ch][j][0] -
+                            pf_beta[j]  * y[ch][j][1];
+
+                y[ch][j][1] = y[ch][j][0];
+                y[ch][j][0] = f_y;
+
+                o += f_y * pf_amp[j];
+            }
+            x[ch][1] = x[ch][0];
+            x[ch][0] = f_x;
+
+            if( b_2eqz )
+            {
+                const float f_x2 = IN_FACTOR * f_x + o;
+                o = 0.0;
+                for( int j = 0; j < 10; j++ )
+                {
+                    float f_y = pf_alpha[j] * ( f_x2 - x2[ch][1] ) +
+                                pf_gamma[j] * y2[ch][j][0] -
+                                pf_beta[j]  * y2[ch][j][1];
+
+                    y2[ch][j][1] = y2[ch][j][0];
+                    y2[ch][j][0] = f_y;
+
+                    o += f_y * pf_amp[j];
+                }
+                x2[ch][1] = x2[ch][0];
+                x2[ch][0] = f_x2;
+
+                out[ch] = GAIN * ( IN_FACTOR * f_x2 + o );
+            }
+            else
+            {
+                out[ch] = GAIN * ( IN_FACTOR * f_x + o );
+            }
+        }
+        in  += i_channels;
+        out += i_channels;
+    }
+}
+
+static void OldCascade( float *out, const float *in, int i_samples,
+                        int i_channels, float state[][5][4] )
+{
+    for( int i = 0; i < i_samples; i++ )
+    {
+        for( int ch = 0; ch < i_channels; ch++ )
+        {
+            const float *c = pf_coeffs;
+            float x = in[ch];
+
+            for( int k = 0; k < 5; k++, c += 5 )
+            {
+                float *s = state[ch][k];
+                const float f_y = x * c[0] + s[0] * c[1] + s[1] * c[2]
+                                - s[2] * c[3] - s[3] * c[4];
+
+                s[1] = s[0];
+                s[0] = x;
+                s[3] = s[2];
+                s[2] = f_y;
+                x = f_y;
+            }
+            out[ch] = x;
+        }
+        in  += i_channels;
+        out += i_channels;
+    }
+}
+
+/* The samples are about 1, and the rounding errors go round the filters */
+static void check_close( const float *p_a, const float *p_b, int i_count,
+                         float f_tolerance )
+{
+    for( int i = 0; i < i_count; i++ )
+        assert( fabsf( p_a[i] - p_b[i] ) <=
+                f_tolerance * ( 1.f + fabsf( p_a[i] ) ) );
+}
+
+static void test_c( const biquad_kernels_t *p_c )
+{
+    for( int i_channels = 1; i_channels <= CHANNELS; i_channels++ )
+    {
+        for( int i_pass = 1; i_pass <= 2; i_pass++ )
+        {
+            static float x[CHANNELS][2], y[CHANNELS][10][2];
+            static float x2[CHANNELS][2], y2[CHANNELS][10][2];
+            static biquad_bands_state_t state, state2;
+
+            memset( x, 0, sizeof(x) );
+            memset( y, 0, sizeof(y) );
+            memset( x2, 0, sizeof(x2) );
+            memset( y2, 0, sizeof(y2) );
+            memset( &state, 0, sizeof(state) );
+            memset( &state2, 0, sizeof(state2) );
+
+            for( int i_buffer = 0; i_buffer < 8; i_buffer++ )
+            {
+                const int i_samples = 1 + rand() % MAX_SAMPLES;
+
+                fill( p_in, i_samples * i_channels );
+                OldEqz( p_ref, p_in, i_samples, i_channels, i_pass == 2,
+                        x, y, x2, y2 );
+                if( i_pass == 2 )
+                {
+                    p_c->pf_bands( &state, &bands, p_out, p_in, i_samples,
+                                   i_channels, IN_FACTOR, 1.f );
+                    p_c->pf_bands( &state2, &bands, p_out, p_out, i_samples,
+                                   i_channels, IN_FACTOR, GAIN );
+                }
+                else
+                    p_c->pf_bands( &state, &bands, p_out, p_in, i_samples,
+                                   i_channels, IN_FACTOR, GAIN );
+                check_close( p_ref, p_out, i_samples * i_channels, 1e-3f );
+            }
+        }
+
+        static float s[CHANNELS][5][4];
+        static biquad_cascade_state_t state;
+
+        memset( s, 0, sizeof(s) );
+        memset( &state, 0, sizeof(state) );
+        for( int i_buffer = 0; i_buffer < 8; i_buffer++ )
+        {
+            const int i_samples = 1 + rand() % MAX_SAMPLES;
+
+            fill( p_in, i_samples * i_channels );
+            OldCascade( p_ref, p_in, i_samples, i_channels, s );
+            p_c->pf_cascade( &state, pf_coeffs, 5, p_out, p_in, i_samples,
+                             i_channels );
+            check_close( p_ref, p_out, i_samples * i_channels, 1e-3f );
+        }
+    }
+}
+
+/* The kernels are also used in place. As the C ones are built with
+ * -ffast-math, the compiler may round them a bit differently, and the
+ * differences last in the states of the narrow bands. */
+static void test_simd( const biquad_kernels_t *p_c,
+                       const biquad_kernels_t *p_simd )
+{
+    for( int i_channels = 1; i_channels <= CHANNELS; i_channels++ )
+    {
+        static biquad_bands_state_t ref_bands, bands_state;
+        static biquad_cascade_state_t ref_cascade, cascade_state;
+
+        memset( &ref_bands, 0, sizeof(ref_bands) );
+        memset( &bands_state, 0, sizeof(bands_state) );
+        memset( &ref_cascade, 0, sizeof(ref_cascade) );
+        memset( &cascade_state, 0, sizeof(cascade_state) );
+
+        for( int i_buffer = 0; i_buffer < 16; i_buffer++ )
+        {
+            const int i_samples = 1 + rand() % MAX_SAMPLES;
+            const int i_count = i_samples * i_channels;
+
+            fill( p_ref, i_count );
+            memcpy( p_out, p_ref, i_count * sizeof(float) );
+            p_c->pf_bands( &ref_bands, &bands, p_ref, p_ref, i_samples,
+                           i_channels, IN_FACTOR, GAIN );
+            p_simd->pf_bands( &bands_state, &bands, p_out, p_out, i_samples,
+                              i_channels, IN_FACTOR, GAIN );
+            check_close( p_ref, p_out, i_count, 1e-3f );
+
+            fill( p_in, i_count );
+            p_c->pf_cascade( &ref_cascade, pf_coeffs, 5, p_ref, p_in,
+                             i_samples, i_channels );
+            p_simd->pf_cascade( &cascade_state, pf_coeffs, 5, p_out, p_in,
+                                i_samples, i_channels );
+            check_close( p_ref, p_out, i_count, 1e-3f );
+        }
+        check_close( (float *)&ref_bands, (float *)&bands_state,
+                     sizeof(ref_bands) / sizeof(float), 1e-3f );
+        check_close( (float *)&ref_cascade, (float *)&cascade_state,
+                     sizeof(ref_cascade) / sizeof(float), 1e-3f );
+    }
+}
+
+/* An impulse followed by silence decays to true zeros */
+static void test_silence( const biquad_kernels_t *p_kernels )
+{
+    const int i_channels = 2;
+    static biquad_bands_state_t bands_state;
+    static biquad_cascade_state_t cascade_state;
+
+    memset( &bands_state, 0, sizeof(bands_state) );
+    memset( &cascade_state, 0, sizeof(cascade_state) );
+    memset( p_in, 0, sizeof(p_in) );
+    p_in[0] = p_in[1] = 1.f;
+
+    for( int i_buffer = 0; i_buffer < 2000; i_buffer++ )
+    {
+        p_kernels->pf_bands( &bands_state, &bands, p_out, p_in, MAX_SAMPLES,
+                             i_channels, IN_FACTOR, GAIN );
+        p_kernels->pf_cascade( &cascade_state, pf_coeffs, 5, p_out, p_in,
+                               MAX_SAMPLES, i_channels );
+        p_in[0] = p_in[1] = 0.f;
+    }
+
+    for( int i = 0; i < i_channels; i++ )
+    {
+        assert( bands_state.x[0][i] == 0.f && bands_state.x[1][i] == 0.f );
+        for( int j = 0; j < 10; j++ )
+            assert( bands_state.y[j][0][i] == 0.f &&
+                    bands_state.y[j][1][i] == 0.f );
+        for( int k = 0; k < 5; k++ )
+            for( int n = 0; n < 4; n++ )
+                assert( cascade_state.s[k][n][i] == 0.f );
+    }
+}
+
+/*
+ * Throughput, in samples per second and channel
+ */
+static void bench( const char *psz_name, const biquad_kernels_t *p_kernels,
+                   int i_channels )
+{
+    static biquad_bands_state_t bands_state;
+    static biquad_cascade_state_t cascade_state;
+    const int i_samples = MAX_SAMPLES * CHANNELS / i_channels;
+    float *p_buffer = malloc( i_samples * i_channels * sizeof(float) );
+
+    assert( p_buffer );
+    memset( &bands_state, 0, sizeof(bands_state) );
+    memset( &cascade_state, 0, sizeof(cascade_state) );
+
+    for( int i_test = 0; i_test < 3; i_test++ )
+    {
+        static const char *const ppsz_test[] = {
+            "equalizer", "equalizer 2 pass", "param_eq" };
+        mtime_t i_start = mdate(), i_time;
+        int64_t i_total = 0;
+
+        do
+        {
+            fill( p_buffer, i_samples * i_channels );
+            if( i_test == 2 )
+                p_kernels->pf_cascade( &cascade_state, pf_coeffs, 5,
+                                       p_buffer, p_buffer, i_samples,
+                                       i_channels );
+            else
+            {
+                p_kernels->pf_bands( &bands_state, &bands, p_buffer,
+                                     p_buffer, i_samples, i_channels,
+                                     IN_FACTOR, GAIN );
+                if( i_test == 1 )
+                    p_kernels->pf_bands( &bands_state, &bands, p_buffer,
+                                         p_buffer, i_samples, i_channels,
+                                         IN_FACTOR, GAIN );
+            }
+            i_total += i_samples;
+        } while( (i_time = mdate() - i_start) < 1000000 );
+
+        printf( "%-6s %d channels %-18s %10.0f samples/s\n", psz_name,
+                i_channels, ppsz_test[i_test], i_total * 1000000. / i_time );
+    }
+    free( p_buffer );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    const unsigned i_cpu = CPUCapabilities();
+    biquad_kernels_t c, simd;
+
+    srand( 0 );
+    CalcPeak( 110, 3, 0, 44100, &pf_coeffs[0] );
+    CalcPeak( 360, 3, 4, 44100, &pf_coeffs[5] );
+    CalcPeak( 8000, 3, -6, 44100, &pf_coeffs[10] );
+    CalcPeak( 100, 0.7, 3, 44100, &pf_coeffs[15] );
+    CalcPeak( 10000, 0.7, -3, 44100, &pf_coeffs[20] );
+
+    biquad_KernelsInit( &c, 0 );
+    biquad_KernelsInit( &simd, i_cpu );
+
+    test_c( &c );
+    test_simd( &c, &simd );
+    test_silence( &c );
+    test_silence( &simd );
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        const int i_channels = atoi( ppsz_argv[i] );
+
+        if( i_channels < 1 || i_channels > BIQUAD_MAX_CHANNELS )
+            continue;
+        bench( "C", &c, i_channels );
+        if( simd.pf_bands != c.pf_bands )
+            bench( "SIMD", &simd, i_channels );
+    }
+    return 0;
+}
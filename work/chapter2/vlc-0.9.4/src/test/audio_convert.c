@@ -0,0 +1,757 @@
+/*****************************************************************************
+ * audio_convert.c: Test and benchmark for the sample format converters
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This checks the kernels of the float and fixed point converters against
+ * the formulas they implement, the SIMD ones against the C ones (dither
+ * included), the in place conversions, and the fused conversion with a
+ * channel map. It then loads an audio filter for every couple of sample
+ * formats that has one and checks the samples it converts, with the stereo
+ * modes of the fused converter. With any argument, it also reports the
+ * throughput of the kernels and of every filter of the matrix:
+ *   ./test_convert bench
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_aout.h>
+
+#include "libvlc.h"
+#include "../../modules/audio_filter/converter/pcm_conv.h"
+
+#define MAX_SAMPLES 300
+#define LOOPS 200
+
+static float RandFloat( float f_max )
+{
+    return ( 2.f * rand() / RAND_MAX - 1.f ) * f_max;
+}
+
+/* Samples in and beyond [-1, 1], with the ties of the 16 bits rounding */
+static void FillFloat( float *p, size_t i_samples )
+{
+    for( size_t i = 0; i < i_samples; i++ )
+    {
+        switch( rand() % 4 )
+        {
+            case 0:
+                p[i] = ( ( rand() % 65536 - 32768 ) + .5f ) / 32768.f;
+                break;
+            case 1:
+                p[i] = RandFloat( 1.2f );
+                break;
+            default:
+                p[i] = RandFloat( 1.f );
+                break;
+        }
+    }
+}
+
+static void FillBytes( void *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+        ((uint8_t *)p)[i] = rand();
+}
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+static int16_t RefS16( double d )
+{
+    d = rint( d * 32768. );
+    return d > 32767. ? 32767 : d < -32768. ? -32768 : d;
+}
+
+static int32_t RefS24( double d )
+{
+    d = rint( d * 8388608. );
+    return d > 8388607. ? 8388607 : d < -8388608. ? -8388608 : d;
+}
+
+static int32_t GetS24( const uint8_t *p )
+{
+#ifdef WORDS_BIGENDIAN
+    return ( (int32_t)(int8_t)p[0] << 16 ) | ( p[1] << 8 ) | p[2];
+#else
+    return ( (int32_t)(int8_t)p[2] << 16 ) | ( p[1] << 8 ) | p[0];
+#endif
+}
+
+/* s24_to_s16_pcm of the fixed point converter */
+static int16_t RefFixedS16( int32_t i )
+{
+    i += 1 << 12;
+    if( i >= 1 << 28 )
+        i = ( 1 << 28 ) - 1;
+    else if( i < -( 1 << 28 ) )
+        i = -( 1 << 28 );
+    return i >> 13;
+}
+
+static void test_from_float( const pcm_conv_t *p_c, const pcm_conv_t *p_simd )
+{
+    float pf_in[MAX_SAMPLES + 1];
+    int16_t pi_c[MAX_SAMPLES], pi_simd[MAX_SAMPLES + 1];
+    uint8_t p_c24[3 * MAX_SAMPLES], p_simd24[3 * MAX_SAMPLES + 1];
+
+    for( int k = 0; k < LOOPS; k++ )
+    {
+        const size_t i_samples = rand() % MAX_SAMPLES;
+        const size_t i_skew = rand() % 2;
+        pcm_dither_t dither_c, dither_simd;
+
+        FillFloat( &pf_in[i_skew], i_samples );
+
+        p_c->pf_fl32_s16( pi_c, &pf_in[i_skew], i_samples, NULL );
+        p_simd->pf_fl32_s16( &pi_simd[i_skew], &pf_in[i_skew], i_samples,
+                             NULL );
+        for( size_t i = 0; i < i_samples; i++ )
+        {
+            assert( pi_c[i] == RefS16( pf_in[i_skew + i] ) );
+            assert( pi_simd[i_skew + i] == pi_c[i] );
+        }
+
+        p_c->pf_fl32_s24( p_c24, &pf_in[i_skew], i_samples, NULL );
+        p_simd->pf_fl32_s24( &p_simd24[i_skew], &pf_in[i_skew], i_samples,
+                             NULL );
+        for( size_t i = 0; i < i_samples; i++ )
+            assert( GetS24( &p_c24[3 * i] ) == RefS24( pf_in[i_skew + i] ) );
+        assert( !memcmp( p_c24, &p_simd24[i_skew], 3 * i_samples ) );
+
+        /* The same dither for the same samples */
+        pcm_DitherInit( &dither_c, k );
+        pcm_DitherInit( &dither_simd, k );
+        for( int j = 0; j < 2; j++ )
+        {
+            p_c->pf_fl32_s16( pi_c, &pf_in[i_skew], i_samples, &dither_c );
+            p_simd->pf_fl32_s16( &pi_simd[i_skew], &pf_in[i_skew], i_samples,
+                                 &dither_simd );
+            assert( !memcmp( pi_c, &pi_simd[i_skew], 2 * i_samples ) );
+
+            p_c->pf_fl32_s24( p_c24, &pf_in[i_skew], i_samples, &dither_c );
+            p_simd->pf_fl32_s24( &p_simd24[i_skew], &pf_in[i_skew],
+                                 i_samples, &dither_simd );
+            assert( !memcmp( p_c24, &p_simd24[i_skew], 3 * i_samples ) );
+        }
+        assert( !memcmp( &dither_c, &dither_simd, sizeof(dither_c) ) );
+
+        /* In place, as the audio filters do it */
+        {
+            float pf_tmp[MAX_SAMPLES];
+
+            memcpy( pf_tmp, &pf_in[i_skew], i_samples * sizeof(float) );
+            p_simd->pf_fl32_s16( (int16_t *)pf_tmp, pf_tmp, i_samples, NULL );
+            p_c->pf_fl32_s16( pi_c, &pf_in[i_skew], i_samples, NULL );
+            assert( !memcmp( pf_tmp, pi_c, 2 * i_samples ) );
+
+            memcpy( pf_tmp, &pf_in[i_skew], i_samples * sizeof(float) );
+            p_simd->pf_fl32_s24( (uint8_t *)pf_tmp, pf_tmp, i_samples, NULL );
+            p_c->pf_fl32_s24( p_c24, &pf_in[i_skew], i_samples, NULL );
+            assert( !memcmp( pf_tmp, p_c24, 3 * i_samples ) );
+        }
+    }
+}
+
+static void test_to_float( const pcm_conv_t *p_c, const pcm_conv_t *p_simd )
+{
+    /* Room for the float output over the integer input */
+    int32_t pi_in[MAX_SAMPLES + 1];
+    float pf_c[MAX_SAMPLES], pf_simd[MAX_SAMPLES + 1];
+
+    for( int k = 0; k < LOOPS; k++ )
+    {
+        const size_t i_samples = rand() % MAX_SAMPLES;
+        const bool b_swap = k & 1;
+        const int16_t *pi_16 = (const int16_t *)pi_in;
+        const uint8_t *p_24 = (const uint8_t *)pi_in;
+
+        FillBytes( pi_in, sizeof(pi_in) );
+
+        p_c->pf_s16_fl32( pf_c, pi_16, i_samples, b_swap );
+        for( size_t i = 0; i < i_samples; i++ )
+        {
+            const uint8_t *p = (const uint8_t *)&pi_16[i];
+            int16_t i_sample;
+
+            if( b_swap )
+            {
+                const uint8_t p_tmp[2] = { p[1], p[0] };
+                memcpy( &i_sample, p_tmp, 2 );
+            }
+            else
+                memcpy( &i_sample, p, 2 );
+            assert( pf_c[i] == i_sample / 32768.f );
+        }
+        p_simd->pf_s16_fl32( pf_simd, pi_16, i_samples, b_swap );
+        assert( !memcmp( pf_c, pf_simd, i_samples * sizeof(float) ) );
+
+        p_c->pf_s24_fl32( pf_c, p_24, i_samples, b_swap );
+        for( size_t i = 0; i < i_samples; i++ )
+        {
+            const uint8_t *p = &p_24[3 * i];
+            const uint8_t p_tmp[3] = { p[2], p[1], p[0] };
+
+            assert( pf_c[i] == GetS24( b_swap ? p_tmp : p ) / 8388608.f );
+        }
+        p_simd->pf_s24_fl32( pf_simd, p_24, i_samples, b_swap );
+        assert( !memcmp( pf_c, pf_simd, i_samples * sizeof(float) ) );
+
+        p_c->pf_s32_fl32( pf_c, pi_in, i_samples, b_swap );
+        for( size_t i = 0; i < i_samples; i++ )
+        {
+            const uint8_t *p = (const uint8_t *)&pi_in[i];
+            int32_t i_sample;
+
+            if( b_swap )
+            {
+                const uint8_t p_tmp[4] = { p[3], p[2], p[1], p[0] };
+                memcpy( &i_sample, p_tmp, 4 );
+            }
+            else
+                memcpy( &i_sample, p, 4 );
+            assert( pf_c[i] == (float)i_sample * (1.f / 2147483648.f) );
+        }
+        p_simd->pf_s32_fl32( pf_simd, pi_in, i_samples, b_swap );
+        assert( !memcmp( pf_c, pf_simd, i_samples * sizeof(float) ) );
+
+        /* In place, from the end */
+        {
+            float pf_tmp[MAX_SAMPLES];
+
+            memcpy( pf_tmp, pi_in, 2 * i_samples );
+            p_simd->pf_s16_fl32( pf_tmp, (int16_t *)pf_tmp, i_samples,
+                                 b_swap );
+            p_c->pf_s16_fl32( pf_c, pi_16, i_samples, b_swap );
+            assert( !memcmp( pf_tmp, pf_c, i_samples * sizeof(float) ) );
+
+            memcpy( pf_tmp, pi_in, 3 * i_samples );
+            p_simd->pf_s24_fl32( pf_tmp, (uint8_t *)pf_tmp, i_samples,
+                                 b_swap );
+            p_c->pf_s24_fl32( pf_c, p_24, i_samples, b_swap );
+            assert( !memcmp( pf_tmp, pf_c, i_samples * sizeof(float) ) );
+
+            memcpy( pf_tmp, pi_in, 4 * i_samples );
+            p_simd->pf_s32_fl32( pf_tmp, (int32_t *)pf_tmp, i_samples,
+                                 b_swap );
+            p_c->pf_s32_fl32( pf_c, pi_in, i_samples, b_swap );
+            assert( !memcmp( pf_tmp, pf_c, i_samples * sizeof(float) ) );
+        }
+    }
+}
+
+static void test_fixed( const pcm_conv_t *p_c, const pcm_conv_t *p_simd )
+{
+    int32_t pi_in[MAX_SAMPLES], pi_c[MAX_SAMPLES], pi_simd[MAX_SAMPLES];
+    int16_t pi_16[MAX_SAMPLES], pi_16simd[MAX_SAMPLES];
+
+    for( int k = 0; k < LOOPS; k++ )
+    {
+        const size_t i_samples = rand() % MAX_SAMPLES;
+
+        /* Up to twice the full scale, as after a gain */
+        for( size_t i = 0; i < i_samples; i++ )
+            pi_in[i] = ( rand() % ( 1 << 30 ) ) - ( 1 << 29 );
+
+        p_c->pf_fi32_s16( pi_16, pi_in, i_samples );
+        p_simd->pf_fi32_s16( pi_16simd, pi_in, i_samples );
+        for( size_t i = 0; i < i_samples; i++ )
+            assert( pi_16[i] == RefFixedS16( pi_in[i] ) );
+        assert( !memcmp( pi_16, pi_16simd, 2 * i_samples ) );
+
+        p_c->pf_s16_fi32( pi_c, pi_16, i_samples );
+        for( size_t i = 0; i < i_samples; i++ )
+            assert( pi_c[i] == pi_16[i] * ( 1 << 12 ) );
+
+        /* In place */
+        memcpy( pi_simd, pi_16, 2 * i_samples );
+        p_simd->pf_s16_fi32( pi_simd, (int16_t *)pi_simd, i_samples );
+        assert( !memcmp( pi_c, pi_simd, 4 * i_samples ) );
+    }
+}
+
+/* The fused conversion against the conversion of the mapped samples */
+static void test_remap( const pcm_conv_t *p_c, const pcm_conv_t *p_simd )
+{
+    static const float pf_gain[] = { 1.f, .5f, 2.f };
+    float pf_in[MAX_SAMPLES * 8], pf_mapped[MAX_SAMPLES * 8];
+    int16_t pi_ref[MAX_SAMPLES * 8], pi_c[MAX_SAMPLES * 8],
+            pi_simd[MAX_SAMPLES * 8];
+
+    for( int k = 0; k < LOOPS; k++ )
+    {
+        const unsigned i_in = 1 + rand() % 8, i_out = 1 + rand() % 8;
+        const size_t i_frames = rand() % MAX_SAMPLES;
+        const float f_gain = pf_gain[k % 3];
+        pcm_dither_t dither_c, dither_simd;
+        int pi_map[8];
+
+        for( unsigned j = 0; j < i_out; j++ )
+            pi_map[j] = rand() % i_in;
+        FillFloat( pf_in, i_frames * i_in );
+        for( size_t i = 0; i < i_frames; i++ )
+            for( unsigned j = 0; j < i_out; j++ )
+                pf_mapped[i * i_out + j] = pf_in[i * i_in + pi_map[j]]
+                                         * f_gain;
+        p_c->pf_fl32_s16( pi_ref, pf_mapped, i_frames * i_out, NULL );
+
+        p_c->pf_fl32_s16_remap( pi_c, pf_in, i_frames, i_in, i_out, pi_map,
+                                f_gain, NULL );
+        assert( !memcmp( pi_c, pi_ref, 2 * i_frames * i_out ) );
+        p_simd->pf_fl32_s16_remap( pi_simd, pf_in, i_frames, i_in, i_out,
+                                   pi_map, f_gain, NULL );
+        assert( !memcmp( pi_simd, pi_ref, 2 * i_frames * i_out ) );
+
+        /* The dither goes as for the mapped samples */
+        pcm_DitherInit( &dither_c, k );
+        pcm_DitherInit( &dither_simd, k );
+        p_c->pf_fl32_s16( pi_ref, pf_mapped, i_frames * i_out, &dither_c );
+        p_c->pf_fl32_s16_remap( pi_c, pf_in, i_frames, i_in, i_out, pi_map,
+                                f_gain, &dither_simd );
+        assert( !memcmp( pi_c, pi_ref, 2 * i_frames * i_out ) );
+        pcm_DitherInit( &dither_simd, k );
+        p_simd->pf_fl32_s16_remap( pi_simd, pf_in, i_frames, i_in, i_out,
+                                   pi_map, f_gain, &dither_simd );
+        assert( !memcmp( pi_simd, pi_ref, 2 * i_frames * i_out ) );
+    }
+}
+
+/* The dither moves a sample by less than 1 LSB, and not on average */
+static void test_dither( const pcm_conv_t *p_conv )
+{
+#define DITHER_SAMPLES 65536
+    static float pf_in[DITHER_SAMPLES];
+    static int16_t pi_out[DITHER_SAMPLES];
+    static uint8_t p_out24[3 * DITHER_SAMPLES];
+    const float pf_value[] = { 0.f, .3f, -.5f, 100.7f };
+    pcm_dither_t dither;
+
+    pcm_DitherInit( &dither, 1 );
+    for( unsigned k = 0; k < sizeof(pf_value) / sizeof(*pf_value); k++ )
+    {
+        const float f_lsb = pf_value[k];
+        double f_sum = 0., f_sum24 = 0.;
+
+        for( int i = 0; i < DITHER_SAMPLES; i++ )
+            pf_in[i] = f_lsb / 32768.f;
+        p_conv->pf_fl32_s16( pi_out, pf_in, DITHER_SAMPLES, &dither );
+        for( int i = 0; i < DITHER_SAMPLES; i++ )
+        {
+            assert( fabs( pi_out[i] - f_lsb ) < 1.5 );
+            f_sum += pi_out[i];
+        }
+        assert( fabs( f_sum / DITHER_SAMPLES - f_lsb ) < .02 );
+
+        for( int i = 0; i < DITHER_SAMPLES; i++ )
+            pf_in[i] = f_lsb / 8388608.f;
+        p_conv->pf_fl32_s24( p_out24, pf_in, DITHER_SAMPLES, &dither );
+        for( int i = 0; i < DITHER_SAMPLES; i++ )
+        {
+            const int32_t i_sample = GetS24( &p_out24[3 * i] );
+
+            assert( fabs( i_sample - f_lsb ) < 1.5 );
+            f_sum24 += i_sample;
+        }
+        assert( fabs( f_sum24 / DITHER_SAMPLES - f_lsb ) < .02 );
+    }
+}
+
+/*****************************************************************************
+ * Matrix of the audio filters
+ *****************************************************************************/
+typedef struct
+{
+    char psz_fourcc[5];
+    unsigned i_bits;
+    bool b_float, b_fixed, b_unsigned, b_big;
+} pcm_format_t;
+
+static const pcm_format_t p_formats[] =
+{
+    { "fl32", 32, true,  false, false, false },
+    { "fi32", 32, false, true,  false, false },
+    { "s16l", 16, false, false, false, false },
+    { "s16b", 16, false, false, false, true  },
+    { "s24l", 24, false, false, false, false },
+    { "s24b", 24, false, false, false, true  },
+    { "s32l", 32, false, false, false, false },
+    { "s32b", 32, false, false, false, true  },
+    { "s8  ",  8, false, false, false, false },
+    { "u8  ",  8, false, false, true,  false },
+    { "u16l", 16, false, false, true,  false },
+    { "u16b", 16, false, false, true,  true  },
+};
+#define FORMATS (sizeof(p_formats) / sizeof(*p_formats))
+
+static vlc_fourcc_t Fourcc( const pcm_format_t *p_fmt )
+{
+    const char *p = p_fmt->psz_fourcc;
+    return VLC_FOURCC( p[0], p[1], p[2], p[3] );
+}
+
+static void Encode( const pcm_format_t *p_fmt, uint8_t *p, double d )
+{
+    const unsigned i_bytes = p_fmt->i_bits / 8;
+    const int64_t i_half = INT64_C(1) << ( p_fmt->i_bits - 1 );
+    int64_t i;
+
+    if( p_fmt->b_float )
+    {
+        const float f = d;
+        memcpy( p, &f, 4 );
+        return;
+    }
+    if( p_fmt->b_fixed )
+    {
+        const int32_t i_fixed = lrint( d * ( 1 << 28 ) );
+        memcpy( p, &i_fixed, 4 );
+        return;
+    }
+    i = llrint( d * i_half );
+    i = i < -i_half ? -i_half : i >= i_half ? i_half - 1 : i;
+    if( p_fmt->b_unsigned )
+        i += i_half;
+    for( unsigned k = 0; k < i_bytes; k++ )
+        p[p_fmt->b_big ? i_bytes - 1 - k : k] = i >> ( 8 * k );
+}
+
+static double Decode( const pcm_format_t *p_fmt, const uint8_t *p )
+{
+    const unsigned i_bytes = p_fmt->i_bits / 8;
+    const int64_t i_half = INT64_C(1) << ( p_fmt->i_bits - 1 );
+    int64_t i = 0;
+
+    if( p_fmt->b_float )
+    {
+        float f;
+        memcpy( &f, p, 4 );
+        return f;
+    }
+    if( p_fmt->b_fixed )
+    {
+        int32_t i_fixed;
+        memcpy( &i_fixed, p, 4 );
+        return i_fixed / (double)( 1 << 28 );
+    }
+    for( unsigned k = 0; k < i_bytes; k++ )
+        i |= (int64_t)p[p_fmt->b_big ? i_bytes - 1 - k : k] << ( 8 * k );
+    if( p_fmt->b_unsigned )
+        i -= i_half;
+    else if( i >= i_half )
+        i -= 2 * i_half;
+    return (double)i / i_half;
+}
+
+/* The largest error of a conversion to the format */
+static double Quantum( const pcm_format_t *p_fmt )
+{
+    if( p_fmt->b_float )
+        return 1e-6;
+    if( p_fmt->b_fixed )
+        return 1. / ( 1 << 28 );
+    return 1. / ( INT64_C(1) << ( p_fmt->i_bits - 1 ) );
+}
+
+#define CHANNELS 2
+#define FRAMES 1024
+
+typedef struct
+{
+    aout_filter_t *p_filter;
+    aout_buffer_t  in, out;
+    uint8_t       *p_in, *p_out;
+} converter_t;
+
+static bool ConverterNew( converter_t *p_conv, vlc_object_t *p_obj,
+                          vlc_fourcc_t i_in, vlc_fourcc_t i_out,
+                          uint32_t i_out_original )
+{
+    aout_filter_t *p_filter = vlc_object_create( p_obj, sizeof(*p_filter) );
+    audio_sample_format_t fmt;
+
+    assert( p_filter != NULL );
+    memset( &fmt, 0, sizeof(fmt) );
+    fmt.i_rate = 48000;
+    fmt.i_physical_channels =
+    fmt.i_original_channels = AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT;
+    fmt.i_format = i_in;
+    aout_FormatPrepare( &fmt );
+    p_filter->input = fmt;
+    fmt.i_format = i_out;
+    fmt.i_original_channels = i_out_original;
+    aout_FormatPrepare( &fmt );
+    p_filter->output = fmt;
+
+    p_filter->p_module = module_Need( p_filter, "audio filter", NULL, false );
+    if( p_filter->p_module == NULL )
+    {
+        vlc_object_release( p_filter );
+        return false;
+    }
+    p_conv->p_filter = p_filter;
+
+    /* The largest sample of the two, for the filters done in place */
+    p_conv->p_in = malloc( FRAMES * CHANNELS * 4 );
+    p_conv->p_out = malloc( FRAMES * CHANNELS * 4 );
+    assert( p_conv->p_in != NULL && p_conv->p_out != NULL );
+    memset( &p_conv->in, 0, sizeof(p_conv->in) );
+    p_conv->in.p_buffer = p_conv->p_in;
+    p_conv->in.i_size = FRAMES * CHANNELS * 4;
+    p_conv->out = p_conv->in;
+    if( !p_filter->b_in_place )
+        p_conv->out.p_buffer = p_conv->p_out;
+    return true;
+}
+
+static void ConverterRun( converter_t *p_conv, unsigned i_frames )
+{
+    aout_filter_t *p_filter = p_conv->p_filter;
+
+    p_conv->in.i_nb_samples = i_frames;
+    p_conv->in.i_nb_bytes = i_frames * p_filter->input.i_bytes_per_frame;
+    p_filter->pf_do_work( NULL, p_filter, &p_conv->in, &p_conv->out );
+    assert( p_conv->out.i_nb_samples == i_frames );
+    assert( p_conv->out.i_nb_bytes
+             == i_frames * p_filter->output.i_bytes_per_frame );
+}
+
+static void ConverterDelete( converter_t *p_conv )
+{
+    module_Unneed( p_conv->p_filter, p_conv->p_filter->p_module );
+    vlc_object_release( p_conv->p_filter );
+    free( p_conv->p_in );
+    free( p_conv->p_out );
+}
+
+static double pd_signal[FRAMES * CHANNELS];
+
+static void test_pair( vlc_object_t *p_obj, const pcm_format_t *p_in,
+                       const pcm_format_t *p_out, bool b_bench )
+{
+    const unsigned i_in = p_in->i_bits / 8, i_out = p_out->i_bits / 8;
+    static double pd_in[FRAMES * CHANNELS];
+    /* The fixed point converter has always given half the full scale
+     * from 16 bits (FIXED32_ONE >> 16) */
+    const double f_scale = p_out->b_fixed && p_in->i_bits == 16 ? .5 : 1.;
+    converter_t conv;
+
+    if( !ConverterNew( &conv, p_obj, Fourcc( p_in ), Fourcc( p_out ),
+                       AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT ) )
+    {
+        if( b_bench )
+            printf( "%s -> %s not available\n", p_in->psz_fourcc,
+                    p_out->psz_fourcc );
+        return;
+    }
+
+    for( unsigned i = 0; i < FRAMES * CHANNELS; i++ )
+    {
+        Encode( p_in, &conv.p_in[i * i_in], pd_signal[i] );
+        pd_in[i] = Decode( p_in, &conv.p_in[i * i_in] ) * f_scale;
+    }
+    ConverterRun( &conv, FRAMES );
+    for( unsigned i = 0; i < FRAMES * CHANNELS; i++ )
+    for( unsigned i = 0; i < FRAMES * CHANNELS; i++ )
+        assert( fabs( Decode( p_out, &conv.out.p_buffer[i * i_out] )
+                      - pd_in[i] ) <= Quantum( p_out ) * 1.0001 + 1e-6 );
+
+    if( b_bench )
+    {
+        mtime_t i_start = mdate(), i_time;
+        int64_t i_total = 0;
+
+        do
+        {
+            ConverterRun( &conv, FRAMES );
+            i_total += FRAMES * CHANNELS;
+        } while( (i_time = mdate() - i_start) < 1000000 );
+        printf( "%s -> %s %-16s %8.1f Msamples/s\n", p_in->psz_fourcc,
+                p_out->psz_fourcc,
+                module_GetObjName( conv.p_filter->p_module ),
+                i_total / (double)i_time );
+    }
+    ConverterDelete( &conv );
+}
+
+/* The stereo modes go through the fused converter */
+static void test_stereo_modes( vlc_object_t *p_obj )
+{
+    static const struct
+    {
+        uint32_t i_original;
+        int pi_map[2];
+    } p_modes[] = {
+        { AOUT_CHAN_LEFT, { 0, 0 } },
+        { AOUT_CHAN_RIGHT, { 1, 1 } },
+        { AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT | AOUT_CHAN_REVERSESTEREO,
+          { 1, 0 } },
+    };
+
+    for( unsigned k = 0; k < sizeof(p_modes) / sizeof(*p_modes); k++ )
+    {
+        converter_t conv;
+        const float *pf_in;
+        const int16_t *pi_out;
+
+        assert( ConverterNew( &conv, p_obj, VLC_FOURCC('f','l','3','2'),
+                              AOUT_FMT_S16_NE, p_modes[k].i_original ) );
+        assert( !conv.p_filter->b_in_place );
+        pf_in = (const float *)conv.p_in;
+        pi_out = (const int16_t *)conv.out.p_buffer;
+
+        FillFloat( (float *)conv.p_in, FRAMES * CHANNELS );
+        ConverterRun( &conv, FRAMES );
+        for( unsigned i = 0; i < FRAMES; i++ )
+            for( unsigned j = 0; j < CHANNELS; j++ )
+                assert( pi_out[i * CHANNELS + j]
+                         == RefS16( pf_in[i * CHANNELS
+                                          + p_modes[k].pi_map[j]] ) );
+        ConverterDelete( &conv );
+    }
+}
+
+/*****************************************************************************
+ * Throughput of the kernels
+ *****************************************************************************/
+#define BENCH_SAMPLES 4096
+
+static void bench_kernels( const char *psz_name, const pcm_conv_t *p_conv )
+{
+    static float pf_buf[BENCH_SAMPLES];
+    static int16_t pi_buf[BENCH_SAMPLES];
+    static const int pi_map[2] = { 1, 0 };
+    pcm_dither_t dither;
+
+    pcm_DitherInit( &dither, 0 );
+    FillFloat( pf_buf, BENCH_SAMPLES );
+    for( int k = 0; k < 9; k++ )
+    {
+        static const char *ppsz_kernel[] = {
+            "fl32 -> s16", "fl32 -> s16 dither", "fl32 -> s24",
+            "s16 -> fl32", "s24 -> fl32", "s32 -> fl32", "fi32 -> s16",
+            "s16 -> fi32", "fl32 -> s16 reversed",
+        };
+        mtime_t i_start = mdate(), i_time;
+        int64_t i_total = 0;
+
+        do
+        {
+            switch( k )
+            {
+                case 0:
+                    p_conv->pf_fl32_s16( pi_buf, pf_buf, BENCH_SAMPLES, NULL );
+                    break;
+                case 1:
+                    p_conv->pf_fl32_s16( pi_buf, pf_buf, BENCH_SAMPLES,
+                                         &dither );
+                    break;
+                case 2:
+                    p_conv->pf_fl32_s24( (uint8_t *)pf_buf, pf_buf,
+                                         BENCH_SAMPLES / 2, NULL );
+                    break;
+                case 3:
+                    p_conv->pf_s16_fl32( pf_buf, pi_buf, BENCH_SAMPLES, false );
+                    break;
+                case 4:
+                    p_conv->pf_s24_fl32( pf_buf, (uint8_t *)pi_buf,
+                                         BENCH_SAMPLES / 2, false );
+                    break;
+                case 5:
+                    p_conv->pf_s32_fl32( pf_buf, (int32_t *)pf_buf,
+                                         BENCH_SAMPLES, false );
+                    break;
+                case 6:
+                    p_conv->pf_fi32_s16( pi_buf, (int32_t *)pf_buf,
+                                         BENCH_SAMPLES );
+                    break;
+                case 7:
+                    p_conv->pf_s16_fi32( (int32_t *)pf_buf, pi_buf,
+                                         BENCH_SAMPLES );
+                    break;
+                case 8:
+                    p_conv->pf_fl32_s16_remap( pi_buf, pf_buf,
+                                               BENCH_SAMPLES / 2, 2, 2, pi_map,
+                                               1.f, NULL );
+                    break;
+            }
+            i_total += k == 2 || k == 4 ? BENCH_SAMPLES / 2 : BENCH_SAMPLES;
+        } while( (i_time = mdate() - i_start) < 200000 );
+
+        printf( "%-4s %-22s %8.1f Msamples/s\n", psz_name, ppsz_kernel[k],
+                i_total / (double)i_time );
+        /* Keep the samples sane after the conversions in place */
+        FillFloat( pf_buf, BENCH_SAMPLES );
+    }
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--no-plugins-cache",
+        "--plugin-path=../../modules"
+    };
+    const bool b_bench = i_argc > 1;
+    libvlc_int_t *p_libvlc;
+    pcm_conv_t c, simd;
+
+    (void)ppsz_argv;
+    srand( 0 );
+    pcm_conv_Init( &c, 0 );
+    pcm_conv_Init( &simd, CPUCapabilities() );
+
+    test_from_float( &c, &simd );
+    test_to_float( &c, &simd );
+    test_fixed( &c, &simd );
+    test_remap( &c, &simd );
+    test_dither( &c );
+    test_dither( &simd );
+
+    if( b_bench )
+    {
+        bench_kernels( "C", &c );
+        bench_kernels( "SIMD", &simd );
+    }
+
+    p_libvlc = libvlc_InternalCreate();
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 5, ppsz_vlc_argv ) == 0 );
+
+    for( unsigned i = 0; i < FRAMES * CHANNELS; i++ )
+        pd_signal[i] = i == 0 ? -1. : RandFloat( .99f );
+    for( unsigned i = 0; i < FORMATS; i++ )
+        for( unsigned j = 0; j < FORMATS; j++ )
+            if( i != j )
+                test_pair( VLC_OBJECT(p_libvlc), &p_formats[i],
+                           &p_formats[j], b_bench );
+    test_stereo_modes( VLC_OBJECT(p_libvlc) );
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*****************************************************************************
+ * audio_mixer.c: Test and benchmark for the float32 mixer kernels
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks the C and SIMD kernels against a weighted
+ * sum in double precision, for any number of inputs, odd lengths and
+ * unaligned buffers. Given numbers of inputs, it also reports the
+ * throughput of each kernel against the loops the mixer had before:
+ *   ./test_mixer 2 16
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "libvlc.h"
+#include "../../modules/audio_mixer/float_mix.h"
+
+#define MAX_INPUTS 32
+#define MAX_WORDS 2048
+
+static float pp_buffer[MAX_INPUTS][MAX_WORDS + 4];
+static float p_out[MAX_WORDS + 4];
+
+static void fill( void )
+{
+    for( int k = 0; k < MAX_INPUTS; k++ )
+        for( int i = 0; i < MAX_WORDS + 4; i++ )
+            pp_buffer[k][i] = 2.f * rand() / RAND_MAX - 1.f;
+}
+
+static void check( float_mix_t pf_mix, unsigned i_inputs, size_t i_words,
+                   unsigned i_offset )
+{
+    const float *pp_in[MAX_INPUTS];
+    float pf_gain[MAX_INPUTS];
+
+    for( unsigned k = 0; k < i_inputs; k++ )
+    {
+        /* Each input at its own misalignment */
+        pp_in[k] = &pp_buffer[k][(i_offset + k) % 4];
+        pf_gain[k] = rand() / (float)RAND_MAX / i_inputs;
+    }
+
+    /* Words past the end must be left alone */
+    for( size_t i = 0; i < MAX_WORDS + 4; i++ )
+        p_out[i] = 1e6f;
+
+    pf_mix( &p_out[i_offset], pp_in, pf_gain, i_inputs, i_words );
+
+    for( size_t i = 0; i < i_words; i++ )
+    {
+        double f_sum = 0., f_bound = 0.;
+
+        for( unsigned k = 0; k < i_inputs; k++ )
+        {
+            f_sum += (double)pp_in[k][i] * pf_gain[k];
+            f_bound += fabs( pp_in[k][i] * pf_gain[k] );
+        }
+        if( fabs( p_out[i_offset + i] - f_sum ) > 1e-6 * (f_bound + 1.) )
+        {
+            fprintf( stderr, "%u inputs, %zu words, offset %u: word %zu is "
+                     "%f instead of %f\n", i_inputs, i_words, i_offset, i,
+                     p_out[i_offset + i], f_sum );
+            abort();
+        }
+    }
+    for( size_t i = 0; i < i_offset; i++ )
+        assert( p_out[i] == 1e6f );
+    for( size_t i = i_offset + i_words; i < MAX_WORDS + 4; i++ )
+        assert( p_out[i] == 1e6f );
+}
+
+static void test( float_mix_t pf_mix )
+{
+    static const size_t pi_words[] = { 0, 1, 2, 3, 4, 5, 7, 8, 17, 1023,
+                                       1024, MAX_WORDS };
+
+    for( unsigned i_inputs = 1; i_inputs <= 20; i_inputs++ )
+        for( unsigned i = 0; i < sizeof(pi_words)/sizeof(*pi_words); i++ )
+            for( unsigned i_offset = 0; i_offset < 4; i_offset++ )
+                check( pf_mix, i_inputs, pi_words[i], i_offset );
+    check( pf_mix, MAX_INPUTS, MAX_WORDS, 1 );
+}
+
+/*
+ * The loops of the mixer before, one pass over the output per input
+ */
+static void MixOld( float *p_out, const float *const *pp_in,
+                    const float *pf_gain, unsigned i_inputs, size_t i_words )
+{
+    for( unsigned k = 0; k < i_inputs; k++ )
+    {
+        const float *p_in = pp_in[k];
+        float *p_dst = p_out;
+
+        if( k == 0 )
+            for( size_t i = i_words; i--; )
+                *p_dst++ = *p_in++ * pf_gain[k];
+        else
+            for( size_t i = i_words; i--; )
+                *p_dst++ += *p_in++ * pf_gain[k];
+    }
+}
+
+/*
+ * Throughput, in output words per second
+ */
+static void bench( const char *psz_name, float_mix_t pf_mix,
+                   unsigned i_inputs )
+{
+    const float *pp_in[MAX_INPUTS];
+    float pf_gain[MAX_INPUTS];
+    mtime_t i_start = mdate(), i_time;
+    int64_t i_total = 0;
+
+    for( unsigned k = 0; k < i_inputs; k++ )
+    {
+        pp_in[k] = pp_buffer[k];
+        pf_gain[k] = 1.f / i_inputs;
+    }
+
+    do
+    {
+        for( int i = 0; i < 100; i++ )
+            pf_mix( p_out, pp_in, pf_gain, i_inputs, MAX_WORDS );
+        i_total += 100 * MAX_WORDS;
+    } while( (i_time = mdate() - i_start) < 1000000 );
+
+    printf( "%-4s %2u inputs %10.0f words/s\n", psz_name, i_inputs,
+            i_total * 1000000. / i_time );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    float_mix_t c = float_mix_Get( 0 );
+    float_mix_t simd = float_mix_Get( CPUCapabilities() );
+
+    srand( 0 );
+    fill();
+
+    test( MixOld );
+    test( c );
+    if( simd != c )
+        test( simd );
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        const int i_inputs = atoi( ppsz_argv[i] );
+
+        if( i_inputs < 1 || i_inputs > MAX_INPUTS )
+            continue;
+        bench( "old", MixOld, i_inputs );
+        bench( "C", c, i_inputs );
+        if( simd != c )
+            bench( "SIMD", simd, i_inputs );
+    }
+    return 0;
+}
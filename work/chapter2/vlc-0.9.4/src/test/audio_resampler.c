@@ -0,0 +1,425 @@
+/*****************************************************************************
+ * audio_resampler.c: Test and benchmark for the polyphase resampler
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this resamples sines in blocks of random sizes and
+ * checks every output frame against the sine at its time, for each
+ * quality, with fixed ratios, with an input rate drifting as the audio
+ * output moves it, and across a jump of the rate that computes another
+ * filter bank. It also checks that the SIMD kernels give the samples of
+ * the C one, and that the frames left to drain are the input ones. Given
+ * rates, it also reports the throughput of each quality against the
+ * bandlimited resampler:
+ *   ./test_resampler 44100:48000 48000:44100
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_aout.h>
+#include <vlc_block.h>
+#include <vlc_filter.h>
+
+#include "libvlc.h"
+#include "../../modules/audio_filter/resampler/polyphase.h"
+
+#define MAX_BLOCK 3000
+#define MAX_CHANNELS 6
+#define TOTAL 40000
+
+/* Enough for the filter of the best quality when downsampling by 6 */
+#define WARMUP 256
+
+/* Largest error to a sine, for each quality */
+static const float pf_tolerance[] = { 2e-2f, 1e-3f, 1e-4f };
+
+/*
+ * The input frame k of channel c is sin( w_c k ), whatever the input rate
+ * is, so that the output frame whose time is t should be sin( w_c t ).
+ * The time goes on as in the resampler, in 1/output rate units.
+ */
+typedef struct
+{
+    double   pd_omega[MAX_CHANNELS];
+    unsigned i_channels;
+    unsigned i_out_rate;
+    uint64_t i_in;          /* input frames given */
+    uint64_t i_pos;         /* time of the next output frame */
+    uint64_t i_rem;
+} sine_t;
+
+static void SineInit( sine_t *p_sine, unsigned i_channels, unsigned i_in_rate,
+                      unsigned i_out_rate )
+{
+    /* Well within the pass band of every quality */
+    const double d_base = 2. * M_PI * .05 * __MIN( i_in_rate, i_out_rate )
+                        / i_in_rate;
+
+    for( unsigned c = 0; c < i_channels; c++ )
+        p_sine->pd_omega[c] = d_base * ( 1. + .3 * c );
+    p_sine->i_channels = i_channels;
+    p_sine->i_out_rate = i_out_rate;
+    p_sine->i_in = 0;
+    p_sine->i_pos = 0;
+    p_sine->i_rem = 0;
+}
+
+static float SineAt( const sine_t *p_sine, unsigned c, double t )
+{
+    return sin( p_sine->pd_omega[c] * t );
+}
+
+static void SineFill( sine_t *p_sine, float *p_buffer, unsigned i_frames )
+{
+    for( unsigned i = 0; i < i_frames; i++, p_sine->i_in++ )
+        for( unsigned c = 0; c < p_sine->i_channels; c++ )
+            p_buffer[i * p_sine->i_channels + c] =
+                SineAt( p_sine, c, p_sine->i_in );
+}
+
+/* Checks the output frames, and returns the largest error past i_skip */
+static float SineCheck( sine_t *p_sine, const float *p_buffer,
+                        unsigned i_frames, unsigned i_in_rate,
+                        uint64_t i_skip_start, uint64_t i_skip_end )
+{
+    float f_max = 0.f;
+
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        const double t = p_sine->i_pos
+                       + (double)p_sine->i_rem / p_sine->i_out_rate;
+
+        if( t >= WARMUP && ( t < i_skip_start || t >= i_skip_end ) )
+            for( unsigned c = 0; c < p_sine->i_channels; c++ )
+                f_max = __MAX( f_max,
+                               fabsf( p_buffer[i * p_sine->i_channels + c]
+                                      - SineAt( p_sine, c, t ) ) );
+
+        p_sine->i_rem += i_in_rate;
+        p_sine->i_pos += p_sine->i_rem / p_sine->i_out_rate;
+        p_sine->i_rem %= p_sine->i_out_rate;
+    }
+    return f_max;
+}
+
+/* The input frames not output yet, from the next output frame rounded */
+static void CheckDrain( polyphase_t *p_poly, const sine_t *p_sine )
+{
+    const uint64_t i_next = p_sine->i_pos
+                          + ( 2 * p_sine->i_rem >= p_sine->i_out_rate );
+    const unsigned i_pending = polyphase_Pending( p_poly );
+    float *p_drain = malloc( ( i_pending + 1 ) * p_sine->i_channels
+                             * sizeof(float) );
+
+    assert( p_drain != NULL );
+    assert( i_next <= p_sine->i_in );
+    assert( i_pending == p_sine->i_in - i_next );
+    assert( polyphase_Drain( p_poly, p_drain ) == i_pending );
+    for( unsigned i = 0; i < i_pending; i++ )
+        for( unsigned c = 0; c < p_sine->i_channels; c++ )
+            assert( p_drain[i * p_sine->i_channels + c] ==
+                    (float)SineAt( p_sine, c, i_next + i ) );
+    assert( polyphase_Pending( p_poly ) == 0 );
+    free( p_drain );
+}
+
+/*
+ * Resamples TOTAL frames, at i_in_rate moved by i_drift at most for each
+ * block, or by i_jump in the middle
+ */
+static void test_sine( unsigned i_cpu, int i_quality, unsigned i_channels,
+                       unsigned i_in_rate, unsigned i_out_rate,
+                       unsigned i_drift, unsigned i_jump )
+{
+    polyphase_t *p_poly = polyphase_New( i_channels, i_out_rate,
+                                         i_in_rate + i_jump + 100 * i_drift,
+                                         i_quality, i_cpu );
+    float *p_in = malloc( MAX_BLOCK * i_channels * sizeof(float) );
+    float *p_out = NULL;
+    uint64_t i_skip_start = UINT64_MAX, i_skip_end = UINT64_MAX;
+    unsigned i_rate = i_in_rate;
+    float f_error = 0.f;
+    sine_t sine;
+
+    assert( p_poly != NULL && p_in != NULL );
+    SineInit( &sine, i_channels, i_in_rate, i_out_rate );
+
+    while( sine.i_in < TOTAL )
+    {
+        const unsigned i_frames = 1 + rand() % MAX_BLOCK;
+        unsigned i_max, i_done;
+        float f_block;
+
+        if( i_drift > 0 )
+        {
+            i_rate += (int)( rand() % ( 2 * i_drift + 1 ) ) - (int)i_drift;
+            i_rate = __MAX( i_in_rate - 100 * i_drift,
+                            __MIN( i_rate, i_in_rate + 100 * i_drift ) );
+        }
+        if( i_jump > 0 && i_rate == i_in_rate && sine.i_in >= TOTAL / 2 )
+        {
+            /* The resampler may have to fill a longer filter with zeros */
+            i_rate += i_jump;
+            i_skip_start = sine.i_in - WARMUP;
+            i_skip_end = sine.i_in + WARMUP;
+        }
+
+        i_max = polyphase_OutputSize( p_poly, i_frames, i_rate );
+        p_out = realloc( p_out, ( i_max + 1 ) * i_channels * sizeof(float) );
+        assert( p_out != NULL );
+        SineFill( &sine, p_in, i_frames );
+        i_done = polyphase_Resample( p_poly, i_rate, p_out, i_max,
+                                     p_in, i_frames );
+        assert( i_done <= i_max );
+        f_block = SineCheck( &sine, p_out, i_done, i_rate,
+                             i_skip_start, i_skip_end );
+        f_error = __MAX( f_error, f_block );
+    }
+
+    /* All of the input but about a filter length has been output */
+    assert( sine.i_pos + 2 * WARMUP >= sine.i_in );
+    if( f_error > pf_tolerance[i_quality] )
+        fprintf( stderr, "quality %d, %u channels, %u->%u Hz (drift %u,"
+                 " jump %u): error %g\n", i_quality, i_channels, i_in_rate,
+                 i_out_rate, i_drift, i_jump, f_error );
+    assert( f_error <= pf_tolerance[i_quality] );
+
+    CheckDrain( p_poly, &sine );
+
+    free( p_out );
+    free( p_in );
+    polyphase_Delete( p_poly );
+}
+
+static const unsigned pp_rates[][2] = {
+    { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 }, { 48000, 8000 },
+    { 32000, 48000 },
+};
+#define RATES (sizeof(pp_rates) / sizeof(pp_rates[0]))
+
+static void test_qualities( unsigned i_cpu )
+{
+    static const unsigned pi_channels[] = { 1, 2, 6 };
+
+    for( int q = POLYPHASE_FAST; q <= POLYPHASE_BEST; q++ )
+    {
+        for( unsigned i = 0; i < RATES; i++ )
+            for( unsigned j = 0; j < 3; j++ )
+                test_sine( i_cpu, q, pi_channels[j], pp_rates[i][0],
+                           pp_rates[i][1], 0, 0 );
+
+        /* The audio output corrects the drift by a few Hz at a time */
+        test_sine( i_cpu, q, 2, 44100, 48000, 2, 0 );
+        test_sine( i_cpu, q, 2, 48000, 48000, 2, 0 );
+        /* and the playback speed changes the rate at once */
+        test_sine( i_cpu, q, 2, 44100, 48000, 0, 22050 );
+        test_sine( i_cpu, q, 6, 48000, 44100, 0, 48000 );
+    }
+}
+
+/* The SIMD kernels only differ from the C one by the rounding */
+static void test_simd( unsigned i_cpu )
+{
+    float *p_in = malloc( MAX_BLOCK * MAX_CHANNELS * sizeof(float) );
+
+    assert( p_in != NULL );
+    for( int q = POLYPHASE_FAST; q <= POLYPHASE_BEST; q++ )
+        for( unsigned i = 0; i < RATES; i++ )
+        {
+            const unsigned i_in_rate = pp_rates[i][0];
+            polyphase_t *p_c = polyphase_New( MAX_CHANNELS, pp_rates[i][1],
+                                              i_in_rate, q, 0 );
+            polyphase_t *p_simd = polyphase_New( MAX_CHANNELS, pp_rates[i][1],
+                                                 i_in_rate, q, i_cpu );
+            sine_t sine;
+
+            assert( p_c != NULL && p_simd != NULL );
+            SineInit( &sine, MAX_CHANNELS, i_in_rate, pp_rates[i][1] );
+            while( sine.i_in < TOTAL / 4 )
+            {
+                const unsigned i_frames = 1 + rand() % MAX_BLOCK;
+                const unsigned i_max = polyphase_OutputSize( p_c, i_frames,
+                                                             i_in_rate );
+                float *p_ref = malloc( i_max * MAX_CHANNELS * sizeof(float) );
+                float *p_out = malloc( i_max * MAX_CHANNELS * sizeof(float) );
+                unsigned i_done;
+
+                assert( p_ref != NULL && p_out != NULL );
+                SineFill( &sine, p_in, i_frames );
+                i_done = polyphase_Resample( p_c, i_in_rate, p_ref, i_max,
+                                             p_in, i_frames );
+                assert( polyphase_Resample( p_simd, i_in_rate, p_out, i_max,
+                                            p_in, i_frames ) == i_done );
+                for( unsigned k = 0; k < i_done * MAX_CHANNELS; k++ )
+                    assert( fabsf( p_ref[k] - p_out[k] ) <= 1e-5f );
+                free( p_out );
+                free( p_ref );
+            }
+            polyphase_Delete( p_simd );
+            polyphase_Delete( p_c );
+        }
+    free( p_in );
+}
+
+/*
+ * Throughput, in frames per second
+ */
+#define BENCH_CHANNELS 2
+#define BENCH_BLOCK 1024
+
+static void bench_poly( const char *psz_name, unsigned i_cpu, int i_quality,
+                        unsigned i_in_rate, unsigned i_out_rate )
+{
+    polyphase_t *p_poly = polyphase_New( BENCH_CHANNELS, i_out_rate,
+                                         i_in_rate, i_quality, i_cpu );
+    const unsigned i_max = polyphase_OutputSize( p_poly, BENCH_BLOCK,
+                                                 i_in_rate );
+    float *p_in = calloc( BENCH_BLOCK * BENCH_CHANNELS, sizeof(float) );
+    float *p_out = malloc( i_max * BENCH_CHANNELS * sizeof(float) );
+    mtime_t i_start = mdate(), i_time;
+    int64_t i_total = 0;
+
+    assert( p_poly != NULL && p_in != NULL && p_out != NULL );
+    do
+    {
+        polyphase_Resample( p_poly, i_in_rate, p_out, i_max,
+                            p_in, BENCH_BLOCK );
+        i_total += BENCH_BLOCK;
+    } while( (i_time = mdate() - i_start) < 1000000 );
+
+    printf( "%u->%u Hz %-6s quality %d %10.0f frames/s\n", i_in_rate,
+            i_out_rate, psz_name, i_quality, i_total * 1000000. / i_time );
+    free( p_out );
+    free( p_in );
+    polyphase_Delete( p_poly );
+}
+
+static block_t *BufferNew( filter_t *p_filter, int i_size )
+{
+    VLC_UNUSED( p_filter );
+    return block_New( p_filter, i_size );
+}
+
+static void bench_bandlimited( vlc_object_t *p_obj, unsigned i_in_rate,
+                               unsigned i_out_rate )
+{
+    filter_t *p_filter = vlc_object_create( p_obj, sizeof( filter_t ) );
+    mtime_t i_start, i_time;
+    int64_t i_total = 0;
+
+    assert( p_filter != NULL );
+    es_format_Init( &p_filter->fmt_in, AUDIO_ES, VLC_FOURCC('f','l','3','2') );
+    p_filter->fmt_in.audio.i_rate = i_in_rate;
+    p_filter->fmt_in.audio.i_channels = BENCH_CHANNELS;
+    p_filter->fmt_in.audio.i_physical_channels =
+    p_filter->fmt_in.audio.i_original_channels = AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT;
+    p_filter->fmt_in.audio.i_bitspersample = 32;
+    p_filter->fmt_out = p_filter->fmt_in;
+    p_filter->fmt_out.audio.i_rate = i_out_rate;
+    p_filter->pf_audio_buffer_new = BufferNew;
+
+    p_filter->p_module = module_Need( p_filter, "audio filter2",
+                                      "bandlimited", true );
+    if( p_filter->p_module == NULL )
+    {
+        printf( "%u->%u Hz bandlimited not available\n", i_in_rate,
+                i_out_rate );
+        vlc_object_release( p_filter );
+        return;
+    }
+
+    i_start = mdate();
+    do
+    {
+        block_t *p_block = block_New( p_filter, BENCH_BLOCK * BENCH_CHANNELS
+                                                * sizeof(float) );
+
+        assert( p_block != NULL );
+        memset( p_block->p_buffer, 0, p_block->i_buffer );
+        p_block->i_samples = BENCH_BLOCK;
+        p_block->i_pts = p_block->i_dts = 1;
+        p_block = p_filter->pf_audio_filter( p_filter, p_block );
+        if( p_block )
+            block_Release( p_block );
+        i_total += BENCH_BLOCK;
+    } while( (i_time = mdate() - i_start) < 1000000 );
+
+    printf( "%u->%u Hz bandlimited           %10.0f frames/s\n", i_in_rate,
+            i_out_rate, i_total * 1000000. / i_time );
+
+    module_Unneed( p_filter, p_filter->p_module );
+    vlc_object_release( p_filter );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--no-plugins-cache",
+        "--plugin-path=../../modules"
+    };
+    const unsigned i_cpu = CPUCapabilities();
+    libvlc_int_t *p_libvlc = NULL;
+
+    srand( 0 );
+    test_qualities( 0 );
+    test_qualities( i_cpu );
+    test_simd( i_cpu );
+
+    if( i_argc > 1 )
+    {
+        p_libvlc = libvlc_InternalCreate();
+        assert( p_libvlc != NULL );
+        assert( libvlc_InternalInit( p_libvlc, 5, ppsz_vlc_argv ) == 0 );
+    }
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        unsigned i_in_rate, i_out_rate;
+
+        if( sscanf( ppsz_argv[i], "%u:%u", &i_in_rate, &i_out_rate ) != 2
+         || i_in_rate == 0 || i_out_rate == 0 )
+        {
+            fprintf( stderr, "%s: not a couple of rates\n", ppsz_argv[i] );
+            continue;
+        }
+        for( int q = POLYPHASE_FAST; q <= POLYPHASE_BEST; q++ )
+        {
+            bench_poly( "C", 0, q, i_in_rate, i_out_rate );
+            bench_poly( "SIMD", i_cpu, q, i_in_rate, i_out_rate );
+        }
+        bench_bandlimited( VLC_OBJECT(p_libvlc), i_in_rate, i_out_rate );
+    }
+
+    if( p_libvlc != NULL )
+    {
+        libvlc_InternalCleanup( p_libvlc );
+        libvlc_InternalDestroy( p_libvlc );
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*****************************************************************************
+ * deinterlace_yadif.c: Test and benchmark for the yadif deinterlacer
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks that every line filter variant gives the
+ * same pictures as the C one, whatever the number of threads, on random
+ * pictures of various sizes. Given picture sizes, it also reports the
+ * throughput of each variant with 1, 2, 4 and 8 threads, in single and
+ * double frame rate modes:
+ *   ./test_yadif 1920x1080 720x576
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_vout.h>
+
+#include "libvlc.h"
+#include "../../modules/video_filter/yadif.h"
+
+#define I420 VLC_FOURCC('I','4','2','0')
+#define I422 VLC_FOURCC('I','4','2','2')
+
+/* The variants of the line filter, selected by the CPU flags */
+static const struct
+{
+    const char *psz_name;
+    unsigned    i_cpu;
+} p_variants[] =
+{
+    { "C",     0 },
+    { "SSE2",  CPU_CAPABILITY_SSE2 },
+    { "SSSE3", CPU_CAPABILITY_SSE2 | CPU_CAPABILITY_SSSE3 },
+};
+#define VARIANTS (sizeof(p_variants) / sizeof(p_variants[0]))
+
+static vlc_object_t *p_obj;
+static uint32_t i_cpu_detected;
+
+static yadif_t *new_variant( unsigned i, unsigned i_threads )
+{
+    yadif_t *p_yadif;
+
+    if( (i_cpu_detected & p_variants[i].i_cpu) != p_variants[i].i_cpu )
+        return NULL;
+    cpu_flags = (i_cpu_detected & ~(CPU_CAPABILITY_SSE2|CPU_CAPABILITY_SSSE3))
+              | p_variants[i].i_cpu;
+    p_yadif = yadif_New( p_obj, i_threads );
+    assert( p_yadif != NULL );
+    if( strcmp( yadif_GetKernel( p_yadif ), p_variants[i].psz_name ) )
+    {
+        /* Not built in */
+        yadif_Delete( p_yadif );
+        return NULL;
+    }
+    return p_yadif;
+}
+
+/* Random pictures, with some smooth areas so that every branch is taken */
+static void fill_random( picture_t *p_pic, int i_motion, const picture_t *p_ref )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                uint8_t *p_px = &p->p_pixels[y * p->i_pitch + x];
+
+                if( p_ref != NULL && rand() % 100 >= i_motion )
+                    *p_px = p_ref->p[i].p_pixels[y * p->i_pitch + x];
+                else if( (x / 8 + y / 8) % 3 == 0 )
+                    *p_px = 16 + x + 2 * y;
+                else
+                    *p_px = rand();
+            }
+    }
+}
+
+static bool same_pixels( const picture_t *p_a, const picture_t *p_b )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+        for( int y = 0; y < p_a->p[i].i_visible_lines; y++ )
+            if( memcmp( &p_a->p[i].p_pixels[y * p_a->p[i].i_pitch],
+                        &p_b->p[i].p_pixels[y * p_b->p[i].i_pitch],
+                        p_a->p[i].i_visible_pitch ) )
+                return false;
+    return true;
+}
+
+static void test_size( vlc_fourcc_t i_chroma, int i_width, int i_height )
+{
+    picture_t *pp_in[3], *p_ref, *p_out;
+    const vlc_fourcc_t i_out_chroma = i_chroma == I422 ? I420 : i_chroma;
+
+    for( int i = 0; i < 3; i++ )
+    {
+        pp_in[i] = picture_New( i_chroma, i_width, i_height, 0 );
+        assert( pp_in[i] != NULL );
+        fill_random( pp_in[i], i == 0 ? 100 : 30, i ? pp_in[i - 1] : NULL );
+    }
+    p_ref = picture_New( i_out_chroma, i_width, i_height, 0 );
+    p_out = picture_New( i_out_chroma, i_width, i_height, 0 );
+    assert( p_ref != NULL && p_out != NULL );
+
+    for( int i_field = 0; i_field < 2; i_field++ )
+        for( int b_tff = 0; b_tff < 2; b_tff++ )
+        {
+            yadif_t *p_yadif = new_variant( 0, 1 );
+
+            yadif_Filter( p_yadif, p_ref, pp_in[0], pp_in[1], pp_in[2],
+                          i_field, b_tff );
+            yadif_Delete( p_yadif );
+
+            /* The kept field is copied as is */
+            for( int y = i_field; y < p_ref->p[0].i_visible_lines; y += 2 )
+                assert( !memcmp( &p_ref->p[0].p_pixels[y * p_ref->p[0].i_pitch],
+                                 &pp_in[1]->p[0].p_pixels[y * pp_in[1]->p[0].i_pitch],
+                                 i_width ) );
+
+            for( unsigned i = 0; i < VARIANTS; i++ )
+                for( unsigned i_threads = 1; i_threads <= 5; i_threads += 2 )
+                {
+                    if( (p_yadif = new_variant( i, i_threads )) == NULL )
+                        continue;
+                    for( int j = 0; j < p_out->i_planes; j++ )
+                        memset( p_out->p[j].p_pixels, 0x5a,
+                                p_out->p[j].i_pitch * p_out->p[j].i_lines );
+                    yadif_Filter( p_yadif, p_out, pp_in[0], pp_in[1],
+                                  pp_in[2], i_field, b_tff );
+                    assert( same_pixels( p_ref, p_out ) );
+                    yadif_Delete( p_yadif );
+                }
+        }
+
+    /* Still pictures without details are left alone */
+    for( int i = 0; i < 3; i++ )
+        for( int j = 0; j < pp_in[i]->i_planes; j++ )
+            memset( pp_in[i]->p[j].p_pixels, 100 + j,
+                    pp_in[i]->p[j].i_pitch * pp_in[i]->p[j].i_lines );
+    for( unsigned i = 0; i < VARIANTS; i++ )
+    {
+        yadif_t *p_yadif = new_variant( i, 2 );
+
+        if( p_yadif == NULL )
+            continue;
+        yadif_Filter( p_yadif, p_out, pp_in[0], pp_in[1], pp_in[2], 1, true );
+        for( int j = 0; j < p_out->i_planes; j++ )
+            for( int y = 0; y < p_out->p[j].i_visible_lines; y++ )
+                for( int x = 0; x < p_out->p[j].i_visible_pitch; x++ )
+                    assert( p_out->p[j].p_pixels[y * p_out->p[j].i_pitch + x]
+                            == 100 + j );
+        yadif_Delete( p_yadif );
+    }
+
+    for( int i = 0; i < 3; i++ )
+        picture_Release( pp_in[i] );
+    picture_Release( p_ref );
+    picture_Release( p_out );
+}
+
+static void bench_size( int i_width, int i_height )
+{
+    static const unsigned p_threads[] = { 1, 2, 4, 8 };
+    picture_t *pp_in[4], *p_out;
+
+    for( int i = 0; i < 4; i++ )
+    {
+        pp_in[i] = picture_New( I420, i_width, i_height, 0 );
+        assert( pp_in[i] != NULL );
+        fill_random( pp_in[i], 20, i ? pp_in[i - 1] : NULL );
+    }
+    p_out = picture_New( I420, i_width, i_height, 0 );
+    assert( p_out != NULL );
+
+    printf( "%dx%d I420:\n", i_width, i_height );
+    for( unsigned i = 0; i < VARIANTS; i++ )
+        for( unsigned t = 0; t < sizeof(p_threads) / sizeof(p_threads[0]);
+             t++ )
+        {
+            yadif_t *p_yadif = new_variant( i, p_threads[t] );
+            mtime_t i_start, i_time;
+            char psz_name[32];
+            int i_frames = 0;
+
+            if( p_yadif == NULL )
+                continue;
+
+            /* One output picture per input picture, or two for yadif2x */
+            i_start = mdate();
+            do
+            {
+                const int k = i_frames++ % 2;
+
+                yadif_Filter( p_yadif, p_out, pp_in[k], pp_in[k + 1],
+                              pp_in[k + 2], 0, true );
+            } while( (i_time = mdate() - i_start) < 500000 );
+            yadif_Delete( p_yadif );
+
+            snprintf( psz_name, sizeof(psz_name), "%s x%u",
+                      p_variants[i].psz_name, p_threads[t] );
+            printf( "  %-10s %8.1f fps yadif, %8.1f fps yadif2x, "
+                    "%7.1f Mpixel/s\n", psz_name,
+                    i_frames * 1000000. / i_time,
+                    i_frames * 500000. / i_time,
+                    (double)i_frames * i_width * i_height / i_time );
+        }
+
+    for( int i = 0; i < 4; i++ )
+        picture_Release( pp_in[i] );
+    picture_Release( p_out );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--plugin-path=/dev/null"
+    };
+    static const int p_sizes[][2] = {
+        { 2, 2 }, { 6, 4 }, { 14, 6 }, { 17, 9 }, { 64, 32 }, { 131, 47 },
+        { 320, 240 },
+    };
+    libvlc_int_t *p_libvlc = libvlc_InternalCreate();
+
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 4, ppsz_vlc_argv ) == 0 );
+    p_obj = VLC_OBJECT(p_libvlc);
+    i_cpu_detected = CPUCapabilities();
+
+    for( unsigned i = 0; i < sizeof(p_sizes) / sizeof(p_sizes[0]); i++ )
+    {
+        test_size( I420, p_sizes[i][0], p_sizes[i][1] );
+        test_size( I422, p_sizes[i][0], p_sizes[i][1] );
+    }
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        int i_width, i_height;
+
+        if( sscanf( ppsz_argv[i], "%dx%d", &i_width, &i_height ) == 2
+         && i_width > 0 && i_height > 0 )
+            bench_size( i_width, i_height );
+        else
+            fprintf( stderr, "%s: not a picture size\n", ppsz_argv[i] );
+    }
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
@@ -0,0 +1,467 @@
+/*****************************************************************************
+ * demux_mkv_block.c: Test for the Matroska block reader
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks the element headers, the integers, the
+ * four lacings and the block groups on blocks built here, and that broken
+ * ones are refused. With an argument, it also reports how fast clusters
+ * of large video frames and of laced audio frames are read, as the demuxer
+ * does it, in MB/s:
+ *   ./test_mkv_block bench
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "../../modules/demux/mkv_block.h"
+
+#define LACING_NONE  0
+#define LACING_XIPH  1
+#define LACING_FIXED 2
+#define LACING_EBML  3
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    size_t   i_alloc;
+} buffer_t;
+
+static uint8_t *Grow( buffer_t *b, size_t i_size )
+{
+    if( b->i_size + i_size > b->i_alloc )
+    {
+        b->i_alloc = 2 * ( b->i_size + i_size );
+        b->p = realloc( b->p, b->i_alloc );
+        assert( b->p != NULL );
+    }
+    b->i_size += i_size;
+    return &b->p[b->i_size - i_size];
+}
+
+static void PutByte( buffer_t *b, uint8_t i_byte )
+{
+    *Grow( b, 1 ) = i_byte;
+}
+
+/* Variable size integer of i_len bytes, the shortest one if 0 */
+static void PutVint( buffer_t *b, uint64_t i_value, int i_len )
+{
+    if( i_len == 0 )
+        for( i_len = 1; i_value >= ( UINT64_C(1) << ( 7 * i_len ) ) - 1;
+             i_len++ );
+    for( int i = i_len - 1; i >= 0; i-- )
+    {
+        uint8_t i_byte = i_value >> ( 8 * i );
+        if( i == i_len - 1 )
+            i_byte |= 0x80 >> ( i_len - 1 );
+        PutByte( b, i_byte );
+    }
+}
+
+static void PutId( buffer_t *b, uint32_t i_id )
+{
+    for( int i = 3; i >= 0; i-- )
+        if( i_id >> ( 8 * i ) )
+            PutByte( b, i_id >> ( 8 * i ) );
+}
+
+static void PutElement( buffer_t *b, uint32_t i_id, const buffer_t *p_payload )
+{
+    PutId( b, i_id );
+    PutVint( b, p_payload->i_size, 0 );
+    memcpy( Grow( b, p_payload->i_size ), p_payload->p, p_payload->i_size );
+}
+
+static void PutUIntElement( buffer_t *b, uint32_t i_id, uint64_t i_value,
+                            int i_len )
+{
+    PutId( b, i_id );
+    PutVint( b, i_len, 0 );
+    for( int i = i_len - 1; i >= 0; i-- )
+        PutByte( b, i_value >> ( 8 * i ) );
+}
+
+/* The payload of a block of the given frames, with their content */
+static void PutBlock( buffer_t *b, uint64_t i_track, int16_t i_timecode,
+                      uint8_t i_flags, int i_lacing, unsigned i_frames,
+                      const uint32_t *pi_frame )
+{
+    PutVint( b, i_track, 0 );
+    PutByte( b, (uint16_t)i_timecode >> 8 );
+    PutByte( b, i_timecode & 0xff );
+    PutByte( b, i_flags | ( i_lacing << 1 ) );
+
+    if( i_lacing != LACING_NONE )
+        PutByte( b, i_frames - 1 );
+
+    for( unsigned i = 0; i + 1 < i_frames; i++ )
+    {
+        if( i_lacing == LACING_XIPH )
+        {
+            uint32_t i_size = pi_frame[i];
+            for( ; i_size >= 255; i_size -= 255 )
+                PutByte( b, 255 );
+            PutByte( b, i_size );
+        }
+        else if( i_lacing == LACING_EBML && i == 0 )
+        {
+            PutVint( b, pi_frame[0], 0 );
+        }
+        else if( i_lacing == LACING_EBML )
+        {
+            int64_t i_delta = (int64_t)pi_frame[i] - pi_frame[i - 1];
+            int i_len = 1;
+
+            while( i_delta > ( INT64_C(1) << ( 7 * i_len - 1 ) ) - 2 ||
+                   -i_delta > ( INT64_C(1) << ( 7 * i_len - 1 ) ) - 1 )
+                i_len++;
+            PutVint( b, i_delta + ( INT64_C(1) << ( 7 * i_len - 1 ) ) - 1,
+                     i_len );
+        }
+    }
+
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        uint8_t *p = Grow( b, pi_frame[i] );
+        for( uint32_t j = 0; j < pi_frame[i]; j++ )
+            p[j] = i * 16 + j;
+    }
+}
+
+static void CheckFrames( const mkv_block_t *p_block, unsigned i_frames,
+                         const uint32_t *pi_frame )
+{
+    assert( p_block->i_frames == i_frames );
+    for( unsigned i = 0; i < i_frames; i++ )
+    {
+        assert( p_block->i_frame[i] == pi_frame[i] );
+        for( uint32_t j = 0; j < pi_frame[i]; j++ )
+            assert( p_block->p_frame[i][j] == (uint8_t)( i * 16 + j ) );
+    }
+}
+
+static void test_header( void )
+{
+    static const uint8_t p_simple[] = { 0xA3, 0x85 };
+    static const uint8_t p_cluster[] = { 0x1F, 0x43, 0xB6, 0x75,
+                                         0x01, 0xFF, 0xFF, 0xFF,
+                                         0xFF, 0xFF, 0xFF, 0xFF };
+    static const uint8_t p_long[] = { 0x1F, 0x43, 0xB6, 0x75,
+                                      0x41, 0x00 };
+    static const uint8_t p_invalid[] = { 0x00, 0x81 };
+    static const uint8_t p_no_size[] = { 0xA3, 0x00 };
+    uint32_t i_id;
+    uint64_t i_size;
+
+    assert( mkv_ReadHeader( p_simple, 2, &i_id, &i_size ) == 2 );
+    assert( i_id == MKV_ID_SIMPLEBLOCK && i_size == 5 );
+    assert( mkv_ReadHeader( p_simple, 1, &i_id, &i_size ) == 0 );
+
+    assert( mkv_ReadHeader( p_cluster, 12, &i_id, &i_size ) == 12 );
+    assert( i_id == 0x1F43B675 && i_size == MKV_SIZE_UNKNOWN );
+    assert( mkv_ReadHeader( p_cluster, 11, &i_id, &i_size ) == 0 );
+
+    assert( mkv_ReadHeader( p_long, 6, &i_id, &i_size ) == 6 );
+    assert( i_id == 0x1F43B675 && i_size == 0x100 );
+
+    assert( mkv_ReadHeader( p_invalid, 2, &i_id, &i_size ) == 0 );
+    assert( mkv_ReadHeader( p_no_size, 2, &i_id, &i_size ) == 0 );
+}
+
+static void test_integers( void )
+{
+    static const uint8_t p_data[] = { 0xFF, 0xFE, 0x01, 0x02, 0x03,
+                                      0x04, 0x05, 0x06, 0x07 };
+    uint64_t i_uint;
+    int64_t i_sint;
+
+    assert( !mkv_ReadUInt( p_data, 0, &i_uint ) && i_uint == 0 );
+    assert( !mkv_ReadUInt( p_data, 2, &i_uint ) && i_uint == 0xFFFE );
+    assert( !mkv_ReadUInt( p_data + 2, 3, &i_uint ) && i_uint == 0x010203 );
+    assert( mkv_ReadUInt( p_data, 9, &i_uint ) );
+
+    assert( !mkv_ReadSInt( p_data, 2, &i_sint ) && i_sint == -2 );
+    assert( !mkv_ReadSInt( p_data, 1, &i_sint ) && i_sint == -1 );
+    assert( !mkv_ReadSInt( p_data + 2, 2, &i_sint ) && i_sint == 0x0102 );
+    assert( !mkv_ReadSInt( p_data, 8, &i_sint ) &&
+            i_sint == (int64_t)UINT64_C(0xFFFE010203040506) );
+    assert( mkv_ReadSInt( p_data, 9, &i_sint ) );
+}
+
+static void test_lacing( int i_lacing, unsigned i_frames,
+                         const uint32_t *pi_frame )
+{
+    buffer_t b = { NULL, 0, 0 };
+    mkv_block_t block;
+
+    PutBlock( &b, 200, -1234, 0x81, i_lacing, i_frames, pi_frame );
+    assert( !mkv_BlockParse( &block, b.p, b.i_size, true ) );
+    assert( block.i_track == 200 && block.i_timecode == -1234 );
+    assert( block.b_simple && block.b_keyframe && block.b_discardable );
+    CheckFrames( &block, i_frames, pi_frame );
+
+    /* The flags are those of SimpleBlock only */
+    assert( !mkv_BlockParse( &block, b.p, b.i_size, false ) );
+    assert( !block.b_simple && !block.b_keyframe && !block.b_discardable );
+
+    /* Truncated in the lace sizes */
+    if( ( i_lacing == LACING_XIPH || i_lacing == LACING_EBML ) &&
+        i_frames > 1 )
+        assert( mkv_BlockParse( &block, b.p, 5, true ) );
+    /* Truncated in the frames */
+    if( ( i_lacing == LACING_XIPH || i_lacing == LACING_EBML ) &&
+        i_frames > 1 && pi_frame[0] > 0 )
+    {
+        size_t i_frames_size = 0;
+        for( unsigned i = 0; i < i_frames; i++ )
+            i_frames_size += pi_frame[i];
+        assert( mkv_BlockParse( &block, b.p,
+                                b.i_size - i_frames_size + pi_frame[0] - 1,
+                                true ) );
+    }
+
+    free( b.p );
+}
+
+static void test_blocks( void )
+{
+    static const uint32_t pi_one[] = { 1000 };
+    static const uint32_t pi_xiph[] = { 0, 254, 255, 256, 600, 13 };
+    static const uint32_t pi_ebml[] = { 5000, 10, 70000, 69990, 0, 300 };
+    static const uint32_t pi_fixed[] = { 417, 417, 417, 417 };
+    uint32_t pi_many[MKV_FRAMES_MAX];
+    buffer_t b = { NULL, 0, 0 };
+    mkv_block_t block;
+
+    for( unsigned i = 0; i < MKV_FRAMES_MAX; i++ )
+        pi_many[i] = ( i * 37 ) % 300;
+
+    test_lacing( LACING_NONE, 1, pi_one );
+    test_lacing( LACING_XIPH, 6, pi_xiph );
+    test_lacing( LACING_XIPH, 1, pi_one );
+    test_lacing( LACING_XIPH, MKV_FRAMES_MAX, pi_many );
+    test_lacing( LACING_EBML, 6, pi_ebml );
+    test_lacing( LACING_EBML, MKV_FRAMES_MAX, pi_many );
+    test_lacing( LACING_FIXED, 4, pi_fixed );
+
+    /* Fixed size lacing of frames which cannot have the same size */
+    PutBlock( &b, 1, 0, 0, LACING_FIXED, 1, pi_one );
+    b.p[4] = 2;
+    assert( mkv_BlockParse( &block, b.p, b.i_size, true ) );
+    b.i_size = 0;
+
+    /* EBML lacing going below 0 */
+    PutBlock( &b, 1, 0, 0, LACING_EBML, 6, pi_ebml );
+    b.p[5] = 0x40; /* 1 instead of 5000 for the first frame */
+    b.p[6] = 0x01;
+    assert( mkv_BlockParse( &block, b.p, b.i_size, true ) );
+    b.i_size = 0;
+
+    /* No room for the timecode and the flags */
+    PutBlock( &b, 1, 0, 0, LACING_NONE, 1, pi_one );
+    assert( mkv_BlockParse( &block, b.p, 3, true ) );
+    assert( mkv_BlockParse( &block, b.p, 0, true ) );
+
+    free( b.p );
+}
+
+static void test_groups( void )
+{
+    static const uint32_t pi_frame[] = { 3000 };
+    buffer_t b = { NULL, 0, 0 }, group = { NULL, 0, 0 },
+             payload = { NULL, 0, 0 };
+    mkv_block_t block;
+
+    /* Block, duration, references and a child which does not matter */
+    PutUIntElement( &group, 0xFA /* ReferencePriority */, 1, 1 );
+    PutBlock( &payload, 3, 100, 0x80, LACING_NONE, 1, pi_frame );
+    PutElement( &group, MKV_ID_BLOCK, &payload );
+    PutUIntElement( &group, MKV_ID_BLOCK_DURATION, 4000, 2 );
+    PutUIntElement( &group, MKV_ID_REFERENCE_BLOCK, 0xFFD8, 2 ); /* -40 */
+    PutUIntElement( &group, MKV_ID_REFERENCE_BLOCK, 0, 1 );
+    PutUIntElement( &group, MKV_ID_REFERENCE_BLOCK, 80, 1 );
+    PutUIntElement( &group, MKV_ID_REFERENCE_BLOCK, 120, 1 );
+
+    assert( !mkv_BlockGroupParse( &block, group.p, group.i_size ) );
+    assert( block.i_track == 3 && block.i_timecode == 100 );
+    assert( !block.b_simple && !block.b_keyframe );
+    assert( block.b_duration && block.i_duration == 4000 );
+    assert( block.i_reference[0] == -40 && block.i_reference[1] == 80 );
+    CheckFrames( &block, 1, pi_frame );
+
+    /* A key frame: no references, nor duration */
+    group.i_size = 0;
+    PutElement( &group, MKV_ID_BLOCK, &payload );
+    assert( !mkv_BlockGroupParse( &block, group.p, group.i_size ) );
+    assert( !block.b_duration );
+    assert( block.i_reference[0] == 0 && block.i_reference[1] == 0 );
+
+    /* A child going out of the group */
+    assert( mkv_BlockGroupParse( &block, group.p, group.i_size - 1 ) );
+
+    /* No block */
+    group.i_size = 0;
+    PutUIntElement( &group, MKV_ID_BLOCK_DURATION, 4000, 2 );
+    assert( mkv_BlockGroupParse( &block, group.p, group.i_size ) );
+
+    /* Two blocks */
+    group.i_size = 0;
+    PutElement( &group, MKV_ID_BLOCK, &payload );
+    PutElement( &group, MKV_ID_BLOCK, &payload );
+    assert( mkv_BlockGroupParse( &block, group.p, group.i_size ) );
+
+    /* In a cluster */
+    group.i_size = 0;
+    PutElement( &group, MKV_ID_BLOCK, &payload );
+    PutElement( &b, MKV_ID_BLOCKGROUP, &group );
+    {
+        uint32_t i_id;
+        uint64_t i_size;
+        int i_header = mkv_ReadHeader( b.p, b.i_size, &i_id, &i_size );
+
+        assert( i_header > 0 && i_id == MKV_ID_BLOCKGROUP );
+        assert( i_header + i_size == b.i_size );
+        assert( !mkv_BlockGroupParse( &block, b.p + i_header, i_size ) );
+        CheckFrames( &block, 1, pi_frame );
+    }
+
+    free( b.p );
+    free( group.p );
+    free( payload.p );
+}
+
+/*
+ * Reads a cluster as the demuxer does: element headers, payloads copied
+ * out of the stream buffer, blocks parsed, frames copied into packets.
+ */
+static void bench( const char *psz_name, const buffer_t *p_cluster )
+{
+    uint8_t *p_buffer = malloc( p_cluster->i_size );
+    uint8_t *p_packet = malloc( p_cluster->i_size );
+    mtime_t i_start = mdate(), i_time;
+    int64_t i_total = 0;
+    unsigned i_blocks = 0;
+
+    assert( p_buffer != NULL && p_packet != NULL );
+    do
+    {
+        size_t i_pos = 0;
+
+        while( i_pos < p_cluster->i_size )
+        {
+            mkv_block_t block;
+            uint32_t i_id;
+            uint64_t i_size;
+            int i_header = mkv_ReadHeader( &p_cluster->p[i_pos],
+                                           __MIN( MKV_HEADER_MAX,
+                                                  p_cluster->i_size - i_pos ),
+                                           &i_id, &i_size );
+            assert( i_header > 0 );
+
+            memcpy( p_buffer, &p_cluster->p[i_pos + i_header], i_size );
+            if( i_id == MKV_ID_SIMPLEBLOCK )
+                assert( !mkv_BlockParse( &block, p_buffer, i_size, true ) );
+            else
+                assert( !mkv_BlockGroupParse( &block, p_buffer, i_size ) );
+            for( unsigned i = 0; i < block.i_frames; i++ )
+                memcpy( p_packet, block.p_frame[i], block.i_frame[i] );
+
+            i_pos += i_header + i_size;
+            i_blocks++;
+        }
+        i_total += p_cluster->i_size;
+    } while( (i_time = mdate() - i_start) < 1000000 );
+
+    printf( "%-6s %8.0f MB/s %10.0f blocks/s\n", psz_name,
+            i_total / (double)i_time, i_blocks * 1000000. / i_time );
+
+    free( p_packet );
+    free( p_buffer );
+}
+
+static void test_bench( void )
+{
+    buffer_t video = { NULL, 0, 0 }, audio = { NULL, 0, 0 },
+             payload = { NULL, 0, 0 }, group = { NULL, 0, 0 };
+    uint32_t pi_frame[8];
+
+    /* 1 s of 100 Mbit/s video, as SimpleBlocks and BlockGroups */
+    for( int i = 0; i < 25; i++ )
+    {
+        pi_frame[0] = i % 12 ? 400000 : 1200000;
+        payload.i_size = 0;
+        PutBlock( &payload, 1, i * 40, i % 12 ? 0 : 0x80, LACING_NONE, 1,
+                  pi_frame );
+        if( i % 2 )
+        {
+            PutElement( &video, MKV_ID_SIMPLEBLOCK, &payload );
+        }
+        else
+        {
+            group.i_size = 0;
+            PutElement( &group, MKV_ID_BLOCK, &payload );
+            PutUIntElement( &group, MKV_ID_REFERENCE_BLOCK, 0xD8, 1 );
+            PutElement( &video, MKV_ID_BLOCKGROUP, &group );
+        }
+    }
+
+    /* 1 s of audio, 8 frames of about 400 bytes per block */
+    for( int i = 0; i < 47; i++ )
+    {
+        for( int j = 0; j < 8; j++ )
+            pi_frame[j] = 380 + ( i * 8 + j ) % 40;
+        payload.i_size = 0;
+        PutBlock( &payload, 2, i * 21, 0x80,
+                  i % 2 ? LACING_EBML : LACING_XIPH, 8, pi_frame );
+        PutElement( &audio, MKV_ID_SIMPLEBLOCK, &payload );
+    }
+
+    bench( "video", &video );
+    bench( "audio", &audio );
+
+    free( video.p );
+    free( audio.p );
+    free( payload.p );
+    free( group.p );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    test_header();
+    test_integers();
+    test_blocks();
+    test_groups();
+
+    if( i_argc > 1 )
+        test_bench();
+
+    (void)ppsz_argv;
+    return 0;
+}
@@ -0,0 +1,337 @@
+/*****************************************************************************
+ * demux_mpeg_index.c: Test for the time index of the TS and PS demuxers
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This indexes synthetic TS and PS streams of 25 frames per second, with an
+ * I picture every 12 frames, a wrap of the 33 bits clock and a jump of the
+ * clock, given in pieces of random sizes as the index thread does. It
+ * checks the entries, and that seeking lands on I pictures at or before the
+ * requested time.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+
+#include "../../modules/demux/mpeg_index.h"
+
+#define FRAMES 500
+#define FRAME_DURATION 40000
+#define GOP 12
+/* The clock wraps after 5 s, and jumps by 100 s at 10 s */
+#define CLOCK_START ( (INT64_C(1) << 33) - 5 * 90000 )
+#define JUMP_FRAME 250
+#define JUMP ( 100 * 90000 )
+#define CLOCK_WRAP ((INT64_C(1) << 33) * 100 / 9)
+
+#define GARBAGE 5
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   i_size;
+    size_t   i_alloc;
+} buffer_t;
+
+static uint8_t *Grow( buffer_t *b, size_t i_size )
+{
+    if( b->i_size + i_size > b->i_alloc )
+    {
+        b->i_alloc = 2 * ( b->i_size + i_size );
+        b->p = realloc( b->p, b->i_alloc );
+        assert( b->p != NULL );
+    }
+    b->i_size += i_size;
+    return &b->p[b->i_size - i_size];
+}
+
+/* 90 kHz clock of a frame */
+static int64_t FrameClock( int i_frame )
+{
+    int64_t i_clock = CLOCK_START + (int64_t)i_frame * FRAME_DURATION * 9 / 100;
+
+    if( i_frame >= JUMP_FRAME )
+        i_clock += JUMP - FRAME_DURATION * 9 / 100;
+    return i_clock & ( ( INT64_C(1) << 33 ) - 1 );
+}
+
+/* Time of a frame, as the index counts it */
+static int64_t FrameTime( int i_frame )
+{
+    return (int64_t)( i_frame >= JUMP_FRAME ? i_frame - 1 : i_frame )
+           * FRAME_DURATION;
+}
+
+/* A video PES header, and a sequence header or a P picture */
+static size_t VideoPes( uint8_t *p, bool b_intra )
+{
+    static const uint8_t pes[] = { 0, 0, 1, 0xe0, 0, 0, 0x80, 0x80, 5,
+                                   0x21, 0, 1, 0, 1 };
+
+    memcpy( p, pes, sizeof(pes) );
+    p += sizeof(pes);
+    p[0] = 0; p[1] = 0; p[2] = 1;
+    if( b_intra )
+    {
+        p[3] = 0xb3;
+        p[4] = 0x16; p[5] = 0x01;
+    }
+    else
+    {
+        p[3] = 0x00;
+        p[4] = 0x00; p[5] = 2 << 3;
+    }
+    return sizeof(pes) + 6;
+}
+
+static void TsPacket( buffer_t *b, int i_pid, int64_t i_pcr, bool b_intra )
+{
+    uint8_t *p = Grow( b, 188 );
+    size_t i = 4;
+
+    memset( p, 0xff, 188 );
+    p[0] = 0x47;
+    p[1] = 0x40 | ( i_pid >> 8 );
+    p[2] = i_pid & 0xff;
+    p[3] = 0x10;
+    if( i_pcr >= 0 )
+    {
+        p[3] |= 0x20;
+        p[4] = 7;
+        p[5] = 0x10;
+        p[6] = i_pcr >> 25;
+        p[7] = i_pcr >> 17;
+        p[8] = i_pcr >> 9;
+        p[9] = i_pcr >> 1;
+        p[10] = ( ( i_pcr & 1 ) << 7 ) | 0x7e;
+        p[11] = 0;
+        i = 12;
+    }
+    if( i_pid == 0x100 )
+        VideoPes( &p[i], b_intra );
+    else
+    {
+        /* Audio, which must not be taken for the video stream */
+        static const uint8_t audio[] = { 0, 0, 1, 0xc0, 0, 20, 0x80, 0, 0,
+                                         0, 0, 1, 0xb3 };
+        memcpy( &p[i], audio, sizeof(audio) );
+    }
+}
+
+static void PsPack( buffer_t *b, int64_t i_scr, bool b_intra )
+{
+    uint8_t *p = Grow( b, 14 );
+
+    p[0] = 0; p[1] = 0; p[2] = 1; p[3] = 0xba;
+    p[4] = 0x44 | ( ( i_scr >> 27 ) & 0x38 ) | ( ( i_scr >> 28 ) & 0x03 );
+    p[5] = i_scr >> 20;
+    p[6] = ( ( i_scr >> 12 ) & 0xf8 ) | 0x04 | ( ( i_scr >> 13 ) & 0x03 );
+    p[7] = i_scr >> 5;
+    p[8] = ( ( i_scr << 3 ) & 0xf8 ) | 0x04;
+    p[9] = 0x01;
+    p[10] = 0x01; p[11] = 0x89; p[12] = 0xc3;
+    p[13] = 0xf8;
+
+    /* Audio, then video */
+    static const uint8_t audio[] = { 0, 0, 1, 0xc0, 0, 10, 0x80, 0, 0,
+                                     0, 0, 1, 0xb3, 0, 0, 0 };
+    memcpy( Grow( b, sizeof(audio) ), audio, sizeof(audio) );
+
+    uint8_t video[200];
+    memset( video, 0, sizeof(video) );
+    VideoPes( video, b_intra );
+    SetWBE( &video[4], sizeof(video) - 6 );
+    memcpy( Grow( b, sizeof(video) ), video, sizeof(video) );
+}
+
+static void Build( buffer_t *b, int i_type )
+{
+    memset( Grow( b, GARBAGE ), 0x42, GARBAGE );
+    for( int i = 0; i < FRAMES; i++ )
+    {
+        const bool b_intra = i % GOP == 0;
+
+        if( i_type == MPEG_INDEX_TS )
+        {
+            TsPacket( b, 0x101, -1, false );
+            TsPacket( b, 0x100, FrameClock( i ), b_intra );
+        }
+        else
+            PsPack( b, FrameClock( i ), b_intra );
+    }
+    if( i_type == MPEG_INDEX_PS )
+    {
+        static const uint8_t end[] = { 0, 0, 1, 0xb9 };
+        memcpy( Grow( b, 4 ), end, 4 );
+    }
+}
+
+/* Index the i_size first bytes, in pieces as the thread reads them */
+static mpeg_index_t *Index( const buffer_t *b, int i_type, size_t i_size )
+{
+    mpeg_index_t *p_index = mpeg_index_Create( NULL, i_type, 188 );
+    size_t i_offset = 0, i_data = 0;
+
+    assert( p_index != NULL );
+    while( i_offset + i_data < i_size )
+    {
+        size_t i_read = 1 + rand() % 3000;
+
+        if( i_read > i_size - i_offset - i_data )
+            i_read = i_size - i_offset - i_data;
+        i_data += i_read;
+
+        size_t i_used = mpeg_index_Parse( p_index, &b->p[i_offset], i_data,
+                                          i_offset );
+        assert( i_used <= i_data );
+        i_offset += i_used;
+        i_data -= i_used;
+    }
+    if( i_size == b->i_size )
+        mpeg_index_End( p_index );
+    return p_index;
+}
+
+/* The frame whose clock reference is at i_offset */
+static int FrameAt( const buffer_t *b, int i_type, int64_t i_offset )
+{
+    for( int i = 0; i < FRAMES; i++ )
+    {
+        const uint8_t *p = &b->p[i_offset];
+        int64_t i_clock;
+
+        if( i_type == MPEG_INDEX_TS )
+            i_clock = ( (int64_t)p[6] << 25 ) | ( p[7] << 17 ) |
+                      ( p[8] << 9 ) | ( p[9] << 1 ) | ( p[10] >> 7 );
+        else
+            i_clock = ( (int64_t)(p[4] & 0x38) << 27 ) |
+                      ( (int64_t)(p[4] & 0x03) << 28 ) |
+                      ( p[5] << 20 ) | ( (p[6] & 0xf8) << 12 ) |
+                      ( (p[6] & 0x03) << 13 ) | ( p[7] << 5 ) | ( p[8] >> 3 );
+        if( i_clock == FrameClock( i ) )
+            return i;
+    }
+    return -1;
+}
+
+static void test_index( int i_type )
+{
+    buffer_t b = { NULL, 0, 0 };
+    mpeg_index_entry_t *p_entries;
+    mpeg_index_t *p_index;
+    unsigned i_entries, i_jumps = 0;
+    int64_t i_length, i_offset, i_clock, i_time, i_last;
+
+    Build( &b, i_type );
+    p_index = Index( &b, i_type, b.i_size );
+
+    /* Entries */
+    i_entries = mpeg_index_Entries( p_index, &p_entries );
+    assert( i_entries > FRAMES * FRAME_DURATION / MPEG_INDEX_INTERVAL / 2 );
+    assert( p_entries[0].i_time == 0 );
+    assert( p_entries[0].i_offset == GARBAGE + ( i_type == MPEG_INDEX_TS ? 188 : 0 ) );
+    for( unsigned i = 0; i < i_entries; i++ )
+    {
+        const int i_frame = FrameAt( &b, i_type, p_entries[i].i_offset );
+
+        assert( i_frame >= 0 );
+        assert( p_entries[i].i_time == FrameTime( i_frame ) );
+        assert( !!(p_entries[i].i_flags & MPEG_INDEX_RAP) ==
+                ( i_frame % GOP == 0 ) );
+        if( p_entries[i].i_flags & MPEG_INDEX_DISCONTINUITY )
+        {
+            assert( i_frame == JUMP_FRAME );
+            i_jumps++;
+        }
+        if( i > 0 )
+        {
+            assert( p_entries[i].i_time > p_entries[i-1].i_time );
+            assert( p_entries[i].i_offset > p_entries[i-1].i_offset );
+        }
+    }
+    assert( i_jumps == 1 );
+    free( p_entries );
+
+    assert( !mpeg_index_GetLength( p_index, &i_length ) );
+    assert( i_length == FrameTime( FRAMES - 1 ) );
+
+    /* Seeks */
+    for( int64_t i_target = 0; i_target < i_length; i_target += 100000 )
+    {
+        int i_frame;
+
+        assert( !mpeg_index_Seek( p_index, i_target, &i_offset, &i_clock ) );
+        i_frame = FrameAt( &b, i_type, i_offset );
+        assert( i_frame >= 0 && i_frame % GOP == 0 );
+        assert( FrameTime( i_frame ) <= i_target );
+        assert( i_target - FrameTime( i_frame ) < 5 * MPEG_INDEX_INTERVAL );
+
+        /* The clock of the target time, unless it jumped on the way */
+        if( i_clock >= 0 )
+        {
+            int64_t i_expected = FrameClock( i_frame ) * 100 / 9
+                               + i_target - FrameTime( i_frame );
+            if( i_expected >= CLOCK_WRAP )
+                i_expected -= CLOCK_WRAP;
+            assert( i_frame >= JUMP_FRAME ||
+                    i_target < FrameTime( JUMP_FRAME ) );
+            assert( i_clock >= i_expected - 2 && i_clock <= i_expected + 2 );
+        }
+    }
+
+    /* Times */
+    i_last = 0;
+    for( i_offset = 0; i_offset < (int64_t)b.i_size - 4; i_offset += 997 )
+    {
+        assert( !mpeg_index_GetTime( p_index, i_offset, &i_time ) );
+        assert( i_time >= i_last && i_time <= i_length );
+        i_last = i_time;
+    }
+    mpeg_index_Delete( p_index );
+
+    /* While the scan goes on, seek only in what is indexed */
+    p_index = Index( &b, i_type, b.i_size / 2 );
+    assert( mpeg_index_Seek( p_index, i_length - 1, &i_offset, &i_clock ) );
+    assert( !mpeg_index_Seek( p_index, i_length / 4, &i_offset, &i_clock ) );
+    assert( i_offset < (int64_t)b.i_size / 2 );
+    assert( mpeg_index_GetTime( p_index, b.i_size - 1, &i_time ) );
+    /* No file size to extrapolate from */
+    assert( mpeg_index_GetLength( p_index, &i_time ) );
+    mpeg_index_Delete( p_index );
+
+    free( b.p );
+}
+
+int main( void )
+{
+    srand( 0 );
+    test_index( MPEG_INDEX_TS );
+    test_index( MPEG_INDEX_PS );
+    return 0;
+}
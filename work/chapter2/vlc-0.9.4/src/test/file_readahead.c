@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * file_readahead.c: Test and benchmark for the file read-ahead engine
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks the data returned by both read-ahead
+ * back-ends against the content of a temporary file, with random seeks
+ * and a file growing past its end. Given files, it also compares the
+ * throughput of plain read() calls, as done by the file access without
+ * read-ahead, with each back-end, after dropping the files from the page
+ * cache where possible:
+ *   ./test_readahead /nas/movie.ts
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include "../../modules/access/readahead.h"
+
+#define READ_SIZE 32768 /* what the stream layer asks for at once */
+
+static vlc_object_t *p_obj;
+
+static void check_read( readahead_t *p_ra, const uint8_t *p_ref,
+                        size_t i_size, int64_t i_pos, size_t i_len )
+{
+    uint8_t p_buf[20000];
+    size_t i_got = 0;
+
+    assert( i_len <= sizeof( p_buf ) );
+    while( i_got < i_len )
+    {
+        ssize_t i_ret = readahead_Read( p_ra, p_buf + i_got, i_len - i_got );
+
+        assert( i_ret >= 0 );
+        if( i_ret == 0 )
+            break;
+        i_got += i_ret;
+    }
+
+    if( i_pos >= (int64_t)i_size )
+        assert( i_got == 0 );
+    else
+        assert( i_got == __MIN( i_len, i_size - i_pos ) );
+    assert( !memcmp( p_buf, p_ref + i_pos, i_got ) );
+}
+
+static void test_backend( bool b_uring )
+{
+    char psz_name[] = "/tmp/vlc-readahead-XXXXXX";
+    size_t i_size = 3 * 1000 * 1000 + 17;
+    uint8_t *p_ref = malloc( i_size + 100000 );
+    int fd = mkstemp( psz_name );
+
+    assert( fd != -1 && p_ref != NULL );
+    unlink( psz_name );
+    for( size_t i = 0; i < i_size + 100000; i++ )
+        p_ref[i] = rand();
+    assert( write( fd, p_ref, i_size ) == (ssize_t)i_size );
+
+    static const struct { unsigned i_depth; size_t i_chunk; } p_configs[] =
+    {
+        { 1, 4096 }, { 3, 10000 }, { 4, 65536 }, { 16, 4096 },
+    };
+
+    for( unsigned c = 0; c < sizeof( p_configs ) / sizeof( p_configs[0] );
+         c++ )
+    {
+        readahead_t *p_ra = readahead_New( p_obj, fd, 0, p_configs[c].i_depth,
+                                           p_configs[c].i_chunk, b_uring );
+        readahead_stats_t stats;
+        int64_t i_pos = 0;
+
+        assert( p_ra != NULL );
+        if( c == 0 )
+            printf( "  back-end: %s\n", readahead_GetBackend( p_ra ) );
+
+        /* Sequential reads of various sizes */
+        while( i_pos < (int64_t)i_size )
+        {
+            size_t i_len = 1 + rand() % 20000;
+
+            check_read( p_ra, p_ref, i_size, i_pos, i_len );
+            i_pos = __MIN( i_pos + (int64_t)i_len, (int64_t)i_size );
+        }
+        check_read( p_ra, p_ref, i_size, i_pos, 100 );
+
+        /* Random seeks: inside the window, backward, and past the end */
+        for( int i = 0; i < 2000; i++ )
+        {
+            int i_kind = rand() % 4;
+            size_t i_len = 1 + rand() % 20000;
+
+            if( i_kind == 0 )
+                i_pos = rand() % (i_size + 1000);
+            else if( i_kind == 1 )
+                i_pos += rand() % (p_configs[c].i_depth
+                                   * p_configs[c].i_chunk + 1);
+            else if( i_kind == 2 && i_pos > 0 )
+                i_pos -= rand() % __MIN( i_pos, 50000 );
+            readahead_Seek( p_ra, i_pos );
+            check_read( p_ra, p_ref, i_size, i_pos, i_len );
+            if( i_pos < (int64_t)i_size )
+                i_pos = __MIN( i_pos + (int64_t)i_len, (int64_t)i_size );
+        }
+
+        /* The file grows after the end was reached */
+        readahead_Seek( p_ra, i_size - 10 );
+        check_read( p_ra, p_ref, i_size, i_size - 10, 100 );
+        check_read( p_ra, p_ref, i_size, i_size, 100 );
+        assert( pwrite( fd, p_ref + i_size, 100000, i_size ) == 100000 );
+        check_read( p_ra, p_ref, i_size + 100000, i_size, 20000 );
+        assert( ftruncate( fd, i_size ) == 0 );
+
+        readahead_GetStats( p_ra, &stats );
+        assert( stats.i_reads > 0 && stats.i_resets > 0 );
+        readahead_Delete( p_ra );
+    }
+
+    close( fd );
+    free( p_ref );
+}
+
+static int64_t bench_run( int fd, readahead_t *p_ra, uint8_t *p_buf )
+{
+    int64_t i_total = 0;
+
+#ifdef HAVE_POSIX_FADVISE
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+#endif
+    lseek( fd, 0, SEEK_SET );
+    for( ;; )
+    {
+        ssize_t i_ret = p_ra ? readahead_Read( p_ra, p_buf, READ_SIZE )
+                             : read( fd, p_buf, READ_SIZE );
+        if( i_ret <= 0 )
+            break;
+        i_total += i_ret;
+    }
+    return i_total;
+}
+
+static void bench_file( const char *psz_file )
+{
+    static const unsigned p_depths[] = { 2, 4, 8, 16 };
+    uint8_t *p_buf = malloc( READ_SIZE );
+    int fd = open( psz_file, O_RDONLY );
+    mtime_t i_start;
+    int64_t i_total;
+
+    if( fd == -1 )
+    {
+        perror( psz_file );
+        free( p_buf );
+        return;
+    }
+
+    i_start = mdate();
+    i_total = bench_run( fd, NULL, p_buf );
+    printf( "%s: %"PRId64" bytes\n  %-16s %9.1f MB/s\n", psz_file, i_total,
+            "read()", (double)i_total / (mdate() - i_start) );
+
+    for( int b_uring = 1; b_uring >= 0; b_uring-- )
+        for( unsigned i = 0; i < sizeof( p_depths ) / sizeof( p_depths[0] );
+             i++ )
+        {
+            /* A 1 MB window, as by default */
+            readahead_t *p_ra = readahead_New( p_obj, fd, 0, p_depths[i],
+                                          (1 << 20) / p_depths[i], b_uring );
+            readahead_stats_t stats;
+            char psz_name[32];
+
+            if( p_ra == NULL )
+                continue;
+            if( b_uring && strcmp( readahead_GetBackend( p_ra ), "io_uring" ) )
+            {
+                readahead_Delete( p_ra );
+                break;
+            }
+
+            i_start = mdate();
+            i_total = bench_run( fd, p_ra, p_buf );
+            readahead_GetStats( p_ra, &stats );
+            snprintf( psz_name, sizeof( psz_name ), "%s x%u",
+                      b_uring ? "io_uring" : "threads", p_depths[i] );
+            printf( "  %-16s %9.1f MB/s, %u stalls\n", psz_name,
+                    (double)i_total / (mdate() - i_start), stats.i_stalls );
+            readahead_Delete( p_ra );
+        }
+
+    close( fd );
+    free( p_buf );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--plugin-path=/dev/null"
+    };
+    libvlc_int_t *p_libvlc = libvlc_InternalCreate();
+
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 4, ppsz_vlc_argv ) == 0 );
+    p_obj = VLC_OBJECT(p_libvlc);
+
+    printf( "checking threads:\n" );
+    test_backend( false );
+    printf( "checking io_uring:\n" );
+    test_backend( true );
+
+    for( int i = 1; i < i_argc; i++ )
+        bench_file( ppsz_argv[i] );
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
@@ -0,0 +1,347 @@
+/*****************************************************************************
+ * filter_slices.c: Test and benchmark for the video filter slices
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks that the slices cover every line once, and
+ * that the filters rendering in slices give the same pictures whatever the
+ * number of threads. The filters are loaded from the modules of the build
+ * tree, and skipped if they are not there. Given picture sizes, it also
+ * reports the throughput of each filter with 1, 2, 4 and 8 threads:
+ *   ./test_filter_slices 3840x2160 1920x1080
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_vout.h>
+#include <vlc_filter.h>
+
+#define I420 VLC_FOURCC('I','4','2','0')
+#define YUY2 VLC_FOURCC('Y','U','Y','2')
+
+static vlc_object_t *p_obj;
+
+/*
+ * The slices themselves
+ */
+static void test_lines( void )
+{
+    for( int i_lines = 0; i_lines < 70; i_lines++ )
+        for( int i_align = 1; i_align <= 4; i_align++ )
+            for( int i_slices = 1; i_slices <= 33; i_slices++ )
+            {
+                int i_next = 0;
+
+                for( int i = 0; i < i_slices; i++ )
+                {
+                    int i_first, i_last;
+
+                    filter_GetSliceLines( i_lines, i_align, i, i_slices,
+                                          &i_first, &i_last );
+                    assert( i_first == i_next );
+                    assert( i_last >= i_first );
+                    assert( i_first % i_align == 0 || i_first == i_lines );
+                    i_next = i_last;
+                }
+                assert( i_next == i_lines );
+            }
+}
+
+/* Counts how many times each line was written */
+static void CountSlice( filter_t *p_filter, picture_t *p_src,
+                        picture_t *p_dst, int i_slice, int i_slices )
+{
+    plane_t *p = &p_dst->p[Y_PLANE];
+    int i_first, i_last;
+
+    (void)p_filter; (void)p_src;
+    filter_GetSliceLines( p->i_visible_lines, 2, i_slice, i_slices,
+                          &i_first, &i_last );
+    for( int y = i_first; y < i_last; y++ )
+        p->p_pixels[y * p->i_pitch]++;
+}
+
+static void test_pool( void )
+{
+    filter_t *p_filter = vlc_object_create( p_obj, sizeof( filter_t ) );
+    picture_t *p_pic = picture_New( I420, 64, 37, 0 );
+
+    assert( p_filter != NULL && p_pic != NULL );
+    assert( filter_slices_New( p_obj, 1 ) == NULL );
+
+    for( unsigned i_threads = 1; i_threads <= 9; i_threads++ )
+    {
+        filter_slices_t *p_slices = filter_slices_New( p_obj, i_threads );
+
+        p_filter->p_slices = p_slices;
+        memset( p_pic->p[0].p_pixels, 0,
+                p_pic->p[0].i_pitch * p_pic->p[0].i_lines );
+        for( int i = 0; i < 100; i++ )
+            filter_RunSlices( p_filter, CountSlice, p_pic, p_pic );
+        for( int y = 0; y < p_pic->p[0].i_visible_lines; y++ )
+            assert( p_pic->p[0].p_pixels[y * p_pic->p[0].i_pitch] == 100 );
+        filter_slices_Delete( p_slices );
+    }
+
+    picture_Release( p_pic );
+    vlc_object_release( p_filter );
+}
+
+/*
+ * The filters, in chains
+ */
+static const struct
+{
+    const char  *psz_name;      /* NULL for a chroma converter */
+    vlc_fourcc_t i_chroma_out;
+} p_filters[] =
+{
+    { "sharpen{sigma=0.5}", I420 },
+    { "adjust{contrast=1.4,hue=20,saturation=2}", I420 },
+    { "gaussianblur", I420 },
+    { NULL, YUY2 },
+};
+#define FILTERS (sizeof(p_filters) / sizeof(p_filters[0]))
+
+static picture_t *BufferNew( filter_t *p_filter )
+{
+    const video_format_t *p_fmt = &p_filter->fmt_out.video;
+
+    return picture_New( p_fmt->i_chroma, p_fmt->i_width, p_fmt->i_height,
+                        p_fmt->i_aspect );
+}
+
+static void BufferDel( filter_t *p_filter, picture_t *p_pic )
+{
+    (void)p_filter;
+    picture_Release( p_pic );
+}
+
+static int BufferInit( filter_t *p_filter, void *p_data )
+{
+    (void)p_data;
+    p_filter->pf_vout_buffer_new = BufferNew;
+    p_filter->pf_vout_buffer_del = BufferDel;
+    return VLC_SUCCESS;
+}
+
+typedef struct
+{
+    vlc_object_t   *p_owner;
+    filter_chain_t *p_chain;
+} chain_t;
+
+/* The chain reads the number of threads from its parent */
+static bool chain_New( chain_t *p, unsigned i, unsigned i_threads,
+                       int i_width, int i_height )
+{
+    es_format_t fmt_in, fmt_out;
+    int i_ret;
+
+    p->p_owner = vlc_object_create( p_obj, sizeof( vlc_object_t ) );
+    assert( p->p_owner != NULL );
+    vlc_object_attach( p->p_owner, p_obj );
+    var_Create( p->p_owner, "filter-threads", VLC_VAR_INTEGER );
+    var_SetInteger( p->p_owner, "filter-threads", i_threads );
+
+    es_format_Init( &fmt_in, VIDEO_ES, I420 );
+    fmt_in.video.i_chroma = I420;
+    fmt_in.video.i_width = fmt_in.video.i_visible_width = i_width;
+    fmt_in.video.i_height = fmt_in.video.i_visible_height = i_height;
+    fmt_in.video.i_aspect = VOUT_ASPECT_FACTOR * i_width / i_height;
+    es_format_Copy( &fmt_out, &fmt_in );
+    fmt_out.i_codec = fmt_out.video.i_chroma = p_filters[i].i_chroma_out;
+
+    p->p_chain = filter_chain_New( p->p_owner, "video filter2", false,
+                                   BufferInit, NULL, NULL );
+    assert( p->p_chain != NULL );
+    filter_chain_Reset( p->p_chain, &fmt_in, &fmt_out );
+    if( p_filters[i].psz_name )
+        i_ret = filter_chain_AppendFromString( p->p_chain,
+                                               p_filters[i].psz_name );
+    else
+        i_ret = filter_chain_AppendFilter( p->p_chain, NULL, NULL,
+                                           NULL, NULL ) ? 1 : -1;
+    es_format_Clean( &fmt_in );
+    es_format_Clean( &fmt_out );
+    if( i_ret <= 0 )
+    {
+        filter_chain_Delete( p->p_chain );
+        vlc_object_detach( p->p_owner );
+        vlc_object_release( p->p_owner );
+        return false;
+    }
+    return true;
+}
+
+static void chain_Delete( chain_t *p )
+{
+    filter_chain_Delete( p->p_chain );
+    vlc_object_detach( p->p_owner );
+    vlc_object_release( p->p_owner );
+}
+
+static picture_t *chain_Filter( chain_t *p, picture_t *p_in )
+{
+    picture_Yield( p_in );
+    return filter_chain_VideoFilter( p->p_chain, p_in );
+}
+
+static const char *filter_name( unsigned i )
+{
+    return p_filters[i].psz_name ? p_filters[i].psz_name : "I420 to YUY2";
+}
+
+static void fill_random( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        for( int j = 0; j < p_pic->p[i].i_pitch * p_pic->p[i].i_lines; j++ )
+            p_pic->p[i].p_pixels[j] = rand();
+}
+
+static bool same_pixels( const picture_t *p_a, const picture_t *p_b )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+        for( int y = 0; y < p_a->p[i].i_visible_lines; y++ )
+            if( memcmp( &p_a->p[i].p_pixels[y * p_a->p[i].i_pitch],
+                        &p_b->p[i].p_pixels[y * p_b->p[i].i_pitch],
+                        p_a->p[i].i_visible_pitch ) )
+                return false;
+    return true;
+}
+
+static void test_filters( int i_width, int i_height )
+{
+    picture_t *p_in = picture_New( I420, i_width, i_height, 0 );
+
+    assert( p_in != NULL );
+    fill_random( p_in );
+
+    for( unsigned i = 0; i < FILTERS; i++ )
+    {
+        chain_t chain;
+        picture_t *p_ref;
+
+        if( !chain_New( &chain, i, 1, i_width, i_height ) )
+        {
+            fprintf( stderr, "%s: not found, skipped\n", filter_name( i ) );
+            continue;
+        }
+        p_ref = chain_Filter( &chain, p_in );
+        assert( p_ref != NULL );
+        chain_Delete( &chain );
+
+        for( unsigned i_threads = 2; i_threads <= 7; i_threads += 5 )
+        {
+            picture_t *p_out;
+
+            assert( chain_New( &chain, i, i_threads, i_width, i_height ) );
+            p_out = chain_Filter( &chain, p_in );
+            assert( p_out != NULL );
+            assert( same_pixels( p_ref, p_out ) );
+            picture_Release( p_out );
+            chain_Delete( &chain );
+        }
+        picture_Release( p_ref );
+    }
+    picture_Release( p_in );
+}
+
+static void bench_size( int i_width, int i_height )
+{
+    static const unsigned p_threads[] = { 1, 2, 4, 8 };
+    picture_t *p_in = picture_New( I420, i_width, i_height, 0 );
+
+    assert( p_in != NULL );
+    fill_random( p_in );
+
+    printf( "%dx%d I420:\n", i_width, i_height );
+    for( unsigned i = 0; i < FILTERS; i++ )
+        for( unsigned t = 0; t < sizeof(p_threads) / sizeof(p_threads[0]);
+             t++ )
+        {
+            mtime_t i_start, i_time;
+            int i_frames = 0;
+            chain_t chain;
+
+            if( !chain_New( &chain, i, p_threads[t], i_width, i_height ) )
+                break;
+
+            i_start = mdate();
+            do
+            {
+                picture_t *p_out = chain_Filter( &chain, p_in );
+
+                assert( p_out != NULL );
+                picture_Release( p_out );
+                i_frames++;
+            } while( (i_time = mdate() - i_start) < 1000000 );
+            chain_Delete( &chain );
+
+            printf( "  %-44s x%u %7.1f fps\n", filter_name( i ),
+                    p_threads[t], i_frames * 1000000. / i_time );
+        }
+
+    picture_Release( p_in );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--no-plugins-cache",
+        "--plugin-path=../../modules"
+    };
+    static const int p_sizes[][2] = {
+        { 16, 2 }, { 64, 30 }, { 320, 240 }, { 352, 288 },
+    };
+    libvlc_int_t *p_libvlc = libvlc_InternalCreate();
+
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 5, ppsz_vlc_argv ) == 0 );
+    p_obj = VLC_OBJECT(p_libvlc);
+
+    test_lines();
+    test_pool();
+    for( unsigned i = 0; i < sizeof(p_sizes) / sizeof(p_sizes[0]); i++ )
+        test_filters( p_sizes[i][0], p_sizes[i][1] );
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        int i_width, i_height;
+
+        if( sscanf( ppsz_argv[i], "%dx%d", &i_width, &i_height ) == 2
+         && i_width > 0 && i_height > 0 )
+            bench_size( i_width, i_height );
+        else
+            fprintf( stderr, "%s: not a picture size\n", ppsz_argv[i] );
+    }
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*****************************************************************************
+ * startcode.c: Test and benchmark for the block start code search
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks every start code search variant against a
+ * naive byte-per-byte search. Given elementary stream files (H.264, MPEG
+ * video, ...), it also reports the throughput of each variant on them:
+ *   ./test_startcode foo.264 bar.m2v
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+
+#include "libvlc.h"
+
+/* The variants of block_StartcodeFind(), selected by the CPU flags */
+static const struct
+{
+    const char *psz_name;
+    unsigned    i_cpu;
+} p_variants[] =
+{
+    { "C",    0 },
+    { "SSE2", CPU_CAPABILITY_SSE2 },
+    { "AVX2", CPU_CAPABILITY_SSE2 | CPU_CAPABILITY_AVX2 },
+};
+#define VARIANTS (sizeof(p_variants) / sizeof(p_variants[0]))
+
+static uint32_t i_cpu_detected;
+
+static bool set_variant( unsigned i )
+{
+    if( (i_cpu_detected & p_variants[i].i_cpu) != p_variants[i].i_cpu )
+        return false;
+    cpu_flags = (i_cpu_detected & ~(CPU_CAPABILITY_SSE2|CPU_CAPABILITY_AVX2))
+              | p_variants[i].i_cpu;
+    return true;
+}
+
+static const uint8_t p_annexb[3] = { 0x00, 0x00, 0x01 };
+
+static const uint8_t *find_naive( const uint8_t *p, const uint8_t *p_end )
+{
+    for( ; p_end - p >= 3; p++ )
+        if( !p[0] && !p[1] && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+/* Mostly zeroes, so that there are plenty of near misses */
+static void fill_random( uint8_t *p, size_t i_size )
+{
+    for( size_t i = 0; i < i_size; i++ )
+    {
+        int r = rand() % 8;
+        p[i] = r < 5 ? 0 : r < 7 ? 1 : rand();
+    }
+}
+
+static void test_buffers( void )
+{
+    uint8_t p_buf[256];
+
+    for( int i_run = 0; i_run < 2000; i_run++ )
+    {
+        fill_random( p_buf, sizeof(p_buf) );
+
+        for( size_t i_start = 0; i_start < 40; i_start++ )
+        {
+            size_t i_end = i_start + rand() % (sizeof(p_buf) - i_start + 1);
+            const uint8_t *p_ref = find_naive( p_buf + i_start,
+                                               p_buf + i_end );
+
+            for( unsigned i = 0; i < VARIANTS; i++ )
+            {
+                if( !set_variant( i ) )
+                    continue;
+                assert( block_StartcodeFind( p_buf + i_start,
+                                             p_buf + i_end ) == p_ref );
+                assert( block_StartcodeFindGeneric( p_buf + i_start,
+                                        p_buf + i_end, p_annexb, 3 ) == p_ref );
+            }
+        }
+    }
+}
+
+static void test_bytestream( const uint8_t *p_startcode, int i_length )
+{
+    uint8_t p_buf[512];
+
+    for( int i_run = 0; i_run < 2000; i_run++ )
+    {
+        block_bytestream_t bytestream = block_BytestreamInit();
+        size_t i_size = rand() % sizeof(p_buf);
+        size_t i_skip, i_from, i_offset;
+
+        fill_random( p_buf, i_size );
+
+        /* Split the data at random places, with a few empty blocks */
+        for( size_t i_pos = 0; i_pos < i_size; )
+        {
+            size_t i_len = rand() % 20;
+            block_t *p_block;
+
+            i_len = __MIN( i_len, i_size - i_pos );
+            p_block = block_New( NULL, i_len );
+
+            assert( p_block != NULL );
+            memcpy( p_block->p_buffer, p_buf + i_pos, i_len );
+            block_BytestreamPush( &bytestream, p_block );
+            i_pos += i_len;
+        }
+        if( i_size == 0 )
+            continue;
+
+        i_skip = rand() % (i_size + 1);
+        assert( block_SkipBytes( &bytestream, i_skip ) == VLC_SUCCESS );
+        i_from = rand() % (i_size - i_skip + 1);
+
+        i_offset = i_from;
+        if( block_FindStartcodeFromOffset( &bytestream, &i_offset,
+                            (uint8_t *)p_startcode, i_length ) == VLC_SUCCESS )
+        {
+            size_t i;
+
+            /* Must be the first complete match */
+            assert( i_skip + i_offset + i_length <= i_size );
+            assert( !memcmp( p_buf + i_skip + i_offset, p_startcode,
+                             i_length ) );
+            for( i = i_skip + i_from; i < i_skip + i_offset; i++ )
+                assert( memcmp( p_buf + i, p_startcode, i_length ) );
+        }
+        else if( i_skip + i_from < i_size )
+        {
+            size_t i;
+
+            /* The search must resume at the first possible partial match */
+            for( i = i_skip + i_from; i + i_length <= i_size; i++ )
+                assert( memcmp( p_buf + i, p_startcode, i_length ) );
+            for( i = __MAX( i, i_skip + i_from ); i < i_size; i++ )
+                if( !memcmp( p_buf + i, p_startcode, i_size - i ) )
+                    break;
+            assert( i_skip + i_offset == i );
+        }
+
+        block_BytestreamRelease( &bytestream );
+    }
+}
+
+static void bench_file( const char *psz_file )
+{
+    FILE *stream = fopen( psz_file, "rb" );
+    uint8_t *p_data = NULL;
+    size_t i_size = 0;
+
+    if( stream == NULL )
+    {
+        perror( psz_file );
+        return;
+    }
+    for( ;; )
+    {
+        uint8_t *p_new = realloc( p_data, i_size + 1048576 );
+        size_t i_read;
+
+        assert( p_new != NULL );
+        p_data = p_new;
+        i_read = fread( p_data + i_size, 1, 1048576, stream );
+        i_size += i_read;
+        if( i_read < 1048576 )
+            break;
+    }
+    fclose( stream );
+
+    printf( "%s: %zu bytes\n", psz_file, i_size );
+    for( unsigned i = 0; i < VARIANTS; i++ )
+    {
+        unsigned i_count = 0;
+        mtime_t i_start, i_time;
+        int i_loop;
+
+        if( !set_variant( i ) )
+            continue;
+
+        i_start = mdate();
+        for( i_loop = 0; i_loop < 10; i_loop++ )
+        {
+            const uint8_t *p = p_data, *p_end = p_data + i_size;
+
+            while( (p = block_StartcodeFind( p, p_end )) != NULL )
+            {
+                i_count++;
+                p += 3;
+            }
+        }
+        i_time = mdate() - i_start;
+
+        printf( "  %-5s %8u start codes, %8.1f MB/s\n",
+                p_variants[i].psz_name, i_count / i_loop,
+                i_time > 0 ? (double)i_size * i_loop / i_time : 0. );
+    }
+    free( p_data );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const uint8_t p_long[5] = { 0x00, 0x00, 0x01, 0xb3, 0x00 };
+
+    cpu_flags = i_cpu_detected = CPUCapabilities();
+
+    test_buffers();
+    for( unsigned i = 0; i < VARIANTS; i++ )
+    {
+        if( !set_variant( i ) )
+            continue;
+        test_bytestream( p_annexb, 3 );
+    }
+    test_bytestream( p_long, 5 );
+
+    for( int i = 1; i < i_argc; i++ )
+        bench_file( ppsz_argv[i] );
+    return 0;
+}
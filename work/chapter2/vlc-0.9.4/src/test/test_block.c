@@ -58,9 +58,45 @@ static void test_block_File (void)
     remove ("testfile.txt");
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block_t *shared = block_Share (block);
+    assert (shared != NULL && shared != block);
+    assert (shared->p_buffer == block->p_buffer);
+    assert (shared->i_buffer == block->i_buffer && shared->i_pts == 42);
+
+    /* Headers are private */
+    shared->p_buffer += 5;
+    shared->i_buffer -= 5;
+    block_t *shared2 = block_Share (shared);
+    assert (shared2->p_buffer == block->p_buffer + 5);
+
+    /* Realloc and Unshare copy a shared payload */
+    block_t *copy = block_Realloc (shared, 4, shared->i_buffer);
+    assert (copy != NULL && copy->p_buffer != block->p_buffer + 1);
+    assert (!memcmp (copy->p_buffer + 4, text + 5, sizeof (text) - 5));
+    block_Release (copy);
+
+    block_t *writable = block_Unshare (block);
+    assert (writable != block);
+    writable->p_buffer[0] = 't';
+    assert (!memcmp (shared2->p_buffer, text + 5, sizeof (text) - 5));
+    block_Release (writable);
+
+    /* The last reference is writable in place */
+    assert (block_Unshare (shared2) == shared2);
+    block_Release (shared2);
+}
+
 int main (void)
 {
     test_block_File ();
+    test_block_Share ();
     return 0;
 }
 
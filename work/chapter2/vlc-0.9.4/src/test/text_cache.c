@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * text_cache.c: Test for the LRU cache of the freetype text renderer
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "../../modules/misc/freetype_cache.h"
+
+#define ENTRIES 500
+
+static int i_freed;
+
+static void Free( void *p_data )
+{
+    free( p_data );
+    i_freed++;
+}
+
+static size_t Key( char *psz_key, int i )
+{
+    return sprintf( psz_key, "key %d", i );
+}
+
+static void Put( ft_cache_t *p_cache, int i )
+{
+    char psz_key[16];
+    int *pi = malloc( sizeof(*pi) );
+
+    assert( pi );
+    *pi = i;
+    assert( !ft_cache_Put( p_cache, psz_key, Key( psz_key, i ), pi, 100 ) );
+}
+
+static bool Has( ft_cache_t *p_cache, int i )
+{
+    char psz_key[16];
+    const int *pi = ft_cache_Get( p_cache, psz_key, Key( psz_key, i ) );
+
+    assert( !pi || *pi == i );
+    return pi != NULL;
+}
+
+int main( void )
+{
+    ft_cache_stats_t stats;
+    ft_cache_t *p_cache;
+    size_t i_entry_size;
+
+    p_cache = ft_cache_New( 0, Free );
+    assert( p_cache );
+
+    /* Nothing is evicted before the cache is trimmed, however many entries
+     * and however small the cache */
+    for( int i = 0; i < ENTRIES; i++ )
+    {
+        assert( !Has( p_cache, i ) );
+        Put( p_cache, i );
+    }
+    for( int i = 0; i < ENTRIES; i++ )
+        assert( Has( p_cache, i ) );
+    assert( !Has( p_cache, ENTRIES ) );
+
+    ft_cache_GetStats( p_cache, &stats );
+    assert( stats.i_hits == ENTRIES );
+    assert( stats.i_misses == ENTRIES + 1 );
+    assert( stats.i_entries == ENTRIES );
+    assert( stats.i_evictions == 0 && i_freed == 0 );
+    assert( stats.i_size >= ENTRIES * 100 );
+    i_entry_size = stats.i_size / ENTRIES;
+
+    /* Keys are compared whole, not as prefixes */
+    assert( !ft_cache_Get( p_cache, "key 1", 4 ) );
+    assert( !ft_cache_Get( p_cache, "key 10x", 7 ) );
+
+    ft_cache_Trim( p_cache );
+    ft_cache_GetStats( p_cache, &stats );
+    assert( stats.i_entries == 0 && stats.i_size == 0 );
+    assert( stats.i_evictions == ENTRIES && i_freed == ENTRIES );
+    ft_cache_Delete( p_cache );
+
+    /* The least recently used entries are evicted first */
+    i_freed = 0;
+    p_cache = ft_cache_New( 10 * i_entry_size + i_entry_size / 2, Free );
+    assert( p_cache );
+    for( int i = 0; i < 20; i++ )
+        Put( p_cache, i );
+    for( int i = 0; i < 5; i++ )
+        assert( Has( p_cache, i ) );
+    ft_cache_Trim( p_cache );
+
+    ft_cache_GetStats( p_cache, &stats );
+    assert( stats.i_entries == 10 && i_freed == 10 );
+    assert( stats.i_size <= stats.i_max_size );
+    for( int i = 0; i < 5; i++ )
+        assert( Has( p_cache, i ) );
+    for( int i = 5; i < 15; i++ )
+        assert( !Has( p_cache, i ) );
+    for( int i = 15; i < 20; i++ )
+        assert( Has( p_cache, i ) );
+
+    /* Trimming a cache that fits changes nothing */
+    ft_cache_Trim( p_cache );
+    ft_cache_GetStats( p_cache, &stats );
+    assert( stats.i_entries == 10 && i_freed == 10 );
+
+    ft_cache_Delete( p_cache );
+    assert( i_freed == 20 );
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ * video_blend.c: Test for the line kernels of the blend module
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that the SIMD kernels blend exactly as the C ones, on lines of
+ * random pixels whose alpha has transparent and opaque runs, whatever the
+ * global alpha and the layout of the destination. The throughput of the
+ * whole module is measured by the blendbench interface (vlc -I blendbench).
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "libvlc.h"
+#include "../../modules/video_filter/blend.h"
+
+#define MAX_WIDTH 300
+
+static uint8_t p_src1[4 * MAX_WIDTH], p_src2[4][MAX_WIDTH * 4];
+static uint8_t p_ref[4 * MAX_WIDTH], p_out[4 * MAX_WIDTH];
+
+/* Random samples, and alphas with runs of 0, of 255 and of anything */
+static void fill( void )
+{
+    for( size_t i = 0; i < sizeof(p_src1); i++ )
+        p_src1[i] = rand();
+    for( int i = 0; i < 3; i++ )
+        for( int j = 0; j < 4 * MAX_WIDTH; j++ )
+            p_src2[i][j] = rand();
+    for( int j = 0; j < 4 * MAX_WIDTH; )
+    {
+        const int i_kind = rand() % 3;
+
+        for( int i_run = 1 + rand() % 40; i_run > 0 && j < 4 * MAX_WIDTH;
+             i_run--, j++ )
+            p_src2[3][j] = i_kind == 0 ? 0 : i_kind == 1 ? 255 : rand();
+    }
+}
+
+/* The destination is not the first source, so that the kept pixels show */
+static void reset( void )
+{
+    memset( p_ref, 0x55, sizeof(p_ref) );
+    memset( p_out, 0x55, sizeof(p_out) );
+}
+
+static void test_lines( const blend_lines_t *p_c, const blend_lines_t *p_simd,
+                        int i_width, int i_alpha )
+{
+    static const int pi_packed[][3] = { { 0, 1, 3 }, { 1, 0, 2 }, { 0, 3, 1 } };
+    static const int pi_rgb[][3] = { { 2, 1, 0 }, { 0, 1, 2 }, { 3, 2, 1 } };
+
+    reset();
+    p_c->pf_plane( p_ref, p_src1, p_src2[0], p_src2[3], i_width, i_alpha );
+    p_simd->pf_plane( p_out, p_src1, p_src2[0], p_src2[3], i_width, i_alpha );
+    assert( !memcmp( p_ref, p_out, sizeof(p_ref) ) );
+
+    reset();
+    p_c->pf_chroma( p_ref, p_src1, p_src2[1], p_src2[3], i_width, i_alpha );
+    p_simd->pf_chroma( p_out, p_src1, p_src2[1], p_src2[3], i_width, i_alpha );
+    assert( !memcmp( p_ref, p_out, sizeof(p_ref) ) );
+
+    for( unsigned i = 0; i < sizeof(pi_packed) / sizeof(pi_packed[0]); i++ )
+    {
+        reset();
+        p_c->pf_packed( p_ref, p_src1, p_src2[0], p_src2[1], p_src2[2],
+                        p_src2[3], i_width & ~1, i_alpha, pi_packed[i][0],
+                        pi_packed[i][1], pi_packed[i][2] );
+        p_simd->pf_packed( p_out, p_src1, p_src2[0], p_src2[1], p_src2[2],
+                           p_src2[3], i_width & ~1, i_alpha, pi_packed[i][0],
+                           pi_packed[i][1], pi_packed[i][2] );
+        assert( !memcmp( p_ref, p_out, sizeof(p_ref) ) );
+    }
+
+    for( unsigned i = 0; i < sizeof(pi_rgb) / sizeof(pi_rgb[0]); i++ )
+    {
+        reset();
+        p_c->pf_rgb32( p_ref, p_src1, p_src2[3], i_width, i_alpha,
+                       pi_rgb[i] );
+        p_simd->pf_rgb32( p_out, p_src1, p_src2[3], i_width, i_alpha,
+                          pi_rgb[i] );
+        assert( !memcmp( p_ref, p_out, sizeof(p_ref) ) );
+    }
+}
+
+int main( void )
+{
+    static const unsigned pi_cpu[] = {
+        CPU_CAPABILITY_SSE2, CPU_CAPABILITY_SSE2 | CPU_CAPABILITY_SSSE3
+    };
+    static const int pi_alpha[] = { 255, 254, 128, 1 };
+    const uint32_t i_cpu_detected = CPUCapabilities();
+    blend_lines_t c;
+
+    blend_LinesInit( &c, 0 );
+    for( unsigned i = 0; i < sizeof(pi_cpu) / sizeof(pi_cpu[0]); i++ )
+    {
+        blend_lines_t simd;
+
+        if( (i_cpu_detected & pi_cpu[i]) != pi_cpu[i] )
+            continue;
+        blend_LinesInit( &simd, pi_cpu[i] );
+
+        for( int k = 0; k < 20; k++ )
+        {
+            fill();
+            for( int i_width = 1; i_width <= MAX_WIDTH; i_width += 1 + k )
+                for( unsigned a = 0; a < sizeof(pi_alpha) / sizeof(int); a++ )
+                    test_lines( &c, &simd, i_width, pi_alpha[a] );
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,433 @@
+/*****************************************************************************
+ * video_chroma.c: Test and benchmark for the SIMD YUV conversions
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks that the SSSE3 and AVX2 conversions give
+ * the very same pixels as the C one for every output format, matrix and
+ * range, whatever the number of threads, and that the C one is close to
+ * the exact floating point conversion. Given picture sizes, it also reports
+ * the throughput of each conversion and variant:
+ *   ./test_chroma 1920x1080 720x576
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_vout.h>
+#include <vlc_filter.h>
+
+#include "libvlc.h"
+#include "../../modules/video_chroma/chroma_simd.h"
+
+#define I420 VLC_FOURCC('I','4','2','0')
+#define J420 VLC_FOURCC('J','4','2','0')
+#define I422 VLC_FOURCC('I','4','2','2')
+#define J422 VLC_FOURCC('J','4','2','2')
+
+#define SIMD_FLAGS (CPU_CAPABILITY_SSSE3 | CPU_CAPABILITY_AVX2)
+
+/* The variants of the line kernels, selected by the CPU flags */
+static const struct
+{
+    const char *psz_name;
+    unsigned    i_cpu;
+} p_variants[] =
+{
+    { "C",     0 },
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS) \
+ && defined(CAN_COMPILE_SSSE3)
+    { "SSSE3", CPU_CAPABILITY_SSSE3 },
+# if defined(CAN_COMPILE_AVX2)
+    { "AVX2",  CPU_CAPABILITY_SSSE3 | CPU_CAPABILITY_AVX2 },
+# endif
+#endif
+};
+#define VARIANTS (sizeof(p_variants) / sizeof(p_variants[0]))
+
+/* The output formats */
+static const struct
+{
+    const char  *psz_name;
+    vlc_fourcc_t i_chroma;
+    uint32_t     i_rmask, i_gmask, i_bmask;
+} p_outputs[] =
+{
+    { "RV32",      VLC_FOURCC('R','V','3','2'), 0xff0000, 0xff00, 0xff },
+    { "RV32 BGR",  VLC_FOURCC('R','V','3','2'), 0xff, 0xff00, 0xff0000 },
+    { "RV32 high", VLC_FOURCC('R','V','3','2'),
+                   0xff000000, 0xff0000, 0xff00 },
+    { "RV24",      VLC_FOURCC('R','V','2','4'), 0xff0000, 0xff00, 0xff },
+    { "RV24 BGR",  VLC_FOURCC('R','V','2','4'), 0xff, 0xff00, 0xff0000 },
+    { "RV16",      VLC_FOURCC('R','V','1','6'), 0xf800, 0x07e0, 0x001f },
+    { "RV15",      VLC_FOURCC('R','V','1','5'), 0x7c00, 0x03e0, 0x001f },
+    { "YUY2",      VLC_FOURCC('Y','U','Y','2'), 0, 0, 0 },
+    { "YVYU",      VLC_FOURCC('Y','V','Y','U'), 0, 0, 0 },
+    { "UYVY",      VLC_FOURCC('U','Y','V','Y'), 0, 0, 0 },
+};
+#define OUTPUTS (sizeof(p_outputs) / sizeof(p_outputs[0]))
+
+static bool is_rgb( unsigned i_output )
+{
+    return p_outputs[i_output].i_rmask != 0;
+}
+
+static vlc_object_t *p_obj;
+static uint32_t i_cpu_detected;
+
+static picture_t *BufferNew( filter_t *p_filter )
+{
+    const video_format_t *p_fmt = &p_filter->fmt_out.video;
+    vlc_fourcc_t i_chroma = p_fmt->i_chroma;
+
+    /* The core does not know YVYU, which is laid out as YUY2 */
+    if( i_chroma == VLC_FOURCC('Y','V','Y','U') )
+        i_chroma = VLC_FOURCC('Y','U','Y','2');
+    return picture_New( i_chroma, p_fmt->i_width, p_fmt->i_height,
+                        p_fmt->i_aspect );
+}
+
+static void BufferDel( filter_t *p_filter, picture_t *p_pic )
+{
+    (void)p_filter;
+    picture_Release( p_pic );
+}
+
+static void set_size( video_format_t *p_fmt, vlc_fourcc_t i_chroma,
+                      int i_width, int i_height )
+{
+    p_fmt->i_chroma = i_chroma;
+    p_fmt->i_width = p_fmt->i_visible_width = i_width;
+    p_fmt->i_height = p_fmt->i_visible_height = i_height;
+    p_fmt->i_aspect = VOUT_ASPECT_FACTOR * i_width / i_height;
+}
+
+static filter_t *new_variant( unsigned i, unsigned i_output, int i_matrix,
+                              unsigned i_threads, vlc_fourcc_t i_chroma,
+                              int i_width, int i_height )
+{
+    filter_t *p_filter;
+    int i_ret;
+
+    if( (i_cpu_detected & p_variants[i].i_cpu) != p_variants[i].i_cpu )
+        return NULL;
+    cpu_flags = (i_cpu_detected & ~SIMD_FLAGS) | p_variants[i].i_cpu;
+
+    p_filter = vlc_object_create( p_obj, sizeof( filter_t ) );
+    assert( p_filter != NULL );
+    es_format_Init( &p_filter->fmt_in, VIDEO_ES, i_chroma );
+    es_format_Init( &p_filter->fmt_out, VIDEO_ES, p_outputs[i_output].i_chroma );
+    set_size( &p_filter->fmt_in.video, i_chroma, i_width, i_height );
+    set_size( &p_filter->fmt_out.video, p_outputs[i_output].i_chroma,
+              i_width, i_height );
+    p_filter->fmt_out.video.i_rmask = p_outputs[i_output].i_rmask;
+    p_filter->fmt_out.video.i_gmask = p_outputs[i_output].i_gmask;
+    p_filter->fmt_out.video.i_bmask = p_outputs[i_output].i_bmask;
+    p_filter->pf_vout_buffer_new = BufferNew;
+    p_filter->pf_vout_buffer_del = BufferDel;
+    p_filter->p_slices = filter_slices_New( p_obj, i_threads );
+    /* Without SIMD, the conversion only opens if asked for by name */
+    p_filter->b_force = p_variants[i].i_cpu == 0;
+    var_Create( p_filter, "rgb-matrix", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "rgb-matrix", i_matrix );
+
+    i_ret = is_rgb( i_output ) ? OpenRGB( VLC_OBJECT(p_filter) )
+                               : OpenPacked( VLC_OBJECT(p_filter) );
+    assert( i_ret == VLC_SUCCESS );
+    return p_filter;
+}
+
+static void delete_variant( filter_t *p_filter )
+{
+    CloseSIMD( VLC_OBJECT(p_filter) );
+    filter_slices_Delete( p_filter->p_slices );
+    vlc_object_release( p_filter );
+}
+
+static picture_t *convert( filter_t *p_filter, picture_t *p_in )
+{
+    picture_t *p_out;
+
+    picture_Yield( p_in );
+    p_out = p_filter->pf_video_filter( p_filter, p_in );
+    assert( p_out != NULL );
+    return p_out;
+}
+
+static void fill_random( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        for( int j = 0; j < p_pic->p[i].i_pitch * p_pic->p[i].i_lines; j++ )
+            p_pic->p[i].p_pixels[j] = rand();
+}
+
+static bool same_pixels( const picture_t *p_a, const picture_t *p_b )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+        for( int y = 0; y < p_a->p[i].i_visible_lines; y++ )
+            if( memcmp( &p_a->p[i].p_pixels[y * p_a->p[i].i_pitch],
+                        &p_b->p[i].p_pixels[y * p_b->p[i].i_pitch],
+                        p_a->p[i].i_visible_pitch ) )
+                return false;
+    return true;
+}
+
+/* The exact conversion of a pixel */
+static void reference( int i_matrix, bool b_full, int i_y, int i_u, int i_v,
+                       double pf_rgb[3] )
+{
+    const double f_kr = i_matrix == 709 ? .2126 : .299;
+    const double f_kb = i_matrix == 709 ? .0722 : .114;
+    const double f_kg = 1. - f_kr - f_kb;
+    const double f_y = b_full ? i_y : ( i_y - 16 ) * 255. / 219.;
+    const double f_u = ( i_u - 128 ) * ( b_full ? 1. : 255. / 224. );
+    const double f_v = ( i_v - 128 ) * ( b_full ? 1. : 255. / 224. );
+
+    pf_rgb[0] = f_y + 2. * ( 1. - f_kr ) * f_v;
+    pf_rgb[1] = f_y - 2. * f_kb * ( 1. - f_kb ) / f_kg * f_u
+                    - 2. * f_kr * ( 1. - f_kr ) / f_kg * f_v;
+    pf_rgb[2] = f_y + 2. * ( 1. - f_kb ) * f_u;
+    for( int i = 0; i < 3; i++ )
+        pf_rgb[i] = pf_rgb[i] < 0. ? 0. : pf_rgb[i] > 255. ? 255. : pf_rgb[i];
+}
+
+/* The C RV32 conversion is within 2 of the exact one */
+static void check_accuracy( const picture_t *p_in, const picture_t *p_out,
+                            int i_matrix, bool b_full, bool b_420 )
+{
+    for( int y = 0; y < p_out->p->i_visible_lines; y++ )
+        for( int x = 0; x < p_out->p->i_visible_pitch / 4; x++ )
+        {
+            const int i_c = b_420 ? y / 2 : y;
+            const uint8_t *p_pixel = &p_out->p->p_pixels[y * p_out->p->i_pitch
+                                                         + 4 * x];
+            double pf_rgb[3];
+
+            reference( i_matrix, b_full,
+                       p_in->Y_PIXELS[y * p_in->Y_PITCH + x],
+                       p_in->U_PIXELS[i_c * p_in->U_PITCH + x / 2],
+                       p_in->V_PIXELS[i_c * p_in->V_PITCH + x / 2], pf_rgb );
+            /* RV32 is 0x00RRGGBB */
+            for( int i = 0; i < 3; i++ )
+                assert( fabs( p_pixel[2 - i] - pf_rgb[i] ) <= 2. );
+        }
+}
+
+/* The packed conversions only move the samples around */
+static void check_packed( const picture_t *p_in, const picture_t *p_out,
+                          unsigned i_output )
+{
+    const vlc_fourcc_t i_chroma = p_outputs[i_output].i_chroma;
+    const char *psz_order =
+        i_chroma == VLC_FOURCC('Y','V','Y','U') ? "YVYU" :
+        i_chroma == VLC_FOURCC('U','Y','V','Y') ? "UYVY" : "YUYV";
+
+    for( int y = 0; y < p_out->p->i_visible_lines; y++ )
+        for( int x = 0; x < p_out->p->i_visible_pitch / 2; x++ )
+        {
+            const uint8_t *p_pair = &p_out->p->p_pixels[y * p_out->p->i_pitch
+                                                        + 4 * ( x / 2 )];
+            for( int i = 0; i < 4; i++ )
+                switch( psz_order[i] )
+                {
+                    case 'Y':
+                        if( i / 2 == x % 2 )
+                            assert( p_pair[i] == p_in->Y_PIXELS[
+                                        y * p_in->Y_PITCH + x] );
+                        break;
+                    case 'U':
+                        assert( p_pair[i] == p_in->U_PIXELS[
+                                    y / 2 * p_in->U_PITCH + x / 2] );
+                        break;
+                    case 'V':
+                        assert( p_pair[i] == p_in->V_PIXELS[
+                                    y / 2 * p_in->V_PITCH + x / 2] );
+                        break;
+                }
+        }
+}
+
+static void test_size( vlc_fourcc_t i_chroma, int i_width, int i_height )
+{
+    static const int pi_matrices[] = { 601, 709 };
+    const bool b_full = i_chroma == J420 || i_chroma == J422;
+    const bool b_420 = i_chroma == I420 || i_chroma == J420;
+    picture_t *p_in = picture_New( i_chroma, i_width, i_height, 0 );
+
+    assert( p_in != NULL );
+    fill_random( p_in );
+
+    for( unsigned o = 0; o < OUTPUTS; o++ )
+        for( unsigned m = 0; m < 2; m++ )
+        {
+            filter_t *p_filter;
+            picture_t *p_ref;
+
+            if( !is_rgb( o ) && ( i_chroma != I420 || m > 0 ) )
+                continue;
+
+            p_filter = new_variant( 0, o, pi_matrices[m], 1, i_chroma,
+                                    i_width, i_height );
+            p_ref = convert( p_filter, p_in );
+            delete_variant( p_filter );
+            if( o == 0 )
+                check_accuracy( p_in, p_ref, pi_matrices[m], b_full, b_420 );
+            else if( !is_rgb( o ) )
+                check_packed( p_in, p_ref, o );
+
+            for( unsigned i = 0; i < VARIANTS; i++ )
+                for( unsigned i_threads = 1; i_threads <= 3; i_threads += 2 )
+                {
+                    picture_t *p_out;
+
+                    p_filter = new_variant( i, o, pi_matrices[m], i_threads,
+                                            i_chroma, i_width, i_height );
+                    if( p_filter == NULL )
+                        continue;
+                    p_out = convert( p_filter, p_in );
+                    assert( same_pixels( p_ref, p_out ) );
+                    picture_Release( p_out );
+                    delete_variant( p_filter );
+                }
+            picture_Release( p_ref );
+        }
+
+    picture_Release( p_in );
+}
+
+/* Automatic uses BT.709 above 576 lines */
+static void test_matrix( void )
+{
+    for( int i_height = 576; i_height <= 578; i_height += 2 )
+    {
+        picture_t *p_in = picture_New( I420, 32, i_height, 0 );
+        picture_t *p_out[2];
+
+        assert( p_in != NULL );
+        fill_random( p_in );
+        for( int k = 0; k < 2; k++ )
+        {
+            filter_t *p_filter = new_variant( 0, 0, k == 0 ? 0 : 709, 1,
+                                              I420, 32, i_height );
+
+            p_out[k] = convert( p_filter, p_in );
+            delete_variant( p_filter );
+        }
+        assert( same_pixels( p_out[0], p_out[1] ) == ( i_height > 576 ) );
+        picture_Release( p_out[0] );
+        picture_Release( p_out[1] );
+        picture_Release( p_in );
+    }
+}
+
+static void bench_size( int i_width, int i_height )
+{
+    picture_t *p_in = picture_New( I420, i_width & ~1, i_height & ~1, 0 );
+
+    assert( p_in != NULL );
+    fill_random( p_in );
+
+    printf( "%dx%d I420:\n", p_in->p->i_visible_pitch,
+            p_in->p->i_visible_lines );
+    for( unsigned o = 0; o < OUTPUTS; o++ )
+        for( unsigned i = 0; i < VARIANTS; i++ )
+        {
+            filter_t *p_filter = new_variant( i, o, 601, 1, I420,
+                                              p_in->p->i_visible_pitch,
+                                              p_in->p->i_visible_lines );
+            mtime_t i_start, i_time;
+            int i_frames = 0;
+            char psz_name[32];
+            double f_fps;
+
+            if( p_filter == NULL )
+                continue;
+            i_start = mdate();
+            do
+            {
+                picture_Release( convert( p_filter, p_in ) );
+                i_frames++;
+            } while( (i_time = mdate() - i_start) < 500000 );
+            delete_variant( p_filter );
+
+            f_fps = i_frames * 1000000. / i_time;
+            snprintf( psz_name, sizeof(psz_name), "%s %s",
+                      p_outputs[o].psz_name, p_variants[i].psz_name );
+            printf( "  %-16s %8.1f fps, %8.1f Mpixel/s\n", psz_name, f_fps,
+                    f_fps * p_in->p->i_visible_pitch
+                          * p_in->p->i_visible_lines / 1000000. );
+        }
+
+    picture_Release( p_in );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--plugin-path=/dev/null"
+    };
+    static const struct
+    {
+        vlc_fourcc_t i_chroma;
+        int i_width, i_height;
+    } p_sizes[] = {
+        { I420, 64, 48 },
+        { I420, 2, 2 },
+        { I420, 18, 6 },
+        { I420, 130, 34 },
+        { J420, 96, 16 },
+        { I422, 62, 10 },
+        { J422, 100, 4 },
+    };
+    libvlc_int_t *p_libvlc = libvlc_InternalCreate();
+
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 4, ppsz_vlc_argv ) == 0 );
+    p_obj = VLC_OBJECT(p_libvlc);
+    i_cpu_detected = CPUCapabilities();
+
+    for( unsigned i = 0; i < sizeof(p_sizes) / sizeof(p_sizes[0]); i++ )
+        test_size( p_sizes[i].i_chroma,
+                   p_sizes[i].i_width, p_sizes[i].i_height );
+    test_matrix();
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        int i_width, i_height;
+
+        if( sscanf( ppsz_argv[i], "%dx%d", &i_width, &i_height ) == 2
+         && i_width > 1 && i_height > 1 )
+            bench_size( i_width, i_height );
+        else
+            fprintf( stderr, "%s: not a picture size\n", ppsz_argv[i] );
+    }
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
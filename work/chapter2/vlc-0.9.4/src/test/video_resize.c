@@ -0,0 +1,467 @@
+/*****************************************************************************
+ * video_resize.c: Test and benchmark for the filtered video scaler
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Without arguments, this checks that every variant of the scaler gives the
+ * same pictures as the C one whatever the number of threads, that scaling to
+ * the same size changes nothing, that flat pictures stay flat, and that the
+ * filtered methods keep more details than the nearest neighbour. Given
+ * picture sizes, it also reports the throughput of each method and variant
+ * when halving and doubling them, and the PSNR of a picture scaled down
+ * then up again:
+ *   ./test_resize 1920x1080 720x576
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include "control/libvlc_internal.h"
+#include <vlc_vout.h>
+#include <vlc_filter.h>
+
+#include "libvlc.h"
+#include "../../modules/video_filter/resize.h"
+
+#define I420 VLC_FOURCC('I','4','2','0')
+#define I422 VLC_FOURCC('I','4','2','2')
+#define RV24 VLC_FOURCC('R','V','2','4')
+#define RV32 VLC_FOURCC('R','V','3','2')
+
+/* The variants of the vertical pass, selected by the CPU flags */
+static const struct
+{
+    const char *psz_name;
+    unsigned    i_cpu;
+} p_variants[] =
+{
+    { "C",     0 },
+#if defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
+    { "SSE2",  CPU_CAPABILITY_SSE2 },
+# if defined(CAN_COMPILE_AVX2)
+    { "AVX2",  CPU_CAPABILITY_SSE2 | CPU_CAPABILITY_AVX2 },
+# endif
+#endif
+};
+#define VARIANTS (sizeof(p_variants) / sizeof(p_variants[0]))
+
+static const char *const ppsz_methods[] = { "bilinear", "bicubic", "lanczos" };
+#define METHODS (sizeof(ppsz_methods) / sizeof(ppsz_methods[0]))
+
+static vlc_object_t *p_obj;
+static uint32_t i_cpu_detected;
+
+static picture_t *BufferNew( filter_t *p_filter )
+{
+    const video_format_t *p_fmt = &p_filter->fmt_out.video;
+
+    return picture_New( p_fmt->i_chroma, p_fmt->i_width, p_fmt->i_height,
+                        p_fmt->i_aspect );
+}
+
+static void BufferDel( filter_t *p_filter, picture_t *p_pic )
+{
+    (void)p_filter;
+    picture_Release( p_pic );
+}
+
+static void set_size( video_format_t *p_fmt, vlc_fourcc_t i_chroma,
+                      int i_width, int i_height )
+{
+    p_fmt->i_chroma = i_chroma;
+    p_fmt->i_width = p_fmt->i_visible_width = i_width;
+    p_fmt->i_height = p_fmt->i_visible_height = i_height;
+    p_fmt->i_aspect = VOUT_ASPECT_FACTOR * i_width / i_height;
+}
+
+static filter_t *new_variant( unsigned i, int i_method, unsigned i_threads,
+                              vlc_fourcc_t i_chroma, int i_src_width,
+                              int i_src_height, int i_dst_width,
+                              int i_dst_height )
+{
+    filter_t *p_filter;
+
+    if( (i_cpu_detected & p_variants[i].i_cpu) != p_variants[i].i_cpu )
+        return NULL;
+    cpu_flags = (i_cpu_detected & ~(CPU_CAPABILITY_SSE2|CPU_CAPABILITY_AVX2))
+              | p_variants[i].i_cpu;
+
+    p_filter = vlc_object_create( p_obj, sizeof( filter_t ) );
+    assert( p_filter != NULL );
+    es_format_Init( &p_filter->fmt_in, VIDEO_ES, i_chroma );
+    es_format_Init( &p_filter->fmt_out, VIDEO_ES, i_chroma );
+    set_size( &p_filter->fmt_in.video, i_chroma, i_src_width, i_src_height );
+    set_size( &p_filter->fmt_out.video, i_chroma, i_dst_width, i_dst_height );
+    p_filter->pf_vout_buffer_new = BufferNew;
+    p_filter->pf_vout_buffer_del = BufferDel;
+    p_filter->p_slices = filter_slices_New( p_obj, i_threads );
+    var_Create( p_filter, "resize-method", VLC_VAR_INTEGER );
+    var_SetInteger( p_filter, "resize-method", i_method );
+    assert( OpenResize( VLC_OBJECT(p_filter) ) == VLC_SUCCESS );
+    return p_filter;
+}
+
+static void delete_variant( filter_t *p_filter )
+{
+    CloseResize( VLC_OBJECT(p_filter) );
+    filter_slices_Delete( p_filter->p_slices );
+    vlc_object_release( p_filter );
+}
+
+static picture_t *resize( filter_t *p_filter, picture_t *p_in )
+{
+    picture_t *p_out;
+
+    picture_Yield( p_in );
+    p_out = p_filter->pf_video_filter( p_filter, p_in );
+    assert( p_out != NULL );
+    return p_out;
+}
+
+static void fill_random( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        for( int j = 0; j < p_pic->p[i].i_pitch * p_pic->p[i].i_lines; j++ )
+            p_pic->p[i].p_pixels[j] = rand();
+}
+
+/* A smooth picture with some fine details, as found in real videos */
+static void fill_smooth( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = 128
+                    + 60 * sin( x * .05 + i ) * cos( y * .07 )
+                    + 30 * sin( ( x + 2 * y ) * .3 );
+    }
+}
+
+static bool same_pixels( const picture_t *p_a, const picture_t *p_b )
+{
+    for( int i = 0; i < p_a->i_planes; i++ )
+        for( int y = 0; y < p_a->p[i].i_visible_lines; y++ )
+            if( memcmp( &p_a->p[i].p_pixels[y * p_a->p[i].i_pitch],
+                        &p_b->p[i].p_pixels[y * p_b->p[i].i_pitch],
+                        p_a->p[i].i_visible_pitch ) )
+                return false;
+    return true;
+}
+
+static double psnr( const picture_t *p_a, const picture_t *p_b )
+{
+    double f_error = 0.;
+    int i_count = 0;
+
+    for( int i = 0; i < p_a->i_planes; i++ )
+        for( int y = 0; y < p_a->p[i].i_visible_lines; y++ )
+            for( int x = 0; x < p_a->p[i].i_visible_pitch; x++ )
+            {
+                const int d = p_a->p[i].p_pixels[y * p_a->p[i].i_pitch + x]
+                            - p_b->p[i].p_pixels[y * p_b->p[i].i_pitch + x];
+                f_error += d * d;
+                i_count++;
+            }
+    if( f_error == 0. )
+        return 99.;
+    return 10. * log10( 255. * 255. * i_count / f_error );
+}
+
+/* The nearest neighbour, as the scale submodule does it */
+static void nearest( picture_t *p_dst, const picture_t *p_src )
+{
+    for( int i = 0; i < p_dst->i_planes; i++ )
+    {
+        const plane_t *s = &p_src->p[i];
+        plane_t *d = &p_dst->p[i];
+
+        for( int y = 0; y < d->i_visible_lines; y++ )
+            for( int x = 0; x < d->i_visible_pitch; x++ )
+                d->p_pixels[y * d->i_pitch + x] = s->p_pixels[
+                        y * s->i_visible_lines / d->i_visible_lines
+                          * s->i_pitch
+                      + x * s->i_visible_pitch / d->i_visible_pitch];
+    }
+}
+
+/* Down then up again, the PSNR tells how much detail was kept */
+static double round_trip( int i_method, int i_width, int i_height,
+                          int i_small_width, int i_small_height,
+                          picture_t *p_in )
+{
+    picture_t *p_small, *p_out;
+    double f_psnr;
+
+    if( i_method < 0 )
+    {
+        p_small = picture_New( I420, i_small_width, i_small_height, 0 );
+        p_out = picture_New( I420, i_width, i_height, 0 );
+        assert( p_small != NULL && p_out != NULL );
+        nearest( p_small, p_in );
+        nearest( p_out, p_small );
+    }
+    else
+    {
+        filter_t *p_down = new_variant( 0, i_method, 1, I420, i_width,
+                                        i_height, i_small_width,
+                                        i_small_height );
+        filter_t *p_up = new_variant( 0, i_method, 1, I420, i_small_width,
+                                      i_small_height, i_width, i_height );
+
+        p_small = resize( p_down, p_in );
+        p_out = resize( p_up, p_small );
+        delete_variant( p_down );
+        delete_variant( p_up );
+    }
+    f_psnr = psnr( p_in, p_out );
+    picture_Release( p_small );
+    picture_Release( p_out );
+    return f_psnr;
+}
+
+static void test_size( vlc_fourcc_t i_chroma, int i_src_width,
+                       int i_src_height, int i_dst_width, int i_dst_height )
+{
+    picture_t *p_in = picture_New( i_chroma, i_src_width, i_src_height, 0 );
+
+    assert( p_in != NULL );
+    fill_random( p_in );
+
+    for( unsigned m = 0; m < METHODS; m++ )
+    {
+        filter_t *p_filter = new_variant( 0, m, 1, i_chroma, i_src_width,
+                                          i_src_height, i_dst_width,
+                                          i_dst_height );
+        picture_t *p_ref = resize( p_filter, p_in );
+
+        delete_variant( p_filter );
+        if( i_src_width == i_dst_width && i_src_height == i_dst_height )
+            assert( same_pixels( p_in, p_ref ) );
+
+        for( unsigned i = 0; i < VARIANTS; i++ )
+            for( unsigned i_threads = 1; i_threads <= 5; i_threads += 2 )
+            {
+                picture_t *p_out;
+
+                p_filter = new_variant( i, m, i_threads, i_chroma,
+                                        i_src_width, i_src_height,
+                                        i_dst_width, i_dst_height );
+                if( p_filter == NULL )
+                    continue;
+                /* Twice, the second time with the cached tables */
+                for( int k = 0; k < 2; k++ )
+                {
+                    p_out = resize( p_filter, p_in );
+                    assert( same_pixels( p_ref, p_out ) );
+                    picture_Release( p_out );
+                }
+                delete_variant( p_filter );
+            }
+        picture_Release( p_ref );
+    }
+
+    /* Flat pictures stay flat, even with the negative lobes */
+    for( int j = 0; j < p_in->i_planes; j++ )
+        memset( p_in->p[j].p_pixels, 16 + 100 * j,
+                p_in->p[j].i_pitch * p_in->p[j].i_lines );
+    for( unsigned m = 0; m < METHODS; m++ )
+        for( unsigned i = 0; i < VARIANTS; i++ )
+        {
+            filter_t *p_filter = new_variant( i, m, 2, i_chroma, i_src_width,
+                                              i_src_height, i_dst_width,
+                                              i_dst_height );
+            picture_t *p_out;
+
+            if( p_filter == NULL )
+                continue;
+            p_out = resize( p_filter, p_in );
+            for( int j = 0; j < p_out->i_planes; j++ )
+                for( int y = 0; y < p_out->p[j].i_visible_lines; y++ )
+                    for( int x = 0; x < p_out->p[j].i_visible_pitch; x++ )
+                        assert( p_out->p[j].p_pixels[y * p_out->p[j].i_pitch
+                                                     + x] == 16 + 100 * j );
+            picture_Release( p_out );
+            delete_variant( p_filter );
+        }
+
+    picture_Release( p_in );
+}
+
+/* The owner may change the formats between two pictures */
+static void test_format_change( void )
+{
+    filter_t *p_filter = new_variant( 0, RESIZE_BICUBIC, 1, RV32, 40, 30,
+                                      20, 15 );
+
+    for( int i = 1; i < 5; i++ )
+    {
+        picture_t *p_in, *p_out;
+
+        set_size( &p_filter->fmt_in.video, RV32, 13 * i, 7 * i );
+        set_size( &p_filter->fmt_out.video, RV32, 5 * i + 3, 11 * i );
+        p_in = picture_New( RV32, 13 * i, 7 * i, 0 );
+        assert( p_in != NULL );
+        fill_random( p_in );
+        p_out = resize( p_filter, p_in );
+        assert( p_out->p[0].i_visible_lines == 11 * i );
+        picture_Release( p_out );
+        picture_Release( p_in );
+    }
+    delete_variant( p_filter );
+}
+
+static void test_quality( void )
+{
+    picture_t *p_in = picture_New( I420, 320, 240, 0 );
+    double f_nearest;
+
+    assert( p_in != NULL );
+    fill_smooth( p_in );
+    f_nearest = round_trip( -1, 320, 240, 160, 120, p_in );
+    for( unsigned m = 0; m < METHODS; m++ )
+        assert( round_trip( m, 320, 240, 160, 120, p_in ) > f_nearest );
+    picture_Release( p_in );
+}
+
+static void bench_size( int i_width, int i_height )
+{
+    static const unsigned p_threads[] = { 1, 2, 4 };
+    const int i_half_width = __MAX( i_width / 2, 1 );
+    const int i_half_height = __MAX( i_height / 2, 1 );
+    picture_t *p_in = picture_New( I420, i_width, i_height, 0 );
+    picture_t *p_half = picture_New( I420, i_half_width, i_half_height, 0 );
+
+    assert( p_in != NULL && p_half != NULL );
+    fill_smooth( p_in );
+    fill_smooth( p_half );
+
+    printf( "%dx%d I420, halved and doubled:\n", i_width, i_height );
+    for( unsigned m = 0; m < METHODS; m++ )
+        for( unsigned i = 0; i < VARIANTS; i++ )
+            for( unsigned t = 0; t < sizeof(p_threads) / sizeof(p_threads[0]);
+                 t++ )
+            {
+                double pf_fps[2];
+                char psz_name[32];
+
+                if( (i_cpu_detected & p_variants[i].i_cpu)
+                     != p_variants[i].i_cpu )
+                    continue;
+                for( int k = 0; k < 2; k++ )
+                {
+                    filter_t *p_filter = k == 0
+                        ? new_variant( i, m, p_threads[t], I420, i_width,
+                                       i_height, i_half_width, i_half_height )
+                        : new_variant( i, m, p_threads[t], I420, i_half_width,
+                                       i_half_height, i_width, i_height );
+                    mtime_t i_start, i_time;
+                    int i_frames = 0;
+
+                    i_start = mdate();
+                    do
+                    {
+                        picture_Release( resize( p_filter,
+                                                 k == 0 ? p_in : p_half ) );
+                        i_frames++;
+                    } while( (i_time = mdate() - i_start) < 500000 );
+                    delete_variant( p_filter );
+                    pf_fps[k] = i_frames * 1000000. / i_time;
+                }
+
+                snprintf( psz_name, sizeof(psz_name), "%s %s x%u",
+                          ppsz_methods[m], p_variants[i].psz_name,
+                          p_threads[t] );
+                printf( "  %-18s %8.1f fps down, %8.1f fps up\n", psz_name,
+                        pf_fps[0], pf_fps[1] );
+            }
+
+    printf( "  PSNR after halving and doubling: nearest %.2f dB",
+            round_trip( -1, i_width, i_height, i_half_width, i_half_height,
+                        p_in ) );
+    for( unsigned m = 0; m < METHODS; m++ )
+        printf( ", %s %.2f dB", ppsz_methods[m],
+                round_trip( m, i_width, i_height, i_half_width,
+                            i_half_height, p_in ) );
+    printf( "\n" );
+
+    picture_Release( p_in );
+    picture_Release( p_half );
+}
+
+int main( int i_argc, char **ppsz_argv )
+{
+    static const char *ppsz_vlc_argv[] = {
+        "vlc", "--ignore-config", "--quiet", "--plugin-path=/dev/null"
+    };
+    static const struct
+    {
+        vlc_fourcc_t i_chroma;
+        int i_src_width, i_src_height, i_dst_width, i_dst_height;
+    } p_sizes[] = {
+        { I420, 64, 48, 64, 48 },
+        { I420, 64, 48, 32, 24 },
+        { I420, 17, 9, 40, 31 },
+        { I420, 320, 240, 171, 97 },
+        { I420, 4, 2, 2, 2 },
+        { I420, 2, 2, 7, 5 },
+        { I422, 100, 60, 33, 60 },
+        { RV24, 50, 40, 77, 23 },
+        { RV32, 61, 13, 61, 13 },
+        { RV32, 61, 13, 19, 45 },
+    };
+    libvlc_int_t *p_libvlc = libvlc_InternalCreate();
+
+    assert( p_libvlc != NULL );
+    assert( libvlc_InternalInit( p_libvlc, 4, ppsz_vlc_argv ) == 0 );
+    p_obj = VLC_OBJECT(p_libvlc);
+    i_cpu_detected = CPUCapabilities();
+
+    for( unsigned i = 0; i < sizeof(p_sizes) / sizeof(p_sizes[0]); i++ )
+        test_size( p_sizes[i].i_chroma,
+                   p_sizes[i].i_src_width, p_sizes[i].i_src_height,
+                   p_sizes[i].i_dst_width, p_sizes[i].i_dst_height );
+    test_format_change();
+    test_quality();
+
+    for( int i = 1; i < i_argc; i++ )
+    {
+        int i_width, i_height;
+
+        if( sscanf( ppsz_argv[i], "%dx%d", &i_width, &i_height ) == 2
+         && i_width > 0 && i_height > 0 )
+            bench_size( i_width, i_height );
+        else
+            fprintf( stderr, "%s: not a picture size\n", ppsz_argv[i] );
+    }
+
+    libvlc_InternalCleanup( p_libvlc );
+    libvlc_InternalDestroy( p_libvlc );
+    return 0;
+}
@@ -47,6 +47,7 @@
 
 #include <vlc_filter.h>
 #include <vlc_osd.h>
+#include <vlc_codec.h>
 
 #if defined( __APPLE__ )
 /* Include darwin_specific.h here if needed */
@@ -59,6 +60,7 @@
 #include "modules/modules.h"
 #include <assert.h>
 #include "vout_pictures.h"
+#include "vout_snapshot.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -91,7 +93,11 @@ int vout_Snapshot( vout_thread_t *, picture_t * );
 static void DisplayTitleOnOSD( vout_thread_t *p_vout );
 
 /* */
+static int  HeapCreate( vout_thread_t *, int );
+static void HeapDestroy( vout_thread_t * );
+static int  RenderPicturesRequired( vlc_object_t * );
 static void DropPicture( vout_thread_t *p_vout, picture_t *p_picture );
+static void WaitPicture( vout_thread_t *, unsigned, mtime_t );
 
 /*****************************************************************************
  * Video Filter2 functions
@@ -186,6 +192,7 @@ vout_thread_t *__vout_Request( vlc_object_t *p_this, vout_thread_t *p_vout,
         if( p_vout->fmt_render.i_chroma != p_fmt->i_chroma ||
             p_vout->fmt_render.i_width != p_fmt->i_width ||
             p_vout->fmt_render.i_height != p_fmt->i_height ||
+            p_vout->i_render_pictures < RenderPicturesRequired( p_this ) ||
             p_vout->b_filter_change )
         {
             vlc_mutex_unlock( &p_vout->change_lock );
@@ -305,9 +312,15 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
     if( p_vout == NULL )
         return NULL;
 
+    if( HeapCreate( p_vout, RenderPicturesRequired( p_parent ) ) )
+    {
+        vlc_object_release( p_vout );
+        return NULL;
+    }
+
     /* Initialize pictures - translation tables and functions
      * will be initialized later in InitThread */
-    for( i_index = 0; i_index < 2 * VOUT_MAX_PICTURES + 1; i_index++)
+    for( i_index = 0; i_index < p_vout->i_heap_pictures; i_index++)
     {
         p_vout->p_picture[i_index].pf_lock = NULL;
         p_vout->p_picture[i_index].pf_unlock = NULL;
@@ -334,11 +347,11 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
     p_vout->render.i_gmask    = p_fmt->i_gmask;
     p_vout->render.i_bmask    = p_fmt->i_bmask;
 
-    p_vout->render.i_last_used_pic = -1;
     p_vout->render.b_allow_modify_pics = 1;
 
     /* Zero the output heap */
     I_OUTPUTPICTURES = 0;
+    p_vout->output.i_last_used_pic = 0;
     p_vout->output.i_width    = 0;
     p_vout->output.i_height   = 0;
     p_vout->output.i_chroma   = 0;
@@ -368,6 +381,9 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
     vlc_mutex_init( &p_vout->picture_lock );
     vlc_mutex_init( &p_vout->change_lock );
     vlc_mutex_init( &p_vout->vfilter_lock );
+    vlc_cond_init( p_vout, &p_vout->picture_released );
+    vlc_cond_init( p_vout, &p_vout->picture_queued );
+    p_vout->i_picture_queued = 0;
 
     /* Mouse coordinates */
     var_Create( p_vout, "mouse-x", VLC_VAR_INTEGER );
@@ -451,6 +467,7 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
         msg_Err( p_vout, "no suitable vout module" );
         // FIXME it's ugly but that's exactly the function that need to be called.
         EndThread( p_vout );
+        HeapDestroy( p_vout );
         vlc_object_detach( p_vout );
         vlc_object_release( p_vout );
         return NULL;
@@ -474,6 +491,10 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
     var_Change( p_vout, "deinterlace", VLC_VAR_ADDCHOICE, &val, &text );
     val.psz_string = (char *)"x"; text.psz_string = (char *)"X";
     var_Change( p_vout, "deinterlace", VLC_VAR_ADDCHOICE, &val, &text );
+    val.psz_string = (char *)"yadif"; text.psz_string = (char *)"Yadif";
+    var_Change( p_vout, "deinterlace", VLC_VAR_ADDCHOICE, &val, &text );
+    val.psz_string = (char *)"yadif2x"; text.psz_string = _("Yadif (2x)");
+    var_Change( p_vout, "deinterlace", VLC_VAR_ADDCHOICE, &val, &text );
 
     if( var_Get( p_vout, "deinterlace-mode", &val ) == VLC_SUCCESS )
     {
@@ -504,6 +525,7 @@ vout_thread_t * __vout_Create( vlc_object_t *p_parent, video_format_t *p_fmt )
                            VLC_THREAD_PRIORITY_OUTPUT, true ) )
     {
         module_Unneed( p_vout, p_vout->p_module );
+        HeapDestroy( p_vout );
         vlc_object_release( p_vout );
         return NULL;
     }
@@ -550,7 +572,10 @@ static void vout_Destructor( vlc_object_t * p_this )
     vlc_mutex_destroy( &p_vout->picture_lock );
     vlc_mutex_destroy( &p_vout->change_lock );
     vlc_mutex_destroy( &p_vout->vfilter_lock );
+    vlc_cond_destroy( &p_vout->picture_released );
+    vlc_cond_destroy( &p_vout->picture_queued );
 
+    HeapDestroy( p_vout );
     free( p_vout->psz_filter_chain );
 
     config_ChainDestroy( p_vout->p_cfg );
@@ -707,14 +732,17 @@ static int InitThread( vout_thread_t *p_vout )
          * for memcpy operations */
         p_vout->b_direct = 1;
 
-        for( i = 1; i < VOUT_MAX_PICTURES; i++ )
+        for( i = 1; i < p_vout->i_heap_pictures - 1 &&
+                    I_RENDERPICTURES < p_vout->i_render_pictures; i++ )
         {
             if( p_vout->p_picture[ i ].i_type != DIRECT_PICTURE &&
                 I_RENDERPICTURES >= VOUT_MIN_DIRECT_PICTURES - 1 &&
+                p_vout->i_render_pictures <= VOUT_MAX_PICTURES &&
                 p_vout->p_picture[ i - 1 ].i_type == DIRECT_PICTURE )
             {
                 /* We have enough direct buffers so there's no need to
-                 * try to use system memory buffers. */
+                 * try to use system memory buffers, unless more pictures
+                 * than usual were requested. */
                 break;
             }
             PP_RENDERPICTURE[ I_RENDERPICTURES ] = &p_vout->p_picture[ i ];
@@ -723,7 +751,7 @@ static int InitThread( vout_thread_t *p_vout )
 
         msg_Dbg( p_vout, "direct render, mapping "
                  "render pictures 0-%i to system pictures 1-%i",
-                 VOUT_MAX_PICTURES - 2, VOUT_MAX_PICTURES - 1 );
+                 I_RENDERPICTURES - 1, I_RENDERPICTURES );
     }
     else
     {
@@ -738,21 +766,21 @@ static int InitThread( vout_thread_t *p_vout )
             return VLC_EGENERIC;
         }
 
-        msg_Dbg( p_vout, "indirect render, mapping "
-                 "render pictures 0-%i to system pictures %i-%i",
-                 VOUT_MAX_PICTURES - 1, I_OUTPUTPICTURES,
-                 I_OUTPUTPICTURES + VOUT_MAX_PICTURES - 1 );
-
         /* Append render buffers after the direct buffers */
-        for( i = I_OUTPUTPICTURES; i < 2 * VOUT_MAX_PICTURES; i++ )
+        for( i = I_OUTPUTPICTURES; i < p_vout->i_heap_pictures - 1; i++ )
         {
             PP_RENDERPICTURE[ I_RENDERPICTURES ] = &p_vout->p_picture[ i ];
             I_RENDERPICTURES++;
 
             /* Check if we have enough render pictures */
-            if( I_RENDERPICTURES == VOUT_MAX_PICTURES )
+            if( I_RENDERPICTURES == p_vout->i_render_pictures )
                 break;
         }
+
+        msg_Dbg( p_vout, "indirect render, mapping "
+                 "render pictures 0-%i to system pictures %i-%i",
+                 I_RENDERPICTURES - 1, I_OUTPUTPICTURES,
+                 I_OUTPUTPICTURES + I_RENDERPICTURES - 1 );
     }
 
     /* Link pictures back to their heap */
@@ -766,6 +794,18 @@ static int InitThread( vout_thread_t *p_vout )
         PP_OUTPUTPICTURE[ i ]->p_heap = &p_vout->output;
     }
 
+    /* Fill the stack of render pictures vout_CreatePicture takes from,
+     * with the ones that already have memory on top */
+    p_vout->i_free_pictures = 0;
+    for( i = 0 ; i < I_RENDERPICTURES ; i++ )
+        if( PP_RENDERPICTURE[ i ]->i_status == FREE_PICTURE )
+            p_vout->pp_free_picture[ p_vout->i_free_pictures++ ] =
+                PP_RENDERPICTURE[ i ];
+    for( i = 0 ; i < I_RENDERPICTURES ; i++ )
+        if( PP_RENDERPICTURE[ i ]->i_status == DESTROYED_PICTURE )
+            p_vout->pp_free_picture[ p_vout->i_free_pictures++ ] =
+                PP_RENDERPICTURE[ i ];
+
     return VLC_SUCCESS;
 }
 
@@ -823,10 +863,17 @@ static void* RunThread( vlc_object_t *p_this )
         picture_t *p_picture = NULL;
         picture_t *p_filtered_picture;
         mtime_t display_date = 0;
+        mtime_t wakeup_date = current_date + VOUT_IDLE_SLEEP;
+        unsigned i_queued;
         picture_t *p_directbuffer;
         input_thread_t *p_input;
         int i_index;
 
+        /* Pictures queued after this point will wake up the idle wait */
+        vlc_mutex_lock( &p_vout->picture_lock );
+        i_queued = p_vout->i_picture_queued;
+        vlc_mutex_unlock( &p_vout->picture_lock );
+
 #if 0
         p_vout->c_loops++;
         if( !(p_vout->c_loops % VOUT_STATS_NB_LOOPS) )
@@ -930,6 +977,8 @@ static void* RunThread( vlc_object_t *p_this )
                  * is far from the current one so the thread will perform an
                  * empty loop as if no picture were found. The picture state
                  * is unchanged */
+                if( display_date - VOUT_DISPLAY_DELAY < wakeup_date )
+                    wakeup_date = display_date - VOUT_DISPLAY_DELAY;
                 p_picture    = NULL;
                 display_date = 0;
             }
@@ -1027,7 +1076,7 @@ static void* RunThread( vlc_object_t *p_this )
         }
         else
         {
-            msleep( VOUT_IDLE_SLEEP );
+            WaitPicture( p_vout, i_queued, wakeup_date );
         }
 
         /* On awakening, take back lock and send immediately picture
@@ -1212,7 +1261,7 @@ static void CleanThread( vout_thread_t *p_vout )
         ChromaDestroy( p_vout );
 
     /* Destroy all remaining pictures */
-    for( i_index = 0; i_index < 2 * VOUT_MAX_PICTURES + 1; i_index++ )
+    for( i_index = 0; i_index < p_vout->i_heap_pictures; i_index++ )
     {
         if ( p_vout->p_picture[i_index].i_type == MEMORY_PICTURE )
         {
@@ -1246,6 +1295,10 @@ static void EndThread( vout_thread_t *p_vout )
 
     /* FIXME does that function *really* need to be called inside the thread ? */
 
+    /* Write the pending snapshots, whose preview may still use the spu */
+    vout_SnapshotDelete( p_vout->p_snapshot );
+    p_vout->p_snapshot = NULL;
+
     /* Destroy subpicture unit */
     spu_Attach( p_vout->p_spu, VLC_OBJECT(p_vout), false );
     spu_Destroy( p_vout->p_spu );
@@ -1296,6 +1349,8 @@ static int ChromaCreate( vout_thread_t *p_vout )
         return VLC_EGENERIC;
     }
     p_chroma->pf_vout_buffer_new = ChromaGetPicture;
+    p_chroma->p_slices = filter_slices_New( p_vout,
+                        var_CreateGetInteger( p_vout, "filter-threads" ) );
     return VLC_SUCCESS;
 }
 
@@ -1307,6 +1362,7 @@ static void ChromaDestroy( vout_thread_t *p_vout )
         return;
 
     module_Unneed( p_vout->p_chroma, p_vout->p_chroma->p_module );
+    filter_slices_Delete( p_vout->p_chroma->p_slices );
     vlc_object_release( p_vout->p_chroma );
     p_vout->p_chroma = NULL;
 }
@@ -1323,14 +1379,73 @@ static void DropPicture( vout_thread_t *p_vout, picture_t *p_picture )
     else
     {
         /* Destroy the picture without displaying it */
-        p_picture->i_status = DESTROYED_PICTURE;
-        p_vout->i_heap_size--;
+        vout_RecyclePicture( p_vout, p_picture );
     }
     vlc_mutex_unlock( &p_vout->picture_lock );
 }
 
 
 
+/* Number of render pictures needed by a video output for p_this */
+static int RenderPicturesRequired( vlc_object_t *p_this )
+{
+    int i_pictures = var_CreateGetInteger( p_this, "vout-pictures" );
+
+    /* Decoders may keep reference pictures linked */
+    if( p_this->i_object_type == VLC_OBJECT_DECODER )
+        i_pictures += ((decoder_t *)p_this)->i_extra_picture_buffers;
+
+    return __MAX( i_pictures, VOUT_MAX_PICTURES );
+}
+
+/* Allocate the picture heap: slots for the direct buffers, i_render render
+ * pictures, and the temporary picture used by vout_RenderPicture */
+static int HeapCreate( vout_thread_t *p_vout, int i_render )
+{
+    const int i_pictures = VOUT_MAX_PICTURES + i_render + 1;
+
+    p_vout->p_picture = calloc( i_pictures, sizeof( picture_t ) );
+    p_vout->render.pp_picture = calloc( i_pictures, sizeof( picture_t * ) );
+    p_vout->output.pp_picture = calloc( i_pictures, sizeof( picture_t * ) );
+    p_vout->pp_free_picture = calloc( i_pictures, sizeof( picture_t * ) );
+    if( !p_vout->p_picture || !p_vout->render.pp_picture ||
+        !p_vout->output.pp_picture || !p_vout->pp_free_picture )
+    {
+        HeapDestroy( p_vout );
+        return VLC_ENOMEM;
+    }
+    p_vout->i_heap_pictures = i_pictures;
+    p_vout->i_render_pictures = i_render;
+    p_vout->i_free_pictures = 0;
+    return VLC_SUCCESS;
+}
+
+static void HeapDestroy( vout_thread_t *p_vout )
+{
+    free( p_vout->p_picture );
+    free( p_vout->render.pp_picture );
+    free( p_vout->output.pp_picture );
+    free( p_vout->pp_free_picture );
+    p_vout->p_picture = NULL;
+    p_vout->render.pp_picture = p_vout->output.pp_picture = NULL;
+    p_vout->pp_free_picture = NULL;
+    p_vout->i_heap_pictures = 0;
+}
+
+/* Wait until a new picture is queued or the given date */
+static void WaitPicture( vout_thread_t *p_vout, unsigned i_queued,
+                         mtime_t deadline )
+{
+    vlc_mutex_lock( &p_vout->picture_lock );
+    while( p_vout->i_picture_queued == i_queued )
+    {
+        if( vlc_cond_timedwait( &p_vout->picture_queued,
+                                &p_vout->picture_lock, deadline ) )
+            break;
+    }
+    vlc_mutex_unlock( &p_vout->picture_lock );
+}
+
 /* following functions are local */
 
 static int ReduceHeight( int i_ratio )
@@ -50,6 +50,7 @@
 #include <vlc_strings.h>
 #include <vlc_charset.h>
 #include "../libvlc.h"
+#include "vout_snapshot.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -436,53 +437,6 @@ void vout_IntfInit( vout_thread_t *p_vout )
 /*****************************************************************************
  * vout_Snapshot: generates a snapshot.
  *****************************************************************************/
-/**
- * This function will inject a subpicture into the vout with the provided
- * picture
- */
-static int VoutSnapshotPip( vout_thread_t *p_vout, image_handler_t *p_image, picture_t *p_pic, const video_format_t *p_fmt_in )
-{
-    video_format_t fmt_in = *p_fmt_in;
-    video_format_t fmt_out;
-    picture_t *p_pip;
-    subpicture_t *p_subpic;
-
-    /* */
-    memset( &fmt_out, 0, sizeof(fmt_out) );
-    fmt_out = fmt_in;
-    fmt_out.i_chroma = VLC_FOURCC('Y','U','V','A');
-
-    /* */
-    p_pip = image_Convert( p_image, p_pic, &fmt_in, &fmt_out );
-    if( !p_pip )
-        return VLC_EGENERIC;
-
-    p_subpic = spu_CreateSubpicture( p_vout->p_spu );
-    if( p_subpic == NULL )
-    {
-         picture_Release( p_pip );
-         return VLC_EGENERIC;
-    }
-
-    p_subpic->i_channel = 0;
-    p_subpic->i_start = mdate();
-    p_subpic->i_stop = mdate() + 4000000;
-    p_subpic->b_ephemer = true;
-    p_subpic->b_fade = true;
-    p_subpic->i_original_picture_width = fmt_out.i_width * 4;
-    p_subpic->i_original_picture_height = fmt_out.i_height * 4;
-    fmt_out.i_aspect = 0;
-    fmt_out.i_sar_num =
-    fmt_out.i_sar_den = 0;
-
-    p_subpic->p_region = spu_CreateRegion( p_vout->p_spu, &fmt_out );
-    if( p_subpic->p_region )
-        vout_CopyPicture( p_image->p_parent, &p_subpic->p_region->picture, p_pip );
-    picture_Release( p_pip );
-
-    spu_DisplaySubpicture( p_vout->p_spu, p_subpic );
-    return VLC_SUCCESS;
-}
 /**
  * This function will return the default directory used for snapshots
  */
@@ -554,15 +508,19 @@ static char *VoutSnapshotGetDefaultDirectory( vout_thread_t *p_vout )
 
 int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
 {
-    image_handler_t *p_image = image_HandlerCreate( p_vout );
     video_format_t fmt_in, fmt_out;
     char *psz_filename = NULL;
     vlc_value_t val, format;
     DIR *path;
-    int i_ret;
     bool b_embedded_snapshot;
     int i_id = 0;
 
+    /* The snapshots are encoded and written by a thread */
+    if( !p_vout->p_snapshot )
+        p_vout->p_snapshot = vout_SnapshotNew( p_vout );
+    if( !p_vout->p_snapshot )
+        return VLC_ENOMEM;
+
     /* */
     val.psz_string = var_GetNonEmptyString( p_vout, "snapshot-path" );
 
@@ -621,80 +579,25 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
     }
 
     /* Embedded snapshot
-       create a snapshot_t* and store it in
-       object(object-id)->p_private, then unlock and signal the
-       waiting object.
+       the snapshot_t* is stored in object(object-id)->p_private by the
+       snapshot thread, which then signals the waiting object.
      */
     if( b_embedded_snapshot )
     {
         vlc_object_t* p_dest;
-        block_t *p_block;
-        snapshot_t *p_snapshot;
-        size_t i_size;
 
+        free( val.psz_string );
         /* Destination object-id is following object: */
         p_dest = ( vlc_object_t* )vlc_object_get( i_id );
         if( !p_dest )
         {
             msg_Err( p_vout, "Cannot find calling object" );
-            image_HandlerDelete( p_image );
             return VLC_EGENERIC;
         }
-        /* Object must be locked. We will unlock it once we get the
-           snapshot and written it to p_private */
         p_dest->p_private = NULL;
 
-        /* Save the snapshot to a memory zone */
-        p_block = image_Write( p_image, p_pic, &fmt_in, &fmt_out );
-        if( !p_block )
-        {
-            msg_Err( p_vout, "Could not get snapshot" );
-            image_HandlerDelete( p_image );
-            vlc_object_signal( p_dest );
-            vlc_object_release( p_dest );
-            return VLC_EGENERIC;
-        }
-
-        /* Copy the p_block data to a snapshot structure */
-        /* FIXME: get the timestamp */
-        p_snapshot = malloc( sizeof( snapshot_t ) );
-        if( !p_snapshot )
-        {
-            block_Release( p_block );
-            image_HandlerDelete( p_image );
-            vlc_object_signal( p_dest );
-            vlc_object_release( p_dest );
-            return VLC_ENOMEM;
-        }
-
-        i_size = p_block->i_buffer;
-
-        p_snapshot->i_width = fmt_out.i_width;
-        p_snapshot->i_height = fmt_out.i_height;
-        p_snapshot->i_datasize = i_size;
-        p_snapshot->date = p_block->i_pts; /* FIXME ?? */
-        p_snapshot->p_data = malloc( i_size );
-        if( !p_snapshot->p_data )
-        {
-            block_Release( p_block );
-            free( p_snapshot );
-            image_HandlerDelete( p_image );
-            vlc_object_signal( p_dest );
-            vlc_object_release( p_dest );
-            return VLC_ENOMEM;
-        }
-        memcpy( p_snapshot->p_data, p_block->p_buffer, p_block->i_buffer );
-
-        p_dest->p_private = p_snapshot;
-
-        block_Release( p_block );
-
-        /* Unlock the object */
-        vlc_object_signal( p_dest );
-        vlc_object_release( p_dest );
-
-        image_HandlerDelete( p_image );
-        return VLC_SUCCESS;
+        return vout_SnapshotPut( p_vout->p_snapshot, p_pic, &fmt_in, &fmt_out,
+                                 NULL, p_dest, false );
     }
 
     /* Get default directory if none provided */
@@ -703,7 +606,6 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
     if( !val.psz_string )
     {
         msg_Err( p_vout, "no path specified for snapshots" );
-        image_HandlerDelete( p_image );
         return VLC_EGENERIC;
     }
 
@@ -714,7 +616,6 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
     if( !format.psz_string )
     {
         free( val.psz_string );
-        image_HandlerDelete( p_image );
         return VLC_ENOMEM;
     }
 
@@ -749,7 +650,6 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
                               format.psz_string ) == -1 )
                 {
                     msg_Err( p_vout, "could not create snapshot" );
-                    image_HandlerDelete( p_image );
                     return VLC_EGENERIC;
                 }
             }
@@ -765,7 +665,6 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
                           format.psz_string ) == -1 )
             {
                 msg_Err( p_vout, "could not create snapshot" );
-                image_HandlerDelete( p_image );
                 return VLC_EGENERIC;
             }
         }
@@ -782,30 +681,9 @@ int vout_Snapshot( vout_thread_t *p_vout, picture_t *p_pic )
     free( format.psz_string );
 
     /* Save the snapshot */
-    i_ret = image_WriteUrl( p_image, p_pic, &fmt_in, &fmt_out, psz_filename );
-    if( i_ret != VLC_SUCCESS )
-    {
-        msg_Err( p_vout, "could not create snapshot %s", psz_filename );
-        free( psz_filename );
-        image_HandlerDelete( p_image );
-        return VLC_EGENERIC;
-    }
-
-    /* */
-    msg_Dbg( p_vout, "snapshot taken (%s)", psz_filename );
-    vout_OSDMessage( VLC_OBJECT( p_vout ), DEFAULT_CHAN,
-                     "%s", psz_filename );
-    free( psz_filename );
-
-    /* */
-    if( var_GetBool( p_vout, "snapshot-preview" ) )
-    {
-        if( VoutSnapshotPip( p_vout, p_image, p_pic, &fmt_in ) )
-            msg_Warn( p_vout, "Failed to display snapshot" );
-    }
-    image_HandlerDelete( p_image );
-
-    return VLC_SUCCESS;
+    return vout_SnapshotPut( p_vout->p_snapshot, p_pic, &fmt_in, &fmt_out,
+                             psz_filename, NULL,
+                             var_GetBool( p_vout, "snapshot-preview" ) );
 }
 
 /*****************************************************************************
@@ -55,6 +55,8 @@ void vout_DisplayPicture( vout_thread_t *p_vout, picture_t *p_pic )
         break;
     case RESERVED_DATED_PICTURE:
         p_pic->i_status = READY_PICTURE;
+        p_vout->i_picture_queued++;
+        vlc_cond_signal( &p_vout->picture_queued );
         break;
     default:
         msg_Err( p_vout, "picture to display %p has invalid status %d",
@@ -87,6 +89,8 @@ void vout_DatePicture( vout_thread_t *p_vout,
         break;
     case RESERVED_DISP_PICTURE:
         p_pic->i_status = READY_PICTURE;
+        p_vout->i_picture_queued++;
+        vlc_cond_signal( &p_vout->picture_queued );
         break;
     default:
         msg_Err( p_vout, "picture to date %p has invalid status %d",
@@ -98,49 +102,59 @@ void vout_DatePicture( vout_thread_t *p_vout,
 }
 
 /**
- * Allocate a picture in the video output heap.
- *
- * This function creates a reserved image in the video output heap.
- * A null pointer is returned if the function fails. This method provides an
- * already allocated zone of memory in the picture data fields.
- * It needs locking since several pictures can be created by several producers
- * threads.
+ * Return the number of pictures that can be created right now.
  */
 int vout_CountPictureAvailable( vout_thread_t *p_vout )
 {
-    int i_free = 0;
-    int i_pic;
+    int i_free;
 
     vlc_mutex_lock( &p_vout->picture_lock );
-    for( i_pic = 0; i_pic < I_RENDERPICTURES; i_pic++ )
-    {
-        picture_t *p_pic = PP_RENDERPICTURE[(p_vout->render.i_last_used_pic + i_pic + 1) % I_RENDERPICTURES];
+    i_free = p_vout->i_free_pictures;
+    vlc_mutex_unlock( &p_vout->picture_lock );
 
-        switch( p_pic->i_status )
-        {
-            case DESTROYED_PICTURE:
-                i_free++;
-                break;
+    return i_free;
+}
 
-            case FREE_PICTURE:
-                i_free++;
-                break;
+/**
+ * Wait for pictures to become available in the video output heap.
+ *
+ * This blocks until at least i_count pictures could be created, or until
+ * the given date. It is woken up whenever a picture goes back to the heap,
+ * that is when it is destroyed, or displayed and no longer linked.
+ * \return the number of available pictures
+ */
+int vout_WaitPictureAvailable( vout_thread_t *p_vout, int i_count,
+                               mtime_t i_deadline )
+{
+    int i_free;
 
-            default:
-                break;
-        }
+    vlc_mutex_lock( &p_vout->picture_lock );
+    while( p_vout->i_free_pictures < i_count )
+    {
+        if( vlc_cond_timedwait( &p_vout->picture_released,
+                                &p_vout->picture_lock, i_deadline ) )
+            break;
     }
+    i_free = p_vout->i_free_pictures;
     vlc_mutex_unlock( &p_vout->picture_lock );
 
     return i_free;
 }
 
+/**
+ * Allocate a picture in the video output heap.
+ *
+ * This function creates a reserved image in the video output heap.
+ * A null pointer is returned if the function fails. This method provides an
+ * already allocated zone of memory in the picture data fields.
+ * It needs locking since several pictures can be created by several producers
+ * threads.
+ */
 picture_t *vout_CreatePicture( vout_thread_t *p_vout,
                                bool b_progressive,
                                bool b_top_field_first,
                                unsigned int i_nb_fields )
 {
-    int         i_pic;                                      /* picture index */
     picture_t * p_pic;
     picture_t * p_freepic = NULL;                      /* first free picture */
 
@@ -148,44 +162,35 @@ picture_t *vout_CreatePicture( vout_thread_t *p_vout,
     vlc_mutex_lock( &p_vout->picture_lock );
 
     /*
-     * Look for an empty place in the picture heap.
+     * Take the last picture given back to the heap. Destroyed pictures are
+     * pushed on top of the free ones, so that memory gets reused first.
      */
-    for( i_pic = 0; i_pic < I_RENDERPICTURES; i_pic++ )
+    while( p_vout->i_free_pictures > 0 )
     {
-        p_pic = PP_RENDERPICTURE[(p_vout->render.i_last_used_pic + i_pic + 1)
-                                 % I_RENDERPICTURES];
+        p_pic = p_vout->pp_free_picture[--p_vout->i_free_pictures];
+
+        if( p_pic->i_status == DESTROYED_PICTURE )
+        {
+            /* Memory will not be reallocated, and function can end
+             * immediately - this is the best possible case, since no
+             * memory allocation needs to be done */
+            p_pic->i_status   = RESERVED_PICTURE;
+            p_pic->i_refcount = 0;
+            p_pic->b_force    = 0;
+
+            p_pic->b_progressive        = b_progressive;
+            p_pic->i_nb_fields          = i_nb_fields;
+            p_pic->b_top_field_first    = b_top_field_first;
 
-        switch( p_pic->i_status )
+            p_vout->i_heap_size++;
+            vlc_mutex_unlock( &p_vout->picture_lock );
+            return( p_pic );
+        }
+        else if( p_pic->i_status == FREE_PICTURE )
         {
-            case DESTROYED_PICTURE:
-                /* Memory will not be reallocated, and function can end
-                 * immediately - this is the best possible case, since no
-                 * memory allocation needs to be done */
-                p_pic->i_status   = RESERVED_PICTURE;
-                p_pic->i_refcount = 0;
-                p_pic->b_force    = 0;
-
-                p_pic->b_progressive        = b_progressive;
-                p_pic->i_nb_fields          = i_nb_fields;
-                p_pic->b_top_field_first    = b_top_field_first;
-
-                p_vout->i_heap_size++;
-                p_vout->render.i_last_used_pic =
-                    ( p_vout->render.i_last_used_pic + i_pic + 1 )
-                    % I_RENDERPICTURES;
-                vlc_mutex_unlock( &p_vout->picture_lock );
-                return( p_pic );
-
-            case FREE_PICTURE:
-                /* Picture is empty and ready for allocation */
-                p_vout->render.i_last_used_pic =
-                    ( p_vout->render.i_last_used_pic + i_pic + 1 )
-                    % I_RENDERPICTURES;
-                p_freepic = p_pic;
-                break;
-
-            default:
-                break;
+            /* Picture is empty and ready for allocation */
+            p_freepic = p_pic;
+            break;
         }
     }
 
@@ -221,6 +226,7 @@ picture_t *vout_CreatePicture( vout_thread_t *p_vout,
         {
             /* Memory allocation failed : set picture as empty */
             p_freepic->i_status = FREE_PICTURE;
+            p_vout->pp_free_picture[p_vout->i_free_pictures++] = p_freepic;
             p_freepic = NULL;
 
             msg_Err( p_vout, "picture allocation failed" );
@@ -260,10 +266,35 @@ void vout_DestroyPicture( vout_thread_t *p_vout, picture_t *p_pic )
     }
 #endif
 
+    vout_RecyclePicture( p_vout, p_pic );
+
+    vlc_mutex_unlock( &p_vout->picture_lock );
+}
+
+/**
+ * Give a picture back to the heap
+ *
+ * The picture is marked as destroyed, and if it belongs to the render heap,
+ * made available to vout_CreatePicture and the waiters of
+ * vout_WaitPictureAvailable. The picture lock must be held.
+ */
+void vout_RecyclePicture( vout_thread_t *p_vout, picture_t *p_pic )
+{
+    const bool b_free = p_pic->i_status == DESTROYED_PICTURE ||
+                        p_pic->i_status == FREE_PICTURE;
+
     p_pic->i_status = DESTROYED_PICTURE;
     p_vout->i_heap_size--;
 
-    vlc_mutex_unlock( &p_vout->picture_lock );
+    /* The render pictures are contiguous in p_vout->p_picture */
+    if( !b_free && I_RENDERPICTURES > 0 &&
+        p_pic >= PP_RENDERPICTURE[0] &&
+        p_pic <= PP_RENDERPICTURE[I_RENDERPICTURES - 1] )
+    {
+        assert( p_vout->i_free_pictures < I_RENDERPICTURES );
+        p_vout->pp_free_picture[p_vout->i_free_pictures++] = p_pic;
+        vlc_cond_signal( &p_vout->picture_released );
+    }
 }
 
 /**
@@ -292,13 +323,41 @@ void vout_UnlinkPicture( vout_thread_t *p_vout, picture_t *p_pic )
     if( ( p_pic->i_refcount == 0 ) &&
         ( p_pic->i_status == DISPLAYED_PICTURE ) )
     {
-        p_pic->i_status = DESTROYED_PICTURE;
-        p_vout->i_heap_size--;
+        vout_RecyclePicture( p_vout, p_pic );
     }
 
     vlc_mutex_unlock( &p_vout->picture_lock );
 }
 
+/**
+ * Pick the direct buffer to convert a picture into
+ *
+ * With indirect rendering, the direct buffers are only written here, so
+ * they can be used in turn. A buffer the output still links (it may be
+ * reading it asynchronously) is skipped, so that the next picture can be
+ * converted while the previous one is being displayed.
+ */
+static picture_t *NextOutputPicture( vout_thread_t *p_vout )
+{
+    int i;
+
+    for( i = 1; i <= I_OUTPUTPICTURES; i++ )
+    {
+        int i_pic = ( p_vout->output.i_last_used_pic + i ) % I_OUTPUTPICTURES;
+
+        if( PP_OUTPUTPICTURE[i_pic]->i_refcount == 0 )
+        {
+            p_vout->output.i_last_used_pic = i_pic;
+            return PP_OUTPUTPICTURE[i_pic];
+        }
+    }
+
+    /* All of them are in use: pf_lock will wait for the oldest one */
+    p_vout->output.i_last_used_pic =
+        ( p_vout->output.i_last_used_pic + 1 ) % I_OUTPUTPICTURES;
+    return PP_OUTPUTPICTURE[p_vout->output.i_last_used_pic];
+}
+
 /**
  * Render a picture
  *
@@ -310,6 +369,7 @@ picture_t * vout_RenderPicture( vout_thread_t *p_vout, picture_t *p_pic,
                                                        subpicture_t *p_subpic )
 {
     int i_scale_width, i_scale_height;
+    picture_t *p_out;
 
     if( p_pic == NULL )
     {
@@ -335,12 +395,21 @@ picture_t * vout_RenderPicture( vout_thread_t *p_vout, picture_t *p_pic,
                 /* We have subtitles. First copy the picture to
                  * the spare direct buffer, then render the
                  * subtitles. */
+                if( PP_OUTPUTPICTURE[0]->pf_lock )
+                    if( PP_OUTPUTPICTURE[0]->pf_lock( p_vout,
+                                                      PP_OUTPUTPICTURE[0] ) )
+                        return NULL;
+
                 vout_CopyPicture( p_vout, PP_OUTPUTPICTURE[0], p_pic );
 
                 spu_RenderSubpictures( p_vout->p_spu, &p_vout->fmt_out,
                                        PP_OUTPUTPICTURE[0], p_pic, p_subpic,
                                        i_scale_width, i_scale_height );
 
+                if( PP_OUTPUTPICTURE[0]->pf_unlock )
+                    PP_OUTPUTPICTURE[0]->pf_unlock( p_vout,
+                                                    PP_OUTPUTPICTURE[0] );
+
                 return PP_OUTPUTPICTURE[0];
             }
 
@@ -387,12 +456,14 @@ picture_t * vout_RenderPicture( vout_thread_t *p_vout, picture_t *p_pic,
      * well. This usually means software YUV, or hardware YUV with a
      * different chroma. */
 
-    if( p_subpic != NULL && p_vout->p_picture[0].b_slow )
+    p_out = NextOutputPicture( p_vout );
+
+    if( p_subpic != NULL && p_out->b_slow )
     {
         /* The picture buffer is in slow memory. We'll use
-         * the "2 * VOUT_MAX_PICTURES + 1" picture as a temporary
-         * one for subpictures rendering. */
-        picture_t *p_tmp_pic = &p_vout->p_picture[2 * VOUT_MAX_PICTURES];
+         * the last picture of the heap as a temporary one for
+         * subpictures rendering. */
+        picture_t *p_tmp_pic = &p_vout->p_picture[p_vout->i_heap_pictures - 1];
         if( p_tmp_pic->i_status == FREE_PICTURE )
         {
             vout_AllocatePicture( VLC_OBJECT(p_vout),
@@ -406,41 +477,41 @@ picture_t * vout_RenderPicture( vout_thread_t *p_vout, picture_t *p_pic,
             p_tmp_pic->p_heap = &p_vout->output;
         }
 
-        /* Convert image to the first direct buffer */
+        /* Convert image to the temporary picture */
         p_vout->p_chroma->p_owner = (filter_owner_sys_t *)p_tmp_pic;
         p_vout->p_chroma->pf_video_filter( p_vout->p_chroma, p_pic );
 
-        /* Render subpictures on the first direct buffer */
+        /* Render subpictures on the temporary picture */
         spu_RenderSubpictures( p_vout->p_spu, &p_vout->fmt_out, p_tmp_pic,
                                p_tmp_pic, p_subpic,
                                i_scale_width, i_scale_height );
 
-        if( p_vout->p_picture[0].pf_lock )
-            if( p_vout->p_picture[0].pf_lock( p_vout, &p_vout->p_picture[0] ) )
+        if( p_out->pf_lock )
+            if( p_out->pf_lock( p_vout, p_out ) )
                 return NULL;
 
-        vout_CopyPicture( p_vout, &p_vout->p_picture[0], p_tmp_pic );
+        vout_CopyPicture( p_vout, p_out, p_tmp_pic );
     }
     else
     {
-        if( p_vout->p_picture[0].pf_lock )
-            if( p_vout->p_picture[0].pf_lock( p_vout, &p_vout->p_picture[0] ) )
+        if( p_out->pf_lock )
+            if( p_out->pf_lock( p_vout, p_out ) )
                 return NULL;
 
-        /* Convert image to the first direct buffer */
-        p_vout->p_chroma->p_owner = (filter_owner_sys_t *)&p_vout->p_picture[0];
+        /* Convert image to the direct buffer */
+        p_vout->p_chroma->p_owner = (filter_owner_sys_t *)p_out;
         p_vout->p_chroma->pf_video_filter( p_vout->p_chroma, p_pic );
 
-        /* Render subpictures on the first direct buffer */
+        /* Render subpictures on the direct buffer */
         spu_RenderSubpictures( p_vout->p_spu, &p_vout->fmt_out,
-                               &p_vout->p_picture[0], &p_vout->p_picture[0],
+                               p_out, p_out,
                                p_subpic, i_scale_width, i_scale_height );
     }
 
-    if( p_vout->p_picture[0].pf_unlock )
-        p_vout->p_picture[0].pf_unlock( p_vout, &p_vout->p_picture[0] );
+    if( p_out->pf_unlock )
+        p_out->pf_unlock( p_vout, p_out );
 
-    return &p_vout->p_picture[0];
+    return p_out;
 }
 
 /**
@@ -0,0 +1,414 @@
+/*****************************************************************************
+ * vout_snapshot.c : snapshot writer thread of the video output
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_vout.h>
+#include <vlc_block.h>
+#include <vlc_image.h>
+#include <vlc_osd.h>
+
+#include "vout_snapshot.h"
+
+/* Snapshots waiting for the thread; the next ones are dropped */
+#define SNAPSHOT_MAX_PENDING 16
+/* Image handlers kept, one per output format */
+#define SNAPSHOT_HANDLERS 4
+
+typedef struct snapshot_job_t snapshot_job_t;
+struct snapshot_job_t
+{
+    snapshot_job_t *p_next;
+
+    picture_t      *p_pic;          /* private copy */
+    video_format_t  fmt_in;
+    video_format_t  fmt_out;
+    char           *psz_filename;   /* NULL for an embedded snapshot */
+    vlc_object_t   *p_dest;         /* receiver of an embedded snapshot */
+    bool            b_preview;
+};
+
+typedef struct
+{
+    VLC_COMMON_MEMBERS
+
+    vout_snapshot_t *p_snapshot;
+} snapshot_worker_t;
+
+typedef struct
+{
+    image_handler_t *p_image;
+    char             psz_ext[8];    /* empty for the embedded snapshots */
+    unsigned         i_last_use;
+} snapshot_handler_t;
+
+struct vout_snapshot_t
+{
+    vout_thread_t      *p_vout;
+    snapshot_worker_t  *p_worker;   /* started on the first snapshot */
+
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait;       /* a job was queued, or stopping */
+    bool                b_stop;
+    snapshot_job_t     *p_first;
+    snapshot_job_t    **pp_last;
+    int                 i_pending;
+
+    /* Used by the thread only */
+    snapshot_handler_t  handlers[SNAPSHOT_HANDLERS];
+    unsigned            i_uses;
+};
+
+/*****************************************************************************
+ * Image handlers
+ *****************************************************************************/
+static image_handler_t *GetHandler( vout_snapshot_t *p_snapshot,
+                                    const char *psz_filename )
+{
+    const char *psz_ext = psz_filename ? strrchr( psz_filename, '.' ) : NULL;
+    snapshot_handler_t *p_handler = &p_snapshot->handlers[0];
+    char psz_key[8];
+
+    strlcpy( psz_key, psz_ext ? psz_ext + 1 : "", sizeof(psz_key) );
+
+    for( int i = 0; i < SNAPSHOT_HANDLERS; i++ )
+    {
+        snapshot_handler_t *p = &p_snapshot->handlers[i];
+
+        if( p->p_image && !strcasecmp( p->psz_ext, psz_key ) )
+        {
+            p_handler = p;
+            goto found;
+        }
+        /* An unused slot, or else the least recently used one */
+        if( p_handler->p_image &&
+            ( !p->p_image || p->i_last_use < p_handler->i_last_use ) )
+            p_handler = p;
+    }
+
+    if( p_handler->p_image )
+        image_HandlerDelete( p_handler->p_image );
+    p_handler->p_image = image_HandlerCreate( p_snapshot->p_vout );
+    if( !p_handler->p_image )
+        return NULL;
+    strcpy( p_handler->psz_ext, psz_key );
+
+found:
+    p_handler->i_last_use = ++p_snapshot->i_uses;
+    return p_handler->p_image;
+}
+
+/*****************************************************************************
+ * Snapshot writing
+ *****************************************************************************/
+/**
+ * This function will inject a subpicture into the vout with the provided
+ * picture
+ */
+static int SnapshotPip( vout_thread_t *p_vout, image_handler_t *p_image,
+                        picture_t *p_pic, const video_format_t *p_fmt_in )
+{
+    video_format_t fmt_in = *p_fmt_in;
+    video_format_t fmt_out;
+    picture_t *p_pip;
+    subpicture_t *p_subpic;
+
+    /* */
+    memset( &fmt_out, 0, sizeof(fmt_out) );
+    fmt_out = fmt_in;
+    fmt_out.i_chroma = VLC_FOURCC('Y','U','V','A');
+
+    /* */
+    p_pip = image_Convert( p_image, p_pic, &fmt_in, &fmt_out );
+    if( !p_pip )
+        return VLC_EGENERIC;
+
+    p_subpic = spu_CreateSubpicture( p_vout->p_spu );
+    if( p_subpic == NULL )
+    {
+         picture_Release( p_pip );
+         return VLC_EGENERIC;
+    }
+
+    p_subpic->i_channel = 0;
+    p_subpic->i_start = mdate();
+    p_subpic->i_stop = mdate() + 4000000;
+    p_subpic->b_ephemer = true;
+    p_subpic->b_fade = true;
+    p_subpic->i_original_picture_width = fmt_out.i_width * 4;
+    p_subpic->i_original_picture_height = fmt_out.i_height * 4;
+    fmt_out.i_aspect = 0;
+    fmt_out.i_sar_num =
+    fmt_out.i_sar_den = 0;
+
+    p_subpic->p_region = spu_CreateRegion( p_vout->p_spu, &fmt_out );
+    if( p_subpic->p_region )
+        vout_CopyPicture( p_image->p_parent, &p_subpic->p_region->picture, p_pip );
+    picture_Release( p_pip );
+
+    spu_DisplaySubpicture( p_vout->p_spu, p_subpic );
+    return VLC_SUCCESS;
+}
+
+/* Creates a snapshot_t and stores it in p_dest->p_private */
+static int SnapshotEmbedded( vout_thread_t *p_vout, image_handler_t *p_image,
+                             snapshot_job_t *p_job )
+{
+    snapshot_t *p_snapshot;
+    block_t *p_block;
+
+    /* Save the snapshot to a memory zone */
+    p_block = image_Write( p_image, p_job->p_pic,
+                           &p_job->fmt_in, &p_job->fmt_out );
+    if( !p_block )
+    {
+        msg_Err( p_vout, "Could not get snapshot" );
+        return VLC_EGENERIC;
+    }
+
+    /* Copy the p_block data to a snapshot structure */
+    /* FIXME: get the timestamp */
+    p_snapshot = malloc( sizeof( snapshot_t ) );
+    if( !p_snapshot )
+    {
+        block_Release( p_block );
+        return VLC_ENOMEM;
+    }
+
+    p_snapshot->i_width = p_job->fmt_out.i_width;
+    p_snapshot->i_height = p_job->fmt_out.i_height;
+    p_snapshot->i_datasize = p_block->i_buffer;
+    p_snapshot->date = p_block->i_pts; /* FIXME ?? */
+    p_snapshot->p_data = malloc( p_block->i_buffer );
+    if( !p_snapshot->p_data )
+    {
+        block_Release( p_block );
+        free( p_snapshot );
+        return VLC_ENOMEM;
+    }
+    memcpy( p_snapshot->p_data, p_block->p_buffer, p_block->i_buffer );
+    block_Release( p_block );
+
+    p_job->p_dest->p_private = p_snapshot;
+    return VLC_SUCCESS;
+}
+
+static void SnapshotFile( vout_thread_t *p_vout, image_handler_t *p_image,
+                          snapshot_job_t *p_job )
+{
+    /* Save the snapshot */
+    if( image_WriteUrl( p_image, p_job->p_pic, &p_job->fmt_in,
+                        &p_job->fmt_out, p_job->psz_filename ) )
+    {
+        msg_Err( p_vout, "could not create snapshot %s",
+                 p_job->psz_filename );
+        return;
+    }
+
+    /* */
+    msg_Dbg( p_vout, "snapshot taken (%s)", p_job->psz_filename );
+    vout_OSDMessage( VLC_OBJECT( p_vout ), DEFAULT_CHAN,
+                     "%s", p_job->psz_filename );
+
+    /* */
+    if( p_job->b_preview &&
+        SnapshotPip( p_vout, p_image, p_job->p_pic, &p_job->fmt_in ) )
+        msg_Warn( p_vout, "Failed to display snapshot" );
+}
+
+/* Releases a job, and wakes the receiver of an embedded snapshot, which
+ * finds NULL in p_private if it was not taken */
+static void JobDelete( snapshot_job_t *p_job )
+{
+    if( p_job->p_dest )
+    {
+        vlc_object_signal( p_job->p_dest );
+        vlc_object_release( p_job->p_dest );
+    }
+    if( p_job->p_pic )
+        picture_Release( p_job->p_pic );
+    free( p_job->psz_filename );
+    free( p_job );
+}
+
+static void *Worker( vlc_object_t *p_this )
+{
+    vout_snapshot_t *p_snapshot = ((snapshot_worker_t *)p_this)->p_snapshot;
+    vout_thread_t *p_vout = p_snapshot->p_vout;
+
+    vlc_mutex_lock( &p_snapshot->lock );
+    for( ;; )
+    {
+        snapshot_job_t *p_job;
+        image_handler_t *p_image;
+
+        /* The queued snapshots are written before stopping */
+        while( !p_snapshot->b_stop && !p_snapshot->p_first )
+            vlc_cond_wait( &p_snapshot->wait, &p_snapshot->lock );
+        if( !p_snapshot->p_first )
+            break;
+
+        p_job = p_snapshot->p_first;
+        p_snapshot->p_first = p_job->p_next;
+        if( !p_snapshot->p_first )
+            p_snapshot->pp_last = &p_snapshot->p_first;
+        p_snapshot->i_pending--;
+        vlc_mutex_unlock( &p_snapshot->lock );
+
+        p_image = GetHandler( p_snapshot, p_job->psz_filename );
+        if( !p_image )
+            msg_Err( p_vout, "could not create snapshot" );
+        else if( p_job->psz_filename )
+            SnapshotFile( p_vout, p_image, p_job );
+        else
+            SnapshotEmbedded( p_vout, p_image, p_job );
+        JobDelete( p_job );
+
+        vlc_mutex_lock( &p_snapshot->lock );
+    }
+    vlc_mutex_unlock( &p_snapshot->lock );
+    return NULL;
+}
+
+/*****************************************************************************
+ * Queue
+ *****************************************************************************/
+vout_snapshot_t *vout_SnapshotNew( vout_thread_t *p_vout )
+{
+    vout_snapshot_t *p_snapshot = calloc( 1, sizeof( *p_snapshot ) );
+
+    if( p_snapshot == NULL )
+        return NULL;
+    p_snapshot->p_vout = p_vout;
+    p_snapshot->pp_last = &p_snapshot->p_first;
+    vlc_mutex_init( &p_snapshot->lock );
+    vlc_cond_init( NULL, &p_snapshot->wait );
+    return p_snapshot;
+}
+
+void vout_SnapshotDelete( vout_snapshot_t *p_snapshot )
+{
+    if( p_snapshot == NULL )
+        return;
+
+    if( p_snapshot->p_worker )
+    {
+        vlc_mutex_lock( &p_snapshot->lock );
+        p_snapshot->b_stop = true;
+        vlc_cond_signal( &p_snapshot->wait );
+        vlc_mutex_unlock( &p_snapshot->lock );
+
+        vlc_thread_join( p_snapshot->p_worker );
+        vlc_object_release( p_snapshot->p_worker );
+    }
+
+    for( int i = 0; i < SNAPSHOT_HANDLERS; i++ )
+        if( p_snapshot->handlers[i].p_image )
+            image_HandlerDelete( p_snapshot->handlers[i].p_image );
+
+    vlc_cond_destroy( &p_snapshot->wait );
+    vlc_mutex_destroy( &p_snapshot->lock );
+    free( p_snapshot );
+}
+
+static int StartWorker( vout_snapshot_t *p_snapshot )
+{
+    snapshot_worker_t *p_worker = vlc_object_create( p_snapshot->p_vout,
+                                                     sizeof( *p_worker ) );
+
+    if( p_worker == NULL )
+        return VLC_ENOMEM;
+    p_worker->p_snapshot = p_snapshot;
+    if( vlc_thread_create( p_worker, "snapshot writer", Worker,
+                           VLC_THREAD_PRIORITY_LOW, false ) )
+    {
+        vlc_object_release( p_worker );
+        return VLC_EGENERIC;
+    }
+    p_snapshot->p_worker = p_worker;
+    return VLC_SUCCESS;
+}
+
+int vout_SnapshotPut( vout_snapshot_t *p_snapshot, picture_t *p_pic,
+                      const video_format_t *p_fmt_in,
+                      const video_format_t *p_fmt_out,
+                      char *psz_filename, vlc_object_t *p_dest,
+                      bool b_preview )
+{
+    vout_thread_t *p_vout = p_snapshot->p_vout;
+    snapshot_job_t *p_job = calloc( 1, sizeof( *p_job ) );
+
+    if( p_job == NULL )
+    {
+        free( psz_filename );
+        if( p_dest )
+        {
+            vlc_object_signal( p_dest );
+            vlc_object_release( p_dest );
+        }
+        return VLC_ENOMEM;
+    }
+    p_job->psz_filename = psz_filename;
+    p_job->p_dest = p_dest;
+    p_job->fmt_in = *p_fmt_in;
+    p_job->fmt_out = *p_fmt_out;
+    p_job->b_preview = b_preview;
+
+    if( !p_snapshot->p_worker && StartWorker( p_snapshot ) )
+    {
+        msg_Err( p_vout, "cannot start the snapshot thread" );
+        JobDelete( p_job );
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_lock( &p_snapshot->lock );
+    if( p_snapshot->i_pending >= SNAPSHOT_MAX_PENDING )
+    {
+        vlc_mutex_unlock( &p_snapshot->lock );
+        msg_Warn( p_vout, "dropping snapshot, %d are being written",
+                  SNAPSHOT_MAX_PENDING );
+        JobDelete( p_job );
+        return VLC_EGENERIC;
+    }
+    vlc_mutex_unlock( &p_snapshot->lock );
+
+    /* The pictures of the video output are given back to the decoder once
+     * displayed, so the thread gets a copy */
+    p_job->p_pic = picture_New( p_fmt_in->i_chroma, p_fmt_in->i_width,
+                                p_fmt_in->i_height, p_fmt_in->i_aspect );
+    if( p_job->p_pic == NULL )
+    {
+        JobDelete( p_job );
+        return VLC_ENOMEM;
+    }
+    picture_Copy( p_job->p_pic, p_pic );
+
+    vlc_mutex_lock( &p_snapshot->lock );
+    *p_snapshot->pp_last = p_job;
+    p_snapshot->pp_last = &p_job->p_next;
+    p_snapshot->i_pending++;
+    vlc_cond_signal( &p_snapshot->wait );
+    vlc_mutex_unlock( &p_snapshot->lock );
+    return VLC_SUCCESS;
+}
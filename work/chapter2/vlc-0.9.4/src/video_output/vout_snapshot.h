@@ -0,0 +1,51 @@
+/*****************************************************************************
+ * vout_snapshot.h : snapshot writer thread of the video output
+ *****************************************************************************
+ * Copyright (C) 2008 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _VOUT_SNAPSHOT_H_
+#define _VOUT_SNAPSHOT_H_ 1
+
+/*
+ * The snapshots are encoded and written by a thread of their own, so that
+ * the video output only copies the picture and goes on displaying. The
+ * thread is started on the first snapshot, and keeps its image handlers, with
+ * their encoder and converter, from one snapshot to the next.
+ */
+
+vout_snapshot_t *vout_SnapshotNew( vout_thread_t * );
+
+/* Writes the snapshots still queued, then stops the thread */
+void vout_SnapshotDelete( vout_snapshot_t * );
+
+/**
+ * Queues a snapshot of a picture of the video output.
+ *
+ * The snapshot is written to psz_filename, which the queue takes, or, if it
+ * is NULL, given to p_dest as a snapshot_t in p_private; p_dest, whose
+ * reference is taken too, is signaled either way. A full queue drops the
+ * snapshot.
+ */
+int vout_SnapshotPut( vout_snapshot_t *, picture_t *,
+                      const video_format_t *p_fmt_in,
+                      const video_format_t *p_fmt_out,
+                      char *psz_filename, vlc_object_t *p_dest,
+                      bool b_preview );
+
+#endif